@@ -231,6 +231,11 @@ L_CFLAGS += -DCONFIG_SAE
 OBJS += src/common/sae.c
 NEED_ECC=y
 NEED_DH_GROUPS=y
+ifdef CONFIG_SAE_WORKERS
+# SAE commit processing in worker threads (sae_worker_threads)
+L_CFLAGS += -DCONFIG_SAE_WORKERS
+OBJS += src/ap/sae_workers.c
+endif
 endif
 
 ifdef CONFIG_WNM
@@ -509,6 +514,11 @@ NEED_DES=y
 L_CFLAGS += -DEAP_TLS_FUNCS
 OBJS += src/eap_server/eap_server_tls_common.c
 NEED_TLS_PRF=y
+ifdef CONFIG_TLS_WORKERS
+# TLS handshake processing in worker threads (requires CONFIG_TLS=internal)
+L_CFLAGS += -DCONFIG_TLS_WORKERS
+OBJS += src/eap_server/eap_tls_workers.c
+endif
 endif
 
 ifndef CONFIG_TLS
@@ -594,6 +604,7 @@ OBJS += src/tls/tlsv1_cred.c
 OBJS += src/tls/tlsv1_server.c
 OBJS += src/tls/tlsv1_server_write.c
 OBJS += src/tls/tlsv1_server_read.c
+OBJS += src/tls/tlsv1_server_session.c
 OBJS += src/tls/asn1.c
 OBJS += src/tls/rsa.c
 OBJS += src/tls/x509v3.c
@@ -602,6 +613,7 @@ OBJS += src/tls/pkcs5.c
 OBJS += src/tls/pkcs8.c
 NEED_SHA256=y
 NEED_BASE64=y
+NEED_AES_CBC=y
 NEED_TLS_PRF=y
 ifdef CONFIG_TLSV12
 NEED_TLS_PRF_SHA256=y
@@ -685,6 +697,7 @@ endif
 AESOBJS = # none so far
 ifdef CONFIG_INTERNAL_AES
 AESOBJS += src/crypto/aes-internal.c src/crypto/aes-internal-enc.c
+AESOBJS += src/crypto/aes-internal-hw.c
 endif
 
 AESOBJS += src/crypto/aes-wrap.c
@@ -725,7 +738,9 @@ SHA1OBJS += src/crypto/sha1.c
 endif
 SHA1OBJS += src/crypto/sha1-prf.c
 ifdef CONFIG_INTERNAL_SHA1
+L_CFLAGS += -DCONFIG_INTERNAL_SHA1
 SHA1OBJS += src/crypto/sha1-internal.c
+SHA1OBJS += src/crypto/sha1-internal-hw.c
 ifdef NEED_FIPS186_2_PRF
 SHA1OBJS += src/crypto/fips_prf_internal.c
 endif
@@ -777,7 +792,9 @@ OBJS += src/crypto/sha256.c
 endif
 OBJS += src/crypto/sha256-prf.c
 ifdef CONFIG_INTERNAL_SHA256
+L_CFLAGS += -DCONFIG_INTERNAL_SHA256
 OBJS += src/crypto/sha256-internal.c
+OBJS += src/crypto/sha256-internal-hw.c
 endif
 ifdef NEED_TLS_PRF_SHA256
 OBJS += src/crypto/sha256-tlsprf.c
@@ -1997,6 +1997,35 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		} else if (os_strcmp(buf, "dh_file") == 0) {
 			os_free(bss->dh_file);
 			bss->dh_file = os_strdup(pos);
+		} else if (os_strcmp(buf, "tls_session_lifetime") == 0) {
+			bss->tls_session_lifetime = atoi(pos);
+		} else if (os_strcmp(buf, "tls_session_cache_size") == 0) {
+			bss->tls_session_cache_size = atoi(pos);
+		} else if (os_strcmp(buf, "tls_session_cache_file") == 0) {
+			os_free(bss->tls_session_cache_file);
+			bss->tls_session_cache_file = os_strdup(pos);
+		} else if (os_strcmp(buf, "tls_session_tickets") == 0) {
+			bss->tls_session_tickets = atoi(pos);
+		} else if (os_strcmp(buf,
+				      "tls_session_ticket_key_lifetime") == 0) {
+			int val = atoi(pos);
+			if (val <= 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "tls_session_ticket_key_lifetime %d",
+					   line, val);
+				errors++;
+			} else {
+				bss->tls_session_ticket_key_lifetime = val;
+			}
+		} else if (os_strcmp(buf, "tls_worker_threads") == 0) {
+			int val = atoi(pos);
+			if (val < 0 || val > 64) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "tls_worker_threads %d", line, val);
+				errors++;
+			} else {
+				bss->tls_worker_threads = val;
+			}
 		} else if (os_strcmp(buf, "fragment_size") == 0) {
 			bss->fragment_size = atoi(pos);
 #ifdef EAP_SERVER_FAST
@@ -2046,6 +2075,10 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		} else if (os_strcmp(buf, "eap_sim_db") == 0) {
 			os_free(bss->eap_sim_db);
 			bss->eap_sim_db = os_strdup(pos);
+		} else if (os_strcmp(buf, "eap_sim_db_prefetch") == 0) {
+			bss->eap_sim_db_prefetch = atoi(pos);
+		} else if (os_strcmp(buf, "eap_sim_db_prefetch_imsis") == 0) {
+			bss->eap_sim_db_prefetch_imsis = atoi(pos);
 		} else if (os_strcmp(buf, "eap_sim_aka_result_ind") == 0) {
 			bss->eap_sim_aka_result_ind = atoi(pos);
 #endif /* EAP_SERVER_SIM */
@@ -2231,6 +2264,24 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		} else if (os_strcmp(buf, "radius_das_require_event_timestamp")
 			   == 0) {
 			bss->radius_das_require_event_timestamp = atoi(pos);
+		} else if (os_strcmp(buf, "radius_das_bulk") == 0) {
+			bss->radius_das_bulk = atoi(pos);
+		} else if (os_strcmp(buf, "radius_das_batch_size") == 0) {
+			int val = atoi(pos);
+			if (val <= 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "radius_das_batch_size", line);
+				errors++;
+			} else
+				bss->radius_das_batch_size = val;
+		} else if (os_strcmp(buf, "radius_das_batch_interval") == 0) {
+			int val = atoi(pos);
+			if (val < 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "radius_das_batch_interval", line);
+				errors++;
+			} else
+				bss->radius_das_batch_interval = val;
 #endif /* CONFIG_NO_RADIUS */
 		} else if (os_strcmp(buf, "auth_algs") == 0) {
 			bss->auth_algs = atoi(pos);
@@ -3194,6 +3245,22 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 					   "sae_groups value '%s'", line, pos);
 				return 1;
 			}
+		} else if (os_strcmp(buf, "sae_worker_threads") == 0) {
+			int val = atoi(pos);
+			if (val < 0 || val > 64) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "sae_worker_threads %d", line, val);
+				return 1;
+			}
+			bss->sae_worker_threads = val;
+		} else if (os_strcmp(buf, "sae_queue_len") == 0) {
+			int val = atoi(pos);
+			if (val <= 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "sae_queue_len %d", line, val);
+				return 1;
+			}
+			bss->sae_queue_len = val;
 		} else if (os_strcmp(buf, "local_pwr_constraint") == 0) {
 			int val = atoi(pos);
 			if (val < 0 || val > 255) {
@@ -25,6 +25,7 @@
 #include "radius/radius_server.h"
 #include "ap/hostapd.h"
 #include "ap/ap_config.h"
+#include "ap/authsrv.h"
 #include "ap/ieee802_1x.h"
 #include "ap/wpa_auth.h"
 #include "ap/ieee802_11.h"
@@ -1263,6 +1264,8 @@ static int hostapd_ctrl_iface_mib(struct hostapd_data *hapd, char *reply,
 					     reply_size);
 	}
 #endif /* RADIUS_SERVER */
+	if (os_strcmp(param, "tls_session") == 0)
+		return authsrv_get_tls_session_mib(hapd, reply, reply_size);
 	return -1;
 }
 
@@ -9,9 +9,215 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "common/defs.h"
+#include "common/wpa_common.h"
+#include "crypto/sha1.h"
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+#include "tls/tlsv1_server_session.h"
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
+
+
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+static int tls_session_ticket_tests(void)
+{
+	struct tlsv1_server_sessions *sessions;
+	struct tlsv1_server_session sess, res;
+	u8 *ticket;
+	size_t ticket_len;
+	int renew = 0, ret = -1;
+
+	wpa_printf(MSG_INFO, "TLS session ticket tests");
+
+	sessions = tlsv1_server_sessions_init(3600, 10, 1, 3600, NULL);
+	if (sessions == NULL)
+		return -1;
+
+	os_memset(&sess, 0, sizeof(sess));
+	os_memset(&res, 0, sizeof(res));
+	sess.tls_version = 0x0301;
+	sess.cipher_suite = 0x002f;
+	os_memset(sess.master_secret, 0x11, sizeof(sess.master_secret));
+	sess.success_data = wpabuf_alloc_copy("\x0d\x04user", 6);
+	if (sess.success_data == NULL)
+		goto fail;
+
+	ticket = tlsv1_server_session_ticket_seal(sessions, &sess,
+						  &ticket_len);
+	if (ticket == NULL)
+		goto fail;
+	if (tlsv1_server_session_ticket_open(sessions, ticket, ticket_len,
+					     &res, &renew) < 0 ||
+	    renew || res.tls_version != sess.tls_version ||
+	    res.cipher_suite != sess.cipher_suite ||
+	    os_memcmp(res.master_secret, sess.master_secret,
+		      sizeof(sess.master_secret)) != 0 ||
+	    res.success_data == NULL ||
+	    wpabuf_len(res.success_data) != wpabuf_len(sess.success_data) ||
+	    os_memcmp(wpabuf_head(res.success_data),
+		      wpabuf_head(sess.success_data),
+		      wpabuf_len(sess.success_data)) != 0) {
+		wpa_printf(MSG_ERROR, "TLS session ticket test: valid ticket "
+			   "not accepted");
+		os_free(ticket);
+		goto fail;
+	}
+	tlsv1_server_session_clear(&res);
+
+	/* Modified ticket must be rejected */
+	ticket[ticket_len / 2] ^= 0x01;
+	if (tlsv1_server_session_ticket_open(sessions, ticket, ticket_len,
+					     &res, &renew) == 0) {
+		wpa_printf(MSG_ERROR, "TLS session ticket test: modified "
+			   "ticket accepted");
+		tlsv1_server_session_clear(&res);
+		os_free(ticket);
+		goto fail;
+	}
+	os_free(ticket);
+
+	/* Session ID cache */
+	if (tlsv1_server_session_add(sessions, (const u8 *) "id-1", 4,
+				     &sess) < 0 ||
+	    tlsv1_server_session_get(sessions, (const u8 *) "id-1", 4,
+				     &res) < 0 ||
+	    res.cipher_suite != sess.cipher_suite) {
+		wpa_printf(MSG_ERROR, "TLS session cache test failed");
+		goto fail;
+	}
+	tlsv1_server_session_clear(&res);
+	if (tlsv1_server_session_get(sessions, (const u8 *) "id-2", 4,
+				     &res) == 0) {
+		wpa_printf(MSG_ERROR, "TLS session cache test: unknown "
+			   "session found");
+		tlsv1_server_session_clear(&res);
+		goto fail;
+	}
+
+	ret = 0;
+fail:
+	wpabuf_free(sess.success_data);
+	tlsv1_server_sessions_deinit(sessions);
+	return ret;
+}
+
+
+static int tls_session_file_tests(void)
+{
+	const char *file = "/tmp/hostapd-module-tests-tls-sessions";
+	static const char *ms =
+		"111111111111111111111111111111111111111111111111"
+		"111111111111111111111111111111111111111111111111";
+	struct tlsv1_server_sessions *sessions;
+	struct tlsv1_server_session res;
+	FILE *f;
+	struct os_time now;
+	long expires;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "TLS session cache file tests");
+
+	f = fopen(file, "w");
+	if (f == NULL)
+		return -1;
+	os_get_time(&now);
+	expires = (long) now.sec + 3600;
+	/* Valid entry */
+	fprintf(f, "session=%ld 01020304 301 2f %s -\n", expires, ms);
+	/* Odd-length session ID */
+	fprintf(f, "session=%ld 0506070 301 2f %s -\n", expires, ms);
+	/* Odd-length success data */
+	fprintf(f, "session=%ld 08090a0b 301 2f %s 0d0475736572f\n",
+		expires, ms);
+	fclose(f);
+
+	sessions = tlsv1_server_sessions_init(3600, 10, 0, 3600, file);
+	if (sessions == NULL)
+		goto out;
+
+	os_memset(&res, 0, sizeof(res));
+	if (tlsv1_server_session_get(sessions, (const u8 *) "\x01\x02\x03\x04",
+				     4, &res) < 0) {
+		wpa_printf(MSG_ERROR, "TLS session cache file test: valid "
+			   "entry not loaded");
+		goto fail;
+	}
+	tlsv1_server_session_clear(&res);
+	if (tlsv1_server_session_get(sessions, (const u8 *) "\x05\x06\x07",
+				     3, &res) == 0 ||
+	    tlsv1_server_session_get(sessions, (const u8 *) "\x08\x09\x0a\x0b",
+				     4, &res) == 0) {
+		wpa_printf(MSG_ERROR, "TLS session cache file test: "
+			   "odd-length hex field accepted");
+		tlsv1_server_session_clear(&res);
+		goto fail;
+	}
+
+	ret = 0;
+fail:
+	tlsv1_server_sessions_deinit(sessions);
+out:
+	unlink(file);
+	return ret;
+}
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
+
+
+static int wpa_kck_multi_tests(void)
+{
+	u8 pmk_buf[11][PMK_LEN], kck_buf[11][SHA1_MAC_LEN];
+	const u8 *pmk[11];
+	u8 *kck[11];
+	struct wpa_ptk ptk;
+	u8 aa[ETH_ALEN], spa[ETH_ALEN], anonce[WPA_NONCE_LEN];
+	u8 snonce[WPA_NONCE_LEN];
+	size_t i;
+
+	wpa_printf(MSG_INFO, "WPA KCK derivation for multiple PMKs tests");
+
+	os_memset(aa, 0x02, ETH_ALEN);
+	os_memset(spa, 0x04, ETH_ALEN);
+	os_memset(anonce, 0x11, WPA_NONCE_LEN);
+	os_memset(snonce, 0x22, WPA_NONCE_LEN);
+	for (i = 0; i < ARRAY_SIZE(pmk_buf); i++) {
+		os_memset(pmk_buf[i], i, PMK_LEN);
+		pmk[i] = pmk_buf[i];
+		kck[i] = kck_buf[i];
+	}
+
+	if (wpa_pmk_to_kck_multi(pmk, PMK_LEN, ARRAY_SIZE(pmk_buf),
+				 "Pairwise key expansion", aa, spa, anonce,
+				 snonce, kck) < 0)
+		return -1;
+
+	for (i = 0; i < ARRAY_SIZE(pmk_buf); i++) {
+		wpa_pmk_to_ptk(pmk[i], PMK_LEN, "Pairwise key expansion",
+			       aa, spa, anonce, snonce, (u8 *) &ptk, 48, 0);
+		if (os_memcmp(kck[i], ptk.kck, sizeof(ptk.kck)) != 0) {
+			wpa_printf(MSG_ERROR, "WPA KCK multi test: mismatch "
+				   "for PMK %u", (unsigned int) i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 
 int hapd_module_tests(void)
 {
+	int ret = 0;
+
 	wpa_printf(MSG_INFO, "hostapd module tests");
-	return 0;
+
+	if (wpa_kck_multi_tests() < 0)
+		ret = -1;
+
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	if (tls_session_ticket_tests() < 0)
+		ret = -1;
+	if (tls_session_file_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
+
+	return ret;
 }
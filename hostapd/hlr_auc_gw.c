@@ -27,6 +27,11 @@
  * AKA-RESP-AUTH <IMSI> <RAND> <AUTN> <IK> <CK> <RES>
  * AKA-RESP-AUTH <IMSI> FAILURE
  *
+ * EAP-AKA / UMTS query/response for multiple authentication vectors:
+ * AKA-REQ-AUTH-BULK <IMSI> <count>
+ * AKA-RESP-AUTH-BULK <IMSI> RAND1:AUTN1:IK1:CK1:RES1 [RAND2:AUTN2:IK2:CK2:RES2]
+ * AKA-RESP-AUTH-BULK <IMSI> FAILURE
+ *
  * EAP-AKA / UMTS AUTS (re-synchronization):
  * AKA-AUTS <IMSI> <AUTS> <RAND>
  *
@@ -46,6 +51,11 @@
  * SQN generation follows the not time-based Profile 2 described in
  * 3GPP TS 33.102 Annex C.3.2. The length of IND is 5 bits by default, but this
  * can be changed with a command line options if needed.
+ *
+ * Subscribers are indexed by IMSI in hash tables. Entries fetched from the
+ * SQLite database are cached in memory and SQN updates are written back to the
+ * database in batches (at most once per second or after SQN_FLUSH_MAX changes)
+ * instead of one transaction per request.
  */
 
 #include "includes.h"
@@ -55,12 +65,16 @@
 #endif /* CONFIG_SQLITE */
 
 #include "common.h"
+#include "eloop.h"
 #include "crypto/milenage.h"
 #include "crypto/random.h"
 
+#define MAX_SOCKETS 8
+
 static const char *default_socket_path = "/tmp/hlr_auc_gw.sock";
-static const char *socket_path;
-static int serv_sock = -1;
+static const char *socket_paths[MAX_SOCKETS];
+static int serv_socks[MAX_SOCKETS];
+static int num_sockets = 0;
 static char *milenage_file = NULL;
 static int update_milenage = 0;
 static int sqn_changes = 0;
@@ -70,28 +84,46 @@ static int stdout_debug = 1;
 /* GSM triplets */
 struct gsm_triplet {
 	struct gsm_triplet *next;
+	struct gsm_triplet *imsi_next; /* circular list for the same IMSI */
 	char imsi[20];
 	u8 kc[8];
 	u8 sres[4];
 	u8 _rand[16];
 };
 
-static struct gsm_triplet *gsm_db = NULL, *gsm_db_pos = NULL;
+static struct gsm_triplet *gsm_db = NULL;
+
+/* Index entry for the GSM triplets of an IMSI */
+struct gsm_imsi {
+	struct gsm_imsi *next; /* hash table bucket */
+	struct gsm_triplet *pos; /* next triplet to use */
+	struct gsm_triplet *last;
+};
+
+static struct gsm_imsi **gsm_index = NULL;
+static unsigned int gsm_index_size = 0;
 
 /* OPc and AMF parameters for Milenage (Example algorithms for AKA). */
 struct milenage_parameters {
 	struct milenage_parameters *next;
+	struct milenage_parameters *hnext; /* hash table bucket */
+	struct milenage_parameters *dirty_next; /* SQN not yet in database */
 	char imsi[20];
 	u8 ki[16];
 	u8 opc[16];
 	u8 amf[2];
 	u8 sqn[6];
 	int set;
+	int db_dirty;
 };
 
 static struct milenage_parameters *milenage_db = NULL;
+static struct milenage_parameters **milenage_index = NULL;
+static unsigned int milenage_index_size = 0;
+static unsigned int milenage_index_count = 0;
 
 #define EAP_SIM_MAX_CHAL 3
+#define EAP_AKA_MAX_BULK 32
 
 #define EAP_AKA_RAND_LEN 16
 #define EAP_AKA_AUTN_LEN 16
@@ -101,10 +133,125 @@ static struct milenage_parameters *milenage_db = NULL;
 #define EAP_AKA_CK_LEN 16
 
 
+static unsigned int imsi_hash(const char *imsi, unsigned int size)
+{
+	unsigned int hash = 0;
+
+	while (*imsi)
+		hash = hash * 31 + (u8) *imsi++;
+	return hash & (size - 1);
+}
+
+
+static int milenage_index_add(struct milenage_parameters *m)
+{
+	unsigned int hash;
+
+	if (milenage_index_count >= milenage_index_size) {
+		struct milenage_parameters **index, *e, *next;
+		unsigned int i, size;
+
+		size = milenage_index_size ? milenage_index_size * 2 : 256;
+		index = os_calloc(size, sizeof(*index));
+		if (index == NULL)
+			return -1;
+		for (i = 0; i < milenage_index_size; i++) {
+			for (e = milenage_index[i]; e; e = next) {
+				next = e->hnext;
+				hash = imsi_hash(e->imsi, size);
+				e->hnext = index[hash];
+				index[hash] = e;
+			}
+		}
+		os_free(milenage_index);
+		milenage_index = index;
+		milenage_index_size = size;
+	}
+
+	hash = imsi_hash(m->imsi, milenage_index_size);
+	m->hnext = milenage_index[hash];
+	milenage_index[hash] = m;
+	milenage_index_count++;
+	return 0;
+}
+
+
+static struct milenage_parameters * milenage_index_get(const char *imsi)
+{
+	struct milenage_parameters *m;
+
+	if (milenage_index == NULL)
+		return NULL;
+	for (m = milenage_index[imsi_hash(imsi, milenage_index_size)]; m;
+	     m = m->hnext) {
+		if (os_strcmp(m->imsi, imsi) == 0)
+			return m;
+	}
+	return NULL;
+}
+
+
+static struct gsm_imsi * gsm_index_get(const char *imsi)
+{
+	struct gsm_imsi *i;
+
+	if (gsm_index == NULL)
+		return NULL;
+	for (i = gsm_index[imsi_hash(imsi, gsm_index_size)]; i; i = i->next) {
+		if (os_strcmp(i->pos->imsi, imsi) == 0)
+			return i;
+	}
+	return NULL;
+}
+
+
+static int gsm_index_build(void)
+{
+	struct gsm_triplet *g;
+	struct gsm_imsi *i;
+	unsigned int count = 0, hash;
+
+	for (g = gsm_db; g; g = g->next)
+		count++;
+	gsm_index_size = 256;
+	while (gsm_index_size < count)
+		gsm_index_size *= 2;
+	gsm_index = os_calloc(gsm_index_size, sizeof(*gsm_index));
+	if (gsm_index == NULL)
+		return -1;
+
+	for (g = gsm_db; g; g = g->next) {
+		i = gsm_index_get(g->imsi);
+		if (i) {
+			g->imsi_next = i->pos;
+			i->last->imsi_next = g;
+			i->last = g;
+			continue;
+		}
+
+		i = os_zalloc(sizeof(*i));
+		if (i == NULL)
+			return -1;
+		g->imsi_next = g;
+		i->pos = g;
+		i->last = g;
+		hash = imsi_hash(g->imsi, gsm_index_size);
+		i->next = gsm_index[hash];
+		gsm_index[hash] = i;
+	}
+
+	return 0;
+}
+
+
 #ifdef CONFIG_SQLITE
 
+#define SQN_FLUSH_MAX 100
+
 static sqlite3 *sqlite_db = NULL;
 static struct milenage_parameters db_tmp_milenage;
+static struct milenage_parameters *db_dirty = NULL;
+static unsigned int db_num_dirty = 0;
 
 
 static int db_table_exists(sqlite3 *db, const char *name)
@@ -200,6 +347,10 @@ static struct milenage_parameters * db_get_milenage(const char *imsi_txt)
 {
 	char cmd[128];
 	unsigned long long imsi;
+	struct milenage_parameters *m;
+
+	if (sqlite_db == NULL)
+		return NULL;
 
 	os_memset(&db_tmp_milenage, 0, sizeof(db_tmp_milenage));
 	imsi = atoll(imsi_txt);
@@ -214,7 +365,20 @@ static struct milenage_parameters * db_get_milenage(const char *imsi_txt)
 
 	if (!db_tmp_milenage.set)
 		return NULL;
-	return &db_tmp_milenage;
+
+	/* Cache the entry to avoid a query for each request */
+	m = os_malloc(sizeof(*m));
+	if (m == NULL)
+		return &db_tmp_milenage;
+	os_memcpy(m, &db_tmp_milenage, sizeof(*m));
+	os_strlcpy(m->imsi, imsi_txt, sizeof(m->imsi));
+	if (milenage_index_add(m) < 0) {
+		os_free(m);
+		return &db_tmp_milenage;
+	}
+	m->next = milenage_db;
+	milenage_db = m;
+	return m;
 }
 
 
@@ -239,6 +403,59 @@ static int db_update_milenage_sqn(struct milenage_parameters *m)
 	return 0;
 }
 
+
+static void db_flush_sqn(void)
+{
+	struct milenage_parameters *m;
+
+	if (sqlite_db == NULL || db_dirty == NULL)
+		return;
+
+	sqlite3_exec(sqlite_db, "BEGIN;", NULL, NULL, NULL);
+	while ((m = db_dirty)) {
+		db_dirty = m->dirty_next;
+		m->dirty_next = NULL;
+		m->db_dirty = 0;
+		db_update_milenage_sqn(m);
+	}
+	if (sqlite3_exec(sqlite_db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK)
+		printf("Failed to commit SQN updates to database\n");
+	db_num_dirty = 0;
+}
+
+
+static void db_flush_sqn_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	db_flush_sqn();
+}
+
+
+static void db_sqn_changed(struct milenage_parameters *m)
+{
+	if (sqlite_db == NULL)
+		return;
+
+	if (m == &db_tmp_milenage) {
+		/* Not cached */
+		db_update_milenage_sqn(m);
+		return;
+	}
+
+	if (!m->db_dirty) {
+		m->db_dirty = 1;
+		m->dirty_next = db_dirty;
+		db_dirty = m;
+		if (db_num_dirty++ == 0)
+			eloop_register_timeout(1, 0, db_flush_sqn_timeout,
+					       NULL, NULL);
+	}
+
+	if (db_num_dirty >= SQN_FLUSH_MAX) {
+		eloop_cancel_timeout(db_flush_sqn_timeout, NULL, NULL);
+		db_flush_sqn();
+	}
+}
+
 #endif /* CONFIG_SQLITE */
 
 
@@ -375,32 +592,24 @@ static int read_gsm_triplets(const char *fname)
 
 	fclose(f);
 
+	if (ret == 0 && gsm_index_build() < 0)
+		ret = -1;
+
 	return ret;
 }
 
 
 static struct gsm_triplet * get_gsm_triplet(const char *imsi)
 {
-	struct gsm_triplet *g = gsm_db_pos;
-
-	while (g) {
-		if (strcmp(g->imsi, imsi) == 0) {
-			gsm_db_pos = g->next;
-			return g;
-		}
-		g = g->next;
-	}
-
-	g = gsm_db;
-	while (g && g != gsm_db_pos) {
-		if (strcmp(g->imsi, imsi) == 0) {
-			gsm_db_pos = g->next;
-			return g;
-		}
-		g = g->next;
-	}
+	struct gsm_imsi *i;
+	struct gsm_triplet *g;
 
-	return NULL;
+	i = gsm_index_get(imsi);
+	if (i == NULL)
+		return NULL;
+	g = i->pos;
+	i->pos = g->imsi_next;
+	return g;
 }
 
 
@@ -517,6 +726,10 @@ static int read_milenage(const char *fname)
 		}
 		pos = pos2 + 1;
 
+		if (milenage_index_add(m) < 0) {
+			ret = -1;
+			break;
+		}
 		m->next = milenage_db;
 		milenage_db = m;
 		m = NULL;
@@ -535,6 +748,7 @@ static void update_milenage_file(const char *fname)
 	char buf[500], *pos;
 	char *end = buf + sizeof(buf);
 	struct milenage_parameters *m;
+	char imsi[20];
 	size_t imsi_len;
 
 	f = fopen(fname, "r");
@@ -560,13 +774,10 @@ static void update_milenage_file(const char *fname)
 			goto no_update;
 
 		imsi_len = pos - buf;
+		os_memcpy(imsi, buf, imsi_len);
+		imsi[imsi_len] = '\0';
 
-		for (m = milenage_db; m; m = m->next) {
-			if (strncmp(buf, m->imsi, imsi_len) == 0 &&
-			    m->imsi[imsi_len] == '\0')
-				break;
-		}
-
+		m = milenage_index_get(imsi);
 		if (!m)
 			goto no_update;
 
@@ -605,13 +816,9 @@ static void update_milenage_file(const char *fname)
 
 static struct milenage_parameters * get_milenage(const char *imsi)
 {
-	struct milenage_parameters *m = milenage_db;
+	struct milenage_parameters *m;
 
-	while (m) {
-		if (strcmp(m->imsi, imsi) == 0)
-			break;
-		m = m->next;
-	}
+	m = milenage_index_get(imsi);
 
 #ifdef CONFIG_SQLITE
 	if (!m)
@@ -767,6 +974,28 @@ static void inc_sqn(u8 *sqn)
 }
 
 
+static int aka_generate(struct milenage_parameters *m, u8 *_rand, u8 *autn,
+			u8 *ik, u8 *ck, u8 *res, size_t *res_len)
+{
+	if (random_get_bytes(_rand, EAP_AKA_RAND_LEN) < 0)
+		return -1;
+	*res_len = EAP_AKA_RES_MAX_LEN;
+	inc_sqn(m->sqn);
+#ifdef CONFIG_SQLITE
+	db_sqn_changed(m);
+#endif /* CONFIG_SQLITE */
+	sqn_changes = 1;
+	if (stdout_debug) {
+		printf("AKA: Milenage with SQN=%02x%02x%02x%02x%02x%02x\n",
+		       m->sqn[0], m->sqn[1], m->sqn[2],
+		       m->sqn[3], m->sqn[4], m->sqn[5]);
+	}
+	milenage_generate(m->opc, m->amf, m->ki, m->sqn, _rand,
+			  autn, ik, ck, res, res_len);
+	return 0;
+}
+
+
 static int aka_req_auth(char *imsi, char *resp, size_t resp_len)
 {
 	/* AKA-RESP-AUTH <IMSI> <RAND> <AUTN> <IK> <CK> <RES> */
@@ -783,21 +1012,8 @@ static int aka_req_auth(char *imsi, char *resp, size_t resp_len)
 
 	m = get_milenage(imsi);
 	if (m) {
-		if (random_get_bytes(_rand, EAP_AKA_RAND_LEN) < 0)
+		if (aka_generate(m, _rand, autn, ik, ck, res, &res_len) < 0)
 			return -1;
-		res_len = EAP_AKA_RES_MAX_LEN;
-		inc_sqn(m->sqn);
-#ifdef CONFIG_SQLITE
-		db_update_milenage_sqn(m);
-#endif /* CONFIG_SQLITE */
-		sqn_changes = 1;
-		if (stdout_debug) {
-			printf("AKA: Milenage with SQN=%02x%02x%02x%02x%02x%02x\n",
-			       m->sqn[0], m->sqn[1], m->sqn[2],
-			       m->sqn[3], m->sqn[4], m->sqn[5]);
-		}
-		milenage_generate(m->opc, m->amf, m->ki, m->sqn, _rand,
-				  autn, ik, ck, res, &res_len);
 	} else {
 		printf("Unknown IMSI: %s\n", imsi);
 #ifdef AKA_USE_FIXED_TEST_VALUES
@@ -840,6 +1056,73 @@ static int aka_req_auth(char *imsi, char *resp, size_t resp_len)
 }
 
 
+static int aka_req_auth_bulk(char *imsi, char *resp, size_t resp_len)
+{
+	/* AKA-RESP-AUTH-BULK <IMSI> RAND:AUTN:IK:CK:RES ... */
+	char *pos, *end, *count_pos;
+	u8 _rand[EAP_AKA_RAND_LEN];
+	u8 autn[EAP_AKA_AUTN_LEN];
+	u8 ik[EAP_AKA_IK_LEN];
+	u8 ck[EAP_AKA_CK_LEN];
+	u8 res[EAP_AKA_RES_MAX_LEN];
+	size_t res_len;
+	int ret, i, count = 1;
+	struct milenage_parameters *m;
+
+	resp[0] = '\0';
+
+	count_pos = os_strchr(imsi, ' ');
+	if (count_pos) {
+		*count_pos++ = '\0';
+		count = atoi(count_pos);
+		if (count < 1)
+			count = 1;
+		if (count > EAP_AKA_MAX_BULK)
+			count = EAP_AKA_MAX_BULK;
+	}
+
+	pos = resp;
+	end = resp + resp_len;
+	ret = os_snprintf(pos, end - pos, "AKA-RESP-AUTH-BULK %s", imsi);
+	if (ret < 0 || ret >= end - pos)
+		return -1;
+	pos += ret;
+
+	m = get_milenage(imsi);
+	if (m == NULL) {
+		printf("Unknown IMSI: %s\n", imsi);
+		ret = os_snprintf(pos, end - pos, " FAILURE");
+		if (ret < 0 || ret >= end - pos)
+			return -1;
+		return 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		/* ' ' + 4 * ':' + hex values + '\0' */
+		if (end - pos < 6 + 2 * (EAP_AKA_RAND_LEN + EAP_AKA_AUTN_LEN +
+					 EAP_AKA_IK_LEN + EAP_AKA_CK_LEN +
+					 EAP_AKA_RES_MAX_LEN))
+			break;
+		if (aka_generate(m, _rand, autn, ik, ck, res, &res_len) < 0)
+			return -1;
+		*pos++ = ' ';
+		pos += wpa_snprintf_hex(pos, end - pos, _rand,
+					EAP_AKA_RAND_LEN);
+		*pos++ = ':';
+		pos += wpa_snprintf_hex(pos, end - pos, autn,
+					EAP_AKA_AUTN_LEN);
+		*pos++ = ':';
+		pos += wpa_snprintf_hex(pos, end - pos, ik, EAP_AKA_IK_LEN);
+		*pos++ = ':';
+		pos += wpa_snprintf_hex(pos, end - pos, ck, EAP_AKA_CK_LEN);
+		*pos++ = ':';
+		pos += wpa_snprintf_hex(pos, end - pos, res, res_len);
+	}
+
+	return 0;
+}
+
+
 static int aka_auts(char *imsi, char *resp, size_t resp_len)
 {
 	char *auts, *__rand;
@@ -886,7 +1169,7 @@ static int aka_auts(char *imsi, char *resp, size_t resp_len)
 			       sqn[0], sqn[1], sqn[2], sqn[3], sqn[4], sqn[5]);
 		}
 #ifdef CONFIG_SQLITE
-		db_update_milenage_sqn(m);
+		db_sqn_changed(m);
 #endif /* CONFIG_SQLITE */
 		sqn_changes = 1;
 	}
@@ -906,6 +1189,9 @@ static int process_cmd(char *cmd, char *resp, size_t resp_len)
 	if (os_strncmp(cmd, "AKA-REQ-AUTH ", 13) == 0)
 		return aka_req_auth(cmd + 13, resp, resp_len);
 
+	if (os_strncmp(cmd, "AKA-REQ-AUTH-BULK ", 18) == 0)
+		return aka_req_auth_bulk(cmd + 18, resp, resp_len);
+
 	if (os_strncmp(cmd, "AKA-AUTS ", 9) == 0)
 		return aka_auts(cmd + 9, resp, resp_len);
 
@@ -914,9 +1200,9 @@ static int process_cmd(char *cmd, char *resp, size_t resp_len)
 }
 
 
-static int process(int s)
+static void process(int s, void *eloop_ctx, void *sock_ctx)
 {
-	char buf[1000], resp[1000];
+	char buf[1000], resp[8192];
 	struct sockaddr_un from;
 	socklen_t fromlen;
 	ssize_t res;
@@ -926,11 +1212,11 @@ static int process(int s)
 		       &fromlen);
 	if (res < 0) {
 		perror("recvfrom");
-		return -1;
+		return;
 	}
 
 	if (res == 0)
-		return 0;
+		return;
 
 	if ((size_t) res >= sizeof(buf))
 		res = sizeof(buf) - 1;
@@ -940,12 +1226,12 @@ static int process(int s)
 
 	if (process_cmd(buf, resp, sizeof(resp)) < 0) {
 		printf("Failed to process request\n");
-		return -1;
+		return;
 	}
 
 	if (resp[0] == '\0') {
 		printf("No response\n");
-		return 0;
+		return;
 	}
 
 	printf("Send: %s\n", resp);
@@ -953,8 +1239,6 @@ static int process(int s)
 	if (sendto(s, resp, os_strlen(resp), 0, (struct sockaddr *) &from,
 		   fromlen) < 0)
 		perror("send");
-
-	return 0;
 }
 
 
@@ -962,10 +1246,33 @@ static void cleanup(void)
 {
 	struct gsm_triplet *g, *gprev;
 	struct milenage_parameters *m, *prev;
+	struct gsm_imsi *i, *iprev;
+	unsigned int idx;
+	int s;
+
+#ifdef CONFIG_SQLITE
+	db_flush_sqn();
+#endif /* CONFIG_SQLITE */
 
 	if (update_milenage && milenage_file && sqn_changes)
 		update_milenage_file(milenage_file);
 
+	for (idx = 0; idx < gsm_index_size; idx++) {
+		i = gsm_index[idx];
+		while (i) {
+			iprev = i;
+			i = i->next;
+			os_free(iprev);
+		}
+	}
+	os_free(gsm_index);
+	gsm_index = NULL;
+	gsm_index_size = 0;
+	os_free(milenage_index);
+	milenage_index = NULL;
+	milenage_index_size = 0;
+	milenage_index_count = 0;
+
 	g = gsm_db;
 	while (g) {
 		gprev = g;
@@ -980,10 +1287,14 @@ static void cleanup(void)
 		os_free(prev);
 	}
 
-	if (serv_sock >= 0)
-		close(serv_sock);
-	if (socket_path)
-		unlink(socket_path);
+	for (s = 0; s < num_sockets; s++) {
+		if (serv_socks[s] < 0)
+			continue;
+		eloop_unregister_read_sock(serv_socks[s]);
+		close(serv_socks[s]);
+		unlink(socket_paths[s]);
+	}
+	num_sockets = 0;
 
 #ifdef CONFIG_SQLITE
 	if (sqlite_db) {
@@ -994,10 +1305,10 @@ static void cleanup(void)
 }
 
 
-static void handle_term(int sig)
+static void handle_term(int sig, void *signal_ctx)
 {
 	printf("Signal %d - terminate\n", sig);
-	exit(0);
+	eloop_terminate();
 }
 
 
@@ -1015,7 +1326,9 @@ static void usage(void)
 	       "options:\n"
 	       "  -h = show this usage help\n"
 	       "  -u = update SQN in Milenage file on exit\n"
-	       "  -s<socket path> = path for UNIX domain socket\n"
+	       "  -s<socket path> = path for UNIX domain socket; can be used "
+	       "multiple times\n"
+	       "                    to serve clients on up to %d sockets\n"
 	       "                    (default: %s)\n"
 	       "  -g<triplet file> = path for GSM authentication triplets\n"
 	       "  -m<milenage file> = path for Milenage keys\n"
@@ -1029,21 +1342,23 @@ static void usage(void)
 	       "a control interface and processes commands sent through it "
 	       "(e.g., by EAP server\n"
 	       "in hostapd).\n",
-	       default_socket_path);
+	       MAX_SOCKETS, default_socket_path);
 }
 
 
 int main(int argc, char *argv[])
 {
-	int c;
+	int c, i;
 	char *gsm_triplet_file = NULL;
 	char *sqlite_db_file = NULL;
 	int ret = 0;
 
 	if (os_program_init())
 		return -1;
-
-	socket_path = default_socket_path;
+	if (eloop_init()) {
+		os_program_deinit();
+		return -1;
+	}
 
 	for (;;) {
 		c = getopt(argc, argv, "D:g:hi:m:s:u");
@@ -1075,7 +1390,11 @@ int main(int argc, char *argv[])
 			milenage_file = optarg;
 			break;
 		case 's':
-			socket_path = optarg;
+			if (num_sockets == MAX_SOCKETS) {
+				printf("Too many sockets\n");
+				return -1;
+			}
+			socket_paths[num_sockets++] = optarg;
 			break;
 		case 'u':
 			update_milenage = 1;
@@ -1103,21 +1422,28 @@ int main(int argc, char *argv[])
 		return -1;
 
 	if (optind == argc) {
-		serv_sock = open_socket(socket_path);
-		if (serv_sock < 0)
-			return -1;
-
-		printf("Listening for requests on %s\n", socket_path);
-
-		atexit(cleanup);
-		signal(SIGTERM, handle_term);
-		signal(SIGINT, handle_term);
+		if (num_sockets == 0)
+			socket_paths[num_sockets++] = default_socket_path;
+		for (i = 0; i < num_sockets; i++)
+			serv_socks[i] = -1;
+		for (i = 0; i < num_sockets; i++) {
+			serv_socks[i] = open_socket(socket_paths[i]);
+			if (serv_socks[i] < 0 ||
+			    eloop_register_read_sock(serv_socks[i], process,
+						     NULL, NULL) < 0) {
+				cleanup();
+				return -1;
+			}
+			printf("Listening for requests on %s\n",
+			       socket_paths[i]);
+		}
 
-		for (;;)
-			process(serv_sock);
+		eloop_register_signal_terminate(handle_term, NULL);
+		eloop_run();
+		cleanup();
 	} else {
-		char buf[1000];
-		socket_path = NULL;
+		char buf[8192];
+		num_sockets = 0;
 		stdout_debug = 0;
 		if (process_cmd(argv[optind], buf, sizeof(buf)) < 0) {
 			printf("FAIL\n");
@@ -1135,6 +1461,7 @@ int main(int argc, char *argv[])
 	}
 #endif /* CONFIG_SQLITE */
 
+	eloop_destroy();
 	os_program_deinit();
 
 	return ret;
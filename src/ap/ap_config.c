@@ -91,8 +91,16 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 #endif /* CONFIG_IEEE80211R */
 
 	bss->radius_das_time_window = 300;
+	bss->radius_das_batch_size = 32;
+	bss->radius_das_batch_interval = 100;
+
+	bss->eap_sim_db_prefetch_imsis = 1000;
+
+	bss->tls_session_cache_size = 1000;
+	bss->tls_session_ticket_key_lifetime = 3600;
 
 	bss->sae_anti_clogging_threshold = 5;
+	bss->sae_queue_len = 32;
 }
 
 
@@ -204,6 +212,32 @@ int hostapd_mac_comp_empty(const void *a)
 }
 
 
+/*
+ * Passphrases from the PSK file are collected and derived in batches so that
+ * pbkdf2_sha1_batch() can process them in parallel.
+ */
+#define WPA_PSK_FILE_BATCH 8
+
+struct hostapd_wpa_psk_batch {
+	char passphrase[WPA_PSK_FILE_BATCH][64];
+	const char *pass[WPA_PSK_FILE_BATCH];
+	u8 *psk[WPA_PSK_FILE_BATCH];
+	size_t num;
+};
+
+
+static void hostapd_wpa_psk_batch_flush(struct hostapd_wpa_psk_batch *batch,
+					struct hostapd_ssid *ssid)
+{
+	if (batch->num) {
+		pbkdf2_sha1_batch(batch->pass, ssid->ssid, ssid->ssid_len,
+				  4096, batch->psk, PMK_LEN, batch->num);
+		os_memset(batch->passphrase, 0, sizeof(batch->passphrase));
+		batch->num = 0;
+	}
+}
+
+
 static int hostapd_config_read_wpa_psk(const char *fname,
 				       struct hostapd_ssid *ssid)
 {
@@ -212,6 +246,7 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 	int line = 0, ret = 0, len, ok;
 	u8 addr[ETH_ALEN];
 	struct hostapd_wpa_psk *psk;
+	struct hostapd_wpa_psk_batch batch;
 
 	if (!fname)
 		return 0;
@@ -222,6 +257,7 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		return -1;
 	}
 
+	batch.num = 0;
 	while (fgets(buf, sizeof(buf), f)) {
 		line++;
 
@@ -271,8 +307,10 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		if (len == 64 && hexstr2bin(pos, psk->psk, PMK_LEN) == 0)
 			ok = 1;
 		else if (len >= 8 && len < 64) {
-			pbkdf2_sha1(pos, ssid->ssid, ssid->ssid_len,
-				    4096, psk->psk, PMK_LEN);
+			os_memcpy(batch.passphrase[batch.num], pos, len + 1);
+			batch.pass[batch.num] = batch.passphrase[batch.num];
+			batch.psk[batch.num] = psk->psk;
+			batch.num++;
 			ok = 1;
 		}
 		if (!ok) {
@@ -285,8 +323,12 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 
 		psk->next = ssid->wpa_psk;
 		ssid->wpa_psk = psk;
+
+		if (batch.num == WPA_PSK_FILE_BATCH)
+			hostapd_wpa_psk_batch_flush(&batch, ssid);
 	}
 
+	hostapd_wpa_psk_batch_flush(&batch, ssid);
 	fclose(f);
 
 	return ret;
@@ -460,6 +502,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	os_free(conf->private_key_passwd);
 	os_free(conf->ocsp_stapling_response);
 	os_free(conf->dh_file);
+	os_free(conf->tls_session_cache_file);
 	os_free(conf->pac_opaque_encr_key);
 	os_free(conf->eap_fast_a_id);
 	os_free(conf->eap_fast_a_id_info);
@@ -699,6 +742,8 @@ static int hostapd_config_check_bss(struct hostapd_bss_config *bss,
 				    struct hostapd_config *conf,
 				    int full_config)
 {
+	size_t i;
+
 	if (full_config && bss->ieee802_1x && !bss->eap_server &&
 	    !bss->radius->auth_servers) {
 		wpa_printf(MSG_ERROR, "Invalid IEEE 802.1X configuration (no "
@@ -706,6 +751,18 @@ static int hostapd_config_check_bss(struct hostapd_bss_config *bss,
 		return -1;
 	}
 
+	for (i = 0; bss->tls_session_cache_file && i < conf->num_bss &&
+		     conf->bss[i] != bss; i++) {
+		if (conf->bss[i]->tls_session_cache_file &&
+		    os_strcmp(conf->bss[i]->tls_session_cache_file,
+			      bss->tls_session_cache_file) == 0) {
+			wpa_printf(MSG_ERROR, "tls_session_cache_file '%s' is "
+				   "used by more than one BSS",
+				   bss->tls_session_cache_file);
+			return -1;
+		}
+	}
+
 	if (bss->wpa) {
 		int wep, i;
 
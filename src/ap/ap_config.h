@@ -203,6 +203,8 @@ struct hostapd_bss_config {
 	struct hostapd_eap_user *eap_user;
 	char *eap_user_sqlite;
 	char *eap_sim_db;
+	unsigned int eap_sim_db_prefetch;
+	unsigned int eap_sim_db_prefetch_imsis;
 	struct hostapd_ip_addr own_ip_addr;
 	char *nas_identifier;
 	struct hostapd_radius_servers *radius;
@@ -216,6 +218,9 @@ struct hostapd_bss_config {
 	struct hostapd_ip_addr radius_das_client_addr;
 	u8 *radius_das_shared_secret;
 	size_t radius_das_shared_secret_len;
+	int radius_das_bulk;
+	unsigned int radius_das_batch_size;
+	unsigned int radius_das_batch_interval; /* in milliseconds */
 
 	struct hostapd_ssid ssid;
 
@@ -300,6 +305,12 @@ struct hostapd_bss_config {
 	int check_crl;
 	char *ocsp_stapling_response;
 	char *dh_file;
+	unsigned int tls_session_lifetime;
+	unsigned int tls_session_cache_size;
+	char *tls_session_cache_file;
+	int tls_session_tickets;
+	unsigned int tls_session_ticket_key_lifetime;
+	unsigned int tls_worker_threads;
 	u8 *pac_opaque_encr_key;
 	u8 *eap_fast_a_id;
 	size_t eap_fast_a_id_len;
@@ -505,6 +516,8 @@ struct hostapd_bss_config {
 
 	unsigned int sae_anti_clogging_threshold;
 	int *sae_groups;
+	unsigned int sae_worker_threads;
+	unsigned int sae_queue_len;
 
 #ifdef CONFIG_TESTING_OPTIONS
 	u8 bss_load_test[5];
@@ -12,6 +12,7 @@
 #include "crypto/tls.h"
 #include "eap_server/eap.h"
 #include "eap_server/eap_sim_db.h"
+#include "eap_server/eap_tls_workers.h"
 #include "eapol_auth/eapol_auth_sm.h"
 #include "radius/radius_server.h"
 #include "hostapd.h"
@@ -25,9 +26,9 @@
 #endif /* EAP_SERVER_SIM || EAP_SERVER_AKA */
 
 
-#ifdef EAP_SIM_DB
-static int hostapd_sim_db_cb_sta(struct hostapd_data *hapd,
-				 struct sta_info *sta, void *ctx)
+#if defined(EAP_SIM_DB) || defined(CONFIG_TLS_WORKERS)
+static int hostapd_eap_pending_cb_sta(struct hostapd_data *hapd,
+				      struct sta_info *sta, void *ctx)
 {
 	if (eapol_auth_eap_pending_cb(sta->eapol_sm, ctx) == 0)
 		return 1;
@@ -35,16 +36,43 @@ static int hostapd_sim_db_cb_sta(struct hostapd_data *hapd,
 }
 
 
-static void hostapd_sim_db_cb(void *ctx, void *session_ctx)
+static void hostapd_eap_pending_cb(void *ctx, void *session_ctx)
 {
 	struct hostapd_data *hapd = ctx;
-	if (ap_for_each_sta(hapd, hostapd_sim_db_cb_sta, session_ctx) == 0) {
+	if (ap_for_each_sta(hapd, hostapd_eap_pending_cb_sta, session_ctx) ==
+	    0) {
 #ifdef RADIUS_SERVER
 		radius_server_eap_pending_cb(hapd->radius_srv, session_ctx);
 #endif /* RADIUS_SERVER */
 	}
 }
-#endif /* EAP_SIM_DB */
+#endif /* EAP_SIM_DB || CONFIG_TLS_WORKERS */
+
+
+#ifdef EAP_TLS_FUNCS
+static int authsrv_init_tls_workers(struct hostapd_data *hapd)
+{
+#ifdef CONFIG_TLS_WORKERS
+	if (!(tls_capabilities(hapd->ssl_ctx) & TLS_CAPABILITY_THREADS)) {
+		wpa_printf(MSG_INFO, "TLS library does not support concurrent "
+			   "connections - ignore tls_worker_threads");
+		return 0;
+	}
+
+	hapd->tls_workers =
+		eap_tls_workers_init(hapd->conf->tls_worker_threads,
+				     hostapd_eap_pending_cb, hapd);
+	if (hapd->tls_workers == NULL) {
+		wpa_printf(MSG_ERROR, "Failed to start TLS worker threads");
+		return -1;
+	}
+#else /* CONFIG_TLS_WORKERS */
+	wpa_printf(MSG_INFO, "TLS worker thread support not included in the "
+		   "build - ignore tls_worker_threads");
+#endif /* CONFIG_TLS_WORKERS */
+	return 0;
+}
+#endif /* EAP_TLS_FUNCS */
 
 
 #ifdef RADIUS_SERVER
@@ -97,6 +125,7 @@ static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 	srv.acct_port = conf->radius_server_acct_port;
 	srv.conf_ctx = hapd;
 	srv.eap_sim_db_priv = hapd->eap_sim_db_priv;
+	srv.tls_workers = hapd->tls_workers;
 	srv.ssl_ctx = hapd->ssl_ctx;
 	srv.msg_ctx = hapd->msg_ctx;
 	srv.pac_opaque_encr_key = conf->pac_opaque_encr_key;
@@ -136,6 +165,37 @@ static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 #endif /* RADIUS_SERVER */
 
 
+#ifdef EAP_TLS_FUNCS
+static int authsrv_tls_session_file_in_use(struct hostapd_data *hapd)
+{
+	const char *file = hapd->conf->tls_session_cache_file;
+	struct hapd_interfaces *interfaces;
+	struct hostapd_data *bss;
+	size_t i, j;
+
+	if (file == NULL || hapd->iface == NULL ||
+	    hapd->iface->interfaces == NULL)
+		return 0;
+
+	/* Each BSS has its own session cache that would overwrite the file
+	 * written by another BSS */
+	interfaces = hapd->iface->interfaces;
+	for (i = 0; i < interfaces->count; i++) {
+		for (j = 0; j < interfaces->iface[i]->num_bss; j++) {
+			bss = interfaces->iface[i]->bss[j];
+			if (bss != hapd && bss->ssl_ctx &&
+			    bss->conf->tls_session_cache_file &&
+			    os_strcmp(bss->conf->tls_session_cache_file,
+				      file) == 0)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+#endif /* EAP_TLS_FUNCS */
+
+
 int authsrv_init(struct hostapd_data *hapd)
 {
 #ifdef EAP_TLS_FUNCS
@@ -143,8 +203,25 @@ int authsrv_init(struct hostapd_data *hapd)
 	    (hapd->conf->ca_cert || hapd->conf->server_cert ||
 	     hapd->conf->private_key || hapd->conf->dh_file)) {
 		struct tls_connection_params params;
+		struct tls_config conf;
 
-		hapd->ssl_ctx = tls_init(NULL);
+		if (authsrv_tls_session_file_in_use(hapd)) {
+			wpa_printf(MSG_ERROR, "tls_session_cache_file '%s' is "
+				   "already used by another BSS",
+				   hapd->conf->tls_session_cache_file);
+			return -1;
+		}
+
+		os_memset(&conf, 0, sizeof(conf));
+		conf.tls_session_lifetime = hapd->conf->tls_session_lifetime;
+		conf.tls_session_cache_size =
+			hapd->conf->tls_session_cache_size;
+		conf.tls_session_cache_file =
+			hapd->conf->tls_session_cache_file;
+		conf.tls_session_tickets = hapd->conf->tls_session_tickets;
+		conf.tls_session_ticket_key_lifetime =
+			hapd->conf->tls_session_ticket_key_lifetime;
+		hapd->ssl_ctx = tls_init(&conf);
 		if (hapd->ssl_ctx == NULL) {
 			wpa_printf(MSG_ERROR, "Failed to initialize TLS");
 			authsrv_deinit(hapd);
@@ -172,6 +249,12 @@ int authsrv_init(struct hostapd_data *hapd)
 			authsrv_deinit(hapd);
 			return -1;
 		}
+
+		if (hapd->conf->tls_worker_threads &&
+		    authsrv_init_tls_workers(hapd) < 0) {
+			authsrv_deinit(hapd);
+			return -1;
+		}
 	}
 #endif /* EAP_TLS_FUNCS */
 
@@ -179,13 +262,16 @@ int authsrv_init(struct hostapd_data *hapd)
 	if (hapd->conf->eap_sim_db) {
 		hapd->eap_sim_db_priv =
 			eap_sim_db_init(hapd->conf->eap_sim_db,
-					hostapd_sim_db_cb, hapd);
+					hostapd_eap_pending_cb, hapd);
 		if (hapd->eap_sim_db_priv == NULL) {
 			wpa_printf(MSG_ERROR, "Failed to initialize EAP-SIM "
 				   "database interface");
 			authsrv_deinit(hapd);
 			return -1;
 		}
+		eap_sim_db_set_prefetch(hapd->eap_sim_db_priv,
+					hapd->conf->eap_sim_db_prefetch,
+					hapd->conf->eap_sim_db_prefetch_imsis);
 	}
 #endif /* EAP_SIM_DB */
 
@@ -206,6 +292,11 @@ void authsrv_deinit(struct hostapd_data *hapd)
 	hapd->radius_srv = NULL;
 #endif /* RADIUS_SERVER */
 
+#ifdef CONFIG_TLS_WORKERS
+	eap_tls_workers_deinit(hapd->tls_workers);
+	hapd->tls_workers = NULL;
+#endif /* CONFIG_TLS_WORKERS */
+
 #ifdef EAP_TLS_FUNCS
 	if (hapd->ssl_ctx) {
 		tls_deinit(hapd->ssl_ctx);
@@ -220,3 +311,37 @@ void authsrv_deinit(struct hostapd_data *hapd)
 	}
 #endif /* EAP_SIM_DB */
 }
+
+
+int authsrv_get_tls_session_mib(struct hostapd_data *hapd, char *buf,
+				size_t buflen)
+{
+#ifdef EAP_TLS_FUNCS
+	struct tls_session_stats stats;
+	int ret;
+
+	if (hapd->ssl_ctx == NULL ||
+	    tls_get_session_stats(hapd->ssl_ctx, &stats) < 0)
+		return -1;
+
+	ret = os_snprintf(buf, buflen,
+			  "tlsSessionCacheEntries=%u\n"
+			  "tlsSessionCacheHits=%u\n"
+			  "tlsSessionCacheMisses=%u\n"
+			  "tlsSessionCacheTimeouts=%u\n"
+			  "tlsSessionCacheEvictions=%u\n"
+			  "tlsSessionTicketHits=%u\n"
+			  "tlsSessionTicketMisses=%u\n"
+			  "tlsSessionTicketsIssued=%u\n"
+			  "tlsSessionTicketKeyRotations=%u\n",
+			  stats.entries, stats.hits, stats.misses,
+			  stats.timeouts, stats.evictions, stats.ticket_hits,
+			  stats.ticket_misses, stats.tickets_issued,
+			  stats.ticket_key_rotations);
+	if (ret < 0 || (size_t) ret >= buflen)
+		return 0;
+	return ret;
+#else /* EAP_TLS_FUNCS */
+	return -1;
+#endif /* EAP_TLS_FUNCS */
+}
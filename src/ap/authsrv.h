@@ -11,5 +11,7 @@
 
 int authsrv_init(struct hostapd_data *hapd);
 void authsrv_deinit(struct hostapd_data *hapd);
+int authsrv_get_tls_session_mib(struct hostapd_data *hapd, char *buf,
+				size_t buflen);
 
 #endif /* AUTHSRV_H */
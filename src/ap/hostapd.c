@@ -24,6 +24,7 @@
 #include "beacon.h"
 #include "iapp.h"
 #include "ieee802_1x.h"
+#include "ieee802_11.h"
 #include "ieee802_11_auth.h"
 #include "vlan_init.h"
 #include "wpa_auth.h"
@@ -239,6 +240,11 @@ static int hostapd_broadcast_wep_set(struct hostapd_data *hapd)
 }
 
 
+#ifndef CONFIG_NO_RADIUS
+static void hostapd_das_deauth_batch(void *eloop_ctx, void *timeout_ctx);
+#endif /* CONFIG_NO_RADIUS */
+
+
 static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 {
 	if (!hapd->started) {
@@ -260,11 +266,16 @@ static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 	hapd->radius = NULL;
 	radius_das_deinit(hapd->radius_das);
 	hapd->radius_das = NULL;
+	eloop_cancel_timeout(hostapd_das_deauth_batch, hapd, NULL);
+	os_free(hapd->das_pending);
+	hapd->das_pending = NULL;
+	hapd->das_pending_num = hapd->das_pending_alloc = 0;
 #endif /* CONFIG_NO_RADIUS */
 
 	hostapd_deinit_wps(hapd);
 
 	authsrv_deinit(hapd);
+	hostapd_sae_workers_deinit(hapd);
 
 	if (hapd->interface_added &&
 	    hostapd_if_remove(hapd, WPA_IF_AP_BSS, hapd->conf->iface)) {
@@ -567,25 +578,36 @@ static int hostapd_das_nas_mismatch(struct hostapd_data *hapd,
 }
 
 
+static int hostapd_das_parse_acct_session_id(struct radius_das_attrs *attr,
+					     u32 *hi, u32 *lo)
+{
+	u8 buf[4];
+
+	/* Acct-Session-Id is generated as "%08X-%08X" */
+	if (attr->acct_session_id_len != 17 || attr->acct_session_id[8] != '-')
+		return -1;
+	if (hexstr2bin((const char *) attr->acct_session_id, buf, 4) < 0)
+		return -1;
+	*hi = WPA_GET_BE32(buf);
+	if (hexstr2bin((const char *) attr->acct_session_id + 9, buf, 4) < 0)
+		return -1;
+	*lo = WPA_GET_BE32(buf);
+	return 0;
+}
+
+
 static struct sta_info * hostapd_das_find_sta(struct hostapd_data *hapd,
 					      struct radius_das_attrs *attr)
 {
 	struct sta_info *sta = NULL;
-	char buf[128];
+	u32 hi, lo;
 
 	if (attr->sta_addr)
 		sta = ap_get_sta(hapd, attr->sta_addr);
 
 	if (sta == NULL && attr->acct_session_id &&
-	    attr->acct_session_id_len == 17) {
-		for (sta = hapd->sta_list; sta; sta = sta->next) {
-			os_snprintf(buf, sizeof(buf), "%08X-%08X",
-				    sta->acct_session_id_hi,
-				    sta->acct_session_id_lo);
-			if (os_memcmp(attr->acct_session_id, buf, 17) == 0)
-				break;
-		}
-	}
+	    hostapd_das_parse_acct_session_id(attr, &hi, &lo) == 0)
+		sta = ap_get_sta_acct_session(hapd, hi, lo);
 
 	if (sta == NULL && attr->cui) {
 		for (sta = hapd->sta_list; sta; sta = sta->next) {
@@ -616,6 +638,188 @@ static struct sta_info * hostapd_das_find_sta(struct hostapd_data *hapd,
 }
 
 
+static int hostapd_das_sta_match(struct hostapd_data *hapd,
+				 struct sta_info *sta,
+				 struct radius_das_attrs *attr)
+{
+	u32 hi, lo;
+
+	if (attr->sta_addr &&
+	    os_memcmp(sta->addr, attr->sta_addr, ETH_ALEN) != 0)
+		return 0;
+
+	if (attr->acct_session_id &&
+	    (hostapd_das_parse_acct_session_id(attr, &hi, &lo) < 0 ||
+	     sta->acct_session_id_hi != hi || sta->acct_session_id_lo != lo))
+		return 0;
+
+	if (attr->nas_port_range &&
+	    (sta->aid < attr->nas_port_first ||
+	     sta->aid > attr->nas_port_last))
+		return 0;
+
+	if (attr->cui) {
+		struct wpabuf *cui;
+
+		cui = ieee802_1x_get_radius_cui(sta->eapol_sm);
+		if (cui == NULL || wpabuf_len(cui) != attr->cui_len ||
+		    os_memcmp(wpabuf_head(cui), attr->cui, attr->cui_len) != 0)
+			return 0;
+	}
+
+	if (attr->user_name) {
+		u8 *identity;
+		size_t identity_len;
+
+		identity = ieee802_1x_get_identity(sta->eapol_sm,
+						   &identity_len);
+		if (identity == NULL || identity_len != attr->user_name_len ||
+		    os_memcmp(identity, attr->user_name, identity_len) != 0)
+			return 0;
+	}
+
+	if (attr->class_prefix) {
+		u8 *class;
+		size_t class_len;
+		int i;
+
+		for (i = 0; ; i++) {
+			class = ieee802_1x_get_radius_class(sta->eapol_sm,
+							    &class_len, i);
+			if (class == NULL)
+				return 0;
+			if (class_len >= attr->class_prefix_len &&
+			    os_memcmp(class, attr->class_prefix,
+				      attr->class_prefix_len) == 0)
+				break;
+		}
+	}
+
+	return 1;
+}
+
+
+static void hostapd_das_deauth_batch(void *eloop_ctx, void *timeout_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+	struct sta_info *sta;
+	size_t i, num;
+
+	num = hapd->das_pending_num;
+	if (num > hapd->conf->radius_das_batch_size)
+		num = hapd->conf->radius_das_batch_size;
+
+	for (i = 0; i < num; i++) {
+		const u8 *addr = &hapd->das_pending[i * ETH_ALEN];
+
+		/* The station may have left while waiting in the queue */
+		sta = ap_get_sta(hapd, addr);
+		if (sta == NULL)
+			continue;
+		hostapd_drv_sta_deauth(hapd, sta->addr,
+				       WLAN_REASON_PREV_AUTH_NOT_VALID);
+		ap_sta_deauthenticate(hapd, sta,
+				      WLAN_REASON_PREV_AUTH_NOT_VALID);
+	}
+
+	hapd->das_pending_num -= num;
+	os_memmove(hapd->das_pending, &hapd->das_pending[num * ETH_ALEN],
+		   hapd->das_pending_num * ETH_ALEN);
+	wpa_printf(MSG_DEBUG, "RADIUS DAS: Disconnected %u station(s); %u "
+		   "pending", (unsigned int) num,
+		   (unsigned int) hapd->das_pending_num);
+
+	if (hapd->das_pending_num) {
+		unsigned int ms = hapd->conf->radius_das_batch_interval;
+		eloop_register_timeout(ms / 1000, (ms % 1000) * 1000,
+				       hostapd_das_deauth_batch, hapd, NULL);
+	}
+}
+
+
+static int hostapd_das_queue_deauth(struct hostapd_data *hapd,
+				    struct sta_info *sta)
+{
+	if (hapd->das_pending_num == hapd->das_pending_alloc) {
+		size_t alloc = hapd->das_pending_alloc ?
+			2 * hapd->das_pending_alloc : 16;
+		u8 *n;
+
+		n = os_realloc_array(hapd->das_pending, alloc, ETH_ALEN);
+		if (n == NULL)
+			return -1;
+		hapd->das_pending = n;
+		hapd->das_pending_alloc = alloc;
+	}
+
+	/* Remove the PMKSA cache entry immediately so that the station cannot
+	 * use it to reconnect while the disconnection is still queued */
+	wpa_auth_pmksa_remove(hapd->wpa_auth, sta->addr);
+	os_memcpy(&hapd->das_pending[hapd->das_pending_num * ETH_ALEN],
+		  sta->addr, ETH_ALEN);
+	hapd->das_pending_num++;
+	return 0;
+}
+
+
+static enum radius_das_res
+hostapd_das_disconnect_bulk(struct hostapd_data *hapd,
+			    struct radius_das_attrs *attr)
+{
+	struct sta_info *sta = NULL;
+	unsigned int matches = 0;
+	size_t was_pending = hapd->das_pending_num;
+	u32 hi, lo;
+
+	if (!attr->sta_addr && !attr->acct_session_id && !attr->cui &&
+	    !attr->user_name && !attr->nas_port_range &&
+	    !attr->class_prefix && !attr->bssid && !attr->ssid) {
+		wpa_printf(MSG_DEBUG, "RADIUS DAS: No session selection "
+			   "attributes in bulk request");
+		return RADIUS_DAS_SESSION_NOT_FOUND;
+	}
+
+	if (attr->bssid && os_memcmp(attr->bssid, hapd->own_addr, ETH_ALEN))
+		return RADIUS_DAS_SESSION_NOT_FOUND;
+	if (attr->ssid &&
+	    (attr->ssid_len != hapd->conf->ssid.ssid_len ||
+	     os_memcmp(attr->ssid, hapd->conf->ssid.ssid, attr->ssid_len)))
+		return RADIUS_DAS_SESSION_NOT_FOUND;
+
+	/* Use the hash indexes for the unique session identifiers and walk
+	 * the station list only for selections that can match many
+	 * sessions */
+	if (attr->sta_addr || attr->acct_session_id) {
+		if (attr->sta_addr)
+			sta = ap_get_sta(hapd, attr->sta_addr);
+		else if (hostapd_das_parse_acct_session_id(attr, &hi, &lo) ==
+			 0)
+			sta = ap_get_sta_acct_session(hapd, hi, lo);
+		if (sta && hostapd_das_sta_match(hapd, sta, attr) &&
+		    hostapd_das_queue_deauth(hapd, sta) == 0)
+			matches++;
+	} else {
+		for (sta = hapd->sta_list; sta; sta = sta->next) {
+			if (!hostapd_das_sta_match(hapd, sta, attr))
+				continue;
+			if (hostapd_das_queue_deauth(hapd, sta) < 0)
+				break;
+			matches++;
+		}
+	}
+
+	if (matches == 0)
+		return RADIUS_DAS_SESSION_NOT_FOUND;
+
+	wpa_printf(MSG_DEBUG, "RADIUS DAS: %u session(s) matched; queued for "
+		   "disconnection", matches);
+	if (was_pending == 0)
+		eloop_register_timeout(0, 0, hostapd_das_deauth_batch, hapd,
+				       NULL);
+
+	return RADIUS_DAS_SUCCESS;
+}
+
 static enum radius_das_res
 hostapd_das_disconnect(void *ctx, struct radius_das_attrs *attr)
 {
@@ -625,6 +829,9 @@ hostapd_das_disconnect(void *ctx, struct radius_das_attrs *attr)
 	if (hostapd_das_nas_mismatch(hapd, attr))
 		return RADIUS_DAS_NAS_MISMATCH;
 
+	if (hapd->conf->radius_das_bulk)
+		return hostapd_das_disconnect_bulk(hapd, attr);
+
 	sta = hostapd_das_find_sta(hapd, attr);
 	if (sta == NULL)
 		return RADIUS_DAS_SESSION_NOT_FOUND;
@@ -638,6 +845,7 @@ hostapd_das_disconnect(void *ctx, struct radius_das_attrs *attr)
 	return RADIUS_DAS_SUCCESS;
 }
 
+
 #endif /* CONFIG_NO_RADIUS */
 
 
@@ -782,6 +990,7 @@ static int hostapd_setup_bss(struct hostapd_data *hapd, int first)
 		das_conf.time_window = hapd->conf->radius_das_time_window;
 		das_conf.require_event_timestamp =
 			hapd->conf->radius_das_require_event_timestamp;
+		das_conf.bulk = hapd->conf->radius_das_bulk;
 		das_conf.ctx = hapd;
 		das_conf.disconnect = hostapd_das_disconnect;
 		hapd->radius_das = radius_das_init(&das_conf);
@@ -803,6 +1012,9 @@ static int hostapd_setup_bss(struct hostapd_data *hapd, int first)
 	if (authsrv_init(hapd) < 0)
 		return -1;
 
+	if (hostapd_sae_workers_init(hapd) < 0)
+		return -1;
+
 	if (ieee802_1x_init(hapd)) {
 		wpa_printf(MSG_ERROR, "IEEE 802.1X initialization failed.");
 		return -1;
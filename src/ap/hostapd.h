@@ -17,6 +17,8 @@
 
 struct wpa_ctrl_dst;
 struct radius_server_data;
+struct eap_tls_workers;
+struct sae_workers;
 struct upnp_wps_device_sm;
 struct hostapd_data;
 struct sta_info;
@@ -111,6 +113,8 @@ struct hostapd_data {
 #define STA_HASH_SIZE 256
 #define STA_HASH(sta) (sta[5])
 	struct sta_info *sta_hash[STA_HASH_SIZE];
+#define STA_ACCT_HASH(lo) ((lo) & (STA_HASH_SIZE - 1))
+	struct sta_info *sta_acct_hash[STA_HASH_SIZE];
 
 	/*
 	 * Bitfield for indicating which AIDs are allocated. Only AID values
@@ -132,6 +136,10 @@ struct hostapd_data {
 	struct radius_client_data *radius;
 	u32 acct_session_id_hi, acct_session_id_lo;
 	struct radius_das_data *radius_das;
+	/* Stations waiting for a rate-limited RADIUS DAS disconnection */
+	u8 *das_pending;
+	size_t das_pending_num;
+	size_t das_pending_alloc;
 
 	struct iapp_data *iapp;
 
@@ -151,6 +159,7 @@ struct hostapd_data {
 
 	void *ssl_ctx;
 	void *eap_sim_db_priv;
+	struct eap_tls_workers *tls_workers;
 	struct radius_server_data *radius_srv;
 
 	int parameter_set_count;
@@ -239,6 +248,7 @@ struct hostapd_data {
 	/** Key used for generating SAE anti-clogging tokens */
 	u8 sae_token_key[8];
 	struct os_reltime last_sae_token_key_update;
+	struct sae_workers *sae_workers;
 #endif /* CONFIG_SAE */
 
 #ifdef CONFIG_TESTING_OPTIONS
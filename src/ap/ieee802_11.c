@@ -39,6 +39,7 @@
 #include "p2p_hostapd.h"
 #include "ap_drv_ops.h"
 #include "wnm_ap.h"
+#include "sae_workers.h"
 #include "ieee802_11.h"
 #include "dfs.h"
 
@@ -382,6 +383,11 @@ static int use_sae_anti_clogging(struct hostapd_data *hapd)
 	if (hapd->conf->sae_anti_clogging_threshold == 0)
 		return 1;
 
+	/* Commits waiting for a worker thread are open sessions, too */
+	open = sae_workers_queued(hapd->sae_workers);
+	if (open >= hapd->conf->sae_anti_clogging_threshold)
+		return 1;
+
 	for (sta = hapd->sta_list; sta; sta = sta->next) {
 		if (!sta->sae)
 			continue;
@@ -443,6 +449,120 @@ static struct wpabuf * auth_build_token_req(struct hostapd_data *hapd,
 }
 
 
+static int auth_queue_sae_commit(struct hostapd_data *hapd,
+				 struct sta_info *sta, int prio)
+{
+	const char *pw = hapd->conf->ssid.wpa_passphrase;
+
+	sta->sae_job = sae_job_start(hapd->sae_workers, hapd->own_addr,
+				     sta->addr, (const u8 *) pw,
+				     os_strlen(pw), sta->sae, prio, sta);
+	if (sta->sae_job == NULL)
+		return -1;
+	wpa_printf(MSG_DEBUG, "SAE: Queued commit from " MACSTR "%s",
+		   MAC2STR(sta->addr), prio ? " (token)" : "");
+	return 0;
+}
+
+
+#ifdef CONFIG_SAE_WORKERS
+static void handle_auth_sae_job_done(void *ctx, void *session_ctx)
+{
+	struct hostapd_data *hapd = ctx;
+	struct sta_info *sta = session_ctx;
+	u16 resp = WLAN_STATUS_SUCCESS;
+	struct wpabuf *data = NULL;
+	int res;
+
+	res = sae_job_finish(sta->sae_job);
+	sta->sae_job = NULL;
+
+	if (res == -2) {
+		/* Evicted to make room for a peer that used a valid token */
+		wpa_printf(MSG_DEBUG, "SAE: Request anti-clogging token from "
+			   MACSTR " (commit evicted from work queue)",
+			   MAC2STR(sta->addr));
+		data = auth_build_token_req(hapd, sta->addr);
+		resp = WLAN_STATUS_ANTI_CLOGGING_TOKEN_REQ;
+	} else if (res < 0) {
+		wpa_printf(MSG_DEBUG, "SAE: Could not process commit from "
+			   MACSTR, MAC2STR(sta->addr));
+		resp = WLAN_STATUS_UNSPECIFIED_FAILURE;
+	} else {
+		data = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+		if (data == NULL) {
+			resp = WLAN_STATUS_UNSPECIFIED_FAILURE;
+		} else {
+			sae_write_commit(sta->sae, data, NULL);
+			sta->sae->state = SAE_COMMITTED;
+		}
+	}
+
+	sta->auth_alg = WLAN_AUTH_SAE;
+
+	send_auth_reply(hapd, sta->addr, hapd->own_addr, WLAN_AUTH_SAE, 1,
+			resp, data ? wpabuf_head(data) : (u8 *) "",
+			data ? wpabuf_len(data) : 0);
+	wpabuf_free(data);
+}
+#endif /* CONFIG_SAE_WORKERS */
+
+
+/**
+ * hostapd_sae_workers_init - Start SAE commit processing worker threads
+ * @hapd: Pointer to BSS data
+ * Returns: 0 on success, -1 on failure
+ *
+ * Nothing is started if sae_worker_threads is not set; received commits are
+ * then processed synchronously.
+ */
+int hostapd_sae_workers_init(struct hostapd_data *hapd)
+{
+	if (hapd->conf->sae_worker_threads == 0 ||
+	    !wpa_key_mgmt_sae(hapd->conf->wpa_key_mgmt))
+		return 0;
+
+#ifdef CONFIG_SAE_WORKERS
+	hapd->sae_workers = sae_workers_init(hapd->conf->sae_worker_threads,
+					     hapd->conf->sae_queue_len,
+					     handle_auth_sae_job_done, hapd);
+	if (hapd->sae_workers == NULL) {
+		wpa_printf(MSG_ERROR, "Failed to start SAE worker threads");
+		return -1;
+	}
+#else /* CONFIG_SAE_WORKERS */
+	wpa_printf(MSG_INFO, "SAE worker thread support not included in the "
+		   "build - ignore sae_worker_threads");
+#endif /* CONFIG_SAE_WORKERS */
+
+	return 0;
+}
+
+
+/**
+ * hostapd_sae_workers_deinit - Stop SAE commit processing worker threads
+ * @hapd: Pointer to BSS data
+ */
+void hostapd_sae_workers_deinit(struct hostapd_data *hapd)
+{
+#ifdef CONFIG_SAE_WORKERS
+	struct sta_info *sta;
+
+	sae_workers_deinit(hapd->sae_workers);
+	hapd->sae_workers = NULL;
+
+	/* The worker threads are stopped, so the remaining jobs only need to
+	 * be released */
+	for (sta = hapd->sta_list; sta; sta = sta->next) {
+		if (sta->sae_job) {
+			sae_job_cancel(sta->sae_job);
+			sta->sae_job = NULL;
+		}
+	}
+#endif /* CONFIG_SAE_WORKERS */
+}
+
+
 static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 			    const struct ieee80211_mgmt *mgmt, size_t len,
 			    u8 auth_transaction)
@@ -459,6 +579,13 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 		sta->sae->state = SAE_NOTHING;
 	}
 
+	if (sta->sae_job) {
+		wpa_printf(MSG_DEBUG, "SAE: Drop Authentication frame from "
+			   MACSTR " while previous commit is being processed",
+			   MAC2STR(sta->addr));
+		return;
+	}
+
 	if (auth_transaction == 1) {
 		const u8 *token = NULL;
 		size_t token_len = 0;
@@ -484,6 +611,22 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 					   MAC2STR(sta->addr));
 				data = auth_build_token_req(hapd, sta->addr);
 				resp = WLAN_STATUS_ANTI_CLOGGING_TOKEN_REQ;
+			} else if (hapd->sae_workers &&
+				   hapd->conf->ssid.wpa_passphrase) {
+				if (auth_queue_sae_commit(hapd, sta,
+							  token != NULL) == 0)
+					return; /* response sent when done */
+				if (token) {
+					wpa_printf(MSG_DEBUG, "SAE: Work queue "
+						   "full - drop commit from "
+						   MACSTR, MAC2STR(sta->addr));
+					return;
+				}
+				wpa_printf(MSG_DEBUG, "SAE: Work queue full - "
+					   "request anti-clogging token from "
+					   MACSTR, MAC2STR(sta->addr));
+				data = auth_build_token_req(hapd, sta->addr);
+				resp = WLAN_STATUS_ANTI_CLOGGING_TOKEN_REQ;
 			} else {
 				data = auth_process_sae_commit(hapd, sta);
 				if (data == NULL)
@@ -2156,8 +2299,39 @@ void ieee802_11_mgmt_cb(struct hostapd_data *hapd, const u8 *buf, size_t len,
 
 int ieee802_11_get_mib(struct hostapd_data *hapd, char *buf, size_t buflen)
 {
+#ifdef CONFIG_SAE_WORKERS
+	struct sae_workers_stats stats;
+	int ret;
+
+	if (hapd->sae_workers == NULL)
+		return 0;
+
+	sae_workers_get_stats(hapd->sae_workers, &stats);
+	ret = os_snprintf(buf, buflen,
+			  "saeQueueLength=%u\n"
+			  "saeQueued=%u\n"
+			  "saeQueuedToken=%u\n"
+			  "saeRunning=%u\n"
+			  "saeMaxQueued=%u\n"
+			  "saeStarted=%lu\n"
+			  "saeCompleted=%lu\n"
+			  "saeRejected=%lu\n"
+			  "saeEvicted=%lu\n"
+			  "saeAvgQueueWaitUsec=%lu\n",
+			  hapd->conf->sae_queue_len,
+			  stats.queued, stats.queued_prio, stats.running,
+			  stats.max_queued, stats.started, stats.completed,
+			  stats.rejected, stats.evicted,
+			  stats.completed ?
+			  (unsigned long) (stats.wait_usec / stats.completed) :
+			  0UL);
+	if (ret < 0 || (size_t) ret >= buflen)
+		return 0;
+	return ret;
+#else /* CONFIG_SAE_WORKERS */
 	/* TODO */
 	return 0;
+#endif /* CONFIG_SAE_WORKERS */
 }
 
 
@@ -87,4 +87,18 @@ int hostapd_update_time_adv(struct hostapd_data *hapd);
 void hostapd_client_poll_ok(struct hostapd_data *hapd, const u8 *addr);
 u8 * hostapd_eid_bss_max_idle_period(struct hostapd_data *hapd, u8 *eid);
 
+#if defined(NEED_AP_MLME) && defined(CONFIG_SAE)
+int hostapd_sae_workers_init(struct hostapd_data *hapd);
+void hostapd_sae_workers_deinit(struct hostapd_data *hapd);
+#else /* NEED_AP_MLME && CONFIG_SAE */
+static inline int hostapd_sae_workers_init(struct hostapd_data *hapd)
+{
+	return 0;
+}
+
+static inline void hostapd_sae_workers_deinit(struct hostapd_data *hapd)
+{
+}
+#endif /* NEED_AP_MLME && CONFIG_SAE */
+
 #endif /* IEEE802_11_H */
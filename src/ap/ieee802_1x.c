@@ -20,6 +20,7 @@
 #include "radius/radius_client.h"
 #include "eap_server/eap.h"
 #include "eap_common/eap_wsc_common.h"
+#include "eap_server/eap_sim_db.h"
 #include "eapol_auth/eapol_auth_sm.h"
 #include "eapol_auth/eapol_auth_sm_i.h"
 #include "p2p/p2p.h"
@@ -1889,6 +1890,7 @@ int ieee802_1x_init(struct hostapd_data *hapd)
 	conf.ssl_ctx = hapd->ssl_ctx;
 	conf.msg_ctx = hapd->msg_ctx;
 	conf.eap_sim_db_priv = hapd->eap_sim_db_priv;
+	conf.tls_workers = hapd->tls_workers;
 	conf.eap_req_id_text = hapd->conf->eap_req_id_text;
 	conf.eap_req_id_text_len = hapd->conf->eap_req_id_text_len;
 	conf.pac_opaque_encr_key = hapd->conf->pac_opaque_encr_key;
@@ -2128,7 +2130,11 @@ static const char * bool_txt(Boolean bool)
 
 int ieee802_1x_get_mib(struct hostapd_data *hapd, char *buf, size_t buflen)
 {
-	/* TODO */
+	/* TODO: dot1xPae* */
+#ifdef EAP_SIM_DB
+	if (hapd->eap_sim_db_priv)
+		return eap_sim_db_get_mib(hapd->eap_sim_db_priv, buf, buflen);
+#endif /* EAP_SIM_DB */
 	return 0;
 }
 
@@ -0,0 +1,515 @@
+/*
+ * hostapd / SAE commit processing in worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Processing a received SAE commit message requires the password element
+ * (PWE) to be derived for the peer (at least 40 hunting-and-pecking rounds,
+ * each with a modular square root) and a number of scalar multiplications.
+ * This is long enough to stall all other processing in the single-threaded
+ * event loop when many peers start SAE at the same time. This module runs
+ * sae_prepare_commit() and sae_process_commit() for the peers in a small pool
+ * of worker threads. Completion is reported back to the event loop through a
+ * pipe, after which the registered callback is used to send the response.
+ *
+ * The queue is bounded. Jobs from peers that included a valid anti-clogging
+ * token are processed before all other jobs and when the queue is full, such
+ * a job evicts the most recently queued job from a peer without a token.
+ * The caller is expected to allow at most one job per peer, i.e., a peer can
+ * only hold one queue entry regardless of how many commits it sends.
+ *
+ * Only the SAE data of the job is accessed from the worker thread.
+ */
+
+#include "includes.h"
+#include <pthread.h>
+
+#include "common.h"
+#include "utils/list.h"
+#include "utils/eloop.h"
+#include "crypto/crypto.h"
+#include "common/sae.h"
+#include "sae_workers.h"
+
+#ifdef WPA_TRACE
+#error CONFIG_SAE_WORKERS cannot be used with WPA_TRACE
+#endif /* WPA_TRACE */
+
+#define SAE_WORKERS_MAX 64
+
+
+enum sae_job_state {
+	SAE_JOB_QUEUED,
+	SAE_JOB_RUNNING,
+	SAE_JOB_COMPLETED,
+	SAE_JOB_DONE
+};
+
+struct sae_job {
+	struct dl_list list;
+	struct sae_workers *workers;
+	enum sae_job_state state;
+	int orphan; /* SAE data owned by the job after sae_job_cancel() */
+	int prio;
+	int result;
+	int notify_errno; /* pipe write() error, logged from the event loop */
+	u8 addr1[ETH_ALEN];
+	u8 addr2[ETH_ALEN];
+	u8 *password;
+	size_t password_len;
+	struct sae_data *sae;
+	struct os_reltime queued;
+	void *session_ctx;
+};
+
+struct sae_workers {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct dl_list queue_prio; /* struct sae_job::list */
+	struct dl_list queue; /* struct sae_job::list */
+	struct dl_list completed; /* struct sae_job::list */
+	unsigned int queue_len;
+	struct sae_workers_stats stats;
+	int stop;
+	int pipe[2];
+	pthread_t *threads;
+	unsigned int num_threads;
+	void (*done_cb)(void *ctx, void *session_ctx);
+	void *ctx;
+};
+
+
+static void sae_job_free(struct sae_job *job)
+{
+	if (job->orphan) {
+		sae_clear_data(job->sae);
+		os_free(job->sae);
+	}
+	if (job->password) {
+		os_memset(job->password, 0, job->password_len);
+		os_free(job->password);
+	}
+	os_free(job);
+}
+
+
+/*
+ * Must be called with workers->lock held. This is used from the worker
+ * threads, so a failure is recorded in the completed job and logged when the
+ * event loop collects it.
+ */
+static void sae_workers_notify(struct sae_workers *workers,
+			       struct sae_job *job)
+{
+	u8 notify = 0;
+
+	if (write(workers->pipe[1], &notify, 1) < 0)
+		job->notify_errno = errno;
+}
+
+
+static void * sae_worker_thread(void *arg)
+{
+	struct sae_workers *workers = arg;
+	struct sae_job *job;
+	struct os_reltime now, diff;
+	int res;
+
+	pthread_mutex_lock(&workers->lock);
+	for (;;) {
+		while (!workers->stop && dl_list_empty(&workers->queue_prio) &&
+		       dl_list_empty(&workers->queue))
+			pthread_cond_wait(&workers->cond, &workers->lock);
+		if (workers->stop)
+			break;
+		job = dl_list_first(&workers->queue_prio, struct sae_job,
+				    list);
+		if (job) {
+			workers->stats.queued_prio--;
+		} else {
+			job = dl_list_first(&workers->queue, struct sae_job,
+					    list);
+		}
+		dl_list_del(&job->list);
+		job->state = SAE_JOB_RUNNING;
+		workers->stats.queued--;
+		workers->stats.running++;
+		os_get_reltime(&now);
+		os_reltime_sub(&now, &job->queued, &diff);
+		workers->stats.wait_usec += diff.sec * 1000000ULL + diff.usec;
+		pthread_mutex_unlock(&workers->lock);
+
+		res = sae_prepare_commit(job->addr1, job->addr2, job->password,
+					 job->password_len, job->sae);
+		if (res == 0)
+			res = sae_process_commit(job->sae);
+
+		pthread_mutex_lock(&workers->lock);
+		job->result = res < 0 ? -1 : 0;
+		job->state = SAE_JOB_COMPLETED;
+		workers->stats.running--;
+		workers->stats.completed++;
+		dl_list_add_tail(&workers->completed, &job->list);
+		sae_workers_notify(workers, job);
+	}
+	pthread_mutex_unlock(&workers->lock);
+
+	crypto_thread_deinit();
+
+	return NULL;
+}
+
+
+static void sae_workers_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct sae_workers *workers = eloop_ctx;
+	struct sae_job *job;
+	u8 buf[32];
+
+	if (read(sock, buf, sizeof(buf)) < 0) {
+		wpa_printf(MSG_INFO, "SAE workers: read: %s", strerror(errno));
+		return;
+	}
+
+	/*
+	 * Process one job at a time without holding the lock since the
+	 * callback may end up cancelling other completed jobs.
+	 */
+	for (;;) {
+		pthread_mutex_lock(&workers->lock);
+		job = dl_list_first(&workers->completed, struct sae_job, list);
+		if (job)
+			dl_list_del(&job->list);
+		pthread_mutex_unlock(&workers->lock);
+		if (job == NULL)
+			break;
+
+		if (job->notify_errno)
+			wpa_printf(MSG_INFO, "SAE workers: write: %s",
+				   strerror(job->notify_errno));
+
+		if (job->orphan) {
+			wpa_printf(MSG_DEBUG, "SAE workers: Drop result for a "
+				   "removed peer");
+			sae_job_free(job);
+			continue;
+		}
+
+		job->state = SAE_JOB_DONE;
+		workers->done_cb(workers->ctx, job->session_ctx);
+	}
+}
+
+
+/**
+ * sae_workers_init - Start SAE worker threads
+ * @num_threads: Number of worker threads
+ * @queue_len: Maximum number of jobs waiting for a worker thread
+ * @done_cb: Callback function for reporting completed jobs in the event loop
+ * @ctx: Context data for done_cb
+ * Returns: Pointer to the worker pool or %NULL on failure
+ *
+ * done_cb is called with the session_ctx value from sae_job_start() once the
+ * job has been completed or evicted from the queue. The result is collected
+ * with sae_job_finish().
+ */
+struct sae_workers *
+sae_workers_init(unsigned int num_threads, unsigned int queue_len,
+		 void (*done_cb)(void *ctx, void *session_ctx), void *ctx)
+{
+	struct sae_workers *workers;
+	unsigned int i;
+
+	if (num_threads == 0 || num_threads > SAE_WORKERS_MAX ||
+	    queue_len == 0)
+		return NULL;
+
+	if (crypto_threads_init() < 0) {
+		wpa_printf(MSG_ERROR, "SAE workers: Crypto library does not "
+			   "support concurrent use");
+		return NULL;
+	}
+
+	workers = os_zalloc(sizeof(*workers));
+	if (workers == NULL)
+		return NULL;
+	workers->queue_len = queue_len;
+	workers->done_cb = done_cb;
+	workers->ctx = ctx;
+	dl_list_init(&workers->queue_prio);
+	dl_list_init(&workers->queue);
+	dl_list_init(&workers->completed);
+
+	workers->threads = os_calloc(num_threads, sizeof(pthread_t));
+	if (workers->threads == NULL) {
+		os_free(workers);
+		return NULL;
+	}
+
+	if (pipe(workers->pipe) < 0) {
+		wpa_printf(MSG_ERROR, "SAE workers: pipe: %s",
+			   strerror(errno));
+		os_free(workers->threads);
+		os_free(workers);
+		return NULL;
+	}
+
+	pthread_mutex_init(&workers->lock, NULL);
+	pthread_cond_init(&workers->cond, NULL);
+
+	if (eloop_register_read_sock(workers->pipe[0], sae_workers_receive,
+				     workers, NULL) < 0) {
+		sae_workers_deinit(workers);
+		return NULL;
+	}
+
+	for (i = 0; i < num_threads; i++) {
+		if (pthread_create(&workers->threads[i], NULL,
+				   sae_worker_thread, workers) != 0) {
+			wpa_printf(MSG_ERROR, "SAE workers: Failed to create "
+				   "worker thread");
+			sae_workers_deinit(workers);
+			return NULL;
+		}
+		workers->num_threads++;
+	}
+
+	wpa_printf(MSG_DEBUG, "SAE workers: Started %u worker thread(s) "
+		   "(queue length %u)", num_threads, queue_len);
+
+	return workers;
+}
+
+
+static void sae_workers_detach(struct dl_list *list)
+{
+	struct sae_job *job, *prev;
+
+	dl_list_for_each_safe(job, prev, list, struct sae_job, list) {
+		dl_list_del(&job->list);
+		if (job->orphan) {
+			sae_job_free(job);
+			continue;
+		}
+		job->workers = NULL;
+		job->result = -1;
+		job->state = SAE_JOB_DONE;
+	}
+}
+
+
+/**
+ * sae_workers_deinit - Stop SAE worker threads
+ * @workers: Pointer from sae_workers_init()
+ *
+ * Jobs that are still referenced by peers are detached from the pool and
+ * reported as failed when the result is collected.
+ */
+void sae_workers_deinit(struct sae_workers *workers)
+{
+	unsigned int i;
+
+	if (workers == NULL)
+		return;
+
+	pthread_mutex_lock(&workers->lock);
+	workers->stop = 1;
+	pthread_cond_broadcast(&workers->cond);
+	pthread_mutex_unlock(&workers->lock);
+
+	for (i = 0; i < workers->num_threads; i++)
+		pthread_join(workers->threads[i], NULL);
+	os_free(workers->threads);
+
+	sae_workers_detach(&workers->queue_prio);
+	sae_workers_detach(&workers->queue);
+	sae_workers_detach(&workers->completed);
+
+	eloop_unregister_read_sock(workers->pipe[0]);
+	close(workers->pipe[0]);
+	close(workers->pipe[1]);
+	pthread_cond_destroy(&workers->cond);
+	pthread_mutex_destroy(&workers->lock);
+	os_free(workers);
+}
+
+
+/**
+ * sae_job_start - Process a received SAE commit in a worker thread
+ * @workers: Pointer from sae_workers_init()
+ * @addr1: Own MAC address (for sae_prepare_commit())
+ * @addr2: Peer MAC address (for sae_prepare_commit())
+ * @password: Password (a copy is taken)
+ * @password_len: Length of the password in octets
+ * @sae: SAE data with the parsed peer commit
+ * @prio: Whether the peer used a valid anti-clogging token
+ * @session_ctx: Context data to report to the done_cb
+ * Returns: Pointer to the job or %NULL if the queue is full or on failure
+ *
+ * The SAE data must not be used by the caller before sae_job_done() returns 1
+ * for this job.
+ */
+struct sae_job * sae_job_start(struct sae_workers *workers, const u8 *addr1,
+			       const u8 *addr2, const u8 *password,
+			       size_t password_len, struct sae_data *sae,
+			       int prio, void *session_ctx)
+{
+	struct sae_job *job, *evict = NULL;
+
+	job = os_zalloc(sizeof(*job));
+	if (job == NULL)
+		return NULL;
+	job->password = os_malloc(password_len);
+	if (job->password == NULL) {
+		os_free(job);
+		return NULL;
+	}
+	os_memcpy(job->password, password, password_len);
+	job->password_len = password_len;
+	os_memcpy(job->addr1, addr1, ETH_ALEN);
+	os_memcpy(job->addr2, addr2, ETH_ALEN);
+	job->workers = workers;
+	job->sae = sae;
+	job->prio = prio;
+	job->session_ctx = session_ctx;
+	os_get_reltime(&job->queued);
+
+	pthread_mutex_lock(&workers->lock);
+	if (workers->stats.queued >= workers->queue_len) {
+		if (prio)
+			evict = dl_list_last(&workers->queue, struct sae_job,
+					     list);
+		if (evict == NULL) {
+			workers->stats.rejected++;
+			pthread_mutex_unlock(&workers->lock);
+			sae_job_free(job);
+			return NULL;
+		}
+		dl_list_del(&evict->list);
+		evict->result = -2;
+		evict->state = SAE_JOB_COMPLETED;
+		dl_list_add_tail(&workers->completed, &evict->list);
+		workers->stats.queued--;
+		workers->stats.evicted++;
+		sae_workers_notify(workers, evict);
+	}
+
+	job->state = SAE_JOB_QUEUED;
+	if (prio) {
+		dl_list_add_tail(&workers->queue_prio, &job->list);
+		workers->stats.queued_prio++;
+	} else {
+		dl_list_add_tail(&workers->queue, &job->list);
+	}
+	workers->stats.queued++;
+	workers->stats.started++;
+	if (workers->stats.queued > workers->stats.max_queued)
+		workers->stats.max_queued = workers->stats.queued;
+	pthread_cond_signal(&workers->cond);
+	pthread_mutex_unlock(&workers->lock);
+
+	return job;
+}
+
+
+/**
+ * sae_job_done - Check whether a job has been completed
+ * @job: Pointer from sae_job_start()
+ * Returns: 1 if the result is available, 0 if the job is still in progress
+ */
+int sae_job_done(struct sae_job *job)
+{
+	return job->state == SAE_JOB_DONE;
+}
+
+
+/**
+ * sae_job_finish - Collect the result of a completed job
+ * @job: Pointer from sae_job_start(); this is freed
+ * Returns: 0 if the commit was processed successfully, -1 on failure, or -2
+ * if the job was evicted from the queue before it was processed
+ */
+int sae_job_finish(struct sae_job *job)
+{
+	int res = job->result;
+
+	sae_job_free(job);
+	return res;
+}
+
+
+/**
+ * sae_job_cancel - Cancel a job
+ * @job: Pointer from sae_job_start(); this is freed or orphaned
+ * Returns: 1 if a worker thread is still processing the SAE data, 0 if not
+ *
+ * If 1 is returned, the ownership of the SAE data is transferred to the
+ * worker pool and it is freed once the worker thread is done with it, i.e.,
+ * the caller must not free it.
+ */
+int sae_job_cancel(struct sae_job *job)
+{
+	struct sae_workers *workers = job->workers;
+	int in_use = 0;
+
+	if (workers) {
+		pthread_mutex_lock(&workers->lock);
+		switch (job->state) {
+		case SAE_JOB_QUEUED:
+			dl_list_del(&job->list);
+			workers->stats.queued--;
+			if (job->prio)
+				workers->stats.queued_prio--;
+			break;
+		case SAE_JOB_COMPLETED:
+			dl_list_del(&job->list);
+			break;
+		case SAE_JOB_RUNNING:
+			job->orphan = 1;
+			in_use = 1;
+			break;
+		case SAE_JOB_DONE:
+			break;
+		}
+		pthread_mutex_unlock(&workers->lock);
+	}
+
+	if (!in_use)
+		sae_job_free(job);
+
+	return in_use;
+}
+
+
+/**
+ * sae_workers_queued - Get the number of pending jobs
+ * @workers: Pointer from sae_workers_init() or %NULL
+ * Returns: Number of jobs that are queued or being processed
+ */
+unsigned int sae_workers_queued(struct sae_workers *workers)
+{
+	unsigned int res;
+
+	if (workers == NULL)
+		return 0;
+	pthread_mutex_lock(&workers->lock);
+	res = workers->stats.queued + workers->stats.running;
+	pthread_mutex_unlock(&workers->lock);
+	return res;
+}
+
+
+/**
+ * sae_workers_get_stats - Get SAE work queue statistics
+ * @workers: Pointer from sae_workers_init()
+ * @stats: Buffer for the statistics
+ */
+void sae_workers_get_stats(struct sae_workers *workers,
+			   struct sae_workers_stats *stats)
+{
+	pthread_mutex_lock(&workers->lock);
+	os_memcpy(stats, &workers->stats, sizeof(*stats));
+	pthread_mutex_unlock(&workers->lock);
+}
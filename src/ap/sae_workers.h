@@ -0,0 +1,91 @@
+/*
+ * hostapd / SAE commit processing in worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef SAE_WORKERS_H
+#define SAE_WORKERS_H
+
+struct sae_workers;
+struct sae_job;
+struct sae_data;
+
+/**
+ * struct sae_workers_stats - SAE work queue statistics
+ * @queued: Number of jobs currently waiting for a worker thread
+ * @queued_prio: Number of the queued jobs that are from peers that used a
+ *	valid anti-clogging token
+ * @running: Number of jobs currently being processed
+ * @max_queued: Highest number of queued jobs seen
+ * @started: Total number of jobs accepted to the queue
+ * @completed: Total number of jobs processed
+ * @rejected: Total number of jobs rejected due to full queue
+ * @evicted: Total number of queued jobs evicted to make room for a job from
+ *	a peer with a valid anti-clogging token
+ * @wait_usec: Total time (in microseconds) the processed jobs were queued
+ */
+struct sae_workers_stats {
+	unsigned int queued;
+	unsigned int queued_prio;
+	unsigned int running;
+	unsigned int max_queued;
+	unsigned long started;
+	unsigned long completed;
+	unsigned long rejected;
+	unsigned long evicted;
+	unsigned long long wait_usec;
+};
+
+#ifdef CONFIG_SAE_WORKERS
+
+struct sae_workers *
+sae_workers_init(unsigned int num_threads, unsigned int queue_len,
+		 void (*done_cb)(void *ctx, void *session_ctx), void *ctx);
+void sae_workers_deinit(struct sae_workers *workers);
+struct sae_job * sae_job_start(struct sae_workers *workers, const u8 *addr1,
+			       const u8 *addr2, const u8 *password,
+			       size_t password_len, struct sae_data *sae,
+			       int prio, void *session_ctx);
+int sae_job_done(struct sae_job *job);
+int sae_job_finish(struct sae_job *job);
+int sae_job_cancel(struct sae_job *job);
+unsigned int sae_workers_queued(struct sae_workers *workers);
+void sae_workers_get_stats(struct sae_workers *workers,
+			   struct sae_workers_stats *stats);
+
+#else /* CONFIG_SAE_WORKERS */
+
+static inline struct sae_job *
+sae_job_start(struct sae_workers *workers, const u8 *addr1, const u8 *addr2,
+	      const u8 *password, size_t password_len, struct sae_data *sae,
+	      int prio, void *session_ctx)
+{
+	return NULL;
+}
+
+static inline int sae_job_done(struct sae_job *job)
+{
+	return 1;
+}
+
+static inline int sae_job_finish(struct sae_job *job)
+{
+	return -1;
+}
+
+static inline int sae_job_cancel(struct sae_job *job)
+{
+	return 0;
+}
+
+static inline unsigned int sae_workers_queued(struct sae_workers *workers)
+{
+	return 0;
+}
+
+#endif /* CONFIG_SAE_WORKERS */
+
+#endif /* SAE_WORKERS_H */
@@ -31,6 +31,7 @@
 #include "ap_drv_ops.h"
 #include "gas_serv.h"
 #include "wnm_ap.h"
+#include "sae_workers.h"
 #include "sta_info.h"
 
 static void ap_sta_remove_in_other_bss(struct hostapd_data *hapd,
@@ -71,6 +72,19 @@ struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta)
 }
 
 
+struct sta_info * ap_get_sta_acct_session(struct hostapd_data *hapd,
+					  u32 hi, u32 lo)
+{
+	struct sta_info *s;
+
+	s = hapd->sta_acct_hash[STA_ACCT_HASH(lo)];
+	while (s != NULL &&
+	       (s->acct_session_id_lo != lo || s->acct_session_id_hi != hi))
+		s = s->acct_hnext;
+	return s;
+}
+
+
 #ifdef CONFIG_P2P
 struct sta_info * ap_get_sta_p2p(struct hostapd_data *hapd, const u8 *addr)
 {
@@ -144,6 +158,31 @@ static void ap_sta_hash_del(struct hostapd_data *hapd, struct sta_info *sta)
 }
 
 
+static void ap_sta_acct_hash_add(struct hostapd_data *hapd,
+				 struct sta_info *sta)
+{
+	unsigned int idx = STA_ACCT_HASH(sta->acct_session_id_lo);
+
+	sta->acct_hnext = hapd->sta_acct_hash[idx];
+	hapd->sta_acct_hash[idx] = sta;
+}
+
+
+static void ap_sta_acct_hash_del(struct hostapd_data *hapd,
+				 struct sta_info *sta)
+{
+	struct sta_info **s;
+
+	for (s = &hapd->sta_acct_hash[STA_ACCT_HASH(sta->acct_session_id_lo)];
+	     *s; s = &(*s)->acct_hnext) {
+		if (*s == sta) {
+			*s = sta->acct_hnext;
+			return;
+		}
+	}
+}
+
+
 void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 {
 	int set_beacon = 0;
@@ -161,6 +200,7 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 		hostapd_drv_sta_remove(hapd, sta->addr);
 
 	ap_sta_hash_del(hapd, sta);
+	ap_sta_acct_hash_del(hapd, sta);
 	ap_sta_list_del(hapd, sta);
 
 	if (sta->aid > 0)
@@ -274,6 +314,10 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 	os_free(sta->hs20_session_info_url);
 
 #ifdef CONFIG_SAE
+	if (sta->sae_job && sae_job_cancel(sta->sae_job)) {
+		/* SAE data is freed by the worker pool */
+		sta->sae = NULL;
+	}
 	sae_clear_data(sta->sae);
 	os_free(sta->sae);
 #endif /* CONFIG_SAE */
@@ -591,6 +635,7 @@ struct sta_info * ap_sta_add(struct hostapd_data *hapd, const u8 *addr)
 	hapd->sta_list = sta;
 	hapd->num_sta++;
 	ap_sta_hash_add(hapd, sta);
+	ap_sta_acct_hash_add(hapd, sta);
 	sta->ssid = &hapd->conf->ssid;
 	ap_sta_remove_in_other_bss(hapd, sta);
 
@@ -82,6 +82,7 @@ struct sta_info {
 
 	u32 acct_session_id_hi;
 	u32 acct_session_id_lo;
+	struct sta_info *acct_hnext; /* next entry in sta_acct_hash chain */
 	struct os_reltime acct_session_start;
 	int acct_session_started;
 	int acct_terminate_cause; /* Acct-Terminate-Cause */
@@ -140,6 +141,7 @@ struct sta_info {
 
 #ifdef CONFIG_SAE
 	struct sae_data *sae;
+	struct sae_job *sae_job; /* pending commit processing in a worker */
 #endif /* CONFIG_SAE */
 };
 
@@ -169,6 +171,8 @@ int ap_for_each_sta(struct hostapd_data *hapd,
 struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta);
 struct sta_info * ap_get_sta_p2p(struct hostapd_data *hapd, const u8 *addr);
 void ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta);
+struct sta_info * ap_get_sta_acct_session(struct hostapd_data *hapd,
+					  u32 hi, u32 lo);
 void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta);
 void hostapd_free_stas(struct hostapd_data *hapd);
 void ap_handle_timer(void *eloop_ctx, void *timeout_ctx);
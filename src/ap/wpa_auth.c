@@ -1828,6 +1828,98 @@ static int wpa_derive_ptk(struct wpa_state_machine *sm, const u8 *pmk,
 }
 
 
+#define WPA_PSK_MIC_MULTI 8
+
+/*
+ * Find the PSK that matches the Key MIC in EAPOL-Key msg 2/4 by trying
+ * WPA_PSK_MIC_MULTI PSKs at a time. Only the KCK is derived for each PSK and
+ * both the KCK derivation and the Key MIC are computed for all the PSKs
+ * together with the multi-message HMAC-SHA1 functions. This is used when
+ * more than one PSK is configured for the station and the Key MIC uses
+ * HMAC-SHA1 with the SHA-1 based PRF.
+ */
+static const u8 * wpa_find_psk_multi(struct wpa_state_machine *sm)
+{
+	const u8 *pmk[WPA_PSK_MIC_MULTI], *prev = NULL, *found = NULL;
+	u8 kck_buf[WPA_PSK_MIC_MULTI][SHA1_MAC_LEN];
+	u8 mic_buf[WPA_PSK_MIC_MULTI][SHA1_MAC_LEN];
+	u8 *kck[WPA_PSK_MIC_MULTI], *mic[WPA_PSK_MIC_MULTI];
+	const u8 *key_addr[WPA_PSK_MIC_MULTI], *data[WPA_PSK_MIC_MULTI];
+	size_t key_len[WPA_PSK_MIC_MULTI], data_len[WPA_PSK_MIC_MULTI];
+	struct wpa_eapol_key *key;
+	u8 rx_mic[16];
+	size_t i, num;
+
+	if (sm->last_rx_eapol_key_len <
+	    sizeof(struct ieee802_1x_hdr) + sizeof(*key))
+		return NULL;
+	key = (struct wpa_eapol_key *)
+		(sm->last_rx_eapol_key + sizeof(struct ieee802_1x_hdr));
+	os_memcpy(rx_mic, key->key_mic, 16);
+	os_memset(key->key_mic, 0, 16);
+
+	for (i = 0; i < WPA_PSK_MIC_MULTI; i++) {
+		kck[i] = kck_buf[i];
+		mic[i] = mic_buf[i];
+		key_addr[i] = kck_buf[i];
+		key_len[i] = 16;
+		data[i] = sm->last_rx_eapol_key;
+		data_len[i] = sm->last_rx_eapol_key_len;
+	}
+
+	do {
+		for (num = 0; num < WPA_PSK_MIC_MULTI; num++) {
+			prev = wpa_auth_get_psk(sm->wpa_auth, sm->addr,
+						sm->p2p_dev_addr, prev);
+			if (prev == NULL)
+				break;
+			pmk[num] = prev;
+		}
+		if (num == 0 ||
+		    wpa_pmk_to_kck_multi(pmk, PMK_LEN, num,
+					 "Pairwise key expansion",
+					 sm->wpa_auth->addr, sm->addr,
+					 sm->ANonce, sm->SNonce, kck) ||
+		    hmac_sha1_multi(key_addr, key_len, data, data_len, mic,
+				    num))
+			break;
+		for (i = 0; i < num; i++) {
+			if (os_memcmp(mic[i], rx_mic, 16) == 0) {
+				found = pmk[i];
+				break;
+			}
+		}
+	} while (!found && prev);
+
+	os_memcpy(key->key_mic, rx_mic, 16);
+	os_memset(kck_buf, 0, sizeof(kck_buf));
+	return found;
+}
+
+
+static int wpa_use_psk_multi(struct wpa_state_machine *sm)
+{
+	const struct wpa_eapol_key *key;
+	const u8 *psk;
+
+	if (!wpa_key_mgmt_wpa_psk(sm->wpa_key_mgmt) ||
+	    wpa_key_mgmt_ft(sm->wpa_key_mgmt) ||
+	    wpa_key_mgmt_sha256(sm->wpa_key_mgmt) ||
+	    sm->last_rx_eapol_key_len <
+	    sizeof(struct ieee802_1x_hdr) + sizeof(*key))
+		return 0;
+	key = (const struct wpa_eapol_key *)
+		(sm->last_rx_eapol_key + sizeof(struct ieee802_1x_hdr));
+	if ((WPA_GET_BE16(key->key_info) & WPA_KEY_INFO_TYPE_MASK) !=
+	    WPA_KEY_INFO_TYPE_HMAC_SHA1_AES)
+		return 0;
+
+	psk = wpa_auth_get_psk(sm->wpa_auth, sm->addr, sm->p2p_dev_addr, NULL);
+	return psk && wpa_auth_get_psk(sm->wpa_auth, sm->addr,
+				       sm->p2p_dev_addr, psk);
+}
+
+
 SM_STATE(WPA_PTK, PTKCALCNEGOTIATING)
 {
 	struct wpa_ptk PTK;
@@ -1838,28 +1930,37 @@ SM_STATE(WPA_PTK, PTKCALCNEGOTIATING)
 	sm->EAPOLKeyReceived = FALSE;
 	sm->update_snonce = FALSE;
 
-	/* WPA with IEEE 802.1X: use the derived PMK from EAP
-	 * WPA-PSK: iterate through possible PSKs and select the one matching
-	 * the packet */
-	for (;;) {
-		if (wpa_key_mgmt_wpa_psk(sm->wpa_key_mgmt)) {
-			pmk = wpa_auth_get_psk(sm->wpa_auth, sm->addr,
-					       sm->p2p_dev_addr, pmk);
-			if (pmk == NULL)
-				break;
-		} else
-			pmk = sm->PMK;
-
-		wpa_derive_ptk(sm, pmk, &PTK);
-
-		if (wpa_verify_key_mic(&PTK, sm->last_rx_eapol_key,
-				       sm->last_rx_eapol_key_len) == 0) {
+	if (wpa_use_psk_multi(sm)) {
+		pmk = wpa_find_psk_multi(sm);
+		if (pmk) {
+			wpa_derive_ptk(sm, pmk, &PTK);
 			ok = 1;
-			break;
 		}
+	} else {
+		/* WPA with IEEE 802.1X: use the derived PMK from EAP
+		 * WPA-PSK: iterate through possible PSKs and select the one
+		 * matching the packet */
+		for (;;) {
+			if (wpa_key_mgmt_wpa_psk(sm->wpa_key_mgmt)) {
+				pmk = wpa_auth_get_psk(sm->wpa_auth, sm->addr,
+						       sm->p2p_dev_addr, pmk);
+				if (pmk == NULL)
+					break;
+			} else
+				pmk = sm->PMK;
+
+			wpa_derive_ptk(sm, pmk, &PTK);
+
+			if (wpa_verify_key_mic(&PTK, sm->last_rx_eapol_key,
+					       sm->last_rx_eapol_key_len)
+			    == 0) {
+				ok = 1;
+				break;
+			}
 
-		if (!wpa_key_mgmt_wpa_psk(sm->wpa_key_mgmt))
-			break;
+			if (!wpa_key_mgmt_wpa_psk(sm->wpa_key_mgmt))
+				break;
+		}
 	}
 
 	if (!ok) {
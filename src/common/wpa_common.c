@@ -71,6 +71,29 @@ int wpa_eapol_key_mic(const u8 *key, int ver, const u8 *buf, size_t len,
 }
 
 
+static void wpa_pmk_to_ptk_data(const u8 *addr1, const u8 *addr2,
+				const u8 *nonce1, const u8 *nonce2, u8 *data)
+{
+	if (os_memcmp(addr1, addr2, ETH_ALEN) < 0) {
+		os_memcpy(data, addr1, ETH_ALEN);
+		os_memcpy(data + ETH_ALEN, addr2, ETH_ALEN);
+	} else {
+		os_memcpy(data, addr2, ETH_ALEN);
+		os_memcpy(data + ETH_ALEN, addr1, ETH_ALEN);
+	}
+
+	if (os_memcmp(nonce1, nonce2, WPA_NONCE_LEN) < 0) {
+		os_memcpy(data + 2 * ETH_ALEN, nonce1, WPA_NONCE_LEN);
+		os_memcpy(data + 2 * ETH_ALEN + WPA_NONCE_LEN, nonce2,
+			  WPA_NONCE_LEN);
+	} else {
+		os_memcpy(data + 2 * ETH_ALEN, nonce2, WPA_NONCE_LEN);
+		os_memcpy(data + 2 * ETH_ALEN + WPA_NONCE_LEN, nonce1,
+			  WPA_NONCE_LEN);
+	}
+}
+
+
 /**
  * wpa_pmk_to_ptk - Calculate PTK from PMK, addresses, and nonces
  * @pmk: Pairwise master key
@@ -100,23 +123,7 @@ void wpa_pmk_to_ptk(const u8 *pmk, size_t pmk_len, const char *label,
 {
 	u8 data[2 * ETH_ALEN + 2 * WPA_NONCE_LEN];
 
-	if (os_memcmp(addr1, addr2, ETH_ALEN) < 0) {
-		os_memcpy(data, addr1, ETH_ALEN);
-		os_memcpy(data + ETH_ALEN, addr2, ETH_ALEN);
-	} else {
-		os_memcpy(data, addr2, ETH_ALEN);
-		os_memcpy(data + ETH_ALEN, addr1, ETH_ALEN);
-	}
-
-	if (os_memcmp(nonce1, nonce2, WPA_NONCE_LEN) < 0) {
-		os_memcpy(data + 2 * ETH_ALEN, nonce1, WPA_NONCE_LEN);
-		os_memcpy(data + 2 * ETH_ALEN + WPA_NONCE_LEN, nonce2,
-			  WPA_NONCE_LEN);
-	} else {
-		os_memcpy(data + 2 * ETH_ALEN, nonce2, WPA_NONCE_LEN);
-		os_memcpy(data + 2 * ETH_ALEN + WPA_NONCE_LEN, nonce1,
-			  WPA_NONCE_LEN);
-	}
+	wpa_pmk_to_ptk_data(addr1, addr2, nonce1, nonce2, data);
 
 #ifdef CONFIG_IEEE80211W
 	if (use_sha256)
@@ -136,6 +143,60 @@ void wpa_pmk_to_ptk(const u8 *pmk, size_t pmk_len, const char *label,
 }
 
 
+#define WPA_KCK_MULTI 8
+
+/**
+ * wpa_pmk_to_kck_multi - Calculate the start of the PTK for multiple PMKs
+ * @pmk: Array of num pairwise master keys
+ * @pmk_len: Length of each PMK
+ * @num: Number of PMKs
+ * @label: Label to use in derivation
+ * @addr1: AA or SA
+ * @addr2: SA or AA
+ * @nonce1: ANonce or SNonce
+ * @nonce2: SNonce or ANonce
+ * @kck: Array of num buffers for the first SHA1_MAC_LEN octets of the PTK
+ * Returns: 0 on success, -1 on failure
+ *
+ * This is the first iteration of the SHA-1 based PRF used in
+ * wpa_pmk_to_ptk() for each of the PMKs, i.e., it derives the KCK that is
+ * needed for validating the Key MIC in EAPOL-Key msg 2/4. The PMKs are
+ * processed together with hmac_sha1_multi(), so that a large number of PSKs
+ * can be tried for a received frame without deriving the full PTK for each.
+ */
+int wpa_pmk_to_kck_multi(const u8 *pmk[], size_t pmk_len, size_t num,
+			 const char *label, const u8 *addr1, const u8 *addr2,
+			 const u8 *nonce1, const u8 *nonce2, u8 *kck[])
+{
+	u8 data[100 + 1 + 2 * ETH_ALEN + 2 * WPA_NONCE_LEN + 1];
+	size_t label_len = os_strlen(label) + 1;
+	const u8 *addr[WPA_KCK_MULTI];
+	size_t key_len[WPA_KCK_MULTI], len[WPA_KCK_MULTI];
+	size_t i, n;
+
+	if (label_len > 100)
+		return -1;
+
+	/* label || 0 || Min(AA, SA) || ... || counter (0) */
+	os_memcpy(data, label, label_len);
+	wpa_pmk_to_ptk_data(addr1, addr2, nonce1, nonce2, data + label_len);
+	data[label_len + 2 * ETH_ALEN + 2 * WPA_NONCE_LEN] = 0;
+	for (i = 0; i < WPA_KCK_MULTI; i++) {
+		addr[i] = data;
+		len[i] = label_len + 2 * ETH_ALEN + 2 * WPA_NONCE_LEN + 1;
+		key_len[i] = pmk_len;
+	}
+
+	for (i = 0; i < num; i += n) {
+		n = num - i < WPA_KCK_MULTI ? num - i : WPA_KCK_MULTI;
+		if (hmac_sha1_multi(&pmk[i], key_len, addr, len, &kck[i], n))
+			return -1;
+	}
+
+	return 0;
+}
+
+
 #ifdef CONFIG_IEEE80211R
 int wpa_ft_mic(const u8 *kck, const u8 *sta_addr, const u8 *ap_addr,
 	       u8 transaction_seqnum, const u8 *mdie, size_t mdie_len,
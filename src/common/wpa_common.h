@@ -335,6 +335,9 @@ void wpa_pmk_to_ptk(const u8 *pmk, size_t pmk_len, const char *label,
 		    const u8 *addr1, const u8 *addr2,
 		    const u8 *nonce1, const u8 *nonce2,
 		    u8 *ptk, size_t ptk_len, int use_sha256);
+int wpa_pmk_to_kck_multi(const u8 *pmk[], size_t pmk_len, size_t num,
+			 const char *label, const u8 *addr1, const u8 *addr2,
+			 const u8 *nonce1, const u8 *nonce2, u8 *kck[]);
 
 #ifdef CONFIG_IEEE80211R
 int wpa_ft_mic(const u8 *kck, const u8 *sta_addr, const u8 *ap_addr,
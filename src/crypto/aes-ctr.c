@@ -1,5 +1,5 @@
 /*
- * AES-128 CTR
+ * AES CTR
  *
  * Copyright (c) 2003-2007, Jouni Malinen <j@w1.fi>
  *
@@ -13,43 +13,72 @@
 #include "aes.h"
 #include "aes_wrap.h"
 
+/* Number of counter blocks encrypted with a single aes_encrypt_blocks() call */
+#define AES_CTR_BATCH 8
+
 /**
- * aes_128_ctr_encrypt - AES-128 CTR mode encryption
- * @key: Key for encryption (16 bytes)
+ * aes_ctr_encrypt - AES CTR mode encryption
+ * @key: Key for encryption (key_len bytes)
+ * @key_len: Length of the key in bytes (16, 24, or 32)
  * @nonce: Nonce for counter mode (16 bytes)
  * @data: Data to encrypt in-place
  * @data_len: Length of data in bytes
  * Returns: 0 on success, -1 on failure
  */
-int aes_128_ctr_encrypt(const u8 *key, const u8 *nonce,
-			u8 *data, size_t data_len)
+int aes_ctr_encrypt(const u8 *key, size_t key_len, const u8 *nonce,
+		    u8 *data, size_t data_len)
 {
 	void *ctx;
-	size_t j, len, left = data_len;
+	size_t j, k, len, left = data_len, blocks;
 	int i;
 	u8 *pos = data;
-	u8 counter[AES_BLOCK_SIZE], buf[AES_BLOCK_SIZE];
+	u8 counter[AES_BLOCK_SIZE];
+	u8 cb[AES_CTR_BATCH * AES_BLOCK_SIZE], buf[AES_CTR_BATCH * AES_BLOCK_SIZE];
 
-	ctx = aes_encrypt_init(key, 16);
+	ctx = aes_encrypt_init(key, key_len);
 	if (ctx == NULL)
 		return -1;
 	os_memcpy(counter, nonce, AES_BLOCK_SIZE);
 
 	while (left > 0) {
-		aes_encrypt(ctx, counter, buf);
+		blocks = (left + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+		if (blocks > AES_CTR_BATCH)
+			blocks = AES_CTR_BATCH;
+		for (k = 0; k < blocks; k++) {
+			os_memcpy(&cb[k * AES_BLOCK_SIZE], counter,
+				  AES_BLOCK_SIZE);
+			for (i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
+				counter[i]++;
+				if (counter[i])
+					break;
+			}
+		}
+		aes_encrypt_blocks(ctx, cb, buf, blocks);
 
-		len = (left < AES_BLOCK_SIZE) ? left : AES_BLOCK_SIZE;
+		len = blocks * AES_BLOCK_SIZE;
+		if (len > left)
+			len = left;
 		for (j = 0; j < len; j++)
 			pos[j] ^= buf[j];
 		pos += len;
 		left -= len;
-
-		for (i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
-			counter[i]++;
-			if (counter[i])
-				break;
-		}
 	}
 	aes_encrypt_deinit(ctx);
+	os_memset(buf, 0, sizeof(buf));
 	return 0;
 }
+
+
+/**
+ * aes_128_ctr_encrypt - AES-128 CTR mode encryption
+ * @key: Key for encryption (16 bytes)
+ * @nonce: Nonce for counter mode (16 bytes)
+ * @data: Data to encrypt in-place
+ * @data_len: Length of data in bytes
+ * Returns: 0 on success, -1 on failure
+ */
+int aes_128_ctr_encrypt(const u8 *key, const u8 *nonce,
+			u8 *data, size_t data_len)
+{
+	return aes_ctr_encrypt(key, 16, nonce, data, data_len);
+}
@@ -33,63 +33,386 @@ static void xor_block(u8 *dst, const u8 *src)
 }
 
 
-static void shift_right_block(u8 *v)
+/*
+ * GHASH uses carry-less multiplication instructions (x86 PCLMULQDQ or ARMv8
+ * PMULL) when the CPU supports them and a 4-bit table (Shoup's method)
+ * otherwise.
+ */
+#if defined(__GNUC__) && !defined(CONFIG_NO_AES_HW) && \
+	(defined(__x86_64__) || defined(__i386__) || \
+	 (defined(__aarch64__) && defined(__linux__) && !defined(__clang__)))
+#define GHASH_HW
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#define GHASH_HW_X86
+#else /* x86 */
+#include <arm_neon.h>
+#define GHASH_HW_ARM
+#endif /* x86 */
+#endif /* __GNUC__ */
+
+#define GHASH_HW_BLOCKS 4
+
+struct ghash_key {
+	u64 htable[16][2]; /* i * H for 4-bit i, as {high, low} 64 bits */
+	int hw;
+	/* H^1..H^4 in the byte order used by ghash_hw_blocks() */
+	u8 hpow[GHASH_HW_BLOCKS][16];
+};
+
+
+/* Reduction constants for the four bits shifted out of Z per step */
+static const u64 ghash_rem_4bit[16] = {
+	0x0000ULL << 48, 0x1C20ULL << 48, 0x3840ULL << 48, 0x2460ULL << 48,
+	0x7080ULL << 48, 0x6CA0ULL << 48, 0x48C0ULL << 48, 0x54E0ULL << 48,
+	0xE100ULL << 48, 0xFD20ULL << 48, 0xD940ULL << 48, 0xC560ULL << 48,
+	0x9180ULL << 48, 0x8DA0ULL << 48, 0xA9C0ULL << 48, 0xB5E0ULL << 48
+};
+
+
+static void ghash_init_4bit(u64 htable[16][2], const u8 *h)
 {
-	u32 val;
+	u64 hi, lo, t;
+	int i, j;
 
-	val = WPA_GET_BE32(v + 12);
-	val >>= 1;
-	if (v[11] & 0x01)
-		val |= 0x80000000;
-	WPA_PUT_BE32(v + 12, val);
-
-	val = WPA_GET_BE32(v + 8);
-	val >>= 1;
-	if (v[7] & 0x01)
-		val |= 0x80000000;
-	WPA_PUT_BE32(v + 8, val);
-
-	val = WPA_GET_BE32(v + 4);
-	val >>= 1;
-	if (v[3] & 0x01)
-		val |= 0x80000000;
-	WPA_PUT_BE32(v + 4, val);
-
-	val = WPA_GET_BE32(v);
-	val >>= 1;
-	WPA_PUT_BE32(v, val);
+	os_memset(htable[0], 0, sizeof(htable[0]));
+	hi = WPA_GET_BE64(h);
+	lo = WPA_GET_BE64(h + 8);
+	htable[8][0] = hi;
+	htable[8][1] = lo;
+
+	/* htable[4], htable[2], htable[1] = H * x, H * x^2, H * x^3 */
+	for (i = 4; i > 0; i >>= 1) {
+		t = 0xe100000000000000ULL & (0 - (lo & 1));
+		lo = (hi << 63) | (lo >> 1);
+		hi = (hi >> 1) ^ t;
+		htable[i][0] = hi;
+		htable[i][1] = lo;
+	}
+
+	for (i = 2; i < 16; i <<= 1) {
+		for (j = 1; j < i; j++) {
+			htable[i + j][0] = htable[i][0] ^ htable[j][0];
+			htable[i + j][1] = htable[i][1] ^ htable[j][1];
+		}
+	}
 }
 
 
-/* Multiplication in GF(2^128) */
-static void gf_mult(const u8 *x, const u8 *y, u8 *z)
+/* Y = Y dot H */
+static void ghash_gmult_4bit(u8 *y, u64 htable[16][2])
 {
-	u8 v[16];
-	int i, j;
+	u64 zhi, zlo;
+	unsigned int rem, nlo, nhi;
+	int cnt = 15;
+
+	nlo = y[15];
+	nhi = nlo >> 4;
+	nlo &= 0xf;
+	zhi = htable[nlo][0];
+	zlo = htable[nlo][1];
+
+	for (;;) {
+		rem = zlo & 0xf;
+		zlo = (zhi << 60) | (zlo >> 4);
+		zhi = (zhi >> 4) ^ ghash_rem_4bit[rem];
+		zhi ^= htable[nhi][0];
+		zlo ^= htable[nhi][1];
+
+		if (--cnt < 0)
+			break;
+
+		nlo = y[cnt];
+		nhi = nlo >> 4;
+		nlo &= 0xf;
+
+		rem = zlo & 0xf;
+		zlo = (zhi << 60) | (zlo >> 4);
+		zhi = (zhi >> 4) ^ ghash_rem_4bit[rem];
+		zhi ^= htable[nlo][0];
+		zlo ^= htable[nlo][1];
+	}
 
-	os_memset(z, 0, 16); /* Z_0 = 0^128 */
-	os_memcpy(v, y, 16); /* V_0 = Y */
-
-	for (i = 0; i < 16; i++) {
-		for (j = 0; j < 8; j++) {
-			if (x[i] & BIT(7 - j)) {
-				/* Z_(i + 1) = Z_i XOR V_i */
-				xor_block(z, v);
-			} else {
-				/* Z_(i + 1) = Z_i */
-			}
-
-			if (v[15] & 0x01) {
-				/* V_(i + 1) = (V_i >> 1) XOR R */
-				shift_right_block(v);
-				/* R = 11100001 || 0^120 */
-				v[0] ^= 0xe1;
-			} else {
-				/* V_(i + 1) = V_i >> 1 */
-				shift_right_block(v);
-			}
-		}
+	WPA_PUT_BE64(y, zhi);
+	WPA_PUT_BE64(y + 8, zlo);
+}
+
+
+#ifdef GHASH_HW
+
+/*
+ * The carry-less multiplication follows Intel's "Carry-Less Multiplication
+ * Instruction and its Usage for Computing the GCM Mode" white paper:
+ * operands are byte-reflected, the 256-bit product is shifted left by one bit
+ * and reduced modulo x^128 + x^7 + x^2 + x + 1. The reduction is linear, so
+ * the products of GHASH_HW_BLOCKS blocks with H^4..H^1 are summed and reduced
+ * once.
+ */
+
+/* Cleared by tests to benchmark the 4-bit table on capable CPUs */
+static int ghash_hw_enabled = 1;
+
+
+static int ghash_hw_available(void)
+{
+	return (cpu_features() & CPU_FEATURE_CLMUL) && ghash_hw_enabled;
+}
+
+
+#ifdef GHASH_HW_X86
+
+#define GHASH_TARGET __attribute__((target("pclmul,ssse3,sse2")))
+
+typedef __m128i ghash_vec;
+
+#define ghash_load(p) _mm_loadu_si128((const __m128i *) (p))
+#define ghash_store(p, v) _mm_storeu_si128((__m128i *) (p), (v))
+#define ghash_xor(a, b) _mm_xor_si128((a), (b))
+
+GHASH_TARGET static inline ghash_vec ghash_bswap(ghash_vec x)
+{
+	return _mm_shuffle_epi8(x, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+						10, 11, 12, 13, 14, 15));
+}
+
+
+GHASH_TARGET static inline void ghash_clmul(ghash_vec a, ghash_vec b,
+					    ghash_vec *lo, ghash_vec *hi)
+{
+	ghash_vec t0, t1, t2, t3;
+
+	t0 = _mm_clmulepi64_si128(a, b, 0x00);
+	t1 = _mm_clmulepi64_si128(a, b, 0x10);
+	t2 = _mm_clmulepi64_si128(a, b, 0x01);
+	t3 = _mm_clmulepi64_si128(a, b, 0x11);
+	t1 = _mm_xor_si128(t1, t2);
+	*lo = _mm_xor_si128(t0, _mm_slli_si128(t1, 8));
+	*hi = _mm_xor_si128(t3, _mm_srli_si128(t1, 8));
+}
+
+
+GHASH_TARGET static inline ghash_vec ghash_reduce(ghash_vec lo, ghash_vec hi)
+{
+	ghash_vec t2, t4, t5, t7, t8, t9;
+
+	/* Shift the 256-bit product hi:lo left by one bit */
+	t7 = _mm_srli_epi32(lo, 31);
+	t8 = _mm_srli_epi32(hi, 31);
+	lo = _mm_slli_epi32(lo, 1);
+	hi = _mm_slli_epi32(hi, 1);
+	t9 = _mm_srli_si128(t7, 12);
+	t8 = _mm_slli_si128(t8, 4);
+	t7 = _mm_slli_si128(t7, 4);
+	lo = _mm_or_si128(lo, t7);
+	hi = _mm_or_si128(hi, t8);
+	hi = _mm_or_si128(hi, t9);
+
+	/* Reduce */
+	t7 = _mm_slli_epi32(lo, 31);
+	t8 = _mm_slli_epi32(lo, 30);
+	t9 = _mm_slli_epi32(lo, 25);
+	t7 = _mm_xor_si128(t7, t8);
+	t7 = _mm_xor_si128(t7, t9);
+	t8 = _mm_srli_si128(t7, 4);
+	t7 = _mm_slli_si128(t7, 12);
+	lo = _mm_xor_si128(lo, t7);
+	t2 = _mm_srli_epi32(lo, 1);
+	t4 = _mm_srli_epi32(lo, 2);
+	t5 = _mm_srli_epi32(lo, 7);
+	t2 = _mm_xor_si128(t2, t4);
+	t2 = _mm_xor_si128(t2, t5);
+	t2 = _mm_xor_si128(t2, t8);
+	lo = _mm_xor_si128(lo, t2);
+	return _mm_xor_si128(hi, lo);
+}
+
+#endif /* GHASH_HW_X86 */
+
+
+#ifdef GHASH_HW_ARM
+
+#define GHASH_TARGET __attribute__((target("+crypto")))
+
+typedef uint8x16_t ghash_vec;
+
+#define ghash_load(p) vld1q_u8(p)
+#define ghash_store(p, v) vst1q_u8((p), (v))
+#define ghash_xor(a, b) veorq_u8((a), (b))
+/* Equivalents of the SSE2 byte shifts and 32-bit lane shifts */
+#define ghash_zero vdupq_n_u8(0)
+#define ghash_slli_bytes(x, n) vextq_u8(ghash_zero, (x), 16 - (n))
+#define ghash_srli_bytes(x, n) vextq_u8((x), ghash_zero, (n))
+#define ghash_slli32(x, n) \
+	vreinterpretq_u8_u32(vshlq_n_u32(vreinterpretq_u32_u8(x), (n)))
+#define ghash_srli32(x, n) \
+	vreinterpretq_u8_u32(vshrq_n_u32(vreinterpretq_u32_u8(x), (n)))
+
+GHASH_TARGET static inline ghash_vec ghash_bswap(ghash_vec x)
+{
+	x = vrev64q_u8(x);
+	return vextq_u8(x, x, 8);
+}
+
+
+GHASH_TARGET static inline ghash_vec ghash_pmull(ghash_vec a, int ai,
+						 ghash_vec b, int bi)
+{
+	poly64_t pa, pb;
+
+	pa = (poly64_t) vgetq_lane_u64(vreinterpretq_u64_u8(a), 0);
+	if (ai)
+		pa = (poly64_t) vgetq_lane_u64(vreinterpretq_u64_u8(a), 1);
+	pb = (poly64_t) vgetq_lane_u64(vreinterpretq_u64_u8(b), 0);
+	if (bi)
+		pb = (poly64_t) vgetq_lane_u64(vreinterpretq_u64_u8(b), 1);
+	return vreinterpretq_u8_p128(vmull_p64(pa, pb));
+}
+
+
+GHASH_TARGET static inline void ghash_clmul(ghash_vec a, ghash_vec b,
+					    ghash_vec *lo, ghash_vec *hi)
+{
+	ghash_vec t0, t1, t2, t3;
+
+	t0 = ghash_pmull(a, 0, b, 0);
+	t1 = ghash_pmull(a, 0, b, 1);
+	t2 = ghash_pmull(a, 1, b, 0);
+	t3 = ghash_pmull(a, 1, b, 1);
+	t1 = veorq_u8(t1, t2);
+	*lo = veorq_u8(t0, ghash_slli_bytes(t1, 8));
+	*hi = veorq_u8(t3, ghash_srli_bytes(t1, 8));
+}
+
+
+GHASH_TARGET static inline ghash_vec ghash_reduce(ghash_vec lo, ghash_vec hi)
+{
+	ghash_vec t2, t4, t5, t7, t8, t9;
+
+	/* Shift the 256-bit product hi:lo left by one bit */
+	t7 = ghash_srli32(lo, 31);
+	t8 = ghash_srli32(hi, 31);
+	lo = ghash_slli32(lo, 1);
+	hi = ghash_slli32(hi, 1);
+	t9 = ghash_srli_bytes(t7, 12);
+	t8 = ghash_slli_bytes(t8, 4);
+	t7 = ghash_slli_bytes(t7, 4);
+	lo = vorrq_u8(lo, t7);
+	hi = vorrq_u8(hi, t8);
+	hi = vorrq_u8(hi, t9);
+
+	/* Reduce */
+	t7 = ghash_slli32(lo, 31);
+	t8 = ghash_slli32(lo, 30);
+	t9 = ghash_slli32(lo, 25);
+	t7 = veorq_u8(t7, t8);
+	t7 = veorq_u8(t7, t9);
+	t8 = ghash_srli_bytes(t7, 4);
+	t7 = ghash_slli_bytes(t7, 12);
+	lo = veorq_u8(lo, t7);
+	t2 = ghash_srli32(lo, 1);
+	t4 = ghash_srli32(lo, 2);
+	t5 = ghash_srli32(lo, 7);
+	t2 = veorq_u8(t2, t4);
+	t2 = veorq_u8(t2, t5);
+	t2 = veorq_u8(t2, t8);
+	lo = veorq_u8(lo, t2);
+	return veorq_u8(hi, lo);
+}
+
+#endif /* GHASH_HW_ARM */
+
+
+GHASH_TARGET static void ghash_hw_init(const u8 *h,
+				       u8 hpow[GHASH_HW_BLOCKS][16])
+{
+	ghash_vec h1, hn, lo, hi;
+	int i;
+
+	h1 = ghash_bswap(ghash_load(h));
+	hn = h1;
+	ghash_store(hpow[0], h1);
+	for (i = 1; i < GHASH_HW_BLOCKS; i++) {
+		ghash_clmul(hn, h1, &lo, &hi);
+		hn = ghash_reduce(lo, hi);
+		ghash_store(hpow[i], hn);
+	}
+}
+
+
+GHASH_TARGET static void ghash_hw_blocks(u8 hpow[GHASH_HW_BLOCKS][16],
+					 u8 *y, const u8 *x, size_t blocks)
+{
+	ghash_vec h1, h2, h3, h4, yv, lo, hi, l, h;
+
+	h1 = ghash_load(hpow[0]);
+	h2 = ghash_load(hpow[1]);
+	h3 = ghash_load(hpow[2]);
+	h4 = ghash_load(hpow[3]);
+	yv = ghash_bswap(ghash_load(y));
+
+	/* Y = (Y ^ X1) H^4 ^ X2 H^3 ^ X3 H^2 ^ X4 H */
+	for (; blocks >= GHASH_HW_BLOCKS; blocks -= GHASH_HW_BLOCKS) {
+		yv = ghash_xor(yv, ghash_bswap(ghash_load(x)));
+		ghash_clmul(yv, h4, &lo, &hi);
+		ghash_clmul(ghash_bswap(ghash_load(x + 16)), h3, &l, &h);
+		lo = ghash_xor(lo, l);
+		hi = ghash_xor(hi, h);
+		ghash_clmul(ghash_bswap(ghash_load(x + 32)), h2, &l, &h);
+		lo = ghash_xor(lo, l);
+		hi = ghash_xor(hi, h);
+		ghash_clmul(ghash_bswap(ghash_load(x + 48)), h1, &l, &h);
+		lo = ghash_xor(lo, l);
+		hi = ghash_xor(hi, h);
+		yv = ghash_reduce(lo, hi);
+		x += 16 * GHASH_HW_BLOCKS;
+	}
+
+	for (; blocks > 0; blocks--) {
+		yv = ghash_xor(yv, ghash_bswap(ghash_load(x)));
+		ghash_clmul(yv, h1, &lo, &hi);
+		yv = ghash_reduce(lo, hi);
+		x += 16;
 	}
+
+	ghash_store(y, ghash_bswap(yv));
+}
+
+#else /* GHASH_HW */
+
+static int ghash_hw_available(void)
+{
+	return 0;
+}
+
+
+static void ghash_hw_init(const u8 *h, u8 hpow[GHASH_HW_BLOCKS][16])
+{
+}
+
+
+static void ghash_hw_blocks(u8 hpow[GHASH_HW_BLOCKS][16],
+			    u8 *y, const u8 *x, size_t blocks)
+{
+}
+
+#endif /* GHASH_HW */
+
+
+static void ghash_init(struct ghash_key *key, const u8 *h)
+{
+	key->hw = ghash_hw_available();
+	if (key->hw)
+		ghash_hw_init(h, key->hpow);
+	else
+		ghash_init_4bit(key->htable, h);
+}
+
+
+static void ghash_deinit(struct ghash_key *key)
+{
+	os_memset(key, 0, sizeof(*key));
 }
 
 
@@ -100,7 +423,7 @@ static void ghash_start(u8 *y)
 }
 
 
-static void ghash(const u8 *h, const u8 *x, size_t xlen, u8 *y)
+static void ghash(struct ghash_key *key, const u8 *x, size_t xlen, u8 *y)
 {
 	size_t m, i;
 	const u8 *xpos = x;
@@ -108,16 +431,20 @@ static void ghash(const u8 *h, const u8 *x, size_t xlen, u8 *y)
 
 	m = xlen / 16;
 
-	for (i = 0; i < m; i++) {
-		/* Y_i = (Y^(i-1) XOR X_i) dot H */
-		xor_block(y, xpos);
-		xpos += 16;
-
-		/* dot operation:
-		 * multiplication operation for binary Galois (finite) field of
-		 * 2^128 elements */
-		gf_mult(y, h, tmp);
-		os_memcpy(y, tmp, 16);
+	if (key->hw) {
+		ghash_hw_blocks(key->hpow, y, xpos, m);
+		xpos += m * 16;
+	} else {
+		for (i = 0; i < m; i++) {
+			/* Y_i = (Y^(i-1) XOR X_i) dot H */
+			xor_block(y, xpos);
+			xpos += 16;
+
+			/* dot operation:
+			 * multiplication operation for binary Galois (finite)
+			 * field of 2^128 elements */
+			ghash_gmult_4bit(y, key->htable);
+		}
 	}
 
 	if (x + xlen > xpos) {
@@ -126,24 +453,27 @@ static void ghash(const u8 *h, const u8 *x, size_t xlen, u8 *y)
 		os_memcpy(tmp, xpos, last);
 		os_memset(tmp + last, 0, sizeof(tmp) - last);
 
-		/* Y_i = (Y^(i-1) XOR X_i) dot H */
-		xor_block(y, tmp);
-
-		/* dot operation:
-		 * multiplication operation for binary Galois (finite) field of
-		 * 2^128 elements */
-		gf_mult(y, h, tmp);
-		os_memcpy(y, tmp, 16);
+		if (key->hw) {
+			ghash_hw_blocks(key->hpow, y, tmp, 1);
+		} else {
+			/* Y_i = (Y^(i-1) XOR X_i) dot H */
+			xor_block(y, tmp);
+			ghash_gmult_4bit(y, key->htable);
+		}
 	}
 
 	/* Return Y_m */
 }
 
 
+/* Number of counter blocks encrypted with a single aes_encrypt_blocks() call */
+#define AES_GCTR_BATCH 8
+
 static void aes_gctr(void *aes, const u8 *icb, const u8 *x, size_t xlen, u8 *y)
 {
-	size_t i, n, last;
+	size_t i, j, n, last, blocks;
 	u8 cb[AES_BLOCK_SIZE], tmp[AES_BLOCK_SIZE];
+	u8 cbs[AES_GCTR_BATCH * AES_BLOCK_SIZE];
 	const u8 *xpos = x;
 	u8 *ypos = y;
 
@@ -154,12 +484,20 @@ static void aes_gctr(void *aes, const u8 *icb, const u8 *x, size_t xlen, u8 *y)
 
 	os_memcpy(cb, icb, AES_BLOCK_SIZE);
 	/* Full blocks */
-	for (i = 0; i < n; i++) {
-		aes_encrypt(aes, cb, ypos);
-		xor_block(ypos, xpos);
-		xpos += AES_BLOCK_SIZE;
-		ypos += AES_BLOCK_SIZE;
-		inc32(cb);
+	for (i = 0; i < n; i += blocks) {
+		blocks = n - i;
+		if (blocks > AES_GCTR_BATCH)
+			blocks = AES_GCTR_BATCH;
+		for (j = 0; j < blocks; j++) {
+			os_memcpy(&cbs[j * AES_BLOCK_SIZE], cb, AES_BLOCK_SIZE);
+			inc32(cb);
+		}
+		aes_encrypt_blocks(aes, cbs, ypos, blocks);
+		for (j = 0; j < blocks; j++) {
+			xor_block(ypos, xpos);
+			xpos += AES_BLOCK_SIZE;
+			ypos += AES_BLOCK_SIZE;
+		}
 	}
 
 	last = x + xlen - xpos;
@@ -189,7 +527,8 @@ static void * aes_gcm_init_hash_subkey(const u8 *key, size_t key_len, u8 *H)
 }
 
 
-static void aes_gcm_prepare_j0(const u8 *iv, size_t iv_len, const u8 *H, u8 *J0)
+static void aes_gcm_prepare_j0(const u8 *iv, size_t iv_len,
+			       struct ghash_key *gh, u8 *J0)
 {
 	u8 len_buf[16];
 
@@ -204,30 +543,59 @@ static void aes_gcm_prepare_j0(const u8 *iv, size_t iv_len, const u8 *H, u8 *J0)
 		 * J_0 = GHASH_H(IV || 0^(s+64) || [len(IV)]_64)
 		 */
 		ghash_start(J0);
-		ghash(H, iv, iv_len, J0);
+		ghash(gh, iv, iv_len, J0);
 		WPA_PUT_BE64(len_buf, 0);
 		WPA_PUT_BE64(len_buf + 8, iv_len * 8);
-		ghash(H, len_buf, sizeof(len_buf), J0);
+		ghash(gh, len_buf, sizeof(len_buf), J0);
 	}
 }
 
 
-static void aes_gcm_gctr(void *aes, const u8 *J0, const u8 *in, size_t len,
-			 u8 *out)
+/*
+ * GCTR_K(inc_32(J_0), in) interleaved with GHASH over the ciphertext so that
+ * each batch of blocks is hashed while still in the cache. The ciphertext is
+ * the output when encrypting and the input when decrypting; the latter is
+ * hashed before the output is written to allow in-place decryption.
+ */
+static void aes_gcm_gctr_ghash(void *aes, struct ghash_key *gh, const u8 *J0,
+			       const u8 *in, size_t len, u8 *out, u8 *S,
+			       int encrypt)
 {
-	u8 J0inc[AES_BLOCK_SIZE];
-
-	if (len == 0)
-		return;
+	u8 cb[AES_BLOCK_SIZE];
+	u8 cbs[AES_GCTR_BATCH * AES_BLOCK_SIZE];
+	u8 ks[AES_GCTR_BATCH * AES_BLOCK_SIZE];
+	size_t i, j, chunk, blocks;
+
+	os_memcpy(cb, J0, AES_BLOCK_SIZE);
+	inc32(cb);
+
+	while (len > 0) {
+		chunk = len < sizeof(ks) ? len : sizeof(ks);
+		blocks = (chunk + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+		for (j = 0; j < blocks; j++) {
+			os_memcpy(&cbs[j * AES_BLOCK_SIZE], cb, AES_BLOCK_SIZE);
+			inc32(cb);
+		}
+		aes_encrypt_blocks(aes, cbs, ks, blocks);
+
+		if (!encrypt)
+			ghash(gh, in, chunk, S);
+		for (i = 0; i < chunk; i++)
+			out[i] = in[i] ^ ks[i];
+		if (encrypt)
+			ghash(gh, out, chunk, S);
+
+		in += chunk;
+		out += chunk;
+		len -= chunk;
+	}
 
-	os_memcpy(J0inc, J0, AES_BLOCK_SIZE);
-	inc32(J0inc);
-	aes_gctr(aes, J0inc, in, len, out);
+	os_memset(ks, 0, sizeof(ks));
 }
 
 
-static void aes_gcm_ghash(const u8 *H, const u8 *aad, size_t aad_len,
-			  const u8 *crypt, size_t crypt_len, u8 *S)
+static void aes_gcm_ghash_len(struct ghash_key *gh, size_t aad_len,
+			      size_t crypt_len, u8 *S)
 {
 	u8 len_buf[16];
 
@@ -237,12 +605,9 @@ static void aes_gcm_ghash(const u8 *H, const u8 *aad, size_t aad_len,
 	 * S = GHASH_H(A || 0^v || C || 0^u || [len(A)]64 || [len(C)]64)
 	 * (i.e., zero padded to block size A || C and lengths of each in bits)
 	 */
-	ghash_start(S);
-	ghash(H, aad, aad_len, S);
-	ghash(H, crypt, crypt_len, S);
 	WPA_PUT_BE64(len_buf, aad_len * 8);
 	WPA_PUT_BE64(len_buf + 8, crypt_len * 8);
-	ghash(H, len_buf, sizeof(len_buf), S);
+	ghash(gh, len_buf, sizeof(len_buf), S);
 
 	wpa_hexdump_key(MSG_EXCESSIVE, "S = GHASH_H(...)", S, 16);
 }
@@ -258,18 +623,23 @@ int aes_gcm_ae(const u8 *key, size_t key_len, const u8 *iv, size_t iv_len,
 	u8 H[AES_BLOCK_SIZE];
 	u8 J0[AES_BLOCK_SIZE];
 	u8 S[16];
+	struct ghash_key gh;
 	void *aes;
 
 	aes = aes_gcm_init_hash_subkey(key, key_len, H);
 	if (aes == NULL)
 		return -1;
+	ghash_init(&gh, H);
 
-	aes_gcm_prepare_j0(iv, iv_len, H, J0);
+	aes_gcm_prepare_j0(iv, iv_len, &gh, J0);
+
+	ghash_start(S);
+	ghash(&gh, aad, aad_len, S);
 
 	/* C = GCTR_K(inc_32(J_0), P) */
-	aes_gcm_gctr(aes, J0, plain, plain_len, crypt);
+	aes_gcm_gctr_ghash(aes, &gh, J0, plain, plain_len, crypt, S, 1);
 
-	aes_gcm_ghash(H, aad, aad_len, crypt, plain_len, S);
+	aes_gcm_ghash_len(&gh, aad_len, plain_len, S);
 
 	/* T = MSB_t(GCTR_K(J_0, S)) */
 	aes_gctr(aes, J0, S, sizeof(S), tag);
@@ -277,6 +647,8 @@ int aes_gcm_ae(const u8 *key, size_t key_len, const u8 *iv, size_t iv_len,
 	/* Return (C, T) */
 
 	aes_encrypt_deinit(aes);
+	ghash_deinit(&gh);
+	os_memset(H, 0, sizeof(H));
 
 	return 0;
 }
@@ -292,23 +664,30 @@ int aes_gcm_ad(const u8 *key, size_t key_len, const u8 *iv, size_t iv_len,
 	u8 H[AES_BLOCK_SIZE];
 	u8 J0[AES_BLOCK_SIZE];
 	u8 S[16], T[16];
+	struct ghash_key gh;
 	void *aes;
 
 	aes = aes_gcm_init_hash_subkey(key, key_len, H);
 	if (aes == NULL)
 		return -1;
+	ghash_init(&gh, H);
+
+	aes_gcm_prepare_j0(iv, iv_len, &gh, J0);
 
-	aes_gcm_prepare_j0(iv, iv_len, H, J0);
+	ghash_start(S);
+	ghash(&gh, aad, aad_len, S);
 
 	/* P = GCTR_K(inc_32(J_0), C) */
-	aes_gcm_gctr(aes, J0, crypt, crypt_len, plain);
+	aes_gcm_gctr_ghash(aes, &gh, J0, crypt, crypt_len, plain, S, 0);
 
-	aes_gcm_ghash(H, aad, aad_len, crypt, crypt_len, S);
+	aes_gcm_ghash_len(&gh, aad_len, crypt_len, S);
 
 	/* T' = MSB_t(GCTR_K(J_0, S)) */
 	aes_gctr(aes, J0, S, sizeof(S), T);
 
 	aes_encrypt_deinit(aes);
+	ghash_deinit(&gh);
+	os_memset(H, 0, sizeof(H));
 
 	if (os_memcmp(tag, T, 16) != 0) {
 		wpa_printf(MSG_EXCESSIVE, "GCM: Tag mismatch");
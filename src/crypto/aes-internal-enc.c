@@ -108,6 +108,7 @@ void * aes_encrypt_init(const u8 *key, size_t len)
 		return NULL;
 	}
 	rk[AES_PRIV_NR_POS] = res;
+	rk[AES_PRIV_HW_POS] = aes_hw_setup(rk, res);
 	return rk;
 }
 
@@ -115,7 +116,29 @@ void * aes_encrypt_init(const u8 *key, size_t len)
 void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 {
 	u32 *rk = ctx;
-	rijndaelEncrypt(ctx, rk[AES_PRIV_NR_POS], plain, crypt);
+	if (rk[AES_PRIV_HW_POS])
+		aes_hw_encrypt(rk, rk[AES_PRIV_NR_POS], plain, crypt, 1);
+	else
+		rijndaelEncrypt(ctx, rk[AES_PRIV_NR_POS], plain, crypt);
+}
+
+
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt,
+			size_t num_blocks)
+{
+	u32 *rk = ctx;
+
+	if (rk[AES_PRIV_HW_POS]) {
+		aes_hw_encrypt(rk, rk[AES_PRIV_NR_POS], plain, crypt,
+			       num_blocks);
+		return;
+	}
+
+	while (num_blocks--) {
+		rijndaelEncrypt(ctx, rk[AES_PRIV_NR_POS], plain, crypt);
+		plain += AES_BLOCK_SIZE;
+		crypt += AES_BLOCK_SIZE;
+	}
 }
 
 
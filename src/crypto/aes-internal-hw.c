@@ -0,0 +1,240 @@
+/*
+ * AES (Rijndael) cipher - CPU instruction based implementation
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * The AES instructions in x86 (AES-NI) and ARMv8 (Cryptography Extensions)
+ * CPUs are used when available at run time. They are both faster than the
+ * table based implementation and free of cache timing side channels. The
+ * instructions are enabled per function with the target attribute, so the
+ * rest of the build does not need to be compiled for these CPU features.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "aes_i.h"
+
+#ifdef AES_HW
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#define AES_HW_X86
+#else /* x86 */
+#include <arm_neon.h>
+#define AES_HW_ARM
+#endif /* x86 */
+
+
+static int aes_hw_enabled = 1;
+
+
+/**
+ * aes_hw_enable - Allow or prevent use of AES instructions for new keys
+ * @enabled: Whether AES instructions are used when supported by the CPU
+ *
+ * This is mainly for testing and benchmarking the table based implementation
+ * on CPUs that support the AES instructions.
+ */
+void aes_hw_enable(int enabled)
+{
+	aes_hw_enabled = enabled;
+}
+
+
+int aes_hw_setup(u32 rk[], int Nr)
+{
+	int i;
+	u32 val;
+
+	if (!(cpu_features() & CPU_FEATURE_AES) || !aes_hw_enabled)
+		return 0;
+
+	/* Store the round keys as byte strings */
+	for (i = 0; i < 4 * (Nr + 1); i++) {
+		val = rk[i];
+		PUTU32((u8 *) &rk[i], val);
+	}
+
+	return 1;
+}
+
+
+#ifdef AES_HW_X86
+
+__attribute__((target("aes,sse2")))
+void aes_hw_encrypt(const u32 rk[], int Nr, const u8 *in, u8 *out,
+		    size_t num_blocks)
+{
+	__m128i k[15], b0, b1, b2, b3;
+	int i;
+
+	for (i = 0; i <= Nr; i++)
+		k[i] = _mm_loadu_si128((const __m128i *) &rk[4 * i]);
+
+	/* Interleave four blocks to hide the AESENC latency */
+	for (; num_blocks >= 4; num_blocks -= 4) {
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in), k[0]);
+		b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (in + 16)),
+				   k[0]);
+		b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (in + 32)),
+				   k[0]);
+		b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (in + 48)),
+				   k[0]);
+		for (i = 1; i < Nr; i++) {
+			b0 = _mm_aesenc_si128(b0, k[i]);
+			b1 = _mm_aesenc_si128(b1, k[i]);
+			b2 = _mm_aesenc_si128(b2, k[i]);
+			b3 = _mm_aesenc_si128(b3, k[i]);
+		}
+		_mm_storeu_si128((__m128i *) out,
+				 _mm_aesenclast_si128(b0, k[Nr]));
+		_mm_storeu_si128((__m128i *) (out + 16),
+				 _mm_aesenclast_si128(b1, k[Nr]));
+		_mm_storeu_si128((__m128i *) (out + 32),
+				 _mm_aesenclast_si128(b2, k[Nr]));
+		_mm_storeu_si128((__m128i *) (out + 48),
+				 _mm_aesenclast_si128(b3, k[Nr]));
+		in += 64;
+		out += 64;
+	}
+
+	for (; num_blocks > 0; num_blocks--) {
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in), k[0]);
+		for (i = 1; i < Nr; i++)
+			b0 = _mm_aesenc_si128(b0, k[i]);
+		_mm_storeu_si128((__m128i *) out,
+				 _mm_aesenclast_si128(b0, k[Nr]));
+		in += 16;
+		out += 16;
+	}
+}
+
+
+__attribute__((target("aes,sse2")))
+void aes_hw_decrypt(const u32 rk[], int Nr, const u8 *in, u8 *out,
+		    size_t num_blocks)
+{
+	__m128i k[15], b0, b1, b2, b3;
+	int i;
+
+	for (i = 0; i <= Nr; i++)
+		k[i] = _mm_loadu_si128((const __m128i *) &rk[4 * i]);
+
+	for (; num_blocks >= 4; num_blocks -= 4) {
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in), k[0]);
+		b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (in + 16)),
+				   k[0]);
+		b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (in + 32)),
+				   k[0]);
+		b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (in + 48)),
+				   k[0]);
+		for (i = 1; i < Nr; i++) {
+			b0 = _mm_aesdec_si128(b0, k[i]);
+			b1 = _mm_aesdec_si128(b1, k[i]);
+			b2 = _mm_aesdec_si128(b2, k[i]);
+			b3 = _mm_aesdec_si128(b3, k[i]);
+		}
+		_mm_storeu_si128((__m128i *) out,
+				 _mm_aesdeclast_si128(b0, k[Nr]));
+		_mm_storeu_si128((__m128i *) (out + 16),
+				 _mm_aesdeclast_si128(b1, k[Nr]));
+		_mm_storeu_si128((__m128i *) (out + 32),
+				 _mm_aesdeclast_si128(b2, k[Nr]));
+		_mm_storeu_si128((__m128i *) (out + 48),
+				 _mm_aesdeclast_si128(b3, k[Nr]));
+		in += 64;
+		out += 64;
+	}
+
+	for (; num_blocks > 0; num_blocks--) {
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in), k[0]);
+		for (i = 1; i < Nr; i++)
+			b0 = _mm_aesdec_si128(b0, k[i]);
+		_mm_storeu_si128((__m128i *) out,
+				 _mm_aesdeclast_si128(b0, k[Nr]));
+		in += 16;
+		out += 16;
+	}
+}
+
+#endif /* AES_HW_X86 */
+
+
+#ifdef AES_HW_ARM
+
+/*
+ * AESE/AESD include the AddRoundKey step before SubBytes/ShiftRows, so the
+ * round keys are used one step earlier than with AES-NI and the last round
+ * key is added separately.
+ */
+
+__attribute__((target("+crypto")))
+void aes_hw_encrypt(const u32 rk[], int Nr, const u8 *in, u8 *out,
+		    size_t num_blocks)
+{
+	uint8x16_t k[15], b0, b1;
+	int i;
+
+	for (i = 0; i <= Nr; i++)
+		k[i] = vld1q_u8((const u8 *) &rk[4 * i]);
+
+	for (; num_blocks >= 2; num_blocks -= 2) {
+		b0 = vld1q_u8(in);
+		b1 = vld1q_u8(in + 16);
+		for (i = 0; i < Nr - 1; i++) {
+			b0 = vaesmcq_u8(vaeseq_u8(b0, k[i]));
+			b1 = vaesmcq_u8(vaeseq_u8(b1, k[i]));
+		}
+		vst1q_u8(out, veorq_u8(vaeseq_u8(b0, k[Nr - 1]), k[Nr]));
+		vst1q_u8(out + 16, veorq_u8(vaeseq_u8(b1, k[Nr - 1]), k[Nr]));
+		in += 32;
+		out += 32;
+	}
+
+	if (num_blocks) {
+		b0 = vld1q_u8(in);
+		for (i = 0; i < Nr - 1; i++)
+			b0 = vaesmcq_u8(vaeseq_u8(b0, k[i]));
+		vst1q_u8(out, veorq_u8(vaeseq_u8(b0, k[Nr - 1]), k[Nr]));
+	}
+}
+
+
+__attribute__((target("+crypto")))
+void aes_hw_decrypt(const u32 rk[], int Nr, const u8 *in, u8 *out,
+		    size_t num_blocks)
+{
+	uint8x16_t k[15], b0, b1;
+	int i;
+
+	for (i = 0; i <= Nr; i++)
+		k[i] = vld1q_u8((const u8 *) &rk[4 * i]);
+
+	for (; num_blocks >= 2; num_blocks -= 2) {
+		b0 = vld1q_u8(in);
+		b1 = vld1q_u8(in + 16);
+		for (i = 0; i < Nr - 1; i++) {
+			b0 = vaesimcq_u8(vaesdq_u8(b0, k[i]));
+			b1 = vaesimcq_u8(vaesdq_u8(b1, k[i]));
+		}
+		vst1q_u8(out, veorq_u8(vaesdq_u8(b0, k[Nr - 1]), k[Nr]));
+		vst1q_u8(out + 16, veorq_u8(vaesdq_u8(b1, k[Nr - 1]), k[Nr]));
+		in += 32;
+		out += 32;
+	}
+
+	if (num_blocks) {
+		b0 = vld1q_u8(in);
+		for (i = 0; i < Nr - 1; i++)
+			b0 = vaesimcq_u8(vaesdq_u8(b0, k[i]));
+		vst1q_u8(out, veorq_u8(vaesdq_u8(b0, k[Nr - 1]), k[Nr]));
+	}
+}
+
+#endif /* AES_HW_ARM */
+
+#endif /* AES_HW */
@@ -13,6 +13,8 @@
 
 void * aes_encrypt_init(const u8 *key, size_t len);
 void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt);
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt,
+			size_t num_blocks);
 void aes_encrypt_deinit(void *ctx);
 void * aes_decrypt_init(const u8 *key, size_t len);
 void aes_decrypt(void *ctx, const u8 *crypt, u8 *plain);
@@ -117,9 +117,55 @@ static inline u32 rotr(u32 val, int bits)
 (ct)[2] = (u8)((st) >>  8); (ct)[3] = (u8)(st); }
 #endif
 
-#define AES_PRIV_SIZE (4 * 4 * 15 + 4)
+#define AES_PRIV_SIZE (4 * 4 * 15 + 4 * 2)
 #define AES_PRIV_NR_POS (4 * 15)
+#define AES_PRIV_HW_POS (4 * 15 + 1)
 
 int rijndaelKeySetupEnc(u32 rk[], const u8 cipherKey[], int keyBits);
 
+#if defined(__GNUC__) && !defined(CONFIG_NO_AES_HW) && \
+	(defined(__x86_64__) || defined(__i386__) || \
+	 (defined(__aarch64__) && defined(__linux__) && !defined(__clang__)))
+#define AES_HW
+#endif
+
+#ifdef AES_HW
+
+/*
+ * AES instructions (x86 AES-NI or ARMv8 Cryptography Extensions) are used
+ * when the CPU supports them. aes_hw_setup() converts a key schedule from
+ * rijndaelKeySetupEnc() (or the equivalent inverse cipher schedule used for
+ * decryption) into the byte order used by the AES instructions and returns 1
+ * if the instructions are to be used for this key.
+ */
+int aes_hw_setup(u32 rk[], int Nr);
+void aes_hw_encrypt(const u32 rk[], int Nr, const u8 *in, u8 *out,
+		    size_t num_blocks);
+void aes_hw_decrypt(const u32 rk[], int Nr, const u8 *in, u8 *out,
+		    size_t num_blocks);
+void aes_hw_enable(int enabled);
+
+#else /* AES_HW */
+
+static inline int aes_hw_setup(u32 rk[], int Nr)
+{
+	return 0;
+}
+
+static inline void aes_hw_encrypt(const u32 rk[], int Nr, const u8 *in,
+				  u8 *out, size_t num_blocks)
+{
+}
+
+static inline void aes_hw_decrypt(const u32 rk[], int Nr, const u8 *in,
+				  u8 *out, size_t num_blocks)
+{
+}
+
+static inline void aes_hw_enable(int enabled)
+{
+}
+
+#endif /* AES_HW */
+
 #endif /* AES_I_H */
@@ -400,11 +400,33 @@ int __must_check crypto_global_init(void);
  * crypto_global_deinit - Deinitialize crypto wrapper
  *
  * This function is only used with internal TLSv1 implementation
- * (CONFIG_TLS=internal). If that is not used, the crypto wrapper does not need
- * to implement this.
+ * (CONFIG_TLS=internal) and with OpenSSL (CONFIG_TLS=openssl). If those are not
+ * used, the crypto wrapper does not need to implement this.
  */
 void crypto_global_deinit(void);
 
+/**
+ * crypto_threads_init - Prepare crypto wrapper for use from multiple threads
+ * Returns: 0 on success, -1 if concurrent use is not supported
+ *
+ * This function needs to be called from the main thread before any of the
+ * crypto wrapper functions are called from other threads. It is only used
+ * with CONFIG_SAE_WORKERS=y and the crypto wrappers that do not support SAE
+ * do not need to implement this.
+ */
+int crypto_threads_init(void);
+
+/**
+ * crypto_thread_deinit - Free per-thread state of the crypto wrapper
+ *
+ * Crypto wrappers may keep cached contexts for each thread. This function
+ * frees the ones of the calling thread. It needs to be called by worker
+ * threads (CONFIG_SAE_WORKERS=y and CONFIG_TLS_WORKERS=y) before they exit and
+ * it is called from crypto_global_deinit() for the main thread. Crypto
+ * wrappers without per-thread state implement this as an empty function.
+ */
+void crypto_thread_deinit(void);
+
 /**
  * crypto_mod_exp - Modular exponentiation of large integers
  * @base: Base integer (big endian byte array)
@@ -303,6 +303,17 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt,
+			size_t num_blocks)
+{
+	while (num_blocks--) {
+		aes_encrypt(ctx, plain, crypt);
+		plain += 16;
+		crypt += 16;
+	}
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 	struct aes_context *akey = ctx;
@@ -773,6 +784,11 @@ void crypto_global_deinit(void)
 }
 
 
+void crypto_thread_deinit(void)
+{
+}
+
+
 int crypto_mod_exp(const u8 *base, size_t base_len,
 		   const u8 *power, size_t power_len,
 		   const u8 *modulus, size_t modulus_len,
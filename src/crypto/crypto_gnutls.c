@@ -114,6 +114,15 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt,
+			size_t num_blocks)
+{
+	gcry_cipher_hd_t hd = ctx;
+	gcry_cipher_encrypt(hd, crypt, num_blocks * 16, plain,
+			    num_blocks * 16);
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 	gcry_cipher_hd_t hd = ctx;
@@ -297,3 +306,8 @@ void crypto_cipher_deinit(struct crypto_cipher *ctx)
 	gcry_cipher_close(ctx->dec);
 	os_free(ctx);
 }
+
+
+void crypto_thread_deinit(void)
+{
+}
@@ -273,3 +273,8 @@ int crypto_global_init(void)
 void crypto_global_deinit(void)
 {
 }
+
+
+void crypto_thread_deinit(void)
+{
+}
@@ -103,6 +103,18 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt,
+			size_t num_blocks)
+{
+	symmetric_key *skey = ctx;
+	while (num_blocks--) {
+		aes_ecb_encrypt(plain, crypt, skey);
+		plain += 16;
+		crypt += 16;
+	}
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 	symmetric_key *skey = ctx;
@@ -691,6 +703,11 @@ void crypto_global_deinit(void)
 }
 
 
+void crypto_thread_deinit(void)
+{
+}
+
+
 #ifdef CONFIG_MODEXP
 
 int crypto_mod_exp(const u8 *base, size_t base_len,
@@ -146,6 +146,12 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt,
+			size_t num_blocks)
+{
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 }
@@ -205,3 +211,8 @@ int crypto_cipher_decrypt(struct crypto_cipher *ctx, const u8 *crypt,
 void crypto_cipher_deinit(struct crypto_cipher *ctx)
 {
 }
+
+
+void crypto_thread_deinit(void)
+{
+}
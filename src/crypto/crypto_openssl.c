@@ -22,6 +22,9 @@
 #ifdef CONFIG_ECC
 #include <openssl/ec.h>
 #endif /* CONFIG_ECC */
+#ifdef CONFIG_SAE_WORKERS
+#include <pthread.h>
+#endif /* CONFIG_SAE_WORKERS */
 
 #include "common.h"
 #include "wpabuf.h"
@@ -78,29 +81,133 @@ static BIGNUM * get_group5_prime(void)
 #define NO_SHA256_WRAPPER
 #endif
 
-static int openssl_digest_vector(const EVP_MD *type, size_t num_elem,
-				 const u8 *addr[], const size_t *len, u8 *mac)
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+/* Compatibility wrappers for older versions that do not have the accessor
+ * functions for the structures that were made opaque in OpenSSL 1.1.0 */
+
+static int EVP_CIPHER_CTX_reset(EVP_CIPHER_CTX *ctx)
+{
+	return EVP_CIPHER_CTX_cleanup(ctx);
+}
+
+
+static HMAC_CTX * HMAC_CTX_new(void)
+{
+	HMAC_CTX *ctx;
+
+	ctx = os_zalloc(sizeof(*ctx));
+	if (ctx)
+		HMAC_CTX_init(ctx);
+	return ctx;
+}
+
+
+static void HMAC_CTX_free(HMAC_CTX *ctx)
+{
+	if (ctx == NULL)
+		return;
+	HMAC_CTX_cleanup(ctx);
+	os_free(ctx);
+}
+
+
+static int HMAC_CTX_reset(HMAC_CTX *ctx)
 {
-	EVP_MD_CTX ctx;
+	HMAC_CTX_cleanup(ctx);
+	HMAC_CTX_init(ctx);
+	return 1;
+}
+
+
+static int DH_set0_pqg(DH *dh, BIGNUM *p, BIGNUM *q, BIGNUM *g)
+{
+	dh->p = p;
+	dh->g = g;
+	return 1;
+}
+
+
+static void DH_get0_key(const DH *dh, const BIGNUM **pub_key,
+			const BIGNUM **priv_key)
+{
+	if (pub_key)
+		*pub_key = dh->pub_key;
+	if (priv_key)
+		*priv_key = dh->priv_key;
+}
+
+
+static int DH_set0_key(DH *dh, BIGNUM *pub_key, BIGNUM *priv_key)
+{
+	dh->pub_key = pub_key;
+	dh->priv_key = priv_key;
+	return 1;
+}
+#endif /* OpenSSL version < 1.1.0 */
+
+/*
+ * Digest, HMAC, and AES contexts are cached and reset for the next operation
+ * instead of being allocated and freed for every call. The cached contexts do
+ * not hold key material between calls. wpa_supplicant and hostapd process
+ * everything from a single eloop thread, but the cache is thread local when
+ * the compiler supports it so that the SAE and TLS worker threads do not end
+ * up sharing a context. Worker threads free their contexts with
+ * crypto_thread_deinit() before exiting.
+ */
+#if defined(__GNUC__) && !defined(CONFIG_NO_OPENSSL_CTX_CACHE_TLS)
+#define OPENSSL_CTX_CACHE __thread
+#else /* __GNUC__ */
+#define OPENSSL_CTX_CACHE
+#endif /* __GNUC__ */
+
+enum openssl_md_idx {
+	OPENSSL_MD_MD4,
+	OPENSSL_MD_MD5,
+	OPENSSL_MD_SHA1,
+	OPENSSL_MD_SHA256,
+	OPENSSL_MD_COUNT
+};
+
+static OPENSSL_CTX_CACHE EVP_MD_CTX *openssl_md_ctx[OPENSSL_MD_COUNT];
+
+
+static int openssl_digest_vector(enum openssl_md_idx idx, const EVP_MD *type,
+				 size_t num_elem, const u8 *addr[],
+				 const size_t *len, u8 *mac)
+{
+	EVP_MD_CTX *ctx;
 	size_t i;
 	unsigned int mac_len;
 
-	EVP_MD_CTX_init(&ctx);
-	if (!EVP_DigestInit_ex(&ctx, type, NULL)) {
+	/*
+	 * One context per digest algorithm is kept, so that
+	 * EVP_DigestInit_ex() can reuse the digest state buffer and only needs
+	 * to reset it. EVP_DigestFinal_ex() is used below since
+	 * EVP_DigestFinal() would release that buffer.
+	 */
+	ctx = openssl_md_ctx[idx];
+	if (ctx == NULL) {
+		ctx = EVP_MD_CTX_create();
+		if (ctx == NULL)
+			return -1;
+		openssl_md_ctx[idx] = ctx;
+	}
+
+	if (!EVP_DigestInit_ex(ctx, type, NULL)) {
 		wpa_printf(MSG_ERROR, "OpenSSL: EVP_DigestInit_ex failed: %s",
 			   ERR_error_string(ERR_get_error(), NULL));
 		return -1;
 	}
 	for (i = 0; i < num_elem; i++) {
-		if (!EVP_DigestUpdate(&ctx, addr[i], len[i])) {
+		if (!EVP_DigestUpdate(ctx, addr[i], len[i])) {
 			wpa_printf(MSG_ERROR, "OpenSSL: EVP_DigestUpdate "
 				   "failed: %s",
 				   ERR_error_string(ERR_get_error(), NULL));
 			return -1;
 		}
 	}
-	if (!EVP_DigestFinal(&ctx, mac, &mac_len)) {
-		wpa_printf(MSG_ERROR, "OpenSSL: EVP_DigestFinal failed: %s",
+	if (!EVP_DigestFinal_ex(ctx, mac, &mac_len)) {
+		wpa_printf(MSG_ERROR, "OpenSSL: EVP_DigestFinal_ex failed: %s",
 			   ERR_error_string(ERR_get_error(), NULL));
 		return -1;
 	}
@@ -111,7 +218,8 @@ static int openssl_digest_vector(const EVP_MD *type, size_t num_elem,
 
 int md4_vector(size_t num_elem, const u8 *addr[], const size_t *len, u8 *mac)
 {
-	return openssl_digest_vector(EVP_md4(), num_elem, addr, len, mac);
+	return openssl_digest_vector(OPENSSL_MD_MD4, EVP_md4(), num_elem, addr,
+				     len, mac);
 }
 
 
@@ -142,32 +250,33 @@ int rc4_skip(const u8 *key, size_t keylen, size_t skip,
 #ifdef OPENSSL_NO_RC4
 	return -1;
 #else /* OPENSSL_NO_RC4 */
-	EVP_CIPHER_CTX ctx;
+	EVP_CIPHER_CTX *ctx;
 	int outl;
 	int res = -1;
 	unsigned char skip_buf[16];
 
-	EVP_CIPHER_CTX_init(&ctx);
-	if (!EVP_CIPHER_CTX_set_padding(&ctx, 0) ||
-	    !EVP_CipherInit_ex(&ctx, EVP_rc4(), NULL, NULL, NULL, 1) ||
-	    !EVP_CIPHER_CTX_set_key_length(&ctx, keylen) ||
-	    !EVP_CipherInit_ex(&ctx, NULL, NULL, key, NULL, 1))
+	ctx = EVP_CIPHER_CTX_new();
+	if (ctx == NULL ||
+	    !EVP_CIPHER_CTX_set_padding(ctx, 0) ||
+	    !EVP_CipherInit_ex(ctx, EVP_rc4(), NULL, NULL, NULL, 1) ||
+	    !EVP_CIPHER_CTX_set_key_length(ctx, keylen) ||
+	    !EVP_CipherInit_ex(ctx, NULL, NULL, key, NULL, 1))
 		goto out;
 
 	while (skip >= sizeof(skip_buf)) {
 		size_t len = skip;
 		if (len > sizeof(skip_buf))
 			len = sizeof(skip_buf);
-		if (!EVP_CipherUpdate(&ctx, skip_buf, &outl, skip_buf, len))
+		if (!EVP_CipherUpdate(ctx, skip_buf, &outl, skip_buf, len))
 			goto out;
 		skip -= len;
 	}
 
-	if (EVP_CipherUpdate(&ctx, data, &outl, data, data_len))
+	if (EVP_CipherUpdate(ctx, data, &outl, data, data_len))
 		res = 0;
 
 out:
-	EVP_CIPHER_CTX_cleanup(&ctx);
+	EVP_CIPHER_CTX_free(ctx);
 	return res;
 #endif /* OPENSSL_NO_RC4 */
 }
@@ -175,13 +284,15 @@ out:
 
 int md5_vector(size_t num_elem, const u8 *addr[], const size_t *len, u8 *mac)
 {
-	return openssl_digest_vector(EVP_md5(), num_elem, addr, len, mac);
+	return openssl_digest_vector(OPENSSL_MD_MD5, EVP_md5(), num_elem, addr,
+				     len, mac);
 }
 
 
 int sha1_vector(size_t num_elem, const u8 *addr[], const size_t *len, u8 *mac)
 {
-	return openssl_digest_vector(EVP_sha1(), num_elem, addr, len, mac);
+	return openssl_digest_vector(OPENSSL_MD_SHA1, EVP_sha1(), num_elem,
+				     addr, len, mac);
 }
 
 
@@ -189,7 +300,8 @@ int sha1_vector(size_t num_elem, const u8 *addr[], const size_t *len, u8 *mac)
 int sha256_vector(size_t num_elem, const u8 *addr[], const size_t *len,
 		  u8 *mac)
 {
-	return openssl_digest_vector(EVP_sha256(), num_elem, addr, len, mac);
+	return openssl_digest_vector(OPENSSL_MD_SHA256, EVP_sha256(), num_elem,
+				     addr, len, mac);
 }
 #endif /* NO_SHA256_WRAPPER */
 
@@ -209,25 +321,71 @@ static const EVP_CIPHER * aes_get_evp_cipher(size_t keylen)
 }
 
 
+/*
+ * Released AES contexts are reset and kept for the next
+ * aes_{en,de}crypt_init() call instead of allocating a new EVP_CIPHER_CTX for
+ * each operation. EVP_CIPHER_CTX_reset() clears and frees the expanded key, so
+ * no key material is left in the cache.
+ */
+#define OPENSSL_AES_CTX_CACHE 4
+
+static OPENSSL_CTX_CACHE EVP_CIPHER_CTX *
+openssl_aes_ctx_cache[OPENSSL_AES_CTX_CACHE];
+
+
+static EVP_CIPHER_CTX * openssl_aes_ctx_get(const EVP_CIPHER *type,
+					    const u8 *key, int enc)
+{
+	EVP_CIPHER_CTX *ctx = NULL;
+	int i;
+
+	for (i = 0; i < OPENSSL_AES_CTX_CACHE; i++) {
+		if (openssl_aes_ctx_cache[i]) {
+			ctx = openssl_aes_ctx_cache[i];
+			openssl_aes_ctx_cache[i] = NULL;
+			break;
+		}
+	}
+
+	if (ctx == NULL) {
+		ctx = EVP_CIPHER_CTX_new();
+		if (ctx == NULL)
+			return NULL;
+	}
+	if (EVP_CipherInit_ex(ctx, type, NULL, key, NULL, enc) != 1) {
+		EVP_CIPHER_CTX_free(ctx);
+		return NULL;
+	}
+	EVP_CIPHER_CTX_set_padding(ctx, 0);
+	return ctx;
+}
+
+
+static void openssl_aes_ctx_put(EVP_CIPHER_CTX *ctx)
+{
+	int i;
+
+	EVP_CIPHER_CTX_reset(ctx);
+	for (i = 0; i < OPENSSL_AES_CTX_CACHE; i++) {
+		if (openssl_aes_ctx_cache[i] == NULL) {
+			openssl_aes_ctx_cache[i] = ctx;
+			return;
+		}
+	}
+
+	EVP_CIPHER_CTX_free(ctx);
+}
+
+
 void * aes_encrypt_init(const u8 *key, size_t len)
 {
-	EVP_CIPHER_CTX *ctx;
 	const EVP_CIPHER *type;
 
 	type = aes_get_evp_cipher(len);
 	if (type == NULL)
 		return NULL;
 
-	ctx = os_malloc(sizeof(*ctx));
-	if (ctx == NULL)
-		return NULL;
-	EVP_CIPHER_CTX_init(ctx);
-	if (EVP_EncryptInit_ex(ctx, type, NULL, key, NULL) != 1) {
-		os_free(ctx);
-		return NULL;
-	}
-	EVP_CIPHER_CTX_set_padding(ctx, 0);
-	return ctx;
+	return openssl_aes_ctx_get(type, key, 1);
 }
 
 
@@ -242,6 +400,19 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt,
+			size_t num_blocks)
+{
+	EVP_CIPHER_CTX *c = ctx;
+	int clen = num_blocks * AES_BLOCK_SIZE;
+	if (EVP_EncryptUpdate(c, crypt, &clen, plain,
+			      num_blocks * AES_BLOCK_SIZE) != 1) {
+		wpa_printf(MSG_ERROR, "OpenSSL: EVP_EncryptUpdate failed: %s",
+			   ERR_error_string(ERR_get_error(), NULL));
+	}
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 	EVP_CIPHER_CTX *c = ctx;
@@ -255,30 +426,19 @@ void aes_encrypt_deinit(void *ctx)
 		wpa_printf(MSG_ERROR, "OpenSSL: Unexpected padding length %d "
 			   "in AES encrypt", len);
 	}
-	EVP_CIPHER_CTX_cleanup(c);
-	os_free(c);
+	openssl_aes_ctx_put(c);
 }
 
 
 void * aes_decrypt_init(const u8 *key, size_t len)
 {
-	EVP_CIPHER_CTX *ctx;
 	const EVP_CIPHER *type;
 
 	type = aes_get_evp_cipher(len);
 	if (type == NULL)
 		return NULL;
 
-	ctx = os_malloc(sizeof(*ctx));
-	if (ctx == NULL)
-		return NULL;
-	EVP_CIPHER_CTX_init(ctx);
-	if (EVP_DecryptInit_ex(ctx, type, NULL, key, NULL) != 1) {
-		os_free(ctx);
-		return NULL;
-	}
-	EVP_CIPHER_CTX_set_padding(ctx, 0);
-	return ctx;
+	return openssl_aes_ctx_get(type, key, 0);
 }
 
 
@@ -306,8 +466,7 @@ void aes_decrypt_deinit(void *ctx)
 		wpa_printf(MSG_ERROR, "OpenSSL: Unexpected padding length %d "
 			   "in AES decrypt", len);
 	}
-	EVP_CIPHER_CTX_cleanup(c);
-	os_free(ctx);
+	openssl_aes_ctx_put(c);
 }
 
 
@@ -350,8 +509,8 @@ error:
 
 
 struct crypto_cipher {
-	EVP_CIPHER_CTX enc;
-	EVP_CIPHER_CTX dec;
+	EVP_CIPHER_CTX *enc;
+	EVP_CIPHER_CTX *dec;
 };
 
 
@@ -408,23 +567,25 @@ struct crypto_cipher * crypto_cipher_init(enum crypto_cipher_alg alg,
 		return NULL;
 	}
 
-	EVP_CIPHER_CTX_init(&ctx->enc);
-	EVP_CIPHER_CTX_set_padding(&ctx->enc, 0);
-	if (!EVP_EncryptInit_ex(&ctx->enc, cipher, NULL, NULL, NULL) ||
-	    !EVP_CIPHER_CTX_set_key_length(&ctx->enc, key_len) ||
-	    !EVP_EncryptInit_ex(&ctx->enc, NULL, NULL, key, iv)) {
-		EVP_CIPHER_CTX_cleanup(&ctx->enc);
+	ctx->enc = EVP_CIPHER_CTX_new();
+	if (ctx->enc == NULL ||
+	    !EVP_CIPHER_CTX_set_padding(ctx->enc, 0) ||
+	    !EVP_EncryptInit_ex(ctx->enc, cipher, NULL, NULL, NULL) ||
+	    !EVP_CIPHER_CTX_set_key_length(ctx->enc, key_len) ||
+	    !EVP_EncryptInit_ex(ctx->enc, NULL, NULL, key, iv)) {
+		EVP_CIPHER_CTX_free(ctx->enc);
 		os_free(ctx);
 		return NULL;
 	}
 
-	EVP_CIPHER_CTX_init(&ctx->dec);
-	EVP_CIPHER_CTX_set_padding(&ctx->dec, 0);
-	if (!EVP_DecryptInit_ex(&ctx->dec, cipher, NULL, NULL, NULL) ||
-	    !EVP_CIPHER_CTX_set_key_length(&ctx->dec, key_len) ||
-	    !EVP_DecryptInit_ex(&ctx->dec, NULL, NULL, key, iv)) {
-		EVP_CIPHER_CTX_cleanup(&ctx->enc);
-		EVP_CIPHER_CTX_cleanup(&ctx->dec);
+	ctx->dec = EVP_CIPHER_CTX_new();
+	if (ctx->dec == NULL ||
+	    !EVP_CIPHER_CTX_set_padding(ctx->dec, 0) ||
+	    !EVP_DecryptInit_ex(ctx->dec, cipher, NULL, NULL, NULL) ||
+	    !EVP_CIPHER_CTX_set_key_length(ctx->dec, key_len) ||
+	    !EVP_DecryptInit_ex(ctx->dec, NULL, NULL, key, iv)) {
+		EVP_CIPHER_CTX_free(ctx->enc);
+		EVP_CIPHER_CTX_free(ctx->dec);
 		os_free(ctx);
 		return NULL;
 	}
@@ -437,7 +598,7 @@ int crypto_cipher_encrypt(struct crypto_cipher *ctx, const u8 *plain,
 			  u8 *crypt, size_t len)
 {
 	int outl;
-	if (!EVP_EncryptUpdate(&ctx->enc, crypt, &outl, plain, len))
+	if (!EVP_EncryptUpdate(ctx->enc, crypt, &outl, plain, len))
 		return -1;
 	return 0;
 }
@@ -448,7 +609,7 @@ int crypto_cipher_decrypt(struct crypto_cipher *ctx, const u8 *crypt,
 {
 	int outl;
 	outl = len;
-	if (!EVP_DecryptUpdate(&ctx->dec, plain, &outl, crypt, len))
+	if (!EVP_DecryptUpdate(ctx->dec, plain, &outl, crypt, len))
 		return -1;
 	return 0;
 }
@@ -456,8 +617,8 @@ int crypto_cipher_decrypt(struct crypto_cipher *ctx, const u8 *crypt,
 
 void crypto_cipher_deinit(struct crypto_cipher *ctx)
 {
-	EVP_CIPHER_CTX_cleanup(&ctx->enc);
-	EVP_CIPHER_CTX_cleanup(&ctx->dec);
+	EVP_CIPHER_CTX_free(ctx->enc);
+	EVP_CIPHER_CTX_free(ctx->dec);
 	os_free(ctx);
 }
 
@@ -465,6 +626,8 @@ void crypto_cipher_deinit(struct crypto_cipher *ctx)
 void * dh5_init(struct wpabuf **priv, struct wpabuf **publ)
 {
 	DH *dh;
+	BIGNUM *p, *g;
+	const BIGNUM *pub_key, *priv_key;
 	struct wpabuf *pubkey = NULL, *privkey = NULL;
 	size_t publen, privlen;
 
@@ -475,28 +638,30 @@ void * dh5_init(struct wpabuf **priv, struct wpabuf **publ)
 	if (dh == NULL)
 		return NULL;
 
-	dh->g = BN_new();
-	if (dh->g == NULL || BN_set_word(dh->g, 2) != 1)
-		goto err;
-
-	dh->p = get_group5_prime();
-	if (dh->p == NULL)
+	g = BN_new();
+	p = get_group5_prime();
+	if (g == NULL || BN_set_word(g, 2) != 1 || p == NULL ||
+	    DH_set0_pqg(dh, p, NULL, g) != 1) {
+		BN_free(p);
+		BN_free(g);
 		goto err;
+	}
 
 	if (DH_generate_key(dh) != 1)
 		goto err;
 
-	publen = BN_num_bytes(dh->pub_key);
+	DH_get0_key(dh, &pub_key, &priv_key);
+	publen = BN_num_bytes(pub_key);
 	pubkey = wpabuf_alloc(publen);
 	if (pubkey == NULL)
 		goto err;
-	privlen = BN_num_bytes(dh->priv_key);
+	privlen = BN_num_bytes(priv_key);
 	privkey = wpabuf_alloc(privlen);
 	if (privkey == NULL)
 		goto err;
 
-	BN_bn2bin(dh->pub_key, wpabuf_put(pubkey, publen));
-	BN_bn2bin(dh->priv_key, wpabuf_put(privkey, privlen));
+	BN_bn2bin(pub_key, wpabuf_put(pubkey, publen));
+	BN_bn2bin(priv_key, wpabuf_put(privkey, privlen));
 
 	*priv = privkey;
 	*publ = pubkey;
@@ -513,26 +678,29 @@ err:
 void * dh5_init_fixed(const struct wpabuf *priv, const struct wpabuf *publ)
 {
 	DH *dh;
+	BIGNUM *p, *g, *pub_key, *priv_key;
 
 	dh = DH_new();
 	if (dh == NULL)
 		return NULL;
 
-	dh->g = BN_new();
-	if (dh->g == NULL || BN_set_word(dh->g, 2) != 1)
-		goto err;
-
-	dh->p = get_group5_prime();
-	if (dh->p == NULL)
-		goto err;
-
-	dh->priv_key = BN_bin2bn(wpabuf_head(priv), wpabuf_len(priv), NULL);
-	if (dh->priv_key == NULL)
+	g = BN_new();
+	p = get_group5_prime();
+	if (g == NULL || BN_set_word(g, 2) != 1 || p == NULL ||
+	    DH_set0_pqg(dh, p, NULL, g) != 1) {
+		BN_free(p);
+		BN_free(g);
 		goto err;
+	}
 
-	dh->pub_key = BN_bin2bn(wpabuf_head(publ), wpabuf_len(publ), NULL);
-	if (dh->pub_key == NULL)
+	priv_key = BN_bin2bn(wpabuf_head(priv), wpabuf_len(priv), NULL);
+	pub_key = BN_bin2bn(wpabuf_head(publ), wpabuf_len(publ), NULL);
+	if (priv_key == NULL || pub_key == NULL ||
+	    DH_set0_key(dh, pub_key, priv_key) != 1) {
+		BN_clear_free(priv_key);
+		BN_free(pub_key);
 		goto err;
+	}
 
 	if (DH_generate_key(dh) != 1)
 		goto err;
@@ -593,9 +761,16 @@ void dh5_free(void *ctx)
 
 
 struct crypto_hash {
-	HMAC_CTX ctx;
+	HMAC_CTX *ctx;
 };
 
+/*
+ * One released crypto_hash context is kept for the next crypto_hash_init()
+ * call to avoid the allocation. The keyed state is cleared when the context is
+ * released.
+ */
+static OPENSSL_CTX_CACHE struct crypto_hash *openssl_hash_spare;
+
 
 struct crypto_hash * crypto_hash_init(enum crypto_hash_alg alg, const u8 *key,
 				      size_t key_len)
@@ -625,15 +800,31 @@ struct crypto_hash * crypto_hash_init(enum crypto_hash_alg alg, const u8 *key,
 		return NULL;
 	}
 
-	ctx = os_zalloc(sizeof(*ctx));
-	if (ctx == NULL)
-		return NULL;
-	HMAC_CTX_init(&ctx->ctx);
+	if (key == NULL) {
+		/* NULL key would make HMAC_Init_ex() keep the previous key */
+		key = (const u8 *) "";
+		key_len = 0;
+	}
+
+	if (openssl_hash_spare) {
+		ctx = openssl_hash_spare;
+		openssl_hash_spare = NULL;
+	} else {
+		ctx = os_zalloc(sizeof(*ctx));
+		if (ctx == NULL)
+			return NULL;
+		ctx->ctx = HMAC_CTX_new();
+		if (ctx->ctx == NULL) {
+			os_free(ctx);
+			return NULL;
+		}
+	}
 
 #if OPENSSL_VERSION_NUMBER < 0x00909000
-	HMAC_Init_ex(&ctx->ctx, key, key_len, md, NULL);
+	HMAC_Init_ex(ctx->ctx, key, key_len, md, NULL);
 #else /* openssl < 0.9.9 */
-	if (HMAC_Init_ex(&ctx->ctx, key, key_len, md, NULL) != 1) {
+	if (HMAC_Init_ex(ctx->ctx, key, key_len, md, NULL) != 1) {
+		HMAC_CTX_free(ctx->ctx);
 		os_free(ctx);
 		return NULL;
 	}
@@ -643,11 +834,25 @@ struct crypto_hash * crypto_hash_init(enum crypto_hash_alg alg, const u8 *key,
 }
 
 
+static void crypto_hash_release(struct crypto_hash *ctx)
+{
+	/* Do not leave the keyed state behind in the spare context */
+	HMAC_CTX_reset(ctx->ctx);
+	if (openssl_hash_spare == NULL) {
+		openssl_hash_spare = ctx;
+		return;
+	}
+
+	HMAC_CTX_free(ctx->ctx);
+	os_free(ctx);
+}
+
+
 void crypto_hash_update(struct crypto_hash *ctx, const u8 *data, size_t len)
 {
 	if (ctx == NULL)
 		return;
-	HMAC_Update(&ctx->ctx, data, len);
+	HMAC_Update(ctx->ctx, data, len);
 }
 
 
@@ -660,19 +865,18 @@ int crypto_hash_finish(struct crypto_hash *ctx, u8 *mac, size_t *len)
 		return -2;
 
 	if (mac == NULL || len == NULL) {
-		os_free(ctx);
+		crypto_hash_release(ctx);
 		return 0;
 	}
 
 	mdlen = *len;
 #if OPENSSL_VERSION_NUMBER < 0x00909000
-	HMAC_Final(&ctx->ctx, mac, &mdlen);
+	HMAC_Final(ctx->ctx, mac, &mdlen);
 	res = 1;
 #else /* openssl < 0.9.9 */
-	res = HMAC_Final(&ctx->ctx, mac, &mdlen);
+	res = HMAC_Final(ctx->ctx, mac, &mdlen);
 #endif /* openssl < 0.9.9 */
-	HMAC_CTX_cleanup(&ctx->ctx);
-	os_free(ctx);
+	crypto_hash_release(ctx);
 
 	if (res == 1) {
 		*len = mdlen;
@@ -700,38 +904,82 @@ int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
 }
 
 
-int hmac_sha1_vector(const u8 *key, size_t key_len, size_t num_elem,
-		     const u8 *addr[], const size_t *len, u8 *mac)
+int pbkdf2_sha1_batch(const char *passphrase[], const u8 *ssid,
+		      size_t ssid_len, int iterations, u8 *buf[],
+		      size_t buflen, size_t num)
 {
-	HMAC_CTX ctx;
 	size_t i;
-	unsigned int mdlen;
+
+	/* PKCS5_PBKDF2_HMAC_SHA1() already reuses the HMAC key state */
+	for (i = 0; i < num; i++) {
+		if (pbkdf2_sha1(passphrase[i], ssid, ssid_len, iterations,
+				buf[i], buflen))
+			return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * One HMAC context per hash algorithm is kept for the HMAC vector functions
+ * to avoid allocating the HMAC context and its digest contexts for every
+ * call. The context is reset after each operation, so no keyed state is left
+ * behind in it.
+ */
+static OPENSSL_CTX_CACHE HMAC_CTX *openssl_hmac_ctx[OPENSSL_MD_COUNT];
+
+
+static int openssl_hmac_vector(enum openssl_md_idx idx, const EVP_MD *type,
+			       const u8 *key, size_t key_len, size_t num_elem,
+			       const u8 *addr[], const size_t *len, u8 *mac,
+			       unsigned int mdlen)
+{
+	HMAC_CTX *ctx;
+	size_t i;
 	int res;
 
-	HMAC_CTX_init(&ctx);
-#if OPENSSL_VERSION_NUMBER < 0x00909000
-	HMAC_Init_ex(&ctx, key, key_len, EVP_sha1(), NULL);
-#else /* openssl < 0.9.9 */
-	if (HMAC_Init_ex(&ctx, key, key_len, EVP_sha1(), NULL) != 1)
-		return -1;
-#endif /* openssl < 0.9.9 */
+	ctx = openssl_hmac_ctx[idx];
+	if (ctx == NULL) {
+		ctx = HMAC_CTX_new();
+		if (ctx == NULL)
+			return -1;
+		openssl_hmac_ctx[idx] = ctx;
+	}
 
-	for (i = 0; i < num_elem; i++)
-		HMAC_Update(&ctx, addr[i], len[i]);
+	if (key == NULL) {
+		/* NULL key would make HMAC_Init_ex() keep the previous key */
+		key = (const u8 *) "";
+		key_len = 0;
+	}
 
-	mdlen = 20;
 #if OPENSSL_VERSION_NUMBER < 0x00909000
-	HMAC_Final(&ctx, mac, &mdlen);
+	HMAC_Init_ex(ctx, key, key_len, type, NULL);
+	for (i = 0; i < num_elem; i++)
+		HMAC_Update(ctx, addr[i], len[i]);
+	HMAC_Final(ctx, mac, &mdlen);
 	res = 1;
 #else /* openssl < 0.9.9 */
-	res = HMAC_Final(&ctx, mac, &mdlen);
+	res = HMAC_Init_ex(ctx, key, key_len, type, NULL);
+	for (i = 0; res == 1 && i < num_elem; i++)
+		res = HMAC_Update(ctx, addr[i], len[i]);
+	if (res == 1)
+		res = HMAC_Final(ctx, mac, &mdlen);
 #endif /* openssl < 0.9.9 */
-	HMAC_CTX_cleanup(&ctx);
+	HMAC_CTX_reset(ctx);
 
 	return res == 1 ? 0 : -1;
 }
 
 
+int hmac_sha1_vector(const u8 *key, size_t key_len, size_t num_elem,
+		     const u8 *addr[], const size_t *len, u8 *mac)
+{
+	return openssl_hmac_vector(OPENSSL_MD_SHA1, EVP_sha1(), key, key_len,
+				   num_elem, addr, len, mac, 20);
+}
+
+
 int hmac_sha1(const u8 *key, size_t key_len, const u8 *data, size_t data_len,
 	       u8 *mac)
 {
@@ -739,47 +987,170 @@ int hmac_sha1(const u8 *key, size_t key_len, const u8 *data, size_t data_len,
 }
 
 
+int hmac_sha1_multi(const u8 *key[], const size_t *key_len, const u8 *data[],
+		    const size_t *data_len, u8 *mac[], size_t num)
+{
+	size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (hmac_sha1(key[i], key_len[i], data[i], data_len[i],
+			      mac[i]))
+			return -1;
+	}
+
+	return 0;
+}
+
+
 #ifdef CONFIG_SHA256
 
 int hmac_sha256_vector(const u8 *key, size_t key_len, size_t num_elem,
 		       const u8 *addr[], const size_t *len, u8 *mac)
 {
-	HMAC_CTX ctx;
+	return openssl_hmac_vector(OPENSSL_MD_SHA256, EVP_sha256(), key,
+				   key_len, num_elem, addr, len, mac, 32);
+}
+
+
+int hmac_sha256(const u8 *key, size_t key_len, const u8 *data,
+		size_t data_len, u8 *mac)
+{
+	return hmac_sha256_vector(key, key_len, 1, &data, &data_len, mac);
+}
+
+
+int hmac_sha256_multi(const u8 *key[], const size_t *key_len,
+		      const u8 *data[], const size_t *data_len, u8 *mac[],
+		      size_t num)
+{
 	size_t i;
-	unsigned int mdlen;
-	int res;
 
-	HMAC_CTX_init(&ctx);
-#if OPENSSL_VERSION_NUMBER < 0x00909000
-	HMAC_Init_ex(&ctx, key, key_len, EVP_sha256(), NULL);
-#else /* openssl < 0.9.9 */
-	if (HMAC_Init_ex(&ctx, key, key_len, EVP_sha256(), NULL) != 1)
+	for (i = 0; i < num; i++) {
+		if (hmac_sha256(key[i], key_len[i], data[i], data_len[i],
+				mac[i]))
+			return -1;
+	}
+
+	return 0;
+}
+
+#endif /* CONFIG_SHA256 */
+
+
+#ifdef CONFIG_SAE_WORKERS
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+/*
+ * OpenSSL versions before 1.1.0 rely on the application to provide the
+ * locking primitives for internal shared state (e.g., error strings, Montgomery
+ * context caching, and the random number generator).
+ */
+static pthread_mutex_t *openssl_locks = NULL;
+
+
+static void openssl_locking_cb(int mode, int type, const char *file,
+			       int line)
+{
+	if (mode & CRYPTO_LOCK)
+		pthread_mutex_lock(&openssl_locks[type]);
+	else
+		pthread_mutex_unlock(&openssl_locks[type]);
+}
+
+
+#if OPENSSL_VERSION_NUMBER >= 0x10000000L
+static void openssl_threadid_cb(CRYPTO_THREADID *id)
+{
+	CRYPTO_THREADID_set_numeric(id, (unsigned long) pthread_self());
+}
+#else /* openssl >= 1.0.0 */
+static unsigned long openssl_id_cb(void)
+{
+	return (unsigned long) pthread_self();
+}
+#endif /* openssl >= 1.0.0 */
+#endif /* openssl < 1.1.0 */
+
+
+int crypto_threads_init(void)
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+	int i, num;
+
+	if (openssl_locks)
+		return 0;
+	if (CRYPTO_get_locking_callback()) {
+		/* Already taken care of by another user of the library */
+		return 0;
+	}
+
+	num = CRYPTO_num_locks();
+	openssl_locks = os_calloc(num, sizeof(pthread_mutex_t));
+	if (openssl_locks == NULL)
 		return -1;
-#endif /* openssl < 0.9.9 */
+	for (i = 0; i < num; i++)
+		pthread_mutex_init(&openssl_locks[i], NULL);
 
-	for (i = 0; i < num_elem; i++)
-		HMAC_Update(&ctx, addr[i], len[i]);
+#if OPENSSL_VERSION_NUMBER >= 0x10000000L
+	CRYPTO_THREADID_set_callback(openssl_threadid_cb);
+#else /* openssl >= 1.0.0 */
+	CRYPTO_set_id_callback(openssl_id_cb);
+#endif /* openssl >= 1.0.0 */
+	CRYPTO_set_locking_callback(openssl_locking_cb);
+#endif /* openssl < 1.1.0 */
 
-	mdlen = 32;
-#if OPENSSL_VERSION_NUMBER < 0x00909000
-	HMAC_Final(&ctx, mac, &mdlen);
-	res = 1;
-#else /* openssl < 0.9.9 */
-	res = HMAC_Final(&ctx, mac, &mdlen);
-#endif /* openssl < 0.9.9 */
-	HMAC_CTX_cleanup(&ctx);
+	return 0;
+}
 
-	return res == 1 ? 0 : -1;
+#endif /* CONFIG_SAE_WORKERS */
+
+
+void crypto_thread_deinit(void)
+{
+	int i;
+
+	/* Free the cached (unkeyed) contexts of the calling thread */
+	for (i = 0; i < OPENSSL_MD_COUNT; i++) {
+		if (openssl_md_ctx[i]) {
+			EVP_MD_CTX_destroy(openssl_md_ctx[i]);
+			openssl_md_ctx[i] = NULL;
+		}
+		if (openssl_hmac_ctx[i]) {
+			HMAC_CTX_free(openssl_hmac_ctx[i]);
+			openssl_hmac_ctx[i] = NULL;
+		}
+	}
+
+	for (i = 0; i < OPENSSL_AES_CTX_CACHE; i++) {
+		EVP_CIPHER_CTX_free(openssl_aes_ctx_cache[i]);
+		openssl_aes_ctx_cache[i] = NULL;
+	}
+
+	if (openssl_hash_spare) {
+		HMAC_CTX_free(openssl_hash_spare->ctx);
+		os_free(openssl_hash_spare);
+		openssl_hash_spare = NULL;
+	}
 }
 
 
-int hmac_sha256(const u8 *key, size_t key_len, const u8 *data,
-		size_t data_len, u8 *mac)
+int crypto_global_init(void)
 {
-	return hmac_sha256_vector(key, key_len, 1, &data, &data_len, mac);
+	return 0;
 }
 
-#endif /* CONFIG_SHA256 */
+
+#ifdef CONFIG_ECC
+static void crypto_ec_groups_deinit(void);
+#endif /* CONFIG_ECC */
+
+void crypto_global_deinit(void)
+{
+	crypto_thread_deinit();
+#ifdef CONFIG_ECC
+	crypto_ec_groups_deinit();
+#endif /* CONFIG_ECC */
+}
 
 
 int crypto_get_random(void *buf, size_t len)
@@ -1009,55 +1380,114 @@ int crypto_bignum_is_one(const struct crypto_bignum *a)
 
 #ifdef CONFIG_ECC
 
+/*
+ * The curve parameters, including the Montgomery multiplication constants
+ * prepared when the group is created, do not change, so each supported group
+ * is created once and then shared by all crypto_ec instances (and threads).
+ * Each instance has its own BN_CTX. Groups that are not in use are freed in
+ * crypto_global_deinit().
+ */
+struct crypto_ec_group {
+	int group;
+	int nid;
+	EC_GROUP *ec_group;
+	BIGNUM *prime;
+	BIGNUM *order;
+	unsigned int users;
+};
+
+/* Map from IANA registry for IKE D-H groups to OpenSSL NID */
+static struct crypto_ec_group crypto_ec_groups[] = {
+	{ 19, NID_X9_62_prime256v1, NULL, NULL, NULL, 0 },
+	{ 20, NID_secp384r1, NULL, NULL, NULL, 0 },
+	{ 21, NID_secp521r1, NULL, NULL, NULL, 0 },
+	{ 25, NID_X9_62_prime192v1, NULL, NULL, NULL, 0 },
+	{ 26, NID_secp224r1, NULL, NULL, NULL, 0 },
+};
+
+#ifdef CONFIG_SAE_WORKERS
+static pthread_mutex_t crypto_ec_groups_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* CONFIG_SAE_WORKERS */
+
 struct crypto_ec {
+	struct crypto_ec_group *g;
 	EC_GROUP *group;
 	BN_CTX *bnctx;
 	BIGNUM *prime;
 	BIGNUM *order;
 };
 
+
+static int crypto_ec_group_setup(struct crypto_ec_group *g, BN_CTX *bnctx)
+{
+	EC_GROUP *group;
+	BIGNUM *prime, *order;
+
+	group = EC_GROUP_new_by_curve_name(g->nid);
+	prime = BN_new();
+	order = BN_new();
+	if (group == NULL || prime == NULL || order == NULL ||
+	    !EC_GROUP_get_curve_GFp(group, prime, NULL, NULL, bnctx) ||
+	    !EC_GROUP_get_order(group, order, bnctx)) {
+		EC_GROUP_free(group);
+		BN_free(prime);
+		BN_free(order);
+		return -1;
+	}
+
+	g->prime = prime;
+	g->order = order;
+	g->ec_group = group;
+	return 0;
+}
+
+
 struct crypto_ec * crypto_ec_init(int group)
 {
 	struct crypto_ec *e;
-	int nid;
+	struct crypto_ec_group *g = NULL;
+	size_t i;
+	int res = 0;
 
-	/* Map from IANA registry for IKE D-H groups to OpenSSL NID */
-	switch (group) {
-	case 19:
-		nid = NID_X9_62_prime256v1;
-		break;
-	case 20:
-		nid = NID_secp384r1;
-		break;
-	case 21:
-		nid = NID_secp521r1;
-		break;
-	case 25:
-		nid = NID_X9_62_prime192v1;
-		break;
-	case 26:
-		nid = NID_secp224r1;
-		break;
-	default:
-		return NULL;
+	for (i = 0; i < ARRAY_SIZE(crypto_ec_groups); i++) {
+		if (crypto_ec_groups[i].group == group) {
+			g = &crypto_ec_groups[i];
+			break;
+		}
 	}
+	if (g == NULL)
+		return NULL;
 
 	e = os_zalloc(sizeof(*e));
 	if (e == NULL)
 		return NULL;
 
 	e->bnctx = BN_CTX_new();
-	e->group = EC_GROUP_new_by_curve_name(nid);
-	e->prime = BN_new();
-	e->order = BN_new();
-	if (e->group == NULL || e->bnctx == NULL || e->prime == NULL ||
-	    e->order == NULL ||
-	    !EC_GROUP_get_curve_GFp(e->group, e->prime, NULL, NULL, e->bnctx) ||
-	    !EC_GROUP_get_order(e->group, e->order, e->bnctx)) {
+	if (e->bnctx == NULL) {
+		os_free(e);
+		return NULL;
+	}
+
+#ifdef CONFIG_SAE_WORKERS
+	pthread_mutex_lock(&crypto_ec_groups_lock);
+#endif /* CONFIG_SAE_WORKERS */
+	if (g->ec_group == NULL)
+		res = crypto_ec_group_setup(g, e->bnctx);
+	if (res == 0)
+		g->users++;
+#ifdef CONFIG_SAE_WORKERS
+	pthread_mutex_unlock(&crypto_ec_groups_lock);
+#endif /* CONFIG_SAE_WORKERS */
+	if (res < 0) {
 		crypto_ec_deinit(e);
-		e = NULL;
+		return NULL;
 	}
 
+	e->g = g;
+	e->group = g->ec_group;
+	e->prime = g->prime;
+	e->order = g->order;
+
 	return e;
 }
 
@@ -1066,13 +1496,45 @@ void crypto_ec_deinit(struct crypto_ec *e)
 {
 	if (e == NULL)
 		return;
-	BN_free(e->order);
-	EC_GROUP_free(e->group);
+	if (e->g) {
+#ifdef CONFIG_SAE_WORKERS
+		pthread_mutex_lock(&crypto_ec_groups_lock);
+#endif /* CONFIG_SAE_WORKERS */
+		e->g->users--;
+#ifdef CONFIG_SAE_WORKERS
+		pthread_mutex_unlock(&crypto_ec_groups_lock);
+#endif /* CONFIG_SAE_WORKERS */
+	}
 	BN_CTX_free(e->bnctx);
 	os_free(e);
 }
 
 
+static void crypto_ec_groups_deinit(void)
+{
+	struct crypto_ec_group *g;
+	size_t i;
+
+#ifdef CONFIG_SAE_WORKERS
+	pthread_mutex_lock(&crypto_ec_groups_lock);
+#endif /* CONFIG_SAE_WORKERS */
+	for (i = 0; i < ARRAY_SIZE(crypto_ec_groups); i++) {
+		g = &crypto_ec_groups[i];
+		if (g->ec_group == NULL || g->users)
+			continue;
+		EC_GROUP_free(g->ec_group);
+		BN_free(g->prime);
+		BN_free(g->order);
+		g->ec_group = NULL;
+		g->prime = NULL;
+		g->order = NULL;
+	}
+#ifdef CONFIG_SAE_WORKERS
+	pthread_mutex_unlock(&crypto_ec_groups_lock);
+#endif /* CONFIG_SAE_WORKERS */
+}
+
+
 struct crypto_ec_point * crypto_ec_point_init(struct crypto_ec *e)
 {
 	if (e == NULL)
@@ -26,6 +26,9 @@
 #ifdef __linux__
 #include <fcntl.h>
 #endif /* __linux__ */
+#if defined(CONFIG_TLS_WORKERS) || defined(CONFIG_SAE_WORKERS)
+#include <pthread.h>
+#endif /* CONFIG_TLS_WORKERS || CONFIG_SAE_WORKERS */
 
 #include "utils/common.h"
 #include "utils/eloop.h"
@@ -60,6 +63,19 @@ static int random_entropy_file_read = 0;
 static unsigned int entropy = 0;
 static unsigned int total_collected = 0;
 
+#if defined(CONFIG_TLS_WORKERS) || defined(CONFIG_SAE_WORKERS)
+/*
+ * random_get_bytes() is also called from EAP server TLS and SAE worker
+ * threads
+ */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#define random_pool_lock() pthread_mutex_lock(&pool_lock)
+#define random_pool_unlock() pthread_mutex_unlock(&pool_lock)
+#else /* CONFIG_TLS_WORKERS || CONFIG_SAE_WORKERS */
+#define random_pool_lock() do { } while (0)
+#define random_pool_unlock() do { } while (0)
+#endif /* CONFIG_TLS_WORKERS || CONFIG_SAE_WORKERS */
+
 
 static void random_write_entropy(void);
 
@@ -140,6 +156,7 @@ void random_add_randomness(const void *buf, size_t len)
 		   count, entropy);
 
 	os_get_time(&t);
+	random_pool_lock();
 	wpa_hexdump_key(MSG_EXCESSIVE, "random pool",
 			(const u8 *) pool, sizeof(pool));
 	random_mix_pool(&t, sizeof(t));
@@ -148,6 +165,7 @@ void random_add_randomness(const void *buf, size_t len)
 			(const u8 *) pool, sizeof(pool));
 	entropy++;
 	total_collected++;
+	random_pool_unlock();
 }
 
 
@@ -166,6 +184,7 @@ int random_get_bytes(void *buf, size_t len)
 			buf, len);
 
 	/* Mix in additional entropy extracted from the internal pool */
+	random_pool_lock();
 	left = len;
 	while (left) {
 		size_t siz, i;
@@ -178,6 +197,7 @@ int random_get_bytes(void *buf, size_t len)
 			*bytes++ ^= tmp[i];
 		left -= siz;
 	}
+	random_pool_unlock();
 
 #ifdef CONFIG_FIPS
 	/* Mix in additional entropy from the crypto module */
@@ -201,10 +221,12 @@ int random_get_bytes(void *buf, size_t len)
 
 	wpa_hexdump_key(MSG_EXCESSIVE, "mixed random", buf, len);
 
+	random_pool_lock();
 	if (entropy < len)
 		entropy = 0;
 	else
 		entropy -= len;
+	random_pool_unlock();
 
 	return ret;
 }
@@ -241,8 +263,10 @@ int random_pool_ready(void)
 		return -1;
 	}
 
+	random_pool_lock();
 	res = read(fd, dummy_key + dummy_key_avail,
 		   sizeof(dummy_key) - dummy_key_avail);
+	random_pool_unlock();
 	if (res < 0) {
 		wpa_printf(MSG_ERROR, "random: Cannot read from /dev/random: "
 			   "%s", strerror(errno));
@@ -312,8 +336,10 @@ static void random_read_fd(int sock, void *eloop_ctx, void *sock_ctx)
 		return;
 	}
 
+	random_pool_lock();
 	res = read(sock, dummy_key + dummy_key_avail,
 		   sizeof(dummy_key) - dummy_key_avail);
+	random_pool_unlock();
 	if (res < 0) {
 		wpa_printf(MSG_ERROR, "random: Cannot read from /dev/random: "
 			   "%s", strerror(errno));
@@ -0,0 +1,341 @@
+/*
+ * SHA-1 hash implementation - CPU instruction and SIMD based processing
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Single messages use the x86 SHA extensions or the ARMv8 SHA1 instructions
+ * when available at run time. Independent messages are processed in eight
+ * SIMD lanes (AVX2 when available, otherwise two SSE2/NEON registers per
+ * vector) when the CPU does not have SHA-1 instructions.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "sha1_i.h"
+
+#ifdef SHA1_HW
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SHA1_HW_X86
+#else /* x86 */
+#include <arm_neon.h>
+#define SHA1_HW_ARM
+#endif /* x86 */
+
+#define SHA1_LANES 8
+
+static int sha1_hw_enabled = 1;
+
+
+/**
+ * sha1_hw_enable - Select which CPU specific SHA-1 code is used
+ * @enabled: 0 = portable C code only, 1 = SHA-1 instructions if supported
+ *	and SIMD lanes otherwise, 2 = SIMD lanes even if SHA-1 instructions
+ *	are supported
+ *
+ * This is mainly for testing and benchmarking the alternative code paths.
+ */
+void sha1_hw_enable(int enabled)
+{
+	sha1_hw_enabled = enabled;
+}
+
+
+#ifdef SHA1_HW_X86
+
+#define SHA1_NI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+
+/*
+ * Four rounds (group j of 0..19) with the message schedule for the following
+ * groups computed from the words of this group: W[t] for group g is
+ * sha1msg2(sha1msg1(M[g-4], M[g-3]) ^ M[g-2], M[g-1]).
+ */
+#define SHA1_NI_GROUP(j, f)						\
+do {									\
+	if ((j) == 0) {							\
+		e0 = _mm_add_epi32(e0, msg[0]);				\
+		e1 = abcd;						\
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, f);		\
+	} else if ((j) & 1) {						\
+		e1 = _mm_sha1nexte_epu32(e1, msg[(j) & 3]);		\
+		e0 = abcd;						\
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, f);		\
+	} else {							\
+		e0 = _mm_sha1nexte_epu32(e0, msg[(j) & 3]);		\
+		e1 = abcd;						\
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, f);		\
+	}								\
+	if ((j) >= 3 && (j) <= 18)					\
+		msg[((j) + 1) & 3] = _mm_sha1msg2_epu32(msg[((j) + 1) & 3], \
+							msg[(j) & 3]);	\
+	if ((j) >= 1 && (j) <= 16)					\
+		msg[((j) + 3) & 3] = _mm_sha1msg1_epu32(msg[((j) + 3) & 3], \
+							msg[(j) & 3]);	\
+	if ((j) >= 2 && (j) <= 17)					\
+		msg[((j) + 2) & 3] = _mm_xor_si128(msg[((j) + 2) & 3],	\
+						   msg[(j) & 3]);	\
+} while (0)
+
+SHA1_NI_TARGET
+static void sha1_ni_transform(u32 state[5], const u8 *data, size_t blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+					    0x08090a0b0c0d0e0fULL);
+	__m128i abcd, abcd_save, e0, e0_save, e1, msg[4];
+	int i;
+
+	abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) state),
+				 0x1B);
+	e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	while (blocks--) {
+		abcd_save = abcd;
+		e0_save = e0;
+
+		for (i = 0; i < 4; i++)
+			msg[i] = _mm_shuffle_epi8(
+				_mm_loadu_si128((const __m128i *)
+						(data + 16 * i)), mask);
+
+		SHA1_NI_GROUP(0, 0);
+		SHA1_NI_GROUP(1, 0);
+		SHA1_NI_GROUP(2, 0);
+		SHA1_NI_GROUP(3, 0);
+		SHA1_NI_GROUP(4, 0);
+		SHA1_NI_GROUP(5, 1);
+		SHA1_NI_GROUP(6, 1);
+		SHA1_NI_GROUP(7, 1);
+		SHA1_NI_GROUP(8, 1);
+		SHA1_NI_GROUP(9, 1);
+		SHA1_NI_GROUP(10, 2);
+		SHA1_NI_GROUP(11, 2);
+		SHA1_NI_GROUP(12, 2);
+		SHA1_NI_GROUP(13, 2);
+		SHA1_NI_GROUP(14, 2);
+		SHA1_NI_GROUP(15, 3);
+		SHA1_NI_GROUP(16, 3);
+		SHA1_NI_GROUP(17, 3);
+		SHA1_NI_GROUP(18, 3);
+		SHA1_NI_GROUP(19, 3);
+
+		/* e0 holds the state before the last four rounds */
+		e0 = _mm_sha1nexte_epu32(e0, e0_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+		data += 64;
+	}
+
+	_mm_storeu_si128((__m128i *) state, _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+#endif /* SHA1_HW_X86 */
+
+
+#ifdef SHA1_HW_ARM
+
+/*
+ * Four rounds (group j of 0..19) with the message schedule for the following
+ * groups: W[t] for group g is sha1su1(sha1su0(M[g-4], M[g-3], M[g-2]),
+ * M[g-1]).
+ */
+#define SHA1_CE_GROUP(j, op, k)						\
+do {									\
+	wk = vaddq_u32(msg[(j) & 3], vdupq_n_u32(k));			\
+	e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0));			\
+	abcd = op(abcd, e, wk);						\
+	e = e_next;							\
+	if ((j) >= 3 && (j) <= 18)					\
+		msg[((j) + 1) & 3] = vsha1su1q_u32(msg[((j) + 1) & 3],	\
+						   msg[(j) & 3]);	\
+	if ((j) >= 2 && (j) <= 17)					\
+		msg[((j) + 2) & 3] = vsha1su0q_u32(msg[((j) + 2) & 3],	\
+						   msg[((j) + 3) & 3],	\
+						   msg[(j) & 3]);	\
+} while (0)
+
+__attribute__((target("+crypto")))
+static void sha1_ce_transform(u32 state[5], const u8 *data, size_t blocks)
+{
+	uint32x4_t abcd, abcd_save, msg[4], wk;
+	u32 e, e_save, e_next;
+	int i;
+
+	abcd = vld1q_u32(state);
+	e = state[4];
+
+	while (blocks--) {
+		abcd_save = abcd;
+		e_save = e;
+
+		for (i = 0; i < 4; i++)
+			msg[i] = vreinterpretq_u32_u8(
+				vrev32q_u8(vld1q_u8(data + 16 * i)));
+
+		SHA1_CE_GROUP(0, vsha1cq_u32, 0x5A827999);
+		SHA1_CE_GROUP(1, vsha1cq_u32, 0x5A827999);
+		SHA1_CE_GROUP(2, vsha1cq_u32, 0x5A827999);
+		SHA1_CE_GROUP(3, vsha1cq_u32, 0x5A827999);
+		SHA1_CE_GROUP(4, vsha1cq_u32, 0x5A827999);
+		SHA1_CE_GROUP(5, vsha1pq_u32, 0x6ED9EBA1);
+		SHA1_CE_GROUP(6, vsha1pq_u32, 0x6ED9EBA1);
+		SHA1_CE_GROUP(7, vsha1pq_u32, 0x6ED9EBA1);
+		SHA1_CE_GROUP(8, vsha1pq_u32, 0x6ED9EBA1);
+		SHA1_CE_GROUP(9, vsha1pq_u32, 0x6ED9EBA1);
+		SHA1_CE_GROUP(10, vsha1mq_u32, 0x8F1BBCDC);
+		SHA1_CE_GROUP(11, vsha1mq_u32, 0x8F1BBCDC);
+		SHA1_CE_GROUP(12, vsha1mq_u32, 0x8F1BBCDC);
+		SHA1_CE_GROUP(13, vsha1mq_u32, 0x8F1BBCDC);
+		SHA1_CE_GROUP(14, vsha1mq_u32, 0x8F1BBCDC);
+		SHA1_CE_GROUP(15, vsha1pq_u32, 0xCA62C1D6);
+		SHA1_CE_GROUP(16, vsha1pq_u32, 0xCA62C1D6);
+		SHA1_CE_GROUP(17, vsha1pq_u32, 0xCA62C1D6);
+		SHA1_CE_GROUP(18, vsha1pq_u32, 0xCA62C1D6);
+		SHA1_CE_GROUP(19, vsha1pq_u32, 0xCA62C1D6);
+
+		abcd = vaddq_u32(abcd, abcd_save);
+		e += e_save;
+		data += 64;
+	}
+
+	vst1q_u32(state, abcd);
+	state[4] = e;
+}
+
+#endif /* SHA1_HW_ARM */
+
+
+int sha1_hw_transform(u32 state[5], const u8 *data, size_t blocks)
+{
+	if (!(cpu_features() & CPU_FEATURE_SHA1) || sha1_hw_enabled != 1)
+		return 0;
+#ifdef SHA1_HW_X86
+	sha1_ni_transform(state, data, blocks);
+#endif /* SHA1_HW_X86 */
+#ifdef SHA1_HW_ARM
+	sha1_ce_transform(state, data, blocks);
+#endif /* SHA1_HW_ARM */
+	return 1;
+}
+
+
+/*
+ * Portable SIMD code using the GCC vector extensions. Each vector element is
+ * one lane, i.e., one independent message. This is compiled both for the
+ * baseline instruction set and for AVX2.
+ */
+
+typedef u32 sha1_vec __attribute__((vector_size(4 * SHA1_LANES)));
+
+#define VROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define SHA1_VEC_ROUND(f, k)						\
+do {									\
+	if (i >= 16) {							\
+		t = w[(i - 3) & 15] ^ w[(i - 8) & 15] ^			\
+			w[(i - 14) & 15] ^ w[i & 15];			\
+		w[i & 15] = VROL(t, 1);					\
+	}								\
+	t = VROL(a, 5) + (f) + e + (k) + w[i & 15];			\
+	e = d;								\
+	d = c;								\
+	c = VROL(b, 30);						\
+	b = a;								\
+	a = t;								\
+} while (0)
+
+static inline __attribute__((always_inline))
+void sha1_vec_transform(u32 *state[SHA1_LANES],
+			const u8 *block[SHA1_LANES])
+{
+	sha1_vec a, b, c, d, e, t, w[16];
+	sha1_vec sa, sb, sc, sd, se;
+	int i, l;
+
+	for (i = 0; i < 16; i++)
+		for (l = 0; l < SHA1_LANES; l++)
+			w[i][l] = WPA_GET_BE32(block[l] + 4 * i);
+	for (l = 0; l < SHA1_LANES; l++) {
+		a[l] = state[l][0];
+		b[l] = state[l][1];
+		c[l] = state[l][2];
+		d[l] = state[l][3];
+		e[l] = state[l][4];
+	}
+	sa = a;
+	sb = b;
+	sc = c;
+	sd = d;
+	se = e;
+
+	for (i = 0; i < 20; i++)
+		SHA1_VEC_ROUND(d ^ (b & (c ^ d)), 0x5A827999);
+	for (; i < 40; i++)
+		SHA1_VEC_ROUND(b ^ c ^ d, 0x6ED9EBA1);
+	for (; i < 60; i++)
+		SHA1_VEC_ROUND((b & c) | (d & (b | c)), 0x8F1BBCDC);
+	for (; i < 80; i++)
+		SHA1_VEC_ROUND(b ^ c ^ d, 0xCA62C1D6);
+
+	a += sa;
+	b += sb;
+	c += sc;
+	d += sd;
+	e += se;
+	for (l = 0; l < SHA1_LANES; l++) {
+		state[l][0] = a[l];
+		state[l][1] = b[l];
+		state[l][2] = c[l];
+		state[l][3] = d[l];
+		state[l][4] = e[l];
+	}
+}
+
+
+#ifdef SHA1_HW_X86
+__attribute__((target("avx2")))
+static void sha1_vec_transform_avx2(u32 *state[SHA1_LANES],
+				    const u8 *block[SHA1_LANES])
+{
+	sha1_vec_transform(state, block);
+}
+#endif /* SHA1_HW_X86 */
+
+
+static void sha1_vec_transform_base(u32 *state[SHA1_LANES],
+				    const u8 *block[SHA1_LANES])
+{
+	sha1_vec_transform(state, block);
+}
+
+
+size_t sha1_hw_transform_multi(u32 *state[], const u8 *block[], size_t num)
+{
+	size_t done;
+	unsigned int caps = cpu_features();
+
+	/*
+	 * The SHA-1 instructions are faster per message than the SIMD lanes,
+	 * so leave all messages to SHA1Transform() when they are available.
+	 */
+	if (!sha1_hw_enabled ||
+	    ((caps & CPU_FEATURE_SHA1) && sha1_hw_enabled == 1))
+		return 0;
+
+	for (done = 0; done + SHA1_LANES <= num; done += SHA1_LANES) {
+#ifdef SHA1_HW_X86
+		if (caps & CPU_FEATURE_AVX2) {
+			sha1_vec_transform_avx2(&state[done], &block[done]);
+			continue;
+		}
+#endif /* SHA1_HW_X86 */
+		sha1_vec_transform_base(&state[done], &block[done]);
+	}
+
+	return done;
+}
+
+#endif /* SHA1_HW */
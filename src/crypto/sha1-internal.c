@@ -40,6 +40,229 @@ int sha1_vector(size_t num_elem, const u8 *addr[], const size_t *len, u8 *mac)
 }
 
 
+/**
+ * hmac_sha1_init - Initialize HMAC-SHA1 context for a key
+ * @ctx: Context to initialize
+ * @key: Key for HMAC operations
+ * @key_len: Length of the key in bytes
+ */
+void hmac_sha1_init(struct hmac_sha1_ctx *ctx, const u8 *key, size_t key_len)
+{
+	unsigned char k_pad[64]; /* padding - key XORd with ipad/opad */
+	unsigned char tk[20];
+	size_t i;
+
+	/* if key is longer than 64 bytes reset it to key = SHA1(key) */
+	if (key_len > 64) {
+		SHA1Init(&ctx->inner);
+		SHA1Update(&ctx->inner, key, key_len);
+		SHA1Final(tk, &ctx->inner);
+		key = tk;
+		key_len = 20;
+	}
+
+	os_memset(k_pad, 0, sizeof(k_pad));
+	os_memcpy(k_pad, key, key_len);
+	for (i = 0; i < 64; i++)
+		k_pad[i] ^= 0x36;
+	SHA1Init(&ctx->inner);
+	SHA1Update(&ctx->inner, k_pad, 64);
+
+	/* k_pad ^ 0x36 ^ 0x5c = key XOR opad */
+	for (i = 0; i < 64; i++)
+		k_pad[i] ^= 0x36 ^ 0x5c;
+	SHA1Init(&ctx->outer);
+	SHA1Update(&ctx->outer, k_pad, 64);
+
+	os_memset(k_pad, 0, sizeof(k_pad));
+	os_memset(tk, 0, sizeof(tk));
+}
+
+
+/**
+ * hmac_sha1_ctx_vector - HMAC-SHA1 over data vector using a prepared key
+ * @ctx: Context from hmac_sha1_init()
+ * @num_elem: Number of elements in the data vector
+ * @addr: Pointers to the data areas
+ * @len: Lengths of the data blocks
+ * @mac: Buffer for the hash (20 bytes)
+ *
+ * The context is not modified, so it can be used for any number of calls.
+ */
+void hmac_sha1_ctx_vector(const struct hmac_sha1_ctx *ctx, size_t num_elem,
+			  const u8 *addr[], const size_t *len, u8 *mac)
+{
+	SHA1_CTX sha;
+	size_t i;
+
+	sha = ctx->inner;
+	for (i = 0; i < num_elem; i++)
+		SHA1Update(&sha, addr[i], len[i]);
+	SHA1Final(mac, &sha);
+
+	sha = ctx->outer;
+	SHA1Update(&sha, mac, SHA1_MAC_LEN);
+	SHA1Final(mac, &sha);
+}
+
+
+/**
+ * hmac_sha1_deinit - Clear key material from HMAC-SHA1 context
+ * @ctx: Context from hmac_sha1_init()
+ */
+void hmac_sha1_deinit(struct hmac_sha1_ctx *ctx)
+{
+	os_memset(ctx, 0, sizeof(*ctx));
+}
+
+
+/**
+ * SHA1TransformMulti - Process one block for each of a set of SHA-1 states
+ * @state: Array of num pointers to SHA-1 states
+ * @buffer: Array of num pointers to 64-octet blocks
+ * @num: Number of states
+ *
+ * The states are independent of each other, so they can be processed in
+ * parallel in SIMD lanes.
+ */
+void SHA1TransformMulti(u32 *state[], const unsigned char *buffer[],
+			size_t num)
+{
+	size_t i;
+
+	for (i = sha1_hw_transform_multi(state, buffer, num); i < num; i++)
+		SHA1Transform(state[i], buffer[i]);
+}
+
+
+#define SHA1_MULTI_LANES 8
+
+/*
+ * Complete the hashes of messages for which the first prefix_len octets
+ * (a multiple of 64) have already been processed into state[i]. Each round
+ * processes the next block of all the messages that are not yet finished.
+ */
+static void sha1_multi_finish(u32 (*state)[5], size_t prefix_len,
+			      const u8 *data[], const size_t *len, u8 *mac[],
+			      size_t num)
+{
+	u8 tail[SHA1_MULTI_LANES][2 * 64];
+	size_t full[SHA1_MULTI_LANES], blocks[SHA1_MULTI_LANES];
+	u32 *st[SHA1_MULTI_LANES];
+	const u8 *blk[SHA1_MULTI_LANES];
+	size_t i, k, b, n, rem, max_blocks;
+
+	for (; num > 0; num -= n, state += n, data += n, len += n, mac += n) {
+		n = num < SHA1_MULTI_LANES ? num : SHA1_MULTI_LANES;
+		max_blocks = 0;
+		for (i = 0; i < n; i++) {
+			full[i] = len[i] / 64;
+			rem = len[i] % 64;
+			blocks[i] = full[i] + (rem < 56 ? 1 : 2);
+			os_memset(tail[i], 0, sizeof(tail[i]));
+			os_memcpy(tail[i], data[i] + 64 * full[i], rem);
+			tail[i][rem] = 0x80;
+			WPA_PUT_BE64(&tail[i][64 * (blocks[i] - full[i]) - 8],
+				     (u64) (prefix_len + len[i]) * 8);
+			if (blocks[i] > max_blocks)
+				max_blocks = blocks[i];
+		}
+
+		for (b = 0; b < max_blocks; b++) {
+			for (i = 0, k = 0; i < n; i++) {
+				if (b >= blocks[i])
+					continue;
+				st[k] = state[i];
+				blk[k++] = b < full[i] ? data[i] + 64 * b :
+					tail[i] + 64 * (b - full[i]);
+			}
+			SHA1TransformMulti(st, blk, k);
+		}
+
+		for (i = 0; i < n; i++) {
+			for (k = 0; k < 5; k++)
+				WPA_PUT_BE32(mac[i] + 4 * k, state[i][k]);
+		}
+	}
+
+	os_memset(tail, 0, sizeof(tail));
+}
+
+
+/**
+ * hmac_sha1_multi - HMAC-SHA1 over a set of independent messages
+ * @key: Array of num keys
+ * @key_len: Array of num key lengths
+ * @data: Array of num messages
+ * @data_len: Array of num message lengths
+ * @mac: Array of num buffers for the MACs (20 bytes each)
+ * @num: Number of messages
+ * Returns: 0 on success, -1 on failure
+ *
+ * This is equivalent to calling hmac_sha1() for each message, but the
+ * messages are processed in parallel when the CPU supports SIMD processing of
+ * multiple SHA-1 blocks. This is useful for trying a large number of keys
+ * for the same message, e.g., when checking a PMKID or a Key MIC against all
+ * possible PSKs.
+ */
+int hmac_sha1_multi(const u8 *key[], const size_t *key_len, const u8 *data[],
+		    const size_t *data_len, u8 *mac[], size_t num)
+{
+	u8 pad[2 * SHA1_MULTI_LANES][64];
+	u8 tk[SHA1_MULTI_LANES][SHA1_MAC_LEN];
+	u32 state[2 * SHA1_MULTI_LANES][5];
+	u32 *st[2 * SHA1_MULTI_LANES];
+	const u8 *blk[2 * SHA1_MULTI_LANES];
+	const u8 *inner[SHA1_MULTI_LANES];
+	u8 *inner_mac[SHA1_MULTI_LANES];
+	size_t inner_len[SHA1_MULTI_LANES];
+	SHA1_CTX init;
+	const u8 *k;
+	size_t i, j, n, klen;
+
+	SHA1Init(&init);
+
+	for (; num > 0; num -= n, key += n, key_len += n, data += n,
+		     data_len += n, mac += n) {
+		n = num < SHA1_MULTI_LANES ? num : SHA1_MULTI_LANES;
+		for (i = 0; i < n; i++) {
+			k = key[i];
+			klen = key_len[i];
+			/* if key is longer than 64 bytes reset it to
+			 * key = SHA1(key) */
+			if (klen > 64) {
+				sha1_vector(1, &key[i], &key_len[i], tk[i]);
+				k = tk[i];
+				klen = SHA1_MAC_LEN;
+			}
+			os_memset(pad[i], 0x36, 64);
+			os_memset(pad[n + i], 0x5c, 64);
+			for (j = 0; j < klen; j++) {
+				pad[i][j] ^= k[j];
+				pad[n + i][j] ^= k[j];
+			}
+			os_memcpy(state[i], init.state, sizeof(state[i]));
+			os_memcpy(state[n + i], init.state, sizeof(state[i]));
+			st[i] = state[i];
+			st[n + i] = state[n + i];
+			blk[i] = pad[i];
+			blk[n + i] = pad[n + i];
+			inner[i] = inner_mac[i] = tk[i];
+			inner_len[i] = SHA1_MAC_LEN;
+		}
+		SHA1TransformMulti(st, blk, 2 * n);
+
+		sha1_multi_finish(state, 64, data, data_len, inner_mac, n);
+		sha1_multi_finish(&state[n], 64, inner, inner_len, mac, n);
+	}
+
+	os_memset(pad, 0, sizeof(pad));
+	os_memset(tk, 0, sizeof(tk));
+	os_memset(state, 0, sizeof(state));
+	return 0;
+}
+
+
 /* ===== start - public domain SHA1 implementation ===== */
 
 /*
@@ -178,6 +401,10 @@ void SHA1Transform(u32 state[5], const unsigned char buffer[64])
 	CHAR64LONG16* block;
 #ifdef SHA1HANDSOFF
 	CHAR64LONG16 workspace;
+#endif
+	if (sha1_hw_transform(state, buffer, 1))
+		return;
+#ifdef SHA1HANDSOFF
 	block = &workspace;
 	os_memcpy(block, buffer, 64);
 #else
@@ -255,6 +482,10 @@ void SHA1Update(SHA1_CTX* context, const void *_data, u32 len)
 	if ((j + len) > 63) {
 		os_memcpy(&context->buffer[j], data, (i = 64-j));
 		SHA1Transform(context->state, context->buffer);
+		if (i + 63 < len &&
+		    sha1_hw_transform(context->state, &data[i],
+				      (len - i) / 64))
+			i += (len - i) & ~63;
 		for ( ; i + 63 < len; i += 64) {
 			SHA1Transform(context->state, &data[i]);
 		}
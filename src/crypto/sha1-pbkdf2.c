@@ -10,6 +10,187 @@
 
 #include "common.h"
 #include "sha1.h"
+#ifdef CONFIG_INTERNAL_SHA1
+#include "sha1_i.h"
+#endif /* CONFIG_INTERNAL_SHA1 */
+
+
+#ifdef CONFIG_INTERNAL_SHA1
+
+/*
+ * With the internal SHA-1 implementation, the HMAC key pads are hashed only
+ * once per passphrase and each of the remaining iterations is two SHA-1
+ * compression function calls on a pre-padded block instead of the four needed
+ * by hmac_sha1(). Multiple passphrases are processed in lanes that advance
+ * together through the iterations, so that SHA1TransformMulti() can process
+ * the lanes in parallel.
+ */
+
+#define PBKDF2_SHA1_LANES 8
+
+struct pbkdf2_sha1_lane {
+	struct hmac_sha1_ctx hmac;
+	u8 block[64]; /* U_i and SHA-1 padding for the 84-octet inner message */
+	u32 t[5]; /* U_1 xor U_2 xor ... xor U_i */
+};
+
+
+static void pbkdf2_sha1_put_state(u8 *pos, const u32 *state)
+{
+	int i;
+
+	for (i = 0; i < 5; i++)
+		WPA_PUT_BE32(pos + 4 * i, state[i]);
+}
+
+
+static void pbkdf2_sha1_f(struct pbkdf2_sha1_lane *lane, size_t num,
+			  const u8 *ssid, size_t ssid_len, int iterations,
+			  unsigned int count)
+{
+	unsigned char count_buf[4];
+	const u8 *addr[2];
+	size_t len[2];
+	u32 state[PBKDF2_SHA1_LANES][5];
+	u32 *st[PBKDF2_SHA1_LANES];
+	const u8 *blk[PBKDF2_SHA1_LANES];
+	size_t j;
+	int i, k;
+
+	addr[0] = ssid;
+	len[0] = ssid_len;
+	addr[1] = count_buf;
+	len[1] = 4;
+
+	/* F(P, S, c, i) = U1 xor U2 xor ... Uc
+	 * U1 = PRF(P, S || i)
+	 * U2 = PRF(P, U1)
+	 * Uc = PRF(P, Uc-1)
+	 */
+
+	WPA_PUT_BE32(count_buf, count);
+	for (j = 0; j < num; j++) {
+		hmac_sha1_ctx_vector(&lane[j].hmac, 2, addr, len,
+				     lane[j].block);
+		for (k = 0; k < 5; k++)
+			lane[j].t[k] = WPA_GET_BE32(lane[j].block + 4 * k);
+		os_memset(lane[j].block + SHA1_MAC_LEN, 0,
+			  sizeof(lane[j].block) - SHA1_MAC_LEN);
+		lane[j].block[SHA1_MAC_LEN] = 0x80;
+		/* 64-octet key pad block + 20-octet U_i = 672 bits */
+		WPA_PUT_BE16(&lane[j].block[62], (64 + SHA1_MAC_LEN) * 8);
+		st[j] = state[j];
+		blk[j] = lane[j].block;
+	}
+
+	for (i = 1; i < iterations; i++) {
+		for (j = 0; j < num; j++)
+			os_memcpy(state[j], lane[j].hmac.inner.state,
+				  sizeof(state[j]));
+		SHA1TransformMulti(st, blk, num);
+		for (j = 0; j < num; j++) {
+			pbkdf2_sha1_put_state(lane[j].block, state[j]);
+			os_memcpy(state[j], lane[j].hmac.outer.state,
+				  sizeof(state[j]));
+		}
+		SHA1TransformMulti(st, blk, num);
+		for (j = 0; j < num; j++) {
+			pbkdf2_sha1_put_state(lane[j].block, state[j]);
+			for (k = 0; k < 5; k++)
+				lane[j].t[k] ^= state[j][k];
+		}
+	}
+
+	os_memset(state, 0, sizeof(state));
+}
+
+
+static void pbkdf2_sha1_lanes(struct pbkdf2_sha1_lane *lane,
+			      const char *passphrase[], size_t num,
+			      const u8 *ssid, size_t ssid_len, int iterations,
+			      u8 *buf[], size_t buflen)
+{
+	unsigned int count = 0;
+	size_t pos = 0, plen, j;
+	u8 digest[SHA1_MAC_LEN];
+
+	for (j = 0; j < num; j++)
+		hmac_sha1_init(&lane[j].hmac, (const u8 *) passphrase[j],
+			       os_strlen(passphrase[j]));
+
+	while (pos < buflen) {
+		count++;
+		pbkdf2_sha1_f(lane, num, ssid, ssid_len, iterations, count);
+		plen = buflen - pos > SHA1_MAC_LEN ? SHA1_MAC_LEN :
+			buflen - pos;
+		for (j = 0; j < num; j++) {
+			pbkdf2_sha1_put_state(digest, lane[j].t);
+			os_memcpy(buf[j] + pos, digest, plen);
+		}
+		pos += plen;
+	}
+
+	os_memset(lane, 0, num * sizeof(*lane));
+	os_memset(digest, 0, sizeof(digest));
+}
+
+
+/**
+ * pbkdf2_sha1_batch - PBKDF2 for multiple passphrases with the same SSID
+ * @passphrase: Array of num ASCII passphrases
+ * @ssid: SSID
+ * @ssid_len: SSID length in bytes
+ * @iterations: Number of iterations to run
+ * @buf: Array of num buffers for the generated keys
+ * @buflen: Length of each buffer in bytes
+ * @num: Number of passphrases
+ * Returns: 0 on success, -1 of failure
+ *
+ * This is equivalent to calling pbkdf2_sha1() for each passphrase, but allows
+ * the derivations to be processed in parallel, e.g., when loading a large
+ * number of passphrases from a PSK file.
+ */
+int pbkdf2_sha1_batch(const char *passphrase[], const u8 *ssid,
+		      size_t ssid_len, int iterations, u8 *buf[],
+		      size_t buflen, size_t num)
+{
+	struct pbkdf2_sha1_lane lane[PBKDF2_SHA1_LANES];
+	size_t i, n;
+
+	for (i = 0; i < num; i += n) {
+		n = num - i;
+		if (n > PBKDF2_SHA1_LANES)
+			n = PBKDF2_SHA1_LANES;
+		pbkdf2_sha1_lanes(lane, &passphrase[i], n, ssid, ssid_len,
+				  iterations, &buf[i], buflen);
+	}
+
+	return 0;
+}
+
+
+/**
+ * pbkdf2_sha1 - SHA1-based key derivation function (PBKDF2) for IEEE 802.11i
+ * @passphrase: ASCII passphrase
+ * @ssid: SSID
+ * @ssid_len: SSID length in bytes
+ * @iterations: Number of iterations to run
+ * @buf: Buffer for the generated key
+ * @buflen: Length of the buffer in bytes
+ * Returns: 0 on success, -1 of failure
+ *
+ * This function is used to derive PSK for WPA-PSK. For this protocol,
+ * iterations is set to 4096 and buflen to 32. This function is described in
+ * IEEE Std 802.11-2004, Clause H.4. The main construction is from PKCS#5 v2.0.
+ */
+int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
+		int iterations, u8 *buf, size_t buflen)
+{
+	return pbkdf2_sha1_batch(&passphrase, ssid, ssid_len, iterations,
+				 &buf, buflen, 1);
+}
+
+#else /* CONFIG_INTERNAL_SHA1 */
 
 static int pbkdf2_sha1_f(const char *passphrase, const u8 *ssid,
 			 size_t ssid_len, int iterations, unsigned int count,
@@ -90,3 +271,32 @@ int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
 
 	return 0;
 }
+
+
+/**
+ * pbkdf2_sha1_batch - PBKDF2 for multiple passphrases with the same SSID
+ * @passphrase: Array of num ASCII passphrases
+ * @ssid: SSID
+ * @ssid_len: SSID length in bytes
+ * @iterations: Number of iterations to run
+ * @buf: Array of num buffers for the generated keys
+ * @buflen: Length of each buffer in bytes
+ * @num: Number of passphrases
+ * Returns: 0 on success, -1 of failure
+ */
+int pbkdf2_sha1_batch(const char *passphrase[], const u8 *ssid,
+		      size_t ssid_len, int iterations, u8 *buf[],
+		      size_t buflen, size_t num)
+{
+	size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (pbkdf2_sha1(passphrase[i], ssid, ssid_len, iterations,
+				buf[i], buflen))
+			return -1;
+	}
+
+	return 0;
+}
+
+#endif /* CONFIG_INTERNAL_SHA1 */
@@ -102,3 +102,30 @@ int hmac_sha1(const u8 *key, size_t key_len, const u8 *data, size_t data_len,
 {
 	return hmac_sha1_vector(key, key_len, 1, &data, &data_len, mac);
 }
+
+
+#ifndef CONFIG_INTERNAL_SHA1
+/**
+ * hmac_sha1_multi - HMAC-SHA1 over a set of independent messages
+ * @key: Array of num keys
+ * @key_len: Array of num key lengths
+ * @data: Array of num messages
+ * @data_len: Array of num message lengths
+ * @mac: Array of num buffers for the MACs (20 bytes each)
+ * @num: Number of messages
+ * Returns: 0 on success, -1 on failure
+ */
+int hmac_sha1_multi(const u8 *key[], const size_t *key_len, const u8 *data[],
+		    const size_t *data_len, u8 *mac[], size_t num)
+{
+	size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (hmac_sha1(key[i], key_len[i], data[i], data_len[i],
+			      mac[i]))
+			return -1;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_INTERNAL_SHA1 */
@@ -15,6 +15,8 @@ int hmac_sha1_vector(const u8 *key, size_t key_len, size_t num_elem,
 		     const u8 *addr[], const size_t *len, u8 *mac);
 int hmac_sha1(const u8 *key, size_t key_len, const u8 *data, size_t data_len,
 	       u8 *mac);
+int hmac_sha1_multi(const u8 *key[], const size_t *key_len, const u8 *data[],
+		    const size_t *data_len, u8 *mac[], size_t num);
 int sha1_prf(const u8 *key, size_t key_len, const char *label,
 	     const u8 *data, size_t data_len, u8 *buf, size_t buf_len);
 int sha1_t_prf(const u8 *key, size_t key_len, const char *label,
@@ -24,4 +26,7 @@ int __must_check tls_prf_sha1_md5(const u8 *secret, size_t secret_len,
 				  size_t seed_len, u8 *out, size_t outlen);
 int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
 		int iterations, u8 *buf, size_t buflen);
+int pbkdf2_sha1_batch(const char *passphrase[], const u8 *ssid,
+		      size_t ssid_len, int iterations, u8 *buf[],
+		      size_t buflen, size_t num);
 #endif /* SHA1_H */
@@ -19,5 +19,63 @@ void SHA1Init(struct SHA1Context *context);
 void SHA1Update(struct SHA1Context *context, const void *data, u32 len);
 void SHA1Final(unsigned char digest[20], struct SHA1Context *context);
 void SHA1Transform(u32 state[5], const unsigned char buffer[64]);
+void SHA1TransformMulti(u32 *state[], const unsigned char *buffer[],
+			size_t num);
+
+/**
+ * struct hmac_sha1_ctx - HMAC-SHA1 context with precomputed key pads
+ * @inner: SHA-1 state after processing the key XOR ipad block
+ * @outer: SHA-1 state after processing the key XOR opad block
+ *
+ * This allows the same key to be used for number of HMAC-SHA1 operations
+ * without having to hash the padded key for each of them.
+ */
+struct hmac_sha1_ctx {
+	struct SHA1Context inner;
+	struct SHA1Context outer;
+};
+
+void hmac_sha1_init(struct hmac_sha1_ctx *ctx, const u8 *key, size_t key_len);
+void hmac_sha1_ctx_vector(const struct hmac_sha1_ctx *ctx, size_t num_elem,
+			  const u8 *addr[], const size_t *len, u8 *mac);
+void hmac_sha1_deinit(struct hmac_sha1_ctx *ctx);
+
+#if defined(__GNUC__) && !defined(CONFIG_NO_SHA_HW) && \
+	(defined(__x86_64__) || defined(__i386__) || \
+	 (defined(__aarch64__) && defined(__linux__) && !defined(__clang__)))
+#define SHA1_HW
+#endif
+
+#ifdef SHA1_HW
+
+/*
+ * sha1_hw_transform() processes the blocks with SHA-1 instructions (x86 SHA
+ * extensions or ARMv8 Cryptography Extensions) and returns 1 if the CPU
+ * supports them. sha1_hw_transform_multi() processes one block for each of
+ * the states in SIMD lanes and returns the number of states it handled.
+ */
+int sha1_hw_transform(u32 state[5], const u8 *data, size_t blocks);
+size_t sha1_hw_transform_multi(u32 *state[], const u8 *block[], size_t num);
+void sha1_hw_enable(int enabled);
+
+#else /* SHA1_HW */
+
+static inline int sha1_hw_transform(u32 state[5], const u8 *data,
+				    size_t blocks)
+{
+	return 0;
+}
+
+static inline size_t sha1_hw_transform_multi(u32 *state[], const u8 *block[],
+					     size_t num)
+{
+	return 0;
+}
+
+static inline void sha1_hw_enable(int enabled)
+{
+}
+
+#endif /* SHA1_HW */
 
 #endif /* SHA1_I_H */
@@ -0,0 +1,328 @@
+/*
+ * SHA-256 hash implementation - CPU instruction and SIMD based processing
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Single messages use the x86 SHA extensions or the ARMv8 SHA2 instructions
+ * when available at run time. Independent messages are processed in eight
+ * SIMD lanes (AVX2 when available, otherwise two SSE2/NEON registers per
+ * vector) when the CPU does not have SHA-256 instructions.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "sha256_i.h"
+
+#ifdef SHA256_HW
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SHA256_HW_X86
+#else /* x86 */
+#include <arm_neon.h>
+#define SHA256_HW_ARM
+#endif /* x86 */
+
+#define SHA256_LANES 8
+
+static int sha256_hw_enabled = 1;
+
+static const u32 K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b,
+	0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01,
+	0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7,
+	0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152,
+	0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+	0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819,
+	0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08,
+	0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+	0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+/**
+ * sha256_hw_enable - Select which CPU specific SHA-256 code is used
+ * @enabled: 0 = portable C code only, 1 = SHA-256 instructions if supported
+ *	and SIMD lanes otherwise, 2 = SIMD lanes even if SHA-256 instructions
+ *	are supported
+ *
+ * This is mainly for testing and benchmarking the alternative code paths.
+ */
+void sha256_hw_enable(int enabled)
+{
+	sha256_hw_enabled = enabled;
+}
+
+
+#ifdef SHA256_HW_X86
+
+/*
+ * Four rounds (group j of 0..15) with the message schedule for the following
+ * groups: W[t] for group g is sha256msg2(sha256msg1(M[g-4], M[g-3]) +
+ * W[t-7..t-4], M[g-1]). The sha256msg1 result for group j+3 overwrites
+ * M[j-1], so the group j+1 words are completed first.
+ */
+#define SHA256_NI_GROUP(j)						\
+do {									\
+	wk = _mm_add_epi32(msg[(j) & 3],				\
+			   _mm_loadu_si128((const __m128i *) &K[4 * (j)])); \
+	state1 = _mm_sha256rnds2_epu32(state1, state0, wk);		\
+	wk = _mm_shuffle_epi32(wk, 0x0E);				\
+	state0 = _mm_sha256rnds2_epu32(state0, state1, wk);		\
+	if ((j) >= 3 && (j) <= 14) {					\
+		tmp = _mm_alignr_epi8(msg[(j) & 3], msg[((j) + 3) & 3], 4); \
+		msg[((j) + 1) & 3] = _mm_add_epi32(msg[((j) + 1) & 3], tmp); \
+		msg[((j) + 1) & 3] = _mm_sha256msg2_epu32(msg[((j) + 1) & 3], \
+							  msg[(j) & 3]); \
+	}								\
+	if ((j) >= 1 && (j) <= 12)					\
+		msg[((j) + 3) & 3] = _mm_sha256msg1_epu32(msg[((j) + 3) & 3], \
+							  msg[(j) & 3]); \
+} while (0)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_ni_transform(u32 state[8], const u8 *data, size_t blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					    0x0405060700010203ULL);
+	__m128i state0, state1, save0, save1, tmp, wk, msg[4];
+	int i;
+
+	/* state0 = ABEF, state1 = CDGH (most significant word first) */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &state[0]),
+				0xB1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)
+						   &state[4]), 0x1B);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+	while (blocks--) {
+		save0 = state0;
+		save1 = state1;
+
+		for (i = 0; i < 4; i++)
+			msg[i] = _mm_shuffle_epi8(
+				_mm_loadu_si128((const __m128i *)
+						(data + 16 * i)), mask);
+
+		SHA256_NI_GROUP(0);
+		SHA256_NI_GROUP(1);
+		SHA256_NI_GROUP(2);
+		SHA256_NI_GROUP(3);
+		SHA256_NI_GROUP(4);
+		SHA256_NI_GROUP(5);
+		SHA256_NI_GROUP(6);
+		SHA256_NI_GROUP(7);
+		SHA256_NI_GROUP(8);
+		SHA256_NI_GROUP(9);
+		SHA256_NI_GROUP(10);
+		SHA256_NI_GROUP(11);
+		SHA256_NI_GROUP(12);
+		SHA256_NI_GROUP(13);
+		SHA256_NI_GROUP(14);
+		SHA256_NI_GROUP(15);
+
+		state0 = _mm_add_epi32(state0, save0);
+		state1 = _mm_add_epi32(state1, save1);
+		data += 64;
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1B);
+	state1 = _mm_shuffle_epi32(state1, 0xB1);
+	_mm_storeu_si128((__m128i *) &state[0],
+			 _mm_blend_epi16(tmp, state1, 0xF0));
+	_mm_storeu_si128((__m128i *) &state[4],
+			 _mm_alignr_epi8(state1, tmp, 8));
+}
+
+#endif /* SHA256_HW_X86 */
+
+
+#ifdef SHA256_HW_ARM
+
+/*
+ * Four rounds (group j of 0..15) with the message schedule for the following
+ * groups: W[t] for group g is sha256su1(sha256su0(M[g-4], M[g-3]), M[g-2],
+ * M[g-1]).
+ */
+#define SHA256_CE_GROUP(j)						\
+do {									\
+	wk = vaddq_u32(msg[(j) & 3], vld1q_u32(&K[4 * (j)]));		\
+	tmp = abcd;							\
+	abcd = vsha256hq_u32(abcd, efgh, wk);				\
+	efgh = vsha256h2q_u32(efgh, tmp, wk);				\
+	if ((j) >= 3 && (j) <= 14)					\
+		msg[((j) + 1) & 3] = vsha256su1q_u32(msg[((j) + 1) & 3], \
+						     msg[((j) + 3) & 3], \
+						     msg[(j) & 3]);	\
+	if ((j) >= 1 && (j) <= 12)					\
+		msg[((j) + 3) & 3] = vsha256su0q_u32(msg[((j) + 3) & 3], \
+						     msg[(j) & 3]);	\
+} while (0)
+
+__attribute__((target("+crypto")))
+static void sha256_ce_transform(u32 state[8], const u8 *data, size_t blocks)
+{
+	uint32x4_t abcd, efgh, save0, save1, tmp, wk, msg[4];
+	int i;
+
+	abcd = vld1q_u32(&state[0]);
+	efgh = vld1q_u32(&state[4]);
+
+	while (blocks--) {
+		save0 = abcd;
+		save1 = efgh;
+
+		for (i = 0; i < 4; i++)
+			msg[i] = vreinterpretq_u32_u8(
+				vrev32q_u8(vld1q_u8(data + 16 * i)));
+
+		SHA256_CE_GROUP(0);
+		SHA256_CE_GROUP(1);
+		SHA256_CE_GROUP(2);
+		SHA256_CE_GROUP(3);
+		SHA256_CE_GROUP(4);
+		SHA256_CE_GROUP(5);
+		SHA256_CE_GROUP(6);
+		SHA256_CE_GROUP(7);
+		SHA256_CE_GROUP(8);
+		SHA256_CE_GROUP(9);
+		SHA256_CE_GROUP(10);
+		SHA256_CE_GROUP(11);
+		SHA256_CE_GROUP(12);
+		SHA256_CE_GROUP(13);
+		SHA256_CE_GROUP(14);
+		SHA256_CE_GROUP(15);
+
+		abcd = vaddq_u32(abcd, save0);
+		efgh = vaddq_u32(efgh, save1);
+		data += 64;
+	}
+
+	vst1q_u32(&state[0], abcd);
+	vst1q_u32(&state[4], efgh);
+}
+
+#endif /* SHA256_HW_ARM */
+
+
+int sha256_hw_transform(u32 state[8], const u8 *data, size_t blocks)
+{
+	if (!(cpu_features() & CPU_FEATURE_SHA256) || sha256_hw_enabled != 1)
+		return 0;
+#ifdef SHA256_HW_X86
+	sha256_ni_transform(state, data, blocks);
+#endif /* SHA256_HW_X86 */
+#ifdef SHA256_HW_ARM
+	sha256_ce_transform(state, data, blocks);
+#endif /* SHA256_HW_ARM */
+	return 1;
+}
+
+
+/*
+ * Portable SIMD code using the GCC vector extensions. Each vector element is
+ * one lane, i.e., one independent message. This is compiled both for the
+ * baseline instruction set and for AVX2.
+ */
+
+typedef u32 sha256_vec __attribute__((vector_size(4 * SHA256_LANES)));
+
+#define VROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define VSIGMA0(x) (VROR(x, 2) ^ VROR(x, 13) ^ VROR(x, 22))
+#define VSIGMA1(x) (VROR(x, 6) ^ VROR(x, 11) ^ VROR(x, 25))
+#define VGAMMA0(x) (VROR(x, 7) ^ VROR(x, 18) ^ ((x) >> 3))
+#define VGAMMA1(x) (VROR(x, 17) ^ VROR(x, 19) ^ ((x) >> 10))
+
+static inline __attribute__((always_inline))
+void sha256_vec_transform(u32 *state[SHA256_LANES],
+			  const u8 *block[SHA256_LANES])
+{
+	sha256_vec s[8], save[8], w[16], t0, t1;
+	int i, l;
+
+	for (i = 0; i < 16; i++)
+		for (l = 0; l < SHA256_LANES; l++)
+			w[i][l] = WPA_GET_BE32(block[l] + 4 * i);
+	for (i = 0; i < 8; i++) {
+		for (l = 0; l < SHA256_LANES; l++)
+			s[i][l] = state[l][i];
+		save[i] = s[i];
+	}
+
+	for (i = 0; i < 64; i++) {
+		if (i >= 16)
+			w[i & 15] += VGAMMA1(w[(i - 2) & 15]) +
+				w[(i - 7) & 15] + VGAMMA0(w[(i - 15) & 15]);
+		t0 = s[7] + VSIGMA1(s[4]) + (s[6] ^ (s[4] & (s[5] ^ s[6]))) +
+			K[i] + w[i & 15];
+		t1 = VSIGMA0(s[0]) + (((s[0] | s[1]) & s[2]) | (s[0] & s[1]));
+		s[7] = s[6];
+		s[6] = s[5];
+		s[5] = s[4];
+		s[4] = s[3] + t0;
+		s[3] = s[2];
+		s[2] = s[1];
+		s[1] = s[0];
+		s[0] = t0 + t1;
+	}
+
+	for (i = 0; i < 8; i++) {
+		s[i] += save[i];
+		for (l = 0; l < SHA256_LANES; l++)
+			state[l][i] = s[i][l];
+	}
+}
+
+
+#ifdef SHA256_HW_X86
+__attribute__((target("avx2")))
+static void sha256_vec_transform_avx2(u32 *state[SHA256_LANES],
+				      const u8 *block[SHA256_LANES])
+{
+	sha256_vec_transform(state, block);
+}
+#endif /* SHA256_HW_X86 */
+
+
+static void sha256_vec_transform_base(u32 *state[SHA256_LANES],
+				      const u8 *block[SHA256_LANES])
+{
+	sha256_vec_transform(state, block);
+}
+
+
+size_t sha256_hw_transform_multi(u32 *state[], const u8 *block[], size_t num)
+{
+	size_t done;
+	unsigned int caps = cpu_features();
+
+	/*
+	 * The SHA-256 instructions are faster per message than the SIMD lanes,
+	 * so leave all messages to sha256_transform() when they are available.
+	 */
+	if (!sha256_hw_enabled ||
+	    ((caps & CPU_FEATURE_SHA256) && sha256_hw_enabled == 1))
+		return 0;
+
+	for (done = 0; done + SHA256_LANES <= num; done += SHA256_LANES) {
+#ifdef SHA256_HW_X86
+		if (caps & CPU_FEATURE_AVX2) {
+			sha256_vec_transform_avx2(&state[done], &block[done]);
+			continue;
+		}
+#endif /* SHA256_HW_X86 */
+		sha256_vec_transform_base(&state[done], &block[done]);
+	}
+
+	return done;
+}
+
+#endif /* SHA256_HW */
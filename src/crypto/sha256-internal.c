@@ -78,15 +78,18 @@ static const unsigned long K[64] = {
 #endif
 
 /* compress 512-bits */
-static int sha256_compress(struct sha256_state *md, unsigned char *buf)
+static int sha256_compress(u32 state[8], const unsigned char *buf)
 {
 	u32 S[8], W[64], t0, t1;
 	u32 t;
 	int i;
 
+	if (sha256_hw_transform(state, buf, 1))
+		return 0;
+
 	/* copy state into S */
 	for (i = 0; i < 8; i++) {
-		S[i] = md->state[i];
+		S[i] = state[i];
 	}
 
 	/* copy the state into 512-bits into W[0..15] */
@@ -114,7 +117,7 @@ static int sha256_compress(struct sha256_state *md, unsigned char *buf)
 
 	/* feedback */
 	for (i = 0; i < 8; i++) {
-		md->state[i] = md->state[i] + S[i];
+		state[i] = state[i] + S[i];
 	}
 	return 0;
 }
@@ -152,11 +155,16 @@ int sha256_process(struct sha256_state *md, const unsigned char *in,
 
 	while (inlen > 0) {
 		if (md->curlen == 0 && inlen >= SHA256_BLOCK_SIZE) {
-			if (sha256_compress(md, (unsigned char *) in) < 0)
+			n = inlen / SHA256_BLOCK_SIZE;
+			if (sha256_hw_transform(md->state, in, n))
+				n *= SHA256_BLOCK_SIZE;
+			else if (sha256_compress(md->state, in) < 0)
 				return -1;
-			md->length += SHA256_BLOCK_SIZE * 8;
-			in += SHA256_BLOCK_SIZE;
-			inlen -= SHA256_BLOCK_SIZE;
+			else
+				n = SHA256_BLOCK_SIZE;
+			md->length += n * 8;
+			in += n;
+			inlen -= n;
 		} else {
 			n = MIN(inlen, (SHA256_BLOCK_SIZE - md->curlen));
 			os_memcpy(md->buf + md->curlen, in, n);
@@ -164,7 +172,7 @@ int sha256_process(struct sha256_state *md, const unsigned char *in,
 			in += n;
 			inlen -= n;
 			if (md->curlen == SHA256_BLOCK_SIZE) {
-				if (sha256_compress(md, md->buf) < 0)
+				if (sha256_compress(md->state, md->buf) < 0)
 					return -1;
 				md->length += 8 * SHA256_BLOCK_SIZE;
 				md->curlen = 0;
@@ -203,7 +211,7 @@ int sha256_done(struct sha256_state *md, unsigned char *out)
 		while (md->curlen < SHA256_BLOCK_SIZE) {
 			md->buf[md->curlen++] = (unsigned char) 0;
 		}
-		sha256_compress(md, md->buf);
+		sha256_compress(md->state, md->buf);
 		md->curlen = 0;
 	}
 
@@ -214,7 +222,7 @@ int sha256_done(struct sha256_state *md, unsigned char *out)
 
 	/* store length */
 	WPA_PUT_BE64(md->buf + 56, md->length);
-	sha256_compress(md, md->buf);
+	sha256_compress(md->state, md->buf);
 
 	/* copy output */
 	for (i = 0; i < 8; i++)
@@ -224,3 +232,156 @@ int sha256_done(struct sha256_state *md, unsigned char *out)
 }
 
 /* ===== end - public domain SHA256 implementation ===== */
+
+
+/**
+ * sha256_transform_multi - Process one block for each of a set of states
+ * @state: Array of num pointers to SHA-256 states
+ * @block: Array of num pointers to 64-octet blocks
+ * @num: Number of states
+ *
+ * The states are independent of each other, so they can be processed in
+ * parallel in SIMD lanes.
+ */
+void sha256_transform_multi(u32 *state[], const u8 *block[], size_t num)
+{
+	size_t i;
+
+	for (i = sha256_hw_transform_multi(state, block, num); i < num; i++)
+		sha256_compress(state[i], block[i]);
+}
+
+
+#define SHA256_MULTI_LANES 8
+
+/*
+ * Complete the hashes of messages for which the first prefix_len octets
+ * (a multiple of 64) have already been processed into state[i]. Each round
+ * processes the next block of all the messages that are not yet finished.
+ */
+static void sha256_multi_finish(u32 (*state)[8], size_t prefix_len,
+				const u8 *data[], const size_t *len,
+				u8 *mac[], size_t num)
+{
+	u8 tail[SHA256_MULTI_LANES][2 * SHA256_BLOCK_SIZE];
+	size_t full[SHA256_MULTI_LANES], blocks[SHA256_MULTI_LANES];
+	u32 *st[SHA256_MULTI_LANES];
+	const u8 *blk[SHA256_MULTI_LANES];
+	size_t i, k, b, n, rem, max_blocks;
+
+	for (; num > 0; num -= n, state += n, data += n, len += n, mac += n) {
+		n = num < SHA256_MULTI_LANES ? num : SHA256_MULTI_LANES;
+		max_blocks = 0;
+		for (i = 0; i < n; i++) {
+			full[i] = len[i] / SHA256_BLOCK_SIZE;
+			rem = len[i] % SHA256_BLOCK_SIZE;
+			blocks[i] = full[i] + (rem < 56 ? 1 : 2);
+			os_memset(tail[i], 0, sizeof(tail[i]));
+			os_memcpy(tail[i], data[i] + SHA256_BLOCK_SIZE * full[i],
+				  rem);
+			tail[i][rem] = 0x80;
+			WPA_PUT_BE64(&tail[i][SHA256_BLOCK_SIZE *
+					      (blocks[i] - full[i]) - 8],
+				     (u64) (prefix_len + len[i]) * 8);
+			if (blocks[i] > max_blocks)
+				max_blocks = blocks[i];
+		}
+
+		for (b = 0; b < max_blocks; b++) {
+			for (i = 0, k = 0; i < n; i++) {
+				if (b >= blocks[i])
+					continue;
+				st[k] = state[i];
+				blk[k++] = b < full[i] ?
+					data[i] + SHA256_BLOCK_SIZE * b :
+					tail[i] + SHA256_BLOCK_SIZE *
+					(b - full[i]);
+			}
+			sha256_transform_multi(st, blk, k);
+		}
+
+		for (i = 0; i < n; i++) {
+			for (k = 0; k < 8; k++)
+				WPA_PUT_BE32(mac[i] + 4 * k, state[i][k]);
+		}
+	}
+
+	os_memset(tail, 0, sizeof(tail));
+}
+
+
+/**
+ * hmac_sha256_multi - HMAC-SHA256 over a set of independent messages
+ * @key: Array of num keys
+ * @key_len: Array of num key lengths
+ * @data: Array of num messages
+ * @data_len: Array of num message lengths
+ * @mac: Array of num buffers for the MACs (32 bytes each)
+ * @num: Number of messages
+ * Returns: 0 on success, -1 on failure
+ *
+ * This is equivalent to calling hmac_sha256() for each message, but the
+ * messages are processed in parallel when the CPU supports SIMD processing of
+ * multiple SHA-256 blocks.
+ */
+int hmac_sha256_multi(const u8 *key[], const size_t *key_len,
+		      const u8 *data[], const size_t *data_len, u8 *mac[],
+		      size_t num)
+{
+	u8 pad[2 * SHA256_MULTI_LANES][SHA256_BLOCK_SIZE];
+	u8 tk[SHA256_MULTI_LANES][SHA256_MAC_LEN];
+	u32 state[2 * SHA256_MULTI_LANES][8];
+	u32 *st[2 * SHA256_MULTI_LANES];
+	const u8 *blk[2 * SHA256_MULTI_LANES];
+	const u8 *inner[SHA256_MULTI_LANES];
+	u8 *inner_mac[SHA256_MULTI_LANES];
+	size_t inner_len[SHA256_MULTI_LANES];
+	struct sha256_state init;
+	const u8 *k;
+	size_t i, j, n, klen;
+
+	sha256_init(&init);
+
+	for (; num > 0; num -= n, key += n, key_len += n, data += n,
+		     data_len += n, mac += n) {
+		n = num < SHA256_MULTI_LANES ? num : SHA256_MULTI_LANES;
+		for (i = 0; i < n; i++) {
+			k = key[i];
+			klen = key_len[i];
+			/* if key is longer than 64 bytes reset it to
+			 * key = SHA256(key) */
+			if (klen > SHA256_BLOCK_SIZE) {
+				if (sha256_vector(1, &key[i], &key_len[i],
+						  tk[i]) < 0)
+					return -1;
+				k = tk[i];
+				klen = SHA256_MAC_LEN;
+			}
+			os_memset(pad[i], 0x36, SHA256_BLOCK_SIZE);
+			os_memset(pad[n + i], 0x5c, SHA256_BLOCK_SIZE);
+			for (j = 0; j < klen; j++) {
+				pad[i][j] ^= k[j];
+				pad[n + i][j] ^= k[j];
+			}
+			os_memcpy(state[i], init.state, sizeof(state[i]));
+			os_memcpy(state[n + i], init.state, sizeof(state[i]));
+			st[i] = state[i];
+			st[n + i] = state[n + i];
+			blk[i] = pad[i];
+			blk[n + i] = pad[n + i];
+			inner[i] = inner_mac[i] = tk[i];
+			inner_len[i] = SHA256_MAC_LEN;
+		}
+		sha256_transform_multi(st, blk, 2 * n);
+
+		sha256_multi_finish(state, SHA256_BLOCK_SIZE, data, data_len,
+				    inner_mac, n);
+		sha256_multi_finish(&state[n], SHA256_BLOCK_SIZE, inner,
+				    inner_len, mac, n);
+	}
+
+	os_memset(pad, 0, sizeof(pad));
+	os_memset(tk, 0, sizeof(tk));
+	os_memset(state, 0, sizeof(state));
+	return 0;
+}
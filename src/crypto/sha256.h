@@ -15,6 +15,9 @@ int hmac_sha256_vector(const u8 *key, size_t key_len, size_t num_elem,
 		       const u8 *addr[], const size_t *len, u8 *mac);
 int hmac_sha256(const u8 *key, size_t key_len, const u8 *data,
 		size_t data_len, u8 *mac);
+int hmac_sha256_multi(const u8 *key[], const size_t *key_len,
+		      const u8 *data[], const size_t *data_len, u8 *mac[],
+		      size_t num);
 void sha256_prf(const u8 *key, size_t key_len, const char *label,
 	      const u8 *data, size_t data_len, u8 *buf, size_t buf_len);
 void sha256_prf_bits(const u8 *key, size_t key_len, const char *label,
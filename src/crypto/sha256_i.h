@@ -21,5 +21,44 @@ void sha256_init(struct sha256_state *md);
 int sha256_process(struct sha256_state *md, const unsigned char *in,
 		   unsigned long inlen);
 int sha256_done(struct sha256_state *md, unsigned char *out);
+void sha256_transform_multi(u32 *state[], const u8 *block[], size_t num);
+
+#if defined(__GNUC__) && !defined(CONFIG_NO_SHA_HW) && \
+	(defined(__x86_64__) || defined(__i386__) || \
+	 (defined(__aarch64__) && defined(__linux__) && !defined(__clang__)))
+#define SHA256_HW
+#endif
+
+#ifdef SHA256_HW
+
+/*
+ * sha256_hw_transform() processes the blocks with SHA-256 instructions (x86
+ * SHA extensions or ARMv8 Cryptography Extensions) and returns 1 if the CPU
+ * supports them. sha256_hw_transform_multi() processes one block for each of
+ * the states in SIMD lanes and returns the number of states it handled.
+ */
+int sha256_hw_transform(u32 state[8], const u8 *data, size_t blocks);
+size_t sha256_hw_transform_multi(u32 *state[], const u8 *block[], size_t num);
+void sha256_hw_enable(int enabled);
+
+#else /* SHA256_HW */
+
+static inline int sha256_hw_transform(u32 state[8], const u8 *data,
+				      size_t blocks)
+{
+	return 0;
+}
+
+static inline size_t sha256_hw_transform_multi(u32 *state[],
+					       const u8 *block[], size_t num)
+{
+	return 0;
+}
+
+static inline void sha256_hw_enable(int enabled)
+{
+}
+
+#endif /* SHA256_HW */
 
 #endif /* SHA256_I_H */
@@ -75,11 +75,42 @@ struct tls_config {
 	int fips_mode;
 	int cert_in_cb;
 
+	/* Server side session resumption (0 = disabled) */
+	unsigned int tls_session_lifetime;
+	size_t tls_session_cache_size;
+	const char *tls_session_cache_file;
+	int tls_session_tickets;
+	unsigned int tls_session_ticket_key_lifetime;
+
 	void (*event_cb)(void *ctx, enum tls_event ev,
 			 union tls_event_data *data);
 	void *cb_ctx;
 };
 
+/**
+ * struct tls_session_stats - Server side session resumption statistics
+ * @entries: Number of sessions currently in the session cache
+ * @hits: Sessions resumed based on the session cache
+ * @misses: Session IDs offered by the client, but not found in the cache
+ * @timeouts: Sessions expired because of tls_session_lifetime
+ * @evictions: Sessions dropped because the cache was full
+ * @ticket_hits: Sessions resumed based on an RFC 5077 session ticket
+ * @ticket_misses: Session tickets that could not be used for resumption
+ * @tickets_issued: Number of NewSessionTicket messages sent
+ * @ticket_key_rotations: Number of ticket encryption key rotations
+ */
+struct tls_session_stats {
+	unsigned int entries;
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int timeouts;
+	unsigned int evictions;
+	unsigned int ticket_hits;
+	unsigned int ticket_misses;
+	unsigned int tickets_issued;
+	unsigned int ticket_key_rotations;
+};
+
 #define TLS_CONN_ALLOW_SIGN_RSA_MD5 BIT(0)
 #define TLS_CONN_DISABLE_TIME_CHECKS BIT(1)
 #define TLS_CONN_DISABLE_SESSION_TICKET BIT(2)
@@ -522,6 +553,12 @@ int tls_connection_get_write_alerts(void *tls_ctx,
 int tls_connection_get_keyblock_size(void *tls_ctx,
 				     struct tls_connection *conn);
 
+/*
+ * TLS_CAPABILITY_THREADS - Separate connections may be processed concurrently
+ * from different threads (e.g., server handshake processing in worker threads)
+ */
+#define TLS_CAPABILITY_THREADS BIT(0)
+
 /**
  * tls_capabilities - Get supported TLS capabilities
  * @tls_ctx: TLS context data from tls_init()
@@ -529,6 +566,44 @@ int tls_connection_get_keyblock_size(void *tls_ctx,
  */
 unsigned int tls_capabilities(void *tls_ctx);
 
+/**
+ * tls_connection_set_success_data - Mark the session resumable
+ * @tls_ctx: TLS context data from tls_init()
+ * @conn: Connection context data from tls_connection_init()
+ * @data: Data to store with the session (ownership is transferred)
+ * Returns: 0 on success, -1 on failure
+ *
+ * This function is used on the server side to indicate that the peer has been
+ * successfully authenticated over this connection. The session is added to the
+ * server session cache only after this has been called, so a session that did
+ * not complete authentication cannot be used for abbreviated handshakes. The
+ * data is returned with tls_connection_get_success_data() when the session is
+ * resumed. This can be called before the handshake has been completed if
+ * completing the handshake itself authenticates the peer (e.g., EAP-TLS);
+ * session tickets are only issued in that case.
+ */
+int tls_connection_set_success_data(void *tls_ctx,
+				    struct tls_connection *conn,
+				    struct wpabuf *data);
+
+/**
+ * tls_connection_get_success_data - Get data stored with a resumed session
+ * @tls_ctx: TLS context data from tls_init()
+ * @conn: Connection context data from tls_connection_init()
+ * Returns: Data from tls_connection_set_success_data() or %NULL if not
+ * available
+ */
+const struct wpabuf * tls_connection_get_success_data(
+	void *tls_ctx, struct tls_connection *conn);
+
+/**
+ * tls_get_session_stats - Get server side session resumption statistics
+ * @tls_ctx: TLS context data from tls_init()
+ * @stats: Buffer for returning the statistics
+ * Returns: 0 on success, -1 if not supported
+ */
+int tls_get_session_stats(void *tls_ctx, struct tls_session_stats *stats);
+
 typedef int (*tls_session_ticket_cb)
 (void *ctx, const u8 *ticket, size_t len, const u8 *client_random,
  const u8 *server_random, u8 *master_secret);
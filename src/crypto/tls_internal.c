@@ -15,6 +15,7 @@
 #include "tls.h"
 #include "tls/tlsv1_client.h"
 #include "tls/tlsv1_server.h"
+#include "tls/tlsv1_server_session.h"
 
 
 static int tls_ref_count = 0;
@@ -23,6 +24,7 @@ struct tls_global {
 	int server;
 	struct tlsv1_credentials *server_cred;
 	int check_crl;
+	struct tlsv1_server_sessions *sessions;
 };
 
 struct tls_connection {
@@ -52,6 +54,21 @@ void * tls_init(const struct tls_config *conf)
 	if (global == NULL)
 		return NULL;
 
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	if (conf && conf->tls_session_lifetime) {
+		global->sessions = tlsv1_server_sessions_init(
+			conf->tls_session_lifetime,
+			conf->tls_session_cache_size,
+			conf->tls_session_tickets,
+			conf->tls_session_ticket_key_lifetime,
+			conf->tls_session_cache_file);
+		if (global->sessions == NULL) {
+			os_free(global);
+			return NULL;
+		}
+	}
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
+
 	return global;
 }
 
@@ -68,6 +85,9 @@ void tls_deinit(void *ssl_ctx)
 		tlsv1_server_global_deinit();
 #endif /* CONFIG_TLS_INTERNAL_SERVER */
 	}
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	tlsv1_server_sessions_deinit(global->sessions);
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
 	os_free(global);
 }
 
@@ -104,6 +124,7 @@ struct tls_connection * tls_connection_init(void *tls_ctx)
 			os_free(conn);
 			return NULL;
 		}
+		tlsv1_server_set_sessions(conn->server, global->sessions);
 	}
 #endif /* CONFIG_TLS_INTERNAL_SERVER */
 
@@ -629,7 +650,49 @@ int tls_connection_get_keyblock_size(void *tls_ctx,
 
 unsigned int tls_capabilities(void *tls_ctx)
 {
+#if defined(CONFIG_TLS_WORKERS) && defined(CONFIG_TLS_INTERNAL_SERVER)
+	return TLS_CAPABILITY_THREADS;
+#else /* CONFIG_TLS_WORKERS && CONFIG_TLS_INTERNAL_SERVER */
 	return 0;
+#endif /* CONFIG_TLS_WORKERS && CONFIG_TLS_INTERNAL_SERVER */
+}
+
+
+int tls_connection_set_success_data(void *tls_ctx,
+				    struct tls_connection *conn,
+				    struct wpabuf *data)
+{
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	if (conn->server)
+		return tlsv1_server_set_success_data(conn->server, data);
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
+	wpabuf_free(data);
+	return -1;
+}
+
+
+const struct wpabuf * tls_connection_get_success_data(
+	void *tls_ctx, struct tls_connection *conn)
+{
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	if (conn->server)
+		return tlsv1_server_get_success_data(conn->server);
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
+	return NULL;
+}
+
+
+int tls_get_session_stats(void *tls_ctx, struct tls_session_stats *stats)
+{
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	struct tls_global *global = tls_ctx;
+
+	if (global->sessions) {
+		tlsv1_server_sessions_get_stats(global->sessions, stats);
+		return 0;
+	}
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
+	return -1;
 }
 
 
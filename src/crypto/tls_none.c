@@ -192,3 +192,25 @@ unsigned int tls_capabilities(void *tls_ctx)
 {
 	return 0;
 }
+
+
+int tls_connection_set_success_data(void *tls_ctx,
+				    struct tls_connection *conn,
+				    struct wpabuf *data)
+{
+	wpabuf_free(data);
+	return -1;
+}
+
+
+const struct wpabuf * tls_connection_get_success_data(
+	void *tls_ctx, struct tls_connection *conn)
+{
+	return NULL;
+}
+
+
+int tls_get_session_stats(void *tls_ctx, struct tls_session_stats *stats)
+{
+	return -1;
+}
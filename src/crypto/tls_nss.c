@@ -636,6 +636,28 @@ unsigned int tls_capabilities(void *tls_ctx)
 }
 
 
+int tls_connection_set_success_data(void *tls_ctx,
+				    struct tls_connection *conn,
+				    struct wpabuf *data)
+{
+	wpabuf_free(data);
+	return -1;
+}
+
+
+const struct wpabuf * tls_connection_get_success_data(
+	void *tls_ctx, struct tls_connection *conn)
+{
+	return NULL;
+}
+
+
+int tls_get_session_stats(void *tls_ctx, struct tls_session_stats *stats)
+{
+	return -1;
+}
+
+
 int tls_connection_set_session_ticket_cb(void *tls_ctx,
 					 struct tls_connection *conn,
 					 tls_session_ticket_cb cb,
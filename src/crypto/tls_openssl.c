@@ -74,9 +74,11 @@ struct tls_context {
 	void *cb_ctx;
 	int cert_in_cb;
 	char *ocsp_stapling_response;
+	unsigned int tls_session_lifetime;
 };
 
 static struct tls_context *tls_global = NULL;
+static int tls_ex_idx_session = -1;
 
 
 struct tls_connection {
@@ -108,6 +110,9 @@ struct tls_connection {
 	X509 *peer_cert;
 	X509 *peer_issuer;
 	X509 *peer_issuer_issuer;
+
+	/* Success data waiting for the handshake to complete (server) */
+	struct wpabuf *success_data;
 };
 
 
@@ -120,11 +125,20 @@ static struct tls_context * tls_context_new(const struct tls_config *conf)
 		context->event_cb = conf->event_cb;
 		context->cb_ctx = conf->cb_ctx;
 		context->cert_in_cb = conf->cert_in_cb;
+		context->tls_session_lifetime = conf->tls_session_lifetime;
 	}
 	return context;
 }
 
 
+static void tls_session_data_free(void *parent, void *ptr,
+				  CRYPTO_EX_DATA *ad, int idx, long argl,
+				  void *argp)
+{
+	wpabuf_free(ptr);
+}
+
+
 #ifdef CONFIG_NO_STDOUT_DEBUG
 
 static void _tls_show_errors(void)
@@ -810,6 +824,24 @@ void * tls_init(const struct tls_config *conf)
 	SSL_CTX_set_app_data(ssl, context);
 #endif /* OPENSSL_SUPPORTS_CTX_APP_DATA */
 
+	if (conf && conf->tls_session_lifetime) {
+		SSL_CTX_set_session_cache_mode(ssl, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_sess_set_cache_size(ssl, conf->tls_session_cache_size);
+		SSL_CTX_set_timeout(ssl, conf->tls_session_lifetime);
+		if (tls_ex_idx_session < 0)
+			tls_ex_idx_session = SSL_SESSION_get_ex_new_index(
+				0, NULL, NULL, NULL, tls_session_data_free);
+		if (tls_ex_idx_session < 0) {
+			tls_deinit(ssl);
+			return NULL;
+		}
+		if (conf->tls_session_tickets)
+			wpa_printf(MSG_DEBUG, "OpenSSL: Session tickets not "
+				   "supported for server side resumption");
+	} else {
+		SSL_CTX_set_session_cache_mode(ssl, SSL_SESS_CACHE_OFF);
+	}
+
 #ifndef OPENSSL_NO_ENGINE
 	if (conf &&
 	    (conf->opensc_engine_path || conf->pkcs11_engine_path ||
@@ -843,6 +875,7 @@ void tls_deinit(void *ssl_ctx)
 
 	tls_openssl_ref_count--;
 	if (tls_openssl_ref_count == 0) {
+		crypto_global_deinit();
 #ifndef OPENSSL_NO_ENGINE
 		ENGINE_cleanup();
 #endif /* OPENSSL_NO_ENGINE */
@@ -1042,8 +1075,17 @@ struct tls_connection * tls_connection_init(void *ssl_ctx)
 
 void tls_connection_deinit(void *ssl_ctx, struct tls_connection *conn)
 {
+	SSL_SESSION *sess;
+
 	if (conn == NULL)
 		return;
+	sess = SSL_get_session(conn->ssl);
+	if (conn->context->tls_session_lifetime && sess &&
+	    SSL_SESSION_get_ex_data(sess, tls_ex_idx_session) == NULL) {
+		/* Do not allow resumption of unauthenticated sessions */
+		SSL_CTX_remove_session(ssl_ctx, sess);
+	}
+	wpabuf_free(conn->success_data);
 	SSL_free(conn->ssl);
 	tls_engine_deinit(conn);
 	os_free(conn->subject_match);
@@ -1804,13 +1846,28 @@ int tls_connection_set_verify(void *ssl_ctx, struct tls_connection *conn,
 
 	SSL_set_accept_state(conn->ssl);
 
+	if (conn->context->tls_session_lifetime) {
+		u8 id_ctx[8];
+
+		/*
+		 * Sessions are only resumable within the same verification
+		 * policy. Session tickets are not used since the success data
+		 * stored with the session would not be included in them.
+		 */
+		os_memcpy(id_ctx, "hostapd", 7);
+		id_ctx[7] = verify_peer ? 1 : 0;
+		SSL_set_session_id_context(conn->ssl, id_ctx, sizeof(id_ctx));
+#ifdef SSL_OP_NO_TICKET
+		SSL_set_options(conn->ssl, SSL_OP_NO_TICKET);
+#endif /*  SSL_OP_NO_TICKET */
+		return 0;
+	}
+
 	/*
 	 * Set session id context in order to avoid fatal errors when client
 	 * tries to resume a session. However, set the context to a unique
-	 * value in order to effectively disable session resumption for now
-	 * since not all areas of the server code are ready for it (e.g.,
-	 * EAP-TTLS needs special handling for Phase 2 after abbreviated TLS
-	 * handshake).
+	 * value in order to effectively disable session resumption when
+	 * tls_session_lifetime is not configured.
 	 */
 	counter++;
 	SSL_set_session_id_context(conn->ssl,
@@ -2651,6 +2708,29 @@ openssl_get_appl_data(struct tls_connection *conn, size_t max_len)
 }
 
 
+static void tls_connection_attach_success_data(struct tls_connection *conn)
+{
+	SSL_SESSION *sess;
+	struct wpabuf *old;
+
+	if (conn->success_data == NULL || !SSL_is_init_finished(conn->ssl) ||
+	    conn->ssl->hit)
+		return;
+
+	sess = SSL_get_session(conn->ssl);
+	if (sess == NULL)
+		return;
+	old = SSL_SESSION_get_ex_data(sess, tls_ex_idx_session);
+	if (SSL_SESSION_set_ex_data(sess, tls_ex_idx_session,
+				    conn->success_data) != 1) {
+		wpa_printf(MSG_INFO, "OpenSSL: Failed to store session data");
+		return;
+	}
+	wpabuf_free(old);
+	conn->success_data = NULL;
+}
+
+
 static struct wpabuf *
 openssl_connection_handshake(struct tls_connection *conn,
 			     const struct wpabuf *in_data,
@@ -2665,6 +2745,9 @@ openssl_connection_handshake(struct tls_connection *conn,
 	if (out_data == NULL)
 		return NULL;
 
+	if (server)
+		tls_connection_attach_success_data(conn);
+
 	if (SSL_is_init_finished(conn->ssl) && appl_data && in_data)
 		*appl_data = openssl_get_appl_data(conn, wpabuf_len(in_data));
 
@@ -3325,6 +3408,56 @@ unsigned int tls_capabilities(void *tls_ctx)
 }
 
 
+int tls_connection_set_success_data(void *tls_ctx,
+				    struct tls_connection *conn,
+				    struct wpabuf *data)
+{
+	if (conn == NULL || tls_ex_idx_session < 0 ||
+	    !conn->context->tls_session_lifetime) {
+		wpabuf_free(data);
+		return -1;
+	}
+
+	wpabuf_free(conn->success_data);
+	conn->success_data = data;
+	tls_connection_attach_success_data(conn);
+	return 0;
+}
+
+
+const struct wpabuf * tls_connection_get_success_data(
+	void *tls_ctx, struct tls_connection *conn)
+{
+	SSL_SESSION *sess;
+
+	if (conn == NULL || tls_ex_idx_session < 0)
+		return NULL;
+	if (conn->success_data && !conn->ssl->hit)
+		return conn->success_data;
+	sess = SSL_get_session(conn->ssl);
+	if (sess == NULL)
+		return NULL;
+	return SSL_SESSION_get_ex_data(sess, tls_ex_idx_session);
+}
+
+
+int tls_get_session_stats(void *tls_ctx, struct tls_session_stats *stats)
+{
+	SSL_CTX *ssl = tls_ctx;
+
+	if (SSL_CTX_get_session_cache_mode(ssl) == SSL_SESS_CACHE_OFF)
+		return -1;
+
+	os_memset(stats, 0, sizeof(*stats));
+	stats->entries = SSL_CTX_sess_number(ssl);
+	stats->hits = SSL_CTX_sess_hits(ssl);
+	stats->misses = SSL_CTX_sess_misses(ssl);
+	stats->timeouts = SSL_CTX_sess_timeouts(ssl);
+	stats->evictions = SSL_CTX_sess_cache_full(ssl);
+	return 0;
+}
+
+
 #if defined(EAP_FAST) || defined(EAP_FAST_DYNAMIC) || defined(EAP_SERVER_FAST)
 /* Pre-shared secred requires a patch to openssl, so this function is
  * commented out unless explicitly needed for EAP-FAST in order to be able to
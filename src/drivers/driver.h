@@ -1691,6 +1691,25 @@ struct wpa_driver_ops {
 	 */
 	 struct wpa_scan_results * (*get_scan_results2)(void *priv);
 
+	/**
+	 * get_scan_results_cb - Fetch the latest scan results one at a time
+	 * @priv: private driver interface data
+	 * @cb: Function to call for each BSS in the scan results
+	 * @ctx: Context pointer for cb
+	 * Returns: Number of reported BSSes on success, -1 on failure
+	 *
+	 * This is an optional alternative to get_scan_results2() for callers
+	 * that do not need to keep the full set of scan results. The scan
+	 * result entry passed to cb is owned by the driver wrapper and remains
+	 * valid only for the duration of the call. Unlike get_scan_results2(),
+	 * the same BSSID,SSID pair may be reported more than once (e.g., if
+	 * the BSS was seen on multiple channels).
+	 */
+	int (*get_scan_results_cb)(void *priv,
+				   void (*cb)(void *ctx,
+					      struct wpa_scan_res *res),
+				   void *ctx);
+
 	/**
 	 * set_country - Set country
 	 * @priv: Private driver interface data
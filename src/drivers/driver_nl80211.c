@@ -562,14 +562,33 @@ static void nl80211_mark_disconnected(struct wpa_driver_nl80211_data *drv)
 }
 
 
+#define NL80211_MAX_NOISE_FREQS 100
+
+struct nl80211_noise_info {
+	int freq[NL80211_MAX_NOISE_FREQS];
+	s8 noise[NL80211_MAX_NOISE_FREQS];
+	unsigned int count;
+};
+
 struct nl80211_bss_info_arg {
 	struct wpa_driver_nl80211_data *drv;
 	struct wpa_scan_results *res;
+	size_t res_size; /* number of allocated entries in res->res */
 	unsigned int assoc_freq;
 	u8 assoc_bssid[ETH_ALEN];
+
+	/* Streaming of results with get_scan_results_cb() */
+	void (*cb)(void *ctx, struct wpa_scan_res *res);
+	void *cb_ctx;
+	struct wpa_scan_res *buf;
+	size_t buf_size;
+	unsigned int num;
+	struct nl80211_noise_info *noise;
 };
 
 static int bss_info_handler(struct nl_msg *msg, void *arg);
+static void nl80211_check_bss_status(struct wpa_driver_nl80211_data *drv,
+				     struct wpa_scan_res *r);
 
 
 /* nl80211 code */
@@ -2309,9 +2328,10 @@ static int get_noise_for_scan_results(struct nl_msg *msg, void *arg)
 		[NL80211_SURVEY_INFO_FREQUENCY] = { .type = NLA_U32 },
 		[NL80211_SURVEY_INFO_NOISE] = { .type = NLA_U8 },
 	};
-	struct wpa_scan_results *scan_results = arg;
-	struct wpa_scan_res *scan_res;
-	size_t i;
+	struct nl80211_noise_info *info = arg;
+
+	if (info->count >= NL80211_MAX_NOISE_FREQS)
+		return NL_STOP;
 
 	nla_parse(tb, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
 		  genlmsg_attrlen(gnlh, 0), NULL);
@@ -2335,30 +2355,22 @@ static int get_noise_for_scan_results(struct nl_msg *msg, void *arg)
 	if (!sinfo[NL80211_SURVEY_INFO_FREQUENCY])
 		return NL_SKIP;
 
-	for (i = 0; i < scan_results->num; ++i) {
-		scan_res = scan_results->res[i];
-		if (!scan_res)
-			continue;
-		if ((int) nla_get_u32(sinfo[NL80211_SURVEY_INFO_FREQUENCY]) !=
-		    scan_res->freq)
-			continue;
-		if (!(scan_res->flags & WPA_SCAN_NOISE_INVALID))
-			continue;
-		scan_res->noise = (s8)
-			nla_get_u8(sinfo[NL80211_SURVEY_INFO_NOISE]);
-		scan_res->flags &= ~WPA_SCAN_NOISE_INVALID;
-	}
+	info->freq[info->count] =
+		nla_get_u32(sinfo[NL80211_SURVEY_INFO_FREQUENCY]);
+	info->noise[info->count] =
+		(s8) nla_get_u8(sinfo[NL80211_SURVEY_INFO_NOISE]);
+	info->count++;
 
 	return NL_SKIP;
 }
 
 
 static int nl80211_get_noise_for_scan_results(
-	struct wpa_driver_nl80211_data *drv,
-	struct wpa_scan_results *scan_res)
+	struct wpa_driver_nl80211_data *drv, struct nl80211_noise_info *info)
 {
 	struct nl_msg *msg;
 
+	os_memset(info, 0, sizeof(*info));
 	msg = nlmsg_alloc();
 	if (!msg)
 		return -ENOMEM;
@@ -2367,14 +2379,30 @@ static int nl80211_get_noise_for_scan_results(
 
 	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, drv->ifindex);
 
-	return send_and_recv_msgs(drv, msg, get_noise_for_scan_results,
-				  scan_res);
+	return send_and_recv_msgs(drv, msg, get_noise_for_scan_results, info);
  nla_put_failure:
 	nlmsg_free(msg);
 	return -ENOBUFS;
 }
 
 
+static void nl80211_update_scan_res_noise(struct wpa_scan_res *res,
+					  const struct nl80211_noise_info *info)
+{
+	unsigned int i;
+
+	if (!(res->flags & WPA_SCAN_NOISE_INVALID))
+		return;
+	for (i = 0; i < info->count; i++) {
+		if (info->freq[i] == res->freq) {
+			res->noise = info->noise[i];
+			res->flags &= ~WPA_SCAN_NOISE_INVALID;
+			break;
+		}
+	}
+}
+
+
 static void nl80211_cqm_event(struct wpa_driver_nl80211_data *drv,
 			      struct nlattr *tb[])
 {
@@ -5390,7 +5418,7 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 	struct wpa_scan_res **tmp;
 	struct wpa_scan_res *r;
 	const u8 *ie, *beacon_ie;
-	size_t ie_len, beacon_ie_len;
+	size_t ie_len, beacon_ie_len, len;
 	u8 *pos;
 	size_t i;
 
@@ -5419,7 +5447,7 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 				   MACSTR, MAC2STR(_arg->assoc_bssid));
 		}
 	}
-	if (!res)
+	if (!res && !_arg->cb)
 		return NL_SKIP;
 	if (bss[NL80211_BSS_INFORMATION_ELEMENTS]) {
 		ie = nla_data(bss[NL80211_BSS_INFORMATION_ELEMENTS]);
@@ -5440,9 +5468,26 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 				  ie ? ie_len : beacon_ie_len))
 		return NL_SKIP;
 
-	r = os_zalloc(sizeof(*r) + ie_len + beacon_ie_len);
-	if (r == NULL)
-		return NL_SKIP;
+	len = sizeof(*r) + ie_len + beacon_ie_len;
+	if (_arg->cb) {
+		/* Reuse the same buffer for all streamed entries */
+		if (len > _arg->buf_size) {
+			size_t size = _arg->buf_size ? 2 * _arg->buf_size : 512;
+			while (size < len)
+				size *= 2;
+			os_free(_arg->buf);
+			_arg->buf = os_malloc(size);
+			_arg->buf_size = _arg->buf ? size : 0;
+			if (_arg->buf == NULL)
+				return NL_SKIP;
+		}
+		r = _arg->buf;
+		os_memset(r, 0, sizeof(*r));
+	} else {
+		r = os_zalloc(len);
+		if (r == NULL)
+			return NL_SKIP;
+	}
 	if (bss[NL80211_BSS_BSSID])
 		os_memcpy(r->bssid, nla_data(bss[NL80211_BSS_BSSID]),
 			  ETH_ALEN);
@@ -5491,6 +5536,15 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 		}
 	}
 
+	if (_arg->cb) {
+		if (_arg->noise)
+			nl80211_update_scan_res_noise(r, _arg->noise);
+		nl80211_check_bss_status(_arg->drv, r);
+		_arg->num++;
+		_arg->cb(_arg->cb_ctx, r);
+		return NL_SKIP;
+	}
+
 	/*
 	 * cfg80211 maintains separate BSS table entries for APs if the same
 	 * BSSID,SSID pair is seen on multiple channels. wpa_supplicant does
@@ -5525,14 +5579,18 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 		return NL_SKIP;
 	}
 
-	tmp = os_realloc_array(res->res, res->num + 1,
-			       sizeof(struct wpa_scan_res *));
-	if (tmp == NULL) {
-		os_free(r);
-		return NL_SKIP;
+	if (res->num == _arg->res_size) {
+		size_t size = _arg->res_size ? 2 * _arg->res_size : 32;
+		tmp = os_realloc_array(res->res, size,
+				       sizeof(struct wpa_scan_res *));
+		if (tmp == NULL) {
+			os_free(r);
+			return NL_SKIP;
+		}
+		res->res = tmp;
+		_arg->res_size = size;
 	}
-	tmp[res->num++] = r;
-	res->res = tmp;
+	res->res[res->num++] = r;
 
 	return NL_SKIP;
 }
@@ -5551,52 +5609,42 @@ static void clear_state_mismatch(struct wpa_driver_nl80211_data *drv,
 }
 
 
-static void wpa_driver_nl80211_check_bss_status(
-	struct wpa_driver_nl80211_data *drv, struct wpa_scan_results *res)
+static void nl80211_check_bss_status(struct wpa_driver_nl80211_data *drv,
+				     struct wpa_scan_res *r)
 {
-	size_t i;
-
-	for (i = 0; i < res->num; i++) {
-		struct wpa_scan_res *r = res->res[i];
-		if (r->flags & WPA_SCAN_AUTHENTICATED) {
-			wpa_printf(MSG_DEBUG, "nl80211: Scan results "
-				   "indicates BSS status with " MACSTR
-				   " as authenticated",
-				   MAC2STR(r->bssid));
-			if (is_sta_interface(drv->nlmode) &&
-			    os_memcmp(r->bssid, drv->bssid, ETH_ALEN) != 0 &&
-			    os_memcmp(r->bssid, drv->auth_bssid, ETH_ALEN) !=
-			    0) {
-				wpa_printf(MSG_DEBUG, "nl80211: Unknown BSSID"
-					   " in local state (auth=" MACSTR
-					   " assoc=" MACSTR ")",
-					   MAC2STR(drv->auth_bssid),
-					   MAC2STR(drv->bssid));
-				clear_state_mismatch(drv, r->bssid);
-			}
+	if (r->flags & WPA_SCAN_AUTHENTICATED) {
+		wpa_printf(MSG_DEBUG, "nl80211: Scan results "
+			   "indicates BSS status with " MACSTR
+			   " as authenticated", MAC2STR(r->bssid));
+		if (is_sta_interface(drv->nlmode) &&
+		    os_memcmp(r->bssid, drv->bssid, ETH_ALEN) != 0 &&
+		    os_memcmp(r->bssid, drv->auth_bssid, ETH_ALEN) != 0) {
+			wpa_printf(MSG_DEBUG, "nl80211: Unknown BSSID"
+				   " in local state (auth=" MACSTR
+				   " assoc=" MACSTR ")",
+				   MAC2STR(drv->auth_bssid),
+				   MAC2STR(drv->bssid));
+			clear_state_mismatch(drv, r->bssid);
 		}
+	}
 
-		if (r->flags & WPA_SCAN_ASSOCIATED) {
-			wpa_printf(MSG_DEBUG, "nl80211: Scan results "
-				   "indicate BSS status with " MACSTR
-				   " as associated",
-				   MAC2STR(r->bssid));
-			if (is_sta_interface(drv->nlmode) &&
-			    !drv->associated) {
-				wpa_printf(MSG_DEBUG, "nl80211: Local state "
-					   "(not associated) does not match "
-					   "with BSS state");
-				clear_state_mismatch(drv, r->bssid);
-			} else if (is_sta_interface(drv->nlmode) &&
-				   os_memcmp(drv->bssid, r->bssid, ETH_ALEN) !=
-				   0) {
-				wpa_printf(MSG_DEBUG, "nl80211: Local state "
-					   "(associated with " MACSTR ") does "
-					   "not match with BSS state",
-					   MAC2STR(drv->bssid));
-				clear_state_mismatch(drv, r->bssid);
-				clear_state_mismatch(drv, drv->bssid);
-			}
+	if (r->flags & WPA_SCAN_ASSOCIATED) {
+		wpa_printf(MSG_DEBUG, "nl80211: Scan results "
+			   "indicate BSS status with " MACSTR
+			   " as associated", MAC2STR(r->bssid));
+		if (is_sta_interface(drv->nlmode) && !drv->associated) {
+			wpa_printf(MSG_DEBUG, "nl80211: Local state "
+				   "(not associated) does not match "
+				   "with BSS state");
+			clear_state_mismatch(drv, r->bssid);
+		} else if (is_sta_interface(drv->nlmode) &&
+			   os_memcmp(drv->bssid, r->bssid, ETH_ALEN) != 0) {
+			wpa_printf(MSG_DEBUG, "nl80211: Local state "
+				   "(associated with " MACSTR ") does "
+				   "not match with BSS state",
+				   MAC2STR(drv->bssid));
+			clear_state_mismatch(drv, r->bssid);
+			clear_state_mismatch(drv, drv->bssid);
 		}
 	}
 }
@@ -5609,6 +5657,8 @@ nl80211_get_scan_results(struct wpa_driver_nl80211_data *drv)
 	struct wpa_scan_results *res;
 	int ret;
 	struct nl80211_bss_info_arg arg;
+	struct nl80211_noise_info info;
+	size_t i;
 
 	res = os_zalloc(sizeof(*res));
 	if (res == NULL)
@@ -5621,6 +5671,7 @@ nl80211_get_scan_results(struct wpa_driver_nl80211_data *drv)
 	if (nl80211_set_iface_id(msg, drv->first_bss) < 0)
 		goto nla_put_failure;
 
+	os_memset(&arg, 0, sizeof(arg));
 	arg.drv = drv;
 	arg.res = res;
 	ret = send_and_recv_msgs(drv, msg, bss_info_handler, &arg);
@@ -5628,7 +5679,11 @@ nl80211_get_scan_results(struct wpa_driver_nl80211_data *drv)
 	if (ret == 0) {
 		wpa_printf(MSG_DEBUG, "nl80211: Received scan results (%lu "
 			   "BSSes)", (unsigned long) res->num);
-		nl80211_get_noise_for_scan_results(drv, res);
+		if (nl80211_get_noise_for_scan_results(drv, &info) == 0) {
+			for (i = 0; i < res->num; i++)
+				nl80211_update_scan_res_noise(res->res[i],
+							      &info);
+		}
 		return res;
 	}
 	wpa_printf(MSG_DEBUG, "nl80211: Scan result fetch failed: ret=%d "
@@ -5651,14 +5706,65 @@ wpa_driver_nl80211_get_scan_results(void *priv)
 	struct i802_bss *bss = priv;
 	struct wpa_driver_nl80211_data *drv = bss->drv;
 	struct wpa_scan_results *res;
+	size_t i;
 
 	res = nl80211_get_scan_results(drv);
-	if (res)
-		wpa_driver_nl80211_check_bss_status(drv, res);
+	for (i = 0; res && i < res->num; i++)
+		nl80211_check_bss_status(drv, res->res[i]);
 	return res;
 }
 
 
+/**
+ * wpa_driver_nl80211_get_scan_results_cb - Report the latest scan results
+ * @priv: Pointer to private nl80211 data from wpa_driver_nl80211_init()
+ * @cb: Function to call for each BSS
+ * @ctx: Context pointer for cb
+ * Returns: Number of reported BSSes on success, -1 on failure
+ *
+ * Each BSS is reported as soon as it has been parsed from the netlink dump
+ * using a single reused buffer, so no per-BSS allocations are needed.
+ */
+static int wpa_driver_nl80211_get_scan_results_cb(
+	void *priv, void (*cb)(void *ctx, struct wpa_scan_res *res), void *ctx)
+{
+	struct i802_bss *bss = priv;
+	struct wpa_driver_nl80211_data *drv = bss->drv;
+	struct nl_msg *msg;
+	struct nl80211_bss_info_arg arg;
+	struct nl80211_noise_info info;
+	int ret;
+
+	os_memset(&arg, 0, sizeof(arg));
+	arg.drv = drv;
+	arg.cb = cb;
+	arg.cb_ctx = ctx;
+	/* Noise values need to be known before the results are reported */
+	if (nl80211_get_noise_for_scan_results(drv, &info) == 0)
+		arg.noise = &info;
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return -1;
+	nl80211_cmd(drv, msg, NLM_F_DUMP, NL80211_CMD_GET_SCAN);
+	if (nl80211_set_iface_id(msg, drv->first_bss) < 0) {
+		nlmsg_free(msg);
+		return -1;
+	}
+
+	ret = send_and_recv_msgs(drv, msg, bss_info_handler, &arg);
+	os_free(arg.buf);
+	if (ret) {
+		wpa_printf(MSG_DEBUG, "nl80211: Scan result fetch failed: "
+			   "ret=%d (%s)", ret, strerror(-ret));
+		return -1;
+	}
+	wpa_printf(MSG_DEBUG, "nl80211: Reported scan results (%u BSSes)",
+		   arg.num);
+	return arg.num;
+}
+
+
 static void nl80211_dump_scan(struct wpa_driver_nl80211_data *drv)
 {
 	struct wpa_scan_results *res;
@@ -12418,6 +12524,7 @@ const struct wpa_driver_ops wpa_driver_nl80211_ops = {
 	.sched_scan = wpa_driver_nl80211_sched_scan,
 	.stop_sched_scan = wpa_driver_nl80211_stop_sched_scan,
 	.get_scan_results2 = wpa_driver_nl80211_get_scan_results,
+	.get_scan_results_cb = wpa_driver_nl80211_get_scan_results_cb,
 	.deauthenticate = driver_nl80211_deauthenticate,
 	.authenticate = driver_nl80211_authenticate,
 	.associate = wpa_driver_nl80211_associate,
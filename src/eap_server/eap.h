@@ -88,6 +88,7 @@ struct eap_config {
 	void *ssl_ctx;
 	void *msg_ctx;
 	void *eap_sim_db_priv;
+	void *tls_workers;
 	Boolean backend_auth;
 	int eap_server;
 	u16 pwd_group;
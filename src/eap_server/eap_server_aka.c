@@ -99,6 +99,7 @@ static int eap_aka_check_identity_reauth(struct eap_sm *sm,
 		return 0;
 
 	wpa_printf(MSG_DEBUG, "EAP-AKA: Reauth username '%s'", username);
+	eap_sim_db_release_reauth(sm->eap_sim_db_priv, data->reauth);
 	data->reauth = eap_sim_db_get_reauth_entry(sm->eap_sim_db_priv,
 						   username);
 	if (data->reauth == NULL) {
@@ -237,6 +238,7 @@ static void * eap_aka_prime_init(struct eap_sm *sm)
 static void eap_aka_reset(struct eap_sm *sm, void *priv)
 {
 	struct eap_aka_data *data = priv;
+	eap_sim_db_release_reauth(sm->eap_sim_db_priv, data->reauth);
 	os_free(data->next_pseudonym);
 	os_free(data->next_reauth_id);
 	wpabuf_free(data->id_msgs);
@@ -807,6 +809,7 @@ static void eap_aka_fullauth(struct eap_sm *sm, struct eap_aka_data *data)
 	}
 #endif /* EAP_SERVER_AKA_PRIME */
 
+	eap_sim_db_release_reauth(sm->eap_sim_db_priv, data->reauth);
 	data->reauth = NULL;
 	data->counter = 0; /* reset re-auth counter since this is full auth */
 
@@ -984,6 +987,8 @@ static void eap_aka_process_challenge(struct eap_sm *sm,
 	} else
 		eap_aka_state(data, SUCCESS);
 
+	eap_sim_db_authenticated(sm->eap_sim_db_priv, data->permanent);
+
 	if (data->next_pseudonym) {
 		eap_sim_db_add_pseudonym(sm->eap_sim_db_priv, data->permanent,
 					 data->next_pseudonym);
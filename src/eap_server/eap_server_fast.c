@@ -1441,11 +1441,16 @@ static int eap_fast_process_version(struct eap_sm *sm, void *priv,
 static int eap_fast_process_phase1(struct eap_sm *sm,
 				   struct eap_fast_data *data)
 {
-	if (eap_server_tls_phase1(sm, &data->ssl) < 0) {
+	int res;
+
+	res = eap_server_tls_phase1(sm, &data->ssl);
+	if (res < 0) {
 		wpa_printf(MSG_INFO, "EAP-FAST: TLS processing failed");
 		eap_fast_state(data, FAILURE);
 		return -1;
 	}
+	if (res > 0)
+		return 1; /* pending */
 
 	if (!tls_connection_established(sm->ssl_ctx, data->ssl.conn) ||
 	    wpabuf_len(data->ssl.tls_out) > 0)
@@ -304,6 +304,18 @@ static int eap_peap_derive_cmk(struct eap_sm *sm, struct eap_peap_data *data)
 		return -1;
 	wpa_hexdump_key(MSG_DEBUG, "EAP-PEAP: TK", tk, 60);
 
+	if (tls_connection_resumed(sm->ssl_ctx, data->ssl.conn)) {
+		/* Fast-connect: IPMK|CMK = TK */
+		os_memcpy(data->ipmk, tk, 40);
+		wpa_hexdump_key(MSG_DEBUG, "EAP-PEAP: IPMK from TK",
+				data->ipmk, 40);
+		os_memcpy(data->cmk, tk + 40, 20);
+		wpa_hexdump_key(MSG_DEBUG, "EAP-PEAP: CMK from TK",
+				data->cmk, 20);
+		os_free(tk);
+		return 0;
+	}
+
 	eap_peap_get_isk(data, isk, sizeof(isk));
 	wpa_hexdump_key(MSG_DEBUG, "EAP-PEAP: ISK", isk, sizeof(isk));
 
@@ -326,7 +338,6 @@ static int eap_peap_derive_cmk(struct eap_sm *sm, struct eap_peap_data *data)
 
 	os_free(tk);
 
-	/* TODO: fast-connect: IPMK|CMK = TK */
 	os_memcpy(data->ipmk, imck, 40);
 	wpa_hexdump_key(MSG_DEBUG, "EAP-PEAP: IPMK (S-IPMKj)", data->ipmk, 40);
 	os_memcpy(data->cmk, imck + 40, 20);
@@ -1121,10 +1132,27 @@ static void eap_peap_process_msg(struct eap_sm *sm, void *priv,
 				 const struct wpabuf *respData)
 {
 	struct eap_peap_data *data = priv;
+	int res;
 
 	switch (data->state) {
 	case PHASE1:
-		if (eap_server_tls_phase1(sm, &data->ssl) < 0) {
+		res = eap_server_tls_phase1(sm, &data->ssl);
+		if (res < 0) {
+			eap_peap_state(data, FAILURE);
+			break;
+		}
+		if (res > 0)
+			break; /* pending */
+		if (!tls_connection_established(sm->ssl_ctx, data->ssl.conn))
+			break;
+		switch (eap_server_tls_resumed_session(sm, &data->ssl,
+						       EAP_TYPE_PEAP)) {
+		case 1:
+			wpa_printf(MSG_DEBUG, "EAP-PEAP: Resuming previous "
+				   "session - skip Phase 2");
+			eap_peap_req_success(sm, data);
+			break;
+		case -1:
 			eap_peap_state(data, FAILURE);
 			break;
 		}
@@ -1162,6 +1190,9 @@ static void eap_peap_process(struct eap_sm *sm, void *priv,
 				   EAP_TYPE_PEAP, eap_peap_process_version,
 				   eap_peap_process_msg) < 0)
 		eap_peap_state(data, FAILURE);
+	else if (data->state == SUCCESS &&
+		 !tls_connection_resumed(sm->ssl_ctx, data->ssl.conn))
+		eap_server_tls_valid_session(sm, &data->ssl, EAP_TYPE_PEAP);
 }
 
 
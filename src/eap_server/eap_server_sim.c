@@ -92,6 +92,7 @@ static void * eap_sim_init(struct eap_sm *sm)
 static void eap_sim_reset(struct eap_sm *sm, void *priv)
 {
 	struct eap_sim_data *data = priv;
+	eap_sim_db_release_reauth(sm->eap_sim_db_priv, data->reauth);
 	os_free(data->next_pseudonym);
 	os_free(data->next_reauth_id);
 	os_free(data);
@@ -457,6 +458,7 @@ static void eap_sim_process_start(struct eap_sm *sm,
 	if (username[0] == EAP_SIM_REAUTH_ID_PREFIX) {
 		wpa_printf(MSG_DEBUG, "EAP-SIM: Reauth username '%s'",
 			   username);
+		eap_sim_db_release_reauth(sm->eap_sim_db_priv, data->reauth);
 		data->reauth = eap_sim_db_get_reauth_entry(
 			sm->eap_sim_db_priv, username);
 		os_free(username);
@@ -518,6 +520,7 @@ skip_id_update:
 	}
 
 	data->counter = 0; /* reset re-auth counter since this is full auth */
+	eap_sim_db_release_reauth(sm->eap_sim_db_priv, data->reauth);
 	data->reauth = NULL;
 
 	data->num_chal = eap_sim_db_get_gsm_triplets(
@@ -586,6 +589,8 @@ static void eap_sim_process_challenge(struct eap_sm *sm,
 	} else
 		eap_sim_state(data, SUCCESS);
 
+	eap_sim_db_authenticated(sm->eap_sim_db_priv, data->permanent);
+
 	if (data->next_pseudonym) {
 		eap_sim_db_add_pseudonym(sm->eap_sim_db_priv, data->permanent,
 					 data->next_pseudonym);
@@ -68,6 +68,9 @@ static void * eap_tls_init(struct eap_sm *sm)
 
 	data->eap_type = EAP_TYPE_TLS;
 
+	/* Completing the handshake authenticates the peer */
+	eap_server_tls_valid_session(sm, &data->ssl, data->eap_type);
+
 	return data;
 }
 
@@ -220,13 +223,35 @@ static void eap_tls_process_msg(struct eap_sm *sm, void *priv,
 				const struct wpabuf *respData)
 {
 	struct eap_tls_data *data = priv;
-	if (data->state == SUCCESS && wpabuf_len(data->ssl.tls_in) == 0) {
+	int res;
+
+	if (data->state == SUCCESS && !data->ssl.job &&
+	    wpabuf_len(data->ssl.tls_in) == 0) {
 		wpa_printf(MSG_DEBUG, "EAP-TLS: Client acknowledged final TLS "
 			   "handshake message");
 		return;
 	}
-	if (eap_server_tls_phase1(sm, &data->ssl) < 0)
+	res = eap_server_tls_phase1(sm, &data->ssl);
+	if (res < 0) {
+		eap_tls_state(data, FAILURE);
+		return;
+	}
+	if (res > 0)
+		return; /* pending */
+
+	if (!tls_connection_established(sm->ssl_ctx, data->ssl.conn))
+		return;
+
+	switch (eap_server_tls_resumed_session(sm, &data->ssl,
+					       data->eap_type)) {
+	case 1:
+		wpa_printf(MSG_DEBUG, "EAP-TLS: Resuming previous session");
+		eap_tls_state(data, SUCCESS);
+		break;
+	case -1:
 		eap_tls_state(data, FAILURE);
+		break;
+	}
 }
 
 
@@ -13,6 +13,7 @@
 #include "crypto/tls.h"
 #include "eap_i.h"
 #include "eap_tls_common.h"
+#include "eap_tls_workers.h"
 
 
 static void eap_server_tls_free_in_buf(struct eap_ssl_data *data);
@@ -90,6 +91,12 @@ int eap_server_tls_ssl_init(struct eap_sm *sm, struct eap_ssl_data *data,
 
 void eap_server_tls_ssl_deinit(struct eap_sm *sm, struct eap_ssl_data *data)
 {
+	if (data->job) {
+		/* The worker thread frees the connection if still using it */
+		if (eap_tls_job_cancel(data->job))
+			data->conn = NULL;
+		data->job = NULL;
+	}
 	tls_connection_deinit(sm->ssl_ctx, data->conn);
 	eap_server_tls_free_in_buf(data);
 	wpabuf_free(data->tls_out);
@@ -277,8 +284,42 @@ static int eap_server_tls_process_fragment(struct eap_ssl_data *data,
 }
 
 
+static struct wpabuf * eap_server_tls_job_finish(struct eap_sm *sm,
+						  struct eap_ssl_data *data)
+{
+	struct wpabuf *out;
+
+#ifdef CONFIG_TLS_INTERNAL
+	out = eap_tls_job_finish(data->job, eap_server_tls_log_cb, sm);
+	tls_connection_set_log_cb(data->conn, eap_server_tls_log_cb, sm);
+#else /* CONFIG_TLS_INTERNAL */
+	out = eap_tls_job_finish(data->job, NULL, NULL);
+#endif /* CONFIG_TLS_INTERNAL */
+	data->job = NULL;
+
+	return out;
+}
+
+
+/**
+ * eap_server_tls_phase1 - Process a TLS handshake message
+ * @sm: EAP server state machine
+ * @data: Data for TLS processing
+ * Returns: 0 on success, -1 on failure, 1 if the processing is pending
+ *
+ * If the TLS handshake processing was passed to a worker thread, the EAP
+ * method is marked pending and this function will be called again with the
+ * same message once the result is available.
+ */
 int eap_server_tls_phase1(struct eap_sm *sm, struct eap_ssl_data *data)
 {
+	if (data->job) {
+		if (!eap_tls_job_done(data->job))
+			return 1;
+		data->tls_out = eap_server_tls_job_finish(sm, data);
+		goto check;
+	}
+
 	if (data->tls_out) {
 		/* This should not happen.. */
 		wpa_printf(MSG_INFO, "SSL: pending tls_out data when "
@@ -287,9 +328,21 @@ int eap_server_tls_phase1(struct eap_sm *sm, struct eap_ssl_data *data)
 		WPA_ASSERT(data->tls_out == NULL);
 	}
 
+	if (sm->tls_workers && !data->phase2) {
+		data->job = eap_tls_job_start(sm->tls_workers, sm->ssl_ctx,
+					      data->conn, data->tls_in, sm);
+		if (data->job) {
+			wpa_printf(MSG_DEBUG, "SSL: TLS processing passed to "
+				   "a worker thread - pending");
+			sm->method_pending = METHOD_PENDING_WAIT;
+			return 1;
+		}
+	}
+
 	data->tls_out = tls_connection_server_handshake(sm->ssl_ctx,
 							data->conn,
 							data->tls_in, NULL);
+check:
 	if (data->tls_out == NULL) {
 		wpa_printf(MSG_INFO, "SSL: TLS processing failed");
 		return -1;
@@ -422,6 +475,19 @@ int eap_server_tls_process(struct eap_sm *sm, struct eap_ssl_data *data,
 				       &left);
 	if (pos == NULL || left < 1)
 		return 0; /* Should not happen - frame already validated */
+
+	if (data->job) {
+		/*
+		 * Reprocessing the message after the TLS handshake processing
+		 * in a worker thread; the message was already reassembled.
+		 */
+		if (!eap_tls_job_done(data->job))
+			return 0;
+		if (proc_msg)
+			proc_msg(sm, priv, respData);
+		goto check_alerts;
+	}
+
 	flags = *pos++;
 	left--;
 	wpa_printf(MSG_DEBUG, "SSL: Received packet(len=%lu) - Flags 0x%02x",
@@ -441,6 +507,12 @@ int eap_server_tls_process(struct eap_sm *sm, struct eap_ssl_data *data,
 	if (proc_msg)
 		proc_msg(sm, priv, respData);
 
+	if (data->job) {
+		/* The connection is in use by a worker thread */
+		goto done;
+	}
+
+check_alerts:
 	if (tls_connection_get_write_alerts(sm->ssl_ctx, data->conn) > 1) {
 		wpa_printf(MSG_INFO, "SSL: Locally detected fatal error in "
 			   "TLS processing");
@@ -452,3 +524,86 @@ done:
 
 	return res;
 }
+
+
+/**
+ * eap_server_tls_valid_session - Allow the TLS session to be resumed
+ * @sm: EAP server state machine
+ * @data: Data for TLS processing
+ * @eap_type: EAP method that authenticated the peer
+ *
+ * The EAP method type and the authenticated identity are stored with the
+ * session so that eap_server_tls_resumed_session() can validate a later
+ * abbreviated handshake.
+ */
+void eap_server_tls_valid_session(struct eap_sm *sm,
+				  struct eap_ssl_data *data, int eap_type)
+{
+	struct wpabuf *buf;
+
+	if (sm->identity_len > 255)
+		return;
+
+	buf = wpabuf_alloc(2 + sm->identity_len);
+	if (buf == NULL)
+		return;
+	wpabuf_put_u8(buf, eap_type);
+	wpabuf_put_u8(buf, sm->identity_len);
+	if (sm->identity)
+		wpabuf_put_data(buf, sm->identity, sm->identity_len);
+	if (tls_connection_set_success_data(sm->ssl_ctx, data->conn, buf) == 0)
+		wpa_printf(MSG_DEBUG, "SSL: Session can be resumed");
+}
+
+
+/**
+ * eap_server_tls_resumed_session - Validate a resumed TLS session
+ * @sm: EAP server state machine
+ * @data: Data for TLS processing
+ * @eap_type: Current EAP method type
+ * Returns: 1 if a previously authenticated session was resumed, 0 if the
+ * session was not resumed, or -1 if the resumed session must be rejected
+ *
+ * On success, the identity that was authenticated with the original session
+ * is restored for the EAP server state machine.
+ */
+int eap_server_tls_resumed_session(struct eap_sm *sm,
+				   struct eap_ssl_data *data, int eap_type)
+{
+	const struct wpabuf *buf;
+	const u8 *pos;
+	size_t len;
+
+	if (!tls_connection_resumed(sm->ssl_ctx, data->conn))
+		return 0;
+
+	buf = tls_connection_get_success_data(sm->ssl_ctx, data->conn);
+	if (buf == NULL || wpabuf_len(buf) < 2) {
+		wpa_printf(MSG_DEBUG, "SSL: No success data in resumed "
+			   "session - reject");
+		return -1;
+	}
+	pos = wpabuf_head(buf);
+	len = pos[1];
+	if (pos[0] != eap_type || wpabuf_len(buf) < 2 + len) {
+		wpa_printf(MSG_DEBUG, "SSL: Resumed session was not "
+			   "authenticated with EAP type %d - reject",
+			   eap_type);
+		return -1;
+	}
+
+	if (len) {
+		u8 *identity = os_malloc(len);
+		if (identity == NULL)
+			return -1;
+		os_memcpy(identity, pos + 2, len);
+		os_free(sm->identity);
+		sm->identity = identity;
+		sm->identity_len = len;
+	}
+	wpa_hexdump_ascii(MSG_DEBUG, "SSL: Resumed session for identity",
+			  sm->identity, sm->identity_len);
+
+	return 1;
+}
+
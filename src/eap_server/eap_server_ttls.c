@@ -1090,11 +1090,30 @@ static void eap_ttls_process_msg(struct eap_sm *sm, void *priv,
 				 const struct wpabuf *respData)
 {
 	struct eap_ttls_data *data = priv;
+	int res;
 
 	switch (data->state) {
 	case PHASE1:
-		if (eap_server_tls_phase1(sm, &data->ssl) < 0)
+		res = eap_server_tls_phase1(sm, &data->ssl);
+		if (res < 0) {
 			eap_ttls_state(data, FAILURE);
+			break;
+		}
+		if (res > 0)
+			break; /* pending */
+		if (!tls_connection_established(sm->ssl_ctx, data->ssl.conn))
+			break;
+		switch (eap_server_tls_resumed_session(sm, &data->ssl,
+						       EAP_TYPE_TTLS)) {
+		case 1:
+			wpa_printf(MSG_DEBUG, "EAP-TTLS: Resuming previous "
+				   "session - skip Phase 2");
+			eap_ttls_state(data, SUCCESS);
+			break;
+		case -1:
+			eap_ttls_state(data, FAILURE);
+			break;
+		}
 		break;
 	case PHASE2_START:
 	case PHASE2_METHOD:
@@ -1137,6 +1156,9 @@ static void eap_ttls_process(struct eap_sm *sm, void *priv,
 				   EAP_TYPE_TTLS, eap_ttls_process_version,
 				   eap_ttls_process_msg) < 0)
 		eap_ttls_state(data, FAILURE);
+	else if (data->state == SUCCESS &&
+		 !tls_connection_resumed(sm->ssl_ctx, data->ssl.conn))
+		eap_server_tls_valid_session(sm, &data->ssl, EAP_TYPE_TTLS);
 }
 
 
@@ -13,6 +13,11 @@
  * gateway implementations for HLR/AuC access. Alternatively, it can also be
  * completely replaced if the in-memory database of pseudonyms/re-auth
  * identities is not suitable for some cases.
+ *
+ * Pseudonyms and re-auth identities are kept in hash tables in memory. If an
+ * SQLite database is configured, the in-memory tables act as a cache in front
+ * of it: changes are written to the database in batched transactions and
+ * entries that are not found in memory are looked up from the database.
  */
 
 #include "includes.h"
@@ -22,23 +27,91 @@
 #endif /* CONFIG_SQLITE */
 
 #include "common.h"
+#include "utils/list.h"
 #include "crypto/random.h"
 #include "eap_common/eap_sim_common.h"
 #include "eap_server/eap_sim_db.h"
 #include "eloop.h"
 
+/* Size of the pending request and prefetch pool hash tables (power of two) */
+#define EAP_SIM_DB_HASH_SIZE 64
+/* Maximum time to wait for a response and for the session to fetch it */
+#define EAP_SIM_DB_PENDING_TIMEOUT 60
+#define EAP_SIM_DB_MAX_PENDING 1000
+/* Maximum time unused prefetched vectors are kept for an IMSI */
+#define EAP_SIM_DB_POOL_LIFETIME 600
+/* Maximum number of AKA vectors prefetched with a single request */
+#define EAP_SIM_DB_MAX_BULK 16
+/*
+ * Pseudonyms and re-auth identities are written to the SQLite database in a
+ * single transaction once a second or when this many entries have changed.
+ */
+#define EAP_SIM_DB_FLUSH_INTERVAL 1
+#define EAP_SIM_DB_FLUSH_MAX 1000
+/*
+ * Maximum number of pseudonyms and re-auth identities (each) kept in memory
+ * when they are also stored in the SQLite database. Entries used within
+ * EAP_SIM_DB_PENDING_TIMEOUT seconds are not evicted since an EAP session may
+ * still be using them.
+ */
+#define EAP_SIM_DB_MAX_CACHED 500000
+
+#define eap_sim_db_entry(node, type, member) \
+	((type *) ((char *) (node) - offsetof(type, member)))
+
+/* Node in a hash table indexed by an identity string */
+struct eap_sim_db_hnode {
+	struct eap_sim_db_hnode *next;
+	const char *key;
+};
+
+struct eap_sim_db_htable {
+	struct eap_sim_db_hnode **bucket;
+	unsigned int size; /* power of two */
+	unsigned int count;
+};
+
 struct eap_sim_pseudonym {
-	struct eap_sim_pseudonym *next;
+	struct eap_sim_db_hnode by_permanent;
+	struct eap_sim_db_hnode by_pseudonym;
+	struct dl_list list; /* LRU list; most recently used first */
+	struct dl_list dirty_list; /* not yet written to the database */
+	struct os_reltime last_used;
+	int dirty;
 	char *permanent; /* permanent username */
 	char *pseudonym; /* pseudonym username */
 };
 
+struct eap_sim_db_reauth {
+	struct eap_sim_reauth r;
+	struct eap_sim_db_hnode by_permanent;
+	struct eap_sim_db_hnode by_reauth_id;
+	struct dl_list list; /* LRU list; most recently used first */
+	struct dl_list dirty_list; /* not yet written to the database */
+	struct os_reltime last_used;
+	int dirty;
+	unsigned int refcount; /* EAP sessions using the entry */
+	int removed; /* only kept for EAP sessions that still refer to it */
+};
+
+/* Re-auth entry that has not yet been removed from the database */
+struct eap_sim_db_removed {
+	struct dl_list list;
+	char *permanent;
+};
+
 struct eap_sim_db_pending {
-	struct eap_sim_db_pending *next;
+	struct eap_sim_db_pending *next; /* hash table bucket */
+	struct dl_list list; /* all pending entries in the order sent */
 	char imsi[20];
 	enum { PENDING, SUCCESS, FAILURE } state;
-	void *cb_session_ctx;
+	void *cb_session_ctx; /* NULL for prefetch requests */
 	int aka;
+	int stale; /* prefetched AKA vector from before resynchronization */
+	unsigned int bulk; /* number of vectors requested with
+			    * AKA-REQ-AUTH-BULK; 0 = single request */
+	unsigned int seq;
+	struct os_reltime sent;
 	union {
 		struct {
 			u8 kc[EAP_SIM_MAX_CHAL][EAP_SIM_KC_LEN];
@@ -57,25 +130,161 @@ struct eap_sim_db_pending {
 	} u;
 };
 
+/* One GSM triplet or one UMTS authentication vector */
+struct eap_sim_db_vector {
+	union {
+		struct {
+			u8 kc[EAP_SIM_KC_LEN];
+			u8 sres[EAP_SIM_SRES_LEN];
+			u8 rand[GSM_RAND_LEN];
+		} sim;
+		struct {
+			u8 rand[EAP_AKA_RAND_LEN];
+			u8 autn[EAP_AKA_AUTN_LEN];
+			u8 ik[EAP_AKA_IK_LEN];
+			u8 ck[EAP_AKA_CK_LEN];
+			u8 res[EAP_AKA_RES_MAX_LEN];
+			size_t res_len;
+		} aka;
+	} u;
+};
+
+/* Unused prefetched vectors for a recently seen IMSI */
+struct eap_sim_db_pool {
+	struct eap_sim_db_pool *next; /* hash table bucket */
+	struct dl_list list; /* LRU list; most recently used first */
+	char imsi[20];
+	int aka;
+	struct os_reltime last_used;
+	unsigned int requested; /* vectors requested, but not yet received */
+	unsigned int num; /* number of entries in vec */
+	struct eap_sim_db_vector *vec; /* oldest first */
+};
+
 struct eap_sim_db_data {
 	int sock;
 	char *fname;
 	char *local_sock;
 	void (*get_complete_cb)(void *ctx, void *session_ctx);
 	void *ctx;
-	struct eap_sim_pseudonym *pseudonyms;
-	struct eap_sim_reauth *reauths;
-	struct eap_sim_db_pending *pending;
+	struct eap_sim_db_htable pseudonym_by_permanent;
+	struct eap_sim_db_htable pseudonym_by_id;
+	struct dl_list pseudonym_list;
+	struct eap_sim_db_htable reauth_by_permanent;
+	struct eap_sim_db_htable reauth_by_id;
+	struct dl_list reauth_list;
+	struct dl_list removed_reauth_list;
+	struct dl_list dirty_pseudonyms;
+	struct dl_list dirty_reauths;
+	struct dl_list removed_reauths;
+	unsigned int num_dirty;
+	struct eap_sim_db_pending *pending[EAP_SIM_DB_HASH_SIZE];
+	struct dl_list pending_list;
+	unsigned int num_pending;
+	unsigned int pending_seq;
+	struct eap_sim_db_pool *pools[EAP_SIM_DB_HASH_SIZE];
+	struct dl_list pool_list;
+	unsigned int num_pools;
+	unsigned int prefetch;
+	unsigned int prefetch_imsis;
+	struct eap_sim_db_stats stats;
 #ifdef CONFIG_SQLITE
 	sqlite3 *sqlite_db;
 	char db_tmp_identity[100];
-	char db_tmp_pseudonym_str[100];
-	struct eap_sim_pseudonym db_tmp_pseudonym;
 	struct eap_sim_reauth db_tmp_reauth;
 #endif /* CONFIG_SQLITE */
 };
 
 
+static unsigned int eap_sim_db_str_hash(const char *str)
+{
+	unsigned int hash = 0;
+
+	while (*str)
+		hash = hash * 31 + (u8) *str++;
+	return hash;
+}
+
+
+static int eap_sim_db_htable_add(struct eap_sim_db_htable *table,
+				 struct eap_sim_db_hnode *node)
+{
+	unsigned int hash;
+
+	if (table->count >= table->size) {
+		struct eap_sim_db_hnode **bucket, *n, *next;
+		unsigned int i, size;
+
+		size = table->size ? table->size * 2 : 256;
+		bucket = os_calloc(size, sizeof(*bucket));
+		if (bucket == NULL && table->size == 0)
+			return -1;
+		if (bucket) {
+			/* Rehash; a failure only makes the chains longer */
+			for (i = 0; i < table->size; i++) {
+				for (n = table->bucket[i]; n; n = next) {
+					next = n->next;
+					hash = eap_sim_db_str_hash(n->key) &
+						(size - 1);
+					n->next = bucket[hash];
+					bucket[hash] = n;
+				}
+			}
+			os_free(table->bucket);
+			table->bucket = bucket;
+			table->size = size;
+		}
+	}
+
+	hash = eap_sim_db_str_hash(node->key) & (table->size - 1);
+	node->next = table->bucket[hash];
+	table->bucket[hash] = node;
+	table->count++;
+	return 0;
+}
+
+
+static struct eap_sim_db_hnode *
+eap_sim_db_htable_get(struct eap_sim_db_htable *table, const char *key)
+{
+	struct eap_sim_db_hnode *node;
+
+	if (table->size == 0)
+		return NULL;
+	node = table->bucket[eap_sim_db_str_hash(key) & (table->size - 1)];
+	while (node && os_strcmp(node->key, key) != 0)
+		node = node->next;
+	return node;
+}
+
+
+static void eap_sim_db_htable_del(struct eap_sim_db_htable *table,
+				  struct eap_sim_db_hnode *node)
+{
+	struct eap_sim_db_hnode **pos;
+
+	if (table->size == 0)
+		return;
+	pos = &table->bucket[eap_sim_db_str_hash(node->key) &
+			     (table->size - 1)];
+	while (*pos && *pos != node)
+		pos = &(*pos)->next;
+	if (*pos) {
+		*pos = node->next;
+		table->count--;
+	}
+}
+
+
+static void eap_sim_db_htable_deinit(struct eap_sim_db_htable *table)
+{
+	os_free(table->bucket);
+	table->bucket = NULL;
+	table->size = 0;
+	table->count = 0;
+}
+
+
 #ifdef CONFIG_SQLITE
 
 static int db_table_exists(sqlite3 *db, const char *name)
@@ -174,20 +383,14 @@ static int valid_db_string(const char *str)
 
 
 static int db_add_pseudonym(struct eap_sim_db_data *data,
-			    const char *permanent, char *pseudonym)
+			    const char *permanent, const char *pseudonym)
 {
 	char cmd[128];
 	char *err = NULL;
 
-	if (!valid_db_string(permanent) || !valid_db_string(pseudonym)) {
-		os_free(pseudonym);
-		return -1;
-	}
-
 	os_snprintf(cmd, sizeof(cmd), "INSERT OR REPLACE INTO pseudonyms "
 		    "(permanent, pseudonym) VALUES ('%s', '%s');",
 		    permanent, pseudonym);
-	os_free(pseudonym);
 	if (sqlite3_exec(data->sqlite_db, cmd, NULL, NULL, &err) != SQLITE_OK)
 	{
 		wpa_printf(MSG_ERROR, "EAP-SIM DB: SQLite error: %s", err);
@@ -235,58 +438,28 @@ db_get_pseudonym(struct eap_sim_db_data *data, const char *pseudonym)
 }
 
 
-static int db_add_reauth(struct eap_sim_db_data *data, const char *permanent,
-			 char *reauth_id, u16 counter, const u8 *mk,
-			 const u8 *k_encr, const u8 *k_aut, const u8 *k_re)
+static int db_add_reauth(struct eap_sim_db_data *data,
+			 const struct eap_sim_reauth *r)
 {
 	char cmd[2000], *pos, *end;
 	char *err = NULL;
 
-	if (!valid_db_string(permanent) || !valid_db_string(reauth_id)) {
-		os_free(reauth_id);
-		return -1;
-	}
-
 	pos = cmd;
 	end = pos + sizeof(cmd);
 	pos += os_snprintf(pos, end - pos, "INSERT OR REPLACE INTO reauth "
-			   "(permanent, reauth_id, counter%s%s%s%s) "
-			   "VALUES ('%s', '%s', %u",
-			   mk ? ", mk" : "",
-			   k_encr ? ", k_encr" : "",
-			   k_aut ? ", k_aut" : "",
-			   k_re ? ", k_re" : "",
-			   permanent, reauth_id, counter);
-	os_free(reauth_id);
-
-	if (mk) {
-		pos += os_snprintf(pos, end - pos, ", '");
-		pos += wpa_snprintf_hex(pos, end - pos, mk, EAP_SIM_MK_LEN);
-		pos += os_snprintf(pos, end - pos, "'");
-	}
-
-	if (k_encr) {
-		pos += os_snprintf(pos, end - pos, ", '");
-		pos += wpa_snprintf_hex(pos, end - pos, k_encr,
-					EAP_SIM_K_ENCR_LEN);
-		pos += os_snprintf(pos, end - pos, "'");
-	}
-
-	if (k_aut) {
-		pos += os_snprintf(pos, end - pos, ", '");
-		pos += wpa_snprintf_hex(pos, end - pos, k_aut,
-					EAP_AKA_PRIME_K_AUT_LEN);
-		pos += os_snprintf(pos, end - pos, "'");
-	}
-
-	if (k_re) {
-		pos += os_snprintf(pos, end - pos, ", '");
-		pos += wpa_snprintf_hex(pos, end - pos, k_re,
-					EAP_AKA_PRIME_K_RE_LEN);
-		pos += os_snprintf(pos, end - pos, "'");
-	}
-
-	os_snprintf(pos, end - pos, ");");
+			   "(permanent, reauth_id, counter, mk, k_encr, k_aut, "
+			   "k_re) VALUES ('%s', '%s', %u, '",
+			   r->permanent, r->reauth_id, r->counter);
+	pos += wpa_snprintf_hex(pos, end - pos, r->mk, EAP_SIM_MK_LEN);
+	pos += os_snprintf(pos, end - pos, "', '");
+	pos += wpa_snprintf_hex(pos, end - pos, r->k_encr, EAP_SIM_K_ENCR_LEN);
+	pos += os_snprintf(pos, end - pos, "', '");
+	pos += wpa_snprintf_hex(pos, end - pos, r->k_aut,
+				EAP_AKA_PRIME_K_AUT_LEN);
+	pos += os_snprintf(pos, end - pos, "', '");
+	pos += wpa_snprintf_hex(pos, end - pos, r->k_re,
+				EAP_AKA_PRIME_K_RE_LEN);
+	os_snprintf(pos, end - pos, "');");
 
 	if (sqlite3_exec(data->sqlite_db, cmd, NULL, NULL, &err) != SQLITE_OK)
 	{
@@ -338,9 +511,6 @@ db_get_reauth(struct eap_sim_db_data *data, const char *reauth_id)
 	if (!valid_db_string(reauth_id))
 		return NULL;
 	os_memset(&data->db_tmp_reauth, 0, sizeof(data->db_tmp_reauth));
-	os_strlcpy(data->db_tmp_pseudonym_str, reauth_id,
-		   sizeof(data->db_tmp_pseudonym_str));
-	data->db_tmp_reauth.reauth_id = data->db_tmp_pseudonym_str;
 	os_snprintf(cmd, sizeof(cmd),
 		    "SELECT * FROM reauth WHERE reauth_id='%s';", reauth_id);
 	if (sqlite3_exec(data->sqlite_db, cmd, get_reauth_cb, data, NULL) !=
@@ -353,47 +523,565 @@ db_get_reauth(struct eap_sim_db_data *data, const char *reauth_id)
 
 
 static void db_remove_reauth(struct eap_sim_db_data *data,
-			     struct eap_sim_reauth *reauth)
+			     const char *permanent)
 {
 	char cmd[256];
 
-	if (!valid_db_string(reauth->permanent))
-		return;
 	os_snprintf(cmd, sizeof(cmd),
-		    "DELETE FROM reauth WHERE permanent='%s';",
-		    reauth->permanent);
+		    "DELETE FROM reauth WHERE permanent='%s';", permanent);
 	sqlite3_exec(data->sqlite_db, cmd, NULL, NULL, NULL);
 }
 
+
+static void eap_sim_db_flush_timeout(void *eloop_ctx, void *timeout_ctx);
+
+static void db_flush(struct eap_sim_db_data *data)
+{
+	struct eap_sim_db_removed *removed;
+	struct eap_sim_pseudonym *p;
+	struct eap_sim_db_reauth *r;
+	unsigned int count = 0;
+
+	if (data->sqlite_db == NULL ||
+	    (dl_list_empty(&data->removed_reauths) &&
+	     dl_list_empty(&data->dirty_pseudonyms) &&
+	     dl_list_empty(&data->dirty_reauths)))
+		return;
+
+	sqlite3_exec(data->sqlite_db, "BEGIN;", NULL, NULL, NULL);
+
+	while ((removed = dl_list_first(&data->removed_reauths,
+					struct eap_sim_db_removed, list))) {
+		db_remove_reauth(data, removed->permanent);
+		dl_list_del(&removed->list);
+		os_free(removed->permanent);
+		os_free(removed);
+		count++;
+	}
+
+	while ((p = dl_list_first(&data->dirty_pseudonyms,
+				  struct eap_sim_pseudonym, dirty_list))) {
+		db_add_pseudonym(data, p->permanent, p->pseudonym);
+		dl_list_del(&p->dirty_list);
+		p->dirty = 0;
+		count++;
+	}
+
+	while ((r = dl_list_first(&data->dirty_reauths,
+				  struct eap_sim_db_reauth, dirty_list))) {
+		db_add_reauth(data, &r->r);
+		dl_list_del(&r->dirty_list);
+		r->dirty = 0;
+		count++;
+	}
+
+	if (sqlite3_exec(data->sqlite_db, "COMMIT;", NULL, NULL, NULL) !=
+	    SQLITE_OK)
+		wpa_printf(MSG_ERROR, "EAP-SIM DB: SQLite error: %s",
+			   sqlite3_errmsg(data->sqlite_db));
+	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Wrote %u pseudonym/reauth changes "
+		   "to the database", count);
+	data->stats.db_writes += count;
+	data->num_dirty = 0;
+	eloop_cancel_timeout(eap_sim_db_flush_timeout, data, NULL);
+}
+
+
+static void eap_sim_db_flush_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	db_flush(eloop_ctx);
+}
+
+
+/* Schedule a database write for a changed entry */
+static void db_dirty(struct eap_sim_db_data *data)
+{
+	if (data->num_dirty++ == 0)
+		eloop_register_timeout(EAP_SIM_DB_FLUSH_INTERVAL, 0,
+				       eap_sim_db_flush_timeout, data, NULL);
+	else if (data->num_dirty >= EAP_SIM_DB_FLUSH_MAX)
+		db_flush(data);
+}
+
+
+static void db_changed(struct eap_sim_db_data *data, struct dl_list *list,
+		       struct dl_list *dirty_list, int *dirty)
+{
+	if (*dirty)
+		return;
+	*dirty = 1;
+	dl_list_add_tail(list, dirty_list);
+	db_dirty(data);
+}
+
+
+/* Check whether the removal of a re-auth entry is still to be written */
+static int db_reauth_removed(struct eap_sim_db_data *data,
+			     const char *permanent)
+{
+	struct eap_sim_db_removed *removed;
+
+	dl_list_for_each(removed, &data->removed_reauths,
+			 struct eap_sim_db_removed, list) {
+		if (os_strcmp(removed->permanent, permanent) == 0)
+			return 1;
+	}
+	return 0;
+}
+
 #endif /* CONFIG_SQLITE */
 
 
-static struct eap_sim_db_pending *
-eap_sim_db_get_pending(struct eap_sim_db_data *data, const char *imsi, int aka)
+static void eap_sim_db_free_pseudonym(struct eap_sim_db_data *data,
+				      struct eap_sim_pseudonym *p)
 {
-	struct eap_sim_db_pending *entry, *prev = NULL;
+	eap_sim_db_htable_del(&data->pseudonym_by_permanent, &p->by_permanent);
+	eap_sim_db_htable_del(&data->pseudonym_by_id, &p->by_pseudonym);
+	dl_list_del(&p->list);
+	if (p->dirty) {
+		dl_list_del(&p->dirty_list);
+		data->num_dirty--;
+	}
+	data->stats.ids_cached--;
+	os_free(p->permanent);
+	os_free(p->pseudonym);
+	os_free(p);
+}
+
+
+static void eap_sim_db_unlink_reauth(struct eap_sim_db_data *data,
+				     struct eap_sim_db_reauth *r)
+{
+	eap_sim_db_htable_del(&data->reauth_by_permanent, &r->by_permanent);
+	eap_sim_db_htable_del(&data->reauth_by_id, &r->by_reauth_id);
+	dl_list_del(&r->list);
+	if (r->dirty) {
+		dl_list_del(&r->dirty_list);
+		r->dirty = 0;
+		data->num_dirty--;
+	}
+	data->stats.ids_cached--;
+}
 
-	entry = data->pending;
-	while (entry) {
-		if (entry->aka == aka && os_strcmp(entry->imsi, imsi) == 0) {
-			if (prev)
-				prev->next = entry->next;
-			else
-				data->pending = entry->next;
+
+static void eap_sim_db_free_reauth(struct eap_sim_db_data *data,
+				   struct eap_sim_db_reauth *r)
+{
+	if (r->removed)
+		dl_list_del(&r->list);
+	else
+		eap_sim_db_unlink_reauth(data, r);
+	os_free(r->r.permanent);
+	os_free(r->r.reauth_id);
+	os_memset(r, 0, sizeof(*r));
+	os_free(r);
+}
+
+
+static void eap_sim_db_used(struct dl_list *head, struct dl_list *list,
+			    struct os_reltime *last_used)
+{
+	dl_list_del(list);
+	dl_list_add(head, list);
+	os_get_reltime(last_used);
+}
+
+
+#ifdef CONFIG_SQLITE
+/*
+ * Drop the least recently used entries that have already been written to the
+ * database once the in-memory cache grows too large. They will be read back
+ * from the database if needed again.
+ */
+static void eap_sim_db_evict(struct eap_sim_db_data *data)
+{
+	struct eap_sim_pseudonym *p;
+	struct eap_sim_db_reauth *r;
+	struct os_reltime now;
+
+	if (data->sqlite_db == NULL)
+		return;
+
+	os_get_reltime(&now);
+	while (data->pseudonym_by_permanent.count > EAP_SIM_DB_MAX_CACHED) {
+		p = dl_list_last(&data->pseudonym_list,
+				 struct eap_sim_pseudonym, list);
+		if (!os_reltime_expired(&now, &p->last_used,
+					EAP_SIM_DB_PENDING_TIMEOUT))
 			break;
-		}
-		prev = entry;
-		entry = entry->next;
+		if (p->dirty)
+			db_flush(data);
+		eap_sim_db_free_pseudonym(data, p);
+	}
+	while (data->reauth_by_permanent.count > EAP_SIM_DB_MAX_CACHED) {
+		r = dl_list_last(&data->reauth_list, struct eap_sim_db_reauth,
+				 list);
+		if (r->refcount ||
+		    !os_reltime_expired(&now, &r->last_used,
+					EAP_SIM_DB_PENDING_TIMEOUT))
+			break;
+		if (r->dirty)
+			db_flush(data);
+		eap_sim_db_free_reauth(data, r);
+	}
+}
+#endif /* CONFIG_SQLITE */
+
+
+static struct eap_sim_pseudonym *
+eap_sim_db_cache_pseudonym(struct eap_sim_db_data *data, const char *permanent,
+			   char *pseudonym)
+{
+	struct eap_sim_db_hnode *node;
+	struct eap_sim_pseudonym *p;
+
+	node = eap_sim_db_htable_get(&data->pseudonym_by_permanent, permanent);
+	if (node) {
+		p = eap_sim_db_entry(node, struct eap_sim_pseudonym,
+				     by_permanent);
+		wpa_printf(MSG_DEBUG, "EAP-SIM DB: Replacing previous "
+			   "pseudonym: %s", p->pseudonym);
+		eap_sim_db_htable_del(&data->pseudonym_by_id, &p->by_pseudonym);
+		os_free(p->pseudonym);
+		p->pseudonym = pseudonym;
+		p->by_pseudonym.key = pseudonym;
+		eap_sim_db_htable_add(&data->pseudonym_by_id, &p->by_pseudonym);
+		eap_sim_db_used(&data->pseudonym_list, &p->list,
+				&p->last_used);
+		return p;
+	}
+
+	p = os_zalloc(sizeof(*p));
+	if (p == NULL) {
+		os_free(pseudonym);
+		return NULL;
 	}
-	return entry;
+
+	p->permanent = os_strdup(permanent);
+	if (p->permanent == NULL) {
+		os_free(p);
+		os_free(pseudonym);
+		return NULL;
+	}
+	p->pseudonym = pseudonym;
+	p->by_permanent.key = p->permanent;
+	p->by_pseudonym.key = p->pseudonym;
+	if (eap_sim_db_htable_add(&data->pseudonym_by_permanent,
+				  &p->by_permanent) < 0) {
+		os_free(p->permanent);
+		os_free(p->pseudonym);
+		os_free(p);
+		return NULL;
+	}
+	if (eap_sim_db_htable_add(&data->pseudonym_by_id, &p->by_pseudonym) <
+	    0) {
+		eap_sim_db_htable_del(&data->pseudonym_by_permanent,
+				      &p->by_permanent);
+		os_free(p->permanent);
+		os_free(p->pseudonym);
+		os_free(p);
+		return NULL;
+	}
+	dl_list_add(&data->pseudonym_list, &p->list);
+	os_get_reltime(&p->last_used);
+	data->stats.ids_cached++;
+
+	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Added new pseudonym entry");
+	return p;
+}
+
+
+static unsigned int eap_sim_db_hash(const char *imsi, int aka)
+{
+	unsigned int hash = aka;
+
+	while (*imsi)
+		hash = hash * 31 + (u8) *imsi++;
+	return hash & (EAP_SIM_DB_HASH_SIZE - 1);
+}
+
+
+static struct eap_sim_db_pending *
+eap_sim_db_get_pending(struct eap_sim_db_data *data, const char *imsi, int aka,
+		       void *cb_session_ctx)
+{
+	struct eap_sim_db_pending *entry;
+
+	for (entry = data->pending[eap_sim_db_hash(imsi, aka)]; entry;
+	     entry = entry->next) {
+		if (entry->cb_session_ctx == cb_session_ctx &&
+		    entry->aka == aka && os_strcmp(entry->imsi, imsi) == 0)
+			return entry;
+	}
+	return NULL;
+}
+
+
+/*
+ * The external server does not identify the request in its response, so match
+ * the response to the oldest request that is still waiting for the IMSI.
+ */
+static struct eap_sim_db_pending *
+eap_sim_db_get_pending_resp(struct eap_sim_db_data *data, const char *imsi,
+			    int aka, int bulk)
+{
+	struct eap_sim_db_pending *entry, *oldest = NULL;
+
+	for (entry = data->pending[eap_sim_db_hash(imsi, aka)]; entry;
+	     entry = entry->next) {
+		if (entry->state == PENDING && entry->aka == aka &&
+		    !entry->bulk == !bulk &&
+		    os_strcmp(entry->imsi, imsi) == 0 &&
+		    (oldest == NULL || (int) (entry->seq - oldest->seq) < 0))
+			oldest = entry;
+	}
+	return oldest;
 }
 
 
 static void eap_sim_db_add_pending(struct eap_sim_db_data *data,
 				   struct eap_sim_db_pending *entry)
 {
-	entry->next = data->pending;
-	data->pending = entry;
+	unsigned int hash = eap_sim_db_hash(entry->imsi, entry->aka);
+
+	entry->seq = data->pending_seq++;
+	entry->next = data->pending[hash];
+	data->pending[hash] = entry;
+	dl_list_add_tail(&data->pending_list, &entry->list);
+	data->num_pending++;
+}
+
+
+static void eap_sim_db_del_pending(struct eap_sim_db_data *data,
+				   struct eap_sim_db_pending *entry)
+{
+	struct eap_sim_db_pending **pos;
+
+	pos = &data->pending[eap_sim_db_hash(entry->imsi, entry->aka)];
+	while (*pos) {
+		if (*pos == entry) {
+			*pos = entry->next;
+			break;
+		}
+		pos = &(*pos)->next;
+	}
+	dl_list_del(&entry->list);
+	data->num_pending--;
+	os_free(entry);
+}
+
+
+static struct eap_sim_db_pool *
+eap_sim_db_get_pool(struct eap_sim_db_data *data, const char *imsi, int aka)
+{
+	struct eap_sim_db_pool *pool;
+
+	for (pool = data->pools[eap_sim_db_hash(imsi, aka)]; pool;
+	     pool = pool->next) {
+		if (pool->aka == aka && os_strcmp(pool->imsi, imsi) == 0)
+			return pool;
+	}
+	return NULL;
+}
+
+
+static void eap_sim_db_free_pool(struct eap_sim_db_data *data,
+				 struct eap_sim_db_pool *pool)
+{
+	struct eap_sim_db_pool **pos;
+
+	pos = &data->pools[eap_sim_db_hash(pool->imsi, pool->aka)];
+	while (*pos) {
+		if (*pos == pool) {
+			*pos = pool->next;
+			break;
+		}
+		pos = &(*pos)->next;
+	}
+	dl_list_del(&pool->list);
+	data->num_pools--;
+	data->stats.pooled -= pool->num;
+	os_memset(pool->vec, 0, data->prefetch * sizeof(*pool->vec));
+	os_free(pool->vec);
+	os_free(pool);
+}
+
+
+static void eap_sim_db_flush_pool(struct eap_sim_db_data *data,
+				  struct eap_sim_db_pool *pool)
+{
+	data->stats.pooled -= pool->num;
+	os_memset(pool->vec, 0, pool->num * sizeof(*pool->vec));
+	pool->num = 0;
+}
+
+
+/*
+ * Find the prefetch pool for an IMSI and mark it recently used. A new pool is
+ * added only if add is set, i.e., for an IMSI that has authenticated
+ * successfully.
+ */
+static struct eap_sim_db_pool *
+eap_sim_db_use_pool(struct eap_sim_db_data *data, const char *imsi, int aka,
+		    int add)
+{
+	struct eap_sim_db_pool *pool;
+	struct os_reltime now;
+	unsigned int hash;
+
+	os_get_reltime(&now);
+	pool = eap_sim_db_get_pool(data, imsi, aka);
+	if (pool) {
+		if (os_reltime_expired(&now, &pool->last_used,
+				       EAP_SIM_DB_POOL_LIFETIME))
+			eap_sim_db_flush_pool(data, pool);
+		pool->last_used = now;
+		dl_list_del(&pool->list);
+		dl_list_add(&data->pool_list, &pool->list);
+		return pool;
+	}
+
+	if (!add || data->prefetch_imsis == 0)
+		return NULL;
+	while (data->num_pools >= data->prefetch_imsis) {
+		eap_sim_db_free_pool(data, dl_list_last(&data->pool_list,
+							struct eap_sim_db_pool,
+							list));
+	}
+
+	pool = os_zalloc(sizeof(*pool));
+	if (pool == NULL)
+		return NULL;
+	pool->vec = os_calloc(data->prefetch, sizeof(*pool->vec));
+	if (pool->vec == NULL) {
+		os_free(pool);
+		return NULL;
+	}
+	os_strlcpy(pool->imsi, imsi, sizeof(pool->imsi));
+	pool->aka = aka;
+	pool->last_used = now;
+	hash = eap_sim_db_hash(imsi, aka);
+	pool->next = data->pools[hash];
+	data->pools[hash] = pool;
+	dl_list_add(&data->pool_list, &pool->list);
+	data->num_pools++;
+
+	return pool;
+}
+
+
+/* Take the oldest num vectors from the prefetch pool of an IMSI */
+static int eap_sim_db_pool_take(struct eap_sim_db_data *data, const char *imsi,
+				int aka, unsigned int num,
+				struct eap_sim_db_vector *vec)
+{
+	struct eap_sim_db_pool *pool;
+
+	if (data->prefetch == 0)
+		return -1;
+
+	pool = eap_sim_db_use_pool(data, imsi, aka, 0);
+	if (pool == NULL || pool->num < num) {
+		data->stats.pool_misses++;
+		return -1;
+	}
+
+	os_memcpy(vec, pool->vec, num * sizeof(*vec));
+	pool->num -= num;
+	os_memmove(pool->vec, pool->vec + num, pool->num * sizeof(*vec));
+	os_memset(pool->vec + pool->num, 0, num * sizeof(*vec));
+	data->stats.pooled -= num;
+	data->stats.pool_hits++;
+	return 0;
+}
+
+
+static void eap_sim_db_pool_add_aka(struct eap_sim_db_data *data,
+				    struct eap_sim_db_pool *pool,
+				    const struct eap_sim_db_vector *vec)
+{
+	if (pool->num >= data->prefetch)
+		return;
+	os_memcpy(&pool->vec[pool->num++], vec, sizeof(*vec));
+	data->stats.pooled++;
+}
+
+
+static void eap_sim_db_pool_add(struct eap_sim_db_data *data,
+				struct eap_sim_db_pending *entry)
+{
+	struct eap_sim_db_pool *pool;
+	struct eap_sim_db_vector *vec;
+	unsigned int i, num;
+
+	pool = eap_sim_db_get_pool(data, entry->imsi, entry->aka);
+	if (entry->bulk)
+		num = entry->bulk;
+	else
+		num = entry->aka ? 1 : EAP_SIM_MAX_CHAL;
+	if (pool == NULL)
+		return;
+	pool->requested = pool->requested > num ? pool->requested - num : 0;
+	if (entry->state != SUCCESS || entry->stale || entry->bulk) {
+		/* Vectors from a bulk response were already added */
+		return;
+	}
+
+	if (entry->aka) {
+		if (pool->num >= data->prefetch)
+			return;
+		vec = &pool->vec[pool->num++];
+		os_memcpy(vec->u.aka.rand, entry->u.aka.rand,
+			  EAP_AKA_RAND_LEN);
+		os_memcpy(vec->u.aka.autn, entry->u.aka.autn,
+			  EAP_AKA_AUTN_LEN);
+		os_memcpy(vec->u.aka.ik, entry->u.aka.ik, EAP_AKA_IK_LEN);
+		os_memcpy(vec->u.aka.ck, entry->u.aka.ck, EAP_AKA_CK_LEN);
+		os_memcpy(vec->u.aka.res, entry->u.aka.res,
+			  EAP_AKA_RES_MAX_LEN);
+		vec->u.aka.res_len = entry->u.aka.res_len;
+		data->stats.pooled++;
+		return;
+	}
+
+	for (i = 0; i < (unsigned int) entry->u.sim.num_chal &&
+		     pool->num < data->prefetch; i++) {
+		vec = &pool->vec[pool->num++];
+		os_memcpy(vec->u.sim.kc, entry->u.sim.kc[i], EAP_SIM_KC_LEN);
+		os_memcpy(vec->u.sim.sres, entry->u.sim.sres[i],
+			  EAP_SIM_SRES_LEN);
+		os_memcpy(vec->u.sim.rand, entry->u.sim.rand[i],
+			  GSM_RAND_LEN);
+		data->stats.pooled++;
+	}
+}
+
+
+/* Process a received response (or failure) for a pending entry */
+static void eap_sim_db_pending_done(struct eap_sim_db_data *data,
+				    struct eap_sim_db_pending *entry)
+{
+	struct os_reltime now, age;
+	unsigned long usec;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &entry->sent, &age);
+	usec = age.sec * 1000000 + age.usec;
+	data->stats.responses++;
+	data->stats.latency_usec += usec;
+	if (usec > data->stats.latency_max_usec)
+		data->stats.latency_max_usec = usec;
+	if (entry->state == FAILURE)
+		data->stats.failures++;
+
+	if (entry->cb_session_ctx == NULL) {
+		/* Prefetch request */
+		eap_sim_db_pool_add(data, entry);
+		eap_sim_db_del_pending(data, entry);
+		return;
+	}
+
+	data->get_complete_cb(data->ctx, entry->cb_session_ctx);
 }
 
 
@@ -410,7 +1098,7 @@ static void eap_sim_db_sim_resp_auth(struct eap_sim_db_data *data,
 	 * (IMSI = ASCII string, Kc/SRES/RAND = hex string)
 	 */
 
-	entry = eap_sim_db_get_pending(data, imsi, 0);
+	entry = eap_sim_db_get_pending_resp(data, imsi, 0, 0);
 	if (entry == NULL) {
 		wpa_printf(MSG_DEBUG, "EAP-SIM DB: No pending entry for the "
 			   "received message found");
@@ -422,8 +1110,7 @@ static void eap_sim_db_sim_resp_auth(struct eap_sim_db_data *data,
 		wpa_printf(MSG_DEBUG, "EAP-SIM DB: External server reported "
 			   "failure");
 		entry->state = FAILURE;
-		eap_sim_db_add_pending(data, entry);
-		data->get_complete_cb(data->ctx, entry->cb_session_ctx);
+		eap_sim_db_pending_done(data, entry);
 		return;
 	}
 
@@ -466,78 +1153,55 @@ static void eap_sim_db_sim_resp_auth(struct eap_sim_db_data *data,
 	entry->state = SUCCESS;
 	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Authentication data parsed "
 		   "successfully - callback");
-	eap_sim_db_add_pending(data, entry);
-	data->get_complete_cb(data->ctx, entry->cb_session_ctx);
+	eap_sim_db_pending_done(data, entry);
 	return;
 
 parse_fail:
 	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Failed to parse response string");
-	os_free(entry);
+	entry->state = FAILURE;
+	eap_sim_db_pending_done(data, entry);
 }
 
 
-static void eap_sim_db_aka_resp_auth(struct eap_sim_db_data *data,
-				     const char *imsi, char *buf)
+/* Parse RAND, AUTN, IK, CK, and RES hex strings separated by sep */
+static int eap_sim_db_parse_aka(char *start, char sep, u8 *_rand, u8 *autn,
+				u8 *ik, u8 *ck, u8 *res, size_t *res_len)
 {
-	char *start, *end;
-	struct eap_sim_db_pending *entry;
+	char *end;
 
-	/*
-	 * AKA-RESP-AUTH <IMSI> <RAND> <AUTN> <IK> <CK> <RES>
-	 * AKA-RESP-AUTH <IMSI> FAILURE
-	 * (IMSI = ASCII string, RAND/AUTN/IK/CK/RES = hex string)
-	 */
-
-	entry = eap_sim_db_get_pending(data, imsi, 1);
-	if (entry == NULL) {
-		wpa_printf(MSG_DEBUG, "EAP-SIM DB: No pending entry for the "
-			   "received message found");
-		return;
-	}
-
-	start = buf;
-	if (os_strncmp(start, "FAILURE", 7) == 0) {
-		wpa_printf(MSG_DEBUG, "EAP-SIM DB: External server reported "
-			   "failure");
-		entry->state = FAILURE;
-		eap_sim_db_add_pending(data, entry);
-		data->get_complete_cb(data->ctx, entry->cb_session_ctx);
-		return;
-	}
-
-	end = os_strchr(start, ' ');
+	end = os_strchr(start, sep);
 	if (end == NULL)
-		goto parse_fail;
+		return -1;
 	*end = '\0';
-	if (hexstr2bin(start, entry->u.aka.rand, EAP_AKA_RAND_LEN))
-		goto parse_fail;
+	if (hexstr2bin(start, _rand, EAP_AKA_RAND_LEN))
+		return -1;
 
 	start = end + 1;
-	end = os_strchr(start, ' ');
+	end = os_strchr(start, sep);
 	if (end == NULL)
-		goto parse_fail;
+		return -1;
 	*end = '\0';
-	if (hexstr2bin(start, entry->u.aka.autn, EAP_AKA_AUTN_LEN))
-		goto parse_fail;
+	if (hexstr2bin(start, autn, EAP_AKA_AUTN_LEN))
+		return -1;
 
 	start = end + 1;
-	end = os_strchr(start, ' ');
+	end = os_strchr(start, sep);
 	if (end == NULL)
-		goto parse_fail;
+		return -1;
 	*end = '\0';
-	if (hexstr2bin(start, entry->u.aka.ik, EAP_AKA_IK_LEN))
-		goto parse_fail;
+	if (hexstr2bin(start, ik, EAP_AKA_IK_LEN))
+		return -1;
 
 	start = end + 1;
-	end = os_strchr(start, ' ');
+	end = os_strchr(start, sep);
 	if (end == NULL)
-		goto parse_fail;
+		return -1;
 	*end = '\0';
-	if (hexstr2bin(start, entry->u.aka.ck, EAP_AKA_CK_LEN))
-		goto parse_fail;
+	if (hexstr2bin(start, ck, EAP_AKA_CK_LEN))
+		return -1;
 
 	start = end + 1;
-	end = os_strchr(start, ' ');
+	end = os_strchr(start, sep);
 	if (end)
 		*end = '\0';
 	else {
@@ -545,32 +1209,123 @@ static void eap_sim_db_aka_resp_auth(struct eap_sim_db_data *data,
 		while (*end)
 			end++;
 	}
-	entry->u.aka.res_len = (end - start) / 2;
-	if (entry->u.aka.res_len > EAP_AKA_RES_MAX_LEN) {
+	*res_len = (end - start) / 2;
+	if (*res_len > EAP_AKA_RES_MAX_LEN) {
 		wpa_printf(MSG_DEBUG, "EAP-SIM DB: Too long RES");
-		entry->u.aka.res_len = 0;
-		goto parse_fail;
+		*res_len = 0;
+		return -1;
+	}
+	if (hexstr2bin(start, res, *res_len))
+		return -1;
+
+	return 0;
+}
+
+
+static void eap_sim_db_aka_resp_auth(struct eap_sim_db_data *data,
+				     const char *imsi, char *buf)
+{
+	struct eap_sim_db_pending *entry;
+
+	/*
+	 * AKA-RESP-AUTH <IMSI> <RAND> <AUTN> <IK> <CK> <RES>
+	 * AKA-RESP-AUTH <IMSI> FAILURE
+	 * (IMSI = ASCII string, RAND/AUTN/IK/CK/RES = hex string)
+	 */
+
+	entry = eap_sim_db_get_pending_resp(data, imsi, 1, 0);
+	if (entry == NULL) {
+		wpa_printf(MSG_DEBUG, "EAP-SIM DB: No pending entry for the "
+			   "received message found");
+		return;
+	}
+
+	if (os_strncmp(buf, "FAILURE", 7) == 0) {
+		wpa_printf(MSG_DEBUG, "EAP-SIM DB: External server reported "
+			   "failure");
+		entry->state = FAILURE;
+		eap_sim_db_pending_done(data, entry);
+		return;
+	}
+
+	if (eap_sim_db_parse_aka(buf, ' ', entry->u.aka.rand,
+				 entry->u.aka.autn, entry->u.aka.ik,
+				 entry->u.aka.ck, entry->u.aka.res,
+				 &entry->u.aka.res_len) < 0) {
+		wpa_printf(MSG_DEBUG, "EAP-SIM DB: Failed to parse response "
+			   "string");
+		entry->state = FAILURE;
+		eap_sim_db_pending_done(data, entry);
+		return;
 	}
-	if (hexstr2bin(start, entry->u.aka.res, entry->u.aka.res_len))
-		goto parse_fail;
 
 	entry->state = SUCCESS;
 	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Authentication data parsed "
 		   "successfully - callback");
-	eap_sim_db_add_pending(data, entry);
-	data->get_complete_cb(data->ctx, entry->cb_session_ctx);
-	return;
+	eap_sim_db_pending_done(data, entry);
+}
 
-parse_fail:
-	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Failed to parse response string");
-	os_free(entry);
+
+static void eap_sim_db_aka_resp_auth_bulk(struct eap_sim_db_data *data,
+					  const char *imsi, char *buf)
+{
+	struct eap_sim_db_pending *entry;
+	struct eap_sim_db_pool *pool;
+	struct eap_sim_db_vector vec;
+	char *start, *end;
+	unsigned int num = 0;
+
+	/*
+	 * AKA-RESP-AUTH-BULK <IMSI> RAND:AUTN:IK:CK:RES [RAND:AUTN:IK:CK:RES]
+	 * AKA-RESP-AUTH-BULK <IMSI> FAILURE
+	 * (IMSI = ASCII string, RAND/AUTN/IK/CK/RES = hex string)
+	 */
+
+	entry = eap_sim_db_get_pending_resp(data, imsi, 1, 1);
+	if (entry == NULL) {
+		wpa_printf(MSG_DEBUG, "EAP-SIM DB: No pending entry for the "
+			   "received message found");
+		return;
+	}
+
+	if (os_strncmp(buf, "FAILURE", 7) == 0) {
+		wpa_printf(MSG_DEBUG, "EAP-SIM DB: External server reported "
+			   "failure");
+		entry->state = FAILURE;
+		eap_sim_db_pending_done(data, entry);
+		return;
+	}
+
+	pool = eap_sim_db_get_pool(data, imsi, 1);
+	start = buf;
+	while (start && *start && num < entry->bulk) {
+		end = os_strchr(start, ' ');
+		if (end)
+			*end++ = '\0';
+		os_memset(&vec, 0, sizeof(vec));
+		if (eap_sim_db_parse_aka(start, ':', vec.u.aka.rand,
+					 vec.u.aka.autn, vec.u.aka.ik,
+					 vec.u.aka.ck, vec.u.aka.res,
+					 &vec.u.aka.res_len) < 0)
+			break;
+		if (pool && !entry->stale)
+			eap_sim_db_pool_add_aka(data, pool, &vec);
+		num++;
+		start = end;
+	}
+	os_memset(&vec, 0, sizeof(vec));
+
+	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Received %u prefetched AKA "
+		   "vector(s)", num);
+	entry->state = num ? SUCCESS : FAILURE;
+	eap_sim_db_pending_done(data, entry);
 }
 
 
 static void eap_sim_db_receive(int sock, void *eloop_ctx, void *sock_ctx)
 {
 	struct eap_sim_db_data *data = eloop_ctx;
-	char buf[1000], *pos, *cmd, *imsi;
+	char buf[4000], *pos, *cmd, *imsi;
 	int res;
 
 	res = recv(sock, buf, sizeof(buf), 0);
@@ -609,6 +1364,8 @@ static void eap_sim_db_receive(int sock, void *eloop_ctx, void *sock_ctx)
 		eap_sim_db_sim_resp_auth(data, imsi, pos + 1);
 	else if (os_strcmp(cmd, "AKA-RESP-AUTH") == 0)
 		eap_sim_db_aka_resp_auth(data, imsi, pos + 1);
+	else if (os_strcmp(cmd, "AKA-RESP-AUTH-BULK") == 0)
+		eap_sim_db_aka_resp_auth_bulk(data, imsi, pos + 1);
 	else
 		wpa_printf(MSG_INFO, "EAP-SIM DB: Unknown external response "
 			   "'%s'", cmd);
@@ -709,6 +1466,14 @@ eap_sim_db_init(const char *config,
 		return NULL;
 
 	data->sock = -1;
+	dl_list_init(&data->pending_list);
+	dl_list_init(&data->pool_list);
+	dl_list_init(&data->pseudonym_list);
+	dl_list_init(&data->reauth_list);
+	dl_list_init(&data->removed_reauth_list);
+	dl_list_init(&data->dirty_pseudonyms);
+	dl_list_init(&data->dirty_reauths);
+	dl_list_init(&data->removed_reauths);
 	data->get_complete_cb = get_complete_cb;
 	data->ctx = ctx;
 	data->fname = os_strdup(config);
@@ -739,23 +1504,7 @@ fail:
 	eap_sim_db_close_socket(data);
 	os_free(data->fname);
 	os_free(data);
-	return NULL;
-}
-
-
-static void eap_sim_db_free_pseudonym(struct eap_sim_pseudonym *p)
-{
-	os_free(p->permanent);
-	os_free(p->pseudonym);
-	os_free(p);
-}
-
-
-static void eap_sim_db_free_reauth(struct eap_sim_reauth *r)
-{
-	os_free(r->permanent);
-	os_free(r->reauth_id);
-	os_free(r);
+	return NULL;
 }
 
 
@@ -766,12 +1515,14 @@ static void eap_sim_db_free_reauth(struct eap_sim_reauth *r)
 void eap_sim_db_deinit(void *priv)
 {
 	struct eap_sim_db_data *data = priv;
-	struct eap_sim_pseudonym *p, *prev;
-	struct eap_sim_reauth *r, *prevr;
-	struct eap_sim_db_pending *pending, *prev_pending;
+	struct eap_sim_pseudonym *p;
+	struct eap_sim_db_reauth *r;
+	struct eap_sim_db_pending *pending;
+	struct eap_sim_db_pool *pool;
 
 #ifdef CONFIG_SQLITE
 	if (data->sqlite_db) {
+		db_flush(data);
 		sqlite3_close(data->sqlite_db);
 		data->sqlite_db = NULL;
 	}
@@ -780,26 +1531,26 @@ void eap_sim_db_deinit(void *priv)
 	eap_sim_db_close_socket(data);
 	os_free(data->fname);
 
-	p = data->pseudonyms;
-	while (p) {
-		prev = p;
-		p = p->next;
-		eap_sim_db_free_pseudonym(prev);
-	}
-
-	r = data->reauths;
-	while (r) {
-		prevr = r;
-		r = r->next;
-		eap_sim_db_free_reauth(prevr);
-	}
-
-	pending = data->pending;
-	while (pending) {
-		prev_pending = pending;
-		pending = pending->next;
-		os_free(prev_pending);
-	}
+	while ((p = dl_list_first(&data->pseudonym_list,
+				  struct eap_sim_pseudonym, list)))
+		eap_sim_db_free_pseudonym(data, p);
+	while ((r = dl_list_first(&data->reauth_list, struct eap_sim_db_reauth,
+				  list)))
+		eap_sim_db_free_reauth(data, r);
+	while ((r = dl_list_first(&data->removed_reauth_list,
+				  struct eap_sim_db_reauth, list)))
+		eap_sim_db_free_reauth(data, r);
+	eap_sim_db_htable_deinit(&data->pseudonym_by_permanent);
+	eap_sim_db_htable_deinit(&data->pseudonym_by_id);
+	eap_sim_db_htable_deinit(&data->reauth_by_permanent);
+	eap_sim_db_htable_deinit(&data->reauth_by_id);
+
+	while ((pending = dl_list_first(&data->pending_list,
+					struct eap_sim_db_pending, list)))
+		eap_sim_db_del_pending(data, pending);
+	while ((pool = dl_list_first(&data->pool_list, struct eap_sim_db_pool,
+				     list)))
+		eap_sim_db_free_pool(data, pool);
 
 	os_free(data);
 }
@@ -837,9 +1588,147 @@ static int eap_sim_db_send(struct eap_sim_db_data *data, const char *msg,
 
 static void eap_sim_db_expire_pending(struct eap_sim_db_data *data)
 {
-	/* TODO: add limit for maximum length for pending list; remove latest
-	 * (i.e., last) entry from the list if the limit is reached; could also
-	 * use timeout to expire pending entries */
+	struct eap_sim_db_pending *entry;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	while ((entry = dl_list_first(&data->pending_list,
+				      struct eap_sim_db_pending, list))) {
+		if (data->num_pending <= EAP_SIM_DB_MAX_PENDING &&
+		    !os_reltime_expired(&now, &entry->sent,
+					EAP_SIM_DB_PENDING_TIMEOUT))
+			break;
+		wpa_printf(MSG_DEBUG, "EAP-SIM DB: Expire pending %s entry "
+			   "for IMSI '%s'", entry->aka ? "AKA" : "SIM",
+			   entry->imsi);
+		if (entry->cb_session_ctx == NULL) {
+			entry->state = FAILURE;
+			eap_sim_db_pool_add(data, entry);
+		}
+		eap_sim_db_del_pending(data, entry);
+	}
+}
+
+
+/*
+ * Send a request for authentication data. For SIM, num is the maximum number
+ * of triplets. For AKA, num > 0 requests that many vectors with
+ * AKA-REQ-AUTH-BULK (prefetch only) and 0 a single vector.
+ */
+static int eap_sim_db_send_req(struct eap_sim_db_data *data, const char *imsi,
+			       int aka, int num, void *cb_session_ctx)
+{
+	struct eap_sim_db_pending *entry;
+	int len, ret;
+	char msg[50];
+	size_t imsi_len;
+
+	if (data->sock < 0) {
+		if (eap_sim_db_open_socket(data) < 0)
+			return -1;
+	}
+
+	imsi_len = os_strlen(imsi);
+	len = os_snprintf(msg, sizeof(msg), "%s-REQ-AUTH%s ",
+			  aka ? "AKA" : "SIM", aka && num ? "-BULK" : "");
+	if (len < 0 || len + imsi_len >= sizeof(msg))
+		return -1;
+	os_memcpy(msg + len, imsi, imsi_len);
+	len += imsi_len;
+	if (!aka || num) {
+		ret = os_snprintf(msg + len, sizeof(msg) - len, " %d", num);
+		if (ret < 0 || (size_t) ret >= sizeof(msg) - len)
+			return -1;
+		len += ret;
+	}
+
+	wpa_printf(MSG_DEBUG, "EAP-SIM DB: requesting %s authentication "
+		   "data for IMSI '%s'%s", aka ? "AKA" : "SIM", imsi,
+		   cb_session_ctx ? "" : " (prefetch)");
+	if (eap_sim_db_send(data, msg, len) < 0)
+		return -1;
+
+	entry = os_zalloc(sizeof(*entry));
+	if (entry == NULL)
+		return -1;
+
+	entry->aka = aka;
+	if (aka)
+		entry->bulk = num;
+	os_strlcpy(entry->imsi, imsi, sizeof(entry->imsi));
+	entry->cb_session_ctx = cb_session_ctx;
+	entry->state = PENDING;
+	os_get_reltime(&entry->sent);
+	eap_sim_db_add_pending(data, entry);
+	data->stats.requests++;
+	if (cb_session_ctx == NULL)
+		data->stats.prefetch_requests++;
+	eap_sim_db_expire_pending(data);
+
+	return 0;
+}
+
+
+/*
+ * Request more vectors to keep the prefetch pool filled. This is done only for
+ * IMSIs that already have a pool, i.e., that have authenticated successfully.
+ * AKA vectors are requested with a single bulk request; each SIM request
+ * returns up to EAP_SIM_MAX_CHAL triplets.
+ */
+static void eap_sim_db_prefetch(struct eap_sim_db_data *data, const char *imsi,
+				int aka)
+{
+	struct eap_sim_db_pool *pool;
+	unsigned int num;
+
+	if (data->prefetch == 0)
+		return;
+
+	pool = eap_sim_db_use_pool(data, imsi, aka, 0);
+	while (pool && pool->num + pool->requested < data->prefetch) {
+		if (aka) {
+			num = data->prefetch - pool->num - pool->requested;
+			if (num > EAP_SIM_DB_MAX_BULK)
+				num = EAP_SIM_DB_MAX_BULK;
+		} else {
+			num = EAP_SIM_MAX_CHAL;
+		}
+		if (eap_sim_db_send_req(data, imsi, aka, num, NULL) < 0)
+			break;
+		pool->requested += num;
+	}
+}
+
+
+/**
+ * eap_sim_db_authenticated - Notify of a successful full authentication
+ * @data: Private data pointer from eap_sim_db_init()
+ * @permanent: Permanent username of the peer
+ *
+ * Authentication vectors are prefetched only for IMSIs that have been reported
+ * with this function, so that unauthenticated peers cannot use an identity to
+ * make the server request vectors from the external server.
+ */
+void eap_sim_db_authenticated(struct eap_sim_db_data *data,
+			      const char *permanent)
+{
+	int aka;
+
+	if (data->prefetch == 0 || permanent == NULL ||
+	    permanent[0] == '\0' || permanent[1] == '\0' ||
+	    os_strlen(permanent) > 20)
+		return;
+
+	if (permanent[0] == EAP_SIM_PERMANENT_PREFIX)
+		aka = 0;
+	else if (permanent[0] == EAP_AKA_PERMANENT_PREFIX ||
+		 permanent[0] == EAP_AKA_PRIME_PERMANENT_PREFIX)
+		aka = 1;
+	else
+		return;
+
+	if (eap_sim_db_use_pool(data, permanent + 1, aka, 1))
+		eap_sim_db_prefetch(data, permanent + 1, aka);
 }
 
 
@@ -872,10 +1761,9 @@ int eap_sim_db_get_gsm_triplets(struct eap_sim_db_data *data,
 				void *cb_session_ctx)
 {
 	struct eap_sim_db_pending *entry;
-	int len, ret;
-	char msg[40];
+	struct eap_sim_db_vector vec[EAP_SIM_MAX_CHAL];
 	const char *imsi;
-	size_t imsi_len;
+	int i;
 
 	if (username == NULL || username[0] != EAP_SIM_PERMANENT_PREFIX ||
 	    username[1] == '\0' || os_strlen(username) > sizeof(entry->imsi)) {
@@ -887,20 +1775,19 @@ int eap_sim_db_get_gsm_triplets(struct eap_sim_db_data *data,
 	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Get GSM triplets for IMSI '%s'",
 		   imsi);
 
-	entry = eap_sim_db_get_pending(data, imsi, 0);
+	entry = eap_sim_db_get_pending(data, imsi, 0, cb_session_ctx);
 	if (entry) {
 		int num_chal;
 		if (entry->state == FAILURE) {
 			wpa_printf(MSG_DEBUG, "EAP-SIM DB: Pending entry -> "
 				   "failure");
-			os_free(entry);
+			eap_sim_db_del_pending(data, entry);
 			return EAP_SIM_DB_FAILURE;
 		}
 
 		if (entry->state == PENDING) {
 			wpa_printf(MSG_DEBUG, "EAP-SIM DB: Pending entry -> "
 				   "still pending");
-			eap_sim_db_add_pending(data, entry);
 			return EAP_SIM_DB_PENDING;
 		}
 
@@ -913,40 +1800,31 @@ int eap_sim_db_get_gsm_triplets(struct eap_sim_db_data *data,
 		os_memcpy(sres, entry->u.sim.sres,
 			  num_chal * EAP_SIM_SRES_LEN);
 		os_memcpy(kc, entry->u.sim.kc, num_chal * EAP_SIM_KC_LEN);
-		os_free(entry);
+		eap_sim_db_del_pending(data, entry);
+		eap_sim_db_prefetch(data, imsi, 0);
 		return num_chal;
 	}
 
-	if (data->sock < 0) {
-		if (eap_sim_db_open_socket(data) < 0)
-			return EAP_SIM_DB_FAILURE;
+	if (max_chal > 0 && max_chal <= EAP_SIM_MAX_CHAL &&
+	    eap_sim_db_pool_take(data, imsi, 0, max_chal, vec) == 0) {
+		wpa_printf(MSG_DEBUG, "EAP-SIM DB: Using %d prefetched "
+			   "triplets", max_chal);
+		for (i = 0; i < max_chal; i++) {
+			os_memcpy(_rand + i * GSM_RAND_LEN, vec[i].u.sim.rand,
+				  GSM_RAND_LEN);
+			os_memcpy(sres + i * EAP_SIM_SRES_LEN,
+				  vec[i].u.sim.sres, EAP_SIM_SRES_LEN);
+			os_memcpy(kc + i * EAP_SIM_KC_LEN, vec[i].u.sim.kc,
+				  EAP_SIM_KC_LEN);
+		}
+		os_memset(vec, 0, sizeof(vec));
+		eap_sim_db_prefetch(data, imsi, 0);
+		return max_chal;
 	}
 
-	imsi_len = os_strlen(imsi);
-	len = os_snprintf(msg, sizeof(msg), "SIM-REQ-AUTH ");
-	if (len < 0 || len + imsi_len >= sizeof(msg))
-		return EAP_SIM_DB_FAILURE;
-	os_memcpy(msg + len, imsi, imsi_len);
-	len += imsi_len;
-	ret = os_snprintf(msg + len, sizeof(msg) - len, " %d", max_chal);
-	if (ret < 0 || (size_t) ret >= sizeof(msg) - len)
-		return EAP_SIM_DB_FAILURE;
-	len += ret;
-
-	wpa_printf(MSG_DEBUG, "EAP-SIM DB: requesting SIM authentication "
-		   "data for IMSI '%s'", imsi);
-	if (eap_sim_db_send(data, msg, len) < 0)
-		return EAP_SIM_DB_FAILURE;
-
-	entry = os_zalloc(sizeof(*entry));
-	if (entry == NULL)
+	if (eap_sim_db_send_req(data, imsi, 0, max_chal, cb_session_ctx) < 0)
 		return EAP_SIM_DB_FAILURE;
-
-	os_strlcpy(entry->imsi, imsi, sizeof(entry->imsi));
-	entry->cb_session_ctx = cb_session_ctx;
-	entry->state = PENDING;
-	eap_sim_db_add_pending(data, entry);
-	eap_sim_db_expire_pending(data);
+	eap_sim_db_prefetch(data, imsi, 0);
 
 	return EAP_SIM_DB_PENDING;
 }
@@ -1058,38 +1936,23 @@ int eap_sim_db_add_pseudonym(struct eap_sim_db_data *data,
 
 	/* TODO: could store last two pseudonyms */
 #ifdef CONFIG_SQLITE
-	if (data->sqlite_db)
-		return db_add_pseudonym(data, permanent, pseudonym);
-#endif /* CONFIG_SQLITE */
-	for (p = data->pseudonyms; p; p = p->next) {
-		if (os_strcmp(permanent, p->permanent) == 0)
-			break;
-	}
-	if (p) {
-		wpa_printf(MSG_DEBUG, "EAP-SIM DB: Replacing previous "
-			   "pseudonym: %s", p->pseudonym);
-		os_free(p->pseudonym);
-		p->pseudonym = pseudonym;
-		return 0;
-	}
-
-	p = os_zalloc(sizeof(*p));
-	if (p == NULL) {
+	if (data->sqlite_db &&
+	    (!valid_db_string(permanent) || !valid_db_string(pseudonym))) {
 		os_free(pseudonym);
 		return -1;
 	}
-
-	p->next = data->pseudonyms;
-	p->permanent = os_strdup(permanent);
-	if (p->permanent == NULL) {
-		os_free(p);
-		os_free(pseudonym);
+#endif /* CONFIG_SQLITE */
+	p = eap_sim_db_cache_pseudonym(data, permanent, pseudonym);
+	if (p == NULL)
 		return -1;
+#ifdef CONFIG_SQLITE
+	if (data->sqlite_db) {
+		db_changed(data, &data->dirty_pseudonyms, &p->dirty_list,
+			   &p->dirty);
+		eap_sim_db_evict(data);
 	}
-	p->pseudonym = pseudonym;
-	data->pseudonyms = p;
+#endif /* CONFIG_SQLITE */
 
-	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Added new pseudonym entry");
 	return 0;
 }
 
@@ -1099,18 +1962,29 @@ eap_sim_db_add_reauth_data(struct eap_sim_db_data *data,
 			   const char *permanent,
 			   char *reauth_id, u16 counter)
 {
-	struct eap_sim_reauth *r;
+	struct eap_sim_db_hnode *node;
+	struct eap_sim_db_reauth *r;
 
-	for (r = data->reauths; r; r = r->next) {
-		if (os_strcmp(r->permanent, permanent) == 0)
-			break;
+#ifdef CONFIG_SQLITE
+	if (data->sqlite_db &&
+	    (!valid_db_string(permanent) || !valid_db_string(reauth_id))) {
+		os_free(reauth_id);
+		return NULL;
 	}
+#endif /* CONFIG_SQLITE */
 
-	if (r) {
+	node = eap_sim_db_htable_get(&data->reauth_by_permanent, permanent);
+	if (node) {
+		r = eap_sim_db_entry(node, struct eap_sim_db_reauth,
+				     by_permanent);
 		wpa_printf(MSG_DEBUG, "EAP-SIM DB: Replacing previous "
-			   "reauth_id: %s", r->reauth_id);
-		os_free(r->reauth_id);
-		r->reauth_id = reauth_id;
+			   "reauth_id: %s", r->r.reauth_id);
+		eap_sim_db_htable_del(&data->reauth_by_id, &r->by_reauth_id);
+		os_free(r->r.reauth_id);
+		r->r.reauth_id = reauth_id;
+		r->by_reauth_id.key = reauth_id;
+		eap_sim_db_htable_add(&data->reauth_by_id, &r->by_reauth_id);
+		eap_sim_db_used(&data->reauth_list, &r->list, &r->last_used);
 	} else {
 		r = os_zalloc(sizeof(*r));
 		if (r == NULL) {
@@ -1118,22 +1992,56 @@ eap_sim_db_add_reauth_data(struct eap_sim_db_data *data,
 			return NULL;
 		}
 
-		r->next = data->reauths;
-		r->permanent = os_strdup(permanent);
-		if (r->permanent == NULL) {
+		r->r.permanent = os_strdup(permanent);
+		if (r->r.permanent == NULL) {
+			os_free(r);
+			os_free(reauth_id);
+			return NULL;
+		}
+		r->r.reauth_id = reauth_id;
+		r->by_permanent.key = r->r.permanent;
+		r->by_reauth_id.key = r->r.reauth_id;
+		if (eap_sim_db_htable_add(&data->reauth_by_permanent,
+					  &r->by_permanent) < 0) {
+			os_free(r->r.permanent);
 			os_free(r);
 			os_free(reauth_id);
 			return NULL;
 		}
-		r->reauth_id = reauth_id;
-		data->reauths = r;
+		if (eap_sim_db_htable_add(&data->reauth_by_id,
+					  &r->by_reauth_id) < 0) {
+			eap_sim_db_htable_del(&data->reauth_by_permanent,
+					      &r->by_permanent);
+			os_free(r->r.permanent);
+			os_free(r);
+			os_free(reauth_id);
+			return NULL;
+		}
+		dl_list_add(&data->reauth_list, &r->list);
+		os_get_reltime(&r->last_used);
+		data->stats.ids_cached++;
 		wpa_printf(MSG_DEBUG, "EAP-SIM DB: Added new reauth entry");
 	}
 
-	r->counter = counter;
+	r->r.counter = counter;
+
+	return &r->r;
+}
+
+
+#ifdef CONFIG_SQLITE
+static void eap_sim_db_reauth_changed(struct eap_sim_db_data *data,
+				      struct eap_sim_reauth *reauth)
+{
+	struct eap_sim_db_reauth *r;
 
-	return r;
+	if (data->sqlite_db == NULL)
+		return;
+	r = eap_sim_db_entry(reauth, struct eap_sim_db_reauth, r);
+	db_changed(data, &data->dirty_reauths, &r->dirty_list, &r->dirty);
+	eap_sim_db_evict(data);
 }
+#endif /* CONFIG_SQLITE */
 
 
 /**
@@ -1160,16 +2068,14 @@ int eap_sim_db_add_reauth(struct eap_sim_db_data *data, const char *permanent,
 	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Add reauth_id '%s' for permanent "
 		   "identity '%s'", reauth_id, permanent);
 
-#ifdef CONFIG_SQLITE
-	if (data->sqlite_db)
-		return db_add_reauth(data, permanent, reauth_id, counter, mk,
-				     NULL, NULL, NULL);
-#endif /* CONFIG_SQLITE */
 	r = eap_sim_db_add_reauth_data(data, permanent, reauth_id, counter);
 	if (r == NULL)
 		return -1;
 
 	os_memcpy(r->mk, mk, EAP_SIM_MK_LEN);
+#ifdef CONFIG_SQLITE
+	eap_sim_db_reauth_changed(data, r);
+#endif /* CONFIG_SQLITE */
 
 	return 0;
 }
@@ -1203,11 +2109,6 @@ int eap_sim_db_add_reauth_prime(struct eap_sim_db_data *data,
 	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Add reauth_id '%s' for permanent "
 		   "identity '%s'", reauth_id, permanent);
 
-#ifdef CONFIG_SQLITE
-	if (data->sqlite_db)
-		return db_add_reauth(data, permanent, reauth_id, counter, NULL,
-				     k_encr, k_aut, k_re);
-#endif /* CONFIG_SQLITE */
 	r = eap_sim_db_add_reauth_data(data, permanent, reauth_id, counter);
 	if (r == NULL)
 		return -1;
@@ -1215,6 +2116,9 @@ int eap_sim_db_add_reauth_prime(struct eap_sim_db_data *data,
 	os_memcpy(r->k_encr, k_encr, EAP_SIM_K_ENCR_LEN);
 	os_memcpy(r->k_aut, k_aut, EAP_AKA_PRIME_K_AUT_LEN);
 	os_memcpy(r->k_re, k_re, EAP_AKA_PRIME_K_RE_LEN);
+#ifdef CONFIG_SQLITE
+	eap_sim_db_reauth_changed(data, r);
+#endif /* CONFIG_SQLITE */
 
 	return 0;
 }
@@ -1230,21 +2134,48 @@ int eap_sim_db_add_reauth_prime(struct eap_sim_db_data *data,
 const char *
 eap_sim_db_get_permanent(struct eap_sim_db_data *data, const char *pseudonym)
 {
+	struct eap_sim_db_hnode *node;
 	struct eap_sim_pseudonym *p;
-
 #ifdef CONFIG_SQLITE
-	if (data->sqlite_db)
-		return db_get_pseudonym(data, pseudonym);
+	const char *permanent;
+	char *id;
 #endif /* CONFIG_SQLITE */
 
-	p = data->pseudonyms;
-	while (p) {
-		if (os_strcmp(p->pseudonym, pseudonym) == 0)
-			return p->permanent;
-		p = p->next;
+	node = eap_sim_db_htable_get(&data->pseudonym_by_id, pseudonym);
+	if (node) {
+		data->stats.id_cache_hits++;
+		p = eap_sim_db_entry(node, struct eap_sim_pseudonym,
+				     by_pseudonym);
+		eap_sim_db_used(&data->pseudonym_list, &p->list,
+				&p->last_used);
+		return p->permanent;
 	}
+	data->stats.id_cache_misses++;
+
+#ifdef CONFIG_SQLITE
+	if (data->sqlite_db == NULL)
+		return NULL;
 
+	/*
+	 * Changes that have not yet been written to the database are all in
+	 * the cache, so a pseudonym read from the database is stale if the
+	 * cache has a (newer) pseudonym for the same permanent identity.
+	 */
+	permanent = db_get_pseudonym(data, pseudonym);
+	if (permanent == NULL ||
+	    eap_sim_db_htable_get(&data->pseudonym_by_permanent, permanent))
+		return NULL;
+	id = os_strdup(pseudonym);
+	if (id == NULL)
+		return permanent;
+	p = eap_sim_db_cache_pseudonym(data, permanent, id);
+	if (p == NULL)
+		return permanent;
+	eap_sim_db_evict(data);
+	return p->permanent;
+#else /* CONFIG_SQLITE */
 	return NULL;
+#endif /* CONFIG_SQLITE */
 }
 
 
@@ -1258,21 +2189,84 @@ struct eap_sim_reauth *
 eap_sim_db_get_reauth_entry(struct eap_sim_db_data *data,
 			    const char *reauth_id)
 {
-	struct eap_sim_reauth *r;
-
+	struct eap_sim_db_hnode *node;
+	struct eap_sim_db_reauth *r;
 #ifdef CONFIG_SQLITE
-	if (data->sqlite_db)
-		return db_get_reauth(data, reauth_id);
+	struct eap_sim_reauth *db, *reauth;
+	char *id;
 #endif /* CONFIG_SQLITE */
 
-	r = data->reauths;
-	while (r) {
-		if (os_strcmp(r->reauth_id, reauth_id) == 0)
-			break;
-		r = r->next;
+	node = eap_sim_db_htable_get(&data->reauth_by_id, reauth_id);
+	if (node) {
+		data->stats.id_cache_hits++;
+		r = eap_sim_db_entry(node, struct eap_sim_db_reauth,
+				     by_reauth_id);
+		eap_sim_db_used(&data->reauth_list, &r->list, &r->last_used);
+		r->refcount++;
+		return &r->r;
+	}
+	data->stats.id_cache_misses++;
+
+#ifdef CONFIG_SQLITE
+	if (data->sqlite_db == NULL)
+		return NULL;
+
+	/*
+	 * Changes that have not yet been written to the database are all in
+	 * the cache, so an entry read from the database is stale if the cache
+	 * has an entry for the same permanent identity or the entry is about
+	 * to be removed.
+	 */
+	db = db_get_reauth(data, reauth_id);
+	if (db == NULL)
+		return NULL;
+	if (eap_sim_db_htable_get(&data->reauth_by_permanent, db->permanent) ||
+	    db_reauth_removed(data, db->permanent)) {
+		os_memset(db, 0, sizeof(*db));
+		return NULL;
 	}
+	id = os_strdup(reauth_id);
+	if (id == NULL)
+		return NULL;
+	reauth = eap_sim_db_add_reauth_data(data, db->permanent, id,
+					    db->counter);
+	if (reauth == NULL)
+		return NULL;
+	os_memcpy(reauth->mk, db->mk, EAP_SIM_MK_LEN);
+	os_memcpy(reauth->k_encr, db->k_encr, EAP_SIM_K_ENCR_LEN);
+	os_memcpy(reauth->k_aut, db->k_aut, EAP_AKA_PRIME_K_AUT_LEN);
+	os_memcpy(reauth->k_re, db->k_re, EAP_AKA_PRIME_K_RE_LEN);
+	os_memset(db, 0, sizeof(*db));
+	eap_sim_db_entry(reauth, struct eap_sim_db_reauth, r)->refcount++;
+	eap_sim_db_evict(data);
+	return reauth;
+#else /* CONFIG_SQLITE */
+	return NULL;
+#endif /* CONFIG_SQLITE */
+}
+
 
-	return r;
+/**
+ * eap_sim_db_release_reauth - EAP-SIM DB: Release re-authentication entry
+ * @data: Private data pointer from eap_sim_db_init()
+ * @reauth: Pointer to re-authentication entry from
+ * eap_sim_db_get_reauth_entry() or %NULL
+ *
+ * This is called when an EAP session no longer uses an entry that it did not
+ * remove with eap_sim_db_remove_reauth().
+ */
+void eap_sim_db_release_reauth(struct eap_sim_db_data *data,
+			       struct eap_sim_reauth *reauth)
+{
+	struct eap_sim_db_reauth *r;
+
+	if (reauth == NULL)
+		return;
+	r = eap_sim_db_entry(reauth, struct eap_sim_db_reauth, r);
+	if (r->refcount)
+		r->refcount--;
+	if (r->removed && r->refcount == 0)
+		eap_sim_db_free_reauth(data, r);
 }
 
 
@@ -1281,30 +2275,50 @@ eap_sim_db_get_reauth_entry(struct eap_sim_db_data *data,
  * @data: Private data pointer from eap_sim_db_init()
  * @reauth: Pointer to re-authentication entry from
  * eap_sim_db_get_reauth_entry()
+ *
+ * This also releases the reference the caller got from
+ * eap_sim_db_get_reauth_entry().
  */
 void eap_sim_db_remove_reauth(struct eap_sim_db_data *data,
 			      struct eap_sim_reauth *reauth)
 {
-	struct eap_sim_reauth *r, *prev = NULL;
+	struct eap_sim_db_reauth *r;
 #ifdef CONFIG_SQLITE
-	if (data->sqlite_db) {
-		db_remove_reauth(data, reauth);
+	struct eap_sim_db_removed *removed;
+#endif /* CONFIG_SQLITE */
+
+	if (reauth == NULL)
+		return;
+	r = eap_sim_db_entry(reauth, struct eap_sim_db_reauth, r);
+	if (r->removed) {
+		eap_sim_db_release_reauth(data, reauth);
 		return;
 	}
-#endif /* CONFIG_SQLITE */
-	r = data->reauths;
-	while (r) {
-		if (r == reauth) {
-			if (prev)
-				prev->next = r->next;
-			else
-				data->reauths = r->next;
-			eap_sim_db_free_reauth(r);
-			return;
+#ifdef CONFIG_SQLITE
+	if (data->sqlite_db) {
+		removed = os_zalloc(sizeof(*removed));
+		if (removed)
+			removed->permanent = os_strdup(r->r.permanent);
+		if (removed == NULL || removed->permanent == NULL) {
+			/* Remove the database entry immediately instead */
+			os_free(removed);
+			db_remove_reauth(data, r->r.permanent);
+		} else {
+			dl_list_add_tail(&data->removed_reauths,
+					 &removed->list);
+			db_dirty(data);
 		}
-		prev = r;
-		r = r->next;
 	}
+#endif /* CONFIG_SQLITE */
+
+	/*
+	 * Another EAP session may have fetched the same entry, so keep the
+	 * memory around until that session has released it, too.
+	 */
+	eap_sim_db_unlink_reauth(data, r);
+	r->removed = 1;
+	dl_list_add_tail(&data->removed_reauth_list, &r->list);
+	eap_sim_db_release_reauth(data, reauth);
 }
 
 
@@ -1337,10 +2351,8 @@ int eap_sim_db_get_aka_auth(struct eap_sim_db_data *data, const char *username,
 			    u8 *res, size_t *res_len, void *cb_session_ctx)
 {
 	struct eap_sim_db_pending *entry;
-	int len;
-	char msg[40];
+	struct eap_sim_db_vector vec;
 	const char *imsi;
-	size_t imsi_len;
 
 	if (username == NULL ||
 	    (username[0] != EAP_AKA_PERMANENT_PREFIX &&
@@ -1354,16 +2366,15 @@ int eap_sim_db_get_aka_auth(struct eap_sim_db_data *data, const char *username,
 	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Get AKA auth for IMSI '%s'",
 		   imsi);
 
-	entry = eap_sim_db_get_pending(data, imsi, 1);
+	entry = eap_sim_db_get_pending(data, imsi, 1, cb_session_ctx);
 	if (entry) {
 		if (entry->state == FAILURE) {
-			os_free(entry);
+			eap_sim_db_del_pending(data, entry);
 			wpa_printf(MSG_DEBUG, "EAP-SIM DB: Failure");
 			return EAP_SIM_DB_FAILURE;
 		}
 
 		if (entry->state == PENDING) {
-			eap_sim_db_add_pending(data, entry);
 			wpa_printf(MSG_DEBUG, "EAP-SIM DB: Pending");
 			return EAP_SIM_DB_PENDING;
 		}
@@ -1376,37 +2387,28 @@ int eap_sim_db_get_aka_auth(struct eap_sim_db_data *data, const char *username,
 		os_memcpy(ck, entry->u.aka.ck, EAP_AKA_CK_LEN);
 		os_memcpy(res, entry->u.aka.res, EAP_AKA_RES_MAX_LEN);
 		*res_len = entry->u.aka.res_len;
-		os_free(entry);
+		eap_sim_db_del_pending(data, entry);
+		eap_sim_db_prefetch(data, imsi, 1);
 		return 0;
 	}
 
-	if (data->sock < 0) {
-		if (eap_sim_db_open_socket(data) < 0)
-			return EAP_SIM_DB_FAILURE;
+	if (eap_sim_db_pool_take(data, imsi, 1, 1, &vec) == 0) {
+		wpa_printf(MSG_DEBUG, "EAP-SIM DB: Using prefetched "
+			   "authentication data");
+		os_memcpy(_rand, vec.u.aka.rand, EAP_AKA_RAND_LEN);
+		os_memcpy(autn, vec.u.aka.autn, EAP_AKA_AUTN_LEN);
+		os_memcpy(ik, vec.u.aka.ik, EAP_AKA_IK_LEN);
+		os_memcpy(ck, vec.u.aka.ck, EAP_AKA_CK_LEN);
+		os_memcpy(res, vec.u.aka.res, EAP_AKA_RES_MAX_LEN);
+		*res_len = vec.u.aka.res_len;
+		os_memset(&vec, 0, sizeof(vec));
+		eap_sim_db_prefetch(data, imsi, 1);
+		return 0;
 	}
 
-	imsi_len = os_strlen(imsi);
-	len = os_snprintf(msg, sizeof(msg), "AKA-REQ-AUTH ");
-	if (len < 0 || len + imsi_len >= sizeof(msg))
-		return EAP_SIM_DB_FAILURE;
-	os_memcpy(msg + len, imsi, imsi_len);
-	len += imsi_len;
-
-	wpa_printf(MSG_DEBUG, "EAP-SIM DB: requesting AKA authentication "
-		    "data for IMSI '%s'", imsi);
-	if (eap_sim_db_send(data, msg, len) < 0)
-		return EAP_SIM_DB_FAILURE;
-
-	entry = os_zalloc(sizeof(*entry));
-	if (entry == NULL)
+	if (eap_sim_db_send_req(data, imsi, 1, 0, cb_session_ctx) < 0)
 		return EAP_SIM_DB_FAILURE;
-
-	entry->aka = 1;
-	os_strlcpy(entry->imsi, imsi, sizeof(entry->imsi));
-	entry->cb_session_ctx = cb_session_ctx;
-	entry->state = PENDING;
-	eap_sim_db_add_pending(data, entry);
-	eap_sim_db_expire_pending(data);
+	eap_sim_db_prefetch(data, imsi, 1);
 
 	return EAP_SIM_DB_PENDING;
 }
@@ -1445,6 +2447,25 @@ int eap_sim_db_resynchronize(struct eap_sim_db_data *data,
 	wpa_printf(MSG_DEBUG, "EAP-SIM DB: Get AKA auth for IMSI '%s'",
 		   imsi);
 
+	/*
+	 * Authentication vectors generated before the resynchronization use
+	 * the old sequence number, so drop the prefetched ones.
+	 */
+	if (data->prefetch) {
+		struct eap_sim_db_pending *entry;
+		struct eap_sim_db_pool *pool;
+
+		pool = eap_sim_db_get_pool(data, imsi, 1);
+		if (pool)
+			eap_sim_db_flush_pool(data, pool);
+		for (entry = data->pending[eap_sim_db_hash(imsi, 1)]; entry;
+		     entry = entry->next) {
+			if (entry->cb_session_ctx == NULL && entry->aka &&
+			    os_strcmp(entry->imsi, imsi) == 0)
+				entry->stale = 1;
+		}
+	}
+
 	if (data->sock >= 0) {
 		char msg[100];
 		int len, ret;
@@ -1478,6 +2499,83 @@ int eap_sim_db_resynchronize(struct eap_sim_db_data *data,
 }
 
 
+/**
+ * eap_sim_db_set_prefetch - Configure prefetching of authentication vectors
+ * @data: Private data pointer from eap_sim_db_init()
+ * @vectors: Number of unused GSM triplets or UMTS authentication vectors to
+ *	keep available for each recently seen IMSI or 0 to disable prefetching
+ * @imsis: Maximum number of IMSIs for which prefetched vectors are maintained
+ *
+ * When prefetching is enabled, an authentication for an IMSI for which enough
+ * prefetched vectors are available is completed without waiting for the
+ * external server and new requests are sent to refill the pool.
+ */
+void eap_sim_db_set_prefetch(struct eap_sim_db_data *data,
+			     unsigned int vectors, unsigned int imsis)
+{
+	struct eap_sim_db_pool *pool;
+
+	while ((pool = dl_list_first(&data->pool_list, struct eap_sim_db_pool,
+				     list)))
+		eap_sim_db_free_pool(data, pool);
+	data->prefetch = vectors;
+	data->prefetch_imsis = imsis;
+}
+
+
+/**
+ * eap_sim_db_get_stats - Get EAP-SIM DB statistics
+ * @data: Private data pointer from eap_sim_db_init()
+ * @stats: Buffer for returning the statistics
+ */
+void eap_sim_db_get_stats(struct eap_sim_db_data *data,
+			  struct eap_sim_db_stats *stats)
+{
+	os_memcpy(stats, &data->stats, sizeof(*stats));
+	stats->pending = data->num_pending;
+}
+
+
+/**
+ * eap_sim_db_get_mib - Get EAP-SIM DB statistics in text format
+ * @data: Private data pointer from eap_sim_db_init()
+ * @buf: Buffer for the text
+ * @buflen: Length of the buffer
+ * Returns: Number of bytes written to buf
+ */
+int eap_sim_db_get_mib(struct eap_sim_db_data *data, char *buf, size_t buflen)
+{
+	struct eap_sim_db_stats *s = &data->stats;
+	unsigned long avg;
+	int ret;
+
+	avg = s->responses ? s->latency_usec / s->responses : 0;
+	ret = os_snprintf(buf, buflen,
+			  "eapSimDbRequests=%lu\n"
+			  "eapSimDbPrefetchRequests=%lu\n"
+			  "eapSimDbResponses=%lu\n"
+			  "eapSimDbFailures=%lu\n"
+			  "eapSimDbPending=%u\n"
+			  "eapSimDbLatencyAvgUsec=%lu\n"
+			  "eapSimDbLatencyMaxUsec=%lu\n"
+			  "eapSimDbPoolHits=%lu\n"
+			  "eapSimDbPoolMisses=%lu\n"
+			  "eapSimDbPooledVectors=%u\n"
+			  "eapSimDbIdCacheHits=%lu\n"
+			  "eapSimDbIdCacheMisses=%lu\n"
+			  "eapSimDbIdsCached=%u\n"
+			  "eapSimDbWrites=%lu\n",
+			  s->requests, s->prefetch_requests, s->responses,
+			  s->failures, data->num_pending, avg,
+			  s->latency_max_usec, s->pool_hits, s->pool_misses,
+			  s->pooled, s->id_cache_hits, s->id_cache_misses,
+			  s->ids_cached, s->db_writes);
+	if (ret < 0 || (size_t) ret >= buflen)
+		return 0;
+	return ret;
+}
+
+
 /**
  * sim_get_username - Extract username from SIM identity
  * @identity: Identity
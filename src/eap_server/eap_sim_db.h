@@ -30,6 +30,48 @@ enum eap_sim_db_method {
 
 struct eap_sim_db_data;
 
+/**
+ * struct eap_sim_db_stats - EAP-SIM DB statistics
+ * @requests: Number of requests sent to the external server
+ * @prefetch_requests: Number of the requests that were sent to prefetch
+ *	authentication vectors
+ * @responses: Number of responses received from the external server
+ * @failures: Number of failure responses (or responses that could not be
+ *	parsed)
+ * @latency_usec: Total time (in microseconds) waited for the responses
+ * @latency_max_usec: Longest time (in microseconds) waited for a response
+ * @pool_hits: Number of authentications that used prefetched vectors
+ * @pool_misses: Number of authentications that had to wait for the external
+ *	server with prefetching enabled
+ * @pooled: Number of prefetched vectors currently available
+ * @pending: Number of requests currently waiting for a response or to be
+ *	fetched by the EAP session
+ * @id_cache_hits: Number of pseudonym and re-auth identity lookups that were
+ *	found in memory
+ * @id_cache_misses: Number of pseudonym and re-auth identity lookups that
+ *	were not found in memory (and were looked up from the database, if
+ *	configured)
+ * @ids_cached: Number of pseudonyms and re-auth identities in memory
+ * @db_writes: Number of pseudonym and re-auth identity changes written to the
+ *	database
+ */
+struct eap_sim_db_stats {
+	unsigned long requests;
+	unsigned long prefetch_requests;
+	unsigned long responses;
+	unsigned long failures;
+	unsigned long long latency_usec;
+	unsigned long latency_max_usec;
+	unsigned long pool_hits;
+	unsigned long pool_misses;
+	unsigned int pooled;
+	unsigned int pending;
+	unsigned long id_cache_hits;
+	unsigned long id_cache_misses;
+	unsigned int ids_cached;
+	unsigned long db_writes;
+};
+
 struct eap_sim_db_data *
 eap_sim_db_init(const char *config,
 		void (*get_complete_cb)(void *ctx, void *session_ctx),
@@ -37,6 +79,14 @@ eap_sim_db_init(const char *config,
 
 void eap_sim_db_deinit(void *priv);
 
+void eap_sim_db_set_prefetch(struct eap_sim_db_data *data,
+			     unsigned int vectors, unsigned int imsis);
+void eap_sim_db_authenticated(struct eap_sim_db_data *data,
+			      const char *permanent);
+void eap_sim_db_get_stats(struct eap_sim_db_data *data,
+			  struct eap_sim_db_stats *stats);
+int eap_sim_db_get_mib(struct eap_sim_db_data *data, char *buf, size_t buflen);
+
 int eap_sim_db_get_gsm_triplets(struct eap_sim_db_data *data,
 				const char *username, int max_chal,
 				u8 *_rand, u8 *kc, u8 *sres,
@@ -65,7 +115,6 @@ const char * eap_sim_db_get_permanent(struct eap_sim_db_data *data,
 				      const char *pseudonym);
 
 struct eap_sim_reauth {
-	struct eap_sim_reauth *next;
 	char *permanent; /* Permanent username */
 	char *reauth_id; /* Fast re-authentication username */
 	u16 counter;
@@ -81,6 +130,8 @@ eap_sim_db_get_reauth_entry(struct eap_sim_db_data *data,
 
 void eap_sim_db_remove_reauth(struct eap_sim_db_data *data,
 			      struct eap_sim_reauth *reauth);
+void eap_sim_db_release_reauth(struct eap_sim_db_data *data,
+			       struct eap_sim_reauth *reauth);
 
 int eap_sim_db_get_aka_auth(struct eap_sim_db_data *data, const char *username,
 			    u8 *_rand, u8 *autn, u8 *ik, u8 *ck,
@@ -48,6 +48,11 @@ struct eap_ssl_data {
 	 */
 	struct eap_sm *eap;
 
+	/**
+	 * job - Pending TLS handshake processing in a worker thread or %NULL
+	 */
+	struct eap_tls_job *job;
+
 	enum { MSG, FRAG_ACK, WAIT_FRAG_ACK } state;
 	struct wpabuf tmpbuf;
 };
@@ -87,5 +92,9 @@ int eap_server_tls_process(struct eap_sm *sm, struct eap_ssl_data *data,
 					       int peer_version),
 			   void (*proc_msg)(struct eap_sm *sm, void *priv,
 					    const struct wpabuf *respData));
+void eap_server_tls_valid_session(struct eap_sm *sm,
+				  struct eap_ssl_data *data, int eap_type);
+int eap_server_tls_resumed_session(struct eap_sm *sm,
+				   struct eap_ssl_data *data, int eap_type);
 
 #endif /* EAP_TLS_COMMON_H */
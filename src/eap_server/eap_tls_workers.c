@@ -0,0 +1,425 @@
+/*
+ * EAP server - TLS handshake processing in worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * The public key operations in the TLS server handshake (private key
+ * signature/decryption, DH, client certificate validation) can take long
+ * enough to stall all other processing in the single-threaded event loop when
+ * many peers authenticate at the same time. This module runs
+ * tls_connection_server_handshake() calls in a small pool of worker threads.
+ * The EAP method marks itself pending and the completion is reported back to
+ * the event loop through a pipe, after which the registered callback is used
+ * to continue the EAP state machine (the same way as with EAP-SIM/AKA database
+ * requests).
+ *
+ * Only the TLS connection of the job is accessed from the worker thread. The
+ * TLS library must advertise TLS_CAPABILITY_THREADS for this to be safe.
+ */
+
+#include "includes.h"
+#include <pthread.h>
+
+#include "common.h"
+#include "utils/list.h"
+#include "utils/eloop.h"
+#include "crypto/crypto.h"
+#include "crypto/tls.h"
+#include "eap_tls_workers.h"
+
+#ifdef WPA_TRACE
+#error CONFIG_TLS_WORKERS cannot be used with WPA_TRACE
+#endif /* WPA_TRACE */
+
+#define EAP_TLS_WORKERS_MAX 64
+
+
+enum eap_tls_job_state {
+	EAP_TLS_JOB_QUEUED,
+	EAP_TLS_JOB_RUNNING,
+	EAP_TLS_JOB_COMPLETED,
+	EAP_TLS_JOB_DONE
+};
+
+struct eap_tls_job {
+	struct dl_list list;
+	struct eap_tls_workers *workers;
+	enum eap_tls_job_state state;
+	int orphan; /* connection owned by the job after eap_tls_job_cancel() */
+	void *ssl_ctx;
+	struct tls_connection *conn;
+	struct wpabuf *in_data;
+	struct wpabuf *out_data;
+	struct wpabuf *log; /* buffered log messages separated with '\0' */
+	int notify_errno; /* pipe write() error, logged from the event loop */
+	void *session_ctx;
+};
+
+struct eap_tls_workers {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct dl_list queue; /* struct eap_tls_job::list */
+	struct dl_list completed; /* struct eap_tls_job::list */
+	int stop;
+	int pipe[2];
+	pthread_t *threads;
+	unsigned int num_threads;
+	void (*done_cb)(void *ctx, void *session_ctx);
+	void *ctx;
+};
+
+
+static void eap_tls_job_free(struct eap_tls_job *job)
+{
+	if (job->orphan)
+		tls_connection_deinit(job->ssl_ctx, job->conn);
+	wpabuf_free(job->in_data);
+	wpabuf_free(job->out_data);
+	wpabuf_free(job->log);
+	os_free(job);
+}
+
+
+#ifdef CONFIG_TLS_INTERNAL
+static void eap_tls_job_log_cb(void *ctx, const char *msg)
+{
+	struct eap_tls_job *job = ctx;
+	size_t len = os_strlen(msg) + 1;
+
+	if (wpabuf_resize(&job->log, len) == 0)
+		wpabuf_put_data(job->log, msg, len);
+}
+#endif /* CONFIG_TLS_INTERNAL */
+
+
+static void * eap_tls_worker_thread(void *arg)
+{
+	struct eap_tls_workers *workers = arg;
+	struct eap_tls_job *job;
+	struct wpabuf *out;
+	u8 notify = 0;
+
+	pthread_mutex_lock(&workers->lock);
+	for (;;) {
+		while (!workers->stop && dl_list_empty(&workers->queue))
+			pthread_cond_wait(&workers->cond, &workers->lock);
+		if (workers->stop)
+			break;
+		job = dl_list_first(&workers->queue, struct eap_tls_job, list);
+		dl_list_del(&job->list);
+		job->state = EAP_TLS_JOB_RUNNING;
+		pthread_mutex_unlock(&workers->lock);
+
+		out = tls_connection_server_handshake(job->ssl_ctx, job->conn,
+						      job->in_data, NULL);
+
+		pthread_mutex_lock(&workers->lock);
+		job->out_data = out;
+		job->state = EAP_TLS_JOB_COMPLETED;
+		dl_list_add_tail(&workers->completed, &job->list);
+		if (write(workers->pipe[1], &notify, 1) < 0)
+			job->notify_errno = errno;
+	}
+	pthread_mutex_unlock(&workers->lock);
+
+	crypto_thread_deinit();
+
+	return NULL;
+}
+
+
+static void eap_tls_workers_receive(int sock, void *eloop_ctx,
+				    void *sock_ctx)
+{
+	struct eap_tls_workers *workers = eloop_ctx;
+	struct eap_tls_job *job;
+	u8 buf[32];
+
+	if (read(sock, buf, sizeof(buf)) < 0) {
+		wpa_printf(MSG_INFO, "TLS workers: read: %s", strerror(errno));
+		return;
+	}
+
+	/*
+	 * Process one job at a time without holding the lock since the
+	 * callback may end up cancelling other completed jobs.
+	 */
+	for (;;) {
+		pthread_mutex_lock(&workers->lock);
+		job = dl_list_first(&workers->completed, struct eap_tls_job,
+				    list);
+		if (job)
+			dl_list_del(&job->list);
+		pthread_mutex_unlock(&workers->lock);
+		if (job == NULL)
+			break;
+
+		if (job->notify_errno)
+			wpa_printf(MSG_INFO, "TLS workers: write: %s",
+				   strerror(job->notify_errno));
+
+		if (job->orphan) {
+			wpa_printf(MSG_DEBUG, "TLS workers: Drop result for a "
+				   "cancelled session");
+			eap_tls_job_free(job);
+			continue;
+		}
+
+		job->state = EAP_TLS_JOB_DONE;
+		workers->done_cb(workers->ctx, job->session_ctx);
+	}
+}
+
+
+/**
+ * eap_tls_workers_init - Start TLS handshake worker threads
+ * @num_threads: Number of worker threads
+ * @done_cb: Callback function for reporting completed jobs in the event loop
+ * @ctx: Context data for done_cb
+ * Returns: Pointer to the worker pool or %NULL on failure
+ *
+ * done_cb is called with the session_ctx value from eap_tls_job_start() once
+ * the job has been completed. The caller is expected to continue the pending
+ * EAP session, e.g., with eapol_auth_eap_pending_cb().
+ */
+struct eap_tls_workers *
+eap_tls_workers_init(unsigned int num_threads,
+		     void (*done_cb)(void *ctx, void *session_ctx),
+		     void *ctx)
+{
+	struct eap_tls_workers *workers;
+	unsigned int i;
+
+	if (num_threads == 0 || num_threads > EAP_TLS_WORKERS_MAX)
+		return NULL;
+
+	workers = os_zalloc(sizeof(*workers));
+	if (workers == NULL)
+		return NULL;
+	workers->done_cb = done_cb;
+	workers->ctx = ctx;
+	dl_list_init(&workers->queue);
+	dl_list_init(&workers->completed);
+
+	workers->threads = os_calloc(num_threads, sizeof(pthread_t));
+	if (workers->threads == NULL) {
+		os_free(workers);
+		return NULL;
+	}
+
+	if (pipe(workers->pipe) < 0) {
+		wpa_printf(MSG_ERROR, "TLS workers: pipe: %s",
+			   strerror(errno));
+		os_free(workers->threads);
+		os_free(workers);
+		return NULL;
+	}
+
+	pthread_mutex_init(&workers->lock, NULL);
+	pthread_cond_init(&workers->cond, NULL);
+
+	if (eloop_register_read_sock(workers->pipe[0],
+				     eap_tls_workers_receive, workers,
+				     NULL) < 0) {
+		eap_tls_workers_deinit(workers);
+		return NULL;
+	}
+
+	for (i = 0; i < num_threads; i++) {
+		if (pthread_create(&workers->threads[i], NULL,
+				   eap_tls_worker_thread, workers) != 0) {
+			wpa_printf(MSG_ERROR, "TLS workers: Failed to create "
+				   "worker thread");
+			eap_tls_workers_deinit(workers);
+			return NULL;
+		}
+		workers->num_threads++;
+	}
+
+	wpa_printf(MSG_DEBUG, "TLS workers: Started %u worker thread(s)",
+		   num_threads);
+
+	return workers;
+}
+
+
+/**
+ * eap_tls_workers_deinit - Stop TLS handshake worker threads
+ * @workers: Pointer from eap_tls_workers_init()
+ *
+ * Jobs that are still referenced by EAP sessions are detached from the pool
+ * and reported as failed when the session collects them.
+ */
+void eap_tls_workers_deinit(struct eap_tls_workers *workers)
+{
+	struct eap_tls_job *job, *prev;
+	unsigned int i;
+
+	if (workers == NULL)
+		return;
+
+	pthread_mutex_lock(&workers->lock);
+	workers->stop = 1;
+	pthread_cond_broadcast(&workers->cond);
+	pthread_mutex_unlock(&workers->lock);
+
+	for (i = 0; i < workers->num_threads; i++)
+		pthread_join(workers->threads[i], NULL);
+	os_free(workers->threads);
+
+	dl_list_for_each_safe(job, prev, &workers->queue, struct eap_tls_job,
+			      list) {
+		dl_list_del(&job->list);
+		job->workers = NULL;
+		job->state = EAP_TLS_JOB_DONE;
+	}
+	dl_list_for_each_safe(job, prev, &workers->completed,
+			      struct eap_tls_job, list) {
+		dl_list_del(&job->list);
+		if (job->orphan) {
+			eap_tls_job_free(job);
+			continue;
+		}
+		job->workers = NULL;
+		job->state = EAP_TLS_JOB_DONE;
+	}
+
+	eloop_unregister_read_sock(workers->pipe[0]);
+	close(workers->pipe[0]);
+	close(workers->pipe[1]);
+	pthread_cond_destroy(&workers->cond);
+	pthread_mutex_destroy(&workers->lock);
+	os_free(workers);
+}
+
+
+/**
+ * eap_tls_job_start - Process a TLS handshake message in a worker thread
+ * @workers: Pointer from eap_tls_workers_init()
+ * @ssl_ctx: TLS context data from tls_init()
+ * @conn: Connection context data from tls_connection_init()
+ * @in_data: Received TLS handshake message (a copy is taken)
+ * @session_ctx: Context data to report to the done_cb
+ * Returns: Pointer to the job or %NULL on failure
+ *
+ * The connection must not be used by the caller before eap_tls_job_done()
+ * returns 1 for this job. Log messages from the TLS library are buffered and
+ * delivered when the result is collected with eap_tls_job_finish().
+ */
+struct eap_tls_job * eap_tls_job_start(struct eap_tls_workers *workers,
+				       void *ssl_ctx,
+				       struct tls_connection *conn,
+				       const struct wpabuf *in_data,
+				       void *session_ctx)
+{
+	struct eap_tls_job *job;
+
+	job = os_zalloc(sizeof(*job));
+	if (job == NULL)
+		return NULL;
+	job->in_data = wpabuf_dup(in_data);
+	if (in_data && job->in_data == NULL) {
+		os_free(job);
+		return NULL;
+	}
+	job->workers = workers;
+	job->ssl_ctx = ssl_ctx;
+	job->conn = conn;
+	job->session_ctx = session_ctx;
+#ifdef CONFIG_TLS_INTERNAL
+	tls_connection_set_log_cb(conn, eap_tls_job_log_cb, job);
+#endif /* CONFIG_TLS_INTERNAL */
+
+	pthread_mutex_lock(&workers->lock);
+	job->state = EAP_TLS_JOB_QUEUED;
+	dl_list_add_tail(&workers->queue, &job->list);
+	pthread_cond_signal(&workers->cond);
+	pthread_mutex_unlock(&workers->lock);
+
+	return job;
+}
+
+
+/**
+ * eap_tls_job_done - Check whether a job has been completed
+ * @job: Pointer from eap_tls_job_start()
+ * Returns: 1 if the result is available, 0 if the job is still in progress
+ */
+int eap_tls_job_done(struct eap_tls_job *job)
+{
+	return job->state == EAP_TLS_JOB_DONE;
+}
+
+
+/**
+ * eap_tls_job_finish - Collect the result of a completed job
+ * @job: Pointer from eap_tls_job_start(); this is freed
+ * @log_cb: Callback for the buffered TLS log messages or %NULL
+ * @log_ctx: Context data for log_cb
+ * Returns: Output from tls_connection_server_handshake() or %NULL on failure
+ *
+ * The caller is responsible for restoring its own TLS connection log callback
+ * (if any) after this call.
+ */
+struct wpabuf * eap_tls_job_finish(struct eap_tls_job *job,
+				   void (*log_cb)(void *ctx, const char *msg),
+				   void *log_ctx)
+{
+	struct wpabuf *out;
+	const char *pos, *end;
+
+	if (job->log && log_cb) {
+		pos = wpabuf_head(job->log);
+		end = pos + wpabuf_len(job->log);
+		while (pos < end) {
+			log_cb(log_ctx, pos);
+			pos += os_strlen(pos) + 1;
+		}
+	}
+
+	out = job->out_data;
+	job->out_data = NULL;
+	eap_tls_job_free(job);
+
+	return out;
+}
+
+
+/**
+ * eap_tls_job_cancel - Cancel a job
+ * @job: Pointer from eap_tls_job_start(); this is freed or orphaned
+ * Returns: 1 if a worker thread is still processing the connection, 0 if not
+ *
+ * If 1 is returned, the ownership of the TLS connection is transferred to the
+ * worker pool and the connection is freed once the worker thread is done with
+ * it, i.e., the caller must not call tls_connection_deinit() for it.
+ */
+int eap_tls_job_cancel(struct eap_tls_job *job)
+{
+	struct eap_tls_workers *workers = job->workers;
+	int in_use = 0;
+
+	if (workers) {
+		pthread_mutex_lock(&workers->lock);
+		switch (job->state) {
+		case EAP_TLS_JOB_QUEUED:
+		case EAP_TLS_JOB_COMPLETED:
+			dl_list_del(&job->list);
+			break;
+		case EAP_TLS_JOB_RUNNING:
+			job->orphan = 1;
+			in_use = 1;
+			break;
+		case EAP_TLS_JOB_DONE:
+			break;
+		}
+		pthread_mutex_unlock(&workers->lock);
+	}
+
+	if (!in_use)
+		eap_tls_job_free(job);
+
+	return in_use;
+}
@@ -0,0 +1,63 @@
+/*
+ * EAP server - TLS handshake processing in worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef EAP_TLS_WORKERS_H
+#define EAP_TLS_WORKERS_H
+
+struct eap_tls_workers;
+struct eap_tls_job;
+struct tls_connection;
+
+#ifdef CONFIG_TLS_WORKERS
+
+struct eap_tls_workers *
+eap_tls_workers_init(unsigned int num_threads,
+		     void (*done_cb)(void *ctx, void *session_ctx),
+		     void *ctx);
+void eap_tls_workers_deinit(struct eap_tls_workers *workers);
+struct eap_tls_job * eap_tls_job_start(struct eap_tls_workers *workers,
+				       void *ssl_ctx,
+				       struct tls_connection *conn,
+				       const struct wpabuf *in_data,
+				       void *session_ctx);
+int eap_tls_job_done(struct eap_tls_job *job);
+struct wpabuf * eap_tls_job_finish(struct eap_tls_job *job,
+				   void (*log_cb)(void *ctx, const char *msg),
+				   void *log_ctx);
+int eap_tls_job_cancel(struct eap_tls_job *job);
+
+#else /* CONFIG_TLS_WORKERS */
+
+static inline struct eap_tls_job *
+eap_tls_job_start(struct eap_tls_workers *workers, void *ssl_ctx,
+		  struct tls_connection *conn, const struct wpabuf *in_data,
+		  void *session_ctx)
+{
+	return NULL;
+}
+
+static inline int eap_tls_job_done(struct eap_tls_job *job)
+{
+	return 1;
+}
+
+static inline struct wpabuf *
+eap_tls_job_finish(struct eap_tls_job *job,
+		   void (*log_cb)(void *ctx, const char *msg), void *log_ctx)
+{
+	return NULL;
+}
+
+static inline int eap_tls_job_cancel(struct eap_tls_job *job)
+{
+	return 0;
+}
+
+#endif /* CONFIG_TLS_WORKERS */
+
+#endif /* EAP_TLS_WORKERS_H */
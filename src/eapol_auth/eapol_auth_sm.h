@@ -22,6 +22,7 @@ struct eapol_auth_config {
 	void *ssl_ctx;
 	void *msg_ctx;
 	void *eap_sim_db_priv;
+	void *tls_workers;
 	char *eap_req_id_text; /* a copy of this will be allocated */
 	size_t eap_req_id_text_len;
 	u8 *pac_opaque_encr_key;
@@ -23,12 +23,122 @@ struct radius_das_data {
 	struct hostapd_ip_addr client_addr;
 	unsigned int time_window;
 	int require_event_timestamp;
+	int bulk;
 	void *ctx;
 	enum radius_das_res (*disconnect)(void *ctx,
 					  struct radius_das_attrs *attr);
 };
 
 
+static int radius_das_parse_port_range(const u8 *buf, size_t len,
+				       struct radius_das_attrs *attrs)
+{
+	char tmp[30], *pos, *end;
+	unsigned long first, last;
+
+	if (len == 0 || len >= sizeof(tmp))
+		return -1;
+	os_memcpy(tmp, buf, len);
+	tmp[len] = '\0';
+
+	first = strtoul(tmp, &end, 10);
+	if (end == tmp)
+		return -1;
+	last = first;
+	if (*end == '-') {
+		pos = end + 1;
+		last = strtoul(pos, &end, 10);
+		if (end == pos)
+			return -1;
+	}
+	if (*end != '\0' || last < first)
+		return -1;
+
+	attrs->nas_port_range = 1;
+	attrs->nas_port_first = first;
+	attrs->nas_port_last = last;
+	return 0;
+}
+
+
+/* BSSID in the IEEE 802 format used in Called-Station-Id (RFC 3580) */
+static int radius_das_parse_bssid(const u8 *buf, size_t len, u8 *bssid)
+{
+	const char *pos = (const char *) buf;
+	int i, val;
+
+	if (len < 17)
+		return -1;
+	for (i = 0; i < ETH_ALEN; i++) {
+		val = hex2byte(pos);
+		if (val < 0 || (i < ETH_ALEN - 1 && pos[2] != '-'))
+			return -1;
+		bssid[i] = val;
+		pos += 3;
+	}
+
+	return 0;
+}
+
+
+static int radius_das_parse_bulk_attrs(struct radius_msg *msg,
+				       struct radius_das_attrs *attrs,
+				       u8 *bssid)
+{
+	u8 *buf, *pos;
+	size_t len;
+	u32 val;
+	int res;
+
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_CALLED_STATION_ID,
+				    &buf, &len, NULL) == 0) {
+		/*
+		 * <BSSID>[:<SSID>] as in RFC 3580 or :<SSID> to select all
+		 * BSSes with the SSID. The position decides which part is the
+		 * BSSID, so an SSID is never taken for a BSSID.
+		 */
+		if (len > 0 && buf[0] == ':') {
+			pos = buf + 1;
+		} else if (radius_das_parse_bssid(buf, len, bssid) == 0 &&
+			   (len == 17 || buf[17] == ':')) {
+			attrs->bssid = bssid;
+			pos = buf + (len == 17 ? 17 : 18);
+		} else {
+			return -1;
+		}
+		if (pos[-1] == ':') {
+			if (pos == buf + len)
+				return -1; /* empty SSID */
+			attrs->ssid = pos;
+			attrs->ssid_len = buf + len - pos;
+		}
+	}
+
+	res = radius_msg_get_attr(msg, RADIUS_ATTR_NAS_PORT, (u8 *) &val, 4);
+	if (res == 4) {
+		attrs->nas_port_range = 1;
+		attrs->nas_port_first = attrs->nas_port_last = ntohl(val);
+	} else if (res >= 0) {
+		return -1;
+	}
+
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_NAS_PORT_ID,
+				    &buf, &len, NULL) == 0) {
+		/* Single port or an inclusive range: <first>[-<last>] */
+		if (radius_das_parse_port_range(buf, len, attrs) < 0)
+			return -1;
+	}
+
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_CLASS,
+				    &buf, &len, NULL) == 0) {
+		attrs->class_prefix = buf;
+		attrs->class_prefix_len = len;
+	}
+
+	return 0;
+}
+
+
 static struct radius_msg * radius_das_disconnect(struct radius_das_data *das,
 						 struct radius_msg *msg,
 						 const char *abuf,
@@ -47,6 +157,24 @@ static struct radius_msg * radius_das_disconnect(struct radius_das_data *das,
 		RADIUS_ATTR_CHARGEABLE_USER_IDENTITY,
 #ifdef CONFIG_IPV6
 		RADIUS_ATTR_NAS_IPV6_ADDRESS,
+#endif /* CONFIG_IPV6 */
+		0
+	};
+	u8 allowed_bulk[] = {
+		RADIUS_ATTR_USER_NAME,
+		RADIUS_ATTR_NAS_IP_ADDRESS,
+		RADIUS_ATTR_NAS_PORT,
+		RADIUS_ATTR_CLASS,
+		RADIUS_ATTR_CALLED_STATION_ID,
+		RADIUS_ATTR_CALLING_STATION_ID,
+		RADIUS_ATTR_NAS_IDENTIFIER,
+		RADIUS_ATTR_ACCT_SESSION_ID,
+		RADIUS_ATTR_EVENT_TIMESTAMP,
+		RADIUS_ATTR_MESSAGE_AUTHENTICATOR,
+		RADIUS_ATTR_NAS_PORT_ID,
+		RADIUS_ATTR_CHARGEABLE_USER_IDENTITY,
+#ifdef CONFIG_IPV6
+		RADIUS_ATTR_NAS_IPV6_ADDRESS,
 #endif /* CONFIG_IPV6 */
 		0
 	};
@@ -58,10 +186,12 @@ static struct radius_msg * radius_das_disconnect(struct radius_das_data *das,
 	size_t len;
 	char tmp[100];
 	u8 sta_addr[ETH_ALEN];
+	u8 bssid[ETH_ALEN];
 
 	hdr = radius_msg_get_hdr(msg);
 
-	attr = radius_msg_find_unlisted_attr(msg, allowed);
+	attr = radius_msg_find_unlisted_attr(msg, das->bulk ? allowed_bulk :
+					     allowed);
 	if (attr) {
 		wpa_printf(MSG_INFO, "DAS: Unsupported attribute %u in "
 			   "Disconnect-Request from %s:%d", attr,
@@ -135,6 +265,14 @@ static struct radius_msg * radius_das_disconnect(struct radius_das_data *das,
 		attrs.cui_len = len;
 	}
 
+	if (das->bulk &&
+	    radius_das_parse_bulk_attrs(msg, &attrs, bssid) < 0) {
+		wpa_printf(MSG_INFO, "DAS: Invalid session selection attribute "
+			   "from %s:%d", abuf, from_port);
+		error = 407;
+		goto fail;
+	}
+
 	res = das->disconnect(das->ctx, &attrs);
 	switch (res) {
 	case RADIUS_DAS_NAS_MISMATCH:
@@ -349,6 +487,7 @@ radius_das_init(struct radius_das_conf *conf)
 
 	das->time_window = conf->time_window;
 	das->require_event_timestamp = conf->require_event_timestamp;
+	das->bulk = conf->bulk;
 	das->ctx = conf->ctx;
 	das->disconnect = conf->disconnect;
 
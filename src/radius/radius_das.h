@@ -32,6 +32,19 @@ struct radius_das_attrs {
 	size_t acct_session_id_len;
 	const u8 *cui;
 	size_t cui_len;
+
+	/*
+	 * Bulk session selection attributes; only used when bulk requests are
+	 * enabled. All included attributes need to match a session.
+	 */
+	const u8 *bssid; /* from Called-Station-Id */
+	const u8 *ssid; /* from Called-Station-Id */
+	size_t ssid_len;
+	int nas_port_range; /* NAS-Port or NAS-Port-Id included */
+	unsigned int nas_port_first;
+	unsigned int nas_port_last;
+	const u8 *class_prefix;
+	size_t class_prefix_len;
 };
 
 struct radius_das_conf {
@@ -41,6 +54,7 @@ struct radius_das_conf {
 	const struct hostapd_ip_addr *client_addr;
 	unsigned int time_window;
 	int require_event_timestamp;
+	int bulk; /* allow requests matching multiple sessions */
 	void *ctx;
 	enum radius_das_res (*disconnect)(void *ctx,
 					  struct radius_das_attrs *attr);
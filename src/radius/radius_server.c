@@ -151,6 +151,15 @@ struct radius_server_data {
 	 */
 	void *eap_sim_db_priv;
 
+	/**
+	 * tls_workers - TLS handshake worker threads
+	 *
+	 * This is passed to the EAP server implementation for processing TLS
+	 * handshake messages outside the event loop thread or %NULL to process
+	 * them synchronously.
+	 */
+	void *tls_workers;
+
 	/**
 	 * ssl_ctx - TLS context
 	 *
@@ -636,6 +645,7 @@ radius_server_get_new_session(struct radius_server_data *data,
 	eap_conf.ssl_ctx = data->ssl_ctx;
 	eap_conf.msg_ctx = data->msg_ctx;
 	eap_conf.eap_sim_db_priv = data->eap_sim_db_priv;
+	eap_conf.tls_workers = data->tls_workers;
 	eap_conf.backend_auth = TRUE;
 	eap_conf.eap_server = 1;
 	eap_conf.pac_opaque_encr_key = data->pac_opaque_encr_key;
@@ -1580,6 +1590,7 @@ radius_server_init(struct radius_server_conf *conf)
 	os_get_reltime(&data->start_time);
 	data->conf_ctx = conf->conf_ctx;
 	data->eap_sim_db_priv = conf->eap_sim_db_priv;
+	data->tls_workers = conf->tls_workers;
 	data->ssl_ctx = conf->ssl_ctx;
 	data->msg_ctx = conf->msg_ctx;
 	data->ipv6 = conf->ipv6;
@@ -59,6 +59,15 @@ struct radius_server_conf {
 	 */
 	void *eap_sim_db_priv;
 
+	/**
+	 * tls_workers - TLS handshake worker threads
+	 *
+	 * This is passed to the EAP server implementation for processing TLS
+	 * handshake messages outside the event loop thread or %NULL to process
+	 * them synchronously.
+	 */
+	void *tls_workers;
+
 	/**
 	 * ssl_ctx - TLS context
 	 *
@@ -15,6 +15,7 @@
 #include "tlsv1_record.h"
 #include "tlsv1_server.h"
 #include "tlsv1_server_i.h"
+#include "tlsv1_server_session.h"
 
 /* TODO:
  * Support for a message fragmented across several records (RFC 2246, 6.2.1)
@@ -430,6 +431,13 @@ static void tlsv1_server_clear_data(struct tlsv1_server *conn)
 	os_free(conn->dh_secret);
 	conn->dh_secret = NULL;
 	conn->dh_secret_len = 0;
+
+	conn->client_session_id_len = 0;
+	conn->session_ticket_ext = 0;
+	conn->resumed = 0;
+	conn->send_new_ticket = 0;
+	wpabuf_free(conn->success_data);
+	conn->success_data = NULL;
 }
 
 
@@ -563,7 +571,7 @@ int tlsv1_server_shutdown(struct tlsv1_server *conn)
  */
 int tlsv1_server_resumed(struct tlsv1_server *conn)
 {
-	return 0;
+	return conn->resumed;
 }
 
 
@@ -660,6 +668,78 @@ void tlsv1_server_set_session_ticket_cb(struct tlsv1_server *conn,
 }
 
 
+/**
+ * tlsv1_server_set_sessions - Configure session cache for resumption
+ * @conn: TLSv1 server connection data from tlsv1_server_init()
+ * @sessions: Session cache from tlsv1_server_sessions_init() or %NULL
+ */
+void tlsv1_server_set_sessions(struct tlsv1_server *conn,
+			       struct tlsv1_server_sessions *sessions)
+{
+	conn->sessions = sessions;
+}
+
+
+/**
+ * tlsv1_server_session_store - Add the established session into cache
+ * @conn: TLSv1 server connection data from tlsv1_server_init()
+ *
+ * Only sessions for which success data has been set are stored, so that a
+ * session that did not complete authentication cannot be resumed.
+ */
+void tlsv1_server_session_store(struct tlsv1_server *conn)
+{
+	struct tlsv1_server_session sess;
+
+	if (conn->sessions == NULL || conn->resumed ||
+	    conn->success_data == NULL || conn->state != ESTABLISHED ||
+	    conn->session_ticket_cb)
+		return;
+
+	os_memset(&sess, 0, sizeof(sess));
+	sess.tls_version = conn->rl.tls_version;
+	sess.cipher_suite = conn->cipher_suite;
+	os_memcpy(sess.master_secret, conn->master_secret,
+		  TLS_MASTER_SECRET_LEN);
+	sess.success_data = conn->success_data;
+	tlsv1_server_session_add(conn->sessions, conn->session_id,
+				 conn->session_id_len, &sess);
+	os_memset(&sess, 0, sizeof(sess));
+}
+
+
+/**
+ * tlsv1_server_set_success_data - Mark the session resumable
+ * @conn: TLSv1 server connection data from tlsv1_server_init()
+ * @data: Data to be stored with the session (ownership is transferred)
+ * Returns: 0 on success, -1 on failure
+ */
+int tlsv1_server_set_success_data(struct tlsv1_server *conn,
+				  struct wpabuf *data)
+{
+	if (conn->sessions == NULL) {
+		wpabuf_free(data);
+		return -1;
+	}
+	wpabuf_free(conn->success_data);
+	conn->success_data = data;
+	tlsv1_server_session_store(conn);
+	return 0;
+}
+
+
+/**
+ * tlsv1_server_get_success_data - Get success data of the session
+ * @conn: TLSv1 server connection data from tlsv1_server_init()
+ * Returns: Success data or %NULL if not available
+ */
+const struct wpabuf *
+tlsv1_server_get_success_data(struct tlsv1_server *conn)
+{
+	return conn->success_data;
+}
+
+
 void tlsv1_server_set_log_cb(struct tlsv1_server *conn,
 			     void (*cb)(void *ctx, const char *msg), void *ctx)
 {
@@ -45,6 +45,15 @@ void tlsv1_server_set_session_ticket_cb(struct tlsv1_server *conn,
 					tlsv1_server_session_ticket_cb cb,
 					void *ctx);
 
+struct tlsv1_server_sessions;
+
+void tlsv1_server_set_sessions(struct tlsv1_server *conn,
+			       struct tlsv1_server_sessions *sessions);
+int tlsv1_server_set_success_data(struct tlsv1_server *conn,
+				  struct wpabuf *data);
+const struct wpabuf *
+tlsv1_server_get_success_data(struct tlsv1_server *conn);
+
 void tlsv1_server_set_log_cb(struct tlsv1_server *conn,
 			     void (*cb)(void *ctx, const char *msg), void *ctx);
 
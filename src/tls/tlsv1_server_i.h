@@ -56,6 +56,14 @@ struct tlsv1_server {
 
 	int use_session_ticket;
 
+	struct tlsv1_server_sessions *sessions;
+	u8 client_session_id[TLS_SESSION_ID_MAX_LEN];
+	size_t client_session_id_len;
+	int session_ticket_ext; /* client included SessionTicket extension */
+	int resumed; /* abbreviated handshake based on session cache/ticket */
+	int send_new_ticket;
+	struct wpabuf *success_data;
+
 	u8 *dh_secret;
 	size_t dh_secret_len;
 
@@ -78,5 +86,6 @@ u8 * tlsv1_server_send_alert(struct tlsv1_server *conn, u8 level,
 			     u8 description, size_t *out_len);
 int tlsv1_server_process_handshake(struct tlsv1_server *conn, u8 ct,
 				   const u8 *buf, size_t *len);
+void tlsv1_server_session_store(struct tlsv1_server *conn);
 
 #endif /* TLSV1_SERVER_I_H */
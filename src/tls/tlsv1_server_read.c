@@ -18,6 +18,7 @@
 #include "tlsv1_record.h"
 #include "tlsv1_server.h"
 #include "tlsv1_server_i.h"
+#include "tlsv1_server_session.h"
 
 
 static int tls_process_client_key_exchange(struct tlsv1_server *conn, u8 ct,
@@ -44,10 +45,79 @@ static int testing_cipher_suite_filter(struct tlsv1_server *conn, u16 suite)
 }
 
 
+static void tls_server_session_resume(struct tlsv1_server *conn,
+				      const u8 *suites, size_t num_suites)
+{
+	struct tlsv1_server_session sess;
+	int from_ticket = 0, renew = 0;
+	size_t i;
+
+	os_memset(&sess, 0, sizeof(sess));
+
+	if (conn->sessions == NULL || conn->session_ticket_cb)
+		return; /* EAP-FAST uses SessionTicket for PAC-Opaque */
+
+	if (conn->session_ticket_ext && conn->session_ticket_len &&
+	    tlsv1_server_sessions_tickets(conn->sessions)) {
+		if (tlsv1_server_session_ticket_open(
+			    conn->sessions, conn->session_ticket,
+			    conn->session_ticket_len, &sess, &renew) == 0)
+			from_ticket = 1;
+		else
+			tlsv1_server_log(conn, "Could not use SessionTicket");
+	}
+
+	if (!from_ticket &&
+	    tlsv1_server_session_get(conn->sessions, conn->client_session_id,
+				     conn->client_session_id_len, &sess) < 0)
+		goto full;
+
+	if (sess.tls_version != conn->rl.tls_version) {
+		tlsv1_server_log(conn, "Cached session used a different protocol version - full handshake");
+		goto full;
+	}
+
+	for (i = 0; i < num_suites; i++) {
+		if (WPA_GET_BE16(suites + 2 * i) == sess.cipher_suite)
+			break;
+	}
+	if (i == num_suites ||
+	    tlsv1_record_set_cipher_suite(&conn->rl, sess.cipher_suite) < 0) {
+		tlsv1_server_log(conn, "Cipher suite of cached session not offered - full handshake");
+		if (tlsv1_record_set_cipher_suite(&conn->rl,
+						  conn->cipher_suite) < 0)
+			wpa_printf(MSG_DEBUG, "TLSv1: Failed to restore "
+				   "CipherSuite for record layer");
+		goto full;
+	}
+
+	tlsv1_server_log(conn, "Resuming session based on %s",
+			 from_ticket ? "SessionTicket" : "session cache");
+	conn->resumed = 1;
+	conn->cipher_suite = sess.cipher_suite;
+	os_memcpy(conn->master_secret, sess.master_secret,
+		  TLS_MASTER_SECRET_LEN);
+	wpabuf_free(conn->success_data);
+	conn->success_data = sess.success_data;
+	sess.success_data = NULL;
+	/* Replace tickets protected with a retired key */
+	conn->send_new_ticket = from_ticket && renew &&
+		conn->success_data != NULL;
+	tlsv1_server_session_clear(&sess);
+	return;
+
+full:
+	tlsv1_server_session_clear(&sess);
+	conn->send_new_ticket = conn->session_ticket_ext &&
+		tlsv1_server_sessions_tickets(conn->sessions) &&
+		conn->success_data != NULL;
+}
+
+
 static int tls_process_client_hello(struct tlsv1_server *conn, u8 ct,
 				    const u8 *in_data, size_t *in_len)
 {
-	const u8 *pos, *end, *c;
+	const u8 *pos, *end, *c, *suites;
 	size_t left, len, i, j;
 	u16 cipher_suite;
 	u16 num_suites;
@@ -136,8 +206,9 @@ static int tls_process_client_hello(struct tlsv1_server *conn, u8 ct,
 	if (end - pos < 1 + *pos || *pos > TLS_SESSION_ID_MAX_LEN)
 		goto decode_error;
 	wpa_hexdump(MSG_MSGDUMP, "TLSv1: client session_id", pos + 1, *pos);
+	conn->client_session_id_len = *pos;
+	os_memcpy(conn->client_session_id, pos + 1, *pos);
 	pos += 1 + *pos;
-	/* TODO: add support for session resumption */
 
 	/* CipherSuite cipher_suites<2..2^16-1> */
 	if (end - pos < 2)
@@ -151,6 +222,7 @@ static int tls_process_client_hello(struct tlsv1_server *conn, u8 ct,
 	if (num_suites & 1)
 		goto decode_error;
 	num_suites /= 2;
+	suites = pos;
 
 	cipher_suite = 0;
 	for (i = 0; !cipher_suite && i < conn->num_cipher_suites; i++) {
@@ -258,6 +330,7 @@ static int tls_process_client_hello(struct tlsv1_server *conn, u8 ct,
 				    "Extension data", pos, ext_len);
 
 			if (ext_type == TLS_EXT_SESSION_TICKET) {
+				conn->session_ticket_ext = 1;
 				os_free(conn->session_ticket);
 				conn->session_ticket = os_malloc(ext_len);
 				if (conn->session_ticket) {
@@ -273,6 +346,8 @@ static int tls_process_client_hello(struct tlsv1_server *conn, u8 ct,
 
 	*in_len = end - in_data;
 
+	tls_server_session_resume(conn, suites, num_suites);
+
 	tlsv1_server_log(conn, "ClientHello OK - proceed to ServerHello");
 	conn->state = SERVER_HELLO;
 
@@ -1109,7 +1184,7 @@ static int tls_process_client_finished(struct tlsv1_server *conn, u8 ct,
 
 	*in_len = end - in_data;
 
-	if (conn->use_session_ticket) {
+	if (conn->use_session_ticket || conn->resumed) {
 		/* Abbreviated handshake using session ticket; RFC 4507 */
 		tlsv1_server_log(conn, "Abbreviated handshake completed successfully");
 		conn->state = ESTABLISHED;
@@ -0,0 +1,938 @@
+/*
+ * TLSv1 server - session cache and session tickets (RFC 5077)
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+#ifndef CONFIG_NATIVE_WINDOWS
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif /* CONFIG_NATIVE_WINDOWS */
+#ifdef CONFIG_TLS_WORKERS
+#include <pthread.h>
+#endif /* CONFIG_TLS_WORKERS */
+
+#include "common.h"
+#include "utils/list.h"
+#include "crypto/aes_wrap.h"
+#include "crypto/sha256.h"
+#include "crypto/random.h"
+#include "crypto/tls.h"
+#include "tlsv1_server_session.h"
+
+
+#define TLSV1_SESSION_HASH_SIZE 256
+/* Session IDs are generated randomly, so the first octet is well distributed
+ */
+#define TLSV1_SESSION_HASH(id) ((id)[0])
+
+#define TLSV1_TICKET_KEY_NAME_LEN 16
+#define TLSV1_TICKET_AES_KEY_LEN 16
+#define TLSV1_TICKET_HMAC_KEY_LEN 32
+#define TLSV1_TICKET_IV_LEN 16
+
+/* version(2) | cipher_suite(2) | master_secret | issued(4) | data_len(2) */
+#define TLSV1_TICKET_STATE_HDR_LEN (2 + 2 + TLS_MASTER_SECRET_LEN + 4 + 2)
+
+/* Minimum interval (in seconds) between writes of the session cache file */
+#define TLSV1_SESSION_SAVE_INTERVAL 60
+
+struct tlsv1_server_session_entry {
+	struct dl_list list; /* newest first, i.e., in order of expiration */
+	struct tlsv1_server_session_entry *hnext;
+	u8 session_id[TLS_SESSION_ID_MAX_LEN];
+	size_t session_id_len;
+	os_time_t expires;
+	struct tlsv1_server_session sess;
+};
+
+struct tlsv1_ticket_key {
+	u8 name[TLSV1_TICKET_KEY_NAME_LEN];
+	u8 aes_key[TLSV1_TICKET_AES_KEY_LEN];
+	u8 hmac_key[TLSV1_TICKET_HMAC_KEY_LEN];
+	os_time_t created;
+	int valid;
+};
+
+struct tlsv1_server_sessions {
+	unsigned int lifetime;
+	size_t max_entries;
+	int tickets;
+	unsigned int ticket_key_lifetime;
+	char *file;
+	int dirty; /* changes not yet written to file */
+	os_time_t last_save;
+
+	struct dl_list entries;
+	size_t num_entries;
+	struct tlsv1_server_session_entry *hash[TLSV1_SESSION_HASH_SIZE];
+
+	/* keys[0] is used for new tickets; keys[1] is the previous key that is
+	 * still accepted for tickets issued before the last rotation */
+	struct tlsv1_ticket_key keys[2];
+
+	struct tls_session_stats stats;
+
+#ifdef CONFIG_TLS_WORKERS
+	/* Handshakes may be processed in EAP server TLS worker threads */
+	pthread_mutex_t lock;
+#endif /* CONFIG_TLS_WORKERS */
+};
+
+
+static void tlsv1_server_sessions_save(struct tlsv1_server_sessions *sessions,
+				       os_time_t now);
+
+
+static void tlsv1_server_sessions_lock(struct tlsv1_server_sessions *sessions)
+{
+#ifdef CONFIG_TLS_WORKERS
+	pthread_mutex_lock(&sessions->lock);
+#endif /* CONFIG_TLS_WORKERS */
+}
+
+
+static void tlsv1_server_sessions_unlock(
+	struct tlsv1_server_sessions *sessions)
+{
+#ifdef CONFIG_TLS_WORKERS
+	pthread_mutex_unlock(&sessions->lock);
+#endif /* CONFIG_TLS_WORKERS */
+}
+
+
+void tlsv1_server_session_clear(struct tlsv1_server_session *sess)
+{
+	wpabuf_free(sess->success_data);
+	os_memset(sess, 0, sizeof(*sess));
+}
+
+
+static int tlsv1_server_session_copy(struct tlsv1_server_session *dst,
+				     const struct tlsv1_server_session *src)
+{
+	os_memcpy(dst, src, sizeof(*dst));
+	dst->success_data = NULL;
+	if (src->success_data) {
+		dst->success_data = wpabuf_dup(src->success_data);
+		if (dst->success_data == NULL)
+			return -1;
+	}
+	return 0;
+}
+
+
+static void tlsv1_server_session_free(struct tlsv1_server_sessions *sessions,
+				      struct tlsv1_server_session_entry *entry)
+{
+	struct tlsv1_server_session_entry **pos;
+
+	pos = &sessions->hash[TLSV1_SESSION_HASH(entry->session_id)];
+	while (*pos && *pos != entry)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = entry->hnext;
+
+	dl_list_del(&entry->list);
+	sessions->num_entries--;
+	tlsv1_server_session_clear(&entry->sess);
+	os_memset(entry, 0, sizeof(*entry));
+	os_free(entry);
+}
+
+
+static struct tlsv1_server_session_entry *
+tlsv1_server_session_find(struct tlsv1_server_sessions *sessions,
+			  const u8 *session_id, size_t session_id_len)
+{
+	struct tlsv1_server_session_entry *entry;
+
+	if (session_id_len == 0)
+		return NULL;
+
+	entry = sessions->hash[TLSV1_SESSION_HASH(session_id)];
+	while (entry) {
+		if (entry->session_id_len == session_id_len &&
+		    os_memcmp(entry->session_id, session_id,
+			      session_id_len) == 0)
+			return entry;
+		entry = entry->hnext;
+	}
+
+	return NULL;
+}
+
+
+static void tlsv1_server_session_expire(struct tlsv1_server_sessions *sessions,
+					os_time_t now)
+{
+	struct tlsv1_server_session_entry *entry;
+
+	while (!dl_list_empty(&sessions->entries)) {
+		entry = dl_list_last(&sessions->entries,
+				     struct tlsv1_server_session_entry, list);
+		if (entry->expires > now)
+			break;
+		tlsv1_server_session_free(sessions, entry);
+		sessions->stats.timeouts++;
+	}
+}
+
+
+static int tlsv1_server_session_insert(struct tlsv1_server_sessions *sessions,
+				       const u8 *session_id,
+				       size_t session_id_len, os_time_t expires,
+				       const struct tlsv1_server_session *sess)
+{
+	struct tlsv1_server_session_entry *entry;
+	int idx;
+
+	if (session_id_len == 0 || session_id_len > TLS_SESSION_ID_MAX_LEN)
+		return -1;
+
+	entry = tlsv1_server_session_find(sessions, session_id,
+					  session_id_len);
+	if (entry)
+		tlsv1_server_session_free(sessions, entry);
+
+	while (sessions->num_entries >= sessions->max_entries &&
+	       !dl_list_empty(&sessions->entries)) {
+		entry = dl_list_last(&sessions->entries,
+				     struct tlsv1_server_session_entry, list);
+		tlsv1_server_session_free(sessions, entry);
+		sessions->stats.evictions++;
+	}
+
+	entry = os_zalloc(sizeof(*entry));
+	if (entry == NULL)
+		return -1;
+	if (tlsv1_server_session_copy(&entry->sess, sess) < 0) {
+		os_free(entry);
+		return -1;
+	}
+	os_memcpy(entry->session_id, session_id, session_id_len);
+	entry->session_id_len = session_id_len;
+	entry->expires = expires;
+
+	idx = TLSV1_SESSION_HASH(entry->session_id);
+	entry->hnext = sessions->hash[idx];
+	sessions->hash[idx] = entry;
+	dl_list_add(&sessions->entries, &entry->list);
+	sessions->num_entries++;
+
+	return 0;
+}
+
+
+/**
+ * tlsv1_server_session_add - Add a session into the session cache
+ * @sessions: Session cache from tlsv1_server_sessions_init()
+ * @session_id: Session ID that was sent in ServerHello
+ * @session_id_len: Length of session_id
+ * @sess: Session state (copied)
+ * Returns: 0 on success, -1 on failure
+ */
+int tlsv1_server_session_add(struct tlsv1_server_sessions *sessions,
+			     const u8 *session_id, size_t session_id_len,
+			     const struct tlsv1_server_session *sess)
+{
+	struct os_time now;
+	int ret;
+
+	if (sessions == NULL || sessions->max_entries == 0)
+		return -1;
+
+	wpa_hexdump(MSG_DEBUG, "TLSv1: Add session to cache",
+		    session_id, session_id_len);
+
+	os_get_time(&now);
+	tlsv1_server_sessions_lock(sessions);
+	tlsv1_server_session_expire(sessions, now.sec);
+	ret = tlsv1_server_session_insert(sessions, session_id,
+					  session_id_len,
+					  now.sec + sessions->lifetime, sess);
+	if (ret == 0)
+		sessions->dirty = 1;
+	/* Write the cache periodically so that a crash or another hostapd
+	 * process using the file does not lose all sessions */
+	if (sessions->file && sessions->dirty &&
+	    now.sec - sessions->last_save >= TLSV1_SESSION_SAVE_INTERVAL)
+		tlsv1_server_sessions_save(sessions, now.sec);
+	tlsv1_server_sessions_unlock(sessions);
+
+	return ret;
+}
+
+
+/**
+ * tlsv1_server_session_get - Find a session from the session cache
+ * @sessions: Session cache from tlsv1_server_sessions_init()
+ * @session_id: Session ID from ClientHello
+ * @session_id_len: Length of session_id
+ * @sess: Buffer for the session state; to be freed with
+ *	tlsv1_server_session_clear()
+ * Returns: 0 if the session was found, -1 if not
+ */
+int tlsv1_server_session_get(struct tlsv1_server_sessions *sessions,
+			     const u8 *session_id, size_t session_id_len,
+			     struct tlsv1_server_session *sess)
+{
+	struct tlsv1_server_session_entry *entry;
+	struct os_time now;
+	int ret = -1;
+
+	if (sessions == NULL || sessions->max_entries == 0 ||
+	    session_id_len == 0)
+		return -1;
+
+	os_get_time(&now);
+	tlsv1_server_sessions_lock(sessions);
+	entry = tlsv1_server_session_find(sessions, session_id,
+					  session_id_len);
+	if (entry && entry->expires <= now.sec) {
+		tlsv1_server_session_free(sessions, entry);
+		sessions->stats.timeouts++;
+		entry = NULL;
+	}
+
+	if (entry && tlsv1_server_session_copy(sess, &entry->sess) == 0) {
+		sessions->stats.hits++;
+		ret = 0;
+	} else {
+		sessions->stats.misses++;
+	}
+	tlsv1_server_sessions_unlock(sessions);
+
+	return ret;
+}
+
+
+static int tlsv1_server_ticket_key_gen(struct tlsv1_ticket_key *key,
+				       os_time_t now)
+{
+	if (random_get_bytes(key->name, sizeof(key->name)) ||
+	    random_get_bytes(key->aes_key, sizeof(key->aes_key)) ||
+	    random_get_bytes(key->hmac_key, sizeof(key->hmac_key))) {
+		wpa_printf(MSG_ERROR, "TLSv1: Failed to generate session "
+			   "ticket key");
+		key->valid = 0;
+		return -1;
+	}
+	key->created = now;
+	key->valid = 1;
+	return 0;
+}
+
+
+static void tlsv1_server_ticket_keys_update(
+	struct tlsv1_server_sessions *sessions, os_time_t now)
+{
+	struct tlsv1_ticket_key *cur = &sessions->keys[0];
+	struct tlsv1_ticket_key *prev = &sessions->keys[1];
+
+	if (prev->valid && now - prev->created >=
+	    2 * (os_time_t) sessions->ticket_key_lifetime) {
+		os_memset(prev, 0, sizeof(*prev));
+	}
+
+	if (cur->valid &&
+	    now - cur->created < (os_time_t) sessions->ticket_key_lifetime)
+		return;
+
+	if (cur->valid) {
+		wpa_printf(MSG_DEBUG, "TLSv1: Rotate session ticket key");
+		os_memcpy(prev, cur, sizeof(*prev));
+		sessions->stats.ticket_key_rotations++;
+	}
+	tlsv1_server_ticket_key_gen(cur, now);
+	sessions->dirty = 1;
+}
+
+
+/**
+ * tlsv1_server_session_ticket_seal - Build an RFC 5077 session ticket
+ * @sessions: Session cache from tlsv1_server_sessions_init()
+ * @sess: Session state to protect
+ * @ticket_len: Buffer for returning the ticket length
+ * Returns: Allocated ticket or %NULL on failure
+ *
+ * The ticket uses the format recommended in RFC 5077, Section 4, i.e.,
+ * key_name | IV | encrypted_state<0..2^16-1> | MAC with AES-128-CBC and
+ * HMAC-SHA256.
+ */
+u8 * tlsv1_server_session_ticket_seal(struct tlsv1_server_sessions *sessions,
+				      const struct tlsv1_server_session *sess,
+				      size_t *ticket_len)
+{
+	struct tlsv1_ticket_key key;
+	struct os_time now;
+	size_t data_len, state_len, pad_len, len;
+	u8 *ticket = NULL, *pos, *state;
+
+	if (sessions == NULL || !sessions->tickets)
+		return NULL;
+
+	os_get_time(&now);
+	tlsv1_server_sessions_lock(sessions);
+	tlsv1_server_ticket_keys_update(sessions, now.sec);
+	os_memcpy(&key, &sessions->keys[0], sizeof(key));
+	tlsv1_server_sessions_unlock(sessions);
+	if (!key.valid)
+		goto fail;
+
+	data_len = sess->success_data ? wpabuf_len(sess->success_data) : 0;
+	if (data_len > 0xffff - TLSV1_TICKET_STATE_HDR_LEN - 16)
+		goto fail;
+	state_len = TLSV1_TICKET_STATE_HDR_LEN + data_len;
+	pad_len = 16 - state_len % 16;
+	len = TLSV1_TICKET_KEY_NAME_LEN + TLSV1_TICKET_IV_LEN + 2 +
+		state_len + pad_len + SHA256_MAC_LEN;
+
+	ticket = os_malloc(len);
+	if (ticket == NULL)
+		goto fail;
+	pos = ticket;
+	os_memcpy(pos, key.name, TLSV1_TICKET_KEY_NAME_LEN);
+	pos += TLSV1_TICKET_KEY_NAME_LEN;
+	if (random_get_bytes(pos, TLSV1_TICKET_IV_LEN))
+		goto fail;
+	pos += TLSV1_TICKET_IV_LEN;
+	WPA_PUT_BE16(pos, state_len + pad_len);
+	pos += 2;
+
+	state = pos;
+	WPA_PUT_BE16(pos, sess->tls_version);
+	pos += 2;
+	WPA_PUT_BE16(pos, sess->cipher_suite);
+	pos += 2;
+	os_memcpy(pos, sess->master_secret, TLS_MASTER_SECRET_LEN);
+	pos += TLS_MASTER_SECRET_LEN;
+	WPA_PUT_BE32(pos, now.sec);
+	pos += 4;
+	WPA_PUT_BE16(pos, data_len);
+	pos += 2;
+	if (data_len) {
+		os_memcpy(pos, wpabuf_head(sess->success_data), data_len);
+		pos += data_len;
+	}
+	os_memset(pos, pad_len, pad_len);
+	pos += pad_len;
+
+	if (aes_128_cbc_encrypt(key.aes_key,
+				ticket + TLSV1_TICKET_KEY_NAME_LEN,
+				state, state_len + pad_len) < 0)
+		goto fail;
+
+	hmac_sha256(key.hmac_key, sizeof(key.hmac_key), ticket, pos - ticket,
+		    pos);
+	pos += SHA256_MAC_LEN;
+
+	os_memset(&key, 0, sizeof(key));
+	*ticket_len = pos - ticket;
+	return ticket;
+
+fail:
+	os_memset(&key, 0, sizeof(key));
+	os_free(ticket);
+	return NULL;
+}
+
+
+/**
+ * tlsv1_server_session_ticket_issued - Update statistics for a sent ticket
+ * @sessions: Session cache from tlsv1_server_sessions_init()
+ */
+void tlsv1_server_session_ticket_issued(struct tlsv1_server_sessions *sessions)
+{
+	if (sessions == NULL)
+		return;
+	tlsv1_server_sessions_lock(sessions);
+	sessions->stats.tickets_issued++;
+	tlsv1_server_sessions_unlock(sessions);
+}
+
+
+/**
+ * tlsv1_server_session_ticket_open - Validate and decrypt a session ticket
+ * @sessions: Session cache from tlsv1_server_sessions_init()
+ * @ticket: SessionTicket extension data from ClientHello
+ * @ticket_len: Length of ticket
+ * @sess: Buffer for the session state; to be freed with
+ *	tlsv1_server_session_clear()
+ * @renew: Set to 1 if the ticket was protected with a previous ticket key and
+ *	a new ticket should be issued
+ * Returns: 0 on success, -1 if the ticket cannot be used
+ */
+int tlsv1_server_session_ticket_open(struct tlsv1_server_sessions *sessions,
+				     const u8 *ticket, size_t ticket_len,
+				     struct tlsv1_server_session *sess,
+				     int *renew)
+{
+	struct tlsv1_ticket_key key;
+	struct os_time now;
+	u8 mac[SHA256_MAC_LEN];
+	const u8 *iv, *end;
+	u8 *state = NULL, *pos;
+	size_t state_len = 0, data_len, pad_len;
+	os_time_t issued;
+	int i;
+
+	if (sessions == NULL || !sessions->tickets)
+		return -1;
+
+	*renew = 0;
+	os_memset(&key, 0, sizeof(key));
+	os_memset(sess, 0, sizeof(*sess));
+
+	if (ticket_len < TLSV1_TICKET_KEY_NAME_LEN + TLSV1_TICKET_IV_LEN + 2 +
+	    16 + SHA256_MAC_LEN)
+		goto fail;
+
+	os_get_time(&now);
+	tlsv1_server_sessions_lock(sessions);
+	tlsv1_server_ticket_keys_update(sessions, now.sec);
+	for (i = 0; i < 2; i++) {
+		if (sessions->keys[i].valid &&
+		    os_memcmp(ticket, sessions->keys[i].name,
+			      TLSV1_TICKET_KEY_NAME_LEN) == 0) {
+			os_memcpy(&key, &sessions->keys[i], sizeof(key));
+			*renew = i > 0;
+			break;
+		}
+	}
+	tlsv1_server_sessions_unlock(sessions);
+	if (!key.valid) {
+		wpa_printf(MSG_DEBUG, "TLSv1: Unknown session ticket key");
+		goto fail;
+	}
+
+	iv = ticket + TLSV1_TICKET_KEY_NAME_LEN;
+	state_len = WPA_GET_BE16(iv + TLSV1_TICKET_IV_LEN);
+	end = iv + TLSV1_TICKET_IV_LEN + 2 + state_len;
+	if (state_len == 0 || state_len % 16 ||
+	    end + SHA256_MAC_LEN != ticket + ticket_len)
+		goto fail;
+
+	hmac_sha256(key.hmac_key, sizeof(key.hmac_key), ticket, end - ticket,
+		    mac);
+	if (os_memcmp_const(mac, end, SHA256_MAC_LEN) != 0) {
+		wpa_printf(MSG_DEBUG, "TLSv1: Invalid session ticket MAC");
+		goto fail;
+	}
+
+	state = os_malloc(state_len);
+	if (state == NULL)
+		goto fail;
+	os_memcpy(state, iv + TLSV1_TICKET_IV_LEN + 2, state_len);
+	if (aes_128_cbc_decrypt(key.aes_key, iv, state, state_len) < 0)
+		goto fail;
+
+	pad_len = state[state_len - 1];
+	if (pad_len == 0 || pad_len > 16 ||
+	    state_len < TLSV1_TICKET_STATE_HDR_LEN + pad_len)
+		goto fail;
+
+	pos = state;
+	sess->tls_version = WPA_GET_BE16(pos);
+	pos += 2;
+	sess->cipher_suite = WPA_GET_BE16(pos);
+	pos += 2;
+	os_memcpy(sess->master_secret, pos, TLS_MASTER_SECRET_LEN);
+	pos += TLS_MASTER_SECRET_LEN;
+	issued = WPA_GET_BE32(pos);
+	pos += 4;
+	data_len = WPA_GET_BE16(pos);
+	pos += 2;
+	if (TLSV1_TICKET_STATE_HDR_LEN + data_len + pad_len != state_len)
+		goto fail;
+
+	if (issued > now.sec ||
+	    now.sec - issued >= (os_time_t) sessions->lifetime) {
+		wpa_printf(MSG_DEBUG, "TLSv1: Session ticket expired");
+		goto fail;
+	}
+
+	if (data_len) {
+		sess->success_data = wpabuf_alloc_copy(pos, data_len);
+		if (sess->success_data == NULL)
+			goto fail;
+	}
+
+	os_memset(state, 0, state_len);
+	os_free(state);
+	os_memset(&key, 0, sizeof(key));
+	tlsv1_server_sessions_lock(sessions);
+	sessions->stats.ticket_hits++;
+	tlsv1_server_sessions_unlock(sessions);
+	return 0;
+
+fail:
+	if (state) {
+		os_memset(state, 0, state_len);
+		os_free(state);
+	}
+	os_memset(&key, 0, sizeof(key));
+	tlsv1_server_session_clear(sess);
+	tlsv1_server_sessions_lock(sessions);
+	sessions->stats.ticket_misses++;
+	tlsv1_server_sessions_unlock(sessions);
+	return -1;
+}
+
+
+static int tlsv1_server_sessions_parse_key(
+	struct tlsv1_server_sessions *sessions, const char *val)
+{
+	struct tlsv1_ticket_key *key;
+	u8 bin[TLSV1_TICKET_KEY_NAME_LEN + TLSV1_TICKET_AES_KEY_LEN +
+	       TLSV1_TICKET_HMAC_KEY_LEN];
+	char *pos;
+	os_time_t created;
+
+	/* <created> <name|aes_key|hmac_key> */
+	created = strtol(val, &pos, 10);
+	if (*pos != ' ' || os_strlen(pos + 1) != 2 * sizeof(bin) ||
+	    hexstr2bin(pos + 1, bin, sizeof(bin)) < 0)
+		return -1;
+
+	/* Keys are stored in order: current, previous */
+	key = sessions->keys[0].valid ? &sessions->keys[1] : &sessions->keys[0];
+	os_memcpy(key->name, bin, TLSV1_TICKET_KEY_NAME_LEN);
+	os_memcpy(key->aes_key, bin + TLSV1_TICKET_KEY_NAME_LEN,
+		  TLSV1_TICKET_AES_KEY_LEN);
+	os_memcpy(key->hmac_key,
+		  bin + TLSV1_TICKET_KEY_NAME_LEN + TLSV1_TICKET_AES_KEY_LEN,
+		  TLSV1_TICKET_HMAC_KEY_LEN);
+	key->created = created;
+	key->valid = 1;
+	os_memset(bin, 0, sizeof(bin));
+
+	return 0;
+}
+
+
+static int tlsv1_server_sessions_parse_session(
+	struct tlsv1_server_sessions *sessions, char *val, os_time_t now)
+{
+	struct tlsv1_server_session sess;
+	u8 id[TLS_SESSION_ID_MAX_LEN];
+	char *pos, *id_hex, *ms_hex, *data_hex;
+	unsigned int version, cipher;
+	os_time_t expires;
+	size_t id_len, data_len;
+	int ret = -1;
+
+	/* <expires> <session_id> <version> <cipher_suite> <master_secret>
+	 * <success_data or -> */
+	expires = strtol(val, &pos, 10);
+	if (*pos++ != ' ')
+		return -1;
+	id_hex = pos;
+	pos = os_strchr(pos, ' ');
+	if (pos == NULL)
+		return -1;
+	*pos++ = '\0';
+	if (sscanf(pos, "%x %x", &version, &cipher) != 2)
+		return -1;
+	pos = os_strchr(pos, ' ');
+	if (pos)
+		pos = os_strchr(pos + 1, ' ');
+	if (pos == NULL)
+		return -1;
+	ms_hex = pos + 1;
+	data_hex = os_strchr(ms_hex, ' ');
+	if (data_hex == NULL || data_hex - ms_hex != 2 * TLS_MASTER_SECRET_LEN)
+		return -1;
+	*data_hex++ = '\0';
+
+	/* Odd-length hex fields are rejected rather than truncated */
+	id_len = os_strlen(id_hex);
+	if (id_len == 0 || (id_len & 1) || id_len / 2 > sizeof(id))
+		return -1;
+	id_len /= 2;
+	if (hexstr2bin(id_hex, id, id_len) < 0)
+		return -1;
+
+	os_memset(&sess, 0, sizeof(sess));
+	sess.tls_version = version;
+	sess.cipher_suite = cipher;
+	if (hexstr2bin(ms_hex, sess.master_secret, TLS_MASTER_SECRET_LEN) < 0)
+		goto out;
+	if (os_strcmp(data_hex, "-") != 0) {
+		data_len = os_strlen(data_hex);
+		if (data_len == 0 || (data_len & 1))
+			goto out;
+		data_len /= 2;
+		sess.success_data = wpabuf_alloc(data_len);
+		if (sess.success_data == NULL ||
+		    hexstr2bin(data_hex, wpabuf_put(sess.success_data,
+						    data_len),
+			       data_len) < 0)
+			goto out;
+	}
+
+	ret = 0;
+	if (expires > now && sessions->num_entries < sessions->max_entries)
+		ret = tlsv1_server_session_insert(sessions, id, id_len,
+						  expires, &sess);
+out:
+	tlsv1_server_session_clear(&sess);
+	return ret;
+}
+
+
+static void tlsv1_server_sessions_load(struct tlsv1_server_sessions *sessions)
+{
+	FILE *f;
+	char buf[2 * (TLS_SESSION_ID_MAX_LEN + TLS_MASTER_SECRET_LEN) + 1024];
+	char *pos;
+	struct os_time now;
+	int line = 0, res;
+
+	f = fopen(sessions->file, "r");
+	if (f == NULL)
+		return;
+
+	os_get_time(&now);
+
+	while (fgets(buf, sizeof(buf), f)) {
+		line++;
+		pos = os_strchr(buf, '\n');
+		if (pos)
+			*pos = '\0';
+		if (buf[0] == '#' || buf[0] == '\0')
+			continue;
+
+		if (os_strncmp(buf, "ticket_key=", 11) == 0)
+			res = tlsv1_server_sessions_parse_key(sessions,
+							      buf + 11);
+		else if (os_strncmp(buf, "session=", 8) == 0)
+			res = tlsv1_server_sessions_parse_session(
+				sessions, buf + 8, now.sec);
+		else
+			res = -1;
+		if (res < 0)
+			wpa_printf(MSG_INFO, "TLSv1: Invalid line %d in "
+				   "session cache file '%s'",
+				   line, sessions->file);
+	}
+
+	os_memset(buf, 0, sizeof(buf));
+	fclose(f);
+
+	wpa_printf(MSG_DEBUG, "TLSv1: Loaded %lu session(s) from '%s'",
+		   (unsigned long) sessions->num_entries, sessions->file);
+}
+
+
+/*
+ * Write the session cache into the file. A temporary file is used so that a
+ * partially written file never replaces the previous contents. The caller
+ * is responsible for locking.
+ */
+static void tlsv1_server_sessions_save(struct tlsv1_server_sessions *sessions,
+				       os_time_t now)
+{
+	FILE *f;
+	struct tlsv1_server_session_entry *entry;
+	char hex[2 * (TLSV1_TICKET_KEY_NAME_LEN + TLSV1_TICKET_AES_KEY_LEN +
+		      TLSV1_TICKET_HMAC_KEY_LEN) + 1];
+	char *tmp;
+	size_t len;
+	int i;
+#ifndef CONFIG_NATIVE_WINDOWS
+	int fd;
+#endif /* CONFIG_NATIVE_WINDOWS */
+
+	sessions->last_save = now;
+	len = os_strlen(sessions->file) + 5;
+	tmp = os_malloc(len);
+	if (tmp == NULL)
+		return;
+	os_snprintf(tmp, len, "%s.tmp", sessions->file);
+
+#ifndef CONFIG_NATIVE_WINDOWS
+	/* The file contains master secrets and ticket keys */
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd >= 0 && fchmod(fd, S_IRUSR | S_IWUSR) < 0) {
+		wpa_printf(MSG_INFO, "TLSv1: Could not restrict session "
+			   "cache file permissions: %s", strerror(errno));
+		close(fd);
+		unlink(tmp);
+		os_free(tmp);
+		return;
+	}
+	f = fd >= 0 ? fdopen(fd, "w") : NULL;
+	if (f == NULL && fd >= 0)
+		close(fd);
+#else /* CONFIG_NATIVE_WINDOWS */
+	f = fopen(tmp, "w");
+#endif /* CONFIG_NATIVE_WINDOWS */
+	if (f == NULL) {
+		wpa_printf(MSG_INFO, "TLSv1: Could not write session cache "
+			   "file '%s'", tmp);
+		os_free(tmp);
+		return;
+	}
+
+	fprintf(f, "# TLS server session cache\n");
+	for (i = 0; i < 2; i++) {
+		struct tlsv1_ticket_key *key = &sessions->keys[i];
+		char *pos = hex, *end = hex + sizeof(hex);
+
+		if (!key->valid)
+			continue;
+		pos += wpa_snprintf_hex(pos, end - pos, key->name,
+					sizeof(key->name));
+		pos += wpa_snprintf_hex(pos, end - pos, key->aes_key,
+					sizeof(key->aes_key));
+		wpa_snprintf_hex(pos, end - pos, key->hmac_key,
+				 sizeof(key->hmac_key));
+		fprintf(f, "ticket_key=%ld %s\n", (long) key->created, hex);
+	}
+
+	/* Oldest first so that the expiration order is preserved on load */
+	dl_list_for_each_reverse(entry, &sessions->entries,
+				 struct tlsv1_server_session_entry, list) {
+		char id[2 * TLS_SESSION_ID_MAX_LEN + 1];
+		char ms[2 * TLS_MASTER_SECRET_LEN + 1];
+		const struct wpabuf *data = entry->sess.success_data;
+
+		if (entry->expires <= now)
+			continue;
+		wpa_snprintf_hex(id, sizeof(id), entry->session_id,
+				 entry->session_id_len);
+		wpa_snprintf_hex(ms, sizeof(ms), entry->sess.master_secret,
+				 TLS_MASTER_SECRET_LEN);
+		fprintf(f, "session=%ld %s %x %x %s ", (long) entry->expires,
+			id, entry->sess.tls_version, entry->sess.cipher_suite,
+			ms);
+		if (data && wpabuf_len(data)) {
+			const u8 *pos = wpabuf_head(data);
+			size_t j;
+
+			for (j = 0; j < wpabuf_len(data); j++)
+				fprintf(f, "%02x", pos[j]);
+			fprintf(f, "\n");
+		} else {
+			fprintf(f, "-\n");
+		}
+		os_memset(ms, 0, sizeof(ms));
+	}
+
+	os_memset(hex, 0, sizeof(hex));
+	if (fclose(f) != 0 || rename(tmp, sessions->file) < 0) {
+		wpa_printf(MSG_INFO, "TLSv1: Could not write session cache "
+			   "file '%s'", sessions->file);
+		unlink(tmp);
+	} else {
+		sessions->dirty = 0;
+	}
+	os_free(tmp);
+}
+
+
+/**
+ * tlsv1_server_sessions_init - Initialize server session cache
+ * @lifetime: Session lifetime in seconds
+ * @max_entries: Maximum number of cached sessions (0 = use only tickets)
+ * @tickets: Whether RFC 5077 session tickets are issued and accepted
+ * @ticket_key_lifetime: Ticket key rotation interval in seconds
+ * @file: File for storing the cache over restarts or %NULL
+ * Returns: Pointer to the session cache or %NULL on failure
+ */
+struct tlsv1_server_sessions *
+tlsv1_server_sessions_init(unsigned int lifetime, size_t max_entries,
+			   int tickets, unsigned int ticket_key_lifetime,
+			   const char *file)
+{
+	struct tlsv1_server_sessions *sessions;
+	struct os_time now;
+
+	sessions = os_zalloc(sizeof(*sessions));
+	if (sessions == NULL)
+		return NULL;
+
+	sessions->lifetime = lifetime;
+	sessions->max_entries = max_entries;
+	sessions->tickets = tickets;
+	sessions->ticket_key_lifetime = ticket_key_lifetime ?
+		ticket_key_lifetime : 3600;
+	dl_list_init(&sessions->entries);
+#ifdef CONFIG_TLS_WORKERS
+	pthread_mutex_init(&sessions->lock, NULL);
+#endif /* CONFIG_TLS_WORKERS */
+
+	if (file) {
+		sessions->file = os_strdup(file);
+		if (sessions->file == NULL) {
+			tlsv1_server_sessions_deinit(sessions);
+			return NULL;
+		}
+		os_get_time(&now);
+		tlsv1_server_sessions_load(sessions);
+		sessions->last_save = now.sec;
+	}
+
+	wpa_printf(MSG_DEBUG, "TLSv1: Server session cache enabled "
+		   "(lifetime=%u max_entries=%lu tickets=%d)",
+		   lifetime, (unsigned long) max_entries, tickets);
+
+	return sessions;
+}
+
+
+/**
+ * tlsv1_server_sessions_deinit - Deinitialize server session cache
+ * @sessions: Session cache from tlsv1_server_sessions_init()
+ */
+void tlsv1_server_sessions_deinit(struct tlsv1_server_sessions *sessions)
+{
+	struct tlsv1_server_session_entry *entry, *prev;
+
+	if (sessions == NULL)
+		return;
+
+	if (sessions->file) {
+		struct os_time now;
+
+		os_get_time(&now);
+		tlsv1_server_sessions_save(sessions, now.sec);
+	}
+
+	dl_list_for_each_safe(entry, prev, &sessions->entries,
+			      struct tlsv1_server_session_entry, list)
+		tlsv1_server_session_free(sessions, entry);
+	os_free(sessions->file);
+#ifdef CONFIG_TLS_WORKERS
+	pthread_mutex_destroy(&sessions->lock);
+#endif /* CONFIG_TLS_WORKERS */
+	os_memset(sessions, 0, sizeof(*sessions));
+	os_free(sessions);
+}
+
+
+unsigned int tlsv1_server_sessions_lifetime(
+	struct tlsv1_server_sessions *sessions)
+{
+	return sessions ? sessions->lifetime : 0;
+}
+
+
+int tlsv1_server_sessions_tickets(struct tlsv1_server_sessions *sessions)
+{
+	return sessions && sessions->tickets;
+}
+
+
+void tlsv1_server_sessions_get_stats(struct tlsv1_server_sessions *sessions,
+				     struct tls_session_stats *stats)
+{
+	tlsv1_server_sessions_lock(sessions);
+	os_memcpy(stats, &sessions->stats, sizeof(*stats));
+	stats->entries = sessions->num_entries;
+	tlsv1_server_sessions_unlock(sessions);
+}
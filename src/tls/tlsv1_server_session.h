@@ -0,0 +1,58 @@
+/*
+ * TLSv1 server - session cache and session tickets (RFC 5077)
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef TLSV1_SERVER_SESSION_H
+#define TLSV1_SERVER_SESSION_H
+
+#include "tlsv1_common.h"
+
+struct tls_session_stats;
+struct tlsv1_server_sessions;
+
+/**
+ * struct tlsv1_server_session - Resumable session state
+ * @tls_version: Negotiated protocol version
+ * @cipher_suite: Negotiated cipher suite
+ * @master_secret: TLS master secret
+ * @success_data: Data from tls_connection_set_success_data() or %NULL
+ */
+struct tlsv1_server_session {
+	u16 tls_version;
+	u16 cipher_suite;
+	u8 master_secret[TLS_MASTER_SECRET_LEN];
+	struct wpabuf *success_data;
+};
+
+struct tlsv1_server_sessions *
+tlsv1_server_sessions_init(unsigned int lifetime, size_t max_entries,
+			   int tickets, unsigned int ticket_key_lifetime,
+			   const char *file);
+void tlsv1_server_sessions_deinit(struct tlsv1_server_sessions *sessions);
+unsigned int tlsv1_server_sessions_lifetime(
+	struct tlsv1_server_sessions *sessions);
+int tlsv1_server_sessions_tickets(struct tlsv1_server_sessions *sessions);
+int tlsv1_server_session_add(struct tlsv1_server_sessions *sessions,
+			     const u8 *session_id, size_t session_id_len,
+			     const struct tlsv1_server_session *sess);
+int tlsv1_server_session_get(struct tlsv1_server_sessions *sessions,
+			     const u8 *session_id, size_t session_id_len,
+			     struct tlsv1_server_session *sess);
+u8 * tlsv1_server_session_ticket_seal(struct tlsv1_server_sessions *sessions,
+				      const struct tlsv1_server_session *sess,
+				      size_t *ticket_len);
+int tlsv1_server_session_ticket_open(struct tlsv1_server_sessions *sessions,
+				     const u8 *ticket, size_t ticket_len,
+				     struct tlsv1_server_session *sess,
+				     int *renew);
+void tlsv1_server_session_ticket_issued(
+	struct tlsv1_server_sessions *sessions);
+void tlsv1_server_session_clear(struct tlsv1_server_session *sess);
+void tlsv1_server_sessions_get_stats(struct tlsv1_server_sessions *sessions,
+				     struct tls_session_stats *stats);
+
+#endif /* TLSV1_SERVER_SESSION_H */
@@ -19,6 +19,7 @@
 #include "tlsv1_record.h"
 #include "tlsv1_server.h"
 #include "tlsv1_server_i.h"
+#include "tlsv1_server_session.h"
 
 
 static size_t tls_server_cert_chain_der_len(struct tlsv1_server *conn)
@@ -62,11 +63,18 @@ static int tls_write_server_hello(struct tlsv1_server *conn,
 	wpa_hexdump(MSG_MSGDUMP, "TLSv1: server_random",
 		    conn->server_random, TLS_RANDOM_LEN);
 
-	conn->session_id_len = TLS_SESSION_ID_MAX_LEN;
-	if (random_get_bytes(conn->session_id, conn->session_id_len)) {
+	if (conn->resumed && conn->client_session_id_len) {
+		/* RFC 5246, 7.4.1.3 and RFC 5077, 3.4: echo the Session ID */
+		conn->session_id_len = conn->client_session_id_len;
+		os_memcpy(conn->session_id, conn->client_session_id,
+			  conn->session_id_len);
+	} else if (random_get_bytes(conn->session_id,
+				    TLS_SESSION_ID_MAX_LEN)) {
 		wpa_printf(MSG_ERROR, "TLSv1: Could not generate "
 			   "session_id");
 		return -1;
+	} else {
+		conn->session_id_len = TLS_SESSION_ID_MAX_LEN;
 	}
 	wpa_hexdump(MSG_MSGDUMP, "TLSv1: session_id",
 		    conn->session_id, conn->session_id_len);
@@ -131,6 +139,24 @@ static int tls_write_server_hello(struct tlsv1_server *conn,
 		 * TODO: Add support for configuring RFC 4507 behavior and make
 		 * EAP-FAST disable it.
 		 */
+	} else if (conn->resumed) {
+		if (tlsv1_server_derive_keys(conn, NULL, 0) < 0) {
+			wpa_printf(MSG_DEBUG, "TLSv1: Failed to derive keys");
+			tlsv1_server_alert(conn, TLS_ALERT_LEVEL_FATAL,
+					   TLS_ALERT_INTERNAL_ERROR);
+			return -1;
+		}
+	}
+
+	if (conn->send_new_ticket) {
+		/* Extension server_hello_extension_list<0..2^16-1> */
+		WPA_PUT_BE16(pos, 4);
+		pos += 2;
+		/* RFC 5077, 3.2: empty SessionTicket extension */
+		WPA_PUT_BE16(pos, TLS_EXT_SESSION_TICKET);
+		pos += 2;
+		WPA_PUT_BE16(pos, 0);
+		pos += 2;
 	}
 
 	WPA_PUT_BE24(hs_length, pos - hs_length - 3);
@@ -798,34 +824,132 @@ static int tls_write_server_finished(struct tlsv1_server *conn,
 }
 
 
+static u8 * tls_server_new_ticket(struct tlsv1_server *conn,
+				  size_t *ticket_len)
+{
+	struct tlsv1_server_session sess;
+	u8 *ticket;
+
+	os_memset(&sess, 0, sizeof(sess));
+	sess.tls_version = conn->rl.tls_version;
+	sess.cipher_suite = conn->cipher_suite;
+	os_memcpy(sess.master_secret, conn->master_secret,
+		  TLS_MASTER_SECRET_LEN);
+	sess.success_data = conn->success_data;
+	ticket = tlsv1_server_session_ticket_seal(conn->sessions, &sess,
+						  ticket_len);
+	os_memset(&sess, 0, sizeof(sess));
+	if (ticket == NULL) {
+		/* RFC 5077, 3.3: send an empty ticket if one was promised */
+		tlsv1_server_log(conn, "Failed to build SessionTicket");
+		*ticket_len = 0;
+	}
+
+	return ticket;
+}
+
+
+static int tls_write_server_new_session_ticket(struct tlsv1_server *conn,
+					       const u8 *ticket,
+					       size_t ticket_len,
+					       u8 **msgpos, u8 *end)
+{
+	u8 *pos, *rhdr, *hs_start;
+	size_t rlen;
+
+	pos = *msgpos;
+
+	tlsv1_server_log(conn, "Send NewSessionTicket");
+	rhdr = pos;
+	pos += TLS_RECORD_HEADER_LEN;
+
+	if ((size_t) (end - pos) < 4 + 4 + 2 + ticket_len) {
+		tlsv1_server_alert(conn, TLS_ALERT_LEVEL_FATAL,
+				   TLS_ALERT_INTERNAL_ERROR);
+		return -1;
+	}
+
+	/* opaque fragment[TLSPlaintext.length] */
+
+	/* Handshake */
+	hs_start = pos;
+	/* HandshakeType msg_type */
+	*pos++ = TLS_HANDSHAKE_TYPE_NEW_SESSION_TICKET;
+	/* uint24 length */
+	WPA_PUT_BE24(pos, 4 + 2 + ticket_len);
+	pos += 3;
+	/* body - NewSessionTicket */
+	/* uint32 ticket_lifetime_hint */
+	WPA_PUT_BE32(pos, ticket ?
+		     tlsv1_server_sessions_lifetime(conn->sessions) : 0);
+	pos += 4;
+	/* opaque ticket<0..2^16-1> */
+	WPA_PUT_BE16(pos, ticket_len);
+	pos += 2;
+	if (ticket_len) {
+		os_memcpy(pos, ticket, ticket_len);
+		pos += ticket_len;
+	}
+
+	tls_verify_hash_add(&conn->verify, hs_start, pos - hs_start);
+
+	if (tlsv1_record_send(&conn->rl, TLS_CONTENT_TYPE_HANDSHAKE,
+			      rhdr, end - rhdr, hs_start, pos - hs_start,
+			      &rlen) < 0) {
+		wpa_printf(MSG_DEBUG, "TLSv1: Failed to create a record");
+		tlsv1_server_alert(conn, TLS_ALERT_LEVEL_FATAL,
+				   TLS_ALERT_INTERNAL_ERROR);
+		return -1;
+	}
+
+	*msgpos = rhdr + rlen;
+	if (ticket)
+		tlsv1_server_session_ticket_issued(conn->sessions);
+
+	return 0;
+}
+
+
 static u8 * tls_send_server_hello(struct tlsv1_server *conn, size_t *out_len)
 {
-	u8 *msg, *end, *pos;
-	size_t msglen;
+	u8 *msg, *end, *pos, *ticket = NULL;
+	size_t msglen, ticket_len = 0;
 
 	*out_len = 0;
 
-	msglen = 1000 + tls_server_cert_chain_der_len(conn);
+	if (conn->resumed && conn->send_new_ticket)
+		ticket = tls_server_new_ticket(conn, &ticket_len);
+
+	msglen = 1000 + tls_server_cert_chain_der_len(conn) + ticket_len;
 
 	msg = os_malloc(msglen);
-	if (msg == NULL)
+	if (msg == NULL) {
+		os_free(ticket);
 		return NULL;
+	}
 
 	pos = msg;
 	end = msg + msglen;
 
 	if (tls_write_server_hello(conn, &pos, end) < 0) {
+		os_free(ticket);
 		os_free(msg);
 		return NULL;
 	}
 
-	if (conn->use_session_ticket) {
+	if (conn->use_session_ticket || conn->resumed) {
 		/* Abbreviated handshake using session ticket; RFC 4507 */
-		if (tls_write_server_change_cipher_spec(conn, &pos, end) < 0 ||
+		if ((conn->send_new_ticket &&
+		     tls_write_server_new_session_ticket(conn, ticket,
+							 ticket_len, &pos,
+							 end) < 0) ||
+		    tls_write_server_change_cipher_spec(conn, &pos, end) < 0 ||
 		    tls_write_server_finished(conn, &pos, end) < 0) {
+			os_free(ticket);
 			os_free(msg);
 			return NULL;
 		}
+		os_free(ticket);
 
 		*out_len = pos - msg;
 
@@ -854,27 +978,40 @@ static u8 * tls_send_server_hello(struct tlsv1_server *conn, size_t *out_len)
 static u8 * tls_send_change_cipher_spec(struct tlsv1_server *conn,
 					size_t *out_len)
 {
-	u8 *msg, *end, *pos;
+	u8 *msg, *end, *pos, *ticket = NULL;
+	size_t msglen, ticket_len = 0;
 
 	*out_len = 0;
 
-	msg = os_malloc(1000);
-	if (msg == NULL)
+	if (conn->send_new_ticket)
+		ticket = tls_server_new_ticket(conn, &ticket_len);
+
+	msglen = 1000 + ticket_len;
+	msg = os_malloc(msglen);
+	if (msg == NULL) {
+		os_free(ticket);
 		return NULL;
+	}
 
 	pos = msg;
-	end = msg + 1000;
+	end = msg + msglen;
 
-	if (tls_write_server_change_cipher_spec(conn, &pos, end) < 0 ||
+	if ((conn->send_new_ticket &&
+	     tls_write_server_new_session_ticket(conn, ticket, ticket_len,
+						 &pos, end) < 0) ||
+	    tls_write_server_change_cipher_spec(conn, &pos, end) < 0 ||
 	    tls_write_server_finished(conn, &pos, end) < 0) {
+		os_free(ticket);
 		os_free(msg);
 		return NULL;
 	}
+	os_free(ticket);
 
 	*out_len = pos - msg;
 
 	tlsv1_server_log(conn, "Handshake completed successfully");
 	conn->state = ESTABLISHED;
+	tlsv1_server_session_store(conn);
 
 	return msg;
 }
@@ -888,7 +1025,8 @@ u8 * tlsv1_server_handshake_write(struct tlsv1_server *conn, size_t *out_len)
 	case SERVER_CHANGE_CIPHER_SPEC:
 		return tls_send_change_cipher_spec(conn, out_len);
 	default:
-		if (conn->state == ESTABLISHED && conn->use_session_ticket) {
+		if (conn->state == ESTABLISHED &&
+		    (conn->use_session_ticket || conn->resumed)) {
 			/* Abbreviated handshake was already completed. */
 			return NULL;
 		}
@@ -12,6 +12,26 @@
 
 #include "common.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define CPU_FEATURES_X86
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#define CPU_FEATURES_ARM
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif /* HWCAP_AES */
+#ifndef HWCAP_PMULL
+#define HWCAP_PMULL (1 << 4)
+#endif /* HWCAP_PMULL */
+#ifndef HWCAP_SHA1
+#define HWCAP_SHA1 (1 << 5)
+#endif /* HWCAP_SHA1 */
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif /* HWCAP_SHA2 */
+#endif
+
 
 static int hex2num(char c)
 {
@@ -857,3 +877,85 @@ void freq_range_value_list_flush(struct dl_list *head)
 		os_free(p);
 	}
 }
+
+
+#if defined(CPU_FEATURES_X86) || defined(CPU_FEATURES_ARM)
+
+/* Set in cpu_features_state once the CPU has been probed */
+#define CPU_FEATURES_PROBED 0x80000000U
+
+static unsigned int cpu_features_state;
+
+
+static unsigned int cpu_features_probe(void)
+{
+	unsigned int features = 0;
+#ifdef CPU_FEATURES_X86
+	unsigned int eax, ebx, ecx, edx;
+	int ssse3_sse41 = 0, avx = 0;
+
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		if ((ecx & bit_AES) && (edx & bit_SSE2))
+			features |= CPU_FEATURE_AES;
+		if ((ecx & bit_PCLMUL) && (ecx & bit_SSSE3))
+			features |= CPU_FEATURE_CLMUL;
+		ssse3_sse41 = (ecx & bit_SSSE3) && (ecx & bit_SSE4_1);
+		/* AVX state must also be enabled by the OS (OSXSAVE/XCR0) */
+		if ((ecx & bit_AVX) && (ecx & bit_OSXSAVE)) {
+			unsigned int xcr0_lo, xcr0_hi;
+
+			__asm__ volatile("xgetbv" : "=a" (xcr0_lo),
+					 "=d" (xcr0_hi) : "c" (0));
+			avx = (xcr0_lo & 0x6) == 0x6;
+		}
+	}
+	if (__get_cpuid_max(0, NULL) >= 7) {
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+		if (ssse3_sse41 && (ebx & bit_SHA))
+			features |= CPU_FEATURE_SHA1 | CPU_FEATURE_SHA256;
+		if (avx && (ebx & bit_AVX2))
+			features |= CPU_FEATURE_AVX2;
+	}
+#endif /* CPU_FEATURES_X86 */
+#ifdef CPU_FEATURES_ARM
+	unsigned long hwcap = getauxval(AT_HWCAP);
+
+	if (hwcap & HWCAP_AES)
+		features |= CPU_FEATURE_AES;
+	if (hwcap & HWCAP_PMULL)
+		features |= CPU_FEATURE_CLMUL;
+	if (hwcap & HWCAP_SHA1)
+		features |= CPU_FEATURE_SHA1;
+	if (hwcap & HWCAP_SHA2)
+		features |= CPU_FEATURE_SHA256;
+#endif /* CPU_FEATURES_ARM */
+	return features;
+}
+
+#endif /* CPU_FEATURES_X86 || CPU_FEATURES_ARM */
+
+
+/**
+ * cpu_features - Get the CPU features used by the crypto implementations
+ * Returns: CPU_FEATURE_* bitmap
+ *
+ * The CPU is probed on the first call. This can be called from worker
+ * threads; the probe has no side effects, so concurrent first callers may
+ * both run it and store the same result.
+ */
+unsigned int cpu_features(void)
+{
+#if defined(CPU_FEATURES_X86) || defined(CPU_FEATURES_ARM)
+	unsigned int state = __atomic_load_n(&cpu_features_state,
+					     __ATOMIC_ACQUIRE);
+
+	if (!(state & CPU_FEATURES_PROBED)) {
+		state = cpu_features_probe() | CPU_FEATURES_PROBED;
+		__atomic_store_n(&cpu_features_state, state, __ATOMIC_RELEASE);
+	}
+
+	return state & ~CPU_FEATURES_PROBED;
+#else /* CPU_FEATURES_X86 || CPU_FEATURES_ARM */
+	return 0;
+#endif /* CPU_FEATURES_X86 || CPU_FEATURES_ARM */
+}
@@ -543,6 +543,14 @@ void int_array_concat(int **res, const int *a);
 void int_array_sort_unique(int *a);
 void int_array_add_unique(int **res, int a);
 
+/* CPU features used by the crypto implementations */
+#define CPU_FEATURE_AES BIT(0) /* x86 AES-NI (with SSE2), ARMv8 AES */
+#define CPU_FEATURE_SHA1 BIT(1) /* x86 SHA (with SSSE3/SSE4.1), ARMv8 SHA1 */
+#define CPU_FEATURE_SHA256 BIT(2) /* x86 SHA (with SSSE3/SSE4.1), ARMv8 SHA2 */
+#define CPU_FEATURE_AVX2 BIT(3) /* x86 AVX2 enabled by the OS */
+#define CPU_FEATURE_CLMUL BIT(4) /* x86 PCLMULQDQ (with SSSE3), ARMv8 PMULL */
+unsigned int cpu_features(void);
+
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 
 
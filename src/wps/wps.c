@@ -374,6 +374,27 @@ int wps_ap_priority_compar(const struct wpabuf *wps_a,
 }
 
 
+/**
+ * wps_ap_priority - Get WPS AP priority class for sorting
+ * @wps: WPS IE contents from Beacon or Probe Response frame
+ * Returns: 0 if the WPS IE cannot be parsed, 1 if no Registrar is active, or
+ * 2 if a Registrar is active
+ *
+ * A higher value corresponds to the AP being preferred by
+ * wps_ap_priority_compar().
+ */
+int wps_ap_priority(const struct wpabuf *wps)
+{
+	struct wps_parse_attr attr;
+
+	if (wps == NULL || wps_parse_msg(wps, &attr) < 0)
+		return 0;
+	if (attr.selected_registrar && *attr.selected_registrar != 0)
+		return 2;
+	return 1;
+}
+
+
 /**
  * wps_get_uuid_e - Get UUID-E from WPS IE
  * @msg: WPS IE contents from Beacon or Probe Response frame
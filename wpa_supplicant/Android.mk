@@ -305,6 +305,10 @@ ifdef CONFIG_INTERWORKING
 OBJS += interworking.c
 L_CFLAGS += -DCONFIG_INTERWORKING
 NEED_GAS=y
+ifdef CONFIG_ANQP_CACHE
+OBJS += anqp_cache.c
+L_CFLAGS += -DCONFIG_ANQP_CACHE
+endif
 endif
 
 include $(LOCAL_PATH)/src/drivers/drivers.mk
@@ -1135,6 +1139,7 @@ endif
 AESOBJS = # none so far (see below)
 ifdef CONFIG_INTERNAL_AES
 AESOBJS += src/crypto/aes-internal.c src/crypto/aes-internal-dec.c
+AESOBJS += src/crypto/aes-internal-hw.c
 endif
 
 AESOBJS += src/crypto/aes-unwrap.c
@@ -1180,7 +1185,9 @@ SHA1OBJS += src/crypto/sha1.c
 endif
 SHA1OBJS += src/crypto/sha1-prf.c
 ifdef CONFIG_INTERNAL_SHA1
+L_CFLAGS += -DCONFIG_INTERNAL_SHA1
 SHA1OBJS += src/crypto/sha1-internal.c
+SHA1OBJS += src/crypto/sha1-internal-hw.c
 ifdef NEED_FIPS186_2_PRF
 SHA1OBJS += src/crypto/fips_prf_internal.c
 endif
@@ -1239,7 +1246,9 @@ SHA256OBJS += src/crypto/sha256.c
 endif
 SHA256OBJS += src/crypto/sha256-prf.c
 ifdef CONFIG_INTERNAL_SHA256
+L_CFLAGS += -DCONFIG_INTERNAL_SHA256
 SHA256OBJS += src/crypto/sha256-internal.c
+SHA256OBJS += src/crypto/sha256-internal-hw.c
 endif
 ifdef NEED_TLS_PRF_SHA256
 SHA256OBJS += src/crypto/sha256-tlsprf.c
@@ -1467,6 +1476,11 @@ L_CFLAGS += -DCONFIG_AUTOSCAN
 OBJS += autoscan.c
 endif
 
+ifdef CONFIG_SCAN_HISTORY
+L_CFLAGS += -DCONFIG_SCAN_HISTORY
+OBJS += scan_history.c
+endif
+
 ifdef CONFIG_EXT_PASSWORD_TEST
 OBJS += src/utils/ext_password_test.c
 L_CFLAGS += -DCONFIG_EXT_PASSWORD_TEST
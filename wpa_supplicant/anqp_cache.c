@@ -0,0 +1,622 @@
+/*
+ * wpa_supplicant - Persistent ANQP cache
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * ANQP data fetched during Interworking ANQP fetch is stored per BSSID
+ * together with the HESSID and ANQP Domain ID that the BSS advertised at that
+ * time. The cached data is used instead of a new ANQP query if the BSS still
+ * advertises the same HESSID and ANQP Domain ID, or if another BSS of the same
+ * homogenous ESS or ANQP domain has cached data. Entries are dropped once they
+ * are older than ANQP_CACHE_MAX_AGE.
+ *
+ * The cache is stored in a compact binary file (anqp_cache parameter) that is
+ * loaded when the cache is first needed:
+ * header: "WAC" version(1) num_entries(le16)
+ * entry: bssid(6) hessid(6) domain_id(le16) flags(1) fetched(le32)
+ *	ssid_len(1) ssid data_len(le16) data
+ * data: sequence of [info_id(le16) len(le16) payload]
+ */
+
+#include "includes.h"
+#ifndef CONFIG_NATIVE_WINDOWS
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif /* CONFIG_NATIVE_WINDOWS */
+
+#include "common.h"
+#include "common/ieee802_11_defs.h"
+#include "config.h"
+#include "wpa_supplicant_i.h"
+#include "bss.h"
+#include "interworking.h"
+#include "anqp_cache.h"
+
+
+#define ANQP_CACHE_VERSION 1
+#define ANQP_CACHE_MAX_ENTRIES 256
+#define ANQP_CACHE_MAX_AGE (24 * 60 * 60)
+#define ANQP_CACHE_HDR_LEN (4 + 2)
+#define ANQP_CACHE_ENTRY_LEN (ETH_ALEN + ETH_ALEN + 2 + 1 + 4 + 1)
+
+#define ANQP_CACHE_DOMAIN_ID BIT(0) /* ANQP Domain ID advertised */
+#define ANQP_CACHE_ALL BIT(1) /* fetched with all ANQP elements requested */
+
+/* Hotspot 2.0 ANQP elements are stored with the subtype in the info_id */
+#define ANQP_CACHE_HS20_ID 0x8000
+#define ANQP_CACHE_HS20(stype) (ANQP_CACHE_HS20_ID | (stype))
+
+struct anqp_cache_elem {
+	u16 info_id;
+	size_t offset; /* struct wpabuf * in struct wpa_bss_anqp */
+};
+
+static const struct anqp_cache_elem anqp_cache_elems[] = {
+	{ ANQP_VENUE_NAME, offsetof(struct wpa_bss_anqp, venue_name) },
+	{ ANQP_NETWORK_AUTH_TYPE,
+	  offsetof(struct wpa_bss_anqp, network_auth_type) },
+	{ ANQP_ROAMING_CONSORTIUM,
+	  offsetof(struct wpa_bss_anqp, roaming_consortium) },
+	{ ANQP_IP_ADDR_TYPE_AVAILABILITY,
+	  offsetof(struct wpa_bss_anqp, ip_addr_type_availability) },
+	{ ANQP_NAI_REALM, offsetof(struct wpa_bss_anqp, nai_realm) },
+	{ ANQP_3GPP_CELLULAR_NETWORK,
+	  offsetof(struct wpa_bss_anqp, anqp_3gpp) },
+	{ ANQP_DOMAIN_NAME, offsetof(struct wpa_bss_anqp, domain_name) },
+#ifdef CONFIG_HS20
+	{ ANQP_CACHE_HS20(HS20_STYPE_OPERATOR_FRIENDLY_NAME),
+	  offsetof(struct wpa_bss_anqp, hs20_operator_friendly_name) },
+	{ ANQP_CACHE_HS20(HS20_STYPE_WAN_METRICS),
+	  offsetof(struct wpa_bss_anqp, hs20_wan_metrics) },
+	{ ANQP_CACHE_HS20(HS20_STYPE_CONNECTION_CAPABILITY),
+	  offsetof(struct wpa_bss_anqp, hs20_connection_capability) },
+	{ ANQP_CACHE_HS20(HS20_STYPE_OPERATING_CLASS),
+	  offsetof(struct wpa_bss_anqp, hs20_operating_class) },
+	{ ANQP_CACHE_HS20(HS20_STYPE_OSU_PROVIDERS_LIST),
+	  offsetof(struct wpa_bss_anqp, hs20_osu_providers_list) },
+#endif /* CONFIG_HS20 */
+};
+
+struct anqp_cache_entry {
+	u8 bssid[ETH_ALEN];
+	u8 hessid[ETH_ALEN];
+	int domain_id; /* -1 if not advertised */
+	u8 flags; /* ANQP_CACHE_* */
+	u32 fetched;
+	u8 ssid[32];
+	size_t ssid_len;
+	struct wpabuf *data;
+};
+
+struct anqp_cache {
+	char *fname;
+	struct anqp_cache_entry *entries;
+	unsigned int num_entries;
+	int dirty;
+	struct anqp_cache_stats stats;
+};
+
+
+static struct wpabuf ** anqp_cache_field(struct wpa_bss_anqp *anqp,
+					 const struct anqp_cache_elem *elem)
+{
+	return (struct wpabuf **) ((u8 *) anqp + elem->offset);
+}
+
+
+static void anqp_cache_remove(struct anqp_cache *c, unsigned int i)
+{
+	wpabuf_free(c->entries[i].data);
+	os_memmove(&c->entries[i], &c->entries[i + 1],
+		   (c->num_entries - i - 1) * sizeof(struct anqp_cache_entry));
+	c->num_entries--;
+	c->dirty = 1;
+}
+
+
+static void anqp_cache_clear(struct anqp_cache *c)
+{
+	unsigned int i;
+
+	for (i = 0; i < c->num_entries; i++)
+		wpabuf_free(c->entries[i].data);
+	os_free(c->entries);
+	c->entries = NULL;
+	c->num_entries = 0;
+}
+
+
+static int anqp_cache_expired(const struct anqp_cache_entry *e, u32 now)
+{
+	return now > e->fetched && now - e->fetched > ANQP_CACHE_MAX_AGE;
+}
+
+
+static int anqp_cache_load(struct anqp_cache *c)
+{
+	const u8 *pos, *end;
+	char *buf;
+	size_t len, data_len;
+	unsigned int i, num;
+	struct os_time now;
+	int ret = -1;
+
+	buf = os_readfile(c->fname, &len);
+	if (buf == NULL)
+		return 0;
+
+	pos = (const u8 *) buf;
+	end = pos + len;
+	if (len < ANQP_CACHE_HDR_LEN || os_memcmp(pos, "WAC", 3) != 0 ||
+	    pos[3] != ANQP_CACHE_VERSION)
+		goto out;
+	pos += 4;
+	num = WPA_GET_LE16(pos);
+	pos += 2;
+	if (num > ANQP_CACHE_MAX_ENTRIES)
+		goto out;
+
+	c->entries = os_calloc(num, sizeof(struct anqp_cache_entry));
+	if (num && c->entries == NULL)
+		goto out;
+
+	os_get_time(&now);
+	for (i = 0; i < num; i++) {
+		struct anqp_cache_entry *e = &c->entries[c->num_entries];
+
+		if (end - pos < ANQP_CACHE_ENTRY_LEN)
+			goto out;
+		os_memcpy(e->bssid, pos, ETH_ALEN);
+		pos += ETH_ALEN;
+		os_memcpy(e->hessid, pos, ETH_ALEN);
+		pos += ETH_ALEN;
+		e->domain_id = WPA_GET_LE16(pos);
+		pos += 2;
+		e->flags = *pos++;
+		if (!(e->flags & ANQP_CACHE_DOMAIN_ID))
+			e->domain_id = -1;
+		e->fetched = WPA_GET_LE32(pos);
+		pos += 4;
+		e->ssid_len = *pos++;
+		if (e->ssid_len > sizeof(e->ssid) ||
+		    (size_t) (end - pos) < e->ssid_len + 2)
+			goto out;
+		os_memcpy(e->ssid, pos, e->ssid_len);
+		pos += e->ssid_len;
+		data_len = WPA_GET_LE16(pos);
+		pos += 2;
+		if ((size_t) (end - pos) < data_len)
+			goto out;
+		if (anqp_cache_expired(e, now.sec)) {
+			pos += data_len;
+			c->stats.expired++;
+			continue;
+		}
+		e->data = wpabuf_alloc_copy(pos, data_len);
+		if (e->data == NULL)
+			goto out;
+		pos += data_len;
+		c->num_entries++;
+	}
+	ret = 0;
+
+out:
+	os_free(buf);
+	if (ret < 0) {
+		wpa_printf(MSG_INFO, "ANQP cache: Ignore invalid cache file %s",
+			   c->fname);
+		anqp_cache_clear(c);
+		return -1;
+	}
+
+	wpa_printf(MSG_DEBUG, "ANQP cache: Loaded %u entries from %s",
+		   c->num_entries, c->fname);
+	return 0;
+}
+
+
+static void anqp_cache_save(struct anqp_cache *c)
+{
+	struct wpabuf *buf;
+	char *tmp;
+	size_t len;
+	unsigned int i;
+	FILE *f;
+	int ok;
+#ifndef CONFIG_NATIVE_WINDOWS
+	int fd;
+#endif /* CONFIG_NATIVE_WINDOWS */
+
+	len = ANQP_CACHE_HDR_LEN;
+	for (i = 0; i < c->num_entries; i++)
+		len += ANQP_CACHE_ENTRY_LEN + c->entries[i].ssid_len + 2 +
+			wpabuf_len(c->entries[i].data);
+	buf = wpabuf_alloc(len);
+	len = os_strlen(c->fname) + 5;
+	tmp = os_malloc(len);
+	if (buf == NULL || tmp == NULL) {
+		wpabuf_free(buf);
+		os_free(tmp);
+		return;
+	}
+
+	wpabuf_put_data(buf, "WAC", 3);
+	wpabuf_put_u8(buf, ANQP_CACHE_VERSION);
+	wpabuf_put_le16(buf, c->num_entries);
+	for (i = 0; i < c->num_entries; i++) {
+		struct anqp_cache_entry *e = &c->entries[i];
+
+		wpabuf_put_data(buf, e->bssid, ETH_ALEN);
+		wpabuf_put_data(buf, e->hessid, ETH_ALEN);
+		wpabuf_put_le16(buf, e->domain_id < 0 ? 0 : e->domain_id);
+		wpabuf_put_u8(buf, e->flags);
+		wpabuf_put_le32(buf, e->fetched);
+		wpabuf_put_u8(buf, e->ssid_len);
+		wpabuf_put_data(buf, e->ssid, e->ssid_len);
+		wpabuf_put_le16(buf, wpabuf_len(e->data));
+		wpabuf_put_buf(buf, e->data);
+	}
+
+	/* Write to a temporary file first to not lose the cache on errors */
+	os_snprintf(tmp, len, "%s.tmp", c->fname);
+#ifndef CONFIG_NATIVE_WINDOWS
+	/* The cached BSSes reveal where the device has been */
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd >= 0 && fchmod(fd, S_IRUSR | S_IWUSR) < 0) {
+		close(fd);
+		fd = -1;
+		unlink(tmp);
+	}
+	f = fd >= 0 ? fdopen(fd, "wb") : NULL;
+	if (f == NULL && fd >= 0)
+		close(fd);
+#else /* CONFIG_NATIVE_WINDOWS */
+	f = fopen(tmp, "wb");
+#endif /* CONFIG_NATIVE_WINDOWS */
+	if (f == NULL) {
+		wpa_printf(MSG_DEBUG, "ANQP cache: Could not open %s: %s",
+			   tmp, strerror(errno));
+		goto out;
+	}
+	ok = fwrite(wpabuf_head(buf), 1, wpabuf_len(buf), f) ==
+		wpabuf_len(buf);
+	if (fclose(f) != 0 || !ok || rename(tmp, c->fname) < 0) {
+		wpa_printf(MSG_DEBUG, "ANQP cache: Failed to write %s",
+			   c->fname);
+		unlink(tmp);
+		goto out;
+	}
+	c->dirty = 0;
+	wpa_printf(MSG_DEBUG, "ANQP cache: Saved %u entries to %s",
+		   c->num_entries, c->fname);
+
+out:
+	wpabuf_free(buf);
+	os_free(tmp);
+}
+
+
+/* Get the cache of the interface and load it from the file on first use */
+static struct anqp_cache * anqp_cache_open(struct wpa_supplicant *wpa_s)
+{
+	struct anqp_cache *c;
+
+	if (wpa_s->anqp_cache || wpa_s->conf->anqp_cache == NULL)
+		return wpa_s->anqp_cache;
+
+	c = os_zalloc(sizeof(*c));
+	if (c == NULL)
+		return NULL;
+	c->fname = os_strdup(wpa_s->conf->anqp_cache);
+	if (c->fname == NULL) {
+		os_free(c);
+		return NULL;
+	}
+	anqp_cache_load(c);
+	wpa_s->anqp_cache = c;
+
+	return c;
+}
+
+
+/*
+ * Cached data of another BSS can be used if both BSSes belong to the same
+ * homogenous ESS or advertise the same nonzero ANQP Domain ID.
+ */
+static int anqp_cache_same_ess(const struct anqp_cache_entry *e,
+			       struct wpa_bss *bss, int domain_id)
+{
+	if (e->ssid_len != bss->ssid_len ||
+	    os_memcmp(e->ssid, bss->ssid, bss->ssid_len) != 0 ||
+	    os_memcmp(e->hessid, bss->hessid, ETH_ALEN) != 0 ||
+	    e->domain_id != domain_id)
+		return 0;
+	return !is_zero_ether_addr(bss->hessid) || domain_id > 0;
+}
+
+
+#ifdef CONFIG_HS20
+static void anqp_cache_apply_hs20(struct wpa_supplicant *wpa_s,
+				  struct wpa_bss *bss, u8 subtype,
+				  const u8 *data, size_t len)
+{
+	struct wpabuf *buf;
+
+	buf = wpabuf_alloc(3 + 1 + 2 + len);
+	if (buf == NULL)
+		return;
+	wpabuf_put_be24(buf, OUI_WFA);
+	wpabuf_put_u8(buf, HS20_ANQP_OUI_TYPE);
+	wpabuf_put_u8(buf, subtype);
+	wpabuf_put_u8(buf, 0); /* Reserved */
+	wpabuf_put_data(buf, data, len);
+	interworking_parse_rx_anqp_resp(wpa_s, bss, bss->bssid,
+					ANQP_VENDOR_SPECIFIC,
+					wpabuf_head(buf), wpabuf_len(buf));
+	wpabuf_free(buf);
+}
+#endif /* CONFIG_HS20 */
+
+
+/*
+ * Cached elements are processed like a received ANQP response so that the
+ * same RX-ANQP events are reported and the same state is updated.
+ */
+static int anqp_cache_apply(struct wpa_supplicant *wpa_s,
+			    struct anqp_cache_entry *e, struct wpa_bss *bss)
+{
+	const u8 *pos, *end;
+	u16 info_id, len;
+
+	if (wpa_bss_anqp_unshare_alloc(bss) < 0)
+		return -1;
+
+	pos = wpabuf_head(e->data);
+	end = pos + wpabuf_len(e->data);
+	while (end - pos >= 4) {
+		info_id = WPA_GET_LE16(pos);
+		len = WPA_GET_LE16(pos + 2);
+		pos += 4;
+		if (end - pos < len)
+			break;
+		if (!(info_id & ANQP_CACHE_HS20_ID))
+			interworking_parse_rx_anqp_resp(wpa_s, bss, bss->bssid,
+							info_id, pos, len);
+#ifdef CONFIG_HS20
+		else
+			anqp_cache_apply_hs20(wpa_s, bss, info_id & 0xff, pos,
+					      len);
+#endif /* CONFIG_HS20 */
+		pos += len;
+	}
+
+	return 0;
+}
+
+
+/**
+ * anqp_cache_get - Fill in the ANQP data of a BSS from the cache
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @bss: BSS entry
+ * @all: Whether all ANQP elements are needed
+ * Returns: 0 if cached data was used or -1 if an ANQP query is needed
+ *
+ * Cached entries for the BSSID are removed if the BSS now advertises a
+ * different HESSID or ANQP Domain ID.
+ */
+int anqp_cache_get(struct wpa_supplicant *wpa_s, struct wpa_bss *bss, int all)
+{
+	struct anqp_cache *c;
+	struct anqp_cache_entry *e, *found = NULL;
+	struct os_time now;
+	unsigned int i;
+	int domain_id;
+
+	c = anqp_cache_open(wpa_s);
+	if (c == NULL)
+		return -1;
+
+	os_get_time(&now);
+	domain_id = interworking_anqp_domain_id(bss);
+	i = 0;
+	while (i < c->num_entries) {
+		e = &c->entries[i];
+		if (anqp_cache_expired(e, now.sec)) {
+			anqp_cache_remove(c, i);
+			c->stats.expired++;
+			continue;
+		}
+		if (os_memcmp(e->bssid, bss->bssid, ETH_ALEN) == 0) {
+			if (os_memcmp(e->hessid, bss->hessid, ETH_ALEN) != 0 ||
+			    e->domain_id != domain_id) {
+				wpa_printf(MSG_DEBUG, "ANQP cache: Drop entry for "
+					   MACSTR " - HESSID or ANQP Domain ID "
+					   "changed", MAC2STR(bss->bssid));
+				anqp_cache_remove(c, i);
+				c->stats.invalidated++;
+				continue;
+			}
+			if (!all || (e->flags & ANQP_CACHE_ALL)) {
+				found = e;
+				break;
+			}
+		} else if (found == NULL && anqp_cache_same_ess(e, bss,
+								 domain_id) &&
+			   (!all || (e->flags & ANQP_CACHE_ALL))) {
+			found = e;
+		}
+		i++;
+	}
+
+	if (found == NULL || anqp_cache_apply(wpa_s, found, bss) < 0) {
+		c->stats.misses++;
+		return -1;
+	}
+
+	wpa_printf(MSG_DEBUG, "ANQP cache: Use data fetched from " MACSTR
+		   " for " MACSTR, MAC2STR(found->bssid), MAC2STR(bss->bssid));
+	c->stats.hits++;
+	return 0;
+}
+
+
+/**
+ * anqp_cache_store - Store the ANQP data of a BSS in the cache
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @bss: BSS entry
+ * @all: Whether all ANQP elements were requested
+ */
+void anqp_cache_store(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
+		      int all)
+{
+	struct anqp_cache *c;
+	struct anqp_cache_entry *e = NULL;
+	struct wpabuf *data, **field;
+	struct os_time now;
+	unsigned int i, oldest = 0;
+	size_t len = 0;
+
+	if (bss->anqp == NULL || bss->ssid_len > sizeof(e->ssid))
+		return;
+	c = anqp_cache_open(wpa_s);
+	if (c == NULL)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(anqp_cache_elems); i++) {
+		field = anqp_cache_field(bss->anqp, &anqp_cache_elems[i]);
+		if (*field)
+			len += 4 + wpabuf_len(*field);
+	}
+	if (len == 0 || len > 0xffff)
+		return;
+	data = wpabuf_alloc(len);
+	if (data == NULL)
+		return;
+	for (i = 0; i < ARRAY_SIZE(anqp_cache_elems); i++) {
+		field = anqp_cache_field(bss->anqp, &anqp_cache_elems[i]);
+		if (*field == NULL)
+			continue;
+		wpabuf_put_le16(data, anqp_cache_elems[i].info_id);
+		wpabuf_put_le16(data, wpabuf_len(*field));
+		wpabuf_put_buf(data, *field);
+	}
+
+	for (i = 0; i < c->num_entries; i++) {
+		if (os_memcmp(c->entries[i].bssid, bss->bssid, ETH_ALEN) == 0) {
+			e = &c->entries[i];
+			break;
+		}
+		if (c->entries[i].fetched < c->entries[oldest].fetched)
+			oldest = i;
+	}
+	if (e == NULL && c->num_entries == ANQP_CACHE_MAX_ENTRIES) {
+		e = &c->entries[oldest];
+	} else if (e == NULL) {
+		e = os_realloc_array(c->entries, c->num_entries + 1,
+				     sizeof(struct anqp_cache_entry));
+		if (e == NULL) {
+			wpabuf_free(data);
+			return;
+		}
+		c->entries = e;
+		e = &c->entries[c->num_entries++];
+		e->data = NULL;
+	}
+
+	os_get_time(&now);
+	os_memcpy(e->bssid, bss->bssid, ETH_ALEN);
+	os_memcpy(e->hessid, bss->hessid, ETH_ALEN);
+	e->domain_id = interworking_anqp_domain_id(bss);
+	e->flags = all ? ANQP_CACHE_ALL : 0;
+	if (e->domain_id >= 0)
+		e->flags |= ANQP_CACHE_DOMAIN_ID;
+	e->fetched = now.sec;
+	os_memcpy(e->ssid, bss->ssid, bss->ssid_len);
+	e->ssid_len = bss->ssid_len;
+	wpabuf_free(e->data);
+	e->data = data;
+	c->dirty = 1;
+}
+
+
+/**
+ * anqp_cache_sync - Write the ANQP cache to its file if it has changed
+ * @wpa_s: Pointer to wpa_supplicant data
+ */
+void anqp_cache_sync(struct wpa_supplicant *wpa_s)
+{
+	if (wpa_s->anqp_cache && wpa_s->anqp_cache->dirty)
+		anqp_cache_save(wpa_s->anqp_cache);
+}
+
+
+/**
+ * anqp_cache_deinit - Save and free the ANQP cache of an interface
+ * @wpa_s: Pointer to wpa_supplicant data
+ */
+void anqp_cache_deinit(struct wpa_supplicant *wpa_s)
+{
+	struct anqp_cache *c = wpa_s->anqp_cache;
+
+	if (c == NULL)
+		return;
+
+	anqp_cache_sync(wpa_s);
+	wpa_s->anqp_cache = NULL;
+	anqp_cache_clear(c);
+	os_free(c->fname);
+	os_free(c);
+}
+
+
+/**
+ * anqp_cache_get_stats - Get ANQP cache statistics
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @stats: Buffer for returning the statistics
+ */
+void anqp_cache_get_stats(struct wpa_supplicant *wpa_s,
+			  struct anqp_cache_stats *stats)
+{
+	struct anqp_cache *c = wpa_s->anqp_cache;
+
+	os_memset(stats, 0, sizeof(*stats));
+	if (c == NULL)
+		return;
+	*stats = c->stats;
+	stats->entries = c->num_entries;
+}
+
+
+/**
+ * anqp_cache_get_status - Get ANQP cache status for STATUS command
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @buf: Buffer for status information
+ * @buflen: Maximum buffer length
+ * @verbose: Whether to include verbose status information
+ * Returns: Number of bytes written to buf
+ */
+int anqp_cache_get_status(struct wpa_supplicant *wpa_s, char *buf,
+			  size_t buflen, int verbose)
+{
+	struct anqp_cache_stats stats;
+	int ret;
+
+	if (!verbose || wpa_s->conf->anqp_cache == NULL)
+		return 0;
+
+	anqp_cache_get_stats(wpa_s, &stats);
+	ret = os_snprintf(buf, buflen,
+			  "anqp_cache_entries=%u\n"
+			  "anqp_cache_hits=%u\n"
+			  "anqp_cache_misses=%u\n"
+			  "anqp_cache_invalidated=%u\n"
+			  "anqp_cache_expired=%u\n",
+			  stats.entries, stats.hits, stats.misses,
+			  stats.invalidated, stats.expired);
+	if (ret < 0 || (size_t) ret >= buflen)
+		return 0;
+
+	return ret;
+}
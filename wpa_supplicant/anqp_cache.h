@@ -0,0 +1,74 @@
+/*
+ * wpa_supplicant - Persistent ANQP cache
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef ANQP_CACHE_H
+#define ANQP_CACHE_H
+
+struct wpa_supplicant;
+struct wpa_bss;
+
+/**
+ * struct anqp_cache_stats - ANQP cache statistics
+ * @entries: Number of entries in the cache
+ * @hits: Number of ANQP queries avoided by using cached data
+ * @misses: Number of lookups that did not find usable cached data
+ * @invalidated: Number of entries removed because the BSS advertised a
+ *	different HESSID or ANQP Domain ID than when the data was fetched
+ * @expired: Number of entries removed because they were too old
+ */
+struct anqp_cache_stats {
+	unsigned int entries;
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int invalidated;
+	unsigned int expired;
+};
+
+#ifdef CONFIG_ANQP_CACHE
+
+int anqp_cache_get(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
+		   int all);
+void anqp_cache_store(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
+		      int all);
+void anqp_cache_sync(struct wpa_supplicant *wpa_s);
+void anqp_cache_deinit(struct wpa_supplicant *wpa_s);
+void anqp_cache_get_stats(struct wpa_supplicant *wpa_s,
+			  struct anqp_cache_stats *stats);
+int anqp_cache_get_status(struct wpa_supplicant *wpa_s, char *buf,
+			  size_t buflen, int verbose);
+
+#else /* CONFIG_ANQP_CACHE */
+
+static inline int anqp_cache_get(struct wpa_supplicant *wpa_s,
+				 struct wpa_bss *bss, int all)
+{
+	return -1;
+}
+
+static inline void anqp_cache_store(struct wpa_supplicant *wpa_s,
+				    struct wpa_bss *bss, int all)
+{
+}
+
+static inline void anqp_cache_sync(struct wpa_supplicant *wpa_s)
+{
+}
+
+static inline void anqp_cache_deinit(struct wpa_supplicant *wpa_s)
+{
+}
+
+static inline int anqp_cache_get_status(struct wpa_supplicant *wpa_s,
+					char *buf, size_t buflen, int verbose)
+{
+	return 0;
+}
+
+#endif /* CONFIG_ANQP_CACHE */
+
+#endif /* ANQP_CACHE_H */
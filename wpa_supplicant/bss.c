@@ -37,6 +37,317 @@
 #define WPA_BSS_IES_CHANGED_FLAG	BIT(8)
 
 
+/*
+ * Parsed IE offsets for a BSS entry. The element IDs present in the Probe
+ * Response IEs are tracked in a bitmap with per-word ranks so that the offset
+ * of the first instance of an element is found with a single bit count. Vendor
+ * specific elements are indexed separately by their four octet vendor type for
+ * both the Probe Response and Beacon IEs. The index is built once for each
+ * shared IE data instance (struct wpa_bss_ies). The offsets are relative to the
+ * start of the Probe Response IEs and the Beacon IEs, respectively, and the
+ * Beacon vendor index is the Probe Response one if the IEs are shared.
+ */
+#define WPA_BSS_EID_BIT(eid) ((u32) 1 << ((eid) % 32))
+
+struct wpa_bss_vendor_ie {
+	u32 vendor_type;
+	u16 first; /* offset of the first element with this vendor type */
+	u16 last; /* offset of the last element with this vendor type */
+};
+
+struct wpa_bss_ie_index {
+	u32 eid_map[256 / 32];
+	u8 eid_rank[256 / 32];
+	u16 num_vendor;
+	u16 num_vendor_beacon;
+	u16 *eid_off;
+	struct wpa_bss_vendor_ie *vendor;
+	struct wpa_bss_vendor_ie *vendor_beacon;
+};
+
+
+static unsigned int wpa_bss_bit_count(u32 val)
+{
+	val = val - ((val >> 1) & 0x55555555);
+	val = (val & 0x33333333) + ((val >> 2) & 0x33333333);
+	return (((val + (val >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+}
+
+
+static unsigned int wpa_bss_ie_walk(const u8 *ies, size_t start, size_t end,
+				    u32 *eid_map)
+{
+	const u8 *pos = ies + start, *e = ies + end;
+	unsigned int num_vendor = 0;
+
+	while (pos + 1 < e) {
+		if (pos + 2 + pos[1] > e)
+			break;
+		if (eid_map)
+			eid_map[pos[0] / 32] |= WPA_BSS_EID_BIT(pos[0]);
+		if (pos[0] == WLAN_EID_VENDOR_SPECIFIC && pos[1] >= 4)
+			num_vendor++;
+		pos += 2 + pos[1];
+	}
+
+	return num_vendor;
+}
+
+
+static u16 wpa_bss_ie_index_vendor(const u8 *ies, size_t start, size_t end,
+				   struct wpa_bss_vendor_ie *vendor)
+{
+	const u8 *pos = ies + start, *e = ies + end;
+	u16 i, num = 0;
+	u32 vendor_type;
+
+	while (pos + 1 < e) {
+		if (pos + 2 + pos[1] > e)
+			break;
+		if (pos[0] == WLAN_EID_VENDOR_SPECIFIC && pos[1] >= 4) {
+			vendor_type = WPA_GET_BE32(&pos[2]);
+			for (i = 0; i < num; i++) {
+				if (vendor[i].vendor_type == vendor_type)
+					break;
+			}
+			if (i == num) {
+				vendor[i].vendor_type = vendor_type;
+				vendor[i].first = pos - ies;
+				num++;
+			}
+			vendor[i].last = pos - ies;
+		}
+		pos += 2 + pos[1];
+	}
+
+	return num;
+}
+
+
+static unsigned int wpa_bss_ie_index_rank(const struct wpa_bss_ie_index *idx,
+					  u8 eid)
+{
+	return idx->eid_rank[eid / 32] +
+		wpa_bss_bit_count(idx->eid_map[eid / 32] &
+				  (WPA_BSS_EID_BIT(eid) - 1));
+}
+
+
+static struct wpa_bss_ie_index * wpa_bss_ie_index_build(const u8 *ies,
+							size_t ie_len,
+							const u8 *beacon,
+							size_t beacon_len)
+{
+	struct wpa_bss_ie_index *idx;
+	const u8 *pos, *end;
+	u32 eid_map[256 / 32], seen[256 / 32];
+	unsigned int i, num_eid = 0, num_vendor, num_vendor_beacon = 0, rank;
+
+	if (ie_len > 0xffff || beacon_len > 0xffff)
+		return NULL; /* getters fall back to walking the IEs */
+
+	os_memset(eid_map, 0, sizeof(eid_map));
+	num_vendor = wpa_bss_ie_walk(ies, 0, ie_len, eid_map);
+	if (beacon != ies)
+		num_vendor_beacon = wpa_bss_ie_walk(beacon, 0, beacon_len,
+						    NULL);
+	for (i = 0; i < ARRAY_SIZE(eid_map); i++)
+		num_eid += wpa_bss_bit_count(eid_map[i]);
+
+	idx = os_zalloc(sizeof(*idx) + num_eid * sizeof(u16) +
+			(num_vendor + num_vendor_beacon) *
+			sizeof(struct wpa_bss_vendor_ie));
+	if (idx == NULL)
+		return NULL;
+	idx->vendor = (struct wpa_bss_vendor_ie *) (idx + 1);
+	idx->vendor_beacon = idx->vendor + num_vendor;
+	idx->eid_off = (u16 *) (idx->vendor_beacon + num_vendor_beacon);
+
+	os_memcpy(idx->eid_map, eid_map, sizeof(eid_map));
+	rank = 0;
+	for (i = 0; i < ARRAY_SIZE(eid_map); i++) {
+		idx->eid_rank[i] = rank;
+		rank += wpa_bss_bit_count(eid_map[i]);
+	}
+
+	os_memset(seen, 0, sizeof(seen));
+	pos = ies;
+	end = ies + ie_len;
+	while (pos + 1 < end) {
+		if (pos + 2 + pos[1] > end)
+			break;
+		if (!(seen[pos[0] / 32] & WPA_BSS_EID_BIT(pos[0]))) {
+			seen[pos[0] / 32] |= WPA_BSS_EID_BIT(pos[0]);
+			idx->eid_off[wpa_bss_ie_index_rank(idx, pos[0])] =
+				pos - ies;
+		}
+		pos += 2 + pos[1];
+	}
+
+	idx->num_vendor = wpa_bss_ie_index_vendor(ies, 0, ie_len, idx->vendor);
+	if (beacon == ies) {
+		idx->vendor_beacon = idx->vendor;
+		idx->num_vendor_beacon = idx->num_vendor;
+	} else {
+		idx->num_vendor_beacon =
+			wpa_bss_ie_index_vendor(beacon, 0, beacon_len,
+						idx->vendor_beacon);
+	}
+
+	return idx;
+}
+
+
+static u32 wpa_bss_ies_hash(const u8 *ies, size_t ie_len, const u8 *beacon,
+			    size_t beacon_len)
+{
+	u32 hash = 2166136261U;
+	size_t i;
+
+	/* FNV-1a over the IEs and their lengths */
+	for (i = 0; i < ie_len; i++)
+		hash = (hash ^ ies[i]) * 16777619U;
+	hash = (hash ^ (u32) ie_len) * 16777619U;
+	for (i = 0; i < beacon_len; i++)
+		hash = (hash ^ beacon[i]) * 16777619U;
+	hash = (hash ^ (u32) beacon_len) * 16777619U;
+
+	return hash;
+}
+
+
+static int wpa_bss_ies_match(const struct wpa_bss_ies *ies, u32 hash,
+			     const u8 *ie, size_t ie_len, const u8 *beacon,
+			     size_t beacon_len)
+{
+	return ies->hash == hash && ies->ie_len == ie_len &&
+		ies->beacon_ie_len == beacon_len &&
+		os_memcmp(ies + 1, ie, ie_len) == 0 &&
+		os_memcmp(ies->beacon_ie, beacon, beacon_len) == 0;
+}
+
+
+/*
+ * Get a reference to the shared IE data instance with the specified contents.
+ * The instance is allocated if no BSS entry uses the same IEs yet.
+ */
+static struct wpa_bss_ies * wpa_bss_ies_get(struct wpa_supplicant *wpa_s,
+					    const u8 *ie, size_t ie_len,
+					    const u8 *beacon,
+					    size_t beacon_len)
+{
+	struct wpa_bss_ies *ies;
+	u32 hash;
+	int shared;
+	size_t len;
+
+	hash = wpa_bss_ies_hash(ie, ie_len, beacon, beacon_len);
+	for (ies = wpa_s->bss_ies_hash[hash & (WPA_BSS_HASH_SIZE - 1)]; ies;
+	     ies = ies->hnext) {
+		if (wpa_bss_ies_match(ies, hash, ie, ie_len, beacon,
+				      beacon_len)) {
+			ies->users++;
+			wpa_s->bss_ies_ref_bytes += ie_len + beacon_len;
+			return ies;
+		}
+	}
+
+	shared = ie_len == beacon_len && os_memcmp(ie, beacon, ie_len) == 0;
+	len = shared ? ie_len : ie_len + beacon_len;
+	ies = os_zalloc(sizeof(*ies) + len);
+	if (ies == NULL)
+		return NULL;
+	ies->users = 1;
+	ies->hash = hash;
+	ies->ie_len = ie_len;
+	ies->beacon_ie_len = beacon_len;
+	os_memcpy(ies + 1, ie, ie_len);
+	if (shared) {
+		ies->beacon_ie = (const u8 *) (ies + 1);
+	} else {
+		os_memcpy((u8 *) (ies + 1) + ie_len, beacon, beacon_len);
+		ies->beacon_ie = (const u8 *) (ies + 1) + ie_len;
+	}
+	ies->index = wpa_bss_ie_index_build((const u8 *) (ies + 1), ie_len,
+					    ies->beacon_ie, beacon_len);
+
+	ies->hnext = wpa_s->bss_ies_hash[hash & (WPA_BSS_HASH_SIZE - 1)];
+	wpa_s->bss_ies_hash[hash & (WPA_BSS_HASH_SIZE - 1)] = ies;
+	wpa_s->bss_ies_num++;
+	wpa_s->bss_ies_bytes += len;
+	wpa_s->bss_ies_ref_bytes += ie_len + beacon_len;
+
+	return ies;
+}
+
+
+static void wpa_bss_ies_put(struct wpa_supplicant *wpa_s,
+			    struct wpa_bss_ies *ies)
+{
+	struct wpa_bss_ies **pos;
+
+	if (ies == NULL)
+		return;
+	wpa_s->bss_ies_ref_bytes -= ies->ie_len + ies->beacon_ie_len;
+	if (--ies->users > 0)
+		return;
+
+	pos = &wpa_s->bss_ies_hash[ies->hash & (WPA_BSS_HASH_SIZE - 1)];
+	while (*pos && *pos != ies)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = ies->hnext;
+	wpa_s->bss_ies_num--;
+	wpa_s->bss_ies_bytes -= ies->ie_len;
+	if (ies->beacon_ie != (const u8 *) (ies + 1))
+		wpa_s->bss_ies_bytes -= ies->beacon_ie_len;
+	os_free(ies->index);
+	os_free(ies);
+}
+
+
+/*
+ * Point the BSS entry to the shared IE data instance matching the IEs in the
+ * scan result. The old IEs are kept if memory allocation fails.
+ */
+static int wpa_bss_set_ies(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
+			   const struct wpa_scan_res *res)
+{
+	const u8 *ie = (const u8 *) (res + 1);
+	struct wpa_bss_ies *ies;
+
+	if (bss->ies &&
+	    wpa_bss_ies_match(bss->ies, bss->ies->hash, ie, res->ie_len,
+			      ie + res->ie_len, res->beacon_ie_len))
+		return 0;
+
+	ies = wpa_bss_ies_get(wpa_s, ie, res->ie_len, ie + res->ie_len,
+			      res->beacon_ie_len);
+	if (ies == NULL)
+		return -1;
+	wpa_bss_ies_put(wpa_s, bss->ies);
+	bss->ies = ies;
+	bss->ie_len = ies->ie_len;
+	bss->beacon_ie_len = ies->beacon_ie_len;
+	return 0;
+}
+
+
+static const struct wpa_bss_vendor_ie *
+wpa_bss_ie_index_get_vendor(const struct wpa_bss_vendor_ie *vendor,
+			    unsigned int num, u32 vendor_type)
+{
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		if (vendor[i].vendor_type == vendor_type)
+			return &vendor[i];
+	}
+
+	return NULL;
+}
+
+
 static void wpa_bss_set_hessid(struct wpa_bss *bss)
 {
 #ifdef CONFIG_INTERWORKING
@@ -176,10 +487,107 @@ static void wpa_bss_anqp_free(struct wpa_bss_anqp *anqp)
 }
 
 
+static unsigned int wpa_bss_hash_addr(const u8 *addr)
+{
+	return (addr[3] * 31 * 31 + addr[4] * 31 + addr[5]) &
+		(WPA_BSS_HASH_SIZE - 1);
+}
+
+
+#ifdef CONFIG_P2P
+static void wpa_bss_hash_add_p2p(struct wpa_supplicant *wpa_s,
+				 struct wpa_bss *bss)
+{
+	unsigned int hash;
+
+	if (!bss->p2p_dev_addr_set)
+		return;
+	hash = wpa_bss_hash_addr(bss->p2p_dev_addr);
+	bss->hnext_p2p = wpa_s->bss_hash_p2p[hash];
+	wpa_s->bss_hash_p2p[hash] = bss;
+}
+
+
+static void wpa_bss_hash_del_p2p(struct wpa_supplicant *wpa_s,
+				 struct wpa_bss *bss)
+{
+	struct wpa_bss **pos;
+
+	if (!bss->p2p_dev_addr_set)
+		return;
+	pos = &wpa_s->bss_hash_p2p[wpa_bss_hash_addr(bss->p2p_dev_addr)];
+	while (*pos && *pos != bss)
+		pos = &(*pos)->hnext_p2p;
+	if (*pos)
+		*pos = bss->hnext_p2p;
+}
+
+
+static void wpa_bss_set_p2p_dev_addr(struct wpa_supplicant *wpa_s,
+				     struct wpa_bss *bss)
+{
+	wpa_bss_hash_del_p2p(wpa_s, bss);
+	bss->p2p_dev_addr_set =
+		p2p_parse_dev_addr(wpa_bss_ie_ptr(bss), bss->ie_len,
+				   bss->p2p_dev_addr) == 0;
+	wpa_bss_hash_add_p2p(wpa_s, bss);
+}
+#endif /* CONFIG_P2P */
+
+
+static void wpa_bss_hash_add(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
+{
+	unsigned int hash;
+
+	hash = wpa_bss_hash_addr(bss->bssid);
+	bss->hnext_bssid = wpa_s->bss_hash_bssid[hash];
+	wpa_s->bss_hash_bssid[hash] = bss;
+
+	hash = bss->id & (WPA_BSS_HASH_SIZE - 1);
+	bss->hnext_id = wpa_s->bss_hash_id[hash];
+	wpa_s->bss_hash_id[hash] = bss;
+
+#ifdef CONFIG_P2P
+	wpa_bss_hash_add_p2p(wpa_s, bss);
+#endif /* CONFIG_P2P */
+}
+
+
+static void wpa_bss_hash_del(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
+{
+	struct wpa_bss **pos;
+
+	pos = &wpa_s->bss_hash_bssid[wpa_bss_hash_addr(bss->bssid)];
+	while (*pos && *pos != bss)
+		pos = &(*pos)->hnext_bssid;
+	if (*pos)
+		*pos = bss->hnext_bssid;
+
+	pos = &wpa_s->bss_hash_id[bss->id & (WPA_BSS_HASH_SIZE - 1)];
+	while (*pos && *pos != bss)
+		pos = &(*pos)->hnext_id;
+	if (*pos)
+		*pos = bss->hnext_id;
+
+#ifdef CONFIG_P2P
+	wpa_bss_hash_del_p2p(wpa_s, bss);
+#endif /* CONFIG_P2P */
+}
+
+
+/* Whether BSS entry a is after b in struct wpa_supplicant::bss */
+static int wpa_bss_later(const struct wpa_bss *a, const struct wpa_bss *b)
+{
+	return (int) (a->list_seq - b->list_seq) > 0;
+}
+
+
 static void wpa_bss_remove(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 			   const char *reason)
 {
-	if (wpa_s->last_scan_res) {
+	/* Only entries updated in the last round can be in last_scan_res */
+	if (wpa_s->last_scan_res &&
+	    bss->last_update_idx == wpa_s->bss_update_idx) {
 		unsigned int i;
 		for (i = 0; i < wpa_s->last_scan_res_used; i++) {
 			if (wpa_s->last_scan_res[i] == bss) {
@@ -194,12 +602,14 @@ static void wpa_bss_remove(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	}
 	dl_list_del(&bss->list);
 	dl_list_del(&bss->list_id);
+	wpa_bss_hash_del(wpa_s, bss);
 	wpa_s->num_bss--;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Remove id %u BSSID " MACSTR
 		" SSID '%s' due to %s", bss->id, MAC2STR(bss->bssid),
 		wpa_ssid_txt(bss->ssid, bss->ssid_len), reason);
 	wpas_notify_bss_removed(wpa_s, bss->bssid, bss->id);
 	wpa_bss_anqp_free(bss->anqp);
+	wpa_bss_ies_put(wpa_s, bss->ies);
 	os_free(bss);
 }
 
@@ -218,7 +628,9 @@ struct wpa_bss * wpa_bss_get(struct wpa_supplicant *wpa_s, const u8 *bssid,
 	struct wpa_bss *bss;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+	/* There is at most one entry for each BSSID,SSID pair */
+	for (bss = wpa_s->bss_hash_bssid[wpa_bss_hash_addr(bssid)]; bss;
+	     bss = bss->hnext_bssid) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0 &&
 		    bss->ssid_len == ssid_len &&
 		    os_memcmp(bss->ssid, ssid, ssid_len) == 0)
@@ -334,18 +746,24 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 {
 	struct wpa_bss *bss;
 
-	bss = os_zalloc(sizeof(*bss) + res->ie_len + res->beacon_ie_len);
+	bss = os_zalloc(sizeof(*bss));
 	if (bss == NULL)
 		return NULL;
+	if (wpa_bss_set_ies(wpa_s, bss, res) < 0) {
+		os_free(bss);
+		return NULL;
+	}
 	bss->id = wpa_s->bss_next_id++;
 	bss->last_update_idx = wpa_s->bss_update_idx;
 	wpa_bss_copy_res(bss, res, fetch_time);
 	os_memcpy(bss->ssid, ssid, ssid_len);
 	bss->ssid_len = ssid_len;
-	bss->ie_len = res->ie_len;
-	bss->beacon_ie_len = res->beacon_ie_len;
-	os_memcpy(bss + 1, res + 1, res->ie_len + res->beacon_ie_len);
 	wpa_bss_set_hessid(bss);
+#ifdef CONFIG_P2P
+	bss->p2p_dev_addr_set =
+		p2p_parse_dev_addr(wpa_bss_ie_ptr(bss), bss->ie_len,
+				   bss->p2p_dev_addr) == 0;
+#endif /* CONFIG_P2P */
 
 	if (wpa_s->num_bss + 1 > wpa_s->conf->bss_max_count &&
 	    wpa_bss_remove_oldest(wpa_s) != 0) {
@@ -357,6 +775,8 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
 	dl_list_add_tail(&wpa_s->bss_id, &bss->list_id);
+	bss->list_seq = wpa_s->bss_list_seq++;
+	wpa_bss_hash_add(wpa_s, bss);
 	wpa_s->num_bss++;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Add new id %u BSSID " MACSTR
 		" SSID '%s'",
@@ -441,7 +861,7 @@ static u32 wpa_bss_compare_res(const struct wpa_bss *old,
 		changes |= WPA_BSS_MODE_CHANGED_FLAG;
 
 	if (old->ie_len == new->ie_len &&
-	    os_memcmp(old + 1, new + 1, old->ie_len) == 0)
+	    os_memcmp(wpa_bss_ie_ptr(old), new + 1, old->ie_len) == 0)
 		return changes;
 	changes |= WPA_BSS_IES_CHANGED_FLAG;
 
@@ -522,38 +942,15 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 			MAC2STR(bss->bssid));
 	} else
 #endif /* CONFIG_P2P */
-	if (bss->ie_len + bss->beacon_ie_len >=
-	    res->ie_len + res->beacon_ie_len) {
-		os_memcpy(bss + 1, res + 1, res->ie_len + res->beacon_ie_len);
-		bss->ie_len = res->ie_len;
-		bss->beacon_ie_len = res->beacon_ie_len;
-	} else {
-		struct wpa_bss *nbss;
-		struct dl_list *prev = bss->list_id.prev;
-		dl_list_del(&bss->list_id);
-		nbss = os_realloc(bss, sizeof(*bss) + res->ie_len +
-				  res->beacon_ie_len);
-		if (nbss) {
-			unsigned int i;
-			for (i = 0; i < wpa_s->last_scan_res_used; i++) {
-				if (wpa_s->last_scan_res[i] == bss) {
-					wpa_s->last_scan_res[i] = nbss;
-					break;
-				}
-			}
-			if (wpa_s->current_bss == bss)
-				wpa_s->current_bss = nbss;
-			bss = nbss;
-			os_memcpy(bss + 1, res + 1,
-				  res->ie_len + res->beacon_ie_len);
-			bss->ie_len = res->ie_len;
-			bss->beacon_ie_len = res->beacon_ie_len;
-		}
-		dl_list_add(prev, &bss->list_id);
-	}
-	if (changes & WPA_BSS_IES_CHANGED_FLAG)
+		wpa_bss_set_ies(wpa_s, bss, res);
+	if (changes & WPA_BSS_IES_CHANGED_FLAG) {
 		wpa_bss_set_hessid(bss);
+#ifdef CONFIG_P2P
+		wpa_bss_set_p2p_dev_addr(wpa_s, bss);
+#endif /* CONFIG_P2P */
+	}
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
+	bss->list_seq = wpa_s->bss_list_seq++;
 
 	notify_bss_changes(wpa_s, changes, bss);
 
@@ -647,16 +1044,29 @@ void wpa_bss_update_scan_res(struct wpa_supplicant *wpa_s,
 	if (bss == NULL)
 		bss = wpa_bss_add(wpa_s, ssid + 2, ssid[1], res, fetch_time);
 	else {
-		bss = wpa_bss_update(wpa_s, bss, res, fetch_time);
-		if (wpa_s->last_scan_res) {
-			unsigned int i;
-			for (i = 0; i < wpa_s->last_scan_res_used; i++) {
-				if (bss == wpa_s->last_scan_res[i]) {
-					/* Already in the list */
-					return;
-				}
-			}
+		/*
+		 * An entry that was already updated during this round is
+		 * already in last_scan_res.
+		 */
+		int seen = bss->last_update_idx == wpa_s->bss_update_idx;
+		if (seen) {
+			struct os_reltime update;
+
+			/*
+			 * The same BSSID,SSID pair can be reported multiple
+			 * times, e.g., if the BSS was seen on multiple
+			 * channels. Prefer the entry for the associated BSS
+			 * and otherwise the newer one.
+			 */
+			calculate_update_time(fetch_time, res->age, &update);
+			if (!((res->flags & WPA_SCAN_ASSOCIATED) &&
+			      !(bss->flags & WPA_SCAN_ASSOCIATED)) &&
+			    !os_reltime_before(&bss->last_update, &update))
+				return;
 		}
+		bss = wpa_bss_update(wpa_s, bss, res, fetch_time);
+		if (seen)
+			return;
 	}
 
 	if (bss == NULL)
@@ -810,6 +1220,11 @@ int wpa_bss_init(struct wpa_supplicant *wpa_s)
 {
 	dl_list_init(&wpa_s->bss);
 	dl_list_init(&wpa_s->bss_id);
+	os_memset(wpa_s->bss_hash_bssid, 0, sizeof(wpa_s->bss_hash_bssid));
+	os_memset(wpa_s->bss_hash_id, 0, sizeof(wpa_s->bss_hash_id));
+#ifdef CONFIG_P2P
+	os_memset(wpa_s->bss_hash_p2p, 0, sizeof(wpa_s->bss_hash_p2p));
+#endif /* CONFIG_P2P */
 	eloop_register_timeout(WPA_BSS_EXPIRATION_PERIOD, 0,
 			       wpa_bss_timeout, wpa_s, NULL);
 	return 0;
@@ -848,6 +1263,34 @@ void wpa_bss_deinit(struct wpa_supplicant *wpa_s)
 }
 
 
+/**
+ * wpa_bss_ies_status - Get memory use of the shared BSS IEs
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @buf: Buffer for status information
+ * @buflen: Maximum buffer length
+ * Returns: Number of bytes written to buf
+ *
+ * bss_ie_bytes is the number of octets of IEs stored for the BSS table while
+ * bss_ie_ref_bytes is the number of octets the entries would use without
+ * sharing identical IEs.
+ */
+int wpa_bss_ies_status(struct wpa_supplicant *wpa_s, char *buf, size_t buflen)
+{
+	int ret;
+
+	ret = os_snprintf(buf, buflen,
+			  "bss_ie_sets=%u\n"
+			  "bss_ie_bytes=%lu\n"
+			  "bss_ie_ref_bytes=%lu\n",
+			  wpa_s->bss_ies_num,
+			  (unsigned long) wpa_s->bss_ies_bytes,
+			  (unsigned long) wpa_s->bss_ies_ref_bytes);
+	if (ret < 0 || (size_t) ret >= buflen)
+		return 0;
+	return ret;
+}
+
+
 /**
  * wpa_bss_get_bssid - Fetch a BSS table entry based on BSSID
  * @wpa_s: Pointer to wpa_supplicant data
@@ -857,14 +1300,17 @@ void wpa_bss_deinit(struct wpa_supplicant *wpa_s)
 struct wpa_bss * wpa_bss_get_bssid(struct wpa_supplicant *wpa_s,
 				   const u8 *bssid)
 {
-	struct wpa_bss *bss;
+	struct wpa_bss *bss, *found = NULL;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
-		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0)
-			return bss;
+	/* Return the most recently updated entry with this BSSID */
+	for (bss = wpa_s->bss_hash_bssid[wpa_bss_hash_addr(bssid)]; bss;
+	     bss = bss->hnext_bssid) {
+		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0 &&
+		    (found == NULL || wpa_bss_later(bss, found)))
+			found = bss;
 	}
-	return NULL;
+	return found;
 }
 
 
@@ -885,11 +1331,15 @@ struct wpa_bss * wpa_bss_get_bssid_latest(struct wpa_supplicant *wpa_s,
 	struct wpa_bss *bss, *found = NULL;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
+	for (bss = wpa_s->bss_hash_bssid[wpa_bss_hash_addr(bssid)]; bss;
+	     bss = bss->hnext_bssid) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) != 0)
 			continue;
 		if (found == NULL ||
-		    os_reltime_before(&found->last_update, &bss->last_update))
+		    os_reltime_before(&found->last_update, &bss->last_update) ||
+		    (!os_reltime_before(&bss->last_update,
+					&found->last_update) &&
+		     wpa_bss_later(bss, found)))
 			found = bss;
 	}
 	return found;
@@ -906,15 +1356,14 @@ struct wpa_bss * wpa_bss_get_bssid_latest(struct wpa_supplicant *wpa_s,
 struct wpa_bss * wpa_bss_get_p2p_dev_addr(struct wpa_supplicant *wpa_s,
 					  const u8 *dev_addr)
 {
-	struct wpa_bss *bss;
-	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
-		u8 addr[ETH_ALEN];
-		if (p2p_parse_dev_addr((const u8 *) (bss + 1), bss->ie_len,
-				       addr) == 0 &&
-		    os_memcmp(addr, dev_addr, ETH_ALEN) == 0)
-			return bss;
+	struct wpa_bss *bss, *found = NULL;
+	for (bss = wpa_s->bss_hash_p2p[wpa_bss_hash_addr(dev_addr)]; bss;
+	     bss = bss->hnext_p2p) {
+		if (os_memcmp(bss->p2p_dev_addr, dev_addr, ETH_ALEN) == 0 &&
+		    (found == NULL || wpa_bss_later(bss, found)))
+			found = bss;
 	}
-	return NULL;
+	return found;
 }
 #endif /* CONFIG_P2P */
 
@@ -928,7 +1377,8 @@ struct wpa_bss * wpa_bss_get_p2p_dev_addr(struct wpa_supplicant *wpa_s,
 struct wpa_bss * wpa_bss_get_id(struct wpa_supplicant *wpa_s, unsigned int id)
 {
 	struct wpa_bss *bss;
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+	for (bss = wpa_s->bss_hash_id[id & (WPA_BSS_HASH_SIZE - 1)]; bss;
+	     bss = bss->hnext_id) {
 		if (bss->id == id)
 			return bss;
 	}
@@ -970,11 +1420,18 @@ struct wpa_bss * wpa_bss_get_id_range(struct wpa_supplicant *wpa_s,
  */
 const u8 * wpa_bss_get_ie(const struct wpa_bss *bss, u8 ie)
 {
+	const struct wpa_bss_ie_index *idx = bss->ies->index;
 	const u8 *end, *pos;
 
-	pos = (const u8 *) (bss + 1);
+	pos = wpa_bss_ie_ptr(bss);
 	end = pos + bss->ie_len;
 
+	if (idx) {
+		if (!(idx->eid_map[ie / 32] & WPA_BSS_EID_BIT(ie)))
+			return NULL;
+		return pos + idx->eid_off[wpa_bss_ie_index_rank(idx, ie)];
+	}
+
 	while (pos + 1 < end) {
 		if (pos + 2 + pos[1] > end)
 			break;
@@ -998,11 +1455,20 @@ const u8 * wpa_bss_get_ie(const struct wpa_bss *bss, u8 ie)
  */
 const u8 * wpa_bss_get_vendor_ie(const struct wpa_bss *bss, u32 vendor_type)
 {
+	const struct wpa_bss_ie_index *idx = bss->ies->index;
 	const u8 *end, *pos;
 
-	pos = (const u8 *) (bss + 1);
+	pos = wpa_bss_ie_ptr(bss);
 	end = pos + bss->ie_len;
 
+	if (idx) {
+		const struct wpa_bss_vendor_ie *v;
+
+		v = wpa_bss_ie_index_get_vendor(idx->vendor, idx->num_vendor,
+						vendor_type);
+		return v ? pos + v->first : NULL;
+	}
+
 	while (pos + 1 < end) {
 		if (pos + 2 + pos[1] > end)
 			break;
@@ -1032,13 +1498,22 @@ const u8 * wpa_bss_get_vendor_ie(const struct wpa_bss *bss, u32 vendor_type)
 const u8 * wpa_bss_get_vendor_ie_beacon(const struct wpa_bss *bss,
 					u32 vendor_type)
 {
+	const struct wpa_bss_ie_index *idx = bss->ies->index;
 	const u8 *end, *pos;
 
 	if (bss->beacon_ie_len == 0)
 		return NULL;
 
-	pos = (const u8 *) (bss + 1);
-	pos += bss->ie_len;
+	if (idx) {
+		const struct wpa_bss_vendor_ie *v;
+
+		v = wpa_bss_ie_index_get_vendor(idx->vendor_beacon,
+						idx->num_vendor_beacon,
+						vendor_type);
+		return v ? wpa_bss_beacon_ie_ptr(bss) + v->first : NULL;
+	}
+
+	pos = wpa_bss_beacon_ie_ptr(bss);
 	end = pos + bss->beacon_ie_len;
 
 	while (pos + 1 < end) {
@@ -1064,12 +1539,25 @@ const u8 * wpa_bss_get_vendor_ie_beacon(const struct wpa_bss *bss,
 const u8 *wpa_bss_get_vendor_ie_subtype(const struct wpa_bss *bss,
 					u32 vendor_type, u32 subtype)
 {
+	const struct wpa_bss_ie_index *idx = bss->ies->index;
 	const u8 *end, *pos;
 
-	pos = (const u8 *)(bss + 1);
+	pos = wpa_bss_ie_ptr(bss);
 	end = pos + bss->ie_len;
 
+	if (idx) {
+		const struct wpa_bss_vendor_ie *v;
+
+		if (vendor_type > 0xffffff || subtype > 0xff)
+			return NULL;
+		v = wpa_bss_ie_index_get_vendor(idx->vendor, idx->num_vendor,
+						(vendor_type << 8) | subtype);
+		return v ? pos + v->first : NULL;
+	}
+
 	while (pos + 1 < end) {
+		if (pos + 2 + pos[1] > end)
+			break;
 		if (pos[0] == WLAN_EID_VENDOR_SPECIFIC && pos[1] >= 4 &&
 		    vendor_type == WPA_GET_BE24(&pos[2]) &&
 		    subtype == pos[5])
@@ -1094,16 +1582,28 @@ const u8 *wpa_bss_get_vendor_ie_subtype(const struct wpa_bss *bss,
 struct wpabuf * wpa_bss_get_vendor_ie_multi(const struct wpa_bss *bss,
 					    u32 vendor_type)
 {
+	const struct wpa_bss_ie_index *idx = bss->ies->index;
 	struct wpabuf *buf;
 	const u8 *end, *pos;
 
+	pos = wpa_bss_ie_ptr(bss);
+	end = pos + bss->ie_len;
+
+	if (idx) {
+		const struct wpa_bss_vendor_ie *v;
+
+		v = wpa_bss_ie_index_get_vendor(idx->vendor, idx->num_vendor,
+						vendor_type);
+		if (v == NULL)
+			return NULL;
+		end = pos + v->last + 2 + pos[v->last + 1];
+		pos += v->first;
+	}
+
 	buf = wpabuf_alloc(bss->ie_len);
 	if (buf == NULL)
 		return NULL;
 
-	pos = (const u8 *) (bss + 1);
-	end = pos + bss->ie_len;
-
 	while (pos + 1 < end) {
 		if (pos + 2 + pos[1] > end)
 			break;
@@ -1138,17 +1638,30 @@ struct wpabuf * wpa_bss_get_vendor_ie_multi(const struct wpa_bss *bss,
 struct wpabuf * wpa_bss_get_vendor_ie_multi_beacon(const struct wpa_bss *bss,
 						   u32 vendor_type)
 {
+	const struct wpa_bss_ie_index *idx = bss->ies->index;
 	struct wpabuf *buf;
 	const u8 *end, *pos;
 
+	pos = wpa_bss_beacon_ie_ptr(bss);
+	end = pos + bss->beacon_ie_len;
+
+	if (idx) {
+		const struct wpa_bss_vendor_ie *v;
+		const u8 *ies = wpa_bss_beacon_ie_ptr(bss);
+
+		v = wpa_bss_ie_index_get_vendor(idx->vendor_beacon,
+						idx->num_vendor_beacon,
+						vendor_type);
+		if (v == NULL)
+			return NULL;
+		pos = ies + v->first;
+		end = ies + v->last + 2 + ies[v->last + 1];
+	}
+
 	buf = wpabuf_alloc(bss->beacon_ie_len);
 	if (buf == NULL)
 		return NULL;
 
-	pos = (const u8 *) (bss + 1);
-	pos += bss->ie_len;
-	end = pos + bss->beacon_ie_len;
-
 	while (pos + 1 < end) {
 		if (pos + 2 + pos[1] > end)
 			break;
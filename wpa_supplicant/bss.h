@@ -21,6 +21,36 @@ struct wpa_scan_res;
 #define WPA_BSS_ASSOCIATED		BIT(5)
 #define WPA_BSS_ANQP_FETCH_TRIED	BIT(6)
 
+struct wpa_bss_ie_index;
+
+/**
+ * struct wpa_bss_ies - Shared IEs for BSS entries (struct wpa_bss)
+ *
+ * The IEs are stored by content in struct wpa_supplicant::bss_ies_hash and
+ * shared by all BSS entries with identical Probe Response and Beacon IEs. The
+ * Beacon IEs are not stored separately if they are identical to the Probe
+ * Response IEs. The contents are never modified; an entry with changed IEs is
+ * moved to another instance.
+ */
+struct wpa_bss_ies {
+	/** Next entry in the struct wpa_supplicant::bss_ies_hash bucket */
+	struct wpa_bss_ies *hnext;
+	/** Number of BSS entries referring to this IE data instance */
+	unsigned int users;
+	/** Hash of the IE contents */
+	u32 hash;
+	/** Length of the Probe Response IEs in octets */
+	size_t ie_len;
+	/** Length of the Beacon IEs in octets */
+	size_t beacon_ie_len;
+	/** Beacon IEs; either following the Probe Response IEs or same */
+	const u8 *beacon_ie;
+	/** Parsed IE offsets for the getters (%NULL if not available) */
+	struct wpa_bss_ie_index *index;
+	/* followed by ie_len octets of IEs */
+	/* followed by beacon_ie_len octets of IEs unless shared */
+};
+
 /**
  * struct wpa_bss_anqp - ANQP data for a BSS entry (struct wpa_bss)
  */
@@ -56,6 +86,23 @@ struct wpa_bss {
 	struct dl_list list;
 	/** List entry for struct wpa_supplicant::bss_id */
 	struct dl_list list_id;
+	/** Next entry in the struct wpa_supplicant::bss_hash_bssid bucket */
+	struct wpa_bss *hnext_bssid;
+	/** Next entry in the struct wpa_supplicant::bss_hash_id bucket */
+	struct wpa_bss *hnext_id;
+#ifdef CONFIG_P2P
+	/** Next entry in the struct wpa_supplicant::bss_hash_p2p bucket */
+	struct wpa_bss *hnext_p2p;
+	/** P2P Device Address from the P2P IE (if p2p_dev_addr_set) */
+	u8 p2p_dev_addr[ETH_ALEN];
+	/** Whether the Probe Response IEs include P2P Device Address */
+	int p2p_dev_addr_set;
+#endif /* CONFIG_P2P */
+	/**
+	 * Position in struct wpa_supplicant::bss; larger value for more
+	 * recently added/updated entries
+	 */
+	unsigned int list_seq;
 	/** Unique identifier for this BSS entry */
 	unsigned int id;
 	/** Number of counts without seeing this BSS */
@@ -90,14 +137,34 @@ struct wpa_bss {
 	struct os_reltime last_update;
 	/** ANQP data */
 	struct wpa_bss_anqp *anqp;
-	/** Length of the following IE field in octets (from Probe Response) */
+	/** Shared IEs; use wpa_bss_ie_ptr() and wpa_bss_beacon_ie_ptr() */
+	struct wpa_bss_ies *ies;
+	/** Length of the IE field in octets (from Probe Response) */
 	size_t ie_len;
-	/** Length of the following Beacon IE field in octets */
+	/** Length of the Beacon IE field in octets */
 	size_t beacon_ie_len;
-	/* followed by ie_len octets of IEs */
-	/* followed by beacon_ie_len octets of IEs */
 };
 
+/**
+ * wpa_bss_ie_ptr - Get the Probe Response IEs of a BSS entry
+ * @bss: BSS table entry
+ * Returns: Pointer to bss->ie_len octets of IEs
+ */
+static inline const u8 * wpa_bss_ie_ptr(const struct wpa_bss *bss)
+{
+	return (const u8 *) (bss->ies + 1);
+}
+
+/**
+ * wpa_bss_beacon_ie_ptr - Get the Beacon IEs of a BSS entry
+ * @bss: BSS table entry
+ * Returns: Pointer to bss->beacon_ie_len octets of IEs
+ */
+static inline const u8 * wpa_bss_beacon_ie_ptr(const struct wpa_bss *bss)
+{
+	return bss->ies->beacon_ie;
+}
+
 void wpa_bss_update_start(struct wpa_supplicant *wpa_s);
 void wpa_bss_update_scan_res(struct wpa_supplicant *wpa_s,
 			     struct wpa_scan_res *res,
@@ -133,6 +200,7 @@ int wpa_bss_get_max_rate(const struct wpa_bss *bss);
 int wpa_bss_get_bit_rates(const struct wpa_bss *bss, u8 **rates);
 struct wpa_bss_anqp * wpa_bss_anqp_alloc(void);
 int wpa_bss_anqp_unshare_alloc(struct wpa_bss *bss);
+int wpa_bss_ies_status(struct wpa_supplicant *wpa_s, char *buf, size_t buflen);
 
 static inline void wpa_bss_update_level(struct wpa_bss *bss, int new_level)
 {
@@ -1770,6 +1770,8 @@ int wpa_config_add_prio_network(struct wpa_config *config,
 	int prio;
 	struct wpa_ssid *prev, **nlist;
 
+	wpa_config_flush_ssid_index(config);
+
 	/*
 	 * Add to an existing priority list if one is available for the
 	 * configured priority level for this network.
@@ -1824,6 +1826,7 @@ int wpa_config_update_prio_list(struct wpa_config *config)
 	os_free(config->pssid);
 	config->pssid = NULL;
 	config->num_prio = 0;
+	wpa_config_flush_ssid_index(config);
 
 	ssid = config->ssid;
 	while (ssid) {
@@ -1836,6 +1839,211 @@ int wpa_config_update_prio_list(struct wpa_config *config)
 	return ret;
 }
 
+/*
+ * Network selection index. The networks in the pssid lists are stored in hash
+ * buckets by their SSID with an extra wildcard bucket for networks without an
+ * SSID (e.g., BSSID-only or WPS networks), so that each BSS needs to be checked
+ * only against the networks that could match it. The entries in each bucket
+ * are in priority list order.
+ */
+struct wpa_ssid_index_entry {
+	struct wpa_ssid *ssid;
+	int priority;
+	unsigned int order;
+};
+
+struct wpa_ssid_index {
+	unsigned int num_buckets;
+	unsigned int *start; /* num_buckets + 2 entries; last bucket: wildcard */
+	struct wpa_ssid_index_entry *entries;
+};
+
+
+static unsigned int wpa_ssid_index_bucket(unsigned int num_buckets,
+					  const u8 *ssid, size_t ssid_len)
+{
+	unsigned int hash = 0;
+	size_t i;
+
+	if (ssid_len == 0)
+		return num_buckets;
+	for (i = 0; i < ssid_len; i++)
+		hash = hash * 31 + ssid[i];
+	return hash & (num_buckets - 1);
+}
+
+
+static struct wpa_ssid_index * wpa_ssid_index_build(struct wpa_config *config)
+{
+	struct wpa_ssid_index *idx;
+	struct wpa_ssid *ssid;
+	unsigned int num = 0, num_buckets = 16, i, b, *fill;
+	int prio;
+
+	for (prio = 0; prio < config->num_prio; prio++) {
+		for (ssid = config->pssid[prio]; ssid; ssid = ssid->pnext)
+			num++;
+	}
+	while (num_buckets < num)
+		num_buckets <<= 1;
+
+	idx = os_zalloc(sizeof(*idx) +
+			(num_buckets + 2) * sizeof(unsigned int) +
+			num * sizeof(struct wpa_ssid_index_entry));
+	fill = os_calloc(num_buckets + 1, sizeof(unsigned int));
+	if (idx == NULL || fill == NULL) {
+		os_free(idx);
+		os_free(fill);
+		return NULL;
+	}
+	idx->num_buckets = num_buckets;
+	idx->entries = (struct wpa_ssid_index_entry *) (idx + 1);
+	idx->start = (unsigned int *) (idx->entries + num);
+
+	for (prio = 0; prio < config->num_prio; prio++) {
+		for (ssid = config->pssid[prio]; ssid; ssid = ssid->pnext) {
+			b = wpa_ssid_index_bucket(num_buckets, ssid->ssid,
+						  ssid->ssid_len);
+			idx->start[b + 1]++;
+		}
+	}
+	for (b = 0; b <= num_buckets; b++) {
+		idx->start[b + 1] += idx->start[b];
+		fill[b] = idx->start[b];
+	}
+
+	i = 0;
+	for (prio = 0; prio < config->num_prio; prio++) {
+		for (ssid = config->pssid[prio]; ssid; ssid = ssid->pnext) {
+			struct wpa_ssid_index_entry *e;
+
+			b = wpa_ssid_index_bucket(num_buckets, ssid->ssid,
+						  ssid->ssid_len);
+			e = &idx->entries[fill[b]++];
+			e->ssid = ssid;
+			e->priority = ssid->priority;
+			e->order = i++;
+		}
+	}
+	os_free(fill);
+
+	wpa_printf(MSG_DEBUG, "Network selection index: %u networks in %u "
+		   "buckets (%u without SSID)", num, num_buckets,
+		   idx->start[num_buckets + 1] - idx->start[num_buckets]);
+
+	return idx;
+}
+
+
+/**
+ * wpa_config_flush_ssid_index - Clear the network selection index
+ * @config: Configuration data from wpa_config_read()
+ *
+ * This needs to be called whenever the SSID of a network is changed outside
+ * wpa_config_update_prio_list(). The index is rebuilt when it is needed next.
+ */
+void wpa_config_flush_ssid_index(struct wpa_config *config)
+{
+	os_free(config->ssid_index);
+	config->ssid_index = NULL;
+}
+
+
+/* Find the range of entries with the specified priority in a bucket */
+static void wpa_ssid_index_range(const struct wpa_ssid_index *idx,
+				 unsigned int bucket, int priority,
+				 unsigned int *pos, unsigned int *end)
+{
+	unsigned int low, high, mid;
+
+	low = idx->start[bucket];
+	high = idx->start[bucket + 1];
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (idx->entries[mid].priority > priority)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	*pos = low;
+
+	high = idx->start[bucket + 1];
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (idx->entries[mid].priority >= priority)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	*end = low;
+}
+
+
+/**
+ * wpa_config_ssid_iter_init - Start iterating networks that may match an SSID
+ * @config: Configuration data from wpa_config_read()
+ * @iter: Iterator to initialize
+ * @priority: Priority of the networks to iterate
+ * @ssid: SSID of the BSS
+ * @ssid_len: Length of the SSID
+ * Returns: 0 on success, -1 if the index is not available
+ *
+ * The iteration covers the networks in the priority list for @priority that
+ * either have the same SSID hash as @ssid or no SSID at all. The caller is
+ * responsible for the full network matching; this only leaves out the networks
+ * that cannot match. If the index cannot be built, the caller needs to go
+ * through the priority list instead.
+ */
+int wpa_config_ssid_iter_init(struct wpa_config *config,
+			      struct wpa_ssid_index_iter *iter, int priority,
+			      const u8 *ssid, size_t ssid_len)
+{
+	const struct wpa_ssid_index *idx;
+	unsigned int b;
+
+	if (config->ssid_index == NULL)
+		config->ssid_index = wpa_ssid_index_build(config);
+	idx = config->ssid_index;
+	iter->index = idx;
+	if (idx == NULL)
+		return -1;
+
+	b = wpa_ssid_index_bucket(idx->num_buckets, ssid, ssid_len);
+	if (b == idx->num_buckets) {
+		iter->pos[0] = iter->end[0] = 0;
+	} else {
+		wpa_ssid_index_range(idx, b, priority, &iter->pos[0],
+				     &iter->end[0]);
+	}
+	wpa_ssid_index_range(idx, idx->num_buckets, priority, &iter->pos[1],
+			     &iter->end[1]);
+
+	return 0;
+}
+
+
+/**
+ * wpa_config_ssid_iter_next - Fetch the next network from the index
+ * @iter: Iterator from wpa_config_ssid_iter_init()
+ * Returns: Next network in priority list order or %NULL at the end
+ */
+struct wpa_ssid * wpa_config_ssid_iter_next(struct wpa_ssid_index_iter *iter)
+{
+	const struct wpa_ssid_index_entry *e = iter->index->entries;
+	int i;
+
+	if (iter->pos[0] < iter->end[0] &&
+	    (iter->pos[1] >= iter->end[1] ||
+	     e[iter->pos[0]].order < e[iter->pos[1]].order))
+		i = 0;
+	else if (iter->pos[1] < iter->end[1])
+		i = 1;
+	else
+		return NULL;
+
+	return e[iter->pos[i]++].ssid;
+}
+
 
 #ifdef IEEE8021X_EAPOL
 static void eap_peer_config_free(struct eap_peer_config *eap)
@@ -2009,6 +2217,7 @@ void wpa_config_free(struct wpa_config *config)
 	os_free(config->config_methods);
 	os_free(config->p2p_ssid_postfix);
 	os_free(config->pssid);
+	os_free(config->ssid_index);
 	os_free(config->p2p_pref_chan);
 	os_free(config->p2p_no_go_freq.range);
 	os_free(config->autoscan);
@@ -2022,6 +2231,8 @@ void wpa_config_free(struct wpa_config *config)
 	os_free(config->osu_dir);
 	os_free(config->bgscan);
 	os_free(config->wowlan_triggers);
+	os_free(config->scan_history);
+	os_free(config->anqp_cache);
 	os_free(config);
 }
 
@@ -3000,6 +3211,7 @@ struct wpa_config * wpa_config_alloc_empty(const char *ctrl_interface,
 		wpa_printf(MSG_ERROR, "Failed to duplicate bgscan string");
 
 	config->sched_scan_interval = DEFAULT_SCHED_SCAN_INTERVAL;
+	config->gas_max_parallel = DEFAULT_GAS_MAX_PARALLEL;
 
 #ifdef CONFIG_DEFAULT_WOWLAN_TRIGGERS
 	config->wowlan_triggers = os_strdup(CONFIG_DEFAULT_WOWLAN_TRIGGERS);
@@ -3626,6 +3838,9 @@ static const struct global_parse_data global_fields[] = {
 	{ INT(tdls_external_control), 0},
 	{ STR(osu_dir), 0 },
 	{ STR(wowlan_triggers), 0 },
+	{ STR(scan_history), 0 },
+	{ INT_RANGE(gas_max_parallel, 1, 16), 0 },
+	{ STR(anqp_cache), 0 },
 };
 
 #undef FUNC
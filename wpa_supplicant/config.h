@@ -37,6 +37,7 @@
 #define DEFAULT_SCAN_CUR_FREQ 0
 #define DEFAULT_DISASSOC_LOW_ACK 1
 #define DEFAULT_SCHED_SCAN_INTERVAL 30
+#define DEFAULT_GAS_MAX_PARALLEL 4
 
 #define DEFAULT_GLOBAL_BGSCAN "simple:64:-72:600"
 
@@ -322,6 +323,20 @@ struct wpa_cred {
 #define CFG_CHANGED_EXT_PW_BACKEND BIT(14)
 #define CFG_CHANGED_NFC_PASSWORD_TOKEN BIT(15)
 
+struct wpa_ssid_index;
+
+/**
+ * struct wpa_ssid_index_iter - Iterator over networks that may match a BSS
+ *
+ * This is initialized with wpa_config_ssid_iter_init() and the networks are
+ * fetched in priority list order with wpa_config_ssid_iter_next().
+ */
+struct wpa_ssid_index_iter {
+	const struct wpa_ssid_index *index;
+	unsigned int pos[2];
+	unsigned int end[2];
+};
+
 /**
  * struct wpa_config - wpa_supplicant configuration data
  *
@@ -351,6 +366,16 @@ struct wpa_config {
 	 */
 	int num_prio;
 
+	/**
+	 * ssid_index - Network selection index
+	 *
+	 * This maps SSIDs to the networks in the pssid lists that may match
+	 * them. It is built on demand by wpa_config_ssid_iter_init() and
+	 * cleared with wpa_config_flush_ssid_index() whenever the priority
+	 * lists are updated or the SSID of a network changes.
+	 */
+	struct wpa_ssid_index *ssid_index;
+
 	/**
 	 * cred - Head of the credential list
 	 *
@@ -1075,6 +1100,36 @@ struct wpa_config {
 	 * If set, these wowlan triggers will be configured
 	 */
 	char *wowlan_triggers;
+
+	/**
+	 * scan_history - File for the channel history of connection scans
+	 *
+	 * If set, the channels on which the configured networks are seen are
+	 * recorded per ESS and location and stored in this file. Connection
+	 * scans are then first limited to these channels and a full scan is
+	 * used only if the partial scans did not find a network.
+	 */
+	char *scan_history;
+
+	/**
+	 * gas_max_parallel - Maximum number of parallel GAS queries
+	 *
+	 * This limits the number of ANQP queries that are kept in flight
+	 * during Interworking ANQP fetch. GAS queries to BSSes on the same
+	 * channel are combined into a single radio work so that they can share
+	 * the off-channel operation.
+	 */
+	int gas_max_parallel;
+
+	/**
+	 * anqp_cache - File for caching ANQP data between runs
+	 *
+	 * If set, ANQP data fetched during Interworking ANQP fetch is stored
+	 * in this file together with the HESSID and ANQP Domain ID of the BSS
+	 * and used instead of new ANQP queries until it expires or the BSS
+	 * advertises a different HESSID or ANQP Domain ID.
+	 */
+	char *anqp_cache;
 };
 
 
@@ -1100,6 +1155,11 @@ void wpa_config_update_psk(struct wpa_ssid *ssid);
 int wpa_config_add_prio_network(struct wpa_config *config,
 				struct wpa_ssid *ssid);
 int wpa_config_update_prio_list(struct wpa_config *config);
+void wpa_config_flush_ssid_index(struct wpa_config *config);
+int wpa_config_ssid_iter_init(struct wpa_config *config,
+			      struct wpa_ssid_index_iter *iter, int priority,
+			      const u8 *ssid, size_t ssid_len);
+struct wpa_ssid * wpa_config_ssid_iter_next(struct wpa_ssid_index_iter *iter);
 const struct wpa_config_blob * wpa_config_get_blob(struct wpa_config *config,
 						   const char *name);
 void wpa_config_set_blob(struct wpa_config *config,
@@ -1155,6 +1155,13 @@ static void wpa_config_write_global(FILE *f, struct wpa_config *config)
 
 	if (config->bgscan && os_strcmp(config->bgscan, DEFAULT_GLOBAL_BGSCAN))
 		fprintf(f, "bgscan=\"%s\"\n", config->bgscan);
+
+	if (config->scan_history)
+		fprintf(f, "scan_history=%s\n", config->scan_history);
+	if (config->gas_max_parallel != DEFAULT_GAS_MAX_PARALLEL)
+		fprintf(f, "gas_max_parallel=%d\n", config->gas_max_parallel);
+	if (config->anqp_cache)
+		fprintf(f, "anqp_cache=%s\n", config->anqp_cache);
 }
 
 #endif /* CONFIG_NO_CONFIG_WRITE */
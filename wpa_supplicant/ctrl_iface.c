@@ -41,6 +41,8 @@
 #include "interworking.h"
 #include "blacklist.h"
 #include "autoscan.h"
+#include "scan_history.h"
+#include "anqp_cache.h"
 #include "wnm_sta.h"
 #include "offchannel.h"
 
@@ -1791,6 +1793,17 @@ static int wpa_supplicant_ctrl_iface_status(struct wpa_supplicant *wpa_s,
 	if (res >= 0)
 		pos += res;
 
+	res = scan_history_get_status(wpa_s, pos, end - pos, verbose);
+	if (res >= 0)
+		pos += res;
+
+	res = anqp_cache_get_status(wpa_s, pos, end - pos, verbose);
+	if (res >= 0)
+		pos += res;
+
+	if (verbose)
+		pos += wpa_bss_ies_status(wpa_s, pos, end - pos);
+
 #ifdef CONFIG_WPS
 	{
 		char uuid_str[100];
@@ -2582,6 +2595,8 @@ static int wpa_supplicant_ctrl_iface_set_network(
 		wpa_config_update_psk(ssid);
 	else if (os_strcmp(name, "priority") == 0)
 		wpa_config_update_prio_list(wpa_s->conf);
+	if (os_strcmp(name, "ssid") == 0)
+		wpa_config_flush_ssid_index(wpa_s->conf);
 
 	return 0;
 }
@@ -3416,7 +3431,7 @@ static int print_bss_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 			return 0;
 		pos += ret;
 
-		ie = (const u8 *) (bss + 1);
+		ie = wpa_bss_ie_ptr(bss);
 		for (i = 0; i < bss->ie_len; i++) {
 			ret = os_snprintf(pos, end - pos, "%02x", *ie++);
 			if (ret < 0 || ret >= end - pos)
@@ -3496,7 +3511,7 @@ static int print_bss_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 
 #ifdef CONFIG_WPS
 	if (mask & WPA_BSS_MASK_WPS_SCAN) {
-		ie = (const u8 *) (bss + 1);
+		ie = wpa_bss_ie_ptr(bss);
 		ret = wpas_wps_scan_result_text(ie, bss->ie_len, pos, end);
 		if (ret < 0 || ret >= end - pos)
 			return 0;
@@ -3506,7 +3521,7 @@ static int print_bss_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 
 #ifdef CONFIG_P2P
 	if (mask & WPA_BSS_MASK_P2P_SCAN) {
-		ie = (const u8 *) (bss + 1);
+		ie = wpa_bss_ie_ptr(bss);
 		ret = wpas_p2p_scan_result_text(ie, bss->ie_len, pos, end);
 		if (ret < 0 || ret >= end - pos)
 			return 0;
@@ -3517,7 +3532,7 @@ static int print_bss_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 #ifdef CONFIG_WIFI_DISPLAY
 	if (mask & WPA_BSS_MASK_WIFI_DISPLAY) {
 		struct wpabuf *wfd;
-		ie = (const u8 *) (bss + 1);
+		ie = wpa_bss_ie_ptr(bss);
 		wfd = ieee802_11_vendor_ie_concat(ie, bss->ie_len,
 						  WFD_IE_VENDOR_TYPE);
 		if (wfd) {
@@ -3758,6 +3773,11 @@ static int wpa_supplicant_ctrl_iface_bss_flush(
 		wpa_bss_flush(wpa_s);
 	else
 		wpa_bss_flush_by_age(wpa_s, flush_age);
+	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: %u entries remaining with %u shared "
+		"IE sets (%lu octets stored for %lu octets of IEs)",
+		(unsigned int) wpa_s->num_bss, wpa_s->bss_ies_num,
+		(unsigned long) wpa_s->bss_ies_bytes,
+		(unsigned long) wpa_s->bss_ies_ref_bytes);
 	return 0;
 }
 
@@ -5678,6 +5698,36 @@ static int wpas_ctrl_radio_work_show(struct wpa_supplicant *wpa_s,
 }
 
 
+static int wpas_ctrl_radio_work_stats(struct wpa_supplicant *wpa_s,
+				      char *buf, size_t buflen)
+{
+	struct radio_work_stats *stats;
+	unsigned int i;
+	char *pos, *end;
+
+	pos = buf;
+	end = buf + buflen;
+
+	for (i = 0; i < wpa_s->radio->num_work_stats; i++) {
+		int ret;
+
+		stats = &wpa_s->radio->work_stats[i];
+		ret = os_snprintf(pos, end - pos,
+				  "type=%s started=%u canceled=%u merged=%u late=%u wait_avg_usec=%llu wait_max_usec=%llu\n",
+				  stats->type, stats->started, stats->canceled,
+				  stats->merged, stats->late,
+				  stats->started ?
+				  stats->wait_usec / stats->started : 0ULL,
+				  stats->max_wait_usec);
+		if (ret < 0 || ret >= end - pos)
+			break;
+		pos += ret;
+	}
+
+	return pos - buf;
+}
+
+
 static void wpas_ctrl_radio_work_timeout(void *eloop_ctx, void *timeout_ctx)
 {
 	struct wpa_radio_work *work = eloop_ctx;
@@ -5756,8 +5806,8 @@ static int wpas_ctrl_radio_work_add(struct wpa_supplicant *wpa_s, char *cmd,
 		wpa_s->ext_work_id++;
 	ework->id = wpa_s->ext_work_id;
 
-	if (radio_add_work(wpa_s, freq, ework->type, 0, wpas_ctrl_radio_work_cb,
-			   ework) < 0) {
+	if (radio_add_work(wpa_s, freq, ework->type, RADIO_WORK_PRIO_NORMAL, 0,
+			   wpas_ctrl_radio_work_cb, ework) < 0) {
 		os_free(ework);
 		return -1;
 	}
@@ -5801,6 +5851,8 @@ static int wpas_ctrl_radio_work(struct wpa_supplicant *wpa_s, char *cmd,
 {
 	if (os_strcmp(cmd, "show") == 0)
 		return wpas_ctrl_radio_work_show(wpa_s, buf, buflen);
+	if (os_strcmp(cmd, "stats") == 0)
+		return wpas_ctrl_radio_work_stats(wpa_s, buf, buflen);
 	if (os_strncmp(cmd, "add ", 4) == 0)
 		return wpas_ctrl_radio_work_add(wpa_s, cmd + 4, buf, buflen);
 	if (os_strncmp(cmd, "done ", 5) == 0)
@@ -990,6 +990,8 @@ DBusMessage * wpas_dbus_iface_set_network(DBusMessage *message,
 			wpa_config_update_psk(ssid);
 		else if (os_strcmp(entry.key, "priority") == 0)
 			wpa_config_update_prio_list(wpa_s->conf);
+		if (os_strcmp(entry.key, "ssid") == 0)
+			wpa_config_flush_ssid_index(wpa_s->conf);
 
 		os_free(value);
 		wpa_dbus_dict_entry_clear(&entry);
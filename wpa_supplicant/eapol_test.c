@@ -40,6 +40,8 @@ struct extra_radius_attr {
 	struct extra_radius_attr *next;
 };
 
+struct eapol_test_load;
+
 struct eapol_test_data {
 	struct wpa_supplicant *wpa_s;
 
@@ -70,12 +72,66 @@ struct eapol_test_data {
 	struct extra_radius_attr *extra_attrs;
 
 	FILE *server_cert_file;
+
+	/* Load test mode (-l); NULL when running a single authentication */
+	struct eapol_test_load *load;
+	int load_active;
+	unsigned int load_round;
+	struct os_reltime load_auth_start;
+	struct os_reltime load_round_start;
 };
 
 static struct eapol_test_data eapol_test;
 
 
+#define EAPOL_TEST_LOAD_MAX_ROUNDS 20
+
+enum eapol_test_load_result {
+	EAPOL_TEST_LOAD_SUCCESS,
+	EAPOL_TEST_LOAD_REJECT,
+	EAPOL_TEST_LOAD_EAP_FAILURE,
+	EAPOL_TEST_LOAD_TIMEOUT,
+	EAPOL_TEST_LOAD_PMK_MISMATCH,
+	EAPOL_TEST_LOAD_SEND_ERROR
+};
+
+struct eapol_test_latency {
+	unsigned int *usec;
+	size_t num;
+	size_t alloc;
+};
+
+struct eapol_test_load {
+	unsigned int num_sessions;
+	double rate; /* offered load in authentications per second */
+	int duration; /* seconds during which new authentications arrive */
+	int auth_timeout; /* per-authentication timeout in seconds */
+
+	struct eapol_test_data *sessions;
+	struct wpa_supplicant *wpa_s;
+	unsigned int *idle; /* stack of indexes of idle sessions */
+	unsigned int num_idle;
+
+	struct os_reltime start;
+	struct os_reltime end;
+	unsigned int arrivals;
+	int arrivals_done;
+
+	unsigned int started;
+	unsigned int succeeded;
+	unsigned int failures[EAPOL_TEST_LOAD_SEND_ERROR + 1];
+	unsigned int no_free_session;
+
+	struct eapol_test_latency auth_latency;
+	struct eapol_test_latency round_latency[EAPOL_TEST_LOAD_MAX_ROUNDS];
+};
+
+
 static void send_eap_request_identity(void *eloop_ctx, void *timeout_ctx);
+static void eapol_test_rx_identity_request(struct wpa_supplicant *wpa_s);
+static void eapol_test_load_auth_done(struct eapol_test_data *e,
+				      enum eapol_test_load_result res);
+static void eapol_test_load_round_done(struct eapol_test_data *e);
 
 
 static void hostapd_logger_cb(void *ctx, const u8 *addr, unsigned int module,
@@ -275,9 +331,18 @@ static void ieee802_1x_encapsulate_radius(struct eapol_test_data *e,
 		}
 	}
 
+	if (e->load) {
+		e->load_round++;
+		os_get_reltime(&e->load_round_start);
+	}
+
 	if (radius_client_send(e->radius, msg, RADIUS_AUTH, e->wpa_s->own_addr)
-	    < 0)
+	    < 0) {
+		if (e->load)
+			eapol_test_load_auth_done(e,
+						  EAPOL_TEST_LOAD_SEND_ERROR);
 		goto fail;
+	}
 	return;
 
  fail:
@@ -288,11 +353,21 @@ static void ieee802_1x_encapsulate_radius(struct eapol_test_data *e,
 static int eapol_test_eapol_send(void *ctx, int type, const u8 *buf,
 				 size_t len)
 {
+	struct eapol_test_data *e = ctx;
+
+	if (e->load) {
+		/* Drop late frames from an authentication that has already
+		 * been completed or timed out */
+		if (type == IEEE802_1X_TYPE_EAP_PACKET && e->load_active)
+			ieee802_1x_encapsulate_radius(e, buf, len);
+		return 0;
+	}
+
 	printf("WPA: eapol_test_eapol_send(type=%d len=%lu)\n",
 	       type, (unsigned long) len);
 	if (type == IEEE802_1X_TYPE_EAP_PACKET) {
 		wpa_hexdump(MSG_DEBUG, "TX EAP -> RADIUS", buf, len);
-		ieee802_1x_encapsulate_radius(&eapol_test, buf, len);
+		ieee802_1x_encapsulate_radius(e, buf, len);
 	}
 	return 0;
 }
@@ -316,7 +391,10 @@ eapol_test_get_config_blob(void *ctx, const char *name)
 
 static void eapol_test_eapol_done_cb(void *ctx)
 {
-	printf("WPA: EAPOL processing complete\n");
+	struct eapol_test_data *e = ctx;
+
+	if (e->load == NULL)
+		printf("WPA: EAPOL processing complete\n");
 }
 
 
@@ -369,6 +447,26 @@ static void eapol_sm_cb(struct eapol_sm *eapol, enum eapol_supp_result result,
 			void *ctx)
 {
 	struct eapol_test_data *e = ctx;
+
+	if (e->load) {
+		if (!e->load_active)
+			return;
+		if (result == EAPOL_SUPP_RESULT_SUCCESS) {
+			if (!e->radius_access_accept_received)
+				return;
+			eapol_test_load_auth_done(
+				e, eapol_test_compare_pmk(e) ?
+				EAPOL_TEST_LOAD_PMK_MISMATCH :
+				EAPOL_TEST_LOAD_SUCCESS);
+		} else if (e->radius_access_reject_received) {
+			eapol_test_load_auth_done(e, EAPOL_TEST_LOAD_REJECT);
+		} else {
+			eapol_test_load_auth_done(e,
+						  EAPOL_TEST_LOAD_EAP_FAILURE);
+		}
+		return;
+	}
+
 	printf("eapol_sm_cb: result=%d\n", result);
 	e->eapol_test_num_reauths--;
 	if (e->eapol_test_num_reauths < 0)
@@ -522,7 +620,7 @@ static int test_eapol(struct eapol_test_data *e, struct wpa_supplicant *wpa_s,
 	ctx->scard_ctx = wpa_s->scard;
 	ctx->cb = eapol_sm_cb;
 	ctx->cb_ctx = e;
-	ctx->eapol_send_ctx = wpa_s;
+	ctx->eapol_send_ctx = e;
 	ctx->preauth = 0;
 	ctx->eapol_done_cb = eapol_test_eapol_done_cb;
 	ctx->eapol_send = eapol_test_eapol_send;
@@ -534,7 +632,10 @@ static int test_eapol(struct eapol_test_data *e, struct wpa_supplicant *wpa_s,
 	ctx->eap_param_needed = eapol_test_eap_param_needed;
 	ctx->cert_cb = eapol_test_cert_cb;
 	ctx->cert_in_cb = 1;
-	ctx->set_anon_id = eapol_test_set_anon_id;
+	/* Emulated supplicants in load test mode share the network blocks, so
+	 * do not let them update the configuration. */
+	if (e->load == NULL)
+		ctx->set_anon_id = eapol_test_set_anon_id;
 
 	wpa_s->eapol = eapol_sm_init(ctx);
 	if (wpa_s->eapol == NULL) {
@@ -601,9 +702,8 @@ static void test_eapol_clean(struct eapol_test_data *e,
 }
 
 
-static void send_eap_request_identity(void *eloop_ctx, void *timeout_ctx)
+static void eapol_test_rx_identity_request(struct wpa_supplicant *wpa_s)
 {
-	struct wpa_supplicant *wpa_s = eloop_ctx;
 	u8 buf[100], *pos;
 	struct ieee802_1x_hdr *hdr;
 	struct eap_hdr *eap;
@@ -620,12 +720,20 @@ static void send_eap_request_identity(void *eloop_ctx, void *timeout_ctx)
 	pos = (u8 *) (eap + 1);
 	*pos = EAP_TYPE_IDENTITY;
 
-	printf("Sending fake EAP-Request-Identity\n");
 	eapol_sm_rx_eapol(wpa_s->eapol, wpa_s->bssid, buf,
 			  sizeof(*hdr) + 5);
 }
 
 
+static void send_eap_request_identity(void *eloop_ctx, void *timeout_ctx)
+{
+	struct wpa_supplicant *wpa_s = eloop_ctx;
+
+	printf("Sending fake EAP-Request-Identity\n");
+	eapol_test_rx_identity_request(wpa_s);
+}
+
+
 static void eapol_test_timeout(void *eloop_ctx, void *timeout_ctx)
 {
 	struct eapol_test_data *e = eloop_ctx;
@@ -710,7 +818,8 @@ static void ieee802_1x_decapsulate_radius(struct eapol_test_data *e)
 		break;
 	case EAP_CODE_FAILURE:
 		os_strlcpy(buf, "EAP Failure", sizeof(buf));
-		eloop_terminate();
+		if (e->load == NULL)
+			eloop_terminate();
 		break;
 	default:
 		os_strlcpy(buf, "unknown EAP code", sizeof(buf));
@@ -825,6 +934,9 @@ ieee802_1x_receive_auth(struct radius_msg *msg, struct radius_msg *req,
 	e->radius_identifier = -1;
 	wpa_printf(MSG_DEBUG, "RADIUS packet matching with station");
 
+	if (e->load)
+		eapol_test_load_round_done(e);
+
 	radius_msg_free(e->last_recv_radius);
 	e->last_recv_radius = msg;
 
@@ -841,6 +953,14 @@ ieee802_1x_receive_auth(struct radius_msg *msg, struct radius_msg *req,
 
 	ieee802_1x_decapsulate_radius(e);
 
+	if (e->load) {
+		/* Access-Reject without EAP-Message does not trigger the
+		 * EAPOL state machine callback */
+		if (hdr->code == RADIUS_CODE_ACCESS_REJECT)
+			eapol_test_load_auth_done(e, EAPOL_TEST_LOAD_REJECT);
+		return RADIUS_RX_QUEUED;
+	}
+
 	if ((hdr->code == RADIUS_CODE_ACCESS_ACCEPT &&
 	     e->eapol_test_num_reauths < 0) ||
 	    hdr->code == RADIUS_CODE_ACCESS_REJECT) {
@@ -857,7 +977,6 @@ static void wpa_init_conf(struct eapol_test_data *e,
 			  const char *cli_addr)
 {
 	struct hostapd_radius_server *as;
-	int res;
 
 	wpa_s->bssid[5] = 1;
 	os_memcpy(wpa_s->own_addr, e->own_addr, ETH_ALEN);
@@ -900,6 +1019,13 @@ static void wpa_init_conf(struct eapol_test_data *e,
 			assert(0);
 		}
 	}
+}
+
+
+static void eapol_test_radius_init(struct eapol_test_data *e,
+				   struct wpa_supplicant *wpa_s)
+{
+	int res;
 
 	e->radius = radius_client_init(wpa_s, e->radius_conf);
 	assert(e->radius != NULL);
@@ -910,6 +1036,314 @@ static void wpa_init_conf(struct eapol_test_data *e,
 }
 
 
+static void eapol_test_latency_add(struct eapol_test_latency *lat,
+				   struct os_reltime *start)
+{
+	struct os_reltime age;
+
+	if (lat->num == lat->alloc) {
+		size_t alloc = lat->alloc ? 2 * lat->alloc : 256;
+		unsigned int *n;
+
+		n = os_realloc_array(lat->usec, alloc, sizeof(unsigned int));
+		if (n == NULL)
+			return;
+		lat->usec = n;
+		lat->alloc = alloc;
+	}
+
+	os_reltime_age(start, &age);
+	lat->usec[lat->num++] = age.sec * 1000000 + age.usec;
+}
+
+
+static int eapol_test_latency_cmp(const void *a, const void *b)
+{
+	unsigned int ua = *(const unsigned int *) a;
+	unsigned int ub = *(const unsigned int *) b;
+
+	return ua < ub ? -1 : (ua > ub ? 1 : 0);
+}
+
+
+static double eapol_test_latency_pct(struct eapol_test_latency *lat,
+				     unsigned int pct)
+{
+	size_t idx;
+
+	idx = (lat->num * pct + 99) / 100;
+	if (idx > 0)
+		idx--;
+	return lat->usec[idx] / 1000.0;
+}
+
+
+static void eapol_test_latency_print(const char *title,
+				     struct eapol_test_latency *lat)
+{
+	if (lat->num == 0)
+		return;
+
+	qsort(lat->usec, lat->num, sizeof(unsigned int),
+	      eapol_test_latency_cmp);
+	printf("%-12s n=%-8lu p50=%9.3f p90=%9.3f p99=%9.3f max=%9.3f\n",
+	       title, (unsigned long) lat->num,
+	       eapol_test_latency_pct(lat, 50),
+	       eapol_test_latency_pct(lat, 90),
+	       eapol_test_latency_pct(lat, 99),
+	       eapol_test_latency_pct(lat, 100));
+}
+
+
+static void eapol_test_load_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct eapol_test_data *e = eloop_ctx;
+
+	/* Forget outstanding Access-Requests so that retransmissions of the
+	 * timed out authentication do not leak into the next one */
+	radius_client_flush(e->radius, 1);
+	eapol_test_load_auth_done(e, EAPOL_TEST_LOAD_TIMEOUT);
+}
+
+
+static void eapol_test_load_round_done(struct eapol_test_data *e)
+{
+	unsigned int round;
+
+	if (!e->load_active || e->load_round == 0)
+		return;
+
+	round = e->load_round - 1;
+	if (round >= EAPOL_TEST_LOAD_MAX_ROUNDS)
+		round = EAPOL_TEST_LOAD_MAX_ROUNDS - 1;
+	eapol_test_latency_add(&e->load->round_latency[round],
+			       &e->load_round_start);
+}
+
+
+static void eapol_test_load_check_done(struct eapol_test_load *l)
+{
+	if (l->arrivals_done && l->num_idle == l->num_sessions)
+		eloop_terminate();
+}
+
+
+static void eapol_test_load_auth_done(struct eapol_test_data *e,
+				      enum eapol_test_load_result res)
+{
+	struct eapol_test_load *l = e->load;
+
+	if (!e->load_active)
+		return;
+	e->load_active = 0;
+	eloop_cancel_timeout(eapol_test_load_timeout, e, NULL);
+
+	if (res == EAPOL_TEST_LOAD_SUCCESS) {
+		l->succeeded++;
+		eapol_test_latency_add(&l->auth_latency, &e->load_auth_start);
+	} else {
+		l->failures[res]++;
+	}
+
+	l->idle[l->num_idle++] = e - l->sessions;
+	eapol_test_load_check_done(l);
+}
+
+
+static void eapol_test_load_start_auth(struct eapol_test_load *l)
+{
+	struct eapol_test_data *e;
+	struct eapol_sm *eapol;
+
+	if (l->num_idle == 0) {
+		l->no_free_session++;
+		return;
+	}
+	e = &l->sessions[l->idle[--l->num_idle]];
+	eapol = e->wpa_s->eapol;
+
+	/* The RADIUS messages of the previous authentication may still be
+	 * referenced when it completes, so release them only here */
+	radius_msg_free(e->last_recv_radius);
+	e->last_recv_radius = NULL;
+	wpabuf_free(e->last_eap_radius);
+	e->last_eap_radius = NULL;
+	os_free(e->eap_identity);
+	e->eap_identity = NULL;
+	e->radius_access_accept_received = 0;
+	e->radius_access_reject_received = 0;
+	os_memset(e->authenticator_pmk, 0, sizeof(e->authenticator_pmk));
+	e->authenticator_pmk_len = 0;
+	e->load_round = 0;
+	e->load_active = 1;
+	l->started++;
+
+	os_get_reltime(&e->load_auth_start);
+	eloop_register_timeout(l->auth_timeout, 0, eapol_test_load_timeout,
+			       e, NULL);
+
+	/* Emulate a new association to start from a clean EAP state */
+	eapol_sm_notify_portEnabled(eapol, FALSE);
+	eapol_sm_notify_portEnabled(eapol, TRUE);
+	eapol_test_rx_identity_request(e->wpa_s);
+}
+
+
+static void eapol_test_load_arrival(void *eloop_ctx, void *timeout_ctx)
+{
+	struct eapol_test_load *l = eloop_ctx;
+	struct os_reltime age;
+	double elapsed, interval;
+	unsigned int due;
+
+	os_reltime_age(&l->start, &age);
+	elapsed = age.sec + age.usec / 1000000.0;
+	if (elapsed >= l->duration) {
+		l->arrivals_done = 1;
+		eapol_test_load_check_done(l);
+		return;
+	}
+
+	/* Open-loop arrivals: start every authentication that is due by now
+	 * regardless of how many earlier ones are still in progress */
+	due = (unsigned int) (elapsed * l->rate) + 1;
+	while (l->arrivals < due) {
+		l->arrivals++;
+		eapol_test_load_start_auth(l);
+	}
+
+	interval = 1.0 / l->rate;
+	if (interval < 0.001)
+		interval = 0.001;
+	eloop_register_timeout((unsigned int) interval,
+			       (unsigned int) (interval * 1000000) % 1000000,
+			       eapol_test_load_arrival, l, NULL);
+}
+
+
+static int eapol_test_load_init(struct eapol_test_load *l,
+				struct eapol_test_data *tmpl,
+				struct wpa_supplicant *tmpl_wpa_s)
+{
+	struct wpa_ssid *ssid = NULL;
+	unsigned int i, addr;
+
+	l->sessions = os_calloc(l->num_sessions, sizeof(*l->sessions));
+	l->wpa_s = os_calloc(l->num_sessions, sizeof(*l->wpa_s));
+	l->idle = os_calloc(l->num_sessions, sizeof(*l->idle));
+	if (l->sessions == NULL || l->wpa_s == NULL || l->idle == NULL) {
+		printf("Failed to allocate %u emulated supplicants\n",
+		       l->num_sessions);
+		return -1;
+	}
+
+	tmpl->radius_conf->msg_dumps = 0;
+	addr = WPA_GET_BE24(&tmpl_wpa_s->own_addr[3]);
+
+	for (i = 0; i < l->num_sessions; i++) {
+		struct eapol_test_data *e = &l->sessions[i];
+		struct wpa_supplicant *wpa_s = &l->wpa_s[i];
+
+		/* Network blocks are assigned to the emulated supplicants in
+		 * round-robin order to allow a mix of methods and
+		 * credentials */
+		ssid = ssid && ssid->next ? ssid->next : tmpl_wpa_s->conf->ssid;
+
+		wpa_s->global = tmpl_wpa_s->global;
+		wpa_s->conf = tmpl_wpa_s->conf;
+		dl_list_init(&wpa_s->bss);
+		dl_list_init(&wpa_s->bss_id);
+		os_memcpy(wpa_s->bssid, tmpl_wpa_s->bssid, ETH_ALEN);
+		os_memcpy(wpa_s->own_addr, tmpl_wpa_s->own_addr, ETH_ALEN);
+		WPA_PUT_BE24(&wpa_s->own_addr[3], (addr + i) & 0xffffff);
+		os_snprintf(wpa_s->ifname, sizeof(wpa_s->ifname), "test%u", i);
+
+		e->wpa_s = wpa_s;
+		e->load = l;
+		e->no_mppe_keys = tmpl->no_mppe_keys;
+		e->own_ip_addr = tmpl->own_ip_addr;
+		e->radius_conf = tmpl->radius_conf;
+		e->connect_info = tmpl->connect_info;
+		e->extra_attrs = tmpl->extra_attrs;
+
+		eapol_test_radius_init(e, wpa_s);
+		if (test_eapol(e, wpa_s, ssid))
+			return -1;
+
+		l->idle[l->num_idle++] = i;
+	}
+
+	return 0;
+}
+
+
+static void eapol_test_load_deinit(struct eapol_test_load *l)
+{
+	unsigned int i;
+
+	for (i = 0; l->sessions && i < l->num_sessions; i++) {
+		struct eapol_test_data *e = &l->sessions[i];
+
+		if (e->wpa_s == NULL)
+			continue;
+		eloop_cancel_timeout(eapol_test_load_timeout, e, NULL);
+		radius_client_deinit(e->radius);
+		radius_msg_free(e->last_recv_radius);
+		wpabuf_free(e->last_eap_radius);
+		os_free(e->eap_identity);
+		eapol_sm_deinit(e->wpa_s->eapol);
+	}
+	eloop_cancel_timeout(eapol_test_load_arrival, l, NULL);
+
+	os_free(l->auth_latency.usec);
+	for (i = 0; i < EAPOL_TEST_LOAD_MAX_ROUNDS; i++)
+		os_free(l->round_latency[i].usec);
+	os_free(l->sessions);
+	os_free(l->wpa_s);
+	os_free(l->idle);
+}
+
+
+static int eapol_test_load_report(struct eapol_test_load *l)
+{
+	struct os_reltime diff;
+	double elapsed;
+	unsigned int i, failed = 0;
+	char title[20];
+
+	os_reltime_sub(&l->end, &l->start, &diff);
+	elapsed = diff.sec + diff.usec / 1000000.0;
+	for (i = 0; i <= EAPOL_TEST_LOAD_SEND_ERROR; i++)
+		failed += l->failures[i];
+
+	printf("Load test: %u emulated supplicants, offered load %.2f "
+	       "authentications/s for %d s\n",
+	       l->num_sessions, l->rate, l->duration);
+	printf("Authentications: started %u  succeeded %u  failed %u  "
+	       "not started %u\n",
+	       l->started, l->succeeded, failed, l->no_free_session);
+	printf("Elapsed %.3f s: %.2f successful authentications/s\n",
+	       elapsed, elapsed > 0 ? l->succeeded / elapsed : 0.0);
+	printf("Failures: reject %u  eap-failure %u  timeout %u  "
+	       "pmk-mismatch %u  send-error %u  no-free-supplicant %u\n",
+	       l->failures[EAPOL_TEST_LOAD_REJECT],
+	       l->failures[EAPOL_TEST_LOAD_EAP_FAILURE],
+	       l->failures[EAPOL_TEST_LOAD_TIMEOUT],
+	       l->failures[EAPOL_TEST_LOAD_PMK_MISMATCH],
+	       l->failures[EAPOL_TEST_LOAD_SEND_ERROR],
+	       l->no_free_session);
+	printf("Latency (ms):\n");
+	eapol_test_latency_print("auth", &l->auth_latency);
+	for (i = 0; i < EAPOL_TEST_LOAD_MAX_ROUNDS; i++) {
+		os_snprintf(title, sizeof(title), "round %u%s", i + 1,
+			    i == EAPOL_TEST_LOAD_MAX_ROUNDS - 1 ? "+" : "");
+		eapol_test_latency_print(title, &l->round_latency[i]);
+	}
+
+	return failed || l->no_free_session || l->succeeded == 0 ? -1 : 0;
+}
+
+
 static int scard_test(void)
 {
 	struct scard_data *scard;
@@ -1100,7 +1534,7 @@ static void usage(void)
 	       "           [-r<count>] [-t<timeout>] [-C<Connect-Info>] \\\n"
 	       "           [-M<client MAC address>] [-o<server cert file] \\\n"
 	       "           [-N<attr spec>] \\\n"
-	       "           [-A<client IP>]\n"
+	       "           [-A<client IP>] [-l<count> [-R<rate>] [-D<seconds>]]\n"
 	       "eapol_test scard\n"
 	       "eapol_test sim <PIN> <num triplets> [debug]\n"
 	       "\n");
@@ -1118,7 +1552,8 @@ static void usage(void)
 	       "  -W = wait for a control interface monitor before starting\n"
 	       "  -S = save configuration after authentication\n"
 	       "  -n = no MPPE keys expected\n"
-	       "  -t<timeout> = sets timeout in seconds (default: 30 s)\n"
+	       "  -t<timeout> = sets timeout in seconds (default: 30 s; per\n"
+	       "                authentication in load test mode)\n"
 	       "  -C<Connect-Info> = RADIUS Connect-Info (default: "
 	       "CONNECT 11Mbps 802.11b)\n"
 	       "  -M<client MAC address> = Set own MAC address "
@@ -1137,7 +1572,14 @@ static void usage(void)
 	       "       When only attr_id is specified, NULL will be used as "
 	       "value.\n"
 	       "       Multiple attributes can be specified by using the "
-	       "option several times.\n");
+	       "option several times.\n"
+	       "  -l<count> = load test mode: run <count> emulated "
+	       "supplicants concurrently;\n"
+	       "              network blocks are assigned to them in "
+	       "round-robin order\n"
+	       "  -R<rate> = load test arrival rate in authentications per "
+	       "second (default: 10)\n"
+	       "  -D<seconds> = load test duration (default: 10 s)\n");
 }
 
 
@@ -1154,6 +1596,7 @@ int main(int argc, char *argv[])
 	int timeout = 30;
 	char *pos;
 	struct extra_radius_attr *p = NULL, *p1;
+	struct eapol_test_load load;
 
 	if (os_program_init())
 		return -1;
@@ -1161,6 +1604,9 @@ int main(int argc, char *argv[])
 	hostapd_logger_register_cb(hostapd_logger_cb);
 
 	os_memset(&eapol_test, 0, sizeof(eapol_test));
+	os_memset(&load, 0, sizeof(load));
+	load.rate = 10;
+	load.duration = 10;
 	eapol_test.connect_info = "CONNECT 11Mbps 802.11b";
 	os_memcpy(eapol_test.own_addr, "\x02\x00\x00\x00\x00\x01", ETH_ALEN);
 
@@ -1168,7 +1614,7 @@ int main(int argc, char *argv[])
 	wpa_debug_show_keys = 1;
 
 	for (;;) {
-		c = getopt(argc, argv, "a:A:c:C:M:nN:o:p:r:s:St:W");
+		c = getopt(argc, argv, "a:A:c:C:D:l:M:nN:o:p:r:R:s:St:W");
 		if (c < 0)
 			break;
 		switch (c) {
@@ -1184,6 +1630,12 @@ int main(int argc, char *argv[])
 		case 'C':
 			eapol_test.connect_info = optarg;
 			break;
+		case 'D':
+			load.duration = atoi(optarg);
+			break;
+		case 'l':
+			load.num_sessions = atoi(optarg);
+			break;
 		case 'M':
 			if (hwaddr_aton(optarg, eapol_test.own_addr)) {
 				usage();
@@ -1209,6 +1661,9 @@ int main(int argc, char *argv[])
 		case 'r':
 			eapol_test.eapol_test_num_reauths = atoi(optarg);
 			break;
+		case 'R':
+			load.rate = atof(optarg);
+			break;
 		case 's':
 			as_secret = optarg;
 			break;
@@ -1270,6 +1725,23 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	if (load.num_sessions > 0) {
+		if (load.rate <= 0 || load.duration <= 0 || timeout <= 0) {
+			usage();
+			printf("Invalid load test parameters.\n");
+			return -1;
+		}
+		if (eapol_test.eapol_test_num_reauths) {
+			usage();
+			printf("Reauthentication (-r) is not supported in load "
+			       "test mode.\n");
+			return -1;
+		}
+		load.auth_timeout = timeout;
+		/* Per-message debug output would dominate the load test */
+		wpa_debug_level = MSG_WARNING;
+	}
+
 	if (eap_register_methods()) {
 		wpa_printf(MSG_ERROR, "Failed to register EAP methods");
 		return -1;
@@ -1313,8 +1785,14 @@ int main(int argc, char *argv[])
 	if (wpa_supplicant_scard_init(&wpa_s, wpa_s.conf->ssid))
 		return -1;
 
-	if (test_eapol(&eapol_test, &wpa_s, wpa_s.conf->ssid))
-		return -1;
+	if (load.num_sessions > 0) {
+		if (eapol_test_load_init(&load, &eapol_test, &wpa_s) < 0)
+			return -1;
+	} else {
+		eapol_test_radius_init(&eapol_test, &wpa_s);
+		if (test_eapol(&eapol_test, &wpa_s, wpa_s.conf->ssid))
+			return -1;
+	}
 
 	if (wpas_init_ext_pw(&wpa_s) < 0)
 		return -1;
@@ -1322,23 +1800,36 @@ int main(int argc, char *argv[])
 	if (wait_for_monitor)
 		wpa_supplicant_ctrl_iface_wait(wpa_s.ctrl_iface);
 
-	eloop_register_timeout(timeout, 0, eapol_test_timeout, &eapol_test,
-			       NULL);
-	eloop_register_timeout(0, 0, send_eap_request_identity, &wpa_s, NULL);
+	if (load.num_sessions > 0) {
+		os_get_reltime(&load.start);
+		eloop_register_timeout(0, 0, eapol_test_load_arrival, &load,
+				       NULL);
+	} else {
+		eloop_register_timeout(timeout, 0, eapol_test_timeout,
+				       &eapol_test, NULL);
+		eloop_register_timeout(0, 0, send_eap_request_identity, &wpa_s,
+				       NULL);
+	}
 	eloop_register_signal_terminate(eapol_test_terminate, &wpa_s);
 	eloop_register_signal_reconfig(eapol_test_terminate, &wpa_s);
 	eloop_run();
 
-	eloop_cancel_timeout(eapol_test_timeout, &eapol_test, NULL);
-	eloop_cancel_timeout(eapol_sm_reauth, &eapol_test, NULL);
+	if (load.num_sessions > 0) {
+		os_get_reltime(&load.end);
+		ret = eapol_test_load_report(&load);
+		eapol_test_load_deinit(&load);
+	} else {
+		eloop_cancel_timeout(eapol_test_timeout, &eapol_test, NULL);
+		eloop_cancel_timeout(eapol_sm_reauth, &eapol_test, NULL);
 
-	if (eapol_test_compare_pmk(&eapol_test) == 0 ||
-	    eapol_test.no_mppe_keys)
-		ret = 0;
-	if (eapol_test.auth_timed_out)
-		ret = -2;
-	if (eapol_test.radius_access_reject_received)
-		ret = -3;
+		if (eapol_test_compare_pmk(&eapol_test) == 0 ||
+		    eapol_test.no_mppe_keys)
+			ret = 0;
+		if (eapol_test.auth_timed_out)
+			ret = -2;
+		if (eapol_test.radius_access_reject_received)
+			ret = -3;
+	}
 
 	if (save_config)
 		wpa_config_write(conf, wpa_s.conf);
@@ -1355,10 +1846,12 @@ int main(int argc, char *argv[])
 	if (eapol_test.server_cert_file)
 		fclose(eapol_test.server_cert_file);
 
-	printf("MPPE keys OK: %d  mismatch: %d\n",
-	       eapol_test.num_mppe_ok, eapol_test.num_mppe_mismatch);
-	if (eapol_test.num_mppe_mismatch)
-		ret = -4;
+	if (load.num_sessions == 0) {
+		printf("MPPE keys OK: %d  mismatch: %d\n",
+		       eapol_test.num_mppe_ok, eapol_test.num_mppe_mismatch);
+		if (eapol_test.num_mppe_mismatch)
+			ret = -4;
+	}
 	if (ret)
 		printf("FAILURE\n");
 	else
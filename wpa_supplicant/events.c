@@ -39,6 +39,7 @@
 #include "p2p_supplicant.h"
 #include "bgscan.h"
 #include "autoscan.h"
+#include "scan_history.h"
 #include "ap.h"
 #include "bss.h"
 #include "scan.h"
@@ -748,6 +749,18 @@ static struct wpa_ssid * wpa_scan_res_match(struct wpa_supplicant *wpa_s,
 	const u8 *ie;
 	struct wpa_ssid *ssid;
 	int osen;
+	struct wpa_ssid_index_iter iter;
+
+	if (only_first_ssid) {
+		iter.index = NULL;
+	} else if (wpa_config_ssid_iter_init(wpa_s->conf, &iter,
+					     group->priority, bss->ssid,
+					     bss->ssid_len) == 0) {
+		/* Only go through the networks that may match the SSID */
+		group = wpa_config_ssid_iter_next(&iter);
+		if (group == NULL)
+			return NULL;
+	}
 
 	ie = wpa_bss_get_vendor_ie(bss, WPA_IE_VENDOR_TYPE);
 	wpa_ie_len = ie ? ie[1] : 0;
@@ -806,7 +819,10 @@ static struct wpa_ssid * wpa_scan_res_match(struct wpa_supplicant *wpa_s,
 
 	wpa = wpa_ie_len > 0 || rsn_ie_len > 0;
 
-	for (ssid = group; ssid; ssid = only_first_ssid ? NULL : ssid->pnext) {
+	for (ssid = group; ssid;
+	     ssid = only_first_ssid ? NULL :
+		     (iter.index ? wpa_config_ssid_iter_next(&iter) :
+		      ssid->pnext)) {
 		int check_ssid = wpa ? 1 : (ssid->ssid_len != 0);
 		int res;
 
@@ -1253,6 +1269,24 @@ static int wpa_supplicant_need_to_roam(struct wpa_supplicant *wpa_s,
 }
 
 
+/*
+ * Whether the scan results are needed as a full set (struct wpa_scan_results)
+ * instead of being streamed directly into the BSS table.
+ */
+static int wpas_scan_res_needed(struct wpa_supplicant *wpa_s, int own_request)
+{
+	if (!wpa_s->driver->get_scan_results_cb)
+		return 1;
+	if (own_request && wpa_s->scan_res_handler)
+		return 1;
+	if (wpa_s->autoscan && wpa_s->autoscan_priv)
+		return 1;
+	if (wpa_s->bgscan && wpa_s->bgscan_priv)
+		return 1;
+	return 0;
+}
+
+
 /* Return != 0 if no scan results could be fetched or if scan results should not
  * be shared with other virtual interfaces. */
 static int _wpa_supplicant_event_scan_results(struct wpa_supplicant *wpa_s,
@@ -1262,6 +1296,7 @@ static int _wpa_supplicant_event_scan_results(struct wpa_supplicant *wpa_s,
 	struct wpa_scan_results *scan_res = NULL;
 	int ret = 0;
 	int ap = 0;
+	int failed;
 #ifndef CONFIG_NO_RANDOM_POOL
 	size_t i, num;
 #endif /* CONFIG_NO_RANDOM_POOL */
@@ -1273,10 +1308,15 @@ static int _wpa_supplicant_event_scan_results(struct wpa_supplicant *wpa_s,
 
 	wpa_supplicant_notify_scanning(wpa_s, 0);
 
-	scan_res = wpa_supplicant_get_scan_results(wpa_s,
-						   data ? &data->scan_info :
-						   NULL, 1);
-	if (scan_res == NULL) {
+	if (wpas_scan_res_needed(wpa_s, own_request)) {
+		scan_res = wpa_supplicant_get_scan_results(
+			wpa_s, data ? &data->scan_info : NULL, 1);
+		failed = scan_res == NULL;
+	} else {
+		failed = wpa_supplicant_stream_scan_results(
+			wpa_s, data ? &data->scan_info : NULL, 1) < 0;
+	}
+	if (failed) {
 		if (wpa_s->conf->ap_scan == 2 || ap ||
 		    wpa_s->scan_res_handler == scan_only_handler)
 			return -1;
@@ -1290,7 +1330,8 @@ static int _wpa_supplicant_event_scan_results(struct wpa_supplicant *wpa_s,
 	}
 
 #ifndef CONFIG_NO_RANDOM_POOL
-	num = scan_res->num;
+	/* Streamed scan results were already added to the pool */
+	num = scan_res ? scan_res->num : 0;
 	if (num > 10)
 		num = 10;
 	for (i = 0; i < num; i++) {
@@ -1336,6 +1377,7 @@ static int _wpa_supplicant_event_scan_results(struct wpa_supplicant *wpa_s,
 	} else {
 		wpa_msg_ctrl(wpa_s, MSG_INFO, WPA_EVENT_SCAN_RESULTS);
 	}
+	scan_history_scan_results(wpa_s);
 	wpas_notify_scan_results(wpa_s);
 
 	wpas_notify_scan_done(wpa_s, 1);
@@ -1394,6 +1436,8 @@ static int wpas_select_network_from_last_scan(struct wpa_supplicant *wpa_s,
 	struct wpa_ssid *ssid = NULL;
 
 	selected = wpa_supplicant_pick_network(wpa_s, &ssid);
+	if (new_scan && own_request)
+		scan_history_scan_done(wpa_s, selected);
 
 	if (selected) {
 		int skip;
@@ -17,6 +17,7 @@
 #include "common/wpa_ctrl.h"
 #include "rsn_supp/wpa.h"
 #include "wpa_supplicant_i.h"
+#include "config.h"
 #include "driver_i.h"
 #include "offchannel.h"
 #include "gas_query.h"
@@ -36,7 +37,9 @@ struct gas_query_pending {
 	u8 dialog_token;
 	u8 next_frag_id;
 	unsigned int wait_comeback:1;
-	unsigned int offchannel_tx_started:1;
+	unsigned int active:1; /* started within struct gas_query::work */
+	unsigned int req_sent:1;
+	unsigned int tx_pending:1; /* waiting for an earlier frame TX */
 	int freq;
 	u16 status_code;
 	struct wpabuf *req;
@@ -52,17 +55,29 @@ struct gas_query_pending {
 
 /**
  * struct gas_query - Internal GAS query data
+ *
+ * Queries to the same channel that are next to each other in the radio work
+ * queue are run within a single radio work, so that up to gas_max_parallel
+ * queries can wait for responses at the same time. Only one Action frame is
+ * transmitted at a time (current); the other queries wait with tx_pending set
+ * until the TX status of the previous frame has been received.
  */
 struct gas_query {
 	struct wpa_supplicant *wpa_s;
 	struct dl_list pending; /* struct gas_query_pending */
-	struct gas_query_pending *current;
+	struct gas_query_pending *current; /* Action frame TX in progress */
 	struct wpa_radio_work *work;
+	int work_freq;
+	unsigned int num_active; /* queries started within work */
+	unsigned int offchannel_tx_started:1;
 };
 
 
 static void gas_query_tx_comeback_timeout(void *eloop_data, void *user_ctx);
 static void gas_query_timeout(void *eloop_data, void *user_ctx);
+static void gas_query_start_cb(struct wpa_radio_work *work, int deinit);
+static void gas_query_tx_next(struct gas_query *gas);
+static void gas_query_tx_next_timeout(void *eloop_data, void *user_ctx);
 
 
 static int ms_from_time(struct os_reltime *last)
@@ -118,16 +133,63 @@ static const char * gas_result_txt(enum gas_query_result result)
 }
 
 
+static unsigned int gas_query_max_parallel(struct gas_query *gas)
+{
+	struct wpa_config *conf = gas->wpa_s->conf;
+
+	if (conf == NULL || conf->gas_max_parallel < 1)
+		return 1;
+	return conf->gas_max_parallel;
+}
+
+
+static struct gas_query_pending * gas_query_first_active(struct gas_query *gas)
+{
+	struct gas_query_pending *q;
+
+	dl_list_for_each(q, &gas->pending, struct gas_query_pending, list) {
+		if (q->active)
+			return q;
+	}
+	return NULL;
+}
+
+
+/* Find the radio work that has not yet been started for a query */
+static struct wpa_radio_work * gas_query_queued_work(struct gas_query *gas,
+						     struct gas_query_pending *q)
+{
+	struct wpa_radio_work *work;
+
+	dl_list_for_each(work, &gas->wpa_s->radio->work, struct wpa_radio_work,
+			 list) {
+		if (!work->started && work->cb == gas_query_start_cb &&
+		    work->ctx == q)
+			return work;
+	}
+	return NULL;
+}
+
+
 static void gas_query_free(struct gas_query_pending *query, int del_list)
 {
 	struct gas_query *gas = query->gas;
+	struct wpa_radio_work *work;
 
 	if (del_list)
 		dl_list_del(&query->list);
 
-	if (gas->work && gas->work->ctx == query) {
-		radio_work_done(gas->work);
-		gas->work = NULL;
+	if (query->active) {
+		query->active = 0;
+		gas->num_active--;
+		if (gas->work && gas->work->ctx == query)
+			gas->work->ctx = gas_query_first_active(gas);
+	} else {
+		work = gas_query_queued_work(gas, query);
+		if (work) {
+			work->ctx = NULL;
+			radio_work_done(work);
+		}
 	}
 
 	wpabuf_free(query->req);
@@ -137,6 +199,80 @@ static void gas_query_free(struct gas_query_pending *query, int del_list)
 }
 
 
+/*
+ * Move the queries to the same channel that are next in the radio work queue
+ * into the ongoing radio work, so that they do not need to wait for the
+ * previous queries to complete. No more queries are added once a higher
+ * priority radio work is waiting, so that the radio work can complete.
+ */
+static void gas_query_join(struct gas_query *gas)
+{
+	struct wpa_radio_work *work, *tmp;
+	struct gas_query_pending *query;
+
+	if (gas->work == NULL || radio_work_preempt_pending(gas->work))
+		return;
+
+	dl_list_for_each_safe(work, tmp, &gas->wpa_s->radio->work,
+			      struct wpa_radio_work, list) {
+		if (work == gas->work)
+			continue;
+		if (gas->num_active >= gas_query_max_parallel(gas) ||
+		    work->started || work->cb != gas_query_start_cb ||
+		    work->wpa_s != gas->wpa_s)
+			break;
+		query = work->ctx;
+		if (query == NULL || query->freq != gas->work_freq)
+			break;
+
+		wpa_printf(MSG_DEBUG, "GAS: Run query to " MACSTR
+			   " dialog_token=%u in parallel on %d MHz",
+			   MAC2STR(query->addr), query->dialog_token,
+			   query->freq);
+		work->ctx = NULL;
+		radio_work_merged(gas->wpa_s, work->type);
+		radio_work_done(work);
+		query->active = 1;
+		query->tx_pending = 1;
+		gas->num_active++;
+	}
+}
+
+
+/* Do not send any more frames for the queries that are being removed */
+static void gas_query_clear_tx_pending(struct gas_query *gas)
+{
+	struct gas_query_pending *q;
+
+	dl_list_for_each(q, &gas->pending, struct gas_query_pending, list)
+		q->tx_pending = 0;
+}
+
+
+/*
+ * Join more queries to the radio work and complete it once none of the queries
+ * started within it remains.
+ */
+static void gas_query_work_check(struct gas_query *gas)
+{
+	gas_query_join(gas);
+
+	if (gas->num_active > 0) {
+		gas_query_tx_next(gas);
+		return;
+	}
+
+	if (gas->offchannel_tx_started) {
+		gas->offchannel_tx_started = 0;
+		offchannel_send_action_done(gas->wpa_s);
+	}
+	if (gas->work) {
+		radio_work_done(gas->work);
+		gas->work = NULL;
+	}
+}
+
+
 static void gas_query_done(struct gas_query *gas,
 			   struct gas_query_pending *query,
 			   enum gas_query_result result)
@@ -147,14 +283,13 @@ static void gas_query_done(struct gas_query *gas,
 		query->status_code, gas_result_txt(result));
 	if (gas->current == query)
 		gas->current = NULL;
-	if (query->offchannel_tx_started)
-		offchannel_send_action_done(gas->wpa_s);
 	eloop_cancel_timeout(gas_query_tx_comeback_timeout, gas, query);
 	eloop_cancel_timeout(gas_query_timeout, gas, query);
 	dl_list_del(&query->list);
 	query->cb(query->ctx, query->addr, query->dialog_token, result,
 		  query->adv_proto, query->resp, query->status_code);
 	gas_query_free(query, 0);
+	gas_query_work_check(gas);
 }
 
 
@@ -169,6 +304,13 @@ void gas_query_deinit(struct gas_query *gas)
 	if (gas == NULL)
 		return;
 
+	eloop_cancel_timeout(gas_query_tx_next_timeout, gas, NULL);
+	if (gas->work) {
+		radio_work_done(gas->work);
+		gas->work = NULL;
+	}
+	gas_query_clear_tx_pending(gas);
+
 	dl_list_for_each_safe(query, next, &gas->pending,
 			      struct gas_query_pending, list)
 		gas_query_done(gas, query, GAS_QUERY_DELETED_AT_DEINIT);
@@ -240,6 +382,9 @@ static void gas_query_tx_status(struct wpa_supplicant *wpa_s,
 		eloop_cancel_timeout(gas_query_timeout, gas, query);
 		eloop_register_timeout(0, 0, gas_query_timeout, gas, query);
 	}
+
+	gas->current = NULL;
+	gas_query_tx_next(gas);
 }
 
 
@@ -270,17 +415,59 @@ static int gas_query_tx(struct gas_query *gas, struct gas_query_pending *query,
 				     gas->wpa_s->own_addr, query->addr,
 				     wpabuf_head(req), wpabuf_len(req), 1000,
 				     gas_query_tx_status, 0);
-	if (res == 0)
-		query->offchannel_tx_started = 1;
+	if (res == 0) {
+		gas->offchannel_tx_started = 1;
+		gas->current = query;
+	}
 	return res;
 }
 
 
+static int gas_query_tx_busy(struct gas_query *gas,
+			     struct gas_query_pending *query)
+{
+	if (gas->current == NULL || gas->current == query) {
+		query->tx_pending = 0;
+		return 0;
+	}
+
+	wpa_printf(MSG_DEBUG, "GAS: Delay frame to " MACSTR
+		   " dialog_token=%u until the previous TX has completed",
+		   MAC2STR(query->addr), query->dialog_token);
+	query->tx_pending = 1;
+	return 1;
+}
+
+
+static int gas_query_tx_initial_req(struct gas_query *gas,
+				    struct gas_query_pending *query)
+{
+	if (gas_query_tx_busy(gas, query))
+		return 0;
+
+	if (gas_query_tx(gas, query, query->req) < 0) {
+		wpa_printf(MSG_DEBUG, "GAS: Failed to send Action frame to "
+			   MACSTR, MAC2STR(query->addr));
+		return -1;
+	}
+	query->req_sent = 1;
+
+	wpa_printf(MSG_DEBUG, "GAS: Starting query timeout for dialog token %u",
+		   query->dialog_token);
+	eloop_register_timeout(GAS_QUERY_TIMEOUT_PERIOD, 0,
+			       gas_query_timeout, gas, query);
+	return 0;
+}
+
+
 static void gas_query_tx_comeback_req(struct gas_query *gas,
 				      struct gas_query_pending *query)
 {
 	struct wpabuf *req;
 
+	if (gas_query_tx_busy(gas, query))
+		return;
+
 	req = gas_build_comeback_req(query->dialog_token);
 	if (req == NULL) {
 		gas_query_done(gas, query, GAS_QUERY_INTERNAL_ERROR);
@@ -297,6 +484,39 @@ static void gas_query_tx_comeback_req(struct gas_query *gas,
 }
 
 
+static void gas_query_tx_next(struct gas_query *gas)
+{
+	struct gas_query_pending *query;
+	int found;
+
+	while (gas->current == NULL) {
+		found = 0;
+		dl_list_for_each(query, &gas->pending,
+				 struct gas_query_pending, list) {
+			if (query->active && query->tx_pending) {
+				found = 1;
+				break;
+			}
+		}
+		if (!found)
+			return;
+
+		if (query->req_sent)
+			gas_query_tx_comeback_req(gas, query);
+		else if (gas_query_tx_initial_req(gas, query) < 0)
+			gas_query_done(gas, query, GAS_QUERY_INTERNAL_ERROR);
+	}
+}
+
+
+static void gas_query_tx_next_timeout(void *eloop_data, void *user_ctx)
+{
+	struct gas_query *gas = eloop_data;
+
+	gas_query_tx_next(gas);
+}
+
+
 static void gas_query_tx_comeback_timeout(void *eloop_data, void *user_ctx)
 {
 	struct gas_query *gas = eloop_data;
@@ -591,34 +811,38 @@ static int gas_query_dialog_token_available(struct gas_query *gas,
 static void gas_query_start_cb(struct wpa_radio_work *work, int deinit)
 {
 	struct gas_query_pending *query = work->ctx;
-	struct gas_query *gas = query->gas;
+	struct gas_query *gas;
+
+	if (query == NULL)
+		return;
+	gas = query->gas;
 
 	if (deinit) {
 		if (work->started) {
 			gas->work = NULL;
-			gas_query_done(gas, query, GAS_QUERY_DELETED_AT_DEINIT);
+			gas_query_clear_tx_pending(gas);
+			while ((query = gas_query_first_active(gas)))
+				gas_query_done(gas, query,
+					       GAS_QUERY_DELETED_AT_DEINIT);
 			return;
 		}
 
+		work->ctx = NULL;
 		gas_query_free(query, 1);
 		return;
 	}
 
 	gas->work = work;
+	gas->work_freq = query->freq;
+	query->active = 1;
+	gas->num_active++;
 
-	if (gas_query_tx(gas, query, query->req) < 0) {
-		wpa_printf(MSG_DEBUG, "GAS: Failed to send Action frame to "
-			   MACSTR, MAC2STR(query->addr));
-		gas_query_free(query, 1);
+	if (gas_query_tx_initial_req(gas, query) < 0) {
+		gas_query_done(gas, query, GAS_QUERY_INTERNAL_ERROR);
 		return;
 	}
-	gas->current = query;
-
-	wpa_printf(MSG_DEBUG, "GAS: Starting query timeout for dialog token %u",
-		   query->dialog_token);
-	eloop_register_timeout(GAS_QUERY_TIMEOUT_PERIOD, 0,
-			       gas_query_timeout, gas, query);
 
+	gas_query_work_check(gas);
 }
 
 
@@ -677,12 +901,24 @@ int gas_query_req(struct gas_query *gas, const u8 *dst, int freq,
 		" dialog_token=%u freq=%d",
 		MAC2STR(query->addr), query->dialog_token, query->freq);
 
-	if (radio_add_work(gas->wpa_s, freq, "gas-query", 0, gas_query_start_cb,
+	if (radio_add_work(gas->wpa_s, freq, "gas-query",
+			   RADIO_WORK_PRIO_BACKGROUND, 0, gas_query_start_cb,
 			   query) < 0) {
 		gas_query_free(query, 1);
 		return -1;
 	}
 
+	if (gas->work) {
+		/*
+		 * Send the frame from eloop to avoid calling the result
+		 * callback before the caller has seen the dialog token.
+		 */
+		gas_query_join(gas);
+		eloop_cancel_timeout(gas_query_tx_next_timeout, gas, NULL);
+		eloop_register_timeout(0, 0, gas_query_tx_next_timeout, gas,
+				       NULL);
+	}
+
 	return dialog_token;
 }
 
@@ -30,6 +30,7 @@
 #include "gas_query.h"
 #include "hs20_supplicant.h"
 #include "interworking.h"
+#include "anqp_cache.h"
 
 
 #if defined(EAP_SIM) | defined(EAP_SIM_DYNAMIC)
@@ -44,6 +45,18 @@
 #endif
 #endif
 
+/**
+ * struct interworking_anqp_query - ANQP query in progress during ANQP fetch
+ * @bss_id: Unique identifier of the BSS entry the query was sent for
+ * @bssid: BSSID of the queried AP
+ * @dialog_token: GAS dialog token of the query
+ */
+struct interworking_anqp_query {
+	unsigned int bss_id;
+	u8 bssid[ETH_ALEN];
+	u8 dialog_token;
+};
+
 static void interworking_next_anqp_fetch(struct wpa_supplicant *wpa_s);
 static struct wpa_cred * interworking_credentials_available_realm(
 	struct wpa_supplicant *wpa_s, struct wpa_bss *bss, int ignore_bw,
@@ -112,6 +125,32 @@ static struct wpabuf * anqp_build_req(u16 info_ids[], size_t num_ids,
 }
 
 
+static void interworking_anqp_query_done(struct wpa_supplicant *wpa_s,
+					 const u8 *dst, u8 dialog_token)
+{
+	struct interworking_anqp_query *q;
+	unsigned int i;
+
+	for (i = 0; i < wpa_s->num_anqp_queries; i++) {
+		q = &wpa_s->anqp_queries[i];
+		if (q->dialog_token != dialog_token ||
+		    os_memcmp(q->bssid, dst, ETH_ALEN) != 0)
+			continue;
+		wpa_s->interworking_gas_bss = wpa_bss_get_id(wpa_s, q->bss_id);
+		os_memmove(q, q + 1, (wpa_s->num_anqp_queries - i - 1) *
+			   sizeof(*q));
+		wpa_s->num_anqp_queries--;
+		if (wpa_s->num_anqp_queries == 0) {
+			os_free(wpa_s->anqp_queries);
+			wpa_s->anqp_queries = NULL;
+		}
+		return;
+	}
+
+	wpa_s->interworking_gas_bss = NULL;
+}
+
+
 static void interworking_anqp_resp_cb(void *ctx, const u8 *dst,
 				      u8 dialog_token,
 				      enum gas_query_result result,
@@ -124,8 +163,14 @@ static void interworking_anqp_resp_cb(void *ctx, const u8 *dst,
 	wpa_printf(MSG_DEBUG, "ANQP: Response callback dst=" MACSTR
 		   " dialog_token=%u result=%d status_code=%u",
 		   MAC2STR(dst), dialog_token, result, status_code);
+	interworking_anqp_query_done(wpa_s, dst, dialog_token);
 	anqp_resp_cb(wpa_s, dst, dialog_token, result, adv_proto, resp,
 		     status_code);
+	if (result == GAS_QUERY_DELETED_AT_DEINIT)
+		return;
+	if (result == GAS_QUERY_SUCCESS && wpa_s->interworking_gas_bss)
+		anqp_cache_store(wpa_s, wpa_s->interworking_gas_bss,
+				 wpa_s->fetch_all_anqp);
 	interworking_next_anqp_fetch(wpa_s);
 }
 
@@ -226,13 +271,6 @@ static int additional_roaming_consortiums(struct wpa_bss *bss)
 }
 
 
-static void interworking_continue_anqp(void *eloop_ctx, void *sock_ctx)
-{
-	struct wpa_supplicant *wpa_s = eloop_ctx;
-	interworking_next_anqp_fetch(wpa_s);
-}
-
-
 static int interworking_anqp_send_req(struct wpa_supplicant *wpa_s,
 				      struct wpa_bss *bss)
 {
@@ -243,10 +281,10 @@ static int interworking_anqp_send_req(struct wpa_supplicant *wpa_s,
 	size_t num_info_ids = 0;
 	struct wpabuf *extra = NULL;
 	int all = wpa_s->fetch_all_anqp;
+	struct interworking_anqp_query *q;
 
 	wpa_printf(MSG_DEBUG, "Interworking: ANQP Query Request to " MACSTR,
 		   MAC2STR(bss->bssid));
-	wpa_s->interworking_gas_bss = bss;
 
 	info_ids[num_info_ids++] = ANQP_CAPABILITY_LIST;
 	if (all) {
@@ -296,6 +334,14 @@ static int interworking_anqp_send_req(struct wpa_supplicant *wpa_s,
 	}
 #endif /* CONFIG_HS20 */
 
+	q = os_realloc_array(wpa_s->anqp_queries, wpa_s->num_anqp_queries + 1,
+			     sizeof(*q));
+	if (q == NULL) {
+		wpabuf_free(extra);
+		return -1;
+	}
+	wpa_s->anqp_queries = q;
+
 	buf = anqp_build_req(info_ids, num_info_ids, extra);
 	wpabuf_free(extra);
 	if (buf == NULL)
@@ -307,11 +353,14 @@ static int interworking_anqp_send_req(struct wpa_supplicant *wpa_s,
 		wpa_printf(MSG_DEBUG, "ANQP: Failed to send Query Request");
 		wpabuf_free(buf);
 		ret = -1;
-		eloop_register_timeout(0, 0, interworking_continue_anqp, wpa_s,
-				       NULL);
-	} else
+	} else {
 		wpa_printf(MSG_DEBUG, "ANQP: Query started with dialog token "
 			   "%u", res);
+		q = &wpa_s->anqp_queries[wpa_s->num_anqp_queries++];
+		q->bss_id = bss->id;
+		os_memcpy(q->bssid, bss->bssid, ETH_ALEN);
+		q->dialog_token = res;
+	}
 
 	return ret;
 }
@@ -2384,14 +2433,48 @@ static void interworking_select_network(struct wpa_supplicant *wpa_s)
 }
 
 
+int interworking_anqp_domain_id(struct wpa_bss *bss)
+{
+	const u8 *ie, *pos;
+
+	ie = wpa_bss_get_vendor_ie(bss, HS20_IE_VENDOR_TYPE);
+	if (ie == NULL || ie[1] < 5 || !(ie[6] & HS20_ANQP_DOMAIN_ID_PRESENT))
+		return -1;
+	pos = ie + 7;
+	if (ie[6] & HS20_PPS_MO_ID_PRESENT)
+		pos += 2;
+	if (pos + 2 > ie + 2 + ie[1])
+		return -1;
+	return WPA_GET_LE16(pos);
+}
+
+
+/*
+ * BSSes of the same homogenous ESS or with the same nonzero ANQP Domain ID
+ * advertise the same ANQP information.
+ */
+static int interworking_same_anqp_info(struct wpa_bss *a, struct wpa_bss *b)
+{
+	int domain_id;
+
+	if (a->ssid_len != b->ssid_len ||
+	    os_memcmp(a->ssid, b->ssid, a->ssid_len) != 0 ||
+	    os_memcmp(a->hessid, b->hessid, ETH_ALEN) != 0)
+		return 0;
+	domain_id = interworking_anqp_domain_id(a);
+	if (domain_id != interworking_anqp_domain_id(b))
+		return 0;
+	if (!is_zero_ether_addr(a->hessid))
+		return 1;
+	return domain_id > 0;
+}
+
+
 static struct wpa_bss_anqp *
 interworking_match_anqp_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
 {
 	struct wpa_bss *other;
 
-	if (is_zero_ether_addr(bss->hessid))
-		return NULL; /* Cannot be in the same homegenous ESS */
-
 	dl_list_for_each(other, &wpa_s->bss, struct wpa_bss, list) {
 		if (other == bss)
 			continue;
@@ -2404,10 +2487,7 @@ interworking_match_anqp_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
 			continue;
 		if (!(other->flags & WPA_BSS_ANQP_FETCH_TRIED))
 			continue;
-		if (os_memcmp(bss->hessid, other->hessid, ETH_ALEN) != 0)
-			continue;
-		if (bss->ssid_len != other->ssid_len ||
-		    os_memcmp(bss->ssid, other->ssid, bss->ssid_len) != 0)
+		if (!interworking_same_anqp_info(bss, other))
 			continue;
 
 		wpa_printf(MSG_DEBUG, "Interworking: Share ANQP data with "
@@ -2421,11 +2501,80 @@ interworking_match_anqp_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
 }
 
 
+/* Check whether a query for the same ANQP information is still in progress */
+static int interworking_anqp_query_pending(struct wpa_supplicant *wpa_s,
+					   struct wpa_bss *bss)
+{
+	struct wpa_bss *other;
+	unsigned int i;
+
+	for (i = 0; i < wpa_s->num_anqp_queries; i++) {
+		if (wpa_s->anqp_queries[i].bss_id == bss->id)
+			return 1;
+		other = wpa_bss_get_id(wpa_s, wpa_s->anqp_queries[i].bss_id);
+		if (other && interworking_same_anqp_info(bss, other))
+			return 1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Select the next BSS to query. BSSes on the channel of the previous query
+ * are preferred so that the queries can share the off-channel operation.
+ */
+static struct wpa_bss * interworking_next_anqp_bss(struct wpa_supplicant *wpa_s)
+{
+	struct wpa_bss *bss, *selected = NULL;
+	const u8 *ie;
+
+	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+		if (!(bss->caps & IEEE80211_CAP_ESS))
+			continue;
+		ie = wpa_bss_get_ie(bss, WLAN_EID_EXT_CAPAB);
+		if (ie == NULL || ie[1] < 4 || !(ie[5] & 0x80))
+			continue; /* AP does not support Interworking */
+		if (disallowed_bssid(wpa_s, bss->bssid) ||
+		    disallowed_ssid(wpa_s, bss->ssid, bss->ssid_len))
+			continue; /* Disallowed BSS */
+		if (bss->flags & WPA_BSS_ANQP_FETCH_TRIED)
+			continue;
+
+		if (bss->anqp == NULL) {
+			bss->anqp = interworking_match_anqp_info(wpa_s, bss);
+			if (bss->anqp) {
+				/* Shared data already fetched */
+				bss->flags |= WPA_BSS_ANQP_FETCH_TRIED;
+				wpa_s->anqp_fetch_shared++;
+				continue;
+			}
+		}
+		if (interworking_anqp_query_pending(wpa_s, bss))
+			continue; /* Try sharing once the response is in */
+
+		if (selected == NULL || (bss->freq == wpa_s->anqp_fetch_freq &&
+					 selected->freq !=
+					 wpa_s->anqp_fetch_freq))
+			selected = bss;
+		if (bss->freq == wpa_s->anqp_fetch_freq)
+			break;
+	}
+
+	if (selected && selected->anqp == NULL) {
+		selected->anqp = wpa_bss_anqp_alloc();
+		if (selected->anqp == NULL)
+			return NULL;
+	}
+
+	return selected;
+}
+
+
 static void interworking_next_anqp_fetch(struct wpa_supplicant *wpa_s)
 {
 	struct wpa_bss *bss;
-	int found = 0;
-	const u8 *ie;
+	struct os_reltime now, diff;
 
 	wpa_printf(MSG_DEBUG, "Interworking: next_anqp_fetch - "
 		   "fetch_anqp_in_progress=%d fetch_osu_icon_in_progress=%d",
@@ -2443,38 +2592,25 @@ static void interworking_next_anqp_fetch(struct wpa_supplicant *wpa_s)
 		return;
 	}
 
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
-		if (!(bss->caps & IEEE80211_CAP_ESS))
-			continue;
-		ie = wpa_bss_get_ie(bss, WLAN_EID_EXT_CAPAB);
-		if (ie == NULL || ie[1] < 4 || !(ie[5] & 0x80))
-			continue; /* AP does not support Interworking */
-		if (disallowed_bssid(wpa_s, bss->bssid) ||
-		    disallowed_ssid(wpa_s, bss->ssid, bss->ssid_len))
-			continue; /* Disallowed BSS */
-
-		if (!(bss->flags & WPA_BSS_ANQP_FETCH_TRIED)) {
-			if (bss->anqp == NULL) {
-				bss->anqp = interworking_match_anqp_info(wpa_s,
-									 bss);
-				if (bss->anqp) {
-					/* Shared data already fetched */
-					continue;
-				}
-				bss->anqp = wpa_bss_anqp_alloc();
-				if (bss->anqp == NULL)
-					break;
-			}
-			found++;
-			bss->flags |= WPA_BSS_ANQP_FETCH_TRIED;
-			wpa_msg(wpa_s, MSG_INFO, "Starting ANQP fetch for "
-				MACSTR, MAC2STR(bss->bssid));
-			interworking_anqp_send_req(wpa_s, bss);
+	while (wpa_s->num_anqp_queries <
+	       (unsigned int) wpa_s->conf->gas_max_parallel) {
+		bss = interworking_next_anqp_bss(wpa_s);
+		if (bss == NULL)
 			break;
+		bss->flags |= WPA_BSS_ANQP_FETCH_TRIED;
+		if (anqp_cache_get(wpa_s, bss, wpa_s->fetch_all_anqp) == 0) {
+			wpa_s->anqp_fetch_cached++;
+			continue;
 		}
+		wpa_msg(wpa_s, MSG_INFO, "Starting ANQP fetch for "
+			MACSTR, MAC2STR(bss->bssid));
+		wpa_s->anqp_fetch_freq = bss->freq;
+		if (interworking_anqp_send_req(wpa_s, bss) == 0)
+			wpa_s->anqp_fetch_queries++;
 	}
 
-	if (found == 0) {
+	if (wpa_s->num_anqp_queries == 0) {
+		anqp_cache_sync(wpa_s);
 		if (wpa_s->fetch_osu_info) {
 			if (wpa_s->num_prov_found == 0 &&
 			    wpa_s->num_osu_scans < 3) {
@@ -2486,6 +2622,11 @@ static void interworking_next_anqp_fetch(struct wpa_supplicant *wpa_s)
 			hs20_osu_icon_fetch(wpa_s);
 			return;
 		}
+		os_get_reltime(&now);
+		os_reltime_sub(&now, &wpa_s->anqp_fetch_start, &diff);
+		wpa_msg(wpa_s, MSG_DEBUG, "Interworking: ANQP fetch took %ld.%06ld seconds (%u queries, %u BSSes with shared ANQP data, %u from cache)",
+			diff.sec, diff.usec, wpa_s->anqp_fetch_queries,
+			wpa_s->anqp_fetch_shared, wpa_s->anqp_fetch_cached);
 		wpa_msg(wpa_s, MSG_INFO, "ANQP fetch completed");
 		wpa_s->fetch_anqp_in_progress = 0;
 		if (wpa_s->network_select)
@@ -2501,6 +2642,12 @@ void interworking_start_fetch_anqp(struct wpa_supplicant *wpa_s)
 	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list)
 		bss->flags &= ~WPA_BSS_ANQP_FETCH_TRIED;
 
+	os_get_reltime(&wpa_s->anqp_fetch_start);
+	wpa_s->anqp_fetch_queries = 0;
+	wpa_s->anqp_fetch_shared = 0;
+	wpa_s->anqp_fetch_cached = 0;
+	wpa_s->anqp_fetch_freq = wpa_s->wpa_state >= WPA_ASSOCIATED ?
+		wpa_s->assoc_freq : 0;
 	wpa_s->fetch_anqp_in_progress = 1;
 	interworking_next_anqp_fetch(wpa_s);
 }
@@ -2523,10 +2670,27 @@ int interworking_fetch_anqp(struct wpa_supplicant *wpa_s)
 
 void interworking_stop_fetch_anqp(struct wpa_supplicant *wpa_s)
 {
+	struct interworking_anqp_query *q;
+	unsigned int num;
+	u8 bssid[ETH_ALEN];
+	u8 dialog_token;
+
 	if (!wpa_s->fetch_anqp_in_progress)
 		return;
 
 	wpa_s->fetch_anqp_in_progress = 0;
+
+	/* Cancel the queries that are still waiting for a response */
+	while (wpa_s->num_anqp_queries > 0) {
+		num = wpa_s->num_anqp_queries;
+		q = &wpa_s->anqp_queries[num - 1];
+		os_memcpy(bssid, q->bssid, ETH_ALEN);
+		dialog_token = q->dialog_token;
+		gas_query_cancel(wpa_s->gas, bssid, dialog_token);
+		if (wpa_s->num_anqp_queries == num)
+			interworking_anqp_query_done(wpa_s, bssid,
+						     dialog_token);
+	}
 }
 
 
@@ -2568,10 +2732,9 @@ int anqp_send_req(struct wpa_supplicant *wpa_s, const u8 *dst,
 }
 
 
-static void interworking_parse_rx_anqp_resp(struct wpa_supplicant *wpa_s,
-					    struct wpa_bss *bss, const u8 *sa,
-					    u16 info_id,
-					    const u8 *data, size_t slen)
+void interworking_parse_rx_anqp_resp(struct wpa_supplicant *wpa_s,
+				     struct wpa_bss *bss, const u8 *sa,
+				     u16 info_id, const u8 *data, size_t slen)
 {
 	const u8 *pos = data;
 	struct wpa_bss_anqp *anqp = NULL;
@@ -31,5 +31,9 @@ int interworking_home_sp_cred(struct wpa_supplicant *wpa_s,
 			      struct wpabuf *domain_names);
 int domain_name_list_contains(struct wpabuf *domain_names,
 			      const char *domain, int exact_match);
+int interworking_anqp_domain_id(struct wpa_bss *bss);
+void interworking_parse_rx_anqp_resp(struct wpa_supplicant *wpa_s,
+				     struct wpa_bss *bss, const u8 *sa,
+				     u16 info_id, const u8 *data, size_t slen);
 
 #endif /* INTERWORKING_H */
@@ -396,8 +396,8 @@ static int wpas_p2p_scan(void *ctx, enum p2p_scan_type type, int freq,
 	}
 
 	radio_remove_works(wpa_s, "p2p-scan", 0);
-	if (radio_add_work(wpa_s, 0, "p2p-scan", 0, wpas_p2p_trigger_scan_cb,
-			   params) < 0)
+	if (radio_add_work(wpa_s, 0, "p2p-scan", RADIO_WORK_PRIO_BACKGROUND, 0,
+			   wpas_p2p_trigger_scan_cb, params) < 0)
 		goto fail;
 	return 0;
 
@@ -656,10 +656,9 @@ static int wpas_p2p_persistent_group(struct wpa_supplicant *wpa_s,
 			   "group is persistent - BSS " MACSTR
 			   " did not include P2P IE", MAC2STR(bssid));
 		wpa_hexdump(MSG_DEBUG, "P2P: Probe Response IEs",
-			    (u8 *) (bss + 1), bss->ie_len);
+			    wpa_bss_ie_ptr(bss), bss->ie_len);
 		wpa_hexdump(MSG_DEBUG, "P2P: Beacon IEs",
-			    ((u8 *) bss + 1) + bss->ie_len,
-			    bss->beacon_ie_len);
+			    wpa_bss_beacon_ie_ptr(bss), bss->beacon_ie_len);
 		return 0;
 	}
 
@@ -757,6 +756,7 @@ static int wpas_p2p_store_persistent_group(struct wpa_supplicant *wpa_s,
 		s->ssid_len = ssid->ssid_len;
 		os_memcpy(s->ssid, ssid->ssid, s->ssid_len);
 	}
+	wpa_config_flush_ssid_index(wpa_s->conf);
 	if (ssid->mode == WPAS_MODE_P2P_GO && wpa_s->global->add_psk) {
 		dl_list_add(&s->psk_list, &wpa_s->global->add_psk->list);
 		wpa_s->global->add_psk = NULL;
@@ -1090,8 +1090,9 @@ static int wpas_send_action_work(struct wpa_supplicant *wpa_s,
 	awork->wait_time = wait_time;
 	os_memcpy(awork->buf, buf, len);
 
-	if (radio_add_work(wpa_s, freq, "p2p-send-action", 0,
-			   wpas_send_action_cb, awork) < 0) {
+	if (radio_add_work(wpa_s, freq, "p2p-send-action",
+			   RADIO_WORK_PRIO_NORMAL, 0, wpas_send_action_cb,
+			   awork) < 0) {
 		os_free(awork);
 		return -1;
 	}
@@ -1883,7 +1884,8 @@ static int wpas_start_listen(void *ctx, unsigned int freq,
 		}
 	}
 
-	if (radio_add_work(wpa_s, freq, "p2p-listen", 0, wpas_start_listen_cb,
+	if (radio_add_work(wpa_s, freq, "p2p-listen",
+			   RADIO_WORK_PRIO_BACKGROUND, 0, wpas_start_listen_cb,
 			   lwork) < 0) {
 		wpas_p2p_listen_work_free(lwork);
 		return -1;
@@ -14,6 +14,7 @@
 #include "utils/eloop.h"
 #include "common/ieee802_11_defs.h"
 #include "common/wpa_ctrl.h"
+#include "crypto/random.h"
 #include "config.h"
 #include "wpa_supplicant_i.h"
 #include "driver_i.h"
@@ -24,6 +25,7 @@
 #include "notify.h"
 #include "bss.h"
 #include "scan.h"
+#include "scan_history.h"
 
 /*
  * Channels with a great SNR can operate at full rate. What is a great SNR?
@@ -194,11 +196,159 @@ static void wpas_trigger_scan_cb(struct wpa_radio_work *work, int deinit)
 }
 
 
+static int wpas_scan_freqs_overlap(const int *a, const int *b)
+{
+	const int *pos;
+
+	if (a == NULL || b == NULL)
+		return 1; /* all channels */
+
+	for (; *a; a++) {
+		for (pos = b; *pos; pos++) {
+			if (*pos == *a)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+static int wpas_scan_has_ssid(const struct wpa_driver_scan_params *params,
+			      const u8 *ssid, size_t ssid_len)
+{
+	size_t i;
+
+	for (i = 0; i < params->num_ssids; i++) {
+		if (params->ssids[i].ssid_len == ssid_len &&
+		    (ssid_len == 0 ||
+		     os_memcmp(params->ssids[i].ssid, ssid, ssid_len) == 0))
+			return 1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Build scan parameters that cover both a and b. Returns NULL if the scans
+ * cannot be combined, e.g., due to different extra IEs or disjoint channel
+ * sets.
+ */
+static struct wpa_driver_scan_params *
+wpas_scan_merge_params(struct wpa_supplicant *wpa_s,
+		       const struct wpa_driver_scan_params *a,
+		       const struct wpa_driver_scan_params *b)
+{
+	struct wpa_driver_scan_params tmp, *merged;
+	size_t i, j, max_ssids;
+	int *freqs = NULL;
+
+	if (a->extra_ies_len != b->extra_ies_len ||
+	    (a->extra_ies_len &&
+	     os_memcmp(a->extra_ies, b->extra_ies, a->extra_ies_len) != 0) ||
+	    a->p2p_probe != b->p2p_probe || a->filter_rssi != b->filter_rssi ||
+	    !wpas_scan_freqs_overlap(a->freqs, b->freqs))
+		return NULL;
+
+	os_memcpy(&tmp, a, sizeof(tmp));
+	max_ssids = wpa_s->max_scan_ssids;
+	if (max_ssids > WPAS_MAX_SCAN_SSIDS)
+		max_ssids = WPAS_MAX_SCAN_SSIDS;
+	for (i = 0; i < b->num_ssids; i++) {
+		if (wpas_scan_has_ssid(&tmp, b->ssids[i].ssid,
+				       b->ssids[i].ssid_len))
+			continue;
+		if (tmp.num_ssids >= max_ssids)
+			return NULL;
+		tmp.ssids[tmp.num_ssids++] = b->ssids[i];
+	}
+
+	if (a->freqs && b->freqs) {
+		int_array_concat(&freqs, a->freqs);
+		int_array_concat(&freqs, b->freqs);
+		if (freqs == NULL)
+			return NULL;
+		int_array_sort_unique(freqs);
+	}
+	tmp.freqs = freqs;
+
+	/* Result filtering is used only if both scans use it */
+	if (a->filter_ssids && b->filter_ssids) {
+		tmp.filter_ssids = os_calloc(a->num_filter_ssids +
+					     b->num_filter_ssids,
+					     sizeof(*tmp.filter_ssids));
+		if (tmp.filter_ssids == NULL) {
+			os_free(freqs);
+			return NULL;
+		}
+		os_memcpy(tmp.filter_ssids, a->filter_ssids,
+			  a->num_filter_ssids * sizeof(*tmp.filter_ssids));
+		tmp.num_filter_ssids = a->num_filter_ssids;
+		for (i = 0; i < b->num_filter_ssids; i++) {
+			for (j = 0; j < tmp.num_filter_ssids; j++) {
+				if (tmp.filter_ssids[j].ssid_len ==
+				    b->filter_ssids[i].ssid_len &&
+				    os_memcmp(tmp.filter_ssids[j].ssid,
+					      b->filter_ssids[i].ssid,
+					      b->filter_ssids[i].ssid_len) == 0)
+					break;
+			}
+			if (j == tmp.num_filter_ssids)
+				tmp.filter_ssids[tmp.num_filter_ssids++] =
+					b->filter_ssids[i];
+		}
+	} else {
+		tmp.filter_ssids = NULL;
+		tmp.num_filter_ssids = 0;
+	}
+	tmp.only_new_results = a->only_new_results || b->only_new_results;
+
+	merged = wpa_scan_clone_params(&tmp);
+	os_free(freqs);
+	os_free(tmp.filter_ssids);
+	return merged;
+}
+
+
+/*
+ * Combine a scan request with a scan that is still waiting in the radio work
+ * queue instead of running two scans after each other.
+ */
+static int wpas_scan_merge_queued(struct wpa_supplicant *wpa_s,
+				  struct wpa_driver_scan_params *params)
+{
+	struct wpa_radio_work *work;
+	struct wpa_driver_scan_params *merged;
+
+	dl_list_for_each(work, &wpa_s->radio->work, struct wpa_radio_work,
+			 list) {
+		if (work->started || work->wpa_s != wpa_s ||
+		    work->cb != wpas_trigger_scan_cb || work->ctx == NULL)
+			continue;
+		merged = wpas_scan_merge_params(wpa_s, work->ctx, params);
+		if (merged == NULL)
+			continue;
+		wpa_dbg(wpa_s, MSG_DEBUG, "Merge scan request into queued scan radio work %p",
+			work);
+		wpa_scan_free_params(work->ctx);
+		work->ctx = merged;
+		radio_work_merged(wpa_s, work->type);
+		return 0;
+	}
+
+	return -1;
+}
+
+
 /**
  * wpa_supplicant_trigger_scan - Request driver to start a scan
  * @wpa_s: Pointer to wpa_supplicant data
  * @params: Scan parameters
  * Returns: 0 on success, -1 on failure
+ *
+ * A request that can be combined with a scan that has not yet been started is
+ * merged into that scan.
  */
 int wpa_supplicant_trigger_scan(struct wpa_supplicant *wpa_s,
 				struct wpa_driver_scan_params *params)
@@ -210,11 +360,15 @@ int wpa_supplicant_trigger_scan(struct wpa_supplicant *wpa_s,
 		return -1;
 	}
 
+	if (wpas_scan_merge_queued(wpa_s, params) == 0)
+		return 0;
+
 	ctx = wpa_scan_clone_params(params);
 	if (ctx == NULL)
 		return -1;
 
-	if (radio_add_work(wpa_s, 0, "scan", 0, wpas_trigger_scan_cb, ctx) < 0)
+	if (radio_add_work(wpa_s, 0, "scan", RADIO_WORK_PRIO_NORMAL, 0,
+			   wpas_trigger_scan_cb, ctx) < 0)
 	{
 		wpa_scan_free_params(ctx);
 		return -1;
@@ -821,6 +975,14 @@ ssid_list_set:
 		}
 	}
 
+	/* Try the channels on which the networks were seen before */
+	if (!params.freqs && wpa_s->last_scan_req == NORMAL_SCAN_REQ &&
+	    wpa_s->wpa_state == WPA_SCANNING) {
+		params.freqs = scan_history_plan(wpa_s);
+		if (params.freqs)
+			wpa_s->last_scan_optimized = 1;
+	}
+
 	params.filter_ssids = wpa_supplicant_build_filter_ssids(
 		wpa_s->conf, &params.num_filter_ssids);
 	if (extra_ie) {
@@ -1468,120 +1630,6 @@ struct wpabuf * wpa_scan_get_vendor_ie_multi(const struct wpa_scan_res *res,
 }
 
 
-static int wpa_scan_result_compar_common(struct wpa_scan_res *a,
-					 struct wpa_scan_res *b)
-{
-	int snr_a, snr_b, maxrate_a, maxrate_b;
-
-	if ((a->flags & b->flags & WPA_SCAN_LEVEL_DBM) &&
-	    !((a->flags | b->flags) & WPA_SCAN_NOISE_INVALID)) {
-		snr_a = MIN(a->level - a->noise, GREAT_SNR);
-		snr_b = MIN(b->level - b->noise, GREAT_SNR);
-	} else {
-		/* not suitable information to calculate SNR, so use level */
-		snr_a = a->level;
-		snr_b = b->level;
-	}
-
-	if ((snr_a && snr_b && abs(snr_b - snr_a) < 5) ||
-	    (a->qual && b->qual && abs(b->qual - a->qual) < 10)) {
-		if (a->freq_priority < b->freq_priority)
-			return 1;
-		if (a->freq_priority > b->freq_priority)
-			return -1;
-		maxrate_a = wpa_scan_get_max_rate(a);
-		maxrate_b = wpa_scan_get_max_rate(b);
-		if (maxrate_a != maxrate_b)
-			return maxrate_b - maxrate_a;
-		if (IS_5GHZ(a->freq) ^ IS_5GHZ(b->freq))
-			return IS_5GHZ(a->freq) ? -1 : 1;
-	}
-
-	/* all things being equal, use SNR; if SNRs are
-	 * identical, use quality values since some drivers may only report
-	 * that value and leave the signal level zero */
-	if (snr_b == snr_a)
-		return b->qual - a->qual;
-	return snr_b - snr_a;
-}
-
-
-/* Compare function for sorting scan results. Return >0 if @b is considered
- * better. */
-static int wpa_scan_result_compar(const void *a, const void *b)
-{
-	struct wpa_scan_res **_wa = (void *) a;
-	struct wpa_scan_res **_wb = (void *) b;
-	struct wpa_scan_res *wa = *_wa;
-	struct wpa_scan_res *wb = *_wb;
-	int wpa_a, wpa_b;
-
-	/* WPA/WPA2 support preferred */
-	wpa_a = wpa_scan_get_vendor_ie(wa, WPA_IE_VENDOR_TYPE) != NULL ||
-		wpa_scan_get_ie(wa, WLAN_EID_RSN) != NULL;
-	wpa_b = wpa_scan_get_vendor_ie(wb, WPA_IE_VENDOR_TYPE) != NULL ||
-		wpa_scan_get_ie(wb, WLAN_EID_RSN) != NULL;
-
-	if (wpa_b && !wpa_a)
-		return 1;
-	if (!wpa_b && wpa_a)
-		return -1;
-
-	/* privacy support preferred */
-	if ((wa->caps & IEEE80211_CAP_PRIVACY) == 0 &&
-	    (wb->caps & IEEE80211_CAP_PRIVACY))
-		return 1;
-	if ((wa->caps & IEEE80211_CAP_PRIVACY) &&
-	    (wb->caps & IEEE80211_CAP_PRIVACY) == 0)
-		return -1;
-
-	return wpa_scan_result_compar_common(wa, wb);
-}
-
-
-#ifdef CONFIG_WPS
-/* Compare function for sorting scan results when searching a WPS AP for
- * provisioning. Return >0 if @b is considered better. */
-static int wpa_scan_result_wps_compar(const void *a, const void *b)
-{
-	struct wpa_scan_res **_wa = (void *) a;
-	struct wpa_scan_res **_wb = (void *) b;
-	struct wpa_scan_res *wa = *_wa;
-	struct wpa_scan_res *wb = *_wb;
-	int uses_wps_a, uses_wps_b;
-	struct wpabuf *wps_a, *wps_b;
-	int res;
-
-	/* Optimization - check WPS IE existence before allocated memory and
-	 * doing full reassembly. */
-	uses_wps_a = wpa_scan_get_vendor_ie(wa, WPS_IE_VENDOR_TYPE) != NULL;
-	uses_wps_b = wpa_scan_get_vendor_ie(wb, WPS_IE_VENDOR_TYPE) != NULL;
-	if (uses_wps_a && !uses_wps_b)
-		return -1;
-	if (!uses_wps_a && uses_wps_b)
-		return 1;
-
-	if (uses_wps_a && uses_wps_b) {
-		wps_a = wpa_scan_get_vendor_ie_multi(wa, WPS_IE_VENDOR_TYPE);
-		wps_b = wpa_scan_get_vendor_ie_multi(wb, WPS_IE_VENDOR_TYPE);
-		res = wps_ap_priority_compar(wps_a, wps_b);
-		wpabuf_free(wps_a);
-		wpabuf_free(wps_b);
-		if (res)
-			return res;
-	}
-
-	/*
-	 * Do not use current AP security policy as a sorting criteria during
-	 * WPS provisioning step since the AP may get reconfigured at the
-	 * completion of provisioning.
-	 */
-
-	return wpa_scan_result_compar_common(wa, wb);
-}
-#endif /* CONFIG_WPS */
-
-
 static void dump_scan_res(struct wpa_scan_results *scan_res)
 {
 #ifndef CONFIG_NO_STDOUT_DEBUG
@@ -1652,40 +1700,67 @@ int wpa_supplicant_filter_bssid_match(struct wpa_supplicant *wpa_s,
 }
 
 
+static int * scan_res_p2p_freqs(struct wpa_supplicant *wpa_s, int *num)
+{
+	int *p2p_freqs;
+
+	p2p_freqs = os_malloc(wpa_s->num_multichan_concurrent * sizeof(int));
+	*num = p2p_freqs ?
+		wpas_get_used_p2p_freqs_hp(wpa_s, p2p_freqs,
+					   wpa_s->num_multichan_concurrent) : 0;
+	return p2p_freqs;
+}
+
+
+static int scan_res_freq_priority(struct wpa_supplicant *wpa_s, int freq,
+				  const int *p2p_freqs, int freqs_num)
+{
+	int freq_priority, freq_index;
+
+	freq_priority = wpas_freq_priority_value(wpa_s, freq);
+	if (freq_priority >= WPA_FREQ_PRIORITY_LOW_LATENCY)
+		return freq_priority;
+
+	for (freq_index = 0; freq_index < freqs_num; freq_index++)
+		if (freq == p2p_freqs[freq_index])
+			return WPA_FREQ_PRIORITY_LOW_LATENCY;
+
+	return freq_priority;
+}
+
+
+static int scan_res_filtered(struct wpa_supplicant *wpa_s,
+			     const struct wpa_scan_res *r)
+{
+	return !wpa_supplicant_filter_bssid_match(wpa_s, r->bssid) ||
+		!wpas_freq_in_current_band(wpa_s, r->freq);
+}
+
+
 static void scan_res_presort(struct wpa_supplicant *wpa_s,
 			     struct wpa_scan_results *res)
 {
 	size_t i, j;
 	struct wpa_scan_res *r;
 	int *p2p_freqs;
-	int freq_index, freqs_num = wpa_s->num_multichan_concurrent;
+	int freqs_num;
 
-	p2p_freqs = os_malloc(freqs_num * sizeof(int));
-	freqs_num = p2p_freqs ? wpas_get_used_p2p_freqs_hp(wpa_s, p2p_freqs,
-							   freqs_num) : 0;
+	p2p_freqs = scan_res_p2p_freqs(wpa_s, &freqs_num);
 
 	for (i = 0, j = 0; i < res->num; i++) {
 		r = res->res[i];
 
 		/* filter scan results */
-		if (!wpa_supplicant_filter_bssid_match(wpa_s, r->bssid) ||
-		    !wpas_freq_in_current_band(wpa_s, r->freq)) {
+		if (scan_res_filtered(wpa_s, r)) {
 			os_free(res->res[i]);
 			res->res[i] = NULL;
 			continue;
 		}
 
 		res->res[j++] = r;
-		r->freq_priority = wpas_freq_priority_value(wpa_s, r->freq);
-		if (r->freq_priority >= WPA_FREQ_PRIORITY_LOW_LATENCY)
-			continue;
-
-		for (freq_index = 0; freq_index < freqs_num; freq_index++)
-			if (r->freq == p2p_freqs[freq_index]) {
-				r->freq_priority =
-					WPA_FREQ_PRIORITY_LOW_LATENCY;
-				break;
-			}
+		r->freq_priority = scan_res_freq_priority(wpa_s, r->freq,
+							  p2p_freqs,
+							  freqs_num);
 	}
 
 	if (res->num != j) {
@@ -1697,6 +1772,191 @@ static void scan_res_presort(struct wpa_supplicant *wpa_s,
 }
 
 
+/*
+ * Sort key of a scan result or a BSS entry. The IE based criteria are
+ * evaluated once per entry when the key is initialized, so that the
+ * comparisons during sorting are done only on these precomputed values.
+ */
+struct wpa_scan_key {
+	void *entry; /* struct wpa_scan_res or struct wpa_bss */
+	/*
+	 * Security class (WPA/WPA2 and privacy support) or WPS AP priority
+	 * when searching a WPS AP for provisioning; larger is better
+	 */
+	int pref;
+	int snr; /* SNR in dB (if snr_valid), capped to GREAT_SNR */
+	int level;
+	int qual;
+	int freq_priority;
+	int max_rate;
+	u8 snr_valid;
+	u8 is_5ghz;
+};
+
+
+static void wpa_scan_key_init(struct wpa_scan_key *key, void *entry,
+			      unsigned int flags, int level, int noise,
+			      int qual, int freq, int freq_priority)
+{
+	key->entry = entry;
+	key->snr_valid = (flags & WPA_SCAN_LEVEL_DBM) &&
+		!(flags & WPA_SCAN_NOISE_INVALID);
+	key->snr = MIN(level - noise, GREAT_SNR);
+	key->level = level;
+	key->qual = qual;
+	key->freq_priority = freq_priority;
+	key->is_5ghz = IS_5GHZ(freq);
+}
+
+
+static void wpa_scan_key_init_res(struct wpa_scan_key *key,
+				  struct wpa_scan_res *res, int wps)
+{
+	wpa_scan_key_init(key, res, res->flags, res->level, res->noise,
+			  res->qual, res->freq, res->freq_priority);
+	key->max_rate = wpa_scan_get_max_rate(res);
+#ifdef CONFIG_WPS
+	if (wps) {
+		struct wpabuf *buf;
+
+		/*
+		 * Do not use current AP security policy as a sorting criteria
+		 * during WPS provisioning step since the AP may get
+		 * reconfigured at the completion of provisioning.
+		 */
+		key->pref = 0;
+		if (wpa_scan_get_vendor_ie(res, WPS_IE_VENDOR_TYPE)) {
+			buf = wpa_scan_get_vendor_ie_multi(res,
+							   WPS_IE_VENDOR_TYPE);
+			key->pref = 1 + wps_ap_priority(buf);
+			wpabuf_free(buf);
+		}
+		return;
+	}
+#endif /* CONFIG_WPS */
+	/* WPA/WPA2 support preferred over privacy support */
+	key->pref = 2 * (wpa_scan_get_vendor_ie(res, WPA_IE_VENDOR_TYPE) ||
+			  wpa_scan_get_ie(res, WLAN_EID_RSN)) +
+		!!(res->caps & IEEE80211_CAP_PRIVACY);
+}
+
+
+static void wpa_scan_key_init_bss(struct wpa_supplicant *wpa_s,
+				  struct wpa_scan_key *key, struct wpa_bss *bss,
+				  int wps, const int *p2p_freqs, int freqs_num)
+{
+	wpa_scan_key_init(key, bss, bss->flags, bss->level, bss->noise,
+			  bss->qual, bss->freq,
+			  scan_res_freq_priority(wpa_s, bss->freq, p2p_freqs,
+						 freqs_num));
+	key->max_rate = wpa_bss_get_max_rate(bss);
+#ifdef CONFIG_WPS
+	if (wps) {
+		struct wpabuf *buf;
+
+		key->pref = 0;
+		if (wpa_bss_get_vendor_ie(bss, WPS_IE_VENDOR_TYPE)) {
+			buf = wpa_bss_get_vendor_ie_multi(bss,
+							  WPS_IE_VENDOR_TYPE);
+			key->pref = 1 + wps_ap_priority(buf);
+			wpabuf_free(buf);
+		}
+		return;
+	}
+#endif /* CONFIG_WPS */
+	key->pref = 2 * (wpa_bss_get_vendor_ie(bss, WPA_IE_VENDOR_TYPE) ||
+			  wpa_bss_get_ie(bss, WLAN_EID_RSN)) +
+		!!(bss->caps & IEEE80211_CAP_PRIVACY);
+}
+
+
+/* Compare function for sorting scan keys. Return >0 if @b is considered
+ * better. */
+static int wpa_scan_key_compar(const void *_a, const void *_b)
+{
+	const struct wpa_scan_key *a = _a;
+	const struct wpa_scan_key *b = _b;
+	int snr_a, snr_b;
+
+	if (a->pref != b->pref)
+		return b->pref - a->pref;
+
+	if (a->snr_valid && b->snr_valid) {
+		snr_a = a->snr;
+		snr_b = b->snr;
+	} else {
+		/* not suitable information to calculate SNR, so use level */
+		snr_a = a->level;
+		snr_b = b->level;
+	}
+
+	if ((snr_a && snr_b && abs(snr_b - snr_a) < 5) ||
+	    (a->qual && b->qual && abs(b->qual - a->qual) < 10)) {
+		if (a->freq_priority < b->freq_priority)
+			return 1;
+		if (a->freq_priority > b->freq_priority)
+			return -1;
+		if (a->max_rate != b->max_rate)
+			return b->max_rate - a->max_rate;
+		if (a->is_5ghz != b->is_5ghz)
+			return a->is_5ghz ? -1 : 1;
+	}
+
+	/* all things being equal, use SNR; if SNRs are
+	 * identical, use quality values since some drivers may only report
+	 * that value and leave the signal level zero */
+	if (snr_b == snr_a)
+		return b->qual - a->qual;
+	return snr_b - snr_a;
+}
+
+
+static int wpa_scan_wps_searching(struct wpa_supplicant *wpa_s)
+{
+#ifdef CONFIG_WPS
+	if (wpas_wps_searching(wpa_s)) {
+		wpa_dbg(wpa_s, MSG_DEBUG, "WPS: Order scan results with WPS "
+			"provisioning rules");
+		return 1;
+	}
+#endif /* CONFIG_WPS */
+	return 0;
+}
+
+
+/**
+ * wpa_supplicant_sort_scan_results - Sort scan results in preference order
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @scan_res: Scan results with freq_priority set for each entry
+ *
+ * The sort key of each scan result is calculated once before sorting, so the
+ * IEs of each result are parsed only once regardless of the number of
+ * comparisons. The results are left in their original order if there is not
+ * enough memory for the keys.
+ */
+void wpa_supplicant_sort_scan_results(struct wpa_supplicant *wpa_s,
+				      struct wpa_scan_results *scan_res)
+{
+	struct wpa_scan_key *keys;
+	size_t i;
+	int wps;
+
+	if (scan_res->num < 2)
+		return;
+	keys = os_calloc(scan_res->num, sizeof(*keys));
+	if (keys == NULL)
+		return;
+
+	wps = wpa_scan_wps_searching(wpa_s);
+	for (i = 0; i < scan_res->num; i++)
+		wpa_scan_key_init_res(&keys[i], scan_res->res[i], wps);
+	qsort(keys, scan_res->num, sizeof(*keys), wpa_scan_key_compar);
+	for (i = 0; i < scan_res->num; i++)
+		scan_res->res[i] = keys[i].entry;
+	os_free(keys);
+}
+
+
 /**
  * wpa_supplicant_get_scan_results - Get scan results
  * @wpa_s: Pointer to wpa_supplicant data
@@ -1714,7 +1974,6 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 {
 	struct wpa_scan_results *scan_res;
 	size_t i;
-	int (*compar)(const void *, const void *) = wpa_scan_result_compar;
 
 	scan_res = wpa_drv_get_scan_results2(wpa_s);
 	if (scan_res == NULL) {
@@ -1729,17 +1988,7 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 		os_get_reltime(&scan_res->fetch_time);
 	}
 	scan_res_presort(wpa_s, scan_res);
-
-#ifdef CONFIG_WPS
-	if (wpas_wps_searching(wpa_s)) {
-		wpa_dbg(wpa_s, MSG_DEBUG, "WPS: Order scan results with WPS "
-			"provisioning rules");
-		compar = wpa_scan_result_wps_compar;
-	}
-#endif /* CONFIG_WPS */
-
-	qsort(scan_res->res, scan_res->num, sizeof(struct wpa_scan_res *),
-	      compar);
+	wpa_supplicant_sort_scan_results(wpa_s, scan_res);
 	dump_scan_res(scan_res);
 
 	wpa_bss_update_start(wpa_s);
@@ -1752,6 +2001,121 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 }
 
 
+static void wpa_supplicant_sort_last_scan_res(struct wpa_supplicant *wpa_s)
+{
+	struct wpa_scan_key *keys;
+	unsigned int i, num = wpa_s->last_scan_res_used;
+	int *p2p_freqs, freqs_num, wps;
+
+	if (num < 2)
+		return;
+	keys = os_calloc(num, sizeof(*keys));
+	if (keys == NULL)
+		return;
+
+	wps = wpa_scan_wps_searching(wpa_s);
+	p2p_freqs = scan_res_p2p_freqs(wpa_s, &freqs_num);
+	for (i = 0; i < num; i++)
+		wpa_scan_key_init_bss(wpa_s, &keys[i], wpa_s->last_scan_res[i],
+				      wps, p2p_freqs, freqs_num);
+	os_free(p2p_freqs);
+
+	qsort(keys, num, sizeof(*keys), wpa_scan_key_compar);
+	for (i = 0; i < num; i++)
+		wpa_s->last_scan_res[i] = keys[i].entry;
+	os_free(keys);
+}
+
+
+struct wpa_scan_stream {
+	struct wpa_supplicant *wpa_s;
+	struct os_reltime fetch_time;
+	int started;
+	unsigned int num;
+	unsigned int filtered;
+};
+
+
+static void wpa_supplicant_scan_res_cb(void *ctx, struct wpa_scan_res *res)
+{
+	struct wpa_scan_stream *stream = ctx;
+	struct wpa_supplicant *wpa_s = stream->wpa_s;
+
+	if (!stream->started) {
+		wpa_bss_update_start(wpa_s);
+		stream->started = 1;
+	}
+
+	if (scan_res_filtered(wpa_s, res)) {
+		stream->filtered++;
+		return;
+	}
+
+#ifndef CONFIG_NO_RANDOM_POOL
+	if (stream->num < 10) {
+		u8 buf[5];
+		buf[0] = res->bssid[5];
+		buf[1] = res->qual & 0xff;
+		buf[2] = res->noise & 0xff;
+		buf[3] = res->level & 0xff;
+		buf[4] = res->tsf & 0xff;
+		random_add_randomness(buf, sizeof(buf));
+	}
+#endif /* CONFIG_NO_RANDOM_POOL */
+	stream->num++;
+
+	wpas_wps_update_ap_info_res(wpa_s, res);
+	wpa_bss_update_scan_res(wpa_s, res, &stream->fetch_time);
+}
+
+
+/**
+ * wpa_supplicant_stream_scan_results - Update BSS table from scan results
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @info: Information about what was scanned or %NULL if not available
+ * @new_scan: Whether a new scan was performed
+ * Returns: Number of scan results used on success, -1 on failure
+ *
+ * This is like wpa_supplicant_get_scan_results(), but the driver wrapper
+ * passes each scan result directly to the BSS table without a full copy of
+ * the scan results being built. wpa_s->last_scan_res is sorted in the same
+ * order as wpa_supplicant_get_scan_results() would have sorted the results.
+ * This requires driver support for get_scan_results_cb().
+ */
+int wpa_supplicant_stream_scan_results(struct wpa_supplicant *wpa_s,
+				       struct scan_info *info, int new_scan)
+{
+	struct wpa_scan_stream stream;
+	int ret;
+
+	os_memset(&stream, 0, sizeof(stream));
+	stream.wpa_s = wpa_s;
+	os_get_reltime(&stream.fetch_time);
+
+	ret = wpa_drv_get_scan_results_cb(wpa_s, wpa_supplicant_scan_res_cb,
+					  &stream);
+	if (ret < 0) {
+		wpa_dbg(wpa_s, MSG_DEBUG, "Failed to get scan results");
+		if (stream.started) {
+			/* Do not expire entries based on partial results */
+			wpa_supplicant_sort_last_scan_res(wpa_s);
+			wpa_bss_update_end(wpa_s, info, 0);
+		}
+		return -1;
+	}
+
+	if (!stream.started)
+		wpa_bss_update_start(wpa_s);
+	if (stream.filtered)
+		wpa_printf(MSG_DEBUG, "Filtered out %u scan results",
+			   stream.filtered);
+	wpa_supplicant_sort_last_scan_res(wpa_s);
+	wpa_bss_update_end(wpa_s, info, new_scan);
+
+	return stream.num;
+}
+
+
 /**
  * wpa_supplicant_update_scan_results - Update scan results from the driver
  * @wpa_s: Pointer to wpa_supplicant data
@@ -1767,6 +2131,11 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 int wpa_supplicant_update_scan_results(struct wpa_supplicant *wpa_s)
 {
 	struct wpa_scan_results *scan_res;
+
+	if (wpa_s->driver->get_scan_results_cb)
+		return wpa_supplicant_stream_scan_results(wpa_s, NULL, 0) < 0 ?
+			-1 : 0;
+
 	scan_res = wpa_supplicant_get_scan_results(wpa_s, NULL, 0);
 	if (scan_res == NULL)
 		return -1;
@@ -0,0 +1,822 @@
+/*
+ * wpa_supplicant - Channel history for partial connection scans
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * The channels on which the configured networks have been seen are recorded
+ * per ESS (hash of the SSID) and per location. The location is identified by
+ * the BSSID of the AP with which the station was last associated, i.e., the
+ * entries for a location list the channels that were used by the ESSes seen
+ * around that AP. Connection scans are first limited to the channels known
+ * for the current location, then to all channels known for the enabled
+ * networks, and a full scan is used only if neither of these found a network
+ * to connect to.
+ *
+ * The history is stored in a compact binary file (scan_history parameter):
+ * header: "WSH" version(1) anchor(6) full_scan_msec(le32) num_entries(le16)
+ * entry: ess(le32) location(6) last_seen(le32) num_freqs(1)
+ *	num_freqs * [freq(le16) hits(1)]
+ */
+
+#include "includes.h"
+#ifndef CONFIG_NATIVE_WINDOWS
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif /* CONFIG_NATIVE_WINDOWS */
+
+#include "common.h"
+#include "list.h"
+#include "drivers/driver.h"
+#include "config.h"
+#include "wpa_supplicant_i.h"
+#include "bss.h"
+#include "scan_history.h"
+
+
+#define SCAN_HISTORY_VERSION 1
+#define SCAN_HISTORY_MAX_ENTRIES 256
+#define SCAN_HISTORY_MAX_FREQS 8
+#define SCAN_HISTORY_MAX_AGE (30 * 24 * 60 * 60)
+#define SCAN_HISTORY_HDR_LEN (4 + ETH_ALEN + 4 + 2)
+#define SCAN_HISTORY_ENTRY_LEN (4 + ETH_ALEN + 4 + 1)
+
+/* Estimated per-channel dwell times before a full scan has been measured */
+#define SCAN_HISTORY_ACTIVE_USEC 40000
+#define SCAN_HISTORY_PASSIVE_USEC 120000
+
+enum scan_history_stage {
+	SCAN_HISTORY_LOCATION,
+	SCAN_HISTORY_ESS,
+	SCAN_HISTORY_FULL
+};
+
+struct scan_history_freq {
+	u16 freq;
+	u8 hits;
+};
+
+struct scan_history_entry {
+	u32 ess;
+	u8 loc[ETH_ALEN];
+	u32 last_seen;
+	u8 num_freqs;
+	struct scan_history_freq freqs[SCAN_HISTORY_MAX_FREQS];
+};
+
+struct scan_history {
+	char *fname;
+	struct scan_history_entry *entries;
+	unsigned int num_entries;
+	u8 anchor[ETH_ALEN]; /* BSSID of the last AP selected for connection */
+	enum scan_history_stage stage; /* stage for the next connection scan */
+	int scan_stage; /* stage of the pending connection scan or -1 */
+	int loc_num_freqs; /* number of channels in the location stage */
+	unsigned int full_scan_usec; /* average full scan time; 0 = unknown */
+	int dirty;
+	struct scan_history_stats stats;
+};
+
+
+/* Collisions only add channels to the scans, so 32 bits are enough */
+static u32 scan_history_ess(const u8 *ssid, size_t ssid_len)
+{
+	u32 hash = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < ssid_len; i++) {
+		hash ^= ssid[i];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+
+static int scan_history_ess_cmp(const void *a, const void *b)
+{
+	u32 ea = *(const u32 *) a, eb = *(const u32 *) b;
+
+	return ea < eb ? -1 : ea > eb;
+}
+
+
+/*
+ * Build a sorted array of the ESS hashes of the configured (or only the
+ * enabled) networks. *unplannable is set if an enabled network cannot be
+ * found based on the history, e.g., due to a wildcard SSID.
+ */
+static u32 * scan_history_conf_ess(struct wpa_supplicant *wpa_s,
+				   int enabled_only, size_t *num,
+				   int *unplannable)
+{
+	struct wpa_ssid *ssid;
+	u32 *ess;
+	size_t count = 0, i, j;
+
+	for (ssid = wpa_s->conf->ssid; ssid; ssid = ssid->next)
+		count++;
+	ess = os_calloc(count + 1, sizeof(u32));
+	if (ess == NULL)
+		return NULL;
+
+	count = 0;
+	for (ssid = wpa_s->conf->ssid; ssid; ssid = ssid->next) {
+		if (enabled_only && wpas_network_disabled(wpa_s, ssid))
+			continue;
+		if (ssid->ssid_len == 0 || ssid->mode != WPAS_MODE_INFRA ||
+		    ssid->key_mgmt == WPA_KEY_MGMT_WPS) {
+			if (enabled_only && unplannable)
+				*unplannable = 1;
+			continue;
+		}
+		ess[count++] = scan_history_ess(ssid->ssid, ssid->ssid_len);
+	}
+
+	qsort(ess, count, sizeof(u32), scan_history_ess_cmp);
+	for (i = 0, j = 0; i < count; i++) {
+		if (j == 0 || ess[j - 1] != ess[i])
+			ess[j++] = ess[i];
+	}
+	*num = j;
+
+	return ess;
+}
+
+
+static int scan_history_ess_in(const u32 *ess, size_t num, u32 val)
+{
+	return bsearch(&val, ess, num, sizeof(u32), scan_history_ess_cmp) !=
+		NULL;
+}
+
+
+/*
+ * Returns 1 if the channel can be scanned and sets *passive for channels that
+ * need passive scanning. Unknown channels are accepted if the driver did not
+ * report its channels.
+ */
+static int scan_history_chan_usable(struct wpa_supplicant *wpa_s, int freq,
+				    int *passive)
+{
+	struct hostapd_hw_modes *modes = wpa_s->hw.modes;
+	int i, j;
+
+	*passive = 0;
+	if (modes == NULL)
+		return 1;
+
+	for (i = 0; i < wpa_s->hw.num_modes; i++) {
+		for (j = 0; j < modes[i].num_channels; j++) {
+			struct hostapd_channel_data *chan =
+				&modes[i].channels[j];
+
+			if (chan->freq != freq)
+				continue;
+			if (chan->flag & HOSTAPD_CHAN_DISABLED)
+				return 0;
+			*passive = !!(chan->flag & (HOSTAPD_CHAN_NO_IR |
+						    HOSTAPD_CHAN_RADAR));
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * Estimated duration of a full scan based on the supported channels. Sets
+ * *num_chan to the number of channels in a full scan (0 if unknown).
+ */
+static unsigned int scan_history_full_scan_cost(struct wpa_supplicant *wpa_s,
+						unsigned int *num_chan)
+{
+	struct hostapd_hw_modes *modes = wpa_s->hw.modes;
+	unsigned int usec = 0, count = 0;
+	int i, j, k, l, dup;
+
+	for (i = 0; modes && i < wpa_s->hw.num_modes; i++) {
+		for (j = 0; j < modes[i].num_channels; j++) {
+			struct hostapd_channel_data *chan =
+				&modes[i].channels[j];
+
+			if (chan->flag & HOSTAPD_CHAN_DISABLED)
+				continue;
+			/* some hw modes (e.g. 11b & 11g) contain same freqs */
+			dup = 0;
+			for (k = 0; k < i && !dup; k++) {
+				for (l = 0; l < modes[k].num_channels; l++) {
+					if (modes[k].channels[l].freq ==
+					    chan->freq) {
+						dup = 1;
+						break;
+					}
+				}
+			}
+			if (dup)
+				continue;
+			count++;
+			usec += (chan->flag & (HOSTAPD_CHAN_NO_IR |
+					       HOSTAPD_CHAN_RADAR)) ?
+				SCAN_HISTORY_PASSIVE_USEC :
+				SCAN_HISTORY_ACTIVE_USEC;
+		}
+	}
+
+	if (num_chan)
+		*num_chan = count;
+	return usec;
+}
+
+
+static struct scan_history_entry *
+scan_history_get(struct scan_history *h, u32 ess, const u8 *loc)
+{
+	unsigned int i;
+
+	for (i = 0; i < h->num_entries; i++) {
+		if (h->entries[i].ess == ess &&
+		    os_memcmp(h->entries[i].loc, loc, ETH_ALEN) == 0)
+			return &h->entries[i];
+	}
+
+	return NULL;
+}
+
+
+static struct scan_history_entry *
+scan_history_add_entry(struct scan_history *h, u32 ess, const u8 *loc)
+{
+	struct scan_history_entry *e, *n;
+	unsigned int i;
+
+	if (h->num_entries == SCAN_HISTORY_MAX_ENTRIES) {
+		/* Replace the entry that was seen least recently */
+		e = &h->entries[0];
+		for (i = 1; i < h->num_entries; i++) {
+			if (h->entries[i].last_seen < e->last_seen)
+				e = &h->entries[i];
+		}
+	} else {
+		n = os_realloc_array(h->entries, h->num_entries + 1,
+				     sizeof(*n));
+		if (n == NULL)
+			return NULL;
+		h->entries = n;
+		e = &h->entries[h->num_entries++];
+	}
+
+	os_memset(e, 0, sizeof(*e));
+	e->ess = ess;
+	os_memcpy(e->loc, loc, ETH_ALEN);
+
+	return e;
+}
+
+
+static void scan_history_add(struct scan_history *h, u32 ess, const u8 *loc,
+			     int freq, u32 now)
+{
+	struct scan_history_entry *e;
+	struct scan_history_freq *f = NULL;
+	unsigned int i;
+
+	if (freq <= 0 || freq > 0xffff)
+		return;
+
+	e = scan_history_get(h, ess, loc);
+	if (e == NULL) {
+		e = scan_history_add_entry(h, ess, loc);
+		if (e == NULL)
+			return;
+	}
+	e->last_seen = now;
+	h->dirty = 1;
+
+	for (i = 0; i < e->num_freqs; i++) {
+		if (e->freqs[i].freq == freq) {
+			if (e->freqs[i].hits < 255)
+				e->freqs[i].hits++;
+			return;
+		}
+	}
+
+	if (e->num_freqs < SCAN_HISTORY_MAX_FREQS) {
+		f = &e->freqs[e->num_freqs++];
+	} else {
+		/* Replace the least used channel */
+		f = &e->freqs[0];
+		for (i = 1; i < e->num_freqs; i++) {
+			if (e->freqs[i].hits <= f->hits)
+				f = &e->freqs[i];
+		}
+	}
+	f->freq = freq;
+	f->hits = 1;
+}
+
+
+static void scan_history_record(struct wpa_supplicant *wpa_s,
+				struct scan_history *h, const u32 *ess,
+				size_t num_ess, const u8 *loc)
+{
+	struct wpa_bss *bss;
+	struct os_time now;
+	u32 val;
+
+	os_get_time(&now);
+	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+		if (bss->last_update_idx != wpa_s->bss_update_idx ||
+		    bss->ssid_len == 0)
+			continue;
+		val = scan_history_ess(bss->ssid, bss->ssid_len);
+		if (scan_history_ess_in(ess, num_ess, val))
+			scan_history_add(h, val, loc, bss->freq, now.sec);
+	}
+}
+
+
+static int scan_history_load(struct scan_history *h)
+{
+	const u8 *pos, *end;
+	char *buf;
+	size_t len;
+	unsigned int i, j, num;
+	struct os_time now;
+	int ret = -1;
+
+	buf = os_readfile(h->fname, &len);
+	if (buf == NULL)
+		return 0;
+
+	pos = (const u8 *) buf;
+	end = pos + len;
+	if (len < SCAN_HISTORY_HDR_LEN || os_memcmp(pos, "WSH", 3) != 0 ||
+	    pos[3] != SCAN_HISTORY_VERSION)
+		goto out;
+	pos += 4;
+	os_memcpy(h->anchor, pos, ETH_ALEN);
+	pos += ETH_ALEN;
+	h->full_scan_usec = WPA_GET_LE32(pos) * 1000;
+	pos += 4;
+	num = WPA_GET_LE16(pos);
+	pos += 2;
+	if (num > SCAN_HISTORY_MAX_ENTRIES)
+		goto out;
+
+	h->entries = os_calloc(num, sizeof(struct scan_history_entry));
+	if (num && h->entries == NULL)
+		goto out;
+
+	os_get_time(&now);
+	for (i = 0; i < num; i++) {
+		struct scan_history_entry *e = &h->entries[h->num_entries];
+
+		if (end - pos < SCAN_HISTORY_ENTRY_LEN)
+			goto out;
+		e->ess = WPA_GET_LE32(pos);
+		pos += 4;
+		os_memcpy(e->loc, pos, ETH_ALEN);
+		pos += ETH_ALEN;
+		e->last_seen = WPA_GET_LE32(pos);
+		pos += 4;
+		e->num_freqs = *pos++;
+		if (e->num_freqs > SCAN_HISTORY_MAX_FREQS ||
+		    end - pos < e->num_freqs * 3)
+			goto out;
+		for (j = 0; j < e->num_freqs; j++) {
+			e->freqs[j].freq = WPA_GET_LE16(pos);
+			e->freqs[j].hits = pos[2];
+			pos += 3;
+		}
+		if ((u32) now.sec > e->last_seen &&
+		    (u32) now.sec - e->last_seen > SCAN_HISTORY_MAX_AGE)
+			continue; /* expired */
+		h->num_entries++;
+	}
+	ret = 0;
+
+out:
+	os_free(buf);
+	if (ret < 0) {
+		wpa_printf(MSG_INFO, "Scan history: Ignore invalid history "
+			   "file %s", h->fname);
+		os_free(h->entries);
+		h->entries = NULL;
+		h->num_entries = 0;
+		os_memset(h->anchor, 0, ETH_ALEN);
+		h->full_scan_usec = 0;
+		return -1;
+	}
+
+	wpa_printf(MSG_DEBUG, "Scan history: Loaded %u entries from %s",
+		   h->num_entries, h->fname);
+	return 0;
+}
+
+
+static void scan_history_save(struct scan_history *h)
+{
+	struct wpabuf *buf;
+	char *tmp;
+	size_t len;
+	unsigned int i, j;
+	FILE *f;
+	int ok;
+#ifndef CONFIG_NATIVE_WINDOWS
+	int fd;
+#endif /* CONFIG_NATIVE_WINDOWS */
+
+	if (h->fname == NULL)
+		return;
+
+	buf = wpabuf_alloc(SCAN_HISTORY_HDR_LEN + h->num_entries *
+			   (SCAN_HISTORY_ENTRY_LEN +
+			    SCAN_HISTORY_MAX_FREQS * 3));
+	len = os_strlen(h->fname) + 5;
+	tmp = os_malloc(len);
+	if (buf == NULL || tmp == NULL) {
+		wpabuf_free(buf);
+		os_free(tmp);
+		return;
+	}
+
+	wpabuf_put_data(buf, "WSH", 3);
+	wpabuf_put_u8(buf, SCAN_HISTORY_VERSION);
+	wpabuf_put_data(buf, h->anchor, ETH_ALEN);
+	wpabuf_put_le32(buf, h->full_scan_usec / 1000);
+	wpabuf_put_le16(buf, h->num_entries);
+	for (i = 0; i < h->num_entries; i++) {
+		struct scan_history_entry *e = &h->entries[i];
+
+		wpabuf_put_le32(buf, e->ess);
+		wpabuf_put_data(buf, e->loc, ETH_ALEN);
+		wpabuf_put_le32(buf, e->last_seen);
+		wpabuf_put_u8(buf, e->num_freqs);
+		for (j = 0; j < e->num_freqs; j++) {
+			wpabuf_put_le16(buf, e->freqs[j].freq);
+			wpabuf_put_u8(buf, e->freqs[j].hits);
+		}
+	}
+
+	/* Write to a temporary file first to not lose the history on errors */
+	os_snprintf(tmp, len, "%s.tmp", h->fname);
+#ifndef CONFIG_NATIVE_WINDOWS
+	/* The history reveals the locations of the device */
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd >= 0 && fchmod(fd, S_IRUSR | S_IWUSR) < 0) {
+		close(fd);
+		fd = -1;
+		unlink(tmp);
+	}
+	f = fd >= 0 ? fdopen(fd, "wb") : NULL;
+	if (f == NULL && fd >= 0)
+		close(fd);
+#else /* CONFIG_NATIVE_WINDOWS */
+	f = fopen(tmp, "wb");
+#endif /* CONFIG_NATIVE_WINDOWS */
+	if (f == NULL) {
+		wpa_printf(MSG_DEBUG, "Scan history: Could not open %s: %s",
+			   tmp, strerror(errno));
+		goto out;
+	}
+	ok = fwrite(wpabuf_head(buf), 1, wpabuf_len(buf), f) ==
+		wpabuf_len(buf);
+	if (fclose(f) != 0 || !ok || rename(tmp, h->fname) < 0) {
+		wpa_printf(MSG_DEBUG, "Scan history: Failed to write %s",
+			   h->fname);
+		unlink(tmp);
+		goto out;
+	}
+	h->dirty = 0;
+	wpa_printf(MSG_DEBUG, "Scan history: Saved %u entries to %s",
+		   h->num_entries, h->fname);
+
+out:
+	wpabuf_free(buf);
+	os_free(tmp);
+}
+
+
+/**
+ * scan_history_init - Initialize the channel history of an interface
+ * @wpa_s: Pointer to wpa_supplicant data
+ * Returns: 0 on success (or if not enabled), -1 on failure
+ *
+ * The history is enabled with the scan_history configuration parameter and
+ * loaded from the file it names.
+ */
+int scan_history_init(struct wpa_supplicant *wpa_s)
+{
+	struct scan_history *h;
+
+	if (wpa_s->conf->scan_history == NULL || wpa_s->scan_history)
+		return 0;
+
+	h = os_zalloc(sizeof(*h));
+	if (h == NULL)
+		return -1;
+	h->fname = os_strdup(wpa_s->conf->scan_history);
+	if (h->fname == NULL) {
+		os_free(h);
+		return -1;
+	}
+	h->scan_stage = -1;
+	h->loc_num_freqs = -1;
+	scan_history_load(h);
+	wpa_s->scan_history = h;
+
+	return 0;
+}
+
+
+/**
+ * scan_history_deinit - Save and free the channel history of an interface
+ * @wpa_s: Pointer to wpa_supplicant data
+ */
+void scan_history_deinit(struct wpa_supplicant *wpa_s)
+{
+	struct scan_history *h = wpa_s->scan_history;
+
+	if (h == NULL)
+		return;
+
+	if (h->dirty)
+		scan_history_save(h);
+	wpa_s->scan_history = NULL;
+	os_free(h->entries);
+	os_free(h->fname);
+	os_free(h);
+}
+
+
+/*
+ * Collect the channels of the enabled networks for the location (or for all
+ * locations if loc == NULL). Returns the number of channels or -1 if the
+ * enabled networks cannot be found based on the history.
+ */
+static int scan_history_get_freqs(struct wpa_supplicant *wpa_s,
+				  struct scan_history *h, const u8 *loc,
+				  int **freqs)
+{
+	u32 *ess;
+	size_t num_ess;
+	int *res = NULL, *n, passive, unplannable = 0;
+	int count = 0, alloc = 0, k;
+	unsigned int i, j;
+
+	*freqs = NULL;
+	ess = scan_history_conf_ess(wpa_s, 1, &num_ess, &unplannable);
+	if (ess == NULL)
+		return -1;
+	if (unplannable || num_ess == 0) {
+		os_free(ess);
+		return -1;
+	}
+
+	for (i = 0; i < h->num_entries; i++) {
+		struct scan_history_entry *e = &h->entries[i];
+
+		if (loc && os_memcmp(e->loc, loc, ETH_ALEN) != 0)
+			continue;
+		if (!scan_history_ess_in(ess, num_ess, e->ess))
+			continue;
+
+		for (j = 0; j < e->num_freqs; j++) {
+			for (k = 0; k < count; k++) {
+				if (res[k] == e->freqs[j].freq)
+					break;
+			}
+			if (k < count ||
+			    !scan_history_chan_usable(wpa_s, e->freqs[j].freq,
+						      &passive))
+				continue;
+			if (count + 1 >= alloc) {
+				alloc = alloc ? 2 * alloc : 16;
+				n = os_realloc_array(res, alloc, sizeof(int));
+				if (n == NULL) {
+					os_free(res);
+					os_free(ess);
+					return -1;
+				}
+				res = n;
+			}
+			res[count++] = e->freqs[j].freq;
+			res[count] = 0;
+		}
+	}
+	os_free(ess);
+
+	*freqs = res;
+	return count;
+}
+
+
+/**
+ * scan_history_plan - Select channels for a connection scan
+ * @wpa_s: Pointer to wpa_supplicant data
+ * Returns: Allocated zero terminated frequency list for a partial scan or
+ * %NULL for a full scan
+ *
+ * This is called for connection scans that are not otherwise limited to
+ * specific channels. The result of the scan needs to be reported with
+ * scan_history_scan_done() to move from the partial scans to a full scan
+ * if no network was found.
+ */
+int * scan_history_plan(struct wpa_supplicant *wpa_s)
+{
+	struct scan_history *h = wpa_s->scan_history;
+	unsigned int num_chan;
+	int *freqs = NULL;
+	int num, fallback;
+
+	if (h == NULL)
+		return NULL;
+
+	scan_history_full_scan_cost(wpa_s, &num_chan);
+	fallback = h->stage != SCAN_HISTORY_LOCATION;
+
+	while (h->stage < SCAN_HISTORY_FULL) {
+		num = scan_history_get_freqs(
+			wpa_s, h, h->stage == SCAN_HISTORY_LOCATION ?
+			h->anchor : NULL, &freqs);
+		if (num < 0) {
+			h->stage = SCAN_HISTORY_FULL;
+			break;
+		}
+		if (h->stage == SCAN_HISTORY_LOCATION)
+			h->loc_num_freqs = num;
+		/*
+		 * The ESS stage covers the location stage, so the same number
+		 * of channels means that the ESS stage would not scan anything
+		 * new.
+		 */
+		if (num > 0 && (num_chan == 0 || (unsigned int) num < num_chan) &&
+		    (h->stage == SCAN_HISTORY_LOCATION ||
+		     num != h->loc_num_freqs))
+			break;
+		os_free(freqs);
+		freqs = NULL;
+		h->stage++;
+	}
+
+	h->scan_stage = h->stage;
+	if (freqs == NULL) {
+		h->stage = SCAN_HISTORY_LOCATION;
+		if (fallback)
+			h->stats.fallback_scans++;
+		wpa_dbg(wpa_s, MSG_DEBUG, "Scan history: Full scan%s",
+			fallback ? " (partial scans did not find a network)" :
+			"");
+		return NULL;
+	}
+
+	h->stats.partial_scans++;
+	wpa_dbg(wpa_s, MSG_DEBUG, "Scan history: Scan %d of %u channels "
+		"known for the %s", int_array_len(freqs), num_chan,
+		h->stage == SCAN_HISTORY_LOCATION ? "location" : "networks");
+
+	return freqs;
+}
+
+
+/**
+ * scan_history_scan_results - Record the channels from new scan results
+ * @wpa_s: Pointer to wpa_supplicant data
+ *
+ * This is called after the BSS table has been updated with new scan results
+ * to record the channels of the BSSes that belong to the configured networks.
+ */
+void scan_history_scan_results(struct wpa_supplicant *wpa_s)
+{
+	struct scan_history *h = wpa_s->scan_history;
+	u32 *ess;
+	size_t num_ess;
+
+	if (h == NULL)
+		return;
+
+	ess = scan_history_conf_ess(wpa_s, 0, &num_ess, NULL);
+	if (ess == NULL)
+		return;
+	if (num_ess)
+		scan_history_record(wpa_s, h, ess, num_ess, h->anchor);
+	os_free(ess);
+}
+
+
+/**
+ * scan_history_scan_done - Report the result of a connection scan
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @selected: The BSS selected for connection or %NULL if none was found
+ *
+ * This is called after the network selection for own scan results.
+ */
+void scan_history_scan_done(struct wpa_supplicant *wpa_s,
+			    struct wpa_bss *selected)
+{
+	struct scan_history *h = wpa_s->scan_history;
+	struct os_reltime now, diff;
+	unsigned int usec, full_usec;
+	u32 *ess;
+	size_t num_ess;
+
+	if (h == NULL || h->scan_stage < 0 ||
+	    wpa_s->last_scan_req != NORMAL_SCAN_REQ)
+		return;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &wpa_s->scan_trigger_time, &diff);
+	usec = diff.sec * 1000000 + diff.usec;
+
+	if (h->scan_stage == SCAN_HISTORY_FULL) {
+		h->stats.full_scans++;
+		h->full_scan_usec = h->full_scan_usec ?
+			(3 * h->full_scan_usec + usec) / 4 : usec;
+		h->stage = SCAN_HISTORY_LOCATION;
+	} else if (selected) {
+		full_usec = h->full_scan_usec ? h->full_scan_usec :
+			scan_history_full_scan_cost(wpa_s, NULL);
+		h->stats.partial_hits++;
+		if (full_usec > usec)
+			h->stats.saved_usec += full_usec - usec;
+		h->stage = SCAN_HISTORY_LOCATION;
+	} else {
+		h->stats.wasted_usec += usec;
+		h->stage = h->scan_stage + 1;
+	}
+	h->scan_stage = -1;
+
+	if (selected == NULL)
+		return;
+
+	if (os_memcmp(h->anchor, selected->bssid, ETH_ALEN) != 0) {
+		/* New location; record the channels seen around it */
+		os_memcpy(h->anchor, selected->bssid, ETH_ALEN);
+		h->loc_num_freqs = -1;
+		h->dirty = 1;
+		ess = scan_history_conf_ess(wpa_s, 0, &num_ess, NULL);
+		if (ess && num_ess)
+			scan_history_record(wpa_s, h, ess, num_ess, h->anchor);
+		os_free(ess);
+	}
+	if (h->dirty)
+		scan_history_save(h);
+}
+
+
+/**
+ * scan_history_get_stats - Get channel history scan planner statistics
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @stats: Buffer for returning the statistics
+ */
+void scan_history_get_stats(struct wpa_supplicant *wpa_s,
+			    struct scan_history_stats *stats)
+{
+	struct scan_history *h = wpa_s->scan_history;
+
+	os_memset(stats, 0, sizeof(*stats));
+	if (h == NULL)
+		return;
+	*stats = h->stats;
+	stats->entries = h->num_entries;
+}
+
+
+/**
+ * scan_history_get_status - Get channel history status for STATUS command
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @buf: Buffer for status information
+ * @buflen: Maximum buffer length
+ * @verbose: Whether to include verbose status information
+ * Returns: Number of bytes written to buf
+ */
+int scan_history_get_status(struct wpa_supplicant *wpa_s, char *buf,
+			    size_t buflen, int verbose)
+{
+	struct scan_history_stats stats;
+	int ret;
+
+	if (!verbose || wpa_s->scan_history == NULL)
+		return 0;
+
+	scan_history_get_stats(wpa_s, &stats);
+	ret = os_snprintf(buf, buflen,
+			  "scan_history_entries=%u\n"
+			  "scan_history_partial_scans=%u\n"
+			  "scan_history_partial_hits=%u\n"
+			  "scan_history_fallback_scans=%u\n"
+			  "scan_history_full_scans=%u\n"
+			  "scan_history_saved_msec=%llu\n"
+			  "scan_history_wasted_msec=%llu\n",
+			  stats.entries, stats.partial_scans,
+			  stats.partial_hits, stats.fallback_scans,
+			  stats.full_scans, stats.saved_usec / 1000,
+			  stats.wasted_usec / 1000);
+	if (ret < 0 || (size_t) ret >= buflen)
+		return 0;
+
+	return ret;
+}
@@ -0,0 +1,86 @@
+/*
+ * wpa_supplicant - Channel history for partial connection scans
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef SCAN_HISTORY_H
+#define SCAN_HISTORY_H
+
+struct wpa_supplicant;
+struct wpa_bss;
+
+/**
+ * struct scan_history_stats - Channel history scan planner statistics
+ * @entries: Number of ESS/location entries in the channel history
+ * @partial_scans: Number of connection scans limited to the channels from
+ *	the history
+ * @partial_hits: Number of partial scans that found a network to connect to
+ * @fallback_scans: Number of full scans done because the partial scans did
+ *	not find a network
+ * @full_scans: Total number of full connection scans
+ * @saved_usec: Estimated scan time (in microseconds) saved by the successful
+ *	partial scans compared to a full scan
+ * @wasted_usec: Time (in microseconds) used for partial scans that did not
+ *	find a network
+ */
+struct scan_history_stats {
+	unsigned int entries;
+	unsigned int partial_scans;
+	unsigned int partial_hits;
+	unsigned int fallback_scans;
+	unsigned int full_scans;
+	unsigned long long saved_usec;
+	unsigned long long wasted_usec;
+};
+
+#ifdef CONFIG_SCAN_HISTORY
+
+int scan_history_init(struct wpa_supplicant *wpa_s);
+void scan_history_deinit(struct wpa_supplicant *wpa_s);
+int * scan_history_plan(struct wpa_supplicant *wpa_s);
+void scan_history_scan_results(struct wpa_supplicant *wpa_s);
+void scan_history_scan_done(struct wpa_supplicant *wpa_s,
+			    struct wpa_bss *selected);
+void scan_history_get_stats(struct wpa_supplicant *wpa_s,
+			    struct scan_history_stats *stats);
+int scan_history_get_status(struct wpa_supplicant *wpa_s, char *buf,
+			    size_t buflen, int verbose);
+
+#else /* CONFIG_SCAN_HISTORY */
+
+static inline int scan_history_init(struct wpa_supplicant *wpa_s)
+{
+	return 0;
+}
+
+static inline void scan_history_deinit(struct wpa_supplicant *wpa_s)
+{
+}
+
+static inline int * scan_history_plan(struct wpa_supplicant *wpa_s)
+{
+	return NULL;
+}
+
+static inline void scan_history_scan_results(struct wpa_supplicant *wpa_s)
+{
+}
+
+static inline void scan_history_scan_done(struct wpa_supplicant *wpa_s,
+					  struct wpa_bss *selected)
+{
+}
+
+static inline int scan_history_get_status(struct wpa_supplicant *wpa_s,
+					  char *buf, size_t buflen,
+					  int verbose)
+{
+	return 0;
+}
+
+#endif /* CONFIG_SCAN_HISTORY */
+
+#endif /* SCAN_HISTORY_H */
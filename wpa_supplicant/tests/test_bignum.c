@@ -0,0 +1,131 @@
+/*
+ * Test program and benchmark for bignum modular exponentiation
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This compares the Montgomery reduction based exponentiation (used for all
+ * odd moduli, i.e., RSA and DH) against the Barrett reduction based
+ * s_mp_exptmod() with pseudo-random full length operands and reports the
+ * time used by each. Build with and without CONFIG_INTERNAL_LIBTOMMATH_FAST=y
+ * to see the effect of the comba multiplication/squaring/reduction routines.
+ */
+
+#include "tls/bignum.c"
+#include "utils/os.h"
+
+
+#ifdef CONFIG_INTERNAL_LIBTOMMATH
+
+static u32 test_rnd_state = 0x12345678;
+
+static void test_rnd(u8 *buf, size_t len)
+{
+	size_t i;
+
+	/* xorshift32 - reproducible operands, not for cryptographic use */
+	for (i = 0; i < len; i++) {
+		test_rnd_state ^= test_rnd_state << 13;
+		test_rnd_state ^= test_rnd_state >> 17;
+		test_rnd_state ^= test_rnd_state << 5;
+		buf[i] = test_rnd_state & 0xff;
+	}
+}
+
+
+static unsigned int test_usec(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static int test_exptmod(int bits, int iter)
+{
+	u8 buf[3072 / 8];
+	size_t len = bits / 8;
+	mp_int v[5];
+	mp_int *g = &v[0], *x = &v[1], *p = &v[2], *y1 = &v[3], *y2 = &v[4];
+	struct os_reltime start;
+	unsigned int t_barrett, t_mont;
+	int i, ret = 1;
+
+	os_memset(v, 0, sizeof(v));
+	for (i = 0; i < 5; i++) {
+		if (mp_init(&v[i]) != MP_OKAY)
+			goto fail;
+	}
+
+	/* odd modulus with the top bit set, full length exponent */
+	test_rnd(buf, len);
+	buf[0] |= 0x80;
+	buf[len - 1] |= 0x01;
+	if (mp_read_unsigned_bin(p, buf, len) != MP_OKAY)
+		goto fail;
+	test_rnd(buf, len);
+	buf[0] |= 0x80;
+	if (mp_read_unsigned_bin(x, buf, len) != MP_OKAY)
+		goto fail;
+	test_rnd(buf, len);
+	buf[0] &= 0x7f;
+	if (mp_read_unsigned_bin(g, buf, len) != MP_OKAY)
+		goto fail;
+
+	os_get_reltime(&start);
+	for (i = 0; i < iter; i++) {
+		if (s_mp_exptmod(g, x, p, y1, 0) != MP_OKAY)
+			goto fail;
+	}
+	t_barrett = test_usec(&start) / iter;
+
+	os_get_reltime(&start);
+	for (i = 0; i < iter; i++) {
+		if (mp_exptmod(g, x, p, y2) != MP_OKAY)
+			goto fail;
+	}
+	t_mont = test_usec(&start) / iter;
+
+	if (mp_cmp(y1, y2) != MP_EQ) {
+		printf("%d-bit exptmod: result mismatch\n", bits);
+		goto fail;
+	}
+
+	printf("%d-bit exptmod: Barrett %u usec, Montgomery %u usec\n",
+	       bits, t_barrett, t_mont);
+	ret = 0;
+fail:
+	for (i = 0; i < 5; i++)
+		mp_clear(&v[i]);
+	return ret;
+}
+
+#endif /* CONFIG_INTERNAL_LIBTOMMATH */
+
+
+int main(int argc, char *argv[])
+{
+	int errors = 0;
+	int iter = argc > 1 ? atoi(argv[1]) : 1;
+
+	if (iter < 1)
+		iter = 1;
+
+#ifdef CONFIG_INTERNAL_LIBTOMMATH
+#ifdef LTM_FAST
+	printf("Testing bignum exptmod (LTM_FAST)\n");
+#else /* LTM_FAST */
+	printf("Testing bignum exptmod\n");
+#endif /* LTM_FAST */
+	errors += test_exptmod(1024, iter);
+	errors += test_exptmod(2048, iter);
+	errors += test_exptmod(3072, iter);
+#else /* CONFIG_INTERNAL_LIBTOMMATH */
+	printf("CONFIG_INTERNAL_LIBTOMMATH not used - nothing to test\n");
+#endif /* CONFIG_INTERNAL_LIBTOMMATH */
+
+	return errors;
+}
@@ -0,0 +1,644 @@
+/*
+ * Test program and microbenchmark for the internal crypto implementation
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This verifies the internal AES implementation against the FIPS-197 test
+ * vectors and AES-GCM against the test cases from the GCM specification,
+ * both with the table based code and with the AES and carry-less multiply
+ * instructions (if supported by the CPU), and reports the throughput of
+ * single block, multi block ECB, CTR, and GCM encryption. SHA-1 and SHA-256
+ * are tested in the same way with the portable code, the SHA instructions,
+ * and the SIMD lanes used for processing multiple messages.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "crypto/crypto.h"
+#include "crypto/aes_i.h"
+#include "crypto/aes_wrap.h"
+#include "crypto/sha1.h"
+#include "crypto/sha1_i.h"
+#include "crypto/sha256.h"
+#include "crypto/sha256_i.h"
+#include "crypto/aes-gcm.c"
+
+
+#define BENCH_LEN 16384
+
+struct aes_test_vector {
+	size_t key_len;
+	const char *ct;
+};
+
+/* FIPS-197, Appendix C */
+static const struct aes_test_vector aes_tests[] = {
+	{ 16, "69c4e0d86a7b0430d8cdb78070b4c55a" },
+	{ 24, "dda97ca4864cdfe06eaf70a0ec0d7191" },
+	{ 32, "8ea2b7ca516745bfeafc49904b496089" },
+};
+
+
+struct gcm_test_vector {
+	const char *key;
+	const char *iv;
+	const char *plain;
+	const char *aad;
+	const char *crypt;
+	const char *tag;
+};
+
+/* Test cases 2, 4, and 6 from "The Galois/Counter Mode of Operation (GCM)" */
+static const struct gcm_test_vector gcm_tests[] = {
+	{
+		"00000000000000000000000000000000",
+		"000000000000000000000000",
+		"00000000000000000000000000000000",
+		"",
+		"0388dace60b6a392f328c2b971b2fe78",
+		"ab6e47d42cec13bdf53a67b21257bddf"
+	},
+	{
+		"feffe9928665731c6d6a8f9467308308",
+		"cafebabefacedbaddecaf888",
+		"d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+		"1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+		"feedfacedeadbeeffeedfacedeadbeefabaddad2",
+		"42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+		"21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+		"5bc94fbc3221a5db94fae95ae7121a47"
+	},
+	{
+		"feffe9928665731c6d6a8f9467308308",
+		"9313225df88406e555909c5aff5269aa6a7a9538534f7da1e4c303d2a318a728"
+		"c3c0c95156809539fcf0e2429a6b525416aedbf5a0de6a57a637b39b",
+		"d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+		"1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+		"feedfacedeadbeeffeedfacedeadbeefabaddad2",
+		"8ce24998625615b603a033aca13fb894be9112a5c3a211a8ba262a3cca7e2ca7"
+		"01e4a9a4fba43c90ccdcb281d48c7c6fd62875d2aca417034c34aee5",
+		"619cc5aefffe0bfa462af43c1699d050"
+	},
+};
+
+
+struct sha_test_vector {
+	const char *key; /* NULL for plain hash */
+	size_t key_len;
+	const char *msg;
+	const char *sha1;
+	const char *sha256;
+};
+
+/* FIPS 180-2 examples; RFC 2202 and RFC 4231 test cases 1 and 6 */
+static const struct sha_test_vector sha_tests[] = {
+	{
+		NULL, 0, "abc",
+		"a9993e364706816aba3e25717850c26c9cd0d89d",
+		"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"
+	},
+	{
+		NULL, 0, "",
+		"da39a3ee5e6b4b0d3255bfef95601890afd80709",
+		"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"
+	},
+	{
+		NULL, 0,
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+		"84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+		"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"
+	},
+	{
+		NULL, 0,
+		"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+		"hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+		"a49b2446a02c645bf419f995b67091253a04a259",
+		"cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"
+	},
+	{
+		"\x0b", 20, "Hi There",
+		"b617318655057264e28bc0b6fb378c8ef146be00",
+		"b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"
+	},
+	{
+		"\xaa", 131,
+		"Test Using Larger Than Block-Size Key - Hash Key First",
+		NULL,
+		"60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"
+	},
+	{
+		"\xaa", 80,
+		"Test Using Larger Than Block-Size Key - Hash Key First",
+		"aa4ae5e15272d00e95705637ce8a3b55ed402112",
+		NULL
+	},
+};
+
+#define SHA_MULTI_NUM 37
+
+
+static void test_hw_enable(int enabled)
+{
+	aes_hw_enable(enabled);
+#ifdef GHASH_HW
+	ghash_hw_enabled = enabled;
+#endif /* GHASH_HW */
+	sha1_hw_enable(enabled);
+	sha256_hw_enable(enabled);
+}
+
+
+static unsigned int test_usec(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static unsigned int test_mbps(size_t len, int rounds, unsigned int usec)
+{
+	if (usec == 0)
+		usec = 1;
+	return (unsigned long long) len * rounds / usec;
+}
+
+
+static int test_aes_vectors(void)
+{
+	u8 key[32], pt[AES_BLOCK_SIZE], ct[AES_BLOCK_SIZE], buf[AES_BLOCK_SIZE];
+	void *ctx;
+	unsigned int i;
+	int errors = 0;
+
+	for (i = 0; i < sizeof(key); i++)
+		key[i] = i;
+	for (i = 0; i < sizeof(pt); i++)
+		pt[i] = i * 0x11;
+
+	for (i = 0; i < ARRAY_SIZE(aes_tests); i++) {
+		const struct aes_test_vector *t = &aes_tests[i];
+
+		hexstr2bin(t->ct, ct, sizeof(ct));
+
+		ctx = aes_encrypt_init(key, t->key_len);
+		if (ctx == NULL)
+			return 1;
+		aes_encrypt(ctx, pt, buf);
+		aes_encrypt_deinit(ctx);
+		if (os_memcmp(buf, ct, sizeof(ct)) != 0) {
+			printf("AES-%u encrypt test vector failed\n",
+			       (unsigned int) t->key_len * 8);
+			errors++;
+		}
+
+		ctx = aes_decrypt_init(key, t->key_len);
+		if (ctx == NULL)
+			return 1;
+		aes_decrypt(ctx, ct, buf);
+		aes_decrypt_deinit(ctx);
+		if (os_memcmp(buf, pt, sizeof(pt)) != 0) {
+			printf("AES-%u decrypt test vector failed\n",
+			       (unsigned int) t->key_len * 8);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+
+static int test_aes_blocks(const u8 *data, u8 *out, u8 *out2)
+{
+	u8 key[32];
+	void *ctx;
+	size_t i, key_len;
+
+	/* Multi block output must match block-by-block encryption */
+	for (key_len = 16; key_len <= 32; key_len += 8) {
+		os_memcpy(key, data + 100, key_len);
+		ctx = aes_encrypt_init(key, key_len);
+		if (ctx == NULL)
+			return 1;
+		aes_encrypt_blocks(ctx, data, out, 37);
+		for (i = 0; i < 37; i++)
+			aes_encrypt(ctx, data + i * AES_BLOCK_SIZE,
+				    out2 + i * AES_BLOCK_SIZE);
+		aes_encrypt_deinit(ctx);
+		if (os_memcmp(out, out2, 37 * AES_BLOCK_SIZE) != 0) {
+			printf("AES-%u multi block encryption mismatch\n",
+			       (unsigned int) key_len * 8);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+static int test_aes_speed(const char *name, const u8 *data, u8 *out,
+			  int rounds)
+{
+	static const u8 key[16] = {
+		0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+		0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+	};
+	struct os_reltime start;
+	unsigned int t_block, t_ecb, t_ctr;
+	void *ctx;
+	size_t i;
+	int r;
+
+	ctx = aes_encrypt_init(key, sizeof(key));
+	if (ctx == NULL)
+		return 1;
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < BENCH_LEN; i += AES_BLOCK_SIZE)
+			aes_encrypt(ctx, data + i, out + i);
+	}
+	t_block = test_usec(&start);
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++)
+		aes_encrypt_blocks(ctx, data, out, BENCH_LEN / AES_BLOCK_SIZE);
+	t_ecb = test_usec(&start);
+
+	aes_encrypt_deinit(ctx);
+
+	os_memcpy(out, data, BENCH_LEN);
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		if (aes_128_ctr_encrypt(key, data, out, BENCH_LEN))
+			return 1;
+	}
+	t_ctr = test_usec(&start);
+
+	printf("AES-128 (%s): aes_encrypt %u MB/s, ECB %u MB/s, CTR %u MB/s\n",
+	       name, test_mbps(BENCH_LEN, rounds, t_block),
+	       test_mbps(BENCH_LEN, rounds, t_ecb),
+	       test_mbps(BENCH_LEN, rounds, t_ctr));
+	return 0;
+}
+
+
+static size_t test_hex(const char *hex, u8 *buf)
+{
+	size_t len = os_strlen(hex) / 2;
+
+	hexstr2bin(hex, buf, len);
+	return len;
+}
+
+
+static int test_gcm_vectors(void)
+{
+	u8 key[32], iv[64], plain[64], aad[32], crypt[64], tag[16];
+	u8 out[64], out_tag[16];
+	size_t key_len, iv_len, plain_len, aad_len;
+	unsigned int i;
+	int errors = 0;
+
+	for (i = 0; i < ARRAY_SIZE(gcm_tests); i++) {
+		const struct gcm_test_vector *t = &gcm_tests[i];
+
+		key_len = test_hex(t->key, key);
+		iv_len = test_hex(t->iv, iv);
+		plain_len = test_hex(t->plain, plain);
+		aad_len = test_hex(t->aad, aad);
+		test_hex(t->crypt, crypt);
+		test_hex(t->tag, tag);
+
+		if (aes_gcm_ae(key, key_len, iv, iv_len, plain, plain_len,
+			       aad, aad_len, out, out_tag) < 0 ||
+		    os_memcmp(out, crypt, plain_len) != 0 ||
+		    os_memcmp(out_tag, tag, sizeof(tag)) != 0) {
+			printf("AES-GCM-AE test vector %u failed\n", i);
+			errors++;
+		}
+
+		if (aes_gcm_ad(key, key_len, iv, iv_len, crypt, plain_len,
+			       aad, aad_len, tag, out) < 0 ||
+		    os_memcmp(out, plain, plain_len) != 0) {
+			printf("AES-GCM-AD test vector %u failed\n", i);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+
+static int test_gcm_lengths(const u8 *data, u8 *out, u8 *out2)
+{
+	static const u8 key[16] = {
+		0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+		0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+	};
+	u8 tag[16], tag2[16];
+	size_t len;
+
+	/*
+	 * Compare the table and instruction based GHASH for lengths that cover
+	 * all remainders of the four block aggregation and partial blocks.
+	 */
+	for (len = 0; len <= 300; len += 7) {
+		test_hw_enable(0);
+		if (aes_gcm_ae(key, sizeof(key), data, 12, data + 1000, len,
+			       data + 2000, len % 37, out, tag) < 0)
+			return 1;
+		test_hw_enable(1);
+		if (aes_gcm_ae(key, sizeof(key), data, 12, data + 1000, len,
+			       data + 2000, len % 37, out2, tag2) < 0 ||
+		    os_memcmp(out, out2, len) != 0 ||
+		    os_memcmp(tag, tag2, sizeof(tag)) != 0 ||
+		    aes_gcm_ad(key, sizeof(key), data, 12, out2, len,
+			       data + 2000, len % 37, tag2, out2) < 0 ||
+		    os_memcmp(out2, data + 1000, len) != 0) {
+			printf("AES-GCM mismatch with %u octet message\n",
+			       (unsigned int) len);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+static int test_gcm_speed(const char *name, const u8 *data, u8 *out,
+			  int rounds)
+{
+	static const u8 key[16] = {
+		0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+		0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+	};
+	struct os_reltime start;
+	unsigned int t_gcm, t_gmac;
+	u8 tag[16];
+	int r;
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		if (aes_gcm_ae(key, sizeof(key), data, 12, data, BENCH_LEN,
+			       NULL, 0, out, tag) < 0)
+			return 1;
+	}
+	t_gcm = test_usec(&start);
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		if (aes_gmac(key, sizeof(key), data, 12, data, BENCH_LEN,
+			     tag) < 0)
+			return 1;
+	}
+	t_gmac = test_usec(&start);
+
+	printf("AES-128-GCM (%s): GCM %u MB/s, GMAC %u MB/s\n",
+	       name, test_mbps(BENCH_LEN, rounds, t_gcm),
+	       test_mbps(BENCH_LEN, rounds, t_gmac));
+	return 0;
+}
+
+
+static int test_sha_vectors(void)
+{
+	u8 key[131], expected[SHA256_MAC_LEN], mac[SHA256_MAC_LEN];
+	const u8 *addr, *kaddr = key;
+	u8 *res = mac;
+	size_t len, key_len;
+	unsigned int i;
+	int errors = 0;
+
+	for (i = 0; i < ARRAY_SIZE(sha_tests); i++) {
+		const struct sha_test_vector *t = &sha_tests[i];
+
+		addr = (const u8 *) t->msg;
+		len = os_strlen(t->msg);
+		key_len = t->key_len;
+		if (t->key)
+			os_memset(key, t->key[0], key_len);
+
+		if (t->sha1) {
+			hexstr2bin(t->sha1, expected, SHA1_MAC_LEN);
+			if (t->key)
+				hmac_sha1_multi(&kaddr, &key_len, &addr, &len,
+						&res, 1);
+			else
+				sha1_vector(1, &addr, &len, mac);
+			if (os_memcmp(mac, expected, SHA1_MAC_LEN) != 0) {
+				printf("SHA-1 test vector %u failed\n", i);
+				errors++;
+			}
+		}
+
+		if (t->sha256) {
+			hexstr2bin(t->sha256, expected, SHA256_MAC_LEN);
+			if (t->key)
+				hmac_sha256_multi(&kaddr, &key_len, &addr,
+						  &len, &res, 1);
+			else
+				sha256_vector(1, &addr, &len, mac);
+			if (os_memcmp(mac, expected, SHA256_MAC_LEN) != 0) {
+				printf("SHA-256 test vector %u failed\n", i);
+				errors++;
+			}
+		}
+	}
+
+	return errors;
+}
+
+
+static void test_hmac_sha256(const u8 *key, size_t key_len, const u8 *data,
+			     size_t data_len, u8 *mac)
+{
+	u8 k_pad[64], tk[SHA256_MAC_LEN];
+	const u8 *addr[2];
+	size_t len[2];
+	size_t i;
+
+	if (key_len > 64) {
+		sha256_vector(1, &key, &key_len, tk);
+		key = tk;
+		key_len = SHA256_MAC_LEN;
+	}
+	os_memset(k_pad, 0, sizeof(k_pad));
+	os_memcpy(k_pad, key, key_len);
+	for (i = 0; i < 64; i++)
+		k_pad[i] ^= 0x36;
+	addr[0] = k_pad;
+	len[0] = 64;
+	addr[1] = data;
+	len[1] = data_len;
+	sha256_vector(2, addr, len, mac);
+
+	for (i = 0; i < 64; i++)
+		k_pad[i] ^= 0x36 ^ 0x5c;
+	addr[1] = mac;
+	len[1] = SHA256_MAC_LEN;
+	sha256_vector(2, addr, len, mac);
+}
+
+
+static int test_sha_multi(const u8 *data)
+{
+	const u8 *key[SHA_MULTI_NUM], *addr[SHA_MULTI_NUM];
+	size_t key_len[SHA_MULTI_NUM], len[SHA_MULTI_NUM];
+	u8 mac[SHA_MULTI_NUM][SHA256_MAC_LEN], *res[SHA_MULTI_NUM];
+	u8 expected[SHA256_MAC_LEN];
+	struct hmac_sha1_ctx ctx;
+	size_t i;
+
+	/* Keys and messages of different lengths so that the messages need
+	 * different numbers of blocks */
+	for (i = 0; i < SHA_MULTI_NUM; i++) {
+		key[i] = data + 1000 + i;
+		key_len[i] = (i * 13) % 100 + 1;
+		addr[i] = data + i;
+		len[i] = (i * 29) % 200;
+		res[i] = mac[i];
+	}
+
+	if (hmac_sha1_multi(key, key_len, addr, len, res, SHA_MULTI_NUM))
+		return 1;
+	for (i = 0; i < SHA_MULTI_NUM; i++) {
+		hmac_sha1_init(&ctx, key[i], key_len[i]);
+		hmac_sha1_ctx_vector(&ctx, 1, &addr[i], &len[i], expected);
+		hmac_sha1_deinit(&ctx);
+		if (os_memcmp(mac[i], expected, SHA1_MAC_LEN) != 0) {
+			printf("HMAC-SHA1 multi-message mismatch for message "
+			       "%u\n", (unsigned int) i);
+			return 1;
+		}
+	}
+
+	if (hmac_sha256_multi(key, key_len, addr, len, res, SHA_MULTI_NUM))
+		return 1;
+	for (i = 0; i < SHA_MULTI_NUM; i++) {
+		test_hmac_sha256(key[i], key_len[i], addr[i], len[i],
+				 expected);
+		if (os_memcmp(mac[i], expected, SHA256_MAC_LEN) != 0) {
+			printf("HMAC-SHA256 multi-message mismatch for "
+			       "message %u\n", (unsigned int) i);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+static int test_sha_speed(const char *name, const u8 *data, int rounds)
+{
+	const u8 *key[SHA_MULTI_NUM], *addr[SHA_MULTI_NUM];
+	size_t key_len[SHA_MULTI_NUM], len[SHA_MULTI_NUM];
+	u8 mac[SHA_MULTI_NUM][SHA256_MAC_LEN], *res[SHA_MULTI_NUM];
+	struct os_reltime start;
+	unsigned int t_sha1, t_sha256, t_single, t_multi;
+	size_t bench_len = BENCH_LEN;
+	size_t i;
+	int r;
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++)
+		sha1_vector(1, &data, &bench_len, mac[0]);
+	t_sha1 = test_usec(&start);
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++)
+		sha256_vector(1, &data, &bench_len, mac[0]);
+	t_sha256 = test_usec(&start);
+
+	/* Key MIC over a 121-octet EAPOL-Key frame with a different KCK for
+	 * each message, e.g., when trying all PSKs for a 4-way handshake */
+	for (i = 0; i < SHA_MULTI_NUM; i++) {
+		key[i] = data + 16 * i;
+		key_len[i] = 16;
+		addr[i] = data + 1000;
+		len[i] = 121;
+		res[i] = mac[i];
+	}
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < SHA_MULTI_NUM; i++)
+			hmac_sha1_multi(&key[i], &key_len[i], &addr[i],
+					&len[i], &res[i], 1);
+	}
+	t_single = test_usec(&start);
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++)
+		hmac_sha1_multi(key, key_len, addr, len, res, SHA_MULTI_NUM);
+	t_multi = test_usec(&start);
+
+	printf("SHA (%s): SHA-1 %u MB/s, SHA-256 %u MB/s, %d HMAC-SHA1 Key "
+	       "MICs %u usec one at a time, %u usec as multi-message\n",
+	       name, test_mbps(BENCH_LEN, rounds, t_sha1),
+	       test_mbps(BENCH_LEN, rounds, t_sha256), SHA_MULTI_NUM,
+	       t_single / rounds, t_multi / rounds);
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int errors = 0;
+	int rounds = argc > 1 ? atoi(argv[1]) : 100;
+	u8 *data, *out, *out2;
+	size_t i;
+
+	if (rounds < 1)
+		rounds = 1;
+
+	data = os_malloc(BENCH_LEN);
+	out = os_malloc(BENCH_LEN);
+	out2 = os_malloc(BENCH_LEN);
+	if (data == NULL || out == NULL || out2 == NULL)
+		return 1;
+	for (i = 0; i < BENCH_LEN; i++)
+		data[i] = i * 7 + (i >> 8);
+
+	printf("Testing internal AES (table based)\n");
+	test_hw_enable(0);
+	errors += test_aes_vectors();
+	errors += test_aes_blocks(data, out, out2);
+	errors += test_gcm_vectors();
+	errors += test_aes_speed("tables", data, out, rounds);
+	errors += test_gcm_speed("tables", data, out, rounds);
+	errors += test_sha_vectors();
+	errors += test_sha_multi(data);
+	errors += test_sha_speed("portable", data, rounds);
+
+	test_hw_enable(1);
+	printf("Testing internal AES (CPU instructions if available)\n");
+	errors += test_aes_vectors();
+	errors += test_aes_blocks(data, out, out2);
+	errors += test_gcm_vectors();
+	errors += test_gcm_lengths(data, out, out2);
+	errors += test_aes_speed("auto", data, out, rounds);
+	errors += test_gcm_speed("auto", data, out, rounds);
+	errors += test_sha_vectors();
+	errors += test_sha_multi(data);
+	errors += test_sha_speed("auto", data, rounds);
+
+	test_hw_enable(2);
+	printf("Testing internal SHA-1/SHA-256 (SIMD lanes if available)\n");
+	errors += test_sha_vectors();
+	errors += test_sha_multi(data);
+	errors += test_sha_speed("lanes", data, rounds);
+
+	os_free(data);
+	os_free(out);
+	os_free(out2);
+
+	if (errors)
+		printf("%d test(s) failed\n", errors);
+	return errors;
+}
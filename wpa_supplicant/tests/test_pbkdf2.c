@@ -0,0 +1,166 @@
+/*
+ * Test program and benchmark for PBKDF2-SHA1
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This verifies pbkdf2_sha1() and pbkdf2_sha1_batch() against the IEEE Std
+ * 802.11 passphrase-to-PSK test vectors and reports the time used for
+ * deriving WPA-PSK keys one at a time and as a batch.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "crypto/sha1.h"
+#ifdef CONFIG_INTERNAL_SHA1
+#include "crypto/sha1_i.h"
+#endif /* CONFIG_INTERNAL_SHA1 */
+
+
+struct pbkdf2_test_vector {
+	const char *passphrase;
+	const char *ssid;
+	int iterations;
+	size_t len;
+	const char *psk;
+};
+
+static const struct pbkdf2_test_vector tests[] = {
+	{
+		"password", "IEEE", 4096, 32,
+		"f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e"
+	},
+	{
+		"ThisIsAPassword", "ThisIsASSID", 4096, 32,
+		"0dc0d6eb90555ed6419756b9a15ec3e3209b63df707dd508d14581f8982721af"
+	},
+	{
+		"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+		"ZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZ", 4096, 32,
+		"2d43d0dabfdd635377172efa1fc4b4b87dbfc4219193909ded9a7cfb89a3097b"
+	},
+	{
+		"password", "IEEE", 4096, 50,
+		"f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e"
+		"4888f197a3680415ff4df678377c111f9f8f"
+	},
+	{
+		"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+		"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb",
+		"long key", 2, 32,
+		"0a2f220b2cbf5d3a638fe5f15d4f959906f31a098fce537c57fa4d91ee291b99"
+	},
+};
+
+#define NUM_TESTS ARRAY_SIZE(tests)
+#define BATCH_SIZE 16
+#define PSK_LEN 32
+
+
+static unsigned int test_usec(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static int test_vectors(void)
+{
+	u8 psk[64], expected[64];
+	unsigned int i;
+	int errors = 0;
+
+	for (i = 0; i < NUM_TESTS; i++) {
+		const struct pbkdf2_test_vector *t = &tests[i];
+
+		if (hexstr2bin(t->psk, expected, t->len) ||
+		    pbkdf2_sha1(t->passphrase, (const u8 *) t->ssid,
+				os_strlen(t->ssid), t->iterations, psk,
+				t->len) ||
+		    os_memcmp(psk, expected, t->len) != 0) {
+			printf("PBKDF2-SHA1 test vector %u failed\n", i);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+
+static int test_batch(int rounds)
+{
+	char passphrase[BATCH_SIZE][20];
+	const char *pass[BATCH_SIZE];
+	u8 psk[BATCH_SIZE][PSK_LEN], psk1[PSK_LEN];
+	u8 *buf[BATCH_SIZE];
+	const u8 *ssid = (const u8 *) "test-network";
+	size_t ssid_len = 12;
+	struct os_reltime start;
+	unsigned int t_single, t_batch;
+	int i, r;
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		os_snprintf(passphrase[i], sizeof(passphrase[i]),
+			    "passphrase-%d", i);
+		pass[i] = passphrase[i];
+		buf[i] = psk[i];
+	}
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < BATCH_SIZE; i++)
+			pbkdf2_sha1(pass[i], ssid, ssid_len, 4096, psk1,
+				    PSK_LEN);
+	}
+	t_single = test_usec(&start) / rounds;
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		if (pbkdf2_sha1_batch(pass, ssid, ssid_len, 4096, buf,
+				      PSK_LEN, BATCH_SIZE))
+			return 1;
+	}
+	t_batch = test_usec(&start) / rounds;
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		pbkdf2_sha1(pass[i], ssid, ssid_len, 4096, psk1, PSK_LEN);
+		if (os_memcmp(psk1, psk[i], PSK_LEN) != 0) {
+			printf("PBKDF2-SHA1 batch entry %d mismatch\n", i);
+			return 1;
+		}
+	}
+
+	printf("%d WPA-PSK derivations: %u usec one at a time, %u usec as a "
+	       "batch\n", BATCH_SIZE, t_single, t_batch);
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int errors = 0;
+	int rounds = argc > 1 ? atoi(argv[1]) : 1;
+
+	if (rounds < 1)
+		rounds = 1;
+
+	printf("Testing PBKDF2-SHA1\n");
+	errors += test_vectors();
+	errors += test_batch(rounds);
+#ifdef CONFIG_INTERNAL_SHA1
+	printf("Testing PBKDF2-SHA1 with SHA-1 in SIMD lanes\n");
+	sha1_hw_enable(2);
+	errors += test_vectors();
+	errors += test_batch(rounds);
+	sha1_hw_enable(1);
+#endif /* CONFIG_INTERNAL_SHA1 */
+
+	if (errors)
+		printf("%d test(s) failed\n", errors);
+	return errors;
+}
@@ -0,0 +1,386 @@
+/*
+ * Benchmark for SAE commit processing in worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This emulates a burst of stations starting SAE with an AP. The station
+ * commits are prepared first, the AP side commit processing is then timed
+ * both synchronously (as done in the event loop without sae_worker_threads)
+ * and through the SAE work queue with an increasing number of worker threads,
+ * and finally each exchange is completed with the confirm messages to verify
+ * the results. The number of sustained SAE authentications per second is
+ * reported for each case. Before that, the average latency of the SAE steps
+ * (group setup, PWE and commit derivation, and K derivation) is reported for
+ * each ECC group that an AP would typically enable.
+ *
+ * Usage: test-sae_speed [number of stations] [max worker threads]
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+#include "common/ieee802_11_defs.h"
+#include "common/sae.h"
+#include "crypto/random.h"
+#include "ap/sae_workers.h"
+
+
+#define SAE_TEST_GROUP 19
+
+struct sae_test_sta {
+	u8 addr[ETH_ALEN];
+	struct sae_data sta;
+	struct sae_data *ap;
+	struct wpabuf *commit;
+	struct sae_job *job;
+	int result;
+};
+
+struct sae_test {
+	u8 ap_addr[ETH_ALEN];
+	const char *password;
+	struct sae_test_sta *stas;
+	unsigned int num_stas;
+	unsigned int done;
+};
+
+
+static int sae_test_sta_init(struct sae_test *t, struct sae_test_sta *s)
+{
+	int groups[] = { SAE_TEST_GROUP, 0 };
+	const u8 *token = NULL;
+	size_t token_len = 0;
+
+	sae_clear_data(&s->sta);
+	if (sae_set_group(&s->sta, SAE_TEST_GROUP) < 0 ||
+	    sae_prepare_commit(s->addr, t->ap_addr,
+			       (const u8 *) t->password,
+			       os_strlen(t->password), &s->sta) < 0)
+		return -1;
+	wpabuf_free(s->commit);
+	s->commit = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+	if (s->commit == NULL)
+		return -1;
+	sae_write_commit(&s->sta, s->commit, NULL);
+
+	if (s->ap) {
+		sae_clear_data(s->ap);
+		os_free(s->ap);
+	}
+	s->ap = os_zalloc(sizeof(*s->ap));
+	if (s->ap == NULL)
+		return -1;
+	if (sae_parse_commit(s->ap, wpabuf_head(s->commit),
+			     wpabuf_len(s->commit), &token, &token_len,
+			     groups) != WLAN_STATUS_SUCCESS)
+		return -1;
+	s->result = -1;
+
+	return 0;
+}
+
+
+static int sae_test_init(struct sae_test *t)
+{
+	unsigned int i;
+
+	for (i = 0; i < t->num_stas; i++) {
+		if (sae_test_sta_init(t, &t->stas[i]) < 0) {
+			printf("Failed to prepare SAE commit for STA %u\n", i);
+			return -1;
+		}
+	}
+	t->done = 0;
+
+	return 0;
+}
+
+
+static int sae_test_verify(struct sae_test *t)
+{
+	int groups[] = { SAE_TEST_GROUP, 0 };
+	struct wpabuf *commit, *confirm;
+	const u8 *token;
+	size_t token_len;
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < t->num_stas; i++) {
+		struct sae_test_sta *s = &t->stas[i];
+
+		if (s->result < 0) {
+			printf("AP failed to process commit from STA %u\n", i);
+			ret = -1;
+			continue;
+		}
+
+		commit = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+		confirm = wpabuf_alloc(SAE_CONFIRM_MAX_LEN);
+		if (commit == NULL || confirm == NULL) {
+			wpabuf_free(commit);
+			wpabuf_free(confirm);
+			return -1;
+		}
+		sae_write_commit(s->ap, commit, NULL);
+		token = NULL;
+		token_len = 0;
+		if (sae_parse_commit(&s->sta, wpabuf_head(commit),
+				     wpabuf_len(commit), &token, &token_len,
+				     groups) != WLAN_STATUS_SUCCESS ||
+		    sae_process_commit(&s->sta) < 0) {
+			printf("STA %u failed to process AP commit\n", i);
+			ret = -1;
+		} else {
+			sae_write_confirm(&s->sta, confirm);
+			if (sae_check_confirm(s->ap, wpabuf_head(confirm),
+					      wpabuf_len(confirm)) < 0 ||
+			    os_memcmp(s->sta.pmk, s->ap->pmk,
+				      SAE_PMK_LEN) != 0) {
+				printf("SAE confirm/PMK mismatch for STA %u\n",
+				       i);
+				ret = -1;
+			}
+		}
+		wpabuf_free(commit);
+		wpabuf_free(confirm);
+	}
+
+	return ret;
+}
+
+
+static unsigned int sae_test_rate(unsigned int num, struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+	unsigned long long usec;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	usec = diff.sec * 1000000ULL + diff.usec;
+	if (usec == 0)
+		usec = 1;
+	return num * 1000000ULL / usec;
+}
+
+
+static unsigned int sae_test_usec(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	*start = now;
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static int sae_test_group_latency(struct sae_test *t, int group,
+				  unsigned int rounds)
+{
+	int groups[] = { group, 0 };
+	struct sae_data sta, ap;
+	struct wpabuf *commit = NULL;
+	struct os_reltime start;
+	unsigned long long usec_group = 0, usec_commit = 0, usec_k = 0;
+	const u8 *token;
+	size_t token_len;
+	unsigned int i;
+	int ret = -1;
+
+	os_memset(&sta, 0, sizeof(sta));
+	os_memset(&ap, 0, sizeof(ap));
+
+	for (i = 0; i < rounds; i++) {
+		wpabuf_free(commit);
+		commit = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+		if (commit == NULL)
+			goto fail;
+		token = NULL;
+		token_len = 0;
+		if (sae_set_group(&sta, group) < 0 ||
+		    sae_prepare_commit(t->stas[0].addr, t->ap_addr,
+				       (const u8 *) t->password,
+				       os_strlen(t->password), &sta) < 0)
+			goto fail;
+		sae_write_commit(&sta, commit, NULL);
+
+		/* Time the AP side of the exchange */
+		os_get_reltime(&start);
+		if (sae_set_group(&ap, group) < 0)
+			goto fail;
+		usec_group += sae_test_usec(&start);
+		if (sae_prepare_commit(t->ap_addr, t->stas[0].addr,
+				       (const u8 *) t->password,
+				       os_strlen(t->password), &ap) < 0)
+			goto fail;
+		usec_commit += sae_test_usec(&start);
+		if (sae_parse_commit(&ap, wpabuf_head(commit),
+				     wpabuf_len(commit), &token, &token_len,
+				     groups) != WLAN_STATUS_SUCCESS)
+			goto fail;
+		os_get_reltime(&start);
+		if (sae_process_commit(&ap) < 0)
+			goto fail;
+		usec_k += sae_test_usec(&start);
+	}
+
+	printf("group %d: set group %llu usec, PWE and commit %llu usec, "
+	       "K %llu usec\n", group, usec_group / rounds,
+	       usec_commit / rounds, usec_k / rounds);
+	ret = 0;
+fail:
+	if (ret < 0)
+		printf("SAE latency test failed for group %d\n", group);
+	sae_clear_data(&sta);
+	sae_clear_data(&ap);
+	wpabuf_free(commit);
+	return ret;
+}
+
+
+static int sae_test_sync(struct sae_test *t)
+{
+	struct os_reltime start;
+	unsigned int i;
+
+	if (sae_test_init(t) < 0)
+		return -1;
+
+	os_get_reltime(&start);
+	for (i = 0; i < t->num_stas; i++) {
+		struct sae_test_sta *s = &t->stas[i];
+
+		if (sae_prepare_commit(t->ap_addr, s->addr,
+				       (const u8 *) t->password,
+				       os_strlen(t->password), s->ap) < 0 ||
+		    sae_process_commit(s->ap) < 0)
+			s->result = -1;
+		else
+			s->result = 0;
+	}
+	printf("synchronous: %u SAE authentications/s\n",
+	       sae_test_rate(t->num_stas, &start));
+
+	return sae_test_verify(t);
+}
+
+
+static void sae_test_done_cb(void *ctx, void *session_ctx)
+{
+	struct sae_test *t = ctx;
+	struct sae_test_sta *s = session_ctx;
+
+	s->result = sae_job_finish(s->job);
+	s->job = NULL;
+	if (++t->done == t->num_stas)
+		eloop_terminate();
+}
+
+
+static int sae_test_workers(struct sae_test *t, unsigned int threads)
+{
+	struct sae_workers *workers;
+	struct sae_workers_stats stats;
+	struct os_reltime start;
+	unsigned int i;
+	unsigned int rate;
+
+	if (sae_test_init(t) < 0)
+		return -1;
+
+	workers = sae_workers_init(threads, t->num_stas, sae_test_done_cb, t);
+	if (workers == NULL) {
+		printf("Failed to start %u SAE worker thread(s)\n", threads);
+		return -1;
+	}
+
+	os_get_reltime(&start);
+	for (i = 0; i < t->num_stas; i++) {
+		struct sae_test_sta *s = &t->stas[i];
+
+		s->job = sae_job_start(workers, t->ap_addr, s->addr,
+				       (const u8 *) t->password,
+				       os_strlen(t->password), s->ap, i & 1,
+				       s);
+		if (s->job == NULL) {
+			printf("Failed to queue SAE job for STA %u\n", i);
+			sae_workers_deinit(workers);
+			return -1;
+		}
+	}
+	eloop_run();
+	rate = sae_test_rate(t->num_stas, &start);
+
+	sae_workers_get_stats(workers, &stats);
+	sae_workers_deinit(workers);
+
+	printf("%u worker thread(s): %u SAE authentications/s (max queued %u, "
+	       "avg queue wait %lu usec)\n", threads, rate, stats.max_queued,
+	       stats.completed ?
+	       (unsigned long) (stats.wait_usec / stats.completed) : 0UL);
+
+	return sae_test_verify(t);
+}
+
+
+int main(int argc, char *argv[])
+{
+	static const int latency_groups[] = { 19, 20, 21 };
+	struct sae_test t;
+	unsigned int i, threads, max_threads;
+	int ret = 0;
+
+	os_memset(&t, 0, sizeof(t));
+	t.num_stas = argc > 1 ? atoi(argv[1]) : 64;
+	max_threads = argc > 2 ? atoi(argv[2]) : 4;
+	if (t.num_stas == 0)
+		t.num_stas = 1;
+	t.password = "benchmark password";
+	os_memset(t.ap_addr, 0x02, ETH_ALEN);
+
+	if (os_program_init())
+		return -1;
+	if (eloop_init()) {
+		printf("Failed to initialize event loop\n");
+		return -1;
+	}
+	random_init(NULL);
+
+	t.stas = os_calloc(t.num_stas, sizeof(struct sae_test_sta));
+	if (t.stas == NULL)
+		return -1;
+	for (i = 0; i < t.num_stas; i++) {
+		t.stas[i].addr[0] = 0x02;
+		WPA_PUT_BE32(&t.stas[i].addr[2], i + 1);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(latency_groups); i++) {
+		if (sae_test_group_latency(&t, latency_groups[i], 20) < 0)
+			ret = -1;
+	}
+	if (ret == 0 && sae_test_sync(&t) < 0)
+		ret = -1;
+	for (threads = 1; ret == 0 && threads <= max_threads; threads *= 2) {
+		if (sae_test_workers(&t, threads) < 0)
+			ret = -1;
+	}
+
+	for (i = 0; i < t.num_stas; i++) {
+		sae_clear_data(&t.stas[i].sta);
+		sae_clear_data(t.stas[i].ap);
+		os_free(t.stas[i].ap);
+		wpabuf_free(t.stas[i].commit);
+	}
+	os_free(t.stas);
+
+	random_deinit();
+	eloop_destroy();
+	os_program_deinit();
+
+	if (ret == 0)
+		printf("SAE worker tests passed\n");
+	return ret;
+}
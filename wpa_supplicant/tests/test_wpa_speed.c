@@ -0,0 +1,171 @@
+/*
+ * Benchmark for the cryptographic operations of the WPA 4-way handshake
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This runs the key derivation, EAPOL-Key MIC, and key data encryption steps
+ * of both the Authenticator and the Supplicant for WPA2-PSK/CCMP 4-way
+ * handshakes with whichever crypto backend wpa_supplicant was configured to
+ * use and reports the number of handshakes per second. HMAC-SHA1 is verified
+ * against RFC 2202 test vectors first with alternating and repeated keys to
+ * cover backends that reuse keyed contexts.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "crypto/sha1.h"
+#include "crypto/aes_wrap.h"
+
+
+#define PMK_LEN 32
+#define PTK_LEN 48
+#define KCK_LEN 16
+#define KEK_LEN 16
+#define MIC_LEN 16
+#define EAPOL_MSG2_LEN 121
+#define EAPOL_MSG3_LEN 155
+#define EAPOL_MSG4_LEN 99
+#define KEY_DATA_LEN 48
+
+
+static int test_hmac_sha1_vectors(void)
+{
+	static const u8 mac1[SHA1_MAC_LEN] = {
+		0xb6, 0x17, 0x31, 0x86, 0x55, 0x05, 0x72, 0x64,
+		0xe2, 0x8b, 0xc0, 0xb6, 0xfb, 0x37, 0x8c, 0x8e,
+		0xf1, 0x46, 0xbe, 0x00
+	};
+	static const u8 mac2[SHA1_MAC_LEN] = {
+		0xef, 0xfc, 0xdf, 0x6a, 0xe5, 0xeb, 0x2f, 0xa2,
+		0xd2, 0x74, 0x16, 0xd5, 0xf1, 0x84, 0xdf, 0x9c,
+		0x25, 0x9a, 0x7c, 0x79
+	};
+	static const int order[] = { 1, 1, 2, 1, 2, 2, 1 };
+	u8 key1[20], mac[SHA1_MAC_LEN];
+	const char *key2 = "Jefe";
+	const char *data1 = "Hi There";
+	const char *data2 = "what do ya want for nothing?";
+	size_t i;
+	int res;
+
+	os_memset(key1, 0x0b, sizeof(key1));
+
+	for (i = 0; i < ARRAY_SIZE(order); i++) {
+		if (order[i] == 1) {
+			res = hmac_sha1(key1, sizeof(key1),
+					(const u8 *) data1, os_strlen(data1),
+					mac);
+			if (res == 0 &&
+			    os_memcmp(mac, mac1, SHA1_MAC_LEN) != 0)
+				res = -1;
+		} else {
+			res = hmac_sha1((const u8 *) key2, os_strlen(key2),
+					(const u8 *) data2, os_strlen(data2),
+					mac);
+			if (res == 0 &&
+			    os_memcmp(mac, mac2, SHA1_MAC_LEN) != 0)
+				res = -1;
+		}
+		if (res) {
+			printf("HMAC-SHA1 test vector %d failed (step %u)\n",
+			       order[i], (unsigned int) i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+static int test_eapol_mic(const u8 *kck, const u8 *frame, size_t len,
+			  u8 *mic)
+{
+	u8 hash[SHA1_MAC_LEN];
+
+	if (hmac_sha1(kck, KCK_LEN, frame, len, hash))
+		return -1;
+	os_memcpy(mic, hash, MIC_LEN);
+	return 0;
+}
+
+
+static int test_handshake(const u8 *pmk, const u8 *data, u8 *frame,
+			  const u8 *key_data)
+{
+	u8 ptk_a[PTK_LEN], ptk_s[PTK_LEN], mic_a[MIC_LEN], mic_s[MIC_LEN];
+	u8 wrapped[KEY_DATA_LEN + 8], plain[KEY_DATA_LEN];
+
+	/* Authenticator and Supplicant both derive the PTK */
+	if (sha1_prf(pmk, PMK_LEN, "Pairwise key expansion", data, 76,
+		     ptk_s, PTK_LEN) ||
+	    sha1_prf(pmk, PMK_LEN, "Pairwise key expansion", data, 76,
+		     ptk_a, PTK_LEN))
+		return -1;
+
+	/* Message 2/4: Supplicant calculates, Authenticator verifies MIC */
+	if (test_eapol_mic(ptk_s, frame, EAPOL_MSG2_LEN, mic_s) ||
+	    test_eapol_mic(ptk_a, frame, EAPOL_MSG2_LEN, mic_a) ||
+	    os_memcmp(mic_s, mic_a, MIC_LEN) != 0)
+		return -1;
+
+	/* Message 3/4: GTK KDE is encrypted with the KEK */
+	if (aes_wrap(ptk_a + KCK_LEN, KEY_DATA_LEN / 8, key_data, wrapped) ||
+	    test_eapol_mic(ptk_a, frame, EAPOL_MSG3_LEN, mic_a) ||
+	    test_eapol_mic(ptk_s, frame, EAPOL_MSG3_LEN, mic_s) ||
+	    os_memcmp(mic_s, mic_a, MIC_LEN) != 0 ||
+	    aes_unwrap(ptk_s + KCK_LEN, KEY_DATA_LEN / 8, wrapped, plain) ||
+	    os_memcmp(plain, key_data, KEY_DATA_LEN) != 0)
+		return -1;
+
+	/* Message 4/4 */
+	if (test_eapol_mic(ptk_s, frame, EAPOL_MSG4_LEN, mic_s) ||
+	    test_eapol_mic(ptk_a, frame, EAPOL_MSG4_LEN, mic_a) ||
+	    os_memcmp(mic_s, mic_a, MIC_LEN) != 0)
+		return -1;
+
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	u8 pmk[PMK_LEN], data[76], frame[EAPOL_MSG3_LEN];
+	u8 key_data[KEY_DATA_LEN];
+	struct os_reltime start, now, diff;
+	int i, rounds = argc > 1 ? atoi(argv[1]) : 10000;
+	unsigned int usec;
+
+	if (test_hmac_sha1_vectors() < 0)
+		return -1;
+
+	os_memset(pmk, 0x44, sizeof(pmk));
+	os_memset(frame, 0x5a, sizeof(frame));
+	os_memset(key_data, 0xdd, sizeof(key_data));
+	if (rounds <= 0)
+		rounds = 1;
+
+	os_get_reltime(&start);
+	for (i = 0; i < rounds; i++) {
+		/* New SNonce for each handshake; AA, SPA, and ANonce fixed */
+		os_memset(data, 0x12, sizeof(data));
+		WPA_PUT_BE32(data + 44, i);
+		if (test_handshake(pmk, data, frame, key_data) < 0) {
+			printf("4-way handshake %d failed\n", i);
+			return -1;
+		}
+	}
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &start, &diff);
+	usec = diff.sec * 1000000 + diff.usec;
+	if (usec == 0)
+		usec = 1;
+
+	printf("%d 4-way handshakes in %u usec: %u handshakes/s\n",
+	       rounds, usec,
+	       (unsigned int) ((unsigned long long) rounds * 1000000 / usec));
+
+	return 0;
+}
@@ -48,6 +48,8 @@
 #include "notify.h"
 #include "bgscan.h"
 #include "autoscan.h"
+#include "scan_history.h"
+#include "anqp_cache.h"
 #include "bss.h"
 #include "scan.h"
 #include "offchannel.h"
@@ -375,6 +377,8 @@ static void wpa_supplicant_cleanup(struct wpa_supplicant *wpa_s)
 {
 	bgscan_deinit(wpa_s);
 	autoscan_deinit(wpa_s);
+	scan_history_deinit(wpa_s);
+	anqp_cache_deinit(wpa_s);
 	scard_deinit(wpa_s->scard);
 	wpa_s->scard = NULL;
 	wpa_sm_set_scard_ctx(wpa_s->wpa, NULL);
@@ -465,6 +469,11 @@ static void wpa_supplicant_cleanup(struct wpa_supplicant *wpa_s)
 
 	gas_query_deinit(wpa_s->gas);
 	wpa_s->gas = NULL;
+#ifdef CONFIG_INTERWORKING
+	os_free(wpa_s->anqp_queries);
+	wpa_s->anqp_queries = NULL;
+	wpa_s->num_anqp_queries = 0;
+#endif /* CONFIG_INTERWORKING */
 
 	free_hw_features(wpa_s);
 
@@ -854,8 +863,12 @@ int wpa_supplicant_reload_configuration(struct wpa_supplicant *wpa_s)
 	rsn_preauth_deinit(wpa_s->wpa);
 
 	old_ap_scan = wpa_s->conf->ap_scan;
+	scan_history_deinit(wpa_s);
+	anqp_cache_deinit(wpa_s);
 	wpa_config_free(wpa_s->conf);
 	wpa_s->conf = conf;
+	if (scan_history_init(wpa_s) < 0)
+		wpa_dbg(wpa_s, MSG_DEBUG, "Failed to initialize scan history");
 	if (old_ap_scan != wpa_s->conf->ap_scan)
 		wpas_notify_ap_scan_changed(wpa_s);
 
@@ -1397,8 +1410,7 @@ void wpa_supplicant_associate(struct wpa_supplicant *wpa_s,
 
 #ifdef CONFIG_TDLS
 	if (bss)
-		wpa_tdls_ap_ies(wpa_s->wpa, (const u8 *) (bss + 1),
-				bss->ie_len);
+		wpa_tdls_ap_ies(wpa_s->wpa, wpa_bss_ie_ptr(bss), bss->ie_len);
 #endif /* CONFIG_TDLS */
 
 	if ((wpa_s->drv_flags & WPA_DRIVER_FLAGS_SME) &&
@@ -1434,8 +1446,9 @@ void wpa_supplicant_associate(struct wpa_supplicant *wpa_s,
 	cwork->bss = bss;
 	cwork->ssid = ssid;
 
-	if (radio_add_work(wpa_s, bss ? bss->freq : 0, "connect", 1,
-			   wpas_start_assoc_cb, cwork) < 0) {
+	if (radio_add_work(wpa_s, bss ? bss->freq : 0, "connect",
+			   RADIO_WORK_PRIO_URGENT, 1, wpas_start_assoc_cb,
+			   cwork) < 0) {
 		os_free(cwork);
 	}
 }
@@ -3221,19 +3234,98 @@ static void radio_work_free(struct wpa_radio_work *work)
 }
 
 
+/*
+ * Maximum time (in seconds) a queued work waits before it is handled with the
+ * next higher priority: a background work is handled as a normal priority work
+ * after 10 seconds and a normal priority work as an urgent one after 5
+ * seconds. Urgent works are not aged any further.
+ */
+#define RADIO_WORK_NORMAL_MAX_WAIT 5
+#define RADIO_WORK_BACKGROUND_MAX_WAIT 10
+#define RADIO_WORK_MAX_STATS 32
+
+
+static int radio_work_eff_prio(struct wpa_radio_work *work,
+			       struct os_reltime *now)
+{
+	if (work->prio < RADIO_WORK_PRIO_URGENT &&
+	    !os_reltime_before(now, &work->deadline))
+		return work->prio + 1;
+	return work->prio;
+}
+
+
+/*
+ * External works (RADIO_WORK add) are named by the external program, so they
+ * share a single entry to keep the number of entries bounded.
+ */
+static struct radio_work_stats *
+radio_work_get_stats(struct wpa_radio *radio, const char *type)
+{
+	struct radio_work_stats *stats;
+	unsigned int i;
+
+	if (os_strncmp(type, "ext:", 4) == 0)
+		type = "ext";
+
+	for (i = 0; i < radio->num_work_stats; i++) {
+		if (os_strcmp(radio->work_stats[i].type, type) == 0)
+			return &radio->work_stats[i];
+	}
+
+	if (radio->num_work_stats >= RADIO_WORK_MAX_STATS)
+		return NULL;
+	stats = os_realloc_array(radio->work_stats, radio->num_work_stats + 1,
+				 sizeof(*stats));
+	if (stats == NULL)
+		return NULL;
+	radio->work_stats = stats;
+	stats = &radio->work_stats[radio->num_work_stats++];
+	os_memset(stats, 0, sizeof(*stats));
+	os_strlcpy(stats->type, type, sizeof(stats->type));
+
+	return stats;
+}
+
+
+/*
+ * Pick the queued work with the highest (deadline adjusted) priority; works
+ * with the same priority are started in the order they were added. Returns
+ * NULL if a work is still in progress.
+ */
+static struct wpa_radio_work * radio_work_get_next(struct wpa_radio *radio,
+						   struct os_reltime *now)
+{
+	struct wpa_radio_work *work, *next = NULL;
+	int prio, next_prio = -1;
+
+	dl_list_for_each(work, &radio->work, struct wpa_radio_work, list) {
+		if (work->started)
+			return NULL;
+		prio = radio_work_eff_prio(work, now);
+		if (prio > next_prio) {
+			next = work;
+			next_prio = prio;
+		}
+	}
+
+	return next;
+}
+
+
 static void radio_start_next_work(void *eloop_ctx, void *timeout_ctx)
 {
 	struct wpa_radio *radio = eloop_ctx;
 	struct wpa_radio_work *work;
+	struct radio_work_stats *stats;
 	struct os_reltime now, diff;
 	struct wpa_supplicant *wpa_s;
+	unsigned long long usec;
 
-	work = dl_list_first(&radio->work, struct wpa_radio_work, list);
+	os_get_reltime(&now);
+	work = radio_work_get_next(radio, &now);
 	if (work == NULL)
-		return;
-
-	if (work->started)
-		return; /* already started and still in progress */
+		return; /* no work queued or one still in progress */
 
 	wpa_s = dl_list_first(&radio->ifaces, struct wpa_supplicant,
 			      radio_list);
@@ -3242,10 +3334,25 @@ static void radio_start_next_work(void *eloop_ctx, void *timeout_ctx)
 		return;
 	}
 
-	os_get_reltime(&now);
 	os_reltime_sub(&now, &work->time, &diff);
-	wpa_dbg(work->wpa_s, MSG_DEBUG, "Starting radio work '%s'@%p after %ld.%06ld second wait",
-		work->type, work, diff.sec, diff.usec);
+	wpa_dbg(work->wpa_s, MSG_DEBUG, "Starting radio work '%s'@%p after %ld.%06ld second wait (priority %d)",
+		work->type, work, diff.sec, diff.usec, work->prio);
+
+	stats = radio_work_get_stats(radio, work->type);
+	if (stats) {
+		usec = (unsigned long long) diff.sec * 1000000 + diff.usec;
+		stats->started++;
+		stats->wait_usec += usec;
+		if (usec > stats->max_wait_usec)
+			stats->max_wait_usec = usec;
+		if (work->prio < RADIO_WORK_PRIO_URGENT &&
+		    !os_reltime_before(&now, &work->deadline))
+			stats->late++;
+	}
+
+	/* The work in progress is kept at the head of the queue */
+	dl_list_del(&work->list);
+	dl_list_add(&radio->work, &work->list);
 	work->started = 1;
 	work->time = now;
 	work->cb(work, 0);
@@ -3306,6 +3413,7 @@ static void radio_remove_interface(struct wpa_supplicant *wpa_s)
 
 	wpa_printf(MSG_DEBUG, "Remove radio %s", radio->name);
 	eloop_cancel_timeout(radio_start_next_work, radio, NULL);
+	os_free(radio->work_stats);
 	os_free(radio);
 }
 
@@ -3326,7 +3434,9 @@ void radio_work_check_next(struct wpa_supplicant *wpa_s)
  * @wpa_s: Pointer to wpa_supplicant data
  * @freq: Frequency of the offchannel operation in MHz or 0
  * @type: Unique identifier for each type of work
- * @next: Force as the next work to be executed
+ * @prio: Priority of the work (see enum radio_work_prio)
+ * @next: Force as the next work to be executed (once the work in progress, if
+ *	any, has been completed); such a work is always urgent
  * @cb: Callback function for indicating when radio is available
  * @ctx: Context pointer for the work (work->ctx in cb())
  * Returns: 0 on success, -1 on failure
@@ -3345,20 +3455,31 @@ void radio_work_check_next(struct wpa_supplicant *wpa_s)
  * operations to be performed in parallel if they apply for the same channel.
  * Setting this to 0 indicates that the work item may use multiple channels or
  * requires exclusive control of the radio.
+ *
+ * Queued works are started in priority order and in the order they were added
+ * within a priority. Works that have waited for longer than the maximum wait
+ * time of their priority are handled with the next higher priority.
  */
 int radio_add_work(struct wpa_supplicant *wpa_s, unsigned int freq,
-		   const char *type, int next,
+		   const char *type, enum radio_work_prio prio, int next,
 		   void (*cb)(struct wpa_radio_work *work, int deinit),
 		   void *ctx)
 {
-	struct wpa_radio_work *work;
+	struct wpa_radio_work *work, *first;
 	int was_empty;
 
 	work = os_zalloc(sizeof(*work));
 	if (work == NULL)
 		return -1;
-	wpa_dbg(wpa_s, MSG_DEBUG, "Add radio work '%s'@%p", type, work);
+	work->prio = next ? RADIO_WORK_PRIO_URGENT : prio;
+	wpa_dbg(wpa_s, MSG_DEBUG, "Add radio work '%s'@%p (priority %d)",
+		type, work, work->prio);
 	os_get_reltime(&work->time);
+	work->deadline = work->time;
+	if (work->prio == RADIO_WORK_PRIO_NORMAL)
+		work->deadline.sec += RADIO_WORK_NORMAL_MAX_WAIT;
+	else if (work->prio == RADIO_WORK_PRIO_BACKGROUND)
+		work->deadline.sec += RADIO_WORK_BACKGROUND_MAX_WAIT;
 	work->freq = freq;
 	work->type = type;
 	work->wpa_s = wpa_s;
@@ -3366,7 +3487,10 @@ int radio_add_work(struct wpa_supplicant *wpa_s, unsigned int freq,
 	work->ctx = ctx;
 
 	was_empty = dl_list_empty(&wpa_s->radio->work);
-	if (next)
+	first = dl_list_first(&wpa_s->radio->work, struct wpa_radio_work, list);
+	if (next && first && first->started)
+		dl_list_add(&first->list, &work->list);
+	else if (next)
 		dl_list_add(&wpa_s->radio->work, &work->list);
 	else
 		dl_list_add_tail(&wpa_s->radio->work, &work->list);
@@ -3389,6 +3513,7 @@ int radio_add_work(struct wpa_supplicant *wpa_s, unsigned int freq,
 void radio_work_done(struct wpa_radio_work *work)
 {
 	struct wpa_supplicant *wpa_s = work->wpa_s;
+	struct radio_work_stats *stats;
 	struct os_reltime now, diff;
 	unsigned int started = work->started;
 
@@ -3397,6 +3522,11 @@ void radio_work_done(struct wpa_radio_work *work)
 	wpa_dbg(wpa_s, MSG_DEBUG, "Radio work '%s'@%p %s in %ld.%06ld seconds",
 		work->type, work, started ? "done" : "canceled",
 		diff.sec, diff.usec);
+	if (!started) {
+		stats = radio_work_get_stats(wpa_s->radio, work->type);
+		if (stats)
+			stats->canceled++;
+	}
 	radio_work_free(work);
 	if (started)
 		radio_work_check_next(wpa_s);
@@ -3417,6 +3547,64 @@ int radio_work_pending(struct wpa_supplicant *wpa_s, const char *type)
 }
 
 
+/**
+ * radio_work_preempt_pending - Check whether a work in progress should yield
+ * @work: Radio work in progress
+ * Returns: 1 if a queued work has higher priority than @work, 0 if not
+ *
+ * Radio works are not interrupted, but works that consist of multiple
+ * operations can use this at safe points between the operations to complete
+ * the work early and let the higher priority work run.
+ */
+int radio_work_preempt_pending(struct wpa_radio_work *work)
+{
+	struct wpa_radio_work *tmp;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	dl_list_for_each(tmp, &work->wpa_s->radio->work, struct wpa_radio_work,
+			 list) {
+		if (!tmp->started &&
+		    radio_work_eff_prio(tmp, &now) > (int) work->prio)
+			return 1;
+	}
+
+	return 0;
+}
+
+
+#ifdef CONFIG_MODULE_TESTS
+/**
+ * radio_work_test_next - Start the next queued radio work immediately
+ * @radio: Radio data
+ *
+ * Module tests cannot run eloop, so this replaces the radio_start_next_work()
+ * call scheduled by radio_work_check_next(). The scheduled call is cleared
+ * also when no work is queued.
+ */
+void radio_work_test_next(struct wpa_radio *radio)
+{
+	eloop_cancel_timeout(radio_start_next_work, radio, NULL);
+	radio_start_next_work(radio, NULL);
+}
+#endif /* CONFIG_MODULE_TESTS */
+
+
+/**
+ * radio_work_merged - Record a request that was merged into another work
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @type: Type of the work
+ */
+void radio_work_merged(struct wpa_supplicant *wpa_s, const char *type)
+{
+	struct radio_work_stats *stats;
+
+	stats = radio_work_get_stats(wpa_s->radio, type);
+	if (stats)
+		stats->merged++;
+}
+
+
 static int wpas_init_driver(struct wpa_supplicant *wpa_s,
 			    struct wpa_interface *iface)
 {
@@ -3698,6 +3886,9 @@ static int wpa_supplicant_init_iface(struct wpa_supplicant *wpa_s,
 	if (wpa_bss_init(wpa_s) < 0)
 		return -1;
 
+	if (scan_history_init(wpa_s) < 0)
+		wpa_dbg(wpa_s, MSG_DEBUG, "Failed to initialize scan history");
+
 	/*
 	 * set wowlan triggers if configured.
 	 * Note: we don't restore/remove the triggers
@@ -286,6 +286,35 @@ struct wpa_global {
 };
 
 
+/**
+ * enum radio_work_prio - Radio work priority
+ * @RADIO_WORK_PRIO_BACKGROUND: Work that can wait for other operations, e.g.,
+ *	P2P find and ANQP queries
+ * @RADIO_WORK_PRIO_NORMAL: Default priority, e.g., station mode scans
+ * @RADIO_WORK_PRIO_URGENT: Connection attempts
+ *
+ * A queued work that has waited past its deadline is handled as if it had
+ * the next higher priority so that lower priority works are not starved.
+ */
+enum radio_work_prio {
+	RADIO_WORK_PRIO_BACKGROUND,
+	RADIO_WORK_PRIO_NORMAL,
+	RADIO_WORK_PRIO_URGENT
+};
+
+/**
+ * struct radio_work_stats - Radio work statistics per work type
+ */
+struct radio_work_stats {
+	char type[100];
+	unsigned int started;
+	unsigned int canceled; /* removed before being started (incl. merged) */
+	unsigned int merged; /* requests merged into another work */
+	unsigned int late; /* started after the deadline */
+	unsigned long long wait_usec; /* total wait time of started works */
+	unsigned long long max_wait_usec;
+};
+
 /**
  * struct wpa_radio - Internal data for per-radio information
  *
@@ -311,6 +340,8 @@ struct wpa_radio {
 		 */
 		enum traffic_load traffic_load;
 	} tcm_data, prev_tcm_data;
+	struct radio_work_stats *work_stats;
+	unsigned int num_work_stats;
 };
 
 /**
@@ -324,11 +355,13 @@ struct wpa_radio_work {
 	void (*cb)(struct wpa_radio_work *work, int deinit);
 	void *ctx;
 	unsigned int started:1;
+	enum radio_work_prio prio;
 	struct os_reltime time;
+	struct os_reltime deadline;
 };
 
 int radio_add_work(struct wpa_supplicant *wpa_s, unsigned int freq,
-		   const char *type, int next,
+		   const char *type, enum radio_work_prio prio, int next,
 		   void (*cb)(struct wpa_radio_work *work, int deinit),
 		   void *ctx);
 void radio_work_done(struct wpa_radio_work *work);
@@ -336,6 +369,11 @@ void radio_remove_works(struct wpa_supplicant *wpa_s,
 			const char *type, int remove_all);
 void radio_work_check_next(struct wpa_supplicant *wpa_s);
 int radio_work_pending(struct wpa_supplicant *wpa_s, const char *type);
+int radio_work_preempt_pending(struct wpa_radio_work *work);
+void radio_work_merged(struct wpa_supplicant *wpa_s, const char *type);
+#ifdef CONFIG_MODULE_TESTS
+void radio_work_test_next(struct wpa_radio *radio);
+#endif /* CONFIG_MODULE_TESTS */
 
 struct wpa_connect_work {
 	unsigned int sme:1;
@@ -484,6 +522,19 @@ struct wpa_supplicant {
 				 struct wpa_scan_results *scan_res);
 	struct dl_list bss; /* struct wpa_bss::list */
 	struct dl_list bss_id; /* struct wpa_bss::list_id */
+	/* Hash tables for BSS entry lookups; chained with struct wpa_bss */
+#define WPA_BSS_HASH_SIZE 256 /* power of two */
+	struct wpa_bss *bss_hash_bssid[WPA_BSS_HASH_SIZE];
+	struct wpa_bss *bss_hash_id[WPA_BSS_HASH_SIZE];
+#ifdef CONFIG_P2P
+	struct wpa_bss *bss_hash_p2p[WPA_BSS_HASH_SIZE];
+#endif /* CONFIG_P2P */
+	/* Shared BSS IEs by content; chained with struct wpa_bss_ies */
+	struct wpa_bss_ies *bss_ies_hash[WPA_BSS_HASH_SIZE];
+	unsigned int bss_ies_num; /* number of shared IE data instances */
+	size_t bss_ies_bytes; /* octets of IEs stored */
+	size_t bss_ies_ref_bytes; /* octets of IEs referenced by BSS entries */
+	unsigned int bss_list_seq;
 	size_t num_bss;
 	unsigned int bss_update_idx;
 	unsigned int bss_next_id;
@@ -793,6 +844,9 @@ struct wpa_supplicant {
 	struct wpa_driver_scan_params *autoscan_params;
 	void *autoscan_priv;
 
+	struct scan_history *scan_history;
+	struct anqp_cache *anqp_cache;
+
 	struct wpa_ssid *connect_without_scan;
 
 	struct wps_ap_info *wps_ap;
@@ -821,6 +875,13 @@ struct wpa_supplicant {
 	unsigned int fetch_osu_info:1;
 	unsigned int fetch_osu_icon_in_progress:1;
 	struct wpa_bss *interworking_gas_bss;
+	struct interworking_anqp_query *anqp_queries;
+	unsigned int num_anqp_queries;
+	int anqp_fetch_freq;
+	struct os_reltime anqp_fetch_start;
+	unsigned int anqp_fetch_queries;
+	unsigned int anqp_fetch_shared;
+	unsigned int anqp_fetch_cached;
 	unsigned int osu_icon_id;
 	struct osu_provider *osu_prov;
 	size_t osu_prov_count;
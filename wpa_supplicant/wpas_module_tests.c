@@ -9,8 +9,22 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "common/ieee802_11_defs.h"
+#include "drivers/driver.h"
 #include "wpa_supplicant_i.h"
+#include "config.h"
 #include "blacklist.h"
+#include "bss.h"
+#include "scan.h"
+#include "scan_history.h"
+#include "interworking.h"
+#include "anqp_cache.h"
+#include "gas_query.h"
+#include "offchannel.h"
+#include "common/gas.h"
+#ifdef CONFIG_WPS
+#include "wps/wps.h"
+#endif /* CONFIG_WPS */
 
 
 static int wpas_blacklist_module_tests(void)
@@ -69,14 +83,2013 @@ fail:
 }
 
 
-int wpas_module_tests(void)
+#define BSS_TEST_NUM 2000
+#define BSS_TEST_ROUNDS 5
+
+static void wpas_bss_test_addr(u8 *addr, u8 prefix, unsigned int i)
 {
-	int ret = 0;
+	addr[0] = prefix;
+	addr[1] = 0;
+	WPA_PUT_BE32(&addr[2], i);
+}
 
-	wpa_printf(MSG_INFO, "wpa_supplicant module tests");
 
-	if (wpas_blacklist_module_tests() < 0)
+/* Interface with an empty configuration, an empty BSS table and a radio */
+struct wpas_test_iface {
+	struct wpa_global global;
+	struct wpa_radio radio;
+	struct wpa_supplicant *wpa_s;
+};
+
+
+static struct wpa_supplicant * wpas_test_iface_init(struct wpas_test_iface *t)
+{
+	struct wpa_supplicant *wpa_s;
+
+	os_memset(t, 0, sizeof(*t));
+	dl_list_init(&t->global.freq_priority);
+	dl_list_init(&t->radio.ifaces);
+	dl_list_init(&t->radio.work);
+
+	wpa_s = os_zalloc(sizeof(*wpa_s));
+	if (wpa_s == NULL)
+		return NULL;
+	wpa_s->conf = wpa_config_alloc_empty(NULL, NULL);
+	if (wpa_s->conf == NULL) {
+		os_free(wpa_s);
+		return NULL;
+	}
+	wpa_s->global = &t->global;
+	wpa_s->radio = &t->radio;
+	dl_list_add(&t->radio.ifaces, &wpa_s->radio_list);
+	wpa_bss_init(wpa_s);
+	t->wpa_s = wpa_s;
+
+	return wpa_s;
+}
+
+
+static void wpas_test_iface_deinit(struct wpas_test_iface *t)
+{
+	struct wpa_supplicant *wpa_s = t->wpa_s;
+
+	if (wpa_s == NULL)
+		return;
+	radio_remove_works(wpa_s, NULL, 1);
+	radio_work_test_next(&t->radio);
+	os_free(t->radio.work_stats);
+	wpa_bss_deinit(wpa_s);
+	os_free(wpa_s->last_scan_res);
+	wpa_config_free(wpa_s->conf);
+	os_free(wpa_s);
+	t->wpa_s = NULL;
+}
+
+
+/*
+ * Allocate a scan result for test BSS i with a copy of the given Probe
+ * Response and Beacon IEs
+ */
+static struct wpa_scan_res * wpas_test_scan_res(unsigned int i, int freq,
+						const u8 *ies, size_t ies_len,
+						const u8 *beacon_ies,
+						size_t beacon_ies_len)
+{
+	struct wpa_scan_res *res;
+	u8 *pos;
+
+	res = os_zalloc(sizeof(*res) + ies_len + beacon_ies_len);
+	if (res == NULL)
+		return NULL;
+	wpas_bss_test_addr(res->bssid, 0x02, i);
+	res->freq = freq;
+	res->beacon_int = 100;
+	pos = (u8 *) (res + 1);
+	os_memcpy(pos, ies, ies_len);
+	res->ie_len = ies_len;
+	if (beacon_ies)
+		os_memcpy(pos + ies_len, beacon_ies, beacon_ies_len);
+	res->beacon_ie_len = beacon_ies_len;
+
+	return res;
+}
+
+
+static struct wpa_scan_res * wpas_bss_test_res(unsigned int i, int second,
+					       int level)
+{
+	struct wpa_scan_res *res;
+	u8 ies[2 + 32 + 2 + 4 + 3 + ETH_ALEN], *pos = ies;
+	char ssid[32];
+	int ssid_len;
+
+	ssid_len = os_snprintf(ssid, sizeof(ssid), "bss-test-%u%s", i / 4,
+			       second ? "-b" : "");
+	*pos++ = WLAN_EID_SSID;
+	*pos++ = ssid_len;
+	os_memcpy(pos, ssid, ssid_len);
+	pos += ssid_len;
+	if (i % 8 == 0 && !second) {
+		/* P2P GO with P2P Device ID attribute */
+		*pos++ = WLAN_EID_VENDOR_SPECIFIC;
+		*pos++ = 4 + 3 + ETH_ALEN;
+		WPA_PUT_BE32(pos, P2P_IE_VENDOR_TYPE);
+		pos += 4;
+		*pos++ = P2P_ATTR_DEVICE_ID;
+		WPA_PUT_LE16(pos, ETH_ALEN);
+		pos += 2;
+		wpas_bss_test_addr(pos, 0x06, i);
+		pos += ETH_ALEN;
+	}
+
+	res = wpas_test_scan_res(i, 2412 + 5 * (i % 11), ies, pos - ies,
+				 NULL, 0);
+	if (res)
+		res->level = level;
+
+	return res;
+}
+
+
+static int wpas_bss_check(struct wpa_supplicant *wpa_s, unsigned int i)
+{
+	struct wpa_bss *bss, *tmp, *latest = NULL;
+	struct wpa_scan_res *res;
+	const u8 *ssid;
+	u8 addr[ETH_ALEN];
+	int ret = -1;
+
+	res = wpas_bss_test_res(i, 0, 0);
+	if (res == NULL)
+		return -1;
+	ssid = wpa_scan_get_ie(res, WLAN_EID_SSID);
+	bss = wpa_bss_get(wpa_s, res->bssid, ssid + 2, ssid[1]);
+	if (bss == NULL || wpa_bss_get_id(wpa_s, bss->id) != bss)
+		goto fail;
+
+	/* The BSSID lookups must match the age ordered list */
+	dl_list_for_each_reverse(tmp, &wpa_s->bss, struct wpa_bss, list) {
+		if (os_memcmp(tmp->bssid, res->bssid, ETH_ALEN) == 0) {
+			latest = tmp;
+			break;
+		}
+	}
+	if (wpa_bss_get_bssid(wpa_s, res->bssid) != latest ||
+	    wpa_bss_get_bssid_latest(wpa_s, res->bssid) != latest)
+		goto fail;
+
+#ifdef CONFIG_P2P
+	wpas_bss_test_addr(addr, 0x06, i);
+	tmp = wpa_bss_get_p2p_dev_addr(wpa_s, addr);
+	if ((i % 8 == 0 && tmp != bss) || (i % 8 && tmp != NULL))
+		goto fail;
+#endif /* CONFIG_P2P */
+	wpas_bss_test_addr(addr, 0x0a, i);
+	if (wpa_bss_get_bssid(wpa_s, addr) != NULL)
+		goto fail;
+
+	ret = 0;
+fail:
+	os_free(res);
+	return ret;
+}
+
+
+static int wpas_bss_module_tests(void)
+{
+	struct wpas_test_iface t;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_scan_res **res;
+	struct os_reltime fetch;
+	unsigned int i, j, num = 0, round, expected;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "BSS table module tests");
+
+	wpa_s = wpas_test_iface_init(&t);
+	res = os_calloc(2 * BSS_TEST_NUM, sizeof(*res));
+	if (wpa_s == NULL || res == NULL)
+		goto fail;
+	wpa_s->conf->bss_max_count = 2 * BSS_TEST_NUM;
+
+	for (round = 0; round < BSS_TEST_ROUNDS; round++) {
+		/* Every 16th BSS advertises a second SSID */
+		num = 0;
+		for (i = 0; i < BSS_TEST_NUM; i++) {
+			j = round & 1 ? BSS_TEST_NUM - 1 - i : i;
+			res[num] = wpas_bss_test_res(j, 0, -50 - round);
+			if (res[num] == NULL)
+				goto fail;
+			num++;
+			if (j % 16 == 0) {
+				res[num] = wpas_bss_test_res(j, 1, -60);
+				if (res[num] == NULL)
+					goto fail;
+				num++;
+			}
+		}
+
+		os_get_reltime(&fetch);
+		wpa_bss_update_start(wpa_s);
+		for (i = 0; i < num; i++)
+			wpa_bss_update_scan_res(wpa_s, res[i], &fetch);
+		/* Duplicates within the same scan round are ignored */
+		wpa_bss_update_scan_res(wpa_s, res[0], &fetch);
+		wpa_bss_update_scan_res(wpa_s, res[num - 1], &fetch);
+		wpa_bss_update_end(wpa_s, NULL, 1);
+
+		for (i = 0; i < num; i++) {
+			os_free(res[i]);
+			res[i] = NULL;
+		}
+
+		expected = BSS_TEST_NUM + BSS_TEST_NUM / 16;
+		if (wpa_s->num_bss != expected ||
+		    wpa_s->last_scan_res_used != expected) {
+			wpa_printf(MSG_ERROR, "BSS module test: unexpected "
+				   "number of entries %u/%u (expected %u)",
+				   (unsigned int) wpa_s->num_bss,
+				   wpa_s->last_scan_res_used, expected);
+			goto fail;
+		}
+
+		for (i = 0; i < BSS_TEST_NUM; i++) {
+			if (wpas_bss_check(wpa_s, i) < 0) {
+				wpa_printf(MSG_ERROR, "BSS module test: lookup "
+					   "failed for entry %u in round %u",
+					   i, round);
+				goto fail;
+			}
+		}
+	}
+
+	wpa_bss_flush(wpa_s);
+	if (wpa_s->num_bss != 0 || wpa_bss_get_id(wpa_s, 0) != NULL)
+		goto fail;
+
+	ret = 0;
+fail:
+	wpas_test_iface_deinit(&t);
+	if (res) {
+		for (i = 0; i < 2 * BSS_TEST_NUM; i++)
+			os_free(res[i]);
+	}
+	os_free(res);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "BSS module test failure");
+
+	return ret;
+}
+
+
+#define SCAN_STREAM_TEST_NUM 1000
+
+/* RSN IE with CCMP/CCMP/PSK */
+static const u8 wpas_test_rsn_ie[] = {
+	WLAN_EID_RSN, 20, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00,
+	0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x02, 0x00, 0x00
+};
+
+static struct wpa_scan_res * wpas_scan_stream_test_res(unsigned int i)
+{
+	struct wpa_scan_res *res;
+	u8 ies[2 + 8 + 2 + 8 + sizeof(wpas_test_rsn_ie)], *pos = ies;
+
+	*pos++ = WLAN_EID_SSID;
+	*pos++ = 8;
+	os_snprintf((char *) pos, 9, "ssid%04u", i % 10000);
+	pos += 8;
+	*pos++ = WLAN_EID_SUPP_RATES;
+	*pos++ = 8;
+	os_memcpy(pos, "\x82\x84\x8b\x96\x0c\x12\x18\x24", 8);
+	if (i % 7 == 0)
+		pos[7] = 0x6c;
+	pos += 8;
+	if (i % 3 == 1) {
+		os_memcpy(pos, wpas_test_rsn_ie, sizeof(wpas_test_rsn_ie));
+		pos += sizeof(wpas_test_rsn_ie);
+	}
+
+	res = wpas_test_scan_res(i, i % 3 ? 2412 + 5 * (i % 13) :
+				 5180 + 20 * (i % 8), ies, pos - ies, NULL, 0);
+	if (res == NULL)
+		return NULL;
+	res->caps = i % 5 ? IEEE80211_CAP_PRIVACY : 0;
+	res->level = -30 - (i * 7919) % 60;
+	res->noise = -95;
+	res->flags = WPA_SCAN_LEVEL_DBM | WPA_SCAN_QUAL_INVALID;
+	if (i % 4 == 0)
+		res->flags |= WPA_SCAN_NOISE_INVALID;
+
+	return res;
+}
+
+
+static struct wpa_scan_results * wpas_scan_stream_test_get(void *priv)
+{
+	struct wpa_scan_results *res;
+	unsigned int i;
+
+	res = os_zalloc(sizeof(*res));
+	if (res == NULL)
+		return NULL;
+	res->res = os_calloc(SCAN_STREAM_TEST_NUM, sizeof(*res->res));
+	if (res->res == NULL) {
+		os_free(res);
+		return NULL;
+	}
+	for (i = 0; i < SCAN_STREAM_TEST_NUM; i++) {
+		res->res[i] = wpas_scan_stream_test_res(i);
+		if (res->res[i] == NULL) {
+			wpa_scan_results_free(res);
+			return NULL;
+		}
+		res->num++;
+	}
+
+	return res;
+}
+
+
+static int wpas_scan_stream_test_get_cb(void *priv,
+					void (*cb)(void *ctx,
+						   struct wpa_scan_res *res),
+					void *ctx)
+{
+	struct wpa_scan_res *res;
+	unsigned int i;
+
+	for (i = 0; i < SCAN_STREAM_TEST_NUM; i++) {
+		res = wpas_scan_stream_test_res(i);
+		if (res == NULL)
+			return -1;
+		cb(ctx, res);
+		os_free(res);
+	}
+
+	return SCAN_STREAM_TEST_NUM;
+}
+
+
+static int wpas_scan_stream_module_tests(void)
+{
+	struct wpa_driver_ops ops;
+	struct wpas_test_iface t;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_scan_results *scan_res;
+	u8 *order;
+	unsigned int i;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "Scan result streaming module tests");
+
+	os_memset(&ops, 0, sizeof(ops));
+	ops.get_scan_results2 = wpas_scan_stream_test_get;
+	ops.get_scan_results_cb = wpas_scan_stream_test_get_cb;
+
+	wpa_s = wpas_test_iface_init(&t);
+	order = os_malloc(SCAN_STREAM_TEST_NUM * ETH_ALEN);
+	if (wpa_s == NULL || order == NULL)
+		goto fail;
+	wpa_s->driver = &ops;
+	wpa_s->conf->bss_max_count = SCAN_STREAM_TEST_NUM;
+
+	scan_res = wpa_supplicant_get_scan_results(wpa_s, NULL, 1);
+	wpa_scan_results_free(scan_res);
+	if (scan_res == NULL ||
+	    wpa_s->last_scan_res_used != SCAN_STREAM_TEST_NUM)
+		goto fail;
+	for (i = 0; i < SCAN_STREAM_TEST_NUM; i++)
+		os_memcpy(&order[i * ETH_ALEN], wpa_s->last_scan_res[i]->bssid,
+			  ETH_ALEN);
+
+	/* Streamed results must end up in the same order */
+	if (wpa_supplicant_stream_scan_results(wpa_s, NULL, 1) !=
+	    SCAN_STREAM_TEST_NUM)
+		goto fail;
+	if (wpa_s->last_scan_res_used != SCAN_STREAM_TEST_NUM ||
+	    wpa_s->num_bss != SCAN_STREAM_TEST_NUM)
+		goto fail;
+	for (i = 0; i < SCAN_STREAM_TEST_NUM; i++) {
+		if (os_memcmp(&order[i * ETH_ALEN],
+			      wpa_s->last_scan_res[i]->bssid, ETH_ALEN) != 0) {
+			wpa_printf(MSG_ERROR, "Scan result streaming test: "
+				   "order differs at %u", i);
+			goto fail;
+		}
+	}
+
+	ret = 0;
+fail:
+	wpas_test_iface_deinit(&t);
+	os_free(order);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "Scan result streaming module test "
+			   "failure");
+
+	return ret;
+}
+
+
+#define SELECT_TEST_BSS 200
+
+static struct wpa_ssid * wpas_select_test_add(struct wpa_config *conf,
+					      const char *ssid_txt,
+					      int priority)
+{
+	struct wpa_ssid *ssid;
+	char buf[20];
+
+	ssid = wpa_config_add_network(conf);
+	if (ssid == NULL)
+		return NULL;
+	wpa_config_set_network_defaults(ssid);
+	os_snprintf(buf, sizeof(buf), "%d", priority);
+	if ((ssid_txt && wpa_config_set(ssid, "ssid", ssid_txt, 0) < 0) ||
+	    wpa_config_set(ssid, "priority", buf, 0) < 0 ||
+	    wpa_config_set(ssid, "psk", "0123456789abcdef0123456789abcdef"
+			   "0123456789abcdef0123456789abcdef", 0) < 0)
+		return NULL;
+
+	return ssid;
+}
+
+
+static int wpas_select_test_pick(struct wpa_supplicant *wpa_s,
+				 struct wpa_ssid *expected, const char *step)
+{
+	struct wpa_ssid *ssid = NULL;
+	struct wpa_bss *bss;
+
+	bss = wpa_supplicant_pick_network(wpa_s, &ssid);
+	if (bss == NULL || ssid != expected) {
+		wpa_printf(MSG_ERROR, "Network selection test: unexpected "
+			   "result for %s (network id %d)", step,
+			   ssid ? ssid->id : -1);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int wpas_select_test_run(unsigned int num_networks)
+{
+	struct wpas_test_iface t;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_config *conf;
+	struct wpa_scan_res *res;
+	struct wpa_ssid *ssid, *target, *disabled, *wildcard, *changed = NULL;
+	struct os_reltime fetch;
+	char buf[20];
+	unsigned int i;
+	int ret = -1;
+
+	wpa_s = wpas_test_iface_init(&t);
+	if (wpa_s == NULL)
+		return -1;
+	conf = wpa_s->conf;
+	conf->bss_max_count = SELECT_TEST_BSS;
+
+	/* BSSes i % 3 == 1 are RSN-PSK and i % 5 != 0 have privacy set */
+	os_get_reltime(&fetch);
+	wpa_bss_update_start(wpa_s);
+	for (i = 0; i < SELECT_TEST_BSS; i++) {
+		res = wpas_scan_stream_test_res(i);
+		if (res == NULL)
+			goto fail;
+		res->caps |= IEEE80211_CAP_ESS;
+		wpa_bss_update_scan_res(wpa_s, res, &fetch);
+		os_free(res);
+	}
+	wpa_bss_update_end(wpa_s, NULL, 1);
+
+	/* None of the SSIDs net%05u is in the scan results */
+	for (i = 0; i < num_networks; i++) {
+		os_snprintf(buf, sizeof(buf), "\"net%05u\"", i);
+		ssid = wpas_select_test_add(conf, buf, i % 4);
+		if (ssid == NULL)
+			goto fail;
+		if (i == (num_networks / 2 | 3))
+			changed = ssid; /* priority 3 */
+	}
+	target = wpas_select_test_add(conf, "\"ssid0004\"", 2);
+	disabled = wpas_select_test_add(conf, "\"ssid0007\"", 3);
+	wildcard = wpas_select_test_add(conf, NULL, 1);
+	ssid = wpas_select_test_add(conf, NULL, 1);
+	if (target == NULL || disabled == NULL || wildcard == NULL ||
+	    ssid == NULL || changed == NULL)
+		goto fail;
+	disabled->disabled = 1;
+	wildcard->bssid_set = 1;
+	wpas_bss_test_addr(wildcard->bssid, 0x02, 13);
+	ssid->bssid_set = 1;
+	wpas_bss_test_addr(ssid->bssid, 0x02, 10); /* no privacy */
+	wpa_config_update_prio_list(conf);
+
+	if (wpas_select_test_pick(wpa_s, target, "SSID match") < 0)
+		goto fail;
+
+	target->disabled = 1;
+	if (wpas_select_test_pick(wpa_s, wildcard, "BSSID-only network") < 0)
+		goto fail;
+
+	/* SSID change needs to be visible to the next selection */
+	if (wpa_config_set(changed, "ssid", "\"ssid0001\"", 0) < 0)
+		goto fail;
+	wpa_config_flush_ssid_index(conf);
+	if (wpas_select_test_pick(wpa_s, changed, "changed SSID") < 0)
+		goto fail;
+
+	ret = 0;
+fail:
+	wpas_test_iface_deinit(&t);
+	return ret;
+}
+
+
+static int wpas_select_module_tests(void)
+{
+	static const unsigned int sizes[] = { 10, 100, 300, 1000 };
+	unsigned int i;
+
+	wpa_printf(MSG_INFO, "Network selection module tests");
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		if (wpas_select_test_run(sizes[i]) < 0) {
+			wpa_printf(MSG_ERROR, "Network selection module test "
+				   "failure");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+static struct wpa_scan_res * wpas_sort_test_res(unsigned int i)
+{
+	static const u8 wpa[] = {
+		WLAN_EID_VENDOR_SPECIFIC, 22, 0x00, 0x50, 0xf2, 0x01, 0x01,
+		0x00, 0x00, 0x50, 0xf2, 0x02, 0x01, 0x00, 0x00, 0x50, 0xf2,
+		0x02, 0x01, 0x00, 0x00, 0x50, 0xf2, 0x02
+	};
+	struct wpa_scan_res *res;
+	u8 ies[2 + 8 + 2 + 8 + sizeof(wpas_test_rsn_ie) + sizeof(wpa) +
+	       2 + 4 + 5 + 5], *pos = ies;
+
+	*pos++ = WLAN_EID_SSID;
+	*pos++ = 8;
+	os_snprintf((char *) pos, 9, "sort%04u", i % 10000);
+	pos += 8;
+	*pos++ = WLAN_EID_SUPP_RATES;
+	*pos++ = 8;
+	os_memcpy(pos, "\x82\x84\x8b\x96\x0c\x12\x18\x24", 8);
+	if (i % 11 == 0)
+		pos[7] = 0x6c;
+	else if (i % 11 == 1)
+		pos[7] = 0x60;
+	pos += 8;
+	if (i % 3 == 1) {
+		os_memcpy(pos, wpas_test_rsn_ie, sizeof(wpas_test_rsn_ie));
+		pos += sizeof(wpas_test_rsn_ie);
+	}
+	if (i % 7 == 2) {
+		os_memcpy(pos, wpa, sizeof(wpa));
+		pos += sizeof(wpa);
+	}
+	if (i % 4 == 0) {
+		/* WPS IE with Version and optionally Selected Registrar */
+		*pos++ = WLAN_EID_VENDOR_SPECIFIC;
+		*pos++ = i % 8 == 0 ? 4 + 5 + 5 : 4 + 5;
+		WPA_PUT_BE32(pos, WPS_IE_VENDOR_TYPE);
+		pos += 4;
+		WPA_PUT_BE16(pos, 0x104a);
+		WPA_PUT_BE16(pos + 2, 1);
+		pos[4] = 0x10;
+		pos += 5;
+		if (i % 8 == 0) {
+			WPA_PUT_BE16(pos, 0x1041);
+			WPA_PUT_BE16(pos + 2, 1);
+			pos[4] = 1;
+			pos += 5;
+		}
+	}
+
+	res = wpas_test_scan_res(i, i % 5 ? 2412 + 5 * (i % 13) :
+				 5180 + 20 * (i % 8), ies, pos - ies, NULL, 0);
+	if (res == NULL)
+		return NULL;
+	res->caps = IEEE80211_CAP_ESS;
+	if (i % 5)
+		res->caps |= IEEE80211_CAP_PRIVACY;
+	/*
+	 * SNR differences are either zero or at least five dB to get a
+	 * consistent ordering for the check in wpas_sort_test_check().
+	 */
+	res->level = -70 - 6 * ((i * 7) % 4);
+	res->noise = -95;
+	res->flags = WPA_SCAN_LEVEL_DBM | WPA_SCAN_QUAL_INVALID;
+
+	return res;
+}
+
+
+static int wpas_sort_test_max_rate(struct wpa_scan_res *res)
+{
+	const u8 *ie;
+	int i, rate = 0;
+
+	ie = wpa_scan_get_ie(res, WLAN_EID_SUPP_RATES);
+	for (i = 0; ie && i < ie[1]; i++) {
+		if ((ie[i + 2] & 0x7f) > rate)
+			rate = ie[i + 2] & 0x7f;
+	}
+
+	return rate;
+}
+
+
+/*
+ * Comparison with IE lookups as done before the sort keys were introduced.
+ * The test data has only SNRs below GREAT_SNR and no quality values.
+ */
+static int wpas_sort_test_compar_common(struct wpa_scan_res *a,
+					struct wpa_scan_res *b)
+{
+	int snr_a, snr_b, maxrate_a, maxrate_b;
+
+	snr_a = a->level - a->noise;
+	snr_b = b->level - b->noise;
+	if (abs(snr_b - snr_a) < 5) {
+		maxrate_a = wpas_sort_test_max_rate(a);
+		maxrate_b = wpas_sort_test_max_rate(b);
+		if (maxrate_a != maxrate_b)
+			return maxrate_b - maxrate_a;
+		if ((a->freq > 4000) != (b->freq > 4000))
+			return a->freq > 4000 ? -1 : 1;
+	}
+	return snr_b - snr_a;
+}
+
+
+static int wpas_sort_test_compar(const void *_a, const void *_b)
+{
+	struct wpa_scan_res *a = *(struct wpa_scan_res **) _a;
+	struct wpa_scan_res *b = *(struct wpa_scan_res **) _b;
+	int wpa_a, wpa_b;
+
+	wpa_a = wpa_scan_get_vendor_ie(a, WPA_IE_VENDOR_TYPE) != NULL ||
+		wpa_scan_get_ie(a, WLAN_EID_RSN) != NULL;
+	wpa_b = wpa_scan_get_vendor_ie(b, WPA_IE_VENDOR_TYPE) != NULL ||
+		wpa_scan_get_ie(b, WLAN_EID_RSN) != NULL;
+	if (wpa_a != wpa_b)
+		return wpa_b - wpa_a;
+	if ((a->caps ^ b->caps) & IEEE80211_CAP_PRIVACY)
+		return (b->caps & IEEE80211_CAP_PRIVACY) ? 1 : -1;
+	return wpas_sort_test_compar_common(a, b);
+}
+
+
+#ifdef CONFIG_WPS
+static int wpas_sort_test_wps_compar(const void *_a, const void *_b)
+{
+	struct wpa_scan_res *a = *(struct wpa_scan_res **) _a;
+	struct wpa_scan_res *b = *(struct wpa_scan_res **) _b;
+	struct wpabuf *wps_a, *wps_b;
+	int res;
+
+	wps_a = wpa_scan_get_vendor_ie_multi(a, WPS_IE_VENDOR_TYPE);
+	wps_b = wpa_scan_get_vendor_ie_multi(b, WPS_IE_VENDOR_TYPE);
+	if (wps_a && wps_b)
+		res = wps_ap_priority_compar(wps_a, wps_b);
+	else
+		res = (wps_b != NULL) - (wps_a != NULL);
+	wpabuf_free(wps_a);
+	wpabuf_free(wps_b);
+	if (res)
+		return res;
+	return wpas_sort_test_compar_common(a, b);
+}
+#endif /* CONFIG_WPS */
+
+
+static int wpas_sort_test_run(struct wpa_supplicant *wpa_s,
+			      struct wpa_scan_results *scan_res, int wps)
+{
+	int (*compar)(const void *, const void *) = wpas_sort_test_compar;
+	size_t i;
+
+#ifdef CONFIG_WPS
+	if (wps)
+		compar = wpas_sort_test_wps_compar;
+#endif /* CONFIG_WPS */
+
+	wpa_supplicant_sort_scan_results(wpa_s, scan_res);
+
+	for (i = 0; i + 1 < scan_res->num; i++) {
+		if (compar(&scan_res->res[i], &scan_res->res[i + 1]) > 0) {
+			wpa_printf(MSG_ERROR, "Scan result sort test: entries "
+				   "%u and %u out of order", (unsigned int) i,
+				   (unsigned int) i + 1);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+static int wpas_sort_module_tests(void)
+{
+	static const unsigned int sizes[] = { 100, 1000, 10000 };
+	struct wpas_test_iface t;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_scan_results scan_res;
+#ifdef CONFIG_WPS
+	struct wpa_ssid *ssid;
+#endif /* CONFIG_WPS */
+	unsigned int i, j;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "Scan result sort module tests");
+
+	os_memset(&scan_res, 0, sizeof(scan_res));
+	wpa_s = wpas_test_iface_init(&t);
+	if (wpa_s == NULL)
+		return -1;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		scan_res.res = os_calloc(sizes[i], sizeof(*scan_res.res));
+		if (scan_res.res == NULL)
+			goto fail;
+		for (j = 0; j < sizes[i]; j++) {
+			/* Replay the same dump in a varying order */
+			scan_res.res[j] = wpas_sort_test_res((j * 7919 + i) %
+							     sizes[i]);
+			if (scan_res.res[j] == NULL)
+				goto fail;
+			scan_res.num++;
+		}
+
+		if (wpas_sort_test_run(wpa_s, &scan_res, 0) < 0)
+			goto fail;
+#ifdef CONFIG_WPS
+		/* An enabled WPS network switches to WPS provisioning order */
+		ssid = wpa_config_add_network(wpa_s->conf);
+		if (ssid == NULL)
+			goto fail;
+		ssid->key_mgmt = WPA_KEY_MGMT_WPS;
+		if (wpas_sort_test_run(wpa_s, &scan_res, 1) < 0)
+			goto fail;
+		wpa_config_remove_network(wpa_s->conf, ssid->id);
+#endif /* CONFIG_WPS */
+
+		for (j = 0; j < scan_res.num; j++)
+			os_free(scan_res.res[j]);
+		os_free(scan_res.res);
+		scan_res.res = NULL;
+		scan_res.num = 0;
+	}
+
+	ret = 0;
+fail:
+	for (j = 0; j < scan_res.num; j++)
+		os_free(scan_res.res[j]);
+	os_free(scan_res.res);
+	wpas_test_iface_deinit(&t);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "Scan result sort module test failure");
+
+	return ret;
+}
+
+
+static const u8 wpas_bss_ie_test_ies[] = {
+	WLAN_EID_SSID, 7, 'i', 'e', '-', 't', 'e', 's', 't',
+	WLAN_EID_SUPP_RATES, 4, 0x82, 0x84, 0x8b, 0x96,
+	WLAN_EID_DS_PARAMS, 1, 6,
+	WLAN_EID_RSN, 20, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01,
+	0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac,
+	0x02, 0x00, 0x00,
+	/* Fragmented WPS IE with an unrelated vendor IE in between */
+	WLAN_EID_VENDOR_SPECIFIC, 6, 0x00, 0x50, 0xf2, 0x04, 0x10, 0x4a,
+	WLAN_EID_VENDOR_SPECIFIC, 7, 0x00, 0x50, 0xf2, 0x02, 0x00, 0x01,
+	0x00,
+	WLAN_EID_VENDOR_SPECIFIC, 2, 0x00, 0x50,
+	WLAN_EID_VENDOR_SPECIFIC, 5, 0x00, 0x50, 0xf2, 0x04, 0x10,
+	WLAN_EID_EXT_SUPP_RATES, 2, 0x0c, 0x12,
+	WLAN_EID_EXT_SUPP_RATES, 2, 0x18, 0x24,
+	WLAN_EID_HT_CAP, 0,
+	/* Truncated element at the end */
+	WLAN_EID_VHT_CAP, 12, 0x00, 0x00
+};
+
+static const u8 wpas_bss_ie_test_beacon_ies[] = {
+	WLAN_EID_SSID, 7, 'i', 'e', '-', 't', 'e', 's', 't',
+	WLAN_EID_VENDOR_SPECIFIC, 5, 0x50, 0x6f, 0x9a, 0x09, 0x02,
+	WLAN_EID_VENDOR_SPECIFIC, 6, 0x00, 0x50, 0xf2, 0x04, 0x10, 0x4a,
+	WLAN_EID_VENDOR_SPECIFIC, 5, 0x50, 0x6f, 0x9a, 0x09, 0x03
+};
+
+static struct wpa_scan_res * wpas_bss_ie_test_res(int extra)
+{
+	u8 ies[4 + sizeof(wpas_bss_ie_test_ies)], *pos = ies;
+
+	if (extra) {
+		*pos++ = WLAN_EID_SSID;
+		*pos++ = 0;
+		*pos++ = WLAN_EID_TIM;
+		*pos++ = 0;
+	}
+	os_memcpy(pos, wpas_bss_ie_test_ies, sizeof(wpas_bss_ie_test_ies));
+	pos += sizeof(wpas_bss_ie_test_ies);
+
+	return wpas_test_scan_res(1, 2437, ies, pos - ies,
+				  wpas_bss_ie_test_beacon_ies,
+				  sizeof(wpas_bss_ie_test_beacon_ies));
+}
+
+
+static int wpas_bss_ie_buf_equal(struct wpabuf *a, struct wpabuf *b)
+{
+	int ret;
+
+	ret = (a == NULL && b == NULL) ||
+		(a && b && wpabuf_len(a) == wpabuf_len(b) &&
+		 os_memcmp(wpabuf_head(a), wpabuf_head(b),
+			   wpabuf_len(a)) == 0);
+	wpabuf_free(a);
+	wpabuf_free(b);
+	return ret;
+}
+
+
+static int wpas_bss_ie_check(struct wpa_bss *bss)
+{
+	static const u32 vendor_types[] = {
+		WPS_IE_VENDOR_TYPE, WPA_IE_VENDOR_TYPE, P2P_IE_VENDOR_TYPE,
+		0x0050f202, 0x506f9a0a, 0x00500000
+	};
+	struct wpa_bss_ie_index *idx = bss->ies->index;
+	const u8 *a, *b;
+	struct wpabuf *ma, *mb, *mba, *mbb;
+	unsigned int i;
+
+	if (idx == NULL)
+		return -1;
+
+	/* The indexed lookups must match walking the IEs */
+	for (i = 0; i < 256; i++) {
+		a = wpa_bss_get_ie(bss, i);
+		bss->ies->index = NULL;
+		b = wpa_bss_get_ie(bss, i);
+		bss->ies->index = idx;
+		if (a != b)
+			return -1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(vendor_types); i++) {
+		u32 type = vendor_types[i];
+		const u8 *a2, *b2, *a3, *b3;
+
+		a = wpa_bss_get_vendor_ie(bss, type);
+		a2 = wpa_bss_get_vendor_ie_beacon(bss, type);
+		a3 = wpa_bss_get_vendor_ie_subtype(bss, type >> 8, type & 0xff);
+		ma = wpa_bss_get_vendor_ie_multi(bss, type);
+		mba = wpa_bss_get_vendor_ie_multi_beacon(bss, type);
+		bss->ies->index = NULL;
+		b = wpa_bss_get_vendor_ie(bss, type);
+		b2 = wpa_bss_get_vendor_ie_beacon(bss, type);
+		b3 = wpa_bss_get_vendor_ie_subtype(bss, type >> 8, type & 0xff);
+		mb = wpa_bss_get_vendor_ie_multi(bss, type);
+		mbb = wpa_bss_get_vendor_ie_multi_beacon(bss, type);
+		bss->ies->index = idx;
+		if (!wpas_bss_ie_buf_equal(ma, mb) ||
+		    !wpas_bss_ie_buf_equal(mba, mbb) ||
+		    a != b || a2 != b2 || a3 != b3)
+			return -1;
+	}
+
+	return 0;
+}
+
+
+static int wpas_bss_ie_module_tests(void)
+{
+	struct wpas_test_iface t;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_scan_res *res;
+	struct wpa_bss *bss;
+	struct os_reltime fetch;
+	unsigned int i;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "BSS IE index module tests");
+
+	wpa_s = wpas_test_iface_init(&t);
+	if (wpa_s == NULL)
+		return -1;
+
+	for (i = 0; i < 3; i++) {
+		/* Add and update with changed Beacon and Probe Response IEs */
+		res = wpas_bss_ie_test_res(i == 2);
+		if (res == NULL)
+			goto fail;
+		if (i == 1)
+			res->beacon_ie_len -= 7;
+		os_get_reltime(&fetch);
+		wpa_bss_update_start(wpa_s);
+		wpa_bss_update_scan_res(wpa_s, res, &fetch);
+		wpa_bss_update_end(wpa_s, NULL, 1);
+		os_free(res);
+		bss = dl_list_first(&wpa_s->bss, struct wpa_bss, list);
+		if (bss == NULL || wpas_bss_ie_check(bss) < 0) {
+			wpa_printf(MSG_ERROR, "BSS IE index module test: "
+				   "lookup mismatch in step %u", i);
+			goto fail;
+		}
+	}
+
+	ret = 0;
+fail:
+	wpas_test_iface_deinit(&t);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "BSS IE index module test failure");
+
+	return ret;
+}
+
+
+#define BSS_IES_TEST_COUNT 100
+
+static struct wpa_scan_res * wpas_bss_ies_test_res(unsigned int i, u8 channel,
+						   int shared)
+{
+	u8 ies[sizeof(wpas_bss_ie_test_ies)];
+
+	os_memcpy(ies, wpas_bss_ie_test_ies, sizeof(ies));
+	/* DS Parameter Set */
+	ies[2 + 7 + 2 + 4 + 2] = channel;
+
+	/* With shared set, Beacon IEs are identical to Probe Response IEs */
+	return wpas_test_scan_res(i, 2437, ies, sizeof(ies),
+				  shared ? ies : wpas_bss_ie_test_beacon_ies,
+				  shared ? sizeof(ies) :
+				  sizeof(wpas_bss_ie_test_beacon_ies));
+}
+
+
+static int wpas_bss_ies_test_update(struct wpa_supplicant *wpa_s,
+				    unsigned int first, unsigned int num,
+				    u8 channel)
+{
+	struct wpa_scan_res *res;
+	struct os_reltime fetch;
+	unsigned int i;
+
+	os_get_reltime(&fetch);
+	wpa_bss_update_start(wpa_s);
+	for (i = first; i < first + num; i++) {
+		res = wpas_bss_ies_test_res(i, channel, i % 2);
+		if (res == NULL)
+			return -1;
+		wpa_bss_update_scan_res(wpa_s, res, &fetch);
+		os_free(res);
+	}
+	wpa_bss_update_end(wpa_s, NULL, 1);
+
+	return 0;
+}
+
+
+static int wpas_bss_ies_module_tests(void)
+{
+	struct wpas_test_iface t;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_scan_res *res;
+	struct wpa_bss *bss, *first[2] = { NULL, NULL };
+	size_t ie_len, beacon_ie_len, ref_bytes;
+	u8 addr[ETH_ALEN];
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "BSS shared IE module tests");
+
+	wpa_s = wpas_test_iface_init(&t);
+	if (wpa_s == NULL)
+		return -1;
+
+	res = wpas_bss_ie_test_res(0);
+	if (res == NULL)
+		goto fail;
+	ie_len = res->ie_len;
+	beacon_ie_len = res->beacon_ie_len;
+	os_free(res);
+
+	/* Every other BSS has Beacon IEs identical to Probe Response IEs */
+	if (wpas_bss_ies_test_update(wpa_s, 0, BSS_IES_TEST_COUNT, 6) < 0)
+		goto fail;
+	ref_bytes = BSS_IES_TEST_COUNT / 2 * (3 * ie_len + beacon_ie_len);
+	if (wpa_s->num_bss != BSS_IES_TEST_COUNT ||
+	    wpa_s->bss_ies_num != 2 ||
+	    wpa_s->bss_ies_bytes != 2 * ie_len + beacon_ie_len ||
+	    wpa_s->bss_ies_ref_bytes != ref_bytes) {
+		wpa_printf(MSG_ERROR, "BSS shared IE module test: unexpected "
+			   "sharing (%u sets, %lu/%lu octets)",
+			   wpa_s->bss_ies_num,
+			   (unsigned long) wpa_s->bss_ies_bytes,
+			   (unsigned long) wpa_s->bss_ies_ref_bytes);
+		goto fail;
+	}
+
+	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+		int shared = wpa_bss_beacon_ie_ptr(bss) == wpa_bss_ie_ptr(bss);
+		int odd = bss->bssid[ETH_ALEN - 1] & 1;
+
+		if (first[odd] == NULL)
+			first[odd] = bss;
+		if (shared != odd || bss->ies != first[odd]->ies ||
+		    bss->ie_len != ie_len ||
+		    bss->beacon_ie_len != (odd ? ie_len : beacon_ie_len) ||
+		    wpas_bss_ie_check(bss) < 0) {
+			wpa_printf(MSG_ERROR, "BSS shared IE module test: "
+				   "mismatch for " MACSTR,
+				   MAC2STR(bss->bssid));
+			goto fail;
+		}
+	}
+
+	/* Changed IEs move the entries to another shared instance */
+	if (wpas_bss_ies_test_update(wpa_s, 0, 2, 11) < 0)
+		goto fail;
+	wpas_bss_test_addr(addr, 0x02, 3);
+	first[1] = wpa_bss_get_bssid(wpa_s, addr);
+	wpas_bss_test_addr(addr, 0x02, 0);
+	bss = wpa_bss_get_bssid(wpa_s, addr);
+	if (wpa_s->bss_ies_num != 4 || bss == NULL || first[1] == NULL ||
+	    wpa_bss_get_ie(bss, WLAN_EID_DS_PARAMS)[2] != 11 ||
+	    wpa_bss_get_ie(first[1], WLAN_EID_DS_PARAMS)[2] != 6 ||
+	    wpa_s->bss_ies_ref_bytes != ref_bytes ||
+	    wpas_bss_ie_check(bss) < 0) {
+		wpa_printf(MSG_ERROR, "BSS shared IE module test: IE update "
+			   "failed");
+		goto fail;
+	}
+
+	wpa_bss_flush(wpa_s);
+	if (wpa_s->num_bss || wpa_s->bss_ies_num || wpa_s->bss_ies_bytes ||
+	    wpa_s->bss_ies_ref_bytes) {
+		wpa_printf(MSG_ERROR, "BSS shared IE module test: IEs left "
+			   "after flush");
+		goto fail;
+	}
+
+	wpa_printf(MSG_INFO, "BSS shared IE module test: %u BSSes: %lu octets "
+		   "of IEs stored for %lu octets referenced",
+		   BSS_IES_TEST_COUNT,
+		   (unsigned long) (2 * ie_len + beacon_ie_len),
+		   (unsigned long) ref_bytes);
+
+	ret = 0;
+fail:
+	wpas_test_iface_deinit(&t);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "BSS shared IE module test failure");
+
+	return ret;
+}
+
+
+#ifdef CONFIG_SCAN_HISTORY
+
+#define SCAN_HISTORY_TEST_FILE "/tmp/wpas-module-tests-scan-history"
+
+static int wpas_scan_history_test_modes(struct wpa_supplicant *wpa_s)
+{
+	static const int freqs_a[] = {
+		5180, 5200, 5220, 5240, 5260, 5280, 5300, 5320,
+		5500, 5520, 5540, 5560, 5580, 5600, 5620, 5640
+	};
+	struct hostapd_hw_modes *modes;
+	int i;
+
+	modes = os_calloc(2, sizeof(*modes));
+	if (modes == NULL)
+		return -1;
+	wpa_s->hw.modes = modes;
+	wpa_s->hw.num_modes = 2;
+	modes[0].mode = HOSTAPD_MODE_IEEE80211G;
+	modes[0].num_channels = 13;
+	modes[1].mode = HOSTAPD_MODE_IEEE80211A;
+	modes[1].num_channels = ARRAY_SIZE(freqs_a);
+	modes[0].channels = os_calloc(modes[0].num_channels,
+				      sizeof(struct hostapd_channel_data));
+	modes[1].channels = os_calloc(modes[1].num_channels,
+				      sizeof(struct hostapd_channel_data));
+	if (modes[0].channels == NULL || modes[1].channels == NULL)
+		return -1;
+	for (i = 0; i < modes[0].num_channels; i++) {
+		modes[0].channels[i].chan = i + 1;
+		modes[0].channels[i].freq = 2412 + 5 * i;
+	}
+	for (i = 0; i < modes[1].num_channels; i++) {
+		modes[1].channels[i].chan = (freqs_a[i] - 5000) / 5;
+		modes[1].channels[i].freq = freqs_a[i];
+		if (freqs_a[i] >= 5260)
+			modes[1].channels[i].flag = HOSTAPD_CHAN_RADAR |
+				HOSTAPD_CHAN_NO_IR;
+	}
+
+	return 0;
+}
+
+
+/* BSS i uses SSID ssid<i % 10000> */
+static int wpas_scan_history_test_scan(struct wpa_supplicant *wpa_s,
+				       const unsigned int *bss,
+				       const int *freqs, size_t num,
+				       int duration_ms)
+{
+	struct wpa_scan_res *res;
+	struct os_reltime fetch;
+	size_t i;
+
+	os_get_reltime(&wpa_s->scan_trigger_time);
+	wpa_s->scan_trigger_time.sec -= duration_ms / 1000;
+	wpa_s->scan_trigger_time.usec -= (duration_ms % 1000) * 1000;
+	if (wpa_s->scan_trigger_time.usec < 0) {
+		wpa_s->scan_trigger_time.sec--;
+		wpa_s->scan_trigger_time.usec += 1000000;
+	}
+
+	os_get_reltime(&fetch);
+	wpa_bss_update_start(wpa_s);
+	for (i = 0; i < num; i++) {
+		res = wpas_scan_stream_test_res(bss[i]);
+		if (res == NULL)
+			return -1;
+		res->freq = freqs[i];
+		res->caps |= IEEE80211_CAP_ESS;
+		wpa_bss_update_scan_res(wpa_s, res, &fetch);
+		os_free(res);
+	}
+	wpa_bss_update_end(wpa_s, NULL, 1);
+	scan_history_scan_results(wpa_s);
+
+	return 0;
+}
+
+
+static int wpas_scan_history_test_done(struct wpa_supplicant *wpa_s,
+				       unsigned int selected)
+{
+	struct wpa_bss *bss = NULL;
+	u8 addr[ETH_ALEN];
+
+	if (selected) {
+		wpas_bss_test_addr(addr, 0x02, selected);
+		bss = wpa_bss_get_bssid(wpa_s, addr);
+		if (bss == NULL)
+			return -1;
+	}
+	scan_history_scan_done(wpa_s, bss);
+
+	return 0;
+}
+
+
+static int wpas_scan_history_test_plan(struct wpa_supplicant *wpa_s,
+				       const int *expected, const char *step)
+{
+	int *freqs;
+	int i, j, num, ok;
+
+	freqs = scan_history_plan(wpa_s);
+	num = freqs ? int_array_len(freqs) : 0;
+	ok = (freqs == NULL) == (expected == NULL);
+	for (i = 0; ok && expected && expected[i]; i++) {
+		for (j = 0; j < num; j++) {
+			if (freqs[j] == expected[i])
+				break;
+		}
+		if (j == num)
+			ok = 0;
+	}
+	if (ok && expected && i != num)
+		ok = 0;
+	os_free(freqs);
+
+	if (!ok) {
+		wpa_printf(MSG_ERROR, "Scan history test: unexpected channels "
+			   "for %s (%d channels)", step, num);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int wpas_scan_history_module_tests(void)
+{
+	/* Location A: ssid0004 on two channels and ssid0011 */
+	static const unsigned int bss_a[] = { 4, 10004, 11, 5 };
+	static const int freqs_a[] = { 2437, 5180, 2462, 2412 };
+	static const int plan_a[] = { 2437, 5180, 2462, 0 };
+	/* Location B: ssid0004 and ssid0011 on DFS channels */
+	static const unsigned int bss_b[] = { 20004, 20011 };
+	static const int freqs_b[] = { 5500, 5520 };
+	static const int plan_b[] = { 5500, 5520, 0 };
+	static const int plan_ess[] = { 2437, 5180, 2462, 5500, 5520, 0 };
+	struct wpas_test_iface t;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_ssid *ssid;
+	struct scan_history_stats stats;
+	char *buf = NULL;
+	size_t i, len;
+	FILE *f;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "Scan history module tests");
+
+	unlink(SCAN_HISTORY_TEST_FILE);
+	wpa_s = wpas_test_iface_init(&t);
+	if (wpa_s == NULL)
+		return -1;
+	wpa_s->conf->scan_history = os_strdup(SCAN_HISTORY_TEST_FILE);
+	if (wpa_s->conf->scan_history == NULL ||
+	    wpas_scan_history_test_modes(wpa_s) < 0)
+		goto fail;
+	wpa_s->wpa_state = WPA_SCANNING;
+	if (wpas_select_test_add(wpa_s->conf, "\"ssid0004\"", 0) == NULL ||
+	    wpas_select_test_add(wpa_s->conf, "\"ssid0011\"", 0) == NULL)
+		goto fail;
+	wpa_config_update_prio_list(wpa_s->conf);
+	if (scan_history_init(wpa_s) < 0 || wpa_s->scan_history == NULL)
+		goto fail;
+
+	/* No history yet; full scan at location A */
+	if (wpas_scan_history_test_plan(wpa_s, NULL, "empty history") < 0 ||
+	    wpas_scan_history_test_scan(wpa_s, bss_a, freqs_a,
+					ARRAY_SIZE(bss_a), 3000) < 0 ||
+	    wpas_scan_history_test_done(wpa_s, 4) < 0)
+		goto fail;
+
+	/*
+	 * Moved to location B: the channels of location A do not find the
+	 * networks and the ESS stage would scan the same channels, so a full
+	 * scan is used next.
+	 */
+	if (wpas_scan_history_test_plan(wpa_s, plan_a, "location A") < 0 ||
+	    wpas_scan_history_test_scan(wpa_s, NULL, NULL, 0, 200) < 0 ||
+	    wpas_scan_history_test_done(wpa_s, 0) < 0 ||
+	    wpas_scan_history_test_plan(wpa_s, NULL, "fallback") < 0 ||
+	    wpas_scan_history_test_scan(wpa_s, bss_b, freqs_b,
+					ARRAY_SIZE(bss_b), 3000) < 0 ||
+	    wpas_scan_history_test_done(wpa_s, 20004) < 0)
+		goto fail;
+
+	/* Reconnect at location B */
+	if (wpas_scan_history_test_plan(wpa_s, plan_b, "location B") < 0 ||
+	    wpas_scan_history_test_scan(wpa_s, bss_b, freqs_b,
+					ARRAY_SIZE(bss_b), 300) < 0 ||
+	    wpas_scan_history_test_done(wpa_s, 20004) < 0)
+		goto fail;
+
+	/* Not found at location B: all channels of the ESSes, then full */
+	if (wpas_scan_history_test_plan(wpa_s, plan_b, "location B") < 0 ||
+	    wpas_scan_history_test_scan(wpa_s, NULL, NULL, 0, 300) < 0 ||
+	    wpas_scan_history_test_done(wpa_s, 0) < 0 ||
+	    wpas_scan_history_test_plan(wpa_s, plan_ess, "ESS") < 0 ||
+	    wpas_scan_history_test_scan(wpa_s, NULL, NULL, 0, 500) < 0 ||
+	    wpas_scan_history_test_done(wpa_s, 0) < 0 ||
+	    wpas_scan_history_test_plan(wpa_s, NULL, "fallback") < 0)
+		goto fail;
+
+	scan_history_get_stats(wpa_s, &stats);
+	if (stats.partial_scans != 4 || stats.partial_hits != 1 ||
+	    stats.fallback_scans != 2 || stats.full_scans != 2 ||
+	    stats.saved_usec == 0 || stats.wasted_usec == 0) {
+		wpa_printf(MSG_ERROR, "Scan history test: unexpected stats "
+			   "partial=%u hits=%u fallback=%u full=%u",
+			   stats.partial_scans, stats.partial_hits,
+			   stats.fallback_scans, stats.full_scans);
+		goto fail;
+	}
+	wpa_printf(MSG_INFO, "Scan history test: %u entries, %llu msec saved, "
+		   "%llu msec used for partial scans without results",
+		   stats.entries, stats.saved_usec / 1000,
+		   stats.wasted_usec / 1000);
+
+	/* The history and the location are restored from the file */
+	scan_history_deinit(wpa_s);
+	if (scan_history_init(wpa_s) < 0 ||
+	    wpas_scan_history_test_plan(wpa_s, plan_b, "restored") < 0)
+		goto fail;
+
+	/* Networks without an SSID cannot be found based on the history */
+	ssid = wpas_select_test_add(wpa_s->conf, NULL, 0);
+	if (ssid == NULL)
+		goto fail;
+	wpa_config_update_prio_list(wpa_s->conf);
+	if (wpas_scan_history_test_plan(wpa_s, NULL, "wildcard") < 0)
+		goto fail;
+	ssid->disabled = 1;
+
+	/* Truncated history files are ignored */
+	scan_history_deinit(wpa_s);
+	buf = os_readfile(SCAN_HISTORY_TEST_FILE, &len);
+	if (buf == NULL)
+		goto fail;
+	for (i = 1; i < len; i += 7) {
+		f = fopen(SCAN_HISTORY_TEST_FILE, "wb");
+		if (f == NULL)
+			goto fail;
+		fwrite(buf, 1, i, f);
+		fclose(f);
+		if (scan_history_init(wpa_s) < 0 ||
+		    wpas_scan_history_test_plan(wpa_s, NULL, "truncated") < 0)
+			goto fail;
+		scan_history_deinit(wpa_s);
+	}
+
+	ret = 0;
+fail:
+	os_free(buf);
+	scan_history_deinit(wpa_s);
+	unlink(SCAN_HISTORY_TEST_FILE);
+	if (wpa_s->hw.modes) {
+		os_free(wpa_s->hw.modes[0].channels);
+		os_free(wpa_s->hw.modes[1].channels);
+		os_free(wpa_s->hw.modes);
+	}
+	wpas_test_iface_deinit(&t);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "Scan history module test failure");
+
+	return ret;
+}
+
+#endif /* CONFIG_SCAN_HISTORY */
+
+#ifdef CONFIG_ANQP_CACHE
+
+#define ANQP_CACHE_TEST_FILE "/tmp/wpas-module-tests-anqp-cache"
+
+static struct wpa_bss * wpas_anqp_cache_test_bss(struct wpa_supplicant *wpa_s,
+						 unsigned int i, int domain_id)
+{
+	static const u8 hessid[ETH_ALEN] = { 0x02, 0xaa, 0, 0, 0, 1 };
+	struct wpa_scan_res *res;
+	struct os_reltime fetch;
+	u8 bssid[ETH_ALEN];
+	u8 ies[2 + 4 + 2 + 7 + 2 + 7], *pos = ies;
+
+	*pos++ = WLAN_EID_SSID;
+	*pos++ = 4;
+	os_memcpy(pos, "hs20", 4);
+	pos += 4;
+	*pos++ = WLAN_EID_INTERWORKING;
+	*pos++ = 7;
+	*pos++ = 0x02; /* Chargeable public network */
+	os_memcpy(pos, hessid, ETH_ALEN);
+	pos += ETH_ALEN;
+	*pos++ = WLAN_EID_VENDOR_SPECIFIC;
+	*pos++ = 7;
+	WPA_PUT_BE32(pos, HS20_IE_VENDOR_TYPE);
+	pos += 4;
+	*pos++ = HS20_ANQP_DOMAIN_ID_PRESENT;
+	WPA_PUT_LE16(pos, domain_id);
+	pos += 2;
+
+	res = wpas_test_scan_res(i, 2412, ies, pos - ies, NULL, 0);
+	if (res == NULL)
+		return NULL;
+	os_get_reltime(&fetch);
+	wpa_bss_update_start(wpa_s);
+	wpa_bss_update_scan_res(wpa_s, res, &fetch);
+	wpa_bss_update_end(wpa_s, NULL, 0);
+	os_memcpy(bssid, res->bssid, ETH_ALEN);
+	os_free(res);
+
+	return wpa_bss_get_bssid(wpa_s, bssid);
+}
+
+
+static int wpas_anqp_cache_test_stats(struct wpa_supplicant *wpa_s,
+				      unsigned int entries, unsigned int hits,
+				      unsigned int misses,
+				      unsigned int invalidated,
+				      unsigned int expired, const char *name)
+{
+	struct anqp_cache_stats stats;
+
+	anqp_cache_get_stats(wpa_s, &stats);
+	if (stats.entries != entries || stats.hits != hits ||
+	    stats.misses != misses || stats.invalidated != invalidated ||
+	    stats.expired != expired) {
+		wpa_printf(MSG_ERROR, "ANQP cache test (%s): entries=%u hits=%u misses=%u invalidated=%u expired=%u",
+			   name, stats.entries, stats.hits, stats.misses,
+			   stats.invalidated, stats.expired);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int wpas_anqp_cache_module_tests(void)
+{
+	struct wpas_test_iface t;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_bss *bss[3];
+	char *buf = NULL;
+	size_t i, len;
+	FILE *f;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "ANQP cache module tests");
+
+	unlink(ANQP_CACHE_TEST_FILE);
+	wpa_s = wpas_test_iface_init(&t);
+	if (wpa_s == NULL)
+		return -1;
+	wpa_s->conf->anqp_cache = os_strdup(ANQP_CACHE_TEST_FILE);
+	if (wpa_s->conf->anqp_cache == NULL)
+		goto fail;
+
+	/* BSS 0 and 1 in the same ANQP domain, BSS 2 in another one */
+	bss[0] = wpas_anqp_cache_test_bss(wpa_s, 0, 0x1234);
+	bss[1] = wpas_anqp_cache_test_bss(wpa_s, 1, 0x1234);
+	bss[2] = wpas_anqp_cache_test_bss(wpa_s, 2, 0x4321);
+	if (bss[0] == NULL || bss[1] == NULL || bss[2] == NULL ||
+	    interworking_anqp_domain_id(bss[0]) != 0x1234)
+		goto fail;
+
+	if (anqp_cache_get(wpa_s, bss[0], 1) == 0 ||
+	    wpa_bss_anqp_unshare_alloc(bss[0]) < 0)
+		goto fail;
+	bss[0]->anqp->nai_realm = wpabuf_alloc_copy("realm", 5);
+	bss[0]->anqp->domain_name = wpabuf_alloc_copy("domain", 6);
+	if (bss[0]->anqp->nai_realm == NULL ||
+	    bss[0]->anqp->domain_name == NULL)
+		goto fail;
+#ifdef CONFIG_HS20
+	bss[0]->anqp->hs20_osu_providers_list = wpabuf_alloc_copy("osu", 3);
+	if (bss[0]->anqp->hs20_osu_providers_list == NULL)
+		goto fail;
+#endif /* CONFIG_HS20 */
+	anqp_cache_store(wpa_s, bss[0], 1);
+
+	/* Shared within the ANQP domain */
+	if (anqp_cache_get(wpa_s, bss[1], 1) < 0 || bss[1]->anqp == NULL ||
+	    bss[1]->anqp->nai_realm == NULL ||
+	    wpabuf_len(bss[1]->anqp->nai_realm) != 5 ||
+	    os_memcmp(wpabuf_head(bss[1]->anqp->nai_realm), "realm", 5) != 0 ||
+	    bss[1]->anqp->domain_name == NULL ||
+	    bss[1]->anqp->venue_name != NULL ||
+	    anqp_cache_get(wpa_s, bss[2], 1) == 0 ||
+	    wpas_anqp_cache_test_stats(wpa_s, 1, 1, 2, 0, 0, "store") < 0)
+		goto fail;
+#ifdef CONFIG_HS20
+	/* Cached elements are processed like a received response */
+	if (bss[1]->anqp->hs20_osu_providers_list == NULL ||
+	    wpabuf_len(bss[1]->anqp->hs20_osu_providers_list) != 3 ||
+	    wpa_s->num_prov_found != 1)
+		goto fail;
+#endif /* CONFIG_HS20 */
+
+	/* Restored from the file on first use after restart */
+	anqp_cache_deinit(wpa_s);
+	if (anqp_cache_get(wpa_s, bss[1], 1) < 0 ||
+	    wpas_anqp_cache_test_stats(wpa_s, 1, 1, 0, 0, 0, "restored") < 0)
+		goto fail;
+
+	/* Changed ANQP Domain ID invalidates the entry */
+	bss[0] = wpas_anqp_cache_test_bss(wpa_s, 0, 0x1235);
+	if (bss[0] == NULL || anqp_cache_get(wpa_s, bss[0], 1) == 0 ||
+	    anqp_cache_get(wpa_s, bss[1], 1) == 0 ||
+	    wpas_anqp_cache_test_stats(wpa_s, 0, 1, 2, 1, 0,
+				       "invalidated") < 0)
+		goto fail;
+
+	/* Expired entries are dropped on load */
+	anqp_cache_store(wpa_s, bss[1], 0);
+	anqp_cache_deinit(wpa_s);
+	buf = os_readfile(ANQP_CACHE_TEST_FILE, &len);
+	if (buf == NULL || len < 25)
+		goto fail;
+	WPA_PUT_LE32((u8 *) buf + 6 + 2 * ETH_ALEN + 2 + 1, 1);
+	f = fopen(ANQP_CACHE_TEST_FILE, "wb");
+	if (f == NULL)
+		goto fail;
+	fwrite(buf, 1, len, f);
+	fclose(f);
+	if (anqp_cache_get(wpa_s, bss[1], 0) == 0 ||
+	    wpas_anqp_cache_test_stats(wpa_s, 0, 0, 1, 0, 1, "expired") < 0)
+		goto fail;
+
+	/* Truncated cache files are ignored */
+	anqp_cache_deinit(wpa_s);
+	for (i = 1; i < len; i += 3) {
+		f = fopen(ANQP_CACHE_TEST_FILE, "wb");
+		if (f == NULL)
+			goto fail;
+		fwrite(buf, 1, i, f);
+		fclose(f);
+		if (anqp_cache_get(wpa_s, bss[1], 0) == 0)
+			goto fail;
+		anqp_cache_deinit(wpa_s);
+	}
+
+	ret = 0;
+fail:
+	os_free(buf);
+	anqp_cache_deinit(wpa_s);
+	unlink(ANQP_CACHE_TEST_FILE);
+	wpas_test_iface_deinit(&t);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "ANQP cache module test failure");
+
+	return ret;
+}
+
+#endif /* CONFIG_ANQP_CACHE */
+
+
+static void wpas_radio_test_cb(struct wpa_radio_work *work, int deinit)
+{
+	struct wpa_radio_work **started = work->ctx;
+
+	if (!deinit && started)
+		*started = work;
+}
+
+
+static int wpas_radio_test_add(struct wpa_supplicant *wpa_s, const char *type,
+			       enum radio_work_prio prio, int next)
+{
+	return radio_add_work(wpa_s, 0, type, prio, next, wpas_radio_test_cb,
+			      NULL);
+}
+
+
+/* Start the next work and check that it is of the expected type */
+static struct wpa_radio_work * wpas_radio_test_next(struct wpa_radio *radio,
+						    const char *type)
+{
+	struct wpa_radio_work *work = NULL, *queued;
+
+	dl_list_for_each(queued, &radio->work, struct wpa_radio_work, list) {
+		if (queued->cb == wpas_radio_test_cb)
+			queued->ctx = &work;
+	}
+	radio_work_test_next(radio);
+	if (work)
+		work->ctx = NULL;
+	if (work == NULL || os_strcmp(work->type, type) != 0) {
+		wpa_printf(MSG_ERROR, "Radio work test: started '%s' instead of '%s'",
+			   work ? work->type : "N/A", type);
+		return NULL;
+	}
+
+	return work;
+}
+
+
+static struct radio_work_stats * wpas_radio_test_stats(struct wpa_radio *radio,
+						       const char *type)
+{
+	unsigned int i;
+
+	for (i = 0; i < radio->num_work_stats; i++) {
+		if (os_strcmp(radio->work_stats[i].type, type) == 0)
+			return &radio->work_stats[i];
+	}
+
+	return NULL;
+}
+
+
+static int wpas_radio_test_scan(struct wpa_supplicant *wpa_s, const char *ssid,
+				const int *freqs, const char *extra_ies)
+{
+	struct wpa_driver_scan_params params;
+	int freq_list[4];
+	unsigned int i;
+
+	os_memset(&params, 0, sizeof(params));
+	params.ssids[0].ssid = (const u8 *) ssid;
+	params.ssids[0].ssid_len = os_strlen(ssid);
+	params.num_ssids = 1;
+	for (i = 0; freqs[i]; i++)
+		freq_list[i] = freqs[i];
+	freq_list[i] = 0;
+	params.freqs = freq_list;
+	if (extra_ies) {
+		params.extra_ies = (const u8 *) extra_ies;
+		params.extra_ies_len = os_strlen(extra_ies);
+	}
+
+	return wpa_supplicant_trigger_scan(wpa_s, &params);
+}
+
+
+static int wpas_radio_work_module_tests(void)
+{
+	static const int freqs_a[] = { 2412, 2437, 0 };
+	static const int freqs_b[] = { 2462, 2437, 0 };
+	static const int freqs_5g[] = { 5180, 0 };
+	struct wpas_test_iface t;
+	struct wpa_radio *radio = &t.radio;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_radio_work *work;
+	struct wpa_driver_scan_params *params;
+	struct radio_work_stats *stats;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "Radio work module tests");
+
+	wpa_s = wpas_test_iface_init(&t);
+	if (wpa_s == NULL)
+		return -1;
+	wpa_s->max_scan_ssids = 2;
+
+	/* Works are started in priority order and in order within a class */
+	if (wpas_radio_test_add(wpa_s, "gas-query",
+				RADIO_WORK_PRIO_BACKGROUND, 0) < 0 ||
+	    wpas_radio_test_add(wpa_s, "scan", RADIO_WORK_PRIO_NORMAL, 0) < 0 ||
+	    wpas_radio_test_add(wpa_s, "ext:a", RADIO_WORK_PRIO_NORMAL,
+				0) < 0 ||
+	    wpas_radio_test_add(wpa_s, "connect", RADIO_WORK_PRIO_URGENT,
+				0) < 0 ||
+	    wpas_radio_test_add(wpa_s, "ext:b", RADIO_WORK_PRIO_NORMAL, 1) < 0)
+		goto fail;
+	if ((work = wpas_radio_test_next(radio, "ext:b")) == NULL ||
+	    radio_work_preempt_pending(work))
+		goto fail;
+	radio_work_done(work);
+	if ((work = wpas_radio_test_next(radio, "connect")) == NULL)
+		goto fail;
+	radio_work_done(work);
+	if ((work = wpas_radio_test_next(radio, "scan")) == NULL ||
+	    radio_work_preempt_pending(work))
+		goto fail;
+	radio_work_done(work);
+	if ((work = wpas_radio_test_next(radio, "ext:a")) == NULL)
+		goto fail;
+	radio_work_done(work);
+	if ((work = wpas_radio_test_next(radio, "gas-query")) == NULL)
+		goto fail;
+
+	/* A background work yields to a queued normal priority work */
+	if (wpas_radio_test_add(wpa_s, "scan", RADIO_WORK_PRIO_NORMAL, 0) < 0 ||
+	    !radio_work_preempt_pending(work))
+		goto fail;
+	radio_work_done(work);
+	if ((work = wpas_radio_test_next(radio, "scan")) == NULL)
+		goto fail;
+	radio_work_done(work);
+
+	/* A work past its deadline is handled with the next priority */
+	if (wpas_radio_test_add(wpa_s, "gas-query",
+				RADIO_WORK_PRIO_BACKGROUND, 0) < 0 ||
+	    wpas_radio_test_add(wpa_s, "scan", RADIO_WORK_PRIO_NORMAL, 0) < 0)
+		goto fail;
+	work = dl_list_first(&radio->work, struct wpa_radio_work, list);
+	work->deadline.sec -= 11;
+	work->time.sec -= 11;
+	if ((work = wpas_radio_test_next(radio, "gas-query")) == NULL)
+		goto fail;
+	radio_work_done(work);
+	if ((work = wpas_radio_test_next(radio, "scan")) == NULL)
+		goto fail;
+	radio_work_done(work);
+
+	stats = wpas_radio_test_stats(radio, "gas-query");
+	if (stats == NULL || stats->started != 2 || stats->late != 1 ||
+	    stats->max_wait_usec < 11000000ULL ||
+	    stats->wait_usec < stats->max_wait_usec)
+		goto fail;
+	/* External works share a single entry */
+	stats = wpas_radio_test_stats(radio, "ext");
+	if (stats == NULL || stats->started != 2 ||
+	    wpas_radio_test_stats(radio, "ext:a") ||
+	    radio->num_work_stats != 4)
+		goto fail;
+
+	/* A compatible scan request is merged into the queued scan */
+	if (wpas_radio_test_scan(wpa_s, "a", freqs_a, NULL) < 0 ||
+	    wpas_radio_test_scan(wpa_s, "b", freqs_b, NULL) < 0 ||
+	    dl_list_len(&radio->work) != 1)
+		goto fail;
+	work = dl_list_first(&radio->work, struct wpa_radio_work, list);
+	params = work->ctx;
+	if (params->num_ssids != 2 || params->ssids[1].ssid_len != 1 ||
+	    params->ssids[1].ssid[0] != 'b' || params->freqs == NULL ||
+	    params->freqs[0] != 2412 || params->freqs[1] != 2437 ||
+	    params->freqs[2] != 2462 || params->freqs[3] != 0)
+		goto fail;
+	stats = wpas_radio_test_stats(radio, "scan");
+	if (stats == NULL || stats->merged != 1)
+		goto fail;
+
+	/*
+	 * Requests with different extra IEs, no common channels, or too many
+	 * SSIDs in total are queued separately.
+	 */
+	if (wpas_radio_test_scan(wpa_s, "a", freqs_a, "ie") < 0 ||
+	    wpas_radio_test_scan(wpa_s, "a", freqs_5g, NULL) < 0 ||
+	    wpas_radio_test_scan(wpa_s, "c", freqs_a, NULL) < 0 ||
+	    dl_list_len(&radio->work) != 4 || stats->merged != 1)
+		goto fail;
+	params = work->ctx;
+	if (params->num_ssids != 2)
+		goto fail;
+
+	ret = 0;
+fail:
+	wpas_test_iface_deinit(&t);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "Radio work module test failure");
+
+	return ret;
+}
+
+
+#ifdef CONFIG_GAS
+
+#define GAS_TEST_QUERIES 6
+
+struct wpas_gas_test {
+	struct wpa_supplicant *wpa_s;
+	unsigned int num_tx;
+	u8 tx_dst[ETH_ALEN];
+	unsigned int tx_freq;
+	u8 tx_frame[24 + 10];
+	size_t tx_len;
+	int result[GAS_TEST_QUERIES];
+	int dialog_token[GAS_TEST_QUERIES];
+	u8 addr[GAS_TEST_QUERIES][ETH_ALEN];
+};
+
+
+static int wpas_gas_test_send_action(void *priv, unsigned int freq,
+				     unsigned int wait, const u8 *dst,
+				     const u8 *src, const u8 *bssid,
+				     const u8 *data, size_t data_len,
+				     int no_cck)
+{
+	struct wpas_gas_test *t = priv;
+
+	if (data_len > sizeof(t->tx_frame) - 24)
+		return -1;
+	t->num_tx++;
+	os_memcpy(t->tx_dst, dst, ETH_ALEN);
+	t->tx_freq = freq;
+	os_memset(t->tx_frame, 0, 24);
+	os_memcpy(t->tx_frame + 24, data, data_len);
+	t->tx_len = 24 + data_len;
+	return 0;
+}
+
+
+static void wpas_gas_test_cb(void *ctx, const u8 *dst, u8 dialog_token,
+			     enum gas_query_result result,
+			     const struct wpabuf *adv_proto,
+			     const struct wpabuf *resp, u16 status_code)
+{
+	int *res = ctx;
+
+	*res = result;
+}
+
+
+static int wpas_gas_test_req(struct wpas_gas_test *t, unsigned int i,
+			     int freq)
+{
+	struct wpabuf *req;
+
+	req = gas_build_initial_req(0, 10);
+	if (req == NULL)
+		return -1;
+	wpabuf_put_u8(req, 0);
+	wpas_bss_test_addr(t->addr[i], 0x02, i);
+	t->result[i] = -1;
+	t->dialog_token[i] = gas_query_req(t->wpa_s->gas, t->addr[i], freq, req,
+					   wpas_gas_test_cb, &t->result[i]);
+	if (t->dialog_token[i] < 0) {
+		wpabuf_free(req);
+		return -1;
+	}
+	return 0;
+}
+
+
+/* Indicate TX status for the last transmitted frame */
+static void wpas_gas_test_tx_status(struct wpas_gas_test *t)
+{
+	offchannel_send_action_tx_status(t->wpa_s, t->tx_dst, t->tx_frame,
+					 t->tx_len,
+					 OFFCHANNEL_SEND_ACTION_SUCCESS);
+}
+
+
+static void wpas_gas_test_resp(struct wpas_gas_test *t, unsigned int i)
+{
+	u8 buf[2 + 2 + 2 + 4 + 2], *pos = buf;
+
+	*pos++ = WLAN_PA_GAS_INITIAL_RESP;
+	*pos++ = t->dialog_token[i];
+	WPA_PUT_LE16(pos, WLAN_STATUS_SUCCESS);
+	pos += 2;
+	WPA_PUT_LE16(pos, 0); /* Comeback Delay */
+	pos += 2;
+	*pos++ = WLAN_EID_ADV_PROTO;
+	*pos++ = 2;
+	*pos++ = 0x7f;
+	*pos++ = ACCESS_NETWORK_QUERY_PROTOCOL;
+	WPA_PUT_LE16(pos, 0); /* Query Response Length */
+	pos += 2;
+
+	gas_query_rx(t->wpa_s->gas, t->wpa_s->own_addr, t->addr[i], t->addr[i],
+		     WLAN_ACTION_PUBLIC, buf, pos - buf, 2412);
+}
+
+
+static int wpas_gas_test_check(struct wpas_gas_test *t, unsigned int num_tx,
+			       unsigned int tx_query, unsigned int num_work,
+			       const char *name)
+{
+	unsigned int i;
+
+	if (t->num_tx != num_tx ||
+	    (num_tx && os_memcmp(t->tx_dst, t->addr[tx_query],
+				 ETH_ALEN) != 0) ||
+	    dl_list_len(&t->wpa_s->radio->work) != num_work) {
+		wpa_printf(MSG_ERROR, "GAS query test (%s): num_tx=%u tx_dst="
+			   MACSTR " num_work=%u", name, t->num_tx,
+			   MAC2STR(t->tx_dst),
+			   dl_list_len(&t->wpa_s->radio->work));
+		for (i = 0; i < GAS_TEST_QUERIES; i++)
+			wpa_printf(MSG_ERROR, "GAS query test: query %u result %d",
+				   i, t->result[i]);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int wpas_gas_module_tests(void)
+{
+	struct wpa_driver_ops ops;
+	struct wpas_test_iface iface;
+	struct wpa_radio *radio = &iface.radio;
+	struct wpa_supplicant *wpa_s;
+	struct wpas_gas_test t;
+	unsigned int i;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "GAS query module tests");
+
+	os_memset(&ops, 0, sizeof(ops));
+	ops.send_action = wpas_gas_test_send_action;
+	os_memset(&t, 0, sizeof(t));
+
+	wpa_s = wpas_test_iface_init(&iface);
+	if (wpa_s == NULL)
+		return -1;
+	t.wpa_s = wpa_s;
+	wpa_s->driver = &ops;
+	wpa_s->drv_priv = &t;
+	wpa_s->drv_flags = WPA_DRIVER_FLAGS_OFFCHANNEL_TX;
+	wpa_s->own_addr[0] = 0x02;
+	wpa_s->own_addr[1] = 0xff;
+	wpa_s->conf->gas_max_parallel = 2;
+	wpa_s->gas = gas_query_init(wpa_s);
+	if (wpa_s->gas == NULL)
+		goto fail;
+
+	/* Queries 0-2 on the same channel, query 3 on another one */
+	for (i = 0; i < 4; i++) {
+		if (wpas_gas_test_req(&t, i, i < 3 ? 2412 : 2437) < 0)
+			goto fail;
+	}
+	if (wpas_gas_test_check(&t, 0, 0, 4, "queued") < 0)
+		goto fail;
+
+	/* Query 1 joins the radio work of query 0, but waits for its TX */
+	radio_work_test_next(radio);
+	if (wpas_gas_test_check(&t, 1, 0, 3, "join") < 0 ||
+	    radio->num_work_stats != 1 || radio->work_stats[0].merged != 1)
+		goto fail;
+	wpas_gas_test_tx_status(&t);
+	if (wpas_gas_test_check(&t, 2, 1, 3, "serialized TX") < 0)
+		goto fail;
+	wpas_gas_test_tx_status(&t);
+
+	/* Query 2 joins once query 0 has completed */
+	wpas_gas_test_resp(&t, 0);
+	if (t.result[0] != GAS_QUERY_SUCCESS ||
+	    wpas_gas_test_check(&t, 3, 2, 2, "response") < 0)
+		goto fail;
+
+	/* Cancel query 1 and query 2 with its TX in progress */
+	gas_query_cancel(wpa_s->gas, t.addr[1], t.dialog_token[1]);
+	if (t.result[1] != GAS_QUERY_CANCELLED ||
+	    wpas_gas_test_check(&t, 3, 2, 2, "cancel") < 0)
+		goto fail;
+	gas_query_cancel(wpa_s->gas, t.addr[2], t.dialog_token[2]);
+	if (t.result[2] != GAS_QUERY_CANCELLED ||
+	    wpas_gas_test_check(&t, 3, 2, 1, "cancel last") < 0)
+		goto fail;
+
+	/* Query 3 gets its own radio work on the other channel */
+	radio_work_test_next(radio);
+	if (wpas_gas_test_check(&t, 4, 3, 1, "next work") < 0 ||
+	    t.tx_freq != 2437)
+		goto fail;
+
+	/* Deinit removes both the started and the queued works */
+	if (wpas_gas_test_req(&t, 4, 2462) < 0 ||
+	    wpas_gas_test_req(&t, 5, 2437) < 0 ||
+	    wpas_gas_test_check(&t, 4, 3, 3, "queued at deinit") < 0)
+		goto fail;
+	gas_query_deinit(wpa_s->gas);
+	wpa_s->gas = NULL;
+	if (t.result[3] != GAS_QUERY_DELETED_AT_DEINIT ||
+	    t.result[4] != GAS_QUERY_DELETED_AT_DEINIT ||
+	    t.result[5] != GAS_QUERY_DELETED_AT_DEINIT ||
+	    wpas_gas_test_check(&t, 4, 3, 0, "deinit") < 0)
+		goto fail;
+
+	ret = 0;
+fail:
+	gas_query_deinit(wpa_s->gas);
+	offchannel_deinit(wpa_s);
+	wpas_test_iface_deinit(&iface);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "GAS query module test failure");
+
+	return ret;
+}
+
+#endif /* CONFIG_GAS */
+
+
+int wpas_module_tests(void)
+{
+	int ret = 0;
+
+	wpa_printf(MSG_INFO, "wpa_supplicant module tests");
+
+	if (wpas_blacklist_module_tests() < 0)
+		ret = -1;
+
+	if (wpas_bss_module_tests() < 0)
+		ret = -1;
+
+	if (wpas_bss_ie_module_tests() < 0)
+		ret = -1;
+
+	if (wpas_bss_ies_module_tests() < 0)
+		ret = -1;
+
+	if (wpas_scan_stream_module_tests() < 0)
+		ret = -1;
+
+	if (wpas_select_module_tests() < 0)
+		ret = -1;
+
+	if (wpas_sort_module_tests() < 0)
+		ret = -1;
+
+#ifdef CONFIG_SCAN_HISTORY
+	if (wpas_scan_history_module_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_SCAN_HISTORY */
+
+#ifdef CONFIG_ANQP_CACHE
+	if (wpas_anqp_cache_module_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_ANQP_CACHE */
+
+	if (wpas_radio_work_module_tests() < 0)
+		ret = -1;
+
+#ifdef CONFIG_GAS
+	if (wpas_gas_module_tests() < 0)
 		ret = -1;
+#endif /* CONFIG_GAS */
 
 #ifdef CONFIG_WPS
 	{
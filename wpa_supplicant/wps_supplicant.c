@@ -383,6 +383,7 @@ static int wpa_supplicant_wps_cred(void *ctx,
 		os_memcpy(ssid->ssid, cred->ssid, cred->ssid_len);
 		ssid->ssid_len = cred->ssid_len;
 	}
+	wpa_config_flush_ssid_index(wpa_s->conf);
 
 	switch (cred->encr_type) {
 	case WPS_ENCR_NONE:
@@ -2677,8 +2678,13 @@ static struct wps_ap_info * wpas_wps_get_ap_info(struct wpa_supplicant *wpa_s,
 }
 
 
-static void wpas_wps_update_ap_info_bss(struct wpa_supplicant *wpa_s,
-					struct wpa_scan_res *res)
+/**
+ * wpas_wps_update_ap_info_res - Update WPS AP information from a scan result
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @res: Scan result entry
+ */
+void wpas_wps_update_ap_info_res(struct wpa_supplicant *wpa_s,
+				 struct wpa_scan_res *res)
 {
 	struct wpabuf *wps;
 	enum wps_ap_info_type type;
@@ -2737,8 +2743,9 @@ void wpas_wps_update_ap_info(struct wpa_supplicant *wpa_s,
 {
 	size_t i;
 
-	for (i = 0; i < scan_res->num; i++)
-		wpas_wps_update_ap_info_bss(wpa_s, scan_res->res[i]);
+	/* Scan results may have already been processed one at a time */
+	for (i = 0; scan_res && i < scan_res->num; i++)
+		wpas_wps_update_ap_info_res(wpa_s, scan_res->res[i]);
 
 	wpas_wps_dump_ap_info(wpa_s);
 }
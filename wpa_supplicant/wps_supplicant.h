@@ -10,6 +10,7 @@
 #define WPS_SUPPLICANT_H
 
 struct wpa_scan_results;
+struct wpa_scan_res;
 
 #ifdef CONFIG_WPS
 
@@ -85,6 +86,8 @@ int wpas_er_wps_nfc_report_handover(struct wpa_supplicant *wpa_s,
 				    const struct wpabuf *sel);
 void wpas_wps_update_ap_info(struct wpa_supplicant *wpa_s,
 			     struct wpa_scan_results *scan_res);
+void wpas_wps_update_ap_info_res(struct wpa_supplicant *wpa_s,
+				 struct wpa_scan_res *res);
 void wpas_wps_notify_assoc(struct wpa_supplicant *wpa_s, const u8 *bssid);
 
 #else /* CONFIG_WPS */
@@ -143,6 +146,11 @@ static inline void wpas_wps_update_ap_info(struct wpa_supplicant *wpa_s,
 {
 }
 
+static inline void wpas_wps_update_ap_info_res(struct wpa_supplicant *wpa_s,
+					       struct wpa_scan_res *res)
+{
+}
+
 static inline void wpas_wps_notify_assoc(struct wpa_supplicant *wpa_s,
 					 const u8 *bssid)
 {